@@ -4,6 +4,7 @@
 	the platform-specific initializer and the main() function.
 */
 
+extern void *_siramfunc, *_sramfunc, *_eramfunc;
 extern void *_sidata, *_sdata, *_edata;
 extern void *_sbss, *_ebss;
 
@@ -20,6 +21,9 @@ void __attribute__((naked, noreturn)) Reset_Handler()
 	//asm ("ldr sp, =_estack");
 
 	void **pSource, **pDest;
+	for (pSource = &_siramfunc, pDest = &_sramfunc; pDest != &_eramfunc; pSource++, pDest++)
+		*pDest = *pSource;
+
 	for (pSource = &_sidata, pDest = &_sdata; pDest != &_edata; pSource++, pDest++)
 		*pDest = *pSource;
 
@@ -0,0 +1,60 @@
+/*
+* capture_frame.h
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#ifndef _CAPTURE_FRAME_H_
+#define _CAPTURE_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*!
+* \def CAPTURE_FRAME_TYPE The P2PPE frame type of raw sensor capture frames
+*/
+#define CAPTURE_FRAME_TYPE          (0x04)
+
+/*!
+* \def CAPTURE_MAX_SAMPLES The maximum number of MPU6050 samples per capture frame
+*/
+#define CAPTURE_MAX_SAMPLES         (4)
+
+/*!
+* \def CAPTURE_FLAG_COMPASS_FRESH Capture frame flag: The HMC5883L sample was read since the previous frame
+*/
+#define CAPTURE_FLAG_COMPASS_FRESH  (0x01)
+
+/*!
+* \brief A raw MPU6050 sample as read from the data registers or the FIFO
+*/
+#pragma pack(1)
+typedef struct __attribute__ ((__packed__)) {
+    int16_t accel[3];               //!< Accelerometer x, y, z
+    int16_t gyro[3];                //!< Gyroscope x, y, z
+} capture_mpu6050_sample_t;
+
+/*!
+* \brief The payload of a raw sensor capture frame, following the frame type byte
+*
+* The sequence number counts MPU6050 samples, so that the receiver can tell dropped
+* samples (a gap in the sequence) from late ones (a gap in the timestamps).
+* Only the first {\ref capture_frame_t::count} samples are transmitted.
+*/
+typedef struct __attribute__ ((__packed__)) {
+    uint16_t sequence;              //!< Sequence number of the first MPU6050 sample in this frame
+    uint32_t timestamp;             //!< Timebase microseconds of the last MPU6050 sample of the batch, or of the fetch if there are none
+    uint8_t count;                  //!< Number of MPU6050 samples in this frame; May be zero.
+    uint8_t flags;                  //!< Combination of CAPTURE_FLAG_*
+    int16_t compass[3];             //!< The latest HMC5883L sample x, y, z
+    capture_mpu6050_sample_t samples[CAPTURE_MAX_SAMPLES]; //!< The MPU6050 samples, oldest first
+} capture_frame_t;
+#pragma pack()
+
+/*!
+* \def CAPTURE_FRAME_SIZE The payload size of a capture frame with the given number of samples
+*/
+#define CAPTURE_FRAME_SIZE(count)   (offsetof(capture_frame_t, samples) + (count) * sizeof(capture_mpu6050_sample_t))
+
+#endif
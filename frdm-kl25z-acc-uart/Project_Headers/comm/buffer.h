@@ -17,8 +17,29 @@
  */
 #define RINGBUFFER_ENABLE_WFI_ON_BLOCK 0
 
+/**
+ * @brief Enables tracking of the peak occupancy, see {@see RingBuffer_Peak()}.
+ */
+#ifndef RINGBUFFER_TRACK_PEAK
+#define RINGBUFFER_TRACK_PEAK 1
+#endif
+
+/**
+ * @brief Orders the memory accesses before and after it, for the compiler as well as the core.
+ *
+ * The CMSIS __DMB() lacks a memory clobber, so the compiler may move the
+ * (non-volatile) data accesses across it.
+ */
+#define RingBuffer_Barrier()	__ASM volatile ("dmb" : : : "memory")
+
 /**
  * @brief Ring buffer type
+ *
+ * Single producer, single consumer: Only the producer writes {@see buffer_t::writeIndex}
+ * and the data, only the consumer writes {@see buffer_t::readIndex}. The producer
+ * publishes data by storing the write index after the data (release), the consumer
+ * loads the write index before the data (acquire); Releasing a slot works the other
+ * way around. Either side may run in an IRQ handler, no locks are taken.
  */
 typedef struct {
 	uint32_t size;			/*< The data array size; Power of two */
@@ -26,6 +47,9 @@ typedef struct {
 	volatile uint32_t writeIndex;	/*< The write index */
 	volatile uint32_t readIndex;	/*< The read index */
 	uint8_t */*const*/ data;		/*< The data array; Size is defined in size */
+#if RINGBUFFER_TRACK_PEAK
+	volatile uint32_t peak;			/*< The highest item count seen by the producer; Written by the producer only. */
+#endif
 } buffer_t;
 
 /**
@@ -43,7 +67,36 @@ uint8_t RingBuffer_Init(buffer_t *const buffer, uint8_t (*const data)[], const u
 __STATIC_INLINE void RingBuffer_Reset(buffer_t *buffer)
 {
 	buffer->writeIndex = buffer->readIndex = 0;
-	__DMB();
+	RingBuffer_Barrier();
+}
+
+/**
+ * @brief Updates the peak occupancy after the producer advanced the write index
+ * @param[in] buffer The ring buffer instance
+ * @param[in] writeIndex The new write index
+ *
+ * Must be called by the producer; A no-op unless {@see RINGBUFFER_TRACK_PEAK} is set.
+ */
+__STATIC_INLINE void RingBuffer_TrackPeak(buffer_t *const buffer, const uint32_t writeIndex)
+{
+#if RINGBUFFER_TRACK_PEAK
+	const uint32_t count = writeIndex - buffer->readIndex;
+	if (count > buffer->peak) buffer->peak = count;
+#endif
+}
+
+/**
+ * @brief Gets the peak occupancy
+ * @param[in] buffer The ring buffer instance
+ * @return The highest item count since the initialization; Larger than the size if the buffer overflowed. Zero unless {@see RINGBUFFER_TRACK_PEAK} is set.
+ */
+__STATIC_INLINE uint32_t RingBuffer_Peak(const buffer_t *const buffer)
+{
+#if RINGBUFFER_TRACK_PEAK
+	return buffer->peak;
+#else
+	return 0;
+#endif
 }
 
 /**
@@ -53,20 +106,31 @@ __STATIC_INLINE void RingBuffer_Reset(buffer_t *buffer)
  */
 __STATIC_INLINE void RingBuffer_Write(buffer_t *buffer, const uint8_t data)
 {
-	buffer->data[buffer->mask & (buffer->writeIndex++)] = data;
-	__DMB();
+	const uint32_t index = buffer->writeIndex;
+	buffer->data[buffer->mask & index] = data;
+	
+	/* release: the data must be in place before the reader sees the index */
+	RingBuffer_Barrier();
+	buffer->writeIndex = index + 1;
+	RingBuffer_TrackPeak(buffer, index + 1);
 }
 
 /**
  * @brief Reads an item from the ring buffer
  * @param[in] buffer The ring buffer instance
  * @return The data read
+ *
+ * The buffer must not be empty, see {@see RingBuffer_Empty()}, which also
+ * orders the index before the data. Safe to use in IRQ handlers.
  */
 __STATIC_INLINE const uint8_t RingBuffer_Read(buffer_t *const buffer)
 {
-	const uint8_t data = buffer->data[buffer->mask & (buffer->readIndex++)];
-	assert(buffer->readIndex <= buffer->writeIndex);
-	__DMB();
+	const uint32_t index = buffer->readIndex;
+	const uint8_t data = buffer->data[buffer->mask & index];
+	
+	/* release: the data must be read before the writer sees the slot freed */
+	RingBuffer_Barrier();
+	buffer->readIndex = index + 1;
 	return data;
 }
 
@@ -77,9 +141,12 @@ __STATIC_INLINE const uint8_t RingBuffer_Read(buffer_t *const buffer)
  */
 __STATIC_INLINE const uint8_t RingBuffer_Empty(const buffer_t *const buffer)
 {
-	__DMB();
 	/* no masking required here because indices are free running and only masked on access */
-	return (buffer->readIndex == buffer->writeIndex);
+	const uint8_t empty = (buffer->readIndex == buffer->writeIndex);
+	
+	/* acquire: the data must not be accessed before the indices were loaded */
+	RingBuffer_Barrier();
+	return empty;
 }
 
 /**
@@ -89,9 +156,12 @@ __STATIC_INLINE const uint8_t RingBuffer_Empty(const buffer_t *const buffer)
  */
 __STATIC_INLINE const uint32_t RingBuffer_Count(const buffer_t *const buffer)
 {
-	__DMB();
 	/* no masking required here because indices are free running and only masked on access */
-	return /*buffer->mask &*/ (uint32_t)(buffer->writeIndex - buffer->readIndex);
+	const uint32_t count = /*buffer->mask &*/ (uint32_t)(buffer->writeIndex - buffer->readIndex);
+	
+	/* acquire: the data must not be accessed before the indices were loaded */
+	RingBuffer_Barrier();
+	return count;
 }
 
 /**
@@ -104,6 +174,89 @@ __STATIC_INLINE const uint8_t RingBuffer_Full(const buffer_t *const buffer)
 	return RingBuffer_Count(buffer) >= buffer->size;
 }
 
+/**
+ * @brief Reserves contiguous write space in the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[out] span The start of the writable region
+ * @return The number of bytes that may be written to span; Zero if the buffer is full.
+ * 
+ * The data becomes visible to the reader only after {@see RingBuffer_CommitWrite()}.
+ * Free space that wraps around the end of the data array needs a second reservation.
+ */
+__STATIC_INLINE uint32_t RingBuffer_ReserveWrite(buffer_t *const buffer, uint8_t **const span)
+{
+	const uint32_t count = RingBuffer_Count(buffer);
+	const uint32_t offset = buffer->mask & buffer->writeIndex;
+	const uint32_t free = (count < buffer->size) ? buffer->size - count : 0;
+	const uint32_t tail = buffer->size - offset;
+	
+	*span = &buffer->data[offset];
+	return (free < tail) ? free : tail;
+}
+
+/**
+ * @brief Commits bytes written to a region obtained by {@see RingBuffer_ReserveWrite()}
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of bytes written
+ */
+__STATIC_INLINE void RingBuffer_CommitWrite(buffer_t *const buffer, const uint32_t count)
+{
+	/* release: the data must be in place before the reader sees the index */
+	RingBuffer_Barrier();
+	const uint32_t index = buffer->writeIndex + count;
+	buffer->writeIndex = index;
+	RingBuffer_TrackPeak(buffer, index);
+}
+
+/**
+ * @brief Peeks the contiguous readable region of the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[out] span The start of the readable region
+ * @return The number of bytes that may be read from span; Zero if the buffer is empty.
+ * 
+ * The data is released to the writer only after {@see RingBuffer_Consume()}.
+ * Data that wraps around the end of the data array needs a second peek.
+ */
+__STATIC_INLINE uint32_t RingBuffer_PeekRead(const buffer_t *const buffer, const uint8_t **const span)
+{
+	const uint32_t count = RingBuffer_Count(buffer);
+	const uint32_t offset = buffer->mask & buffer->readIndex;
+	const uint32_t tail = buffer->size - offset;
+	
+	*span = &buffer->data[offset];
+	return (count < tail) ? count : tail;
+}
+
+/**
+ * @brief Releases bytes read from a region obtained by {@see RingBuffer_PeekRead()}
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of bytes read
+ */
+__STATIC_INLINE void RingBuffer_Consume(buffer_t *const buffer, const uint32_t count)
+{
+	/* release: the data must be read before the writer sees the index */
+	RingBuffer_Barrier();
+	buffer->readIndex += count;
+}
+
+/**
+ * @brief Writes as many items as fit into the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[in] data The data to write
+ * @param[in] count The number of bytes to write
+ * @return The number of bytes written
+ */
+uint32_t RingBuffer_WriteBlock(buffer_t *const buffer, const uint8_t *const data, const uint32_t count);
+
+/**
+ * @brief Reads as many items as available from the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[out] data The data read
+ * @param[in] count The maximum number of bytes to read
+ * @return The number of bytes read
+ */
+uint32_t RingBuffer_ReadBlock(buffer_t *const buffer, uint8_t *const data, const uint32_t count);
+
 /**
  * @brief Blocks until the ring buffer contains data 
  * @param[in] buffer The ring buffer instance
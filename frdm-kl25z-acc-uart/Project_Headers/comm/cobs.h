@@ -0,0 +1,84 @@
+/*
+ * cobs.h
+ *
+ * Consistent Overhead Byte Stuffing framing, an alternative to P2PPE.
+ * The payload is followed by its CRC-16 (see crc16.h, little endian), COBS
+ * encoded and terminated by a zero byte. Encoding replaces every zero by
+ * the distance to the next one, so that the overhead is fixed for frames of
+ * less than 254 bytes: one code byte plus the delimiter, regardless of content.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The frame delimiter
+ */
+#define COBS_DELIMITER				(0x00)
+
+/**
+ * @brief The maximum encoded length of a frame
+ * @param[in] payloadCount The number of prefix and data bytes
+ *
+ * Payload and CRC, one code byte per started block of 254 bytes and the delimiter;
+ * Exact if payload and CRC are shorter than 254 bytes.
+ */
+#define COBS_MAX_FRAME_LENGTH(payloadCount) ((payloadCount) + 2 + ((payloadCount) + 2) / 254 + 1 + 1)
+
+/**
+ * @brief Encodes a COBS frame with a prefix into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see COBS_MAX_FRAME_LENGTH(prefixCount + dataCount)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes, including the delimiter
+ */
+uint16_t COBS_EncodeFramePrefixed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount);
+
+/**
+ * @brief Result of feeding a byte to the COBS decoder
+ */
+typedef enum {
+	COBSD_PENDING = 0,		/*< No complete frame yet */
+	COBSD_FRAME = 1,		/*< A complete frame with a valid CRC was decoded */
+	COBSD_ERROR = 2,		/*< A malformed, oversized or corrupted frame was dropped */
+} cobsd_result_t;
+
+/**
+ * @brief State of the COBS decoder
+ */
+typedef struct {
+	uint8_t *buffer;		/*< The payload buffer */
+	uint8_t size;			/*< The payload buffer size in bytes */
+	uint8_t count;			/*< The number of bytes decoded */
+	uint8_t code;			/*< The code byte of the current block, zero at the start of a frame */
+	uint8_t remaining;		/*< The number of data bytes left in the current block */
+	uint8_t overflow;		/*< Nonzero if the frame did not fit the buffer */
+} cobsd_decoder_t;
+
+/**
+ * @brief Initializes the COBS decoder
+ * @param[out] decoder The decoder
+ * @param[in] buffer The payload buffer; Must hold the payload and the CRC. Larger frames are dropped.
+ * @param[in] size The payload buffer size in bytes
+ */
+void COBSD_Init(register cobsd_decoder_t *const decoder, register uint8_t *const buffer, register uint8_t size);
+
+/**
+ * @brief Feeds a received byte to the COBS decoder
+ * @param[inout] decoder The decoder
+ * @param[in] byte The received byte
+ * @return {@see COBSD_FRAME} if the payload of a complete frame is available in the buffer
+ *
+ * On {@see COBSD_FRAME}, the payload is valid until the next call; Its length, without
+ * the CRC, is found in {@see cobsd_decoder_t::count}. Delimiters between frames are ignored.
+ */
+cobsd_result_t COBSD_Decode(register cobsd_decoder_t *const decoder, register uint8_t byte);
+
+#endif /* COBS_H_ */
@@ -0,0 +1,134 @@
+/*
+ * command.h
+ *
+ * Decoder for the P2PPE framed commands received over the UART.
+ * Every command frame starts with the {@see command_id_t}, followed by its arguments
+ * in native endianness. Each decoded command is answered with an acknowledge frame.
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The P2PPE frame type of the acknowledge frames
+ */
+#define COMMAND_ACK_FRAME_TYPE		(0x11)
+
+/**
+ * @brief The P2PPE frame type of the statistics frames
+ */
+#define COMMAND_STATS_FRAME_TYPE	(0x12)
+
+/**
+ * @brief The P2PPE frame type of the echo frames answering {@see COMMAND_PING}
+ *
+ * The frame is the receive time and the transmit time of the firmware in microseconds
+ * on the timebase (uint32_t each), followed by the ping arguments, in native endianness.
+ */
+#define COMMAND_ECHO_FRAME_TYPE		(0x14)
+
+/**
+ * @brief The maximum payload length of a command frame in byte
+ */
+#define COMMAND_MAX_LENGTH			(24)
+
+/**
+ * @brief The commands
+ */
+typedef enum {
+	COMMAND_SET_OUTPUT_MODE = 0x01,			/*< uint8_t output_mode_t */
+	COMMAND_SET_RUN_MODE = 0x02,			/*< uint8_t run_mode_t */
+	COMMAND_SET_OUTPUT_PERIOD = 0x03,		/*< uint16_t period of the fused output in milliseconds */
+	COMMAND_SET_FILTER_PARAMETER = 0x04,	/*< uint8_t fusion_parameter_t, fix16_t value */
+	COMMAND_START_STREAMING = 0x05,			/*< no arguments */
+	COMMAND_STOP_STREAMING = 0x06,			/*< no arguments */
+	COMMAND_REQUEST_STATS = 0x07,			/*< no arguments; Answered with a statistics and an instrumentation frame before the acknowledge */
+	COMMAND_SET_CALIBRATION_ROW = 0x08,		/*< uint8_t command_sensor_t, uint8_t row (0..2), fix16_t[4] affine transformation row */
+	COMMAND_SET_VARIANCES = 0x09,			/*< uint8_t command_sensor_t, fix16_t[3] variances */
+	COMMAND_SAVE_PARAMETERS = 0x0A,			/*< no arguments; Stores the calibration and filter parameters in flash */
+	COMMAND_ERASE_PARAMETERS = 0x0B,		/*< no arguments; Reverts to the compiled-in defaults after the next reset */
+	COMMAND_START_MAG_CALIBRATION = 0x0C,	/*< no arguments; Starts collecting magnetometer samples for the ellipsoid fit */
+	COMMAND_FINISH_MAG_CALIBRATION = 0x0D,	/*< no arguments; Fits, applies and stores the magnetometer calibration */
+	COMMAND_SET_FRAMING = 0x0E,				/*< uint8_t io_framing_t; Applies to all frames sent afterwards, including the acknowledge */
+	COMMAND_SET_BAUD_RATE = 0x0F,			/*< uint32_t baud rate; Applied after the acknowledge was sent at the old rate */
+	COMMAND_SET_FUSION_MODE = 0x10,			/*< uint8_t fusion_mode_t */
+	COMMAND_SET_PERFORMANCE_PRESET = 0x11,	/*< uint8_t performance_preset_t; Sets the sensor rates, the hybrid fusion decimation and the output period */
+	COMMAND_SET_CLOCK_LEVEL = 0x12,			/*< uint8_t clock_level_t, or 0xFF for the automatic clock scaling; See cpu/governor.h */
+	COMMAND_SET_OUTPUT_TIMING = 0x13,		/*< uint8_t output_timing_t flags; See output_mode.h */
+	COMMAND_PING = 0x14,					/*< any arguments, e.g. the host send time; Answered with an echo frame before the acknowledge */
+} command_id_t;
+
+/**
+ * @brief The status codes of the acknowledge frames
+ */
+typedef enum {
+	COMMAND_OK = 0,							/*< The command was executed */
+	COMMAND_UNKNOWN = 1,					/*< The command is unknown */
+	COMMAND_INVALID_LENGTH = 2,				/*< The arguments have the wrong length */
+	COMMAND_INVALID_VALUE = 3,				/*< An argument is out of range */
+	COMMAND_FAILED = 4,						/*< The command was valid, but could not be executed */
+} command_status_t;
+
+/**
+ * @brief The sensors addressed by the calibration commands
+ */
+typedef enum {
+	COMMAND_SENSOR_ACCELEROMETER = 0,		/*< MPU6050 accelerometer */
+	COMMAND_SENSOR_GYROSCOPE = 1,			/*< MPU6050 gyroscope */
+	COMMAND_SENSOR_MAGNETOMETER = 2,		/*< HMC5883L magnetometer */
+} command_sensor_t;
+
+/**
+ * @brief A decoded command
+ */
+typedef struct {
+	uint8_t id;								/*< The {@see command_id_t} */
+	uint8_t length;							/*< The number of argument bytes */
+	const uint8_t *args;					/*< The arguments; Valid until the next call to {@see Command_Poll()} */
+	uint32_t time;							/*< The time the frame was completed, in microseconds on the timebase */
+} command_t;
+
+/**
+ * @brief The receive statistics
+ */
+typedef struct {
+	uint16_t received;						/*< The number of command frames received */
+	uint16_t rejected;						/*< The number of commands not acknowledged with {@see COMMAND_OK} */
+	uint16_t framingErrors;					/*< The number of malformed frames dropped */
+} command_statistics_t;
+
+/**
+ * @brief Initializes the command decoder
+ */
+void Command_Init();
+
+/**
+ * @brief Feeds the received bytes to the decoder until a command frame is complete
+ * @param[out] command The decoded command
+ * @return Nonzero if a command was decoded, zero if the receive buffer ran empty
+ *
+ * Must only be used after initialization of Uart0 interrupt.
+ */
+uint8_t Command_Poll(command_t *const command);
+
+/**
+ * @brief Sends the acknowledge frame for a command and updates the statistics
+ * @param[in] command The command
+ * @param[in] status The status
+ *
+ * The frame is {@see COMMAND_ACK_FRAME_TYPE}, the command id and the status.
+ */
+void Command_Acknowledge(const command_t *const command, command_status_t status);
+
+/**
+ * @brief Fetches the receive statistics
+ * @return The statistics
+ */
+const command_statistics_t* Command_GetStatistics();
+
+#endif /* COMMAND_H_ */
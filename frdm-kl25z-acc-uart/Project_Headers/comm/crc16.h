@@ -0,0 +1,64 @@
+/*
+ * crc16.h
+ *
+ * CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF, no reflection, no final XOR).
+ * The implementation trades flash for speed, see {@see CRC16_IMPLEMENTATION}.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief CRC implementation: One bit at a time, no table
+ */
+#define CRC16_BITWISE				(0)
+
+/**
+ * @brief CRC implementation: Four bits at a time from a 16 entry table (32 bytes)
+ */
+#define CRC16_NIBBLE_TABLE			(1)
+
+/**
+ * @brief CRC implementation: Eight bits at a time from a 256 entry table (512 bytes)
+ */
+#define CRC16_BYTE_TABLE			(2)
+
+/**
+ * @brief The CRC implementation
+ */
+#ifndef CRC16_IMPLEMENTATION
+#define CRC16_IMPLEMENTATION		CRC16_NIBBLE_TABLE
+#endif
+
+/**
+ * @brief The initial CRC value
+ */
+#define CRC16_INITIAL				(0xFFFFu)
+
+/**
+ * @brief Feeds data into a running CRC
+ * @param[in] crc The CRC of the preceding data, or {@see CRC16_INITIAL}
+ * @param[in] data The data
+ * @param[in] length The number of bytes
+ * @return The updated CRC
+ */
+uint16_t CRC16_Update(uint16_t crc, const uint8_t *data, size_t length);
+
+/**
+ * @brief Calculates the CRC of a buffer
+ * @param[in] data The data
+ * @param[in] length The number of bytes
+ * @return The CRC
+ */
+static inline uint16_t CRC16_Calculate(const uint8_t *data, size_t length)
+{
+	return CRC16_Update(CRC16_INITIAL, data, length);
+}
+
+#endif /* CRC16_H_ */
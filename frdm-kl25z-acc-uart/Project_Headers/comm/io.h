@@ -10,6 +10,64 @@
 
 #include "ARMCM0plus.h"
 
+/**
+ * @brief Drop policy of {@see IO_SubmitFrame()}: Reject the new frame while one is queued
+ */
+#define IO_DROP_NEWEST	(0)
+
+/**
+ * @brief Drop policy of {@see IO_SubmitFrame()}: Replace the queued frame by the new one
+ *
+ * Only applies to DMA transmission; Without it, new frames are dropped.
+ */
+#define IO_DROP_OLDEST	(1)
+
+/**
+ * @brief The drop policy of {@see IO_SubmitFrame()}
+ */
+#ifndef IO_DROP_POLICY
+#define IO_DROP_POLICY	IO_DROP_OLDEST
+#endif
+
+/**
+ * @brief The framing of the frames sent by {@see IO_SendFrame()} and {@see IO_SubmitFrame()}
+ */
+typedef enum {
+	IO_FRAMING_P2PPE = 0,	/*< P2PPE, see p2pprotocol.h; Escaping makes the length depend on the content. */
+	IO_FRAMING_COBS = 1,	/*< COBS with CRC-16, see cobs.h; Fixed overhead and integrity check. */
+	IO_FRAMING_P2PPE_TRAILER = 2, /*< P2PPE with sequence number and CRC-16 trailer, see {@see P2PPE_EncodeFrameTrailed()} */
+} io_framing_t;
+
+/**
+ * @brief Selects the framing of the frames sent from now on
+ * @param[in] framing The framing
+ *
+ * Frames already queued are sent in their original framing.
+ */
+void IO_SetFraming(io_framing_t framing);
+
+/**
+ * @brief Fetches the framing of sent frames
+ * @return The framing
+ */
+io_framing_t IO_GetFraming();
+
+/**
+ * @brief Determines the number of bytes on the wire of a frame in the current framing
+ * @param[in] payloadCount The number of prefix and data bytes
+ * @return The frame length; Assumes no escaping for P2PPE.
+ */
+uint16_t IO_FrameLength(uint8_t payloadCount);
+
+/**
+ * @brief Fetches the sequence number of the next frame sent with {@see IO_FRAMING_P2PPE_TRAILER}
+ * @return The sequence number
+ *
+ * The counter advances for every encoded frame, so frames dropped by
+ * {@see IO_SubmitFrame()} after encoding show up as gaps at the receiver.
+ */
+uint16_t IO_NextSequence();
+
 /**
  * @brief Sends a char without flushing the buffer.
  */
@@ -87,6 +145,48 @@ void IO_SendZString(const char *const string);
  */
 void IO_SendBuffer(const uint8_t *const buffer, uint8_t length);
 
+/**
+ * @brief Sends a frame with a prefix in the current framing
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * 
+ * Must only be used after initialization of Uart0 interrupt.
+ * If {@see UART0_USE_DMA_TX} is enabled, the frame is encoded into
+ * a contiguous buffer and sent by DMA in one go.
+ */
+void IO_SendFrame(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount);
+
+/**
+ * @brief Sends a frame with a prefix in the current framing if it can be queued without waiting
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @return Zero if the frame was queued, nonzero if it was dropped
+ *
+ * Never blocks, so that periodic streams do not depend on the link speed. A frame
+ * is queued as a whole or not at all; If one is already waiting behind the running
+ * transmission, {@see IO_DROP_POLICY} decides which of both is dropped.
+ * Drops are counted, see {@see IO_DroppedFrames()}.
+ */
+uint8_t IO_SubmitFrame(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount);
+
+/**
+ * @brief Fetches the number of frames dropped by {@see IO_SubmitFrame()}
+ * @return The frame count
+ */
+uint32_t IO_DroppedFrames();
+
+/**
+ * @brief Determines if a frame sent now would have to wait for the previous transmission
+ * @return Nonzero if the transmitter is busy, zero otherwise
+ *
+ * Senders of periodic data can drop a frame instead of blocking in {@see IO_SendFrame()}.
+ */
+uint8_t IO_TransmitBusy();
+
 /**
  * @brief Flushes the IO.
  */
@@ -1,7 +1,7 @@
 /*
  * p2pprotocol.h
  *
- * Naive point-to-point data protocol encoder
+ * Naive point-to-point data protocol encoder and decoder
  *
  *  Created on: Nov 8, 2013
  *      Author: Markus
@@ -13,6 +13,34 @@
 #include "derivative.h"
 #include <stdint.h>
 
+/**
+ * @brief The worst-case encoded length of a frame, i.e. with every payload byte escaped
+ * @param[in] payloadCount The number of prefix and data bytes
+ */
+#define P2PPE_MAX_FRAME_LENGTH(payloadCount) (2 + 2 + 2*(payloadCount) + 1)
+
+/**
+ * @brief The encoded length of a frame without escaped payload bytes
+ * @param[in] payloadCount The number of prefix and data bytes
+ */
+#define P2PPE_FRAME_LENGTH(payloadCount) (2 + 2 + (payloadCount) + 1)
+
+/**
+ * @brief The width of the trailer sequence number in bits; 8 or 16.
+ */
+#ifndef P2PPE_SEQUENCE_BITS
+#define P2PPE_SEQUENCE_BITS (16)
+#endif
+
+#if P2PPE_SEQUENCE_BITS != 8 && P2PPE_SEQUENCE_BITS != 16
+#error P2PPE_SEQUENCE_BITS must be 8 or 16
+#endif
+
+/**
+ * @brief The length of the optional trailer: the sequence number and the CRC-16
+ */
+#define P2PPE_TRAILER_LENGTH (P2PPE_SEQUENCE_BITS/8 + 2)
+
 /**
  * @brief Begins a P2PPE Transmission
  * @param[in] data The data to send
@@ -31,4 +59,81 @@ void P2PPE_Transmission(register const uint8_t*const data, register uint8_t data
  */
 void P2PPE_TransmissionPrefixed(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register void (*sendHandler)(uint8_t dataByte));
 
+/**
+ * @brief Encodes a P2PPE frame into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(dataCount)} bytes.
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes
+ */
+uint16_t P2PPE_EncodeFrame(register uint8_t *const frame, register const uint8_t*const data, register uint8_t dataCount);
+
+/**
+ * @brief Encodes a P2PPE frame with a prefix into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(prefixCount + dataCount)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes
+ */
+uint16_t P2PPE_EncodeFramePrefixed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount);
+
+/**
+ * @brief Encodes a P2PPE frame with a prefix and a trailer into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(prefixCount + dataCount + P2PPE_TRAILER_LENGTH)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @param[in] sequence The sequence number; Truncated to {@see P2PPE_SEQUENCE_BITS}.
+ * @return The encoded frame length in bytes
+ *
+ * The trailer is part of the payload and counted in the length byte: The sequence
+ * number and the CRC-16 (see crc16.h) over prefix, data and sequence number, both
+ * little endian. Receivers detect corrupted frames by the CRC and lost ones by gaps
+ * in the sequence.
+ */
+uint16_t P2PPE_EncodeFrameTrailed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register uint16_t sequence);
+
+/**
+ * @brief Result of feeding a byte to the P2PPE decoder
+ */
+typedef enum {
+	P2PPD_PENDING = 0,		/*< No complete frame yet */
+	P2PPD_FRAME = 1,		/*< A complete frame was decoded */
+	P2PPD_ERROR = 2,		/*< A malformed or oversized frame was dropped */
+} p2ppd_result_t;
+
+/**
+ * @brief State of the P2PPE decoder
+ */
+typedef struct {
+	uint8_t *buffer;		/*< The payload buffer */
+	uint8_t size;			/*< The payload buffer size in bytes */
+	uint8_t state;			/*< The decoder state */
+	uint8_t length;			/*< The announced payload length */
+	uint8_t count;			/*< The number of payload bytes decoded */
+	uint8_t escaped;		/*< Nonzero if the previous byte was an escape */
+} p2ppd_decoder_t;
+
+/**
+ * @brief Initializes the P2PPE decoder
+ * @param[out] decoder The decoder
+ * @param[in] buffer The payload buffer; Frames with a larger payload are dropped.
+ * @param[in] size The payload buffer size in bytes
+ */
+void P2PPD_Init(register p2ppd_decoder_t *const decoder, register uint8_t *const buffer, register uint8_t size);
+
+/**
+ * @brief Feeds a received byte to the P2PPE decoder
+ * @param[inout] decoder The decoder
+ * @param[in] byte The received byte
+ * @return {@see P2PPD_FRAME} if the payload of a complete frame is available in the buffer
+ *
+ * On {@see P2PPD_FRAME}, the payload is valid until the next call; Its length is found in {@see p2ppd_decoder_t::count}.
+ * On {@see P2PPD_ERROR}, the decoder resynchronizes on the next preamble.
+ */
+p2ppd_result_t P2PPD_Decode(register p2ppd_decoder_t *const decoder, register uint8_t byte);
+
 #endif /* P2PPROTOCOL_H_ */
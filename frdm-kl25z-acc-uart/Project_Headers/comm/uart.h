@@ -20,6 +20,77 @@
 
 #include "nice_names.h"
 #include "buffer.h"
+#include "cpu/clock.h"
+
+#define UART_115200 115200 /*! UART in 115.2 kbaud mode */
+#define UART_230400 230400 /*! UART in 230.4 kbaud mode */
+#define UART_DEV 0x0815 
+
+/**
+ * @brief Configures the UART speed
+ */
+#define UART_SPEED_MODE UART_115200
+
+/**
+ * @brief Default UART speed mode selection
+ */
+#ifndef UART_SPEED_MODE
+#define UART_SPEED_MODE UART_115200
+#endif
+
+/**
+ * @brief The baud rate of the configured {@see UART_SPEED_MODE}, used after reset
+ */
+#if UART_SPEED_MODE == UART_DEV
+#define UART0_BAUD_RATE (38400u)
+#else
+#define UART0_BAUD_RATE ((uint32_t)UART_SPEED_MODE)
+#endif
+
+/**
+ * @brief The number of bits on the line per byte (8N1: start, eight data bits, stop)
+ */
+#define UART0_BITS_PER_BYTE (10u)
+
+/**
+ * @brief The UART0 module clock in Hz; PLL/2, see {@see InitUart0()}
+ */
+#define UART0_CLOCK (CORE_CLOCK/2u)
+
+/**
+ * @brief The maximum deviation of the generated from the requested baud rate in permille
+ */
+#define UART0_MAX_BAUD_ERROR (30u)
+
+/**
+ * @brief Baud rate generator settings
+ */
+typedef struct {
+	uint16_t sbr;		/*< The baud rate modulo divisor, 1..8191 */
+	uint8_t osr;		/*< The oversampling ratio minus one, 3..31 */
+	uint8_t bothEdge;	/*< Nonzero if data is sampled on both clock edges */
+	uint32_t baudRate;	/*< The generated baud rate */
+} uart0_baud_t;
+
+/**
+ * @brief Enables or disables DMA driven transmission of whole frames.
+ *
+ * If enabled, {@see Uart0_TransmitDma()} hands a contiguous buffer to
+ * DMA channel {@see DMA_CHANNEL_UART0_TX}, so that no TDRE interrupt is
+ * taken per byte. Bytes written to the transmit ring buffer are still sent
+ * by the UART0 IRQ in between frames.
+ */
+#define UART0_USE_DMA_TX 1
+
+/**
+ * @brief Enables or disables DMA driven reception.
+ *
+ * If enabled, DMA channel {@see DMA_CHANNEL_UART0_RX} writes received bytes
+ * directly into the receive ring buffer, which has to be aligned to its size.
+ * Instead of one IRQ per byte, the idle line IRQ wakes the main loop after
+ * each burst; {@see Uart0_SyncDmaReceive()} publishes the received bytes.
+ */
+#define UART0_USE_DMA_RX 1
 
 /*
  * @brief The IRQ number (not exception number!) for UART0 interrupt
@@ -27,10 +98,36 @@
 #define UART0_IRQ		(12)
 
 /*
- * @brief Sets up the UART0 for 115.2 kbaud on PTA1/RX, PTA2/TX using PLL/2 clocking.
+ * @brief Sets up the UART0 for {@see UART0_BAUD_RATE} on PTA1/RX, PTA2/TX using PLL/2 clocking.
  */
 void InitUart0();
 
+/**
+ * @brief Calculates the baud rate generator settings for a baud rate
+ * @param[in] baudRate The requested baud rate
+ * @param[out] config The settings
+ * @return Zero if the baud rate can be generated within {@see UART0_MAX_BAUD_ERROR}, nonzero otherwise
+ *
+ * Of all oversampling ratios, the one with the smallest error is chosen; Ties
+ * are resolved towards higher ratios. Ratios up to eight sample on both edges.
+ */
+uint8_t Uart0_CalculateBaud(register uint32_t baudRate, uart0_baud_t *const config);
+
+/**
+ * @brief Switches to another baud rate
+ * @param[in] config The settings calculated by {@see Uart0_CalculateBaud()}
+ *
+ * Waits for the byte being shifted out; The caller has to make sure that
+ * no further transmission is queued.
+ */
+void Uart0_SetBaud(const uart0_baud_t *const config);
+
+/**
+ * @brief Fetches the current baud rate
+ * @return The generated baud rate
+ */
+uint32_t Uart0_BaudRate();
+
 /**
  * @brief Initializes the interrupt for UART0
  */
@@ -84,4 +181,80 @@ static inline void Uart0_DisableTransmitIrq()
 #endif
 }
 
+#if UART0_USE_DMA_TX
+
+/**
+ * @brief Routes the UART0 transmit requests to the DMA and enables the DMA channel IRQ.
+ *
+ * Must be called after {@see Uart0_InitializeIrq()}.
+ */
+void Uart0_InitializeDmaTransmit();
+
+/**
+ * @brief Starts or queues a DMA transmission of a buffer.
+ * @param[in] data The data to send; Must stay valid until it was sent.
+ * @param[in] length The number of bytes to send; Must be larger than zero.
+ *
+ * Blocks while another buffer is queued, see {@see Uart0_QueueDma()}.
+ */
+void Uart0_TransmitDma(const uint8_t *const data, register uint16_t length);
+
+/**
+ * @brief Queues a buffer for DMA transmission and returns immediately.
+ * @param[in] data The data to send; Must stay valid until it was sent.
+ * @param[in] length The number of bytes to send; Must be larger than zero.
+ * @return Zero if the buffer was started or queued, nonzero if another buffer is already queued
+ *
+ * One buffer can wait behind the running transmission; It is started once that
+ * one and all bytes in the transmit ring buffer have been sent, keeping the byte order.
+ */
+uint8_t Uart0_QueueDma(const uint8_t *const data, register uint16_t length);
+
+/**
+ * @brief Removes the queued buffer before it was started
+ * @return Nonzero if a buffer was removed and may be reused, zero if none was queued
+ */
+uint8_t Uart0_CancelQueuedDma();
+
+/**
+ * @brief Determines if a buffer is queued behind the running transmission
+ * @return Nonzero if a buffer is queued, zero otherwise
+ */
+uint8_t Uart0_DmaTransmitQueued();
+
+/**
+ * @brief Determines if a DMA transmission is running
+ * @return Nonzero if busy, zero otherwise
+ */
+uint8_t Uart0_DmaTransmitBusy();
+
+/**
+ * @brief Waits until the running DMA transmission has completed
+ */
+static inline void Uart0_WaitForDmaTransmit()
+{
+	while (Uart0_DmaTransmitBusy()) {}
+}
+
+#endif /* UART0_USE_DMA_TX */
+
+#if UART0_USE_DMA_RX
+
+/**
+ * @brief Routes the UART0 receive requests to the DMA and enables the idle line IRQ.
+ *
+ * Must be called after {@see Uart0_InitializeIrq()} instead of {@see Uart0_EnableReceiveIrq()}.
+ * The read buffer must be aligned to its size, which is a power of two of at least 16 bytes.
+ */
+void Uart0_InitializeDmaReceive();
+
+/**
+ * @brief Publishes the bytes received by DMA in the read buffer
+ *
+ * Bytes not read before the DMA wrapped around the buffer are lost.
+ */
+void Uart0_SyncDmaReceive();
+
+#endif /* UART0_USE_DMA_RX */
+
 #endif /* UART_H_ */
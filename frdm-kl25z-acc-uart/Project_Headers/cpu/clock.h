@@ -8,6 +8,8 @@
 #ifndef CLOCK_H_
 #define CLOCK_H_
 
+#include <stdint.h>
+
 /**
 * @brief Macros defining the XTAL frequency and core clock
 */
@@ -16,13 +18,61 @@
 #define XTAL_PEE_DIVIDE		(4u)		/* divide by 4 (8 MHz --> 2 MHz) */
 #define XTAL_PEE_UPSCALE	(24u)		/* scale up by 24 (2 MHz --> 48 MHz) */
 
-#define CORE_CLOCK			(XTAL_FREQ/XTAL_PEE_DIVIDE*XTAL_PEE_UPSCALE) /* Hz */
+#define CORE_CLOCK			(XTAL_FREQ/XTAL_PEE_DIVIDE*XTAL_PEE_UPSCALE) /* Hz, PLL output and core clock at full speed */
+#define BUS_CLOCK			(CORE_CLOCK/2u) /* Hz, bus and flash clock divider OUTDIV4 is 2 */
+
+/**
+ * @brief The core clock configurations, fastest first
+ *
+ * All of them run in PEE mode with the PLL locked at {@see CORE_CLOCK};
+ * Only the core clock divider OUTDIV1 changes. UART0 is clocked by the PLL
+ * directly and keeps its baud rate. The bus clock is always half the core clock.
+ */
+typedef enum {
+	CLOCK_LEVEL_48MHZ = 0,					/*< 48 MHz core, 24 MHz bus */
+	CLOCK_LEVEL_24MHZ = 1,					/*< 24 MHz core, 12 MHz bus */
+	CLOCK_LEVEL_12MHZ = 2,					/*< 12 MHz core, 6 MHz bus */
+	CLOCK_LEVEL_COUNT						/*< The number of clock levels */
+} clock_level_t;
+
+/**
+ * @brief The core clock at the slowest level in Hz
+ */
+#define CORE_CLOCK_MIN		(CORE_CLOCK >> (CLOCK_LEVEL_COUNT - 1))
+
+/**
+ * @brief The bus clock at the slowest level in Hz
+ */
+#define BUS_CLOCK_MIN		(CORE_CLOCK_MIN/2u)
 
+/**
+ * @brief The current core clock in Hz
+ */
+extern uint32_t ClockCoreFrequency;
 
+/**
+ * @brief The current bus clock in Hz
+ */
+extern uint32_t ClockBusFrequency;
 
 /**
 * @brief Function to initialize the core clock 
 */
 void InitClock();
 
+/**
+ * @brief Switches the core and bus clock dividers to a clock level
+ * @param[in] level The clock level
+ *
+ * Does not reconfigure the peripherals depending on the core or bus clock,
+ * see {@see Governor_SetLevel()}.
+ */
+void Clock_SetLevel(clock_level_t level);
+
+/**
+ * @brief Returns the current clock level
+ * @return The level
+ */
+clock_level_t Clock_Level();
+
 #endif /* CLOCK_H_ */
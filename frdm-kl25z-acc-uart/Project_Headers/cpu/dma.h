@@ -0,0 +1,101 @@
+/*
+ * dma.h
+ *
+ * Channel assignment and helpers for the four DMA channels.
+ *
+ *  Created on: Mar 4, 2014
+ *      Author: Markus
+ */
+
+#ifndef DMA_H_
+#define DMA_H_
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+#include "nice_names.h"
+
+/**
+ * @brief DMA channel used for I2C0 burst receive
+ */
+#define DMA_CHANNEL_I2C0		(0)
+
+/**
+ * @brief The IRQ number (not exception number!) of DMA channel 0
+ */
+#define DMA0_IRQ				(0)
+
+/**
+ * @brief DMAMUX request source for I2C0
+ */
+#define DMAMUX_SOURCE_I2C0		(22)
+
+/**
+ * @brief DMA channel used for UART0 frame transmission
+ */
+#define DMA_CHANNEL_UART0_TX	(1)
+
+/**
+ * @brief The IRQ number (not exception number!) of DMA channel 1
+ */
+#define DMA1_IRQ				(1)
+
+/**
+ * @brief DMAMUX request source for UART0 transmit
+ */
+#define DMAMUX_SOURCE_UART0_TX	(3)
+
+/**
+ * @brief DMA channel used for UART0 reception
+ */
+#define DMA_CHANNEL_UART0_RX	(2)
+
+/**
+ * @brief The IRQ number (not exception number!) of DMA channel 2
+ */
+#define DMA2_IRQ				(2)
+
+/**
+ * @brief DMAMUX request source for UART0 receive
+ */
+#define DMAMUX_SOURCE_UART0_RX	(2)
+
+/**
+ * @brief Enables the clock gates to DMA and DMAMUX
+ */
+__STATIC_INLINE void DMA_EnableClocks()
+{
+	SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+}
+
+/**
+ * @brief Routes a request source to a DMA channel
+ * @param[in] channel The DMA channel
+ * @param[in] source The DMAMUX request source
+ */
+__STATIC_INLINE void DMA_RouteSource(register uint8_t channel, register uint8_t source)
+{
+	DMAMUX_CHCFG_REG(DMAMUX0, channel) = 0; /* must be disabled while reconfiguring */
+	DMAMUX_CHCFG_REG(DMAMUX0, channel) = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(source);
+}
+
+/**
+ * @brief Clears the DONE flag and any error flags of a DMA channel
+ * @param[in] channel The DMA channel
+ */
+__STATIC_INLINE void DMA_ClearDone(register uint8_t channel)
+{
+	DMA_DSR_BCR_REG(DMA0, channel) = DMA_DSR_BCR_DONE_MASK;
+}
+
+/**
+ * @brief Determines if a DMA channel stopped due to a configuration or bus error
+ * @param[in] channel The DMA channel
+ * @return Nonzero in case of an error, zero otherwise
+ */
+__STATIC_INLINE uint32_t DMA_HasError(register uint8_t channel)
+{
+	return DMA_DSR_BCR_REG(DMA0, channel) & (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK);
+}
+
+#endif /* DMA_H_ */
@@ -0,0 +1,81 @@
+/*
+ * events.h
+ *
+ * Event mask shared between the interrupt handlers and the main loop.
+ * Handlers signal what they produced, the main loop fetches and clears the
+ * mask atomically and sleeps only while it is empty, so that an event raised
+ * right before the sleep cannot get lost.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <stdint.h>
+
+#include "ARMCM0plus.h"
+
+/**
+ * @brief The events
+ */
+typedef enum {
+	EVENT_TICK			= (1 << 0),		/*< The SysTick advanced the millisecond counter */
+	EVENT_MPU6050		= (1 << 1),		/*< The MPU6050 signalled data ready */
+	EVENT_MMA8451Q		= (1 << 2),		/*< The MMA8451Q signalled data ready */
+	EVENT_HMC5883L		= (1 << 3),		/*< The HMC5883L signalled data ready */
+	EVENT_UART_RX		= (1 << 4),		/*< UART0 received a byte */
+	EVENT_I2C			= (1 << 5)		/*< An asynchronous I2C transaction completed */
+} event_t;
+
+/**
+ * @brief The pending events; Use the accessors below.
+ */
+extern volatile uint32_t Events;
+
+/**
+ * @brief Signals events; May be called from any interrupt priority.
+ * @param[in] events The combination of {@see event_t}
+ *
+ * The Cortex-M0+ has no exclusive accesses, so the read-modify-write is guarded by PRIMASK.
+ */
+static inline void Events_Signal(register uint32_t events)
+{
+	register const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Events |= events;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Fetches and clears the pending events
+ * @return The combination of {@see event_t}
+ */
+static inline uint32_t Events_Fetch()
+{
+	__disable_irq();
+	register const uint32_t events = Events;
+	Events = 0;
+	__enable_irq();
+	return events;
+}
+
+/**
+ * @brief Sleeps until an event is pending
+ *
+ * Checks the mask with interrupts disabled: An interrupt arriving after the check
+ * is held pending and still wakes WFI, it is serviced once PRIMASK is cleared.
+ */
+static inline void Events_WaitForAny()
+{
+	__disable_irq();
+	if (0 == Events)
+	{
+		__DSB();
+		__WFI();
+	}
+	__enable_irq();
+}
+
+#endif /* EVENTS_H_ */
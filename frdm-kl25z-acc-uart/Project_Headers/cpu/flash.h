@@ -0,0 +1,63 @@
+/*
+ * flash.h
+ *
+ * Erasing and programming of the program flash through the FTFA flash controller.
+ * The flash cannot be read while a command executes, so the command launch runs
+ * from SRAM with interrupts disabled, since the vector table and most
+ * handlers reside in flash.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The size of an erasable flash sector in byte
+ */
+#define FLASH_SECTOR_SIZE			(1024u)
+
+/**
+ * @brief The programming granularity in byte
+ */
+#define FLASH_LONGWORD_SIZE			(4u)
+
+/**
+ * @brief The flash command status codes
+ */
+#define FLASH_OK					(0)		/*< The command completed */
+#define FLASH_ERROR_ACCESS			(1)		/*< Illegal address or alignment (ACCERR) */
+#define FLASH_ERROR_PROTECTION		(2)		/*< The address is protected (FPVIOL) */
+#define FLASH_ERROR_VERIFY			(3)		/*< The erase or program verify failed (MGSTAT0) */
+
+/**
+ * @brief Erases a flash sector
+ * @param[in] address The sector aligned address
+ * @return {@see FLASH_OK} or one of the FLASH_ERROR_* codes
+ *
+ * Blocks with interrupts disabled for the duration of the erase (up to 100 ms).
+ */
+uint8_t Flash_EraseSector(uint32_t address);
+
+/**
+ * @brief Programs a longword into erased flash
+ * @param[in] address The longword aligned address
+ * @param[in] value The value
+ * @return {@see FLASH_OK} or one of the FLASH_ERROR_* codes
+ */
+uint8_t Flash_ProgramLongword(uint32_t address, uint32_t value);
+
+/**
+ * @brief Programs a buffer into erased flash
+ * @param[in] address The longword aligned address
+ * @param[in] data The data
+ * @param[in] length The number of bytes; Must be a multiple of {@see FLASH_LONGWORD_SIZE}.
+ * @return {@see FLASH_OK} or the FLASH_ERROR_* code of the first failing longword
+ */
+uint8_t Flash_Program(uint32_t address, const void *const data, size_t length);
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,94 @@
+/*
+ * governor.h
+ *
+ * Core clock governor. The duty cycle of the fusion is measured from the
+ * cycles the profiled stages spent on the core (see {@see Profile_FetchBusyCycles()})
+ * and the core clock is stepped down while the core mostly sleeps, e.g. at the
+ * 50 Hz presets, and back up to full speed as soon as the load rises.
+ * The peripherals clocked by the core or bus clock are reconfigured with each
+ * step: The SysTick reload, the timebase divider and the I2C dividers.
+ *
+ *  Created on: Mar 13, 2014
+ *      Author: Markus
+ */
+
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include <stdint.h>
+
+#include "cpu/clock.h"
+#include "cpu/profile.h"
+
+/**
+ * @brief Enables or disables the automatic clock scaling; Requires the busy cycle count.
+ *
+ * If disabled, the core stays at the level set by {@see Governor_SetMode()}, full speed by default.
+ * Only needs {@see PROFILE_BUSY_ENABLED}, not the stage statistics, so release builds scale the clock, see release.mak.
+ */
+#ifndef GOVERNOR_ENABLED
+#define GOVERNOR_ENABLED				(PROFILE_SECTIONS_ENABLED)
+#endif
+
+#if GOVERNOR_ENABLED && !PROFILE_SECTIONS_ENABLED
+#error The clock governor measures the load with the busy cycle count of the profiled sections
+#endif
+
+/**
+ * @brief The period in milliseconds over which the duty cycle is measured
+ */
+#define GOVERNOR_PERIOD					(250u) /* ms */
+
+/**
+ * @brief The duty cycle in permille above which the core returns to full speed
+ */
+#define GOVERNOR_UPSCALE_THRESHOLD		(500u) /* permille */
+
+/**
+ * @brief The duty cycle in permille below which the core clock is halved
+ *
+ * Must be less than half of {@see GOVERNOR_UPSCALE_THRESHOLD}, since halving
+ * the clock doubles the duty cycle.
+ */
+#define GOVERNOR_DOWNSCALE_THRESHOLD	(150u) /* permille */
+
+#if GOVERNOR_DOWNSCALE_THRESHOLD * 2 >= GOVERNOR_UPSCALE_THRESHOLD
+#error The clock governor would oscillate between two levels
+#endif
+
+/**
+ * @brief The mode argument of {@see Governor_SetMode()} selecting the automatic clock scaling
+ */
+#define GOVERNOR_MODE_AUTOMATIC			(0xFFu)
+
+/**
+ * @brief Starts the governor at full speed
+ *
+ * Must be called after the SysTick, the timebase and the I2C module were initialized.
+ */
+void Governor_Init();
+
+/**
+ * @brief Selects a fixed clock level or the automatic clock scaling
+ * @param[in] mode A {@see clock_level_t} or {@see GOVERNOR_MODE_AUTOMATIC}
+ * @return Zero on success, nonzero if the mode is unknown or automatic scaling is disabled
+ *
+ * The level is applied by the next {@see Governor_Update()}.
+ */
+uint8_t Governor_SetMode(uint8_t mode);
+
+/**
+ * @brief Measures the duty cycle and switches the clock level if required
+ *
+ * Called once per main loop pass, between the profiled stages. A switch is
+ * deferred while an I2C transaction is queued or running.
+ */
+void Governor_Update();
+
+/**
+ * @brief Returns the duty cycle measured over the last period
+ * @return The duty cycle in permille of the core clock at that time
+ */
+uint16_t Governor_DutyCycle();
+
+#endif /* GOVERNOR_H_ */
@@ -0,0 +1,171 @@
+/*
+ * instrument.h
+ *
+ * Run-time instrumentation for sizing the SRAM use: Stack painting with a
+ * high-water report, run-time counters of the interrupt handlers and, if the
+ * MTB buffer is reserved (see sa_mtb.c), gating of the trace capture.
+ * The ring buffer peaks are tracked by the buffers themselves, see
+ * {@see RingBuffer_Peak()}.
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#ifndef INSTRUMENT_H_
+#define INSTRUMENT_H_
+
+#include <stdint.h>
+
+#include "derivative.h"
+#include "cpu/ramfunc.h"
+
+/**
+ * @brief Enables or disables the stack painting and the interrupt handler counters.
+ */
+#ifndef INSTRUMENT_ENABLED
+#define INSTRUMENT_ENABLED			(1)
+#endif
+
+/**
+ * @brief The P2PPE frame type of the instrumentation frames
+ */
+#define INSTRUMENT_FRAME_TYPE		(0x13)
+
+/**
+ * @brief The word the free stack is painted with
+ */
+#define INSTRUMENT_STACK_PAINT		(0xC5C5C5C5u)
+
+/**
+ * @brief Enables or disables the MTB trace capture around the fusion hot path.
+ *
+ * Only effective if the MTB buffer is reserved with __SA_MTB_SIZE.
+ */
+#if defined(__SA_MTB_SIZE) && (__SA_MTB_SIZE > 0)
+#define INSTRUMENT_TRACE_ENABLED	(1)
+#else
+#define INSTRUMENT_TRACE_ENABLED	(0)
+#endif
+
+/**
+ * @brief The instrumented interrupt handlers
+ */
+typedef enum {
+	INSTRUMENT_ISR_SYSTICK = 0,				/*< SysTick_Handler */
+	INSTRUMENT_ISR_PORTA,					/*< PORTA_Handler, the sensor data ready lines */
+	INSTRUMENT_ISR_I2C0,					/*< I2C0_Handler */
+	INSTRUMENT_ISR_DMA0,					/*< DMA0_Handler, the I2C0 reception */
+	INSTRUMENT_ISR_UART0,					/*< UART0_Handler */
+	INSTRUMENT_ISR_DMA1,					/*< DMA1_Handler, the UART0 transmission */
+	INSTRUMENT_ISR_DMA2,					/*< DMA2_Handler, the UART0 reception */
+	INSTRUMENT_ISR_COUNT					/*< The number of instrumented handlers */
+} instrument_isr_t;
+
+/**
+ * @brief Run-time counters of an interrupt handler
+ */
+typedef struct {
+	uint32_t count;							/*< The number of invocations */
+	uint32_t cycles;						/*< The sum of the cycle counts */
+	uint16_t max;							/*< The maximum cycle count of a single invocation */
+	uint16_t latency;						/*< The worst-case entry latency in cycles, see {@see Instrument_FetchIsrs()} */
+} instrument_isr_counter_t;
+
+/**
+ * @brief The stack usage
+ */
+typedef struct {
+	uint32_t static_size;					/*< The bytes used by the MTB buffer, the data and the bss sections */
+	uint32_t stack_reserved;				/*< The bytes the linker reserves for the stack */
+	uint32_t stack_used;					/*< The deepest the stack grew in bytes, including the interrupt frames */
+	uint32_t untouched;						/*< The bytes between the static data and the deepest stack that were never written */
+} instrument_stack_t;
+
+/**
+ * @brief Paints the free SRAM between the static data and the stack pointer.
+ *
+ * Must be called first thing in main, before the interrupts are enabled.
+ * The firmware does not use the heap; A heap would show up as stack use.
+ */
+void Instrument_PaintStack();
+
+/**
+ * @brief Fetches the stack usage by scanning for the lowest overwritten paint word
+ * @param[out] stack The stack usage
+ *
+ * Takes a few microseconds per kilobyte of untouched SRAM.
+ */
+void Instrument_FetchStack(instrument_stack_t *const stack);
+
+/**
+ * @brief Fetches and resets the counters of all interrupt handlers
+ * @param[out] counters The counters accumulated since the last fetch, indexed by {@see instrument_isr_t}
+ *
+ * The SysTick latency is measured: The tick pends as the counter reloads, so the
+ * counter value on entry tells how long it waited. It covers the sections running
+ * with the interrupts disabled and the handlers of the highest priority.
+ * The other interrupts cannot tell when they were raised; Their latency is bounded
+ * from the measured maxima instead, see cpu/irq.h: The longest other handler of the
+ * same priority, plus one invocation of every handler of a higher priority, plus
+ * the SysTick latency for the disabled sections.
+ */
+void Instrument_FetchIsrs(instrument_isr_counter_t counters[INSTRUMENT_ISR_COUNT]);
+
+#if INSTRUMENT_ENABLED
+
+/**
+ * @brief Tracks an interrupt handler invocation on exit, see {@see INSTRUMENT_ISR}
+ */
+typedef struct {
+	instrument_isr_t isr;					/*< The interrupt handler */
+	uint32_t start;							/*< The SysTick value on entry */
+} instrument_isr_scope_t;
+
+/**
+ * @brief Records the cycles an interrupt handler took
+ * @param[in] scope The scope opened by {@see INSTRUMENT_ISR}
+ */
+RAMFUNC void Instrument_IsrExit(register const instrument_isr_scope_t *const scope);
+
+/**
+ * @brief Counts the cycles from here to the end of the handler, whichever way it returns
+ * @param[in] isr The interrupt handler, see {@see instrument_isr_t}
+ *
+ * Uses the SysTick value register only, which works with the interrupts disabled
+ * but limits a single invocation to one tick. Higher-priority handlers preempting
+ * the handler are counted with it.
+ */
+#define INSTRUMENT_ISR(isr)			instrument_isr_scope_t __instrument_scope __attribute__((cleanup(Instrument_IsrExit))) = { (isr), SysTick_BASE_PTR->CVR }
+
+#else
+
+#define INSTRUMENT_ISR(isr)			((void)0)
+
+#endif /* INSTRUMENT_ENABLED */
+
+#if INSTRUMENT_TRACE_ENABLED
+
+/**
+ * @brief Configures the MTB to capture into the buffer reserved in sa_mtb.c, stopped.
+ */
+void Instrument_InitTrace();
+
+/**
+ * @brief Starts the trace capture
+ */
+#define INSTRUMENT_TRACE_START()	do { MTB_MASTER |= MTB_MASTER_EN_MASK; } while (0)
+
+/**
+ * @brief Stops the trace capture; The buffer then holds the last executed branches of the hot path.
+ */
+#define INSTRUMENT_TRACE_STOP()		do { MTB_MASTER &= ~MTB_MASTER_EN_MASK; } while (0)
+
+#else
+
+#define Instrument_InitTrace()		((void)0)
+#define INSTRUMENT_TRACE_START()	((void)0)
+#define INSTRUMENT_TRACE_STOP()		((void)0)
+
+#endif /* INSTRUMENT_TRACE_ENABLED */
+
+#endif /* INSTRUMENT_H_ */
@@ -0,0 +1,72 @@
+/*
+ * irq.h
+ *
+ * Central interrupt priority scheme. Every interrupt is enabled through
+ * {@see IRQ_Enable()}, which assigns the priority of its class:
+ * The sensor data ready latch and the SysTick preempt everything, so that
+ * the sample timestamps do not depend on the bus and link load; The I2C
+ * and its DMA completion preempt the serial link, which has the most
+ * frequent and least time critical interrupts.
+ *
+ * Handlers of one class do not preempt each other. Handlers of a higher
+ * class may run in the middle of a lower one, so state shared across
+ * classes must be updated with the interrupts disabled, see
+ * {@see Events_Signal()} or {@see I2CAsync_Submit()}.
+ *
+ *  Created on: Mar 11, 2014
+ *      Author: Markus
+ */
+
+#ifndef IRQ_H_
+#define IRQ_H_
+
+#include <stdint.h>
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+
+/**
+ * @brief The IRQ number (not exception number!) for the PORTA pin interrupts
+ */
+#define PORTA_IRQ					(30)
+
+/**
+ * @brief Priority of the sensor data ready latch and the SysTick; The highest.
+ */
+#define IRQ_PRIORITY_SAMPLE			(0)
+
+/**
+ * @brief Priority of the I2C0 transfers and their DMA completion
+ */
+#define IRQ_PRIORITY_TRANSFER		(1)
+
+/**
+ * @brief Priority of the UART0 and its DMA channels
+ */
+#define IRQ_PRIORITY_COMMUNICATION	(2)
+
+/**
+ * @brief Number of priority levels in use; Bounds the handler nesting depth.
+ */
+#define IRQ_PRIORITY_LEVELS			(3)
+
+/**
+ * @brief Fetches the priority of an interrupt
+ * @param[in] irq The IRQ number; {@see SysTick_IRQn} for the SysTick.
+ * @return The priority, zero being the highest
+ */
+uint8_t IRQ_Priority(int8_t irq);
+
+/**
+ * @brief Assigns the priority of an interrupt according to the scheme
+ * @param[in] irq The IRQ number; {@see SysTick_IRQn} for the SysTick.
+ */
+void IRQ_Configure(int8_t irq);
+
+/**
+ * @brief Assigns the priority, clears the pending flag and enables an interrupt
+ * @param[in] irq The IRQ number (not exception number!)
+ */
+void IRQ_Enable(int8_t irq);
+
+#endif /* IRQ_H_ */
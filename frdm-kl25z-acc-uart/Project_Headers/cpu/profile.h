@@ -0,0 +1,150 @@
+/*
+ * profile.h
+ *
+ * On-target cycle profiling of the processing stages.
+ * Cycles are counted using the SysTick timer, which runs at the core clock;
+ * Its current value register is extended by the millisecond counter, so that
+ * stages longer than one tick are measured correctly. The cycles are those of
+ * the current core clock, see {@see Clock_SetLevel()}; A section spanning a
+ * clock switch measures garbage, so switches happen between the stages.
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Enables or disables the profiling of the processing stages.
+ *
+ * Disabled in release builds, see release.mak; The busy cycle count stays, see {@see PROFILE_BUSY_ENABLED}.
+ */
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED				(1)
+#endif
+
+/**
+ * @brief Enables or disables the busy cycle count of the profiled sections, see {@see Profile_FetchBusyCycles()}
+ *
+ * Independent of {@see PROFILE_ENABLED}: Without the stage statistics and reports,
+ * the sections only add up their cycles for the clock governor, see cpu/governor.h.
+ */
+#ifndef PROFILE_BUSY_ENABLED
+#define PROFILE_BUSY_ENABLED		(1)
+#endif
+
+/**
+ * @brief Nonzero if the profiled sections are timed at all
+ */
+#define PROFILE_SECTIONS_ENABLED	(PROFILE_ENABLED || PROFILE_BUSY_ENABLED)
+
+/**
+ * @brief The P2PPE frame type of the profiling report frames
+ */
+#define PROFILE_FRAME_TYPE			(0x10)
+
+/**
+ * @brief The period in milliseconds at which the profiling counters are reported
+ */
+#define PROFILE_REPORT_PERIOD		(1000u) /* ms */
+
+/**
+ * @brief The profiled stages
+ */
+typedef enum {
+	PROFILE_STAGE_I2C_READ = 0,				/*< Waiting for the sensor reads to complete */
+	PROFILE_STAGE_PREPARE,					/*< Sensor data conversion and calibration */
+	PROFILE_STAGE_PREDICT,					/*< Fusion prediction */
+	PROFILE_STAGE_UPDATE_ATTITUDE,			/*< Attitude correction with accelerometer data */
+	PROFILE_STAGE_UPDATE_ATTITUDE_GYRO,		/*< Attitude correction with gyroscope data only */
+	PROFILE_STAGE_UPDATE_ORIENTATION,		/*< Orientation correction with magnetometer data */
+	PROFILE_STAGE_UPDATE_ORIENTATION_GYRO,	/*< Orientation correction with gyroscope data only */
+	PROFILE_STAGE_OUTPUT,					/*< Encoding and queuing of the output frames */
+	PROFILE_STAGE_COUNT						/*< The number of profiled stages */
+} profile_stage_t;
+
+#if PROFILE_SECTIONS_ENABLED
+
+#include "derivative.h"
+#include "cpu/clock.h"
+#include "cpu/delay.h"
+#include "cpu/systick.h"
+
+/**
+ * @brief The number of core cycles per SysTick period at the current core clock
+ */
+#define PROFILE_CYCLES_PER_TICK		(SysTick_BASE_PTR->RVR + 1)
+
+/**
+ * @brief Fetches the current cycle count
+ * @return The cycle count; Wraps around after roughly 89 seconds.
+ *
+ * Must not be called with interrupts disabled, since the millisecond
+ * counter would not follow a SysTick wrap-around.
+ */
+static inline uint32_t Profile_Cycles()
+{
+	register uint32_t ms, value;
+	do
+	{
+		ms = SystemMilliseconds;
+		value = SysTick_BASE_PTR->CVR;
+	} while (ms != SystemMilliseconds);
+
+	/* the SysTick counts down from its reload value */
+	register const uint32_t cyclesPerTick = PROFILE_CYCLES_PER_TICK;
+	return ms * cyclesPerTick + (cyclesPerTick - 1 - value);
+}
+
+#endif /* PROFILE_SECTIONS_ENABLED */
+
+/**
+ * @brief Records a cycle count for a stage
+ * @param[in] stage The stage
+ * @param[in] cycles The number of cycles the stage took
+ */
+void Profile_Record(register profile_stage_t stage, register uint32_t cycles);
+
+/**
+ * @brief Sends one P2PPE frame per stage with samples and resets the counters.
+ *
+ * Each frame is {@see PROFILE_FRAME_TYPE}, the stage, followed by the sample count (uint16_t)
+ * and the minimum, average and maximum cycle counts (uint32_t), in native endianness.
+ */
+void Profile_Report();
+
+/**
+ * @brief Fetches and resets the cycles the core spent on the stages bound by it
+ * @return The cycles of all stages but {@see PROFILE_STAGE_I2C_READ}, which waits for the bus, since the last fetch
+ *
+ * Unlike the report counters, the sum does not depend on the report period;
+ * Used by the clock governor to determine the duty cycle, see cpu/governor.h.
+ */
+uint32_t Profile_FetchBusyCycles();
+
+#if PROFILE_SECTIONS_ENABLED
+
+/**
+ * @brief Starts a profiled section by capturing the cycle count in a local variable
+ * @param[in] name The name of the local variable
+ */
+#define PROFILE_START(name)			const uint32_t name = Profile_Cycles()
+
+/**
+ * @brief Ends a profiled section and records its cycle count
+ * @param[in] stage The stage
+ * @param[in] name The name of the local variable passed to {@see PROFILE_START}
+ */
+#define PROFILE_STOP(stage, name)	Profile_Record((stage), Profile_Cycles() - (name))
+
+#else
+
+#define PROFILE_START(name)			((void)0)
+#define PROFILE_STOP(stage, name)	((void)0)
+
+#endif
+
+#endif /* PROFILE_H_ */
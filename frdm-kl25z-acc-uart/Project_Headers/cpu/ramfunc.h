@@ -0,0 +1,37 @@
+/*
+ * ramfunc.h
+ *
+ * Placement of time critical functions in SRAM.
+ * Flash is clocked at the bus clock and inserts wait states at 48 MHz core
+ * clock, whereas SRAM is fetched in a single cycle. Functions tagged with
+ * {@see RAMFUNC} are linked to the .ramfunc section, which is loaded to flash
+ * and copied to SRAM by the startup code, along with .data.
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#ifndef RAMFUNC_H_
+#define RAMFUNC_H_
+
+/**
+ * @brief Enables or disables execution of {@see RAMFUNC} tagged functions from SRAM.
+ */
+#ifndef RAMFUNC_ENABLED
+#define RAMFUNC_ENABLED				(1)
+#endif
+
+/**
+ * @brief Places a function in SRAM.
+ *
+ * Must be used on the definition and should be used on the declaration, since
+ * SRAM lies out of BL range of the flash (long_call). Functions must not be inlined
+ * into their (flash) callers, or they end up in flash anyway.
+ */
+#if RAMFUNC_ENABLED
+#define RAMFUNC						__attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define RAMFUNC
+#endif
+
+#endif /* RAMFUNC_H_ */
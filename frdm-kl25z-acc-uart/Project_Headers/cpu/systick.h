@@ -12,11 +12,16 @@
 * @brief Defines for the system tick behaviour
 */
 
-#define SYSTICK_FREQUENCY		(4000u) /* Hz */
+#define SYSTICK_FREQUENCY		(1000u) /* Hz */
 
 /**
 * @brief Function to initialize the SysTick interrupt 
 */
 void InitSysTick();
 
+/**
+ * @brief Adapts the reload value to the current core clock, see {@see Clock_SetLevel()}
+ */
+void SysTick_ApplyClock();
+
 #endif /* SYSTICK_H_ */
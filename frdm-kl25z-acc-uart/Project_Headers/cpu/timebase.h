@@ -0,0 +1,55 @@
+/*
+ * timebase.h
+ *
+ * Free-running microsecond counter built from the two chained PIT channels.
+ * Channel 0 divides the bus clock down to 1 MHz, channel 1 counts its
+ * expirations, so reading the time is a single register access.
+ *
+ *  Created on: Mar 8, 2014
+ *      Author: Markus
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+#include "fixmath.h"
+
+/**
+ * @brief Frequency of the timebase counter
+ */
+#define TIMEBASE_FREQUENCY		(1000000u) /* Hz */
+
+/**
+ * @brief Starts the PIT timebase
+ */
+void InitTimebase();
+
+/**
+ * @brief Adapts the divider of channel 0 to the current bus clock, see {@see Clock_SetLevel()}
+ */
+void Timebase_ApplyClock();
+
+/**
+ * @brief Returns the current time in microseconds
+ * @return The time; Wraps around after roughly 71 minutes.
+ */
+static inline uint32_t Timebase_Microseconds()
+{
+	/* channel 1 counts down from its load value */
+	return ~PIT_CVAL1;
+}
+
+/**
+ * @brief Converts a microsecond time difference to seconds
+ * @param[in] microseconds The time difference in microseconds
+ * @return The time difference in seconds
+ */
+static inline fix16_t Timebase_ToSeconds(register uint32_t microseconds)
+{
+	/* 2^16/10^6 as 0.32 fixed point: 281474976.71 */
+	return (fix16_t)(((uint64_t)microseconds * 281474977u) >> 32);
+}
+
+#endif /* TIMEBASE_H_ */
@@ -0,0 +1,80 @@
+/*
+* complementary_filter.h
+*
+* Lightweight explicit complementary (Mahony style) filter for the attitude
+* and orientation DCM rows. The rows are integrated with the gyroscope rates
+* like in the Kalman prediction; Instead of a covariance update, the angles
+* between the estimated and the observed rows feed back through a proportional
+* and an integral gain, the latter tracking the gyroscope bias.
+* A step costs a few dozen multiplications and up to four reciprocal square roots.
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#ifndef COMPLEMENTARY_FILTER_H_
+#define COMPLEMENTARY_FILTER_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+#include "cpu/ramfunc.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \brief The state of a complementary filter
+*
+* The rows have the same meaning as the Kalman filter states, i.e. C3 is the
+* (gravity aligned) attitude row and C2 the orientation row, both in body coordinates.
+*/
+typedef struct {
+    v3d c3;                         //!< The attitude DCM row
+    v3d c2;                         //!< The orientation DCM row
+    v3d rate;                       //!< The bias corrected angular velocity used by the next prediction in rad/s
+    int64_t integral[3];            //!< The integrated error in rad/s as Q32, so that the small increments at high rates are kept; The negative gyroscope bias.
+    fix16_t kp;                     //!< The proportional gain in 1/s
+    fix16_t ki;                     //!< The integral gain in 1/s^2
+} complementary_filter_t;
+
+/*!
+* \brief Resets the rows to the initial orientation and clears the rate and the integrated error.
+* \param[out] filter The filter
+*
+* The gains are not modified.
+*/
+COLD NONNULL
+void complementary_filter_initialize(register complementary_filter_t *const filter);
+
+/*!
+* \brief Sets the rows, e.g. to continue from the state of another filter.
+* \param[inout] filter The filter
+* \param[in] c3 The attitude DCM row
+* \param[in] c2 The orientation DCM row
+*/
+NONNULL
+void complementary_filter_set_rows(register complementary_filter_t *const filter, register const fix16_t *const c3, register const fix16_t *const c2);
+
+/*!
+* \brief Integrates the rows with the rate of the last correction.
+* \param[inout] filter The filter
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*/
+HOT NONNULL RAMFUNC
+void complementary_filter_predict(register complementary_filter_t *const filter, register const fix16_t deltaT);
+
+/*!
+* \brief Corrects the rows and the rate for the next predictions.
+* \param[inout] filter The filter
+* \param[in] gyro The gyroscope data in rad/s
+* \param[in] c3 The observed attitude row, e.g. the normalized accelerometer data; May be <code>NULL</code>.
+* \param[in] c2 The observed orientation row, e.g. the projected magnetometer data; May be <code>NULL</code>.
+* \param[in] deltaT The time in seconds the observations account for, i.e. since the last correction.
+*
+* The observed rows must be normalized. The proportional correction is applied to the rows
+* right away, the rate is the gyroscope data corrected by the integrated error.
+*/
+HOT RAMFUNC
+void complementary_filter_correct(register complementary_filter_t *const filter, register const v3d *const gyro, register const v3d *const c3, register const v3d *const c2, register const fix16_t deltaT);
+
+#endif // COMPLEMENTARY_FILTER_H_
@@ -0,0 +1,251 @@
+/*
+* fix16_fast.h
+*
+* Fast path fix16 kernels for the sensor fusion, tuned for the Cortex-M0+
+* (single cycle MULS, no hardware divider, no CLZ).
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#ifndef FIX16_FAST_H_
+#define FIX16_FAST_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+#include "cpu/ramfunc.h"
+#include "fixmath.h"
+
+/*!
+* \def FIX16_FAST_KERNELS Enables the fast path kernels in the sensor fusion; Set by the build (PREPROCESSOR_MACROS).
+*
+* If disabled, the fusion uses the libfixmath reference implementations.
+*/
+#ifndef FIX16_FAST_KERNELS
+#define FIX16_FAST_KERNELS 0
+#endif
+
+/*!
+* \brief Multiplies two fix16 values, rounding to nearest.
+* \param[in] a The first operand
+* \param[in] b The second operand
+* \return The product
+*
+* Composes the 32x32->64 bit product from four 16x16 bit partial products,
+* which maps to four single cycle MULS instructions instead of a call to __aeabi_lmul.
+* There is no overflow detection; The result is only valid if it fits into a fix16_t,
+* which is always the case for the unit vectors and covariances in the fusion.
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_fast_mul(register const fix16_t a, register const fix16_t b)
+{
+    register const int32_t  ah = a >> 16;
+    register const uint32_t al = (uint32_t)a & 0xFFFFu;
+    register const int32_t  bh = b >> 16;
+    register const uint32_t bl = (uint32_t)b & 0xFFFFu;
+
+    register const int32_t  hi  = ah * bh;
+    register const int32_t  mid = ah * (int32_t)bl + (int32_t)al * bh;
+    register const uint32_t lo  = al * bl;
+
+    return (fix16_t)(((uint32_t)hi << 16) + (uint32_t)mid + ((lo + 0x8000u) >> 16));
+}
+
+/*!
+* \brief A value in [-2..2) in Q2.30 format; The product of two unit bounded fix16 values, see {\ref fix16_fast_mul_q30()}.
+*/
+typedef int32_t q30_t;
+
+/*!
+* \brief Multiplies a unit bounded fix16 value with an arbitrary one, rounding to nearest.
+* \param[in] u The bounded operand, |u| <= 1 + 2^-16, e.g. a component of a normalized vector
+* \param[in] b The other operand
+* \return The product
+*
+* Since the bounded operand has at most 17 significant bits, the product takes two 32x32->32 bit
+* MULS instead of the four of {\ref fix16_fast_mul()}: One with the integer part of b and one with its
+* fraction, which drops its least significant bit to fit. The error is below 1.5 LSB.
+* There is no overflow detection; The result is only valid if it fits into a fix16_t.
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_fast_mul_unit(register const fix16_t u, register const fix16_t b)
+{
+    register const int32_t bh = b >> 16;
+    register const int32_t bl = (int32_t)(((uint32_t)b & 0xFFFFu) >> 1);
+
+    return (fix16_t)(u * bh + ((u * bl + 0x4000) >> 15));
+}
+
+/*!
+* \brief Multiplies two unit bounded fix16 values into a Q2.30 product.
+* \param[in] a The first operand, |a| <= 1.125
+* \param[in] b The second operand, |b| <= 1.125
+* \return The product in Q2.30
+*
+* Both operands are rounded to 15 fractional bits (Q1.15), so that the product fits into
+* 32 bits and takes a single MULS. Products of the components of vectors no longer than 1.125
+* can be summed up in Q2.30 without overflow, e.g. to cross or dot products.
+*/
+HOT CONST
+STATIC_INLINE q30_t fix16_fast_mul_q30(register const fix16_t a, register const fix16_t b)
+{
+    return ((a + 1) >> 1) * ((b + 1) >> 1);
+}
+
+/*!
+* \brief Converts a Q2.30 value to fix16, rounding to nearest.
+* \param[in] x The Q2.30 value
+* \return The fix16 value
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_from_q30(register const q30_t x)
+{
+    return (fix16_t)((x + 0x2000) >> 14);
+}
+
+/*!
+* \brief Calculates the cross product of two vectors of at most unit length.
+* \param[in] a The first vector, |a| <= 1.125
+* \param[in] b The second vector, |b| <= 1.125
+* \param[out] out The cross product a x b; Must not alias the operands.
+*
+* Six MULS in Q2.30, see {\ref fix16_fast_mul_q30()}; The error is below 3 LSB.
+*/
+HOT NONNULL
+STATIC_INLINE void fix16_fast_cross_unit(register const fix16_t *const a, register const fix16_t *const b, register fix16_t *RESTRICT const out)
+{
+    out[0] = fix16_from_q30(fix16_fast_mul_q30(a[1], b[2]) - fix16_fast_mul_q30(a[2], b[1]));
+    out[1] = fix16_from_q30(fix16_fast_mul_q30(a[2], b[0]) - fix16_fast_mul_q30(a[0], b[2]));
+    out[2] = fix16_from_q30(fix16_fast_mul_q30(a[0], b[1]) - fix16_fast_mul_q30(a[1], b[0]));
+}
+
+/*!
+* \brief Calculates the dot product of two vectors of at most unit length.
+* \param[in] a The first vector, |a| <= 1.125
+* \param[in] b The second vector, |b| <= 1.125
+* \return The dot product
+*/
+HOT NONNULL
+STATIC_INLINE fix16_t fix16_fast_dot_unit(register const fix16_t *const a, register const fix16_t *const b)
+{
+    return fix16_from_q30(fix16_fast_mul_q30(a[0], b[0]) + fix16_fast_mul_q30(a[1], b[1]) + fix16_fast_mul_q30(a[2], b[2]));
+}
+
+/*!
+* \brief Calculates the squared length of a vector shorter than two.
+* \param[in] a The first component
+* \param[in] b The second component
+* \param[in] c The third component
+* \return The squared length, [0..4)
+*
+* The squares are summed without sign in Q2.30, which leaves room for up to four.
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_fast_norm_sq_unit(register const fix16_t a, register const fix16_t b, register const fix16_t c)
+{
+    register const uint32_t sum = (uint32_t)fix16_fast_mul_q30(a, a) + (uint32_t)fix16_fast_mul_q30(b, b) + (uint32_t)fix16_fast_mul_q30(c, c);
+    return (fix16_t)((sum + 0x2000u) >> 14);
+}
+
+/*!
+* \brief Adds two fix16 values and accumulates the overflow into a flag word.
+* \param[in] a The first operand
+* \param[in] b The second operand
+* \param[inout] overflow The flag word; Its sign bit is set if this or any previously accumulated operation overflowed.
+* \return The sum, wrapped around on overflow
+*
+* Unlike fix16_add(), there is no branch per element, so that the additions of a kernel can be
+* scheduled densely between the multiplications; Test the flag once per operation with
+* {\ref fix16_fast_overflowed()}.
+*/
+HOT NONNULL
+STATIC_INLINE fix16_t fix16_fast_add(register const fix16_t a, register const fix16_t b, register uint32_t *const overflow)
+{
+    register const uint32_t sum = (uint32_t)a + (uint32_t)b;
+
+    // the sign of the sum differs from both operands' signs
+    *overflow |= (sum ^ (uint32_t)a) & (sum ^ (uint32_t)b);
+    return (fix16_t)sum;
+}
+
+/*!
+* \brief Subtracts two fix16 values and accumulates the overflow into a flag word.
+* \param[in] a The minuend
+* \param[in] b The subtrahend
+* \param[inout] overflow The flag word, see {\ref fix16_fast_add()}
+* \return The difference, wrapped around on overflow
+*/
+HOT NONNULL
+STATIC_INLINE fix16_t fix16_fast_sub(register const fix16_t a, register const fix16_t b, register uint32_t *const overflow)
+{
+    register const uint32_t difference = (uint32_t)a - (uint32_t)b;
+
+    // the operands' signs differ and the sign of the difference differs from the minuend's
+    *overflow |= ((uint32_t)a ^ (uint32_t)b) & ((uint32_t)a ^ difference);
+    return (fix16_t)difference;
+}
+
+/*!
+* \brief Determines if an operation accumulated into a flag word overflowed.
+* \param[in] overflow The flag word, see {\ref fix16_fast_add()}
+* \return Nonzero on overflow
+*/
+HOT CONST
+STATIC_INLINE uint_fast8_t fix16_fast_overflowed(register const uint32_t overflow)
+{
+    return (overflow >> 31);
+}
+
+/*!
+* \brief Calculates the reciprocal square root of a value.
+* \param[in] x The value; Must be positive.
+* \return 1/sqrt(x) or fix16_maximum if x is not positive.
+*
+* Normalizes the value to [1..4), looks up an initial guess and refines it using two Newton steps.
+*/
+HOT CONST RAMFUNC
+fix16_t fix16_fast_rsqrt(register fix16_t x);
+
+/*!
+* \brief Calculates the square root of a value.
+* \param[in] x The value; Must not be negative.
+* \return sqrt(x)
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_fast_sqrt(register const fix16_t x)
+{
+    return (x > 0) ? fix16_fast_mul(x, fix16_fast_rsqrt(x)) : 0;
+}
+
+/*!
+* \brief Calculates the four-quadrant arc tangent of y/x.
+* \param[in] y The y coordinate
+* \param[in] x The x coordinate
+* \return The angle in radians, [-pi..pi]
+*
+* Uses a 9th order minimax polynomial on the first octant; The maximum error is approx. 1e-4 rad.
+*/
+HOT CONST
+fix16_t fix16_fast_atan2(register fix16_t y, register fix16_t x);
+
+/*!
+* \brief Calculates the arc sine of a value.
+* \param[in] x The value, [-1..1]
+* \return The angle in radians, [-pi/2..pi/2]
+*/
+HOT CONST
+STATIC_INLINE fix16_t fix16_fast_asin(register const fix16_t x)
+{
+    register const fix16_t c = fix16_sub(F16(1), fix16_fast_mul(x, x));
+    return fix16_fast_atan2(x, fix16_fast_sqrt(c));
+}
+
+/*!
+* \brief Verifies the fast path kernels against the libfixmath reference implementations.
+* \return Zero if all kernels are within tolerance, the number of the first failing kernel otherwise.
+*/
+COLD
+uint8_t fix16_fast_verify();
+
+#endif /* FIX16_FAST_H_ */
@@ -0,0 +1,96 @@
+/*
+* gyro_bias.h
+*
+* Online estimation of the residual gyroscope bias.
+* The static calibration offsets drift with temperature; Whenever the sensor
+* is found to be stationary (accelerometer norm close to 1g, low gyroscope
+* deviation), the remaining rate is learned as bias and removed from the
+* prepared gyroscope data before it reaches the filter.
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#ifndef GYRO_BIAS_H_
+#define GYRO_BIAS_H_
+
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \def GYRO_BIAS_TEMPERATURE_COMPENSATION Set to <code>1</code> to additionally learn a linear temperature coefficient of the bias
+*
+* The coefficient is only observable if the sensor is stationary at different temperatures.
+*/
+#ifndef GYRO_BIAS_TEMPERATURE_COMPENSATION
+#define GYRO_BIAS_TEMPERATURE_COMPENSATION 0
+#endif
+
+/*!
+* \brief The learned state of the bias estimator, see {\ref gyro_bias_checkpoint()}
+*/
+typedef struct {
+    v3d bias;                               //!< The bias in rad/s at the reference temperature
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    v3d bias_temperature;                   //!< The temperature coefficient in rad/s per degree Celsius
+    fix16_t reference_temperature;          //!< The reference temperature in degree Celsius
+    uint16_t have_reference_temperature;    //!< Nonzero if the reference temperature is valid
+#endif
+    uint16_t learning_count;                //!< The number of learning steps taken
+} gyro_bias_snapshot_t;
+
+/*!
+* \brief Resets the bias estimate and the stationary detection.
+*/
+COLD
+void gyro_bias_initialize();
+
+/*!
+* \brief Removes the estimated bias from prepared gyroscope data.
+* \param[inout] gyro The prepared gyroscope data in rad/s
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+HOT NONNULL
+void gyro_bias_correct(register v3d *const gyro, register const fix16_t temperature);
+
+/*!
+* \brief Detects stationary periods and refines the bias estimate.
+* \param[in] gyro The bias corrected gyroscope data in rad/s, see {\ref gyro_bias_correct()}
+* \param[in] accel The prepared accelerometer data in g
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+HOT NONNULL
+void gyro_bias_update(register const v3d *const gyro, register const v3d *const accel, register const fix16_t temperature);
+
+/*!
+* \brief Determines if the sensor was detected to be stationary by the last update.
+* \return Nonzero if stationary
+*/
+uint8_t gyro_bias_is_stationary();
+
+/*!
+* \brief Fetches the current bias estimate.
+* \param[out] bias The bias in rad/s
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+NONNULL
+void gyro_bias_fetch(register v3d *const bias, register const fix16_t temperature);
+
+/*!
+* \brief Fetches the learned state, e.g. to keep it across a warm reset.
+* \param[out] snapshot The learned state
+*/
+COLD NONNULL
+void gyro_bias_checkpoint(register gyro_bias_snapshot_t *const snapshot);
+
+/*!
+* \brief Continues learning from a state fetched by {\ref gyro_bias_checkpoint()}.
+* \param[in] snapshot The learned state
+*
+* The stationary detection starts over as after {\ref gyro_bias_initialize()}.
+*/
+COLD NONNULL
+void gyro_bias_resume(register const gyro_bias_snapshot_t *const snapshot);
+
+#endif // GYRO_BIAS_H_
@@ -0,0 +1,1615 @@
+/*
+* kalman_kernels.h
+*
+* Straight-line Kalman kernels of the sensor fusion, generated by host/kalman_codegen.py
+* from the filter model; Do not edit. Included by sensor_fusion.c only, after the
+* filter types and the fusion_* arithmetic, see {\ref FUSION_GENERATED_KERNELS}.
+*/
+
+#ifndef KALMAN_KERNELS_H_
+#define KALMAN_KERNELS_H_
+
+#if FUSION_ENGINE == FUSION_ENGINE_DUAL
+
+/*!
+* \brief Predicts the covariance, P = A*P*A' + Q; Generated.
+* \param[inout] kf The filter
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*/
+HOT NONNULL
+static void fusion_predict_P_generated(fusion_filter_t *const kf, uint32_t *const overflow)
+{
+    // T = A*P for the rows coupled to the angular velocities
+    const fix16_t t0_0 = fusion_add(fusion_add(kf->P[0], fusion_mul(kf->B[0][0][1], kf->P[4]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[5]), *overflow);
+    const fix16_t t0_1 = fusion_add(fusion_add(kf->P[1], fusion_mul(kf->B[0][0][1], kf->P[9]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[10]), *overflow);
+    const fix16_t t0_2 = fusion_add(fusion_add(kf->P[2], fusion_mul(kf->B[0][0][1], kf->P[13]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[14]), *overflow);
+    const fix16_t t0_3 = fusion_add(fusion_add(kf->P[3], fusion_mul(kf->B[0][0][1], kf->P[16]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[17]), *overflow);
+    const fix16_t t0_4 = fusion_add(fusion_add(kf->P[4], fusion_mul(kf->B[0][0][1], kf->P[18]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[19]), *overflow);
+    const fix16_t t0_5 = fusion_add(fusion_add(kf->P[5], fusion_mul(kf->B[0][0][1], kf->P[19]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[20]), *overflow);
+    const fix16_t t1_1 = fusion_add(fusion_add(kf->P[6], fusion_mul(kf->B[0][1][0], kf->P[8]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[10]), *overflow);
+    const fix16_t t1_2 = fusion_add(fusion_add(kf->P[7], fusion_mul(kf->B[0][1][0], kf->P[12]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[14]), *overflow);
+    const fix16_t t1_3 = fusion_add(fusion_add(kf->P[8], fusion_mul(kf->B[0][1][0], kf->P[15]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[17]), *overflow);
+    const fix16_t t1_4 = fusion_add(fusion_add(kf->P[9], fusion_mul(kf->B[0][1][0], kf->P[16]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[19]), *overflow);
+    const fix16_t t1_5 = fusion_add(fusion_add(kf->P[10], fusion_mul(kf->B[0][1][0], kf->P[17]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[20]), *overflow);
+    const fix16_t t2_2 = fusion_add(fusion_add(kf->P[11], fusion_mul(kf->B[0][2][0], kf->P[12]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[13]), *overflow);
+    const fix16_t t2_3 = fusion_add(fusion_add(kf->P[12], fusion_mul(kf->B[0][2][0], kf->P[15]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[16]), *overflow);
+    const fix16_t t2_4 = fusion_add(fusion_add(kf->P[13], fusion_mul(kf->B[0][2][0], kf->P[16]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[18]), *overflow);
+    const fix16_t t2_5 = fusion_add(fusion_add(kf->P[14], fusion_mul(kf->B[0][2][0], kf->P[17]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[19]), *overflow);
+
+    // P = T*A' + Q (upper triangle)
+    kf->P[0] = fusion_add(fusion_add(fusion_add(t0_0, fusion_mul(t0_4, kf->B[0][0][1]), *overflow), fusion_mul(t0_5, kf->B[0][0][2]), *overflow), kf->q[0], *overflow);
+    kf->P[1] = fusion_add(fusion_add(t0_1, fusion_mul(t0_3, kf->B[0][1][0]), *overflow), fusion_mul(t0_5, kf->B[0][1][2]), *overflow);
+    kf->P[2] = fusion_add(fusion_add(t0_2, fusion_mul(t0_3, kf->B[0][2][0]), *overflow), fusion_mul(t0_4, kf->B[0][2][1]), *overflow);
+    kf->P[3] = t0_3;
+    kf->P[4] = t0_4;
+    kf->P[5] = t0_5;
+    kf->P[6] = fusion_add(fusion_add(fusion_add(t1_1, fusion_mul(t1_3, kf->B[0][1][0]), *overflow), fusion_mul(t1_5, kf->B[0][1][2]), *overflow), kf->q[1], *overflow);
+    kf->P[7] = fusion_add(fusion_add(t1_2, fusion_mul(t1_3, kf->B[0][2][0]), *overflow), fusion_mul(t1_4, kf->B[0][2][1]), *overflow);
+    kf->P[8] = t1_3;
+    kf->P[9] = t1_4;
+    kf->P[10] = t1_5;
+    kf->P[11] = fusion_add(fusion_add(fusion_add(t2_2, fusion_mul(t2_3, kf->B[0][2][0]), *overflow), fusion_mul(t2_4, kf->B[0][2][1]), *overflow), kf->q[2], *overflow);
+    kf->P[12] = t2_3;
+    kf->P[13] = t2_4;
+    kf->P[14] = t2_5;
+    kf->P[15] = fusion_add(kf->P[15], kf->q[3], *overflow);
+    kf->P[18] = fusion_add(kf->P[18], kf->q[4], *overflow);
+    kf->P[20] = fusion_add(kf->P[20], kf->q[5], *overflow);
+}
+
+/*!
+* \brief Corrects with the axis_gyro observation model; Generated.
+* \param[inout] kf The filter
+* \param[in] z The observation vector
+* \param[in] r The diagonal of the observation noise
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*
+* Observes the accelerometer and magnetometer: the DCM row, then the angular velocities; States 0, 1, 2, 3, 4, 5.
+*/
+HOT NONNULL
+static void fusion_correct_axis_gyro_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)
+{
+    // observation 0 selects state 0
+    {
+        const fix16_t ph0 = kf->P[0];
+        const fix16_t ph1 = kf->P[1];
+        const fix16_t ph2 = kf->P[2];
+        const fix16_t ph3 = kf->P[3];
+        const fix16_t ph4 = kf->P[4];
+        const fix16_t ph5 = kf->P[5];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph0, r[0], *overflow));
+        const fix16_t innovation = fusion_sub(z[0], kf->x[0], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 1 selects state 1
+    {
+        const fix16_t ph0 = kf->P[1];
+        const fix16_t ph1 = kf->P[6];
+        const fix16_t ph2 = kf->P[7];
+        const fix16_t ph3 = kf->P[8];
+        const fix16_t ph4 = kf->P[9];
+        const fix16_t ph5 = kf->P[10];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph1, r[1], *overflow));
+        const fix16_t innovation = fusion_sub(z[1], kf->x[1], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 2 selects state 2
+    {
+        const fix16_t ph0 = kf->P[2];
+        const fix16_t ph1 = kf->P[7];
+        const fix16_t ph2 = kf->P[11];
+        const fix16_t ph3 = kf->P[12];
+        const fix16_t ph4 = kf->P[13];
+        const fix16_t ph5 = kf->P[14];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph2, r[2], *overflow));
+        const fix16_t innovation = fusion_sub(z[2], kf->x[2], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 3 selects state 3
+    {
+        const fix16_t ph0 = kf->P[3];
+        const fix16_t ph1 = kf->P[8];
+        const fix16_t ph2 = kf->P[12];
+        const fix16_t ph3 = kf->P[15];
+        const fix16_t ph4 = kf->P[16];
+        const fix16_t ph5 = kf->P[17];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph3, r[3], *overflow));
+        const fix16_t innovation = fusion_sub(z[3], kf->x[3], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 4 selects state 4
+    {
+        const fix16_t ph0 = kf->P[4];
+        const fix16_t ph1 = kf->P[9];
+        const fix16_t ph2 = kf->P[13];
+        const fix16_t ph3 = kf->P[16];
+        const fix16_t ph4 = kf->P[18];
+        const fix16_t ph5 = kf->P[19];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph4, r[4], *overflow));
+        const fix16_t innovation = fusion_sub(z[4], kf->x[4], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 5 selects state 5
+    {
+        const fix16_t ph0 = kf->P[5];
+        const fix16_t ph1 = kf->P[10];
+        const fix16_t ph2 = kf->P[14];
+        const fix16_t ph3 = kf->P[17];
+        const fix16_t ph4 = kf->P[19];
+        const fix16_t ph5 = kf->P[20];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph5, r[5], *overflow));
+        const fix16_t innovation = fusion_sub(z[5], kf->x[5], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+}
+
+/*!
+* \brief Corrects with the gyro observation model; Generated.
+* \param[inout] kf The filter
+* \param[in] z The observation vector
+* \param[in] r The diagonal of the observation noise
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*
+* Observes the gyroscope: the angular velocities; States 3, 4, 5.
+*/
+HOT NONNULL
+static void fusion_correct_gyro_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)
+{
+    // observation 0 selects state 3
+    {
+        const fix16_t ph0 = kf->P[3];
+        const fix16_t ph1 = kf->P[8];
+        const fix16_t ph2 = kf->P[12];
+        const fix16_t ph3 = kf->P[15];
+        const fix16_t ph4 = kf->P[16];
+        const fix16_t ph5 = kf->P[17];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph3, r[0], *overflow));
+        const fix16_t innovation = fusion_sub(z[0], kf->x[3], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 1 selects state 4
+    {
+        const fix16_t ph0 = kf->P[4];
+        const fix16_t ph1 = kf->P[9];
+        const fix16_t ph2 = kf->P[13];
+        const fix16_t ph3 = kf->P[16];
+        const fix16_t ph4 = kf->P[18];
+        const fix16_t ph5 = kf->P[19];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph4, r[1], *overflow));
+        const fix16_t innovation = fusion_sub(z[1], kf->x[4], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+
+    // observation 2 selects state 5
+    {
+        const fix16_t ph0 = kf->P[5];
+        const fix16_t ph1 = kf->P[10];
+        const fix16_t ph2 = kf->P[14];
+        const fix16_t ph3 = kf->P[17];
+        const fix16_t ph4 = kf->P[19];
+        const fix16_t ph5 = kf->P[20];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph5, r[2], *overflow));
+        const fix16_t innovation = fusion_sub(z[2], kf->x[5], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k1, ph1), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k1, ph2), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k1, ph3), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph4), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph5), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k2, ph2), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k2, ph3), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k2, ph4), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k2, ph5), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k3, ph3), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k3, ph4), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k3, ph5), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k4, ph4), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k4, ph5), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k5, ph5), *overflow);
+    }
+}
+
+/*!
+* \brief Corrects with the generated kernel matching an observation model
+* \param[inout] kf The filter
+* \param[in] kfm The observation
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+* \return Nonzero if a kernel matched, zero if the model is not generated
+*/
+HOT NONNULL
+static uint_fast8_t fusion_correct_generated(fusion_filter_t *const kf, const fusion_observation_t *const kfm, uint32_t *const overflow)
+{
+    if (6 == kfm->count && 0 == kfm->state[0] && 1 == kfm->state[1] && 2 == kfm->state[2] && 3 == kfm->state[3] && 4 == kfm->state[4] && 5 == kfm->state[5])
+    {
+        fusion_correct_axis_gyro_generated(kf, kfm->z, kfm->r, overflow);
+        return 1;
+    }
+    if (3 == kfm->count && 3 == kfm->state[0] && 4 == kfm->state[1] && 5 == kfm->state[2])
+    {
+        fusion_correct_gyro_generated(kf, kfm->z, kfm->r, overflow);
+        return 1;
+    }
+    return 0;
+}
+
+#elif FUSION_ENGINE == FUSION_ENGINE_JOINT
+
+/*!
+* \brief Predicts the covariance, P = A*P*A' + Q; Generated.
+* \param[inout] kf The filter
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*/
+HOT NONNULL
+static void fusion_predict_P_generated(fusion_filter_t *const kf, uint32_t *const overflow)
+{
+    // T = A*P for the rows coupled to the angular velocities
+    const fix16_t t0_0 = fusion_add(fusion_add(kf->P[0], fusion_mul(kf->B[0][0][1], kf->P[7]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[8]), *overflow);
+    const fix16_t t0_1 = fusion_add(fusion_add(kf->P[1], fusion_mul(kf->B[0][0][1], kf->P[15]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[16]), *overflow);
+    const fix16_t t0_2 = fusion_add(fusion_add(kf->P[2], fusion_mul(kf->B[0][0][1], kf->P[22]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[23]), *overflow);
+    const fix16_t t0_3 = fusion_add(fusion_add(kf->P[3], fusion_mul(kf->B[0][0][1], kf->P[28]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[29]), *overflow);
+    const fix16_t t0_4 = fusion_add(fusion_add(kf->P[4], fusion_mul(kf->B[0][0][1], kf->P[33]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[34]), *overflow);
+    const fix16_t t0_5 = fusion_add(fusion_add(kf->P[5], fusion_mul(kf->B[0][0][1], kf->P[37]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[38]), *overflow);
+    const fix16_t t0_6 = fusion_add(fusion_add(kf->P[6], fusion_mul(kf->B[0][0][1], kf->P[40]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[41]), *overflow);
+    const fix16_t t0_7 = fusion_add(fusion_add(kf->P[7], fusion_mul(kf->B[0][0][1], kf->P[42]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[43]), *overflow);
+    const fix16_t t0_8 = fusion_add(fusion_add(kf->P[8], fusion_mul(kf->B[0][0][1], kf->P[43]), *overflow), fusion_mul(kf->B[0][0][2], kf->P[44]), *overflow);
+    const fix16_t t1_1 = fusion_add(fusion_add(kf->P[9], fusion_mul(kf->B[0][1][0], kf->P[14]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[16]), *overflow);
+    const fix16_t t1_2 = fusion_add(fusion_add(kf->P[10], fusion_mul(kf->B[0][1][0], kf->P[21]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[23]), *overflow);
+    const fix16_t t1_3 = fusion_add(fusion_add(kf->P[11], fusion_mul(kf->B[0][1][0], kf->P[27]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[29]), *overflow);
+    const fix16_t t1_4 = fusion_add(fusion_add(kf->P[12], fusion_mul(kf->B[0][1][0], kf->P[32]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[34]), *overflow);
+    const fix16_t t1_5 = fusion_add(fusion_add(kf->P[13], fusion_mul(kf->B[0][1][0], kf->P[36]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[38]), *overflow);
+    const fix16_t t1_6 = fusion_add(fusion_add(kf->P[14], fusion_mul(kf->B[0][1][0], kf->P[39]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[41]), *overflow);
+    const fix16_t t1_7 = fusion_add(fusion_add(kf->P[15], fusion_mul(kf->B[0][1][0], kf->P[40]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[43]), *overflow);
+    const fix16_t t1_8 = fusion_add(fusion_add(kf->P[16], fusion_mul(kf->B[0][1][0], kf->P[41]), *overflow), fusion_mul(kf->B[0][1][2], kf->P[44]), *overflow);
+    const fix16_t t2_2 = fusion_add(fusion_add(kf->P[17], fusion_mul(kf->B[0][2][0], kf->P[21]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[22]), *overflow);
+    const fix16_t t2_3 = fusion_add(fusion_add(kf->P[18], fusion_mul(kf->B[0][2][0], kf->P[27]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[28]), *overflow);
+    const fix16_t t2_4 = fusion_add(fusion_add(kf->P[19], fusion_mul(kf->B[0][2][0], kf->P[32]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[33]), *overflow);
+    const fix16_t t2_5 = fusion_add(fusion_add(kf->P[20], fusion_mul(kf->B[0][2][0], kf->P[36]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[37]), *overflow);
+    const fix16_t t2_6 = fusion_add(fusion_add(kf->P[21], fusion_mul(kf->B[0][2][0], kf->P[39]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[40]), *overflow);
+    const fix16_t t2_7 = fusion_add(fusion_add(kf->P[22], fusion_mul(kf->B[0][2][0], kf->P[40]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[42]), *overflow);
+    const fix16_t t2_8 = fusion_add(fusion_add(kf->P[23], fusion_mul(kf->B[0][2][0], kf->P[41]), *overflow), fusion_mul(kf->B[0][2][1], kf->P[43]), *overflow);
+    const fix16_t t3_3 = fusion_add(fusion_add(kf->P[24], fusion_mul(kf->B[1][0][1], kf->P[28]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[29]), *overflow);
+    const fix16_t t3_4 = fusion_add(fusion_add(kf->P[25], fusion_mul(kf->B[1][0][1], kf->P[33]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[34]), *overflow);
+    const fix16_t t3_5 = fusion_add(fusion_add(kf->P[26], fusion_mul(kf->B[1][0][1], kf->P[37]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[38]), *overflow);
+    const fix16_t t3_6 = fusion_add(fusion_add(kf->P[27], fusion_mul(kf->B[1][0][1], kf->P[40]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[41]), *overflow);
+    const fix16_t t3_7 = fusion_add(fusion_add(kf->P[28], fusion_mul(kf->B[1][0][1], kf->P[42]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[43]), *overflow);
+    const fix16_t t3_8 = fusion_add(fusion_add(kf->P[29], fusion_mul(kf->B[1][0][1], kf->P[43]), *overflow), fusion_mul(kf->B[1][0][2], kf->P[44]), *overflow);
+    const fix16_t t4_4 = fusion_add(fusion_add(kf->P[30], fusion_mul(kf->B[1][1][0], kf->P[32]), *overflow), fusion_mul(kf->B[1][1][2], kf->P[34]), *overflow);
+    const fix16_t t4_5 = fusion_add(fusion_add(kf->P[31], fusion_mul(kf->B[1][1][0], kf->P[36]), *overflow), fusion_mul(kf->B[1][1][2], kf->P[38]), *overflow);
+    const fix16_t t4_6 = fusion_add(fusion_add(kf->P[32], fusion_mul(kf->B[1][1][0], kf->P[39]), *overflow), fusion_mul(kf->B[1][1][2], kf->P[41]), *overflow);
+    const fix16_t t4_7 = fusion_add(fusion_add(kf->P[33], fusion_mul(kf->B[1][1][0], kf->P[40]), *overflow), fusion_mul(kf->B[1][1][2], kf->P[43]), *overflow);
+    const fix16_t t4_8 = fusion_add(fusion_add(kf->P[34], fusion_mul(kf->B[1][1][0], kf->P[41]), *overflow), fusion_mul(kf->B[1][1][2], kf->P[44]), *overflow);
+    const fix16_t t5_5 = fusion_add(fusion_add(kf->P[35], fusion_mul(kf->B[1][2][0], kf->P[36]), *overflow), fusion_mul(kf->B[1][2][1], kf->P[37]), *overflow);
+    const fix16_t t5_6 = fusion_add(fusion_add(kf->P[36], fusion_mul(kf->B[1][2][0], kf->P[39]), *overflow), fusion_mul(kf->B[1][2][1], kf->P[40]), *overflow);
+    const fix16_t t5_7 = fusion_add(fusion_add(kf->P[37], fusion_mul(kf->B[1][2][0], kf->P[40]), *overflow), fusion_mul(kf->B[1][2][1], kf->P[42]), *overflow);
+    const fix16_t t5_8 = fusion_add(fusion_add(kf->P[38], fusion_mul(kf->B[1][2][0], kf->P[41]), *overflow), fusion_mul(kf->B[1][2][1], kf->P[43]), *overflow);
+
+    // P = T*A' + Q (upper triangle)
+    kf->P[0] = fusion_add(fusion_add(fusion_add(t0_0, fusion_mul(t0_7, kf->B[0][0][1]), *overflow), fusion_mul(t0_8, kf->B[0][0][2]), *overflow), kf->q[0], *overflow);
+    kf->P[1] = fusion_add(fusion_add(t0_1, fusion_mul(t0_6, kf->B[0][1][0]), *overflow), fusion_mul(t0_8, kf->B[0][1][2]), *overflow);
+    kf->P[2] = fusion_add(fusion_add(t0_2, fusion_mul(t0_6, kf->B[0][2][0]), *overflow), fusion_mul(t0_7, kf->B[0][2][1]), *overflow);
+    kf->P[3] = fusion_add(fusion_add(t0_3, fusion_mul(t0_7, kf->B[1][0][1]), *overflow), fusion_mul(t0_8, kf->B[1][0][2]), *overflow);
+    kf->P[4] = fusion_add(fusion_add(t0_4, fusion_mul(t0_6, kf->B[1][1][0]), *overflow), fusion_mul(t0_8, kf->B[1][1][2]), *overflow);
+    kf->P[5] = fusion_add(fusion_add(t0_5, fusion_mul(t0_6, kf->B[1][2][0]), *overflow), fusion_mul(t0_7, kf->B[1][2][1]), *overflow);
+    kf->P[6] = t0_6;
+    kf->P[7] = t0_7;
+    kf->P[8] = t0_8;
+    kf->P[9] = fusion_add(fusion_add(fusion_add(t1_1, fusion_mul(t1_6, kf->B[0][1][0]), *overflow), fusion_mul(t1_8, kf->B[0][1][2]), *overflow), kf->q[1], *overflow);
+    kf->P[10] = fusion_add(fusion_add(t1_2, fusion_mul(t1_6, kf->B[0][2][0]), *overflow), fusion_mul(t1_7, kf->B[0][2][1]), *overflow);
+    kf->P[11] = fusion_add(fusion_add(t1_3, fusion_mul(t1_7, kf->B[1][0][1]), *overflow), fusion_mul(t1_8, kf->B[1][0][2]), *overflow);
+    kf->P[12] = fusion_add(fusion_add(t1_4, fusion_mul(t1_6, kf->B[1][1][0]), *overflow), fusion_mul(t1_8, kf->B[1][1][2]), *overflow);
+    kf->P[13] = fusion_add(fusion_add(t1_5, fusion_mul(t1_6, kf->B[1][2][0]), *overflow), fusion_mul(t1_7, kf->B[1][2][1]), *overflow);
+    kf->P[14] = t1_6;
+    kf->P[15] = t1_7;
+    kf->P[16] = t1_8;
+    kf->P[17] = fusion_add(fusion_add(fusion_add(t2_2, fusion_mul(t2_6, kf->B[0][2][0]), *overflow), fusion_mul(t2_7, kf->B[0][2][1]), *overflow), kf->q[2], *overflow);
+    kf->P[18] = fusion_add(fusion_add(t2_3, fusion_mul(t2_7, kf->B[1][0][1]), *overflow), fusion_mul(t2_8, kf->B[1][0][2]), *overflow);
+    kf->P[19] = fusion_add(fusion_add(t2_4, fusion_mul(t2_6, kf->B[1][1][0]), *overflow), fusion_mul(t2_8, kf->B[1][1][2]), *overflow);
+    kf->P[20] = fusion_add(fusion_add(t2_5, fusion_mul(t2_6, kf->B[1][2][0]), *overflow), fusion_mul(t2_7, kf->B[1][2][1]), *overflow);
+    kf->P[21] = t2_6;
+    kf->P[22] = t2_7;
+    kf->P[23] = t2_8;
+    kf->P[24] = fusion_add(fusion_add(fusion_add(t3_3, fusion_mul(t3_7, kf->B[1][0][1]), *overflow), fusion_mul(t3_8, kf->B[1][0][2]), *overflow), kf->q[3], *overflow);
+    kf->P[25] = fusion_add(fusion_add(t3_4, fusion_mul(t3_6, kf->B[1][1][0]), *overflow), fusion_mul(t3_8, kf->B[1][1][2]), *overflow);
+    kf->P[26] = fusion_add(fusion_add(t3_5, fusion_mul(t3_6, kf->B[1][2][0]), *overflow), fusion_mul(t3_7, kf->B[1][2][1]), *overflow);
+    kf->P[27] = t3_6;
+    kf->P[28] = t3_7;
+    kf->P[29] = t3_8;
+    kf->P[30] = fusion_add(fusion_add(fusion_add(t4_4, fusion_mul(t4_6, kf->B[1][1][0]), *overflow), fusion_mul(t4_8, kf->B[1][1][2]), *overflow), kf->q[4], *overflow);
+    kf->P[31] = fusion_add(fusion_add(t4_5, fusion_mul(t4_6, kf->B[1][2][0]), *overflow), fusion_mul(t4_7, kf->B[1][2][1]), *overflow);
+    kf->P[32] = t4_6;
+    kf->P[33] = t4_7;
+    kf->P[34] = t4_8;
+    kf->P[35] = fusion_add(fusion_add(fusion_add(t5_5, fusion_mul(t5_6, kf->B[1][2][0]), *overflow), fusion_mul(t5_7, kf->B[1][2][1]), *overflow), kf->q[5], *overflow);
+    kf->P[36] = t5_6;
+    kf->P[37] = t5_7;
+    kf->P[38] = t5_8;
+    kf->P[39] = fusion_add(kf->P[39], kf->q[6], *overflow);
+    kf->P[42] = fusion_add(kf->P[42], kf->q[7], *overflow);
+    kf->P[44] = fusion_add(kf->P[44], kf->q[8], *overflow);
+}
+
+/*!
+* \brief Corrects with the attitude_gyro observation model; Generated.
+* \param[inout] kf The filter
+* \param[in] z The observation vector
+* \param[in] r The diagonal of the observation noise
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*
+* Observes the accelerometer: the attitude row, then the angular velocities; States 0, 1, 2, 6, 7, 8.
+*/
+HOT NONNULL
+static void fusion_correct_attitude_gyro_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)
+{
+    // observation 0 selects state 0
+    {
+        const fix16_t ph0 = kf->P[0];
+        const fix16_t ph1 = kf->P[1];
+        const fix16_t ph2 = kf->P[2];
+        const fix16_t ph3 = kf->P[3];
+        const fix16_t ph4 = kf->P[4];
+        const fix16_t ph5 = kf->P[5];
+        const fix16_t ph6 = kf->P[6];
+        const fix16_t ph7 = kf->P[7];
+        const fix16_t ph8 = kf->P[8];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph0, r[0], *overflow));
+        const fix16_t innovation = fusion_sub(z[0], kf->x[0], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 1 selects state 1
+    {
+        const fix16_t ph0 = kf->P[1];
+        const fix16_t ph1 = kf->P[9];
+        const fix16_t ph2 = kf->P[10];
+        const fix16_t ph3 = kf->P[11];
+        const fix16_t ph4 = kf->P[12];
+        const fix16_t ph5 = kf->P[13];
+        const fix16_t ph6 = kf->P[14];
+        const fix16_t ph7 = kf->P[15];
+        const fix16_t ph8 = kf->P[16];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph1, r[1], *overflow));
+        const fix16_t innovation = fusion_sub(z[1], kf->x[1], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 2 selects state 2
+    {
+        const fix16_t ph0 = kf->P[2];
+        const fix16_t ph1 = kf->P[10];
+        const fix16_t ph2 = kf->P[17];
+        const fix16_t ph3 = kf->P[18];
+        const fix16_t ph4 = kf->P[19];
+        const fix16_t ph5 = kf->P[20];
+        const fix16_t ph6 = kf->P[21];
+        const fix16_t ph7 = kf->P[22];
+        const fix16_t ph8 = kf->P[23];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph2, r[2], *overflow));
+        const fix16_t innovation = fusion_sub(z[2], kf->x[2], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 3 selects state 6
+    {
+        const fix16_t ph0 = kf->P[6];
+        const fix16_t ph1 = kf->P[14];
+        const fix16_t ph2 = kf->P[21];
+        const fix16_t ph3 = kf->P[27];
+        const fix16_t ph4 = kf->P[32];
+        const fix16_t ph5 = kf->P[36];
+        const fix16_t ph6 = kf->P[39];
+        const fix16_t ph7 = kf->P[40];
+        const fix16_t ph8 = kf->P[41];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph6, r[3], *overflow));
+        const fix16_t innovation = fusion_sub(z[3], kf->x[6], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 4 selects state 7
+    {
+        const fix16_t ph0 = kf->P[7];
+        const fix16_t ph1 = kf->P[15];
+        const fix16_t ph2 = kf->P[22];
+        const fix16_t ph3 = kf->P[28];
+        const fix16_t ph4 = kf->P[33];
+        const fix16_t ph5 = kf->P[37];
+        const fix16_t ph6 = kf->P[40];
+        const fix16_t ph7 = kf->P[42];
+        const fix16_t ph8 = kf->P[43];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph7, r[4], *overflow));
+        const fix16_t innovation = fusion_sub(z[4], kf->x[7], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 5 selects state 8
+    {
+        const fix16_t ph0 = kf->P[8];
+        const fix16_t ph1 = kf->P[16];
+        const fix16_t ph2 = kf->P[23];
+        const fix16_t ph3 = kf->P[29];
+        const fix16_t ph4 = kf->P[34];
+        const fix16_t ph5 = kf->P[38];
+        const fix16_t ph6 = kf->P[41];
+        const fix16_t ph7 = kf->P[43];
+        const fix16_t ph8 = kf->P[44];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph8, r[5], *overflow));
+        const fix16_t innovation = fusion_sub(z[5], kf->x[8], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+}
+
+/*!
+* \brief Corrects with the orientation observation model; Generated.
+* \param[inout] kf The filter
+* \param[in] z The observation vector
+* \param[in] r The diagonal of the observation noise
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*
+* Observes the magnetometer: the orientation row; States 3, 4, 5.
+*/
+HOT NONNULL
+static void fusion_correct_orientation_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)
+{
+    // observation 0 selects state 3
+    {
+        const fix16_t ph0 = kf->P[3];
+        const fix16_t ph1 = kf->P[11];
+        const fix16_t ph2 = kf->P[18];
+        const fix16_t ph3 = kf->P[24];
+        const fix16_t ph4 = kf->P[25];
+        const fix16_t ph5 = kf->P[26];
+        const fix16_t ph6 = kf->P[27];
+        const fix16_t ph7 = kf->P[28];
+        const fix16_t ph8 = kf->P[29];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph3, r[0], *overflow));
+        const fix16_t innovation = fusion_sub(z[0], kf->x[3], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 1 selects state 4
+    {
+        const fix16_t ph0 = kf->P[4];
+        const fix16_t ph1 = kf->P[12];
+        const fix16_t ph2 = kf->P[19];
+        const fix16_t ph3 = kf->P[25];
+        const fix16_t ph4 = kf->P[30];
+        const fix16_t ph5 = kf->P[31];
+        const fix16_t ph6 = kf->P[32];
+        const fix16_t ph7 = kf->P[33];
+        const fix16_t ph8 = kf->P[34];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph4, r[1], *overflow));
+        const fix16_t innovation = fusion_sub(z[1], kf->x[4], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 2 selects state 5
+    {
+        const fix16_t ph0 = kf->P[5];
+        const fix16_t ph1 = kf->P[13];
+        const fix16_t ph2 = kf->P[20];
+        const fix16_t ph3 = kf->P[26];
+        const fix16_t ph4 = kf->P[31];
+        const fix16_t ph5 = kf->P[35];
+        const fix16_t ph6 = kf->P[36];
+        const fix16_t ph7 = kf->P[37];
+        const fix16_t ph8 = kf->P[38];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph5, r[2], *overflow));
+        const fix16_t innovation = fusion_sub(z[2], kf->x[5], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+}
+
+/*!
+* \brief Corrects with the gyro observation model; Generated.
+* \param[inout] kf The filter
+* \param[in] z The observation vector
+* \param[in] r The diagonal of the observation noise
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+*
+* Observes the gyroscope: the angular velocities; States 6, 7, 8.
+*/
+HOT NONNULL
+static void fusion_correct_gyro_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)
+{
+    // observation 0 selects state 6
+    {
+        const fix16_t ph0 = kf->P[6];
+        const fix16_t ph1 = kf->P[14];
+        const fix16_t ph2 = kf->P[21];
+        const fix16_t ph3 = kf->P[27];
+        const fix16_t ph4 = kf->P[32];
+        const fix16_t ph5 = kf->P[36];
+        const fix16_t ph6 = kf->P[39];
+        const fix16_t ph7 = kf->P[40];
+        const fix16_t ph8 = kf->P[41];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph6, r[0], *overflow));
+        const fix16_t innovation = fusion_sub(z[0], kf->x[6], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 1 selects state 7
+    {
+        const fix16_t ph0 = kf->P[7];
+        const fix16_t ph1 = kf->P[15];
+        const fix16_t ph2 = kf->P[22];
+        const fix16_t ph3 = kf->P[28];
+        const fix16_t ph4 = kf->P[33];
+        const fix16_t ph5 = kf->P[37];
+        const fix16_t ph6 = kf->P[40];
+        const fix16_t ph7 = kf->P[42];
+        const fix16_t ph8 = kf->P[43];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph7, r[1], *overflow));
+        const fix16_t innovation = fusion_sub(z[1], kf->x[7], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+
+    // observation 2 selects state 8
+    {
+        const fix16_t ph0 = kf->P[8];
+        const fix16_t ph1 = kf->P[16];
+        const fix16_t ph2 = kf->P[23];
+        const fix16_t ph3 = kf->P[29];
+        const fix16_t ph4 = kf->P[34];
+        const fix16_t ph5 = kf->P[38];
+        const fix16_t ph6 = kf->P[41];
+        const fix16_t ph7 = kf->P[43];
+        const fix16_t ph8 = kf->P[44];
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph8, r[2], *overflow));
+        const fix16_t innovation = fusion_sub(z[2], kf->x[8], *overflow);
+        const fix16_t k0 = fusion_mul(ph0, inv_s);
+        const fix16_t k1 = fusion_mul(ph1, inv_s);
+        const fix16_t k2 = fusion_mul(ph2, inv_s);
+        const fix16_t k3 = fusion_mul(ph3, inv_s);
+        const fix16_t k4 = fusion_mul(ph4, inv_s);
+        const fix16_t k5 = fusion_mul(ph5, inv_s);
+        const fix16_t k6 = fusion_mul(ph6, inv_s);
+        const fix16_t k7 = fusion_mul(ph7, inv_s);
+        const fix16_t k8 = fusion_mul(ph8, inv_s);
+        kf->x[0] = fusion_add(kf->x[0], fusion_mul(k0, innovation), *overflow);
+        kf->x[1] = fusion_add(kf->x[1], fusion_mul(k1, innovation), *overflow);
+        kf->x[2] = fusion_add(kf->x[2], fusion_mul(k2, innovation), *overflow);
+        kf->x[3] = fusion_add(kf->x[3], fusion_mul(k3, innovation), *overflow);
+        kf->x[4] = fusion_add(kf->x[4], fusion_mul(k4, innovation), *overflow);
+        kf->x[5] = fusion_add(kf->x[5], fusion_mul(k5, innovation), *overflow);
+        kf->x[6] = fusion_add(kf->x[6], fusion_mul(k6, innovation), *overflow);
+        kf->x[7] = fusion_add(kf->x[7], fusion_mul(k7, innovation), *overflow);
+        kf->x[8] = fusion_add(kf->x[8], fusion_mul(k8, innovation), *overflow);
+        kf->P[0] = fusion_sub(kf->P[0], fusion_mul(k0, ph0), *overflow);
+        kf->P[1] = fusion_sub(kf->P[1], fusion_mul(k0, ph1), *overflow);
+        kf->P[2] = fusion_sub(kf->P[2], fusion_mul(k0, ph2), *overflow);
+        kf->P[3] = fusion_sub(kf->P[3], fusion_mul(k0, ph3), *overflow);
+        kf->P[4] = fusion_sub(kf->P[4], fusion_mul(k0, ph4), *overflow);
+        kf->P[5] = fusion_sub(kf->P[5], fusion_mul(k0, ph5), *overflow);
+        kf->P[6] = fusion_sub(kf->P[6], fusion_mul(k0, ph6), *overflow);
+        kf->P[7] = fusion_sub(kf->P[7], fusion_mul(k0, ph7), *overflow);
+        kf->P[8] = fusion_sub(kf->P[8], fusion_mul(k0, ph8), *overflow);
+        kf->P[9] = fusion_sub(kf->P[9], fusion_mul(k1, ph1), *overflow);
+        kf->P[10] = fusion_sub(kf->P[10], fusion_mul(k1, ph2), *overflow);
+        kf->P[11] = fusion_sub(kf->P[11], fusion_mul(k1, ph3), *overflow);
+        kf->P[12] = fusion_sub(kf->P[12], fusion_mul(k1, ph4), *overflow);
+        kf->P[13] = fusion_sub(kf->P[13], fusion_mul(k1, ph5), *overflow);
+        kf->P[14] = fusion_sub(kf->P[14], fusion_mul(k1, ph6), *overflow);
+        kf->P[15] = fusion_sub(kf->P[15], fusion_mul(k1, ph7), *overflow);
+        kf->P[16] = fusion_sub(kf->P[16], fusion_mul(k1, ph8), *overflow);
+        kf->P[17] = fusion_sub(kf->P[17], fusion_mul(k2, ph2), *overflow);
+        kf->P[18] = fusion_sub(kf->P[18], fusion_mul(k2, ph3), *overflow);
+        kf->P[19] = fusion_sub(kf->P[19], fusion_mul(k2, ph4), *overflow);
+        kf->P[20] = fusion_sub(kf->P[20], fusion_mul(k2, ph5), *overflow);
+        kf->P[21] = fusion_sub(kf->P[21], fusion_mul(k2, ph6), *overflow);
+        kf->P[22] = fusion_sub(kf->P[22], fusion_mul(k2, ph7), *overflow);
+        kf->P[23] = fusion_sub(kf->P[23], fusion_mul(k2, ph8), *overflow);
+        kf->P[24] = fusion_sub(kf->P[24], fusion_mul(k3, ph3), *overflow);
+        kf->P[25] = fusion_sub(kf->P[25], fusion_mul(k3, ph4), *overflow);
+        kf->P[26] = fusion_sub(kf->P[26], fusion_mul(k3, ph5), *overflow);
+        kf->P[27] = fusion_sub(kf->P[27], fusion_mul(k3, ph6), *overflow);
+        kf->P[28] = fusion_sub(kf->P[28], fusion_mul(k3, ph7), *overflow);
+        kf->P[29] = fusion_sub(kf->P[29], fusion_mul(k3, ph8), *overflow);
+        kf->P[30] = fusion_sub(kf->P[30], fusion_mul(k4, ph4), *overflow);
+        kf->P[31] = fusion_sub(kf->P[31], fusion_mul(k4, ph5), *overflow);
+        kf->P[32] = fusion_sub(kf->P[32], fusion_mul(k4, ph6), *overflow);
+        kf->P[33] = fusion_sub(kf->P[33], fusion_mul(k4, ph7), *overflow);
+        kf->P[34] = fusion_sub(kf->P[34], fusion_mul(k4, ph8), *overflow);
+        kf->P[35] = fusion_sub(kf->P[35], fusion_mul(k5, ph5), *overflow);
+        kf->P[36] = fusion_sub(kf->P[36], fusion_mul(k5, ph6), *overflow);
+        kf->P[37] = fusion_sub(kf->P[37], fusion_mul(k5, ph7), *overflow);
+        kf->P[38] = fusion_sub(kf->P[38], fusion_mul(k5, ph8), *overflow);
+        kf->P[39] = fusion_sub(kf->P[39], fusion_mul(k6, ph6), *overflow);
+        kf->P[40] = fusion_sub(kf->P[40], fusion_mul(k6, ph7), *overflow);
+        kf->P[41] = fusion_sub(kf->P[41], fusion_mul(k6, ph8), *overflow);
+        kf->P[42] = fusion_sub(kf->P[42], fusion_mul(k7, ph7), *overflow);
+        kf->P[43] = fusion_sub(kf->P[43], fusion_mul(k7, ph8), *overflow);
+        kf->P[44] = fusion_sub(kf->P[44], fusion_mul(k8, ph8), *overflow);
+    }
+}
+
+/*!
+* \brief Corrects with the generated kernel matching an observation model
+* \param[inout] kf The filter
+* \param[in] kfm The observation
+* \param[inout] overflow The flag word of the additions, see {\ref fix16_fast_add()}
+* \return Nonzero if a kernel matched, zero if the model is not generated
+*/
+HOT NONNULL
+static uint_fast8_t fusion_correct_generated(fusion_filter_t *const kf, const fusion_observation_t *const kfm, uint32_t *const overflow)
+{
+    if (6 == kfm->count && 0 == kfm->state[0] && 1 == kfm->state[1] && 2 == kfm->state[2] && 6 == kfm->state[3] && 7 == kfm->state[4] && 8 == kfm->state[5])
+    {
+        fusion_correct_attitude_gyro_generated(kf, kfm->z, kfm->r, overflow);
+        return 1;
+    }
+    if (3 == kfm->count && 3 == kfm->state[0] && 4 == kfm->state[1] && 5 == kfm->state[2])
+    {
+        fusion_correct_orientation_generated(kf, kfm->z, kfm->r, overflow);
+        return 1;
+    }
+    if (3 == kfm->count && 6 == kfm->state[0] && 7 == kfm->state[1] && 8 == kfm->state[2])
+    {
+        fusion_correct_gyro_generated(kf, kfm->z, kfm->r, overflow);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
+
+#endif /* KALMAN_KERNELS_H_ */
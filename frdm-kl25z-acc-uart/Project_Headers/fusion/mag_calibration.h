@@ -0,0 +1,83 @@
+/*
+* mag_calibration.h
+*
+* On-target hard and soft iron calibration of the HMC5883L magnetometer.
+* While active, the normal equations of a general ellipsoid fit are accumulated
+* from the raw samples in constant memory; No samples are buffered. Solving
+* yields the 3x4 affine transformation that maps the ellipsoid onto a sphere,
+* in the layout of {\ref sensor_calibration_t::hmc5883l}.
+*
+*  Created on: Mar 10, 2014
+*      Author: Markus
+*/
+
+#ifndef MAG_CALIBRATION_H_
+#define MAG_CALIBRATION_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+#include "fixmath.h"
+
+/*!
+* \def MAG_CALIBRATION_MIN_SAMPLES The minimum number of samples required for a fit
+*/
+#define MAG_CALIBRATION_MIN_SAMPLES     (200)
+
+/*!
+* \def MAG_CALIBRATION_MAX_SAMPLES The number of samples after which accumulation stops
+*
+* Bounds the 64 bit sums of the fourth order terms for full scale raw values.
+*/
+#define MAG_CALIBRATION_MAX_SAMPLES     (65536ul)
+
+/*!
+* \brief Discards the accumulated statistics and starts collecting samples.
+*/
+COLD
+void mag_calibration_start();
+
+/*!
+* \brief Stops collecting samples without solving.
+*/
+COLD
+void mag_calibration_stop();
+
+/*!
+* \brief Determines if samples are being collected.
+* \return Nonzero if active
+*/
+LEAF
+uint8_t mag_calibration_is_active();
+
+/*!
+* \brief Fetches the number of samples accumulated.
+* \return The sample count
+*/
+LEAF
+uint32_t mag_calibration_sample_count();
+
+/*!
+* \brief Accumulates a raw magnetometer sample; Does nothing unless active.
+* \param[in] x The raw x value
+* \param[in] y The raw y value
+* \param[in] z The raw z value
+*
+* Overflowing samples (-4096) are ignored.
+*/
+HOT
+void mag_calibration_update(register const int16_t x, register const int16_t y, register const int16_t z);
+
+/*!
+* \brief Stops collecting samples and fits the ellipsoid.
+* \param[in] scaling The HMC5883L scaling factor the raw values are divided by, e.g. F16(1090) for 1.3 gauss mode
+* \param[out] calibration The 3x4 affine transformation, row major
+* \return Zero on success, nonzero if there are too few samples or the samples do not span an ellipsoid
+*
+* The transformation is symmetric, so that it does not rotate the sensor frame, and
+* maps the fitted ellipsoid onto a sphere of the (harmonic) mean semi-axis length.
+*/
+COLD NONNULL
+uint8_t mag_calibration_solve(register const fix16_t scaling, fix16_t calibration[static 3][4]);
+
+#endif // MAG_CALIBRATION_H_
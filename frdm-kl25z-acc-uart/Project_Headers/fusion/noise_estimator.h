@@ -0,0 +1,73 @@
+/*
+* noise_estimator.h
+*
+* Running estimation of the sensor noise for adaptive measurement noise.
+* The mean and variance of each axis are tracked with an exponentially weighted
+* form of Welford's update in O(1) per sample and without a history buffer;
+* Their ratio to the calibrated variances scales the measurement noise of the
+* filter, so that its precision follows the actual vibration level.
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#ifndef NOISE_ESTIMATOR_H_
+#define NOISE_ESTIMATOR_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \def NOISE_ESTIMATOR_SHIFT The smoothing factor of the estimates as a power of two; The window is about 2^shift samples.
+*/
+#ifndef NOISE_ESTIMATOR_SHIFT
+#define NOISE_ESTIMATOR_SHIFT 6
+#endif
+
+/*!
+* \brief The running noise estimate of a three axis sensor
+*
+* Mean and variance are kept in Q32 (variances are squared fix16 values), since the
+* calibrated variances are at or below the fix16 resolution.
+*/
+typedef struct {
+    int64_t mean[3];                //!< The smoothed values in Q32
+    int64_t var[3];                 //!< The smoothed variances in Q32
+    int64_t nominal[3];             //!< The calibrated variances in Q32; Zero for axes that are not scaled
+    uint_fast8_t seeded;            //!< Set after the first sample initialized the mean
+} noise_estimator_t;
+
+/*!
+* \brief Initializes an estimator with the calibrated variances.
+* \param[out] estimator The estimator
+* \param[in] x The calibrated x axis variance in Q32
+* \param[in] y The calibrated y axis variance in Q32
+* \param[in] z The calibrated z axis variance in Q32
+* \param[in] gain The unit conversion factor the calibrated variances are given without, e.g. degree to radians
+*
+* The variance estimates start out at the calibrated variances, see {\ref mpu6050_var_accelerometer_q32()};
+* Axes without a positive calibrated variance do not contribute to {\ref noise_estimator_scale()}.
+*/
+COLD NONNULL
+void noise_estimator_initialize(register noise_estimator_t *const estimator, register const int64_t x, register const int64_t y, register const int64_t z, register const fix16_t gain);
+
+/*!
+* \brief Updates the estimates with a sample.
+* \param[inout] estimator The estimator
+* \param[in] sample The prepared sensor data
+*/
+HOT NONNULL
+void noise_estimator_update(register noise_estimator_t *const estimator, register const v3d *const sample);
+
+/*!
+* \brief Fetches the ratio of the estimated to the calibrated variances, averaged over the axes.
+* \param[in] estimator The estimator
+* \return The ratio, clamped to [1/4, 64]; One if no axis has a calibrated variance.
+*/
+HOT NONNULL LEAF
+fix16_t noise_estimator_scale(register const noise_estimator_t *const estimator);
+
+#endif // NOISE_ESTIMATOR_H_
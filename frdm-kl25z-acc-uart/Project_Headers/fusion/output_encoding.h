@@ -0,0 +1,113 @@
+/*
+* output_encoding.h
+*
+* Compact wire formats of the fused orientation.
+* The fix16_t outputs need four bytes per value; A unit quaternion fits in
+* Q1.15, its smallest three components in 47 bits and the angles in 16 bit
+* binary angles. Successive quaternions differ only slightly, so the delta
+* format sends int8 differences against the last transmitted Q1.15 values.
+*
+* All multi-byte values are little endian.
+*
+*  Created on: Mar 10, 2014
+*      Author: Markus
+*/
+
+#ifndef OUTPUT_ENCODING_H_
+#define OUTPUT_ENCODING_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixquat.h"
+
+/*!
+* \def OUTPUT_SMALLEST_THREE_SIZE The size of a smallest-three encoded quaternion in bytes
+*
+* Bits 46..45 hold the index of the dropped (largest) component, bits 44..30, 29..15
+* and 14..0 the remaining components in order, each as signed 15 bit value of the
+* component times sqrt(2) in units of 1/16383. The dropped component is positive
+* and follows from the unit norm.
+*/
+#define OUTPUT_SMALLEST_THREE_SIZE      (6)
+
+/*!
+* \def OUTPUT_DELTA_KEYFRAME_INTERVAL The maximum number of delta frames between two key frames
+*/
+#ifndef OUTPUT_DELTA_KEYFRAME_INTERVAL
+#define OUTPUT_DELTA_KEYFRAME_INTERVAL  (32)
+#endif
+
+/*!
+* \def OUTPUT_DELTA_KEYFRAME_TYPE The frame type of the key frames of the delta format
+*
+* The payload is the sequence number (uint8_t) followed by the quaternion w, x, y, z in Q1.15 (int16_t).
+*/
+#define OUTPUT_DELTA_KEYFRAME_TYPE      (48)
+
+/*!
+* \def OUTPUT_DELTA_MAX_PAYLOAD The largest payload of the delta format in bytes
+*/
+#define OUTPUT_DELTA_MAX_PAYLOAD        (1 + 4 * sizeof(int16_t))
+
+/*!
+* \brief State of the delta encoder
+*/
+typedef struct {
+    int16_t reference[4];           //!< The Q1.15 quaternion as reconstructed by the receiver
+    uint8_t sequence;               //!< Sequence number of the next frame
+    uint8_t since_keyframe;         //!< Number of delta frames since the last key frame
+} output_delta_t;
+
+/*!
+* \brief Converts a unit quaternion to Q1.15
+* \param[out] out The w, x, y and z components; Saturated to [-1, 1)
+* \param[in] quat The quaternion
+*/
+HOT NONNULL LEAF
+void output_encode_q15(register int16_t out[static 4], register const qf16 *const quat);
+
+/*!
+* \brief Encodes a unit quaternion in smallest-three format
+* \param[out] out The encoded quaternion, see {\ref OUTPUT_SMALLEST_THREE_SIZE}
+* \param[in] quat The quaternion
+*/
+HOT NONNULL LEAF
+void output_encode_smallest_three(register uint8_t out[static OUTPUT_SMALLEST_THREE_SIZE], register const qf16 *const quat);
+
+/*!
+* \brief Converts angles to 16 bit binary angles
+* \param[out] out The roll, pitch and yaw angles in units of pi/32768
+* \param[in] roll The roll angle in radians
+* \param[in] pitch The pitch angle in radians
+* \param[in] yaw The yaw angle in radians
+*/
+HOT NONNULL LEAF
+void output_encode_angles(register int16_t out[static 3], register fix16_t roll, register fix16_t pitch, register fix16_t yaw);
+
+/*!
+* \brief Resets the delta encoder, so that the next frame is a key frame
+* \param[out] state The encoder state
+*/
+COLD NONNULL LEAF
+void output_delta_initialize(register output_delta_t *const state);
+
+/*!
+* \brief Encodes a quaternion as key frame or delta frame
+* \param[inout] state The encoder state
+* \param[in] quat The quaternion
+* \param[out] type The frame type, either {\ref OUTPUT_DELTA_KEYFRAME_TYPE} or the delta frame type
+* \param[in] delta_type The frame type of delta frames
+* \param[out] payload The payload; Must hold {\ref OUTPUT_DELTA_MAX_PAYLOAD} bytes.
+* \return The payload length
+*
+* Delta frames are the sequence number (uint8_t) followed by the differences of w, x, y and z
+* against the previous frame in Q1.15 (int8_t). A key frame is sent if a difference does not
+* fit or after {\ref OUTPUT_DELTA_KEYFRAME_INTERVAL} delta frames. The receiver must wait for
+* the next key frame after a gap in the sequence numbers.
+*/
+HOT NONNULL
+uint8_t output_delta_encode(register output_delta_t *const state, register const qf16 *const quat, uint8_t *const type, uint8_t delta_type, uint8_t payload[static OUTPUT_DELTA_MAX_PAYLOAD]);
+
+#endif
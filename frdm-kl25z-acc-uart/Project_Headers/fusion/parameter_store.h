@@ -0,0 +1,64 @@
+/*
+* parameter_store.h
+*
+* Persistence of the sensor calibration and the fusion tuning parameters.
+* A versioned, CRC protected block in the flash sector reserved by the linker
+* script (_sparameters) replaces the compiled-in defaults at startup, so that
+* a board can be recalibrated without rebuilding the firmware.
+*
+*  Created on: Mar 10, 2014
+*      Author: Markus
+*/
+
+#ifndef PARAMETER_STORE_H_
+#define PARAMETER_STORE_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+
+/*!
+* \def PARAMETER_STORE_VERSION The layout version of the parameter block
+*
+* Must be increased whenever {\ref sensor_calibration_t} or {\ref fusion_parameter_t} change,
+* so that blocks written by older firmware are ignored instead of misinterpreted.
+*/
+#define PARAMETER_STORE_VERSION         (2)
+
+/*!
+* \brief The result codes of the parameter store
+*/
+typedef enum {
+    PARAMETER_STORE_OK = 0,             //!< The operation succeeded
+    PARAMETER_STORE_EMPTY = 1,          //!< No parameter block was stored
+    PARAMETER_STORE_INVALID = 2,        //!< The stored block has a different version or length, a CRC mismatch or invalid values
+    PARAMETER_STORE_FLASH_ERROR = 3,    //!< Erasing, programming or verifying the flash failed
+} parameter_store_result_t;
+
+/*!
+* \brief Loads the stored parameters into the sensor calibration and the fusion.
+* \return {\ref PARAMETER_STORE_OK} if the parameters were applied; The compiled-in defaults remain in effect otherwise.
+*
+* Must be called before {\ref sensor_prepare_initialize()} and {\ref fusion_initialize()}.
+*/
+COLD
+parameter_store_result_t parameter_store_load();
+
+/*!
+* \brief Stores the current sensor calibration and fusion parameters.
+* \return {\ref PARAMETER_STORE_OK} on success, {\ref PARAMETER_STORE_INVALID} if the values would not load again
+*
+* Blocks with interrupts disabled while the sector is erased and programmed.
+* The programmed block is read back and validated like {\ref parameter_store_load()} does.
+*/
+COLD
+parameter_store_result_t parameter_store_save();
+
+/*!
+* \brief Erases the stored parameters, so that the compiled-in defaults are used after the next reset.
+* \return {\ref PARAMETER_STORE_OK} on success
+*/
+COLD
+parameter_store_result_t parameter_store_erase();
+
+#endif // PARAMETER_STORE_H_
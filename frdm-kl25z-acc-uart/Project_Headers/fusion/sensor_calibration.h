@@ -8,10 +8,36 @@
 #ifndef SENSOR_CALIBRATIOn_H
 #define SENSOR_CALIBRATIOn_H
 
+#include <stdint.h>
+
 #include "compiler.h"
 #include "fixmath.h"
 #include "fixvector3d.h"
 
+/*!
+* \def MPU6050_COUNT The number of MPU6050 averaged into one virtual IMU
+*
+* The first one is calibrated by the persisted calibration, the redundant ones by the compiled-in
+* calibrations of {\ref mpu6050_redundant_accelerometer_calibration_matrix()} and
+* {\ref mpu6050_redundant_gyroscope_calibration_matrix()}; See InitI2CArbiter() in main.c for their
+* addresses and pins. Up to three.
+*/
+#ifndef MPU6050_COUNT
+#define MPU6050_COUNT 1
+#endif
+
+/*!
+* \brief The complete sensor calibration, as persisted in the parameter store
+*/
+typedef struct {
+    fix16_t mpu6050_accelerometer[3][4];    //!< MPU6050 accelerometer affine transformation, row major
+    fix16_t mpu6050_gyroscope[3][4];        //!< MPU6050 gyroscope affine transformation, row major
+    fix16_t hmc5883l[3][4];                 //!< HMC5883L magnetometer affine transformation, row major
+    fix16_t var_mpu6050_accelerometer[3];   //!< MPU6050 accelerometer variances
+    fix16_t var_mpu6050_gyroscope[3];       //!< MPU6050 gyroscope variances
+    fix16_t var_hmc5883l[3];                //!< HMC5883L magnetometer variances
+} sensor_calibration_t;
+
 /*!
 * \brief Calibrates MPU6050 accelerometer sensor data
 * \param[inout] x The x data (will be overwritten with the calibrated version)
@@ -78,6 +104,15 @@ STATIC_INLINE void hmc5883l_calibrate_v3d(register v3d *const data)
 LEAF NONNULL
 void mpu6050_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z);
 
+/*!
+* \brief Retrieves the variances of the MMA8451Q accelerometer
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+LEAF NONNULL
+void mma8451q_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z);
+
 /*!
 * \brief Retrieves the variances of the MPU6050 gyroscope
 * \param[out] x The x axis variances
@@ -96,4 +131,119 @@ void mpu6050_var_gyroscope(register fix16_t *const RESTRICT x, register fix16_t
 LEAF NONNULL
 void hmc5883l_var(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z);
 
+/*!
+* \brief Retrieves the variances of the MPU6050 accelerometer in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*
+* Unlike {\ref mpu6050_var_accelerometer()}, variances below the fix16 resolution are not clamped.
+*/
+LEAF NONNULL
+void mpu6050_var_accelerometer_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z);
+
+/*!
+* \brief Retrieves the variances of the MPU6050 gyroscope in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+LEAF NONNULL
+void mpu6050_var_gyroscope_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z);
+
+/*!
+* \brief Retrieves the variances of the HMC5883L magnetometer in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*
+* Unlike {\ref hmc5883l_var()}, variances below the fix16 resolution are not clamped.
+*/
+LEAF NONNULL
+void hmc5883l_var_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z);
+
+/*!
+* \brief Retrieves the MPU6050 accelerometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* mpu6050_accelerometer_calibration_matrix();
+
+/*!
+* \brief Retrieves the MMA8451Q accelerometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* mma8451q_accelerometer_calibration_matrix();
+
+/*!
+* \brief Retrieves the MPU6050 gyroscope calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* mpu6050_gyroscope_calibration_matrix();
+
+/*!
+* \brief Retrieves the HMC5883L magnetometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* hmc5883l_calibration_matrix();
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief Retrieves the accelerometer calibration of a redundant MPU6050
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* mpu6050_redundant_accelerometer_calibration_matrix(uint_fast8_t device);
+
+/*!
+* \brief Retrieves the gyroscope calibration of a redundant MPU6050
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \return The 3x4 affine transformation matrix, row major
+*/
+LEAF CONST
+const fix16_t* mpu6050_redundant_gyroscope_calibration_matrix(uint_fast8_t device);
+
+#endif
+
+/*!
+* \brief Fetches the current calibration
+* \param[out] calibration The calibration
+*/
+COLD NONNULL
+void sensor_calibration_fetch(register sensor_calibration_t *const calibration);
+
+/*!
+* \brief Replaces the HMC5883L affine transformation, leaving the rest of the calibration unchanged
+* \param[in] transformation The 3x4 affine transformation, row major
+*
+* The folded sensor transforms must be rebuilt with {\ref sensor_prepare_initialize()} afterwards.
+*/
+COLD NONNULL
+void sensor_calibration_apply_hmc5883l(register const fix16_t transformation[static 3][4]);
+
+/*!
+* \brief Checks a calibration before it is applied or stored
+* \param[in] calibration The calibration
+* \return Nonzero if all variances are positive
+*
+* Variances below the fix16 resolution must be given as one LSB instead of zero.
+*/
+COLD NONNULL
+uint8_t sensor_calibration_valid(register const sensor_calibration_t *const calibration);
+
+/*!
+* \brief Replaces the current calibration
+* \param[in] calibration The calibration
+* \return Zero on success, nonzero if a variance is not positive; The calibration is unchanged then.
+*
+* The folded sensor transforms must be rebuilt with {\ref sensor_prepare_initialize()} afterwards.
+*/
+COLD NONNULL
+uint8_t sensor_calibration_apply(register const sensor_calibration_t *const calibration);
+
 #endif // SENSOR_CALIBRATIOn_H
\ No newline at end of file
@@ -10,8 +10,18 @@
 
 #include "compiler.h"
 #include "fixmatrix.h"
+#include "fixquat.h"
 #include "fixvector3d.h"
 
+/*!
+* \brief A plain 3x3 direction cosine matrix
+*
+* Unlike {\ref mf16}, without the storage for the maximum matrix size, the dimensions and the error flags.
+*/
+typedef struct {
+    fix16_t data[3][3];     //!< The elements, row major
+} dcm3_t;
+
 /*!
 * \brief Builds a DCM from the given calibrated sensor values
 * \param[out] dcm The DCM matrix to write to
@@ -39,6 +49,34 @@ void sensor_dcm2rpy(const mf16 *RESTRICT const dcm, fix16_t *RESTRICT const roll
 */
 void sensor_ddcm(const mf16 *RESTRICT const current_dcm, const mf16 *RESTRICT const previous_dcm, fix16_t *RESTRICT const omega_roll, fix16_t *RESTRICT const omega_pitch, fix16_t *RESTRICT const omega_yaw) HOT NONNULL;
 
+/*!
+* \brief Builds the rotation matrix from the attitude and orientation rows of the filter state
+* \param[out] dcm The rotation matrix with the rows C3 x C2, C2 and -C3
+* \param[in] c2 The orientation row; Unit length
+* \param[in] c3 The attitude row; Unit length
+*
+* The rows are expected to be normalized already, e.g. by the state sanitation of the filter;
+* C2 is orthogonalized against C3 and renormalized before C1 is formed, so that all rows
+* are orthonormal and every element describes the same rotation.
+*/
+void sensor_dcm3_from_rows(dcm3_t *RESTRICT const dcm, const fix16_t *RESTRICT const c2, const fix16_t *RESTRICT const c3) HOT NONNULL;
+
+/*!
+* \brief Converts a rotation matrix to a quaternion.
+* \param[in] dcm The rotation matrix
+* \param[out] quat The normalized quaternion
+*/
+void sensor_dcm3_to_quaternion(const dcm3_t *RESTRICT const dcm, qf16 *RESTRICT const quat) HOT NONNULL;
+
+/*!
+* \brief Gets roll, pitch, yaw from a rotation matrix.
+* \param[in] dcm The rotation matrix
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch(elevation) angle in radians.
+* \param[out] yaw The yaw(heading, azimuth) angle in radians.
+*/
+void sensor_dcm3_to_rpy(const dcm3_t *RESTRICT const dcm, fix16_t *RESTRICT const roll, fix16_t *RESTRICT const pitch, fix16_t *RESTRICT const yaw) HOT NONNULL;
+
 /*!
 * \brief Gets the last calculated coordinate system
 * \param[out] x The X axis
@@ -8,22 +8,131 @@
 #ifndef SENSOR_FUNCTION_H_
 #define SENSOR_FUNCTION_H_
 
+#include <stdint.h>
+
 #include "compiler.h"
+#include "cpu/ramfunc.h"
 #include "fixmath.h"
 #include "fixmatrix.h"
 #include "fixquat.h"
 
+/*!
+* \def FUSION_ENGINE_DUAL Filter engine: Two 6-state filters for attitude and orientation
+*/
+#define FUSION_ENGINE_DUAL  0
+
+/*!
+* \def FUSION_ENGINE_JOINT Filter engine: One 9-state filter for attitude and orientation with shared angular velocities
+*/
+#define FUSION_ENGINE_JOINT 1
+
+/*!
+* \def FUSION_ENGINE The filter engine used by the sensor fusion
+*
+* The joint engine tracks the correlation of both DCM rows and integrates the gyroscope once,
+* at the cost of a larger covariance update (45 instead of two times 21 elements).
+*/
+#ifndef FUSION_ENGINE
+#define FUSION_ENGINE FUSION_ENGINE_DUAL
+#endif
+
+/*!
+* \def FUSION_GENERATED_KERNELS Selects the unrolled covariance prediction and correction kernels
+*
+* The kernels in fusion/kalman_kernels.h are generated by host/kalman_codegen.py and replace the
+* structure-aware loops with straight-line code without index tables or loop overhead.
+* Enabled for the dual engine by default; The joint kernels are about three times the size
+* and are opt-in where the flash allows it.
+*/
+#ifndef FUSION_GENERATED_KERNELS
+#define FUSION_GENERATED_KERNELS (FUSION_ENGINE == FUSION_ENGINE_DUAL)
+#endif
+
 /*!
 * \brief Initializes the sensor fusion mechanism.
 */
 COLD
 void fusion_initialize();
 
+/*!
+* \brief The tuning parameters of the sensor fusion
+*/
+typedef enum {
+    FUSION_PARAMETER_R_AXIS = 0,            //!< Observation axis uncertainty (accelerometer)
+    FUSION_PARAMETER_R_PROJECTION = 1,      //!< Observation projection uncertainty (magnetometer)
+    FUSION_PARAMETER_R_GYRO = 2,            //!< Observation gyro uncertainty
+    FUSION_PARAMETER_Q_AXIS = 3,            //!< Axis process noise
+    FUSION_PARAMETER_Q_GYRO = 4,            //!< Gyro process noise
+    FUSION_PARAMETER_ALPHA1 = 5,            //!< Tuning factor for the axis observation
+    FUSION_PARAMETER_ALPHA2 = 6,            //!< Tuning factor for the gyro observation
+    FUSION_PARAMETER_ATTITUDE_THRESHOLD = 7,//!< Threshold value for attitude detection
+    FUSION_PARAMETER_COMPLEMENTARY_KP = 8,  //!< Proportional gain of the complementary filter
+    FUSION_PARAMETER_COMPLEMENTARY_KI = 9,  //!< Integral gain of the complementary filter
+    FUSION_PARAMETER_COUNT = 10             //!< The number of tuning parameters
+} fusion_parameter_t;
+
+/*!
+* \brief Sets a tuning parameter of the sensor fusion.
+* \param[in] parameter The parameter
+* \param[in] value The value; Must not be negative.
+* \return Zero on success, nonzero if the parameter or value is invalid.
+*
+* The value is kept across {\ref fusion_initialize()}.
+*/
+COLD
+uint8_t fusion_set_parameter(register const fusion_parameter_t parameter, register const fix16_t value);
+
+/*!
+* \brief Fetches a tuning parameter of the sensor fusion.
+* \param[in] parameter The parameter
+* \return The value, or -1 if the parameter is invalid.
+*/
+COLD LEAF
+fix16_t fusion_get_parameter(register const fusion_parameter_t parameter);
+
+/*!
+* \brief The fusion modes
+*/
+typedef enum {
+    FUSION_MODE_KALMAN = 0,                 //!< Kalman filter at the sample rate
+    FUSION_MODE_COMPLEMENTARY = 1,          //!< Complementary filter at the sample rate; Cheapest, least precise.
+    FUSION_MODE_HYBRID = 2                  //!< Complementary filter at the sample rate, corrected by the Kalman filter at a fraction of it
+} fusion_mode_t;
+
+/*!
+* \brief Selects the fusion mode.
+* \param[in] mode The mode
+* \return Zero on success, nonzero if the mode is invalid.
+*
+* The complementary filter continues from the current orientation, the Kalman filter
+* bootstraps again if it was not running. The mode is kept across {\ref fusion_initialize()}.
+*/
+COLD
+uint8_t fusion_set_mode(register const fusion_mode_t mode);
+
+/*!
+* \brief Fetches the fusion mode.
+* \return The mode
+*/
+COLD LEAF
+fusion_mode_t fusion_get_mode();
+
+/*!
+* \brief Sets the number of samples per Kalman step in {\ref FUSION_MODE_HYBRID}.
+* \param[in] samples The number of samples; Zero is treated as one.
+*
+* Lower sample rates need fewer samples per step for the same correction rate.
+*/
+COLD LEAF
+void fusion_set_hybrid_decimation(register const uint8_t samples);
+
 /*!
 * \brief Fetches the values without any modification
-* \param[out] roll The roll angle in degree.
-* \param[out] pitch The pitch (elevation) angle in degree.
-* \param[out] yaw The yaw (heading, azimuth) angle in degree.
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch (elevation) angle in radians.
+* \param[out] yaw The yaw (heading, azimuth) angle in radians.
+*
+* The angles are derived from the orientation quaternion and cached until the next prediction or update.
 */
 HOT NONNULL LEAF
 void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw);
@@ -31,31 +140,73 @@ void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t
 /*!
 * \brief Fetches the orientation quaternion.
 * \param[out] quat The orientation quaternion
+*
+* The quaternion is cached until the next prediction or update.
 */
 HOT NONNULL LEAF
 void fusion_fetch_quaternion(register qf16 *RESTRICT const quat);
 
+/*!
+* \brief Fetches the orientation quaternion extrapolated with the estimated angular velocity.
+* \param[out] quat The orientation quaternion
+* \param[in] deltaT The time in seconds past the state, see {\ref fusion_get_state_time()}; At most 0.1 s are extrapolated.
+*
+* Compensates the latency between the state and its use, e.g. the end of the transmission.
+* The DCM rows are integrated with the angular velocity states in a single first order step
+* instead of a prediction; Not cached, and the filter state is not modified.
+*/
+HOT NONNULL
+void fusion_fetch_quaternion_extrapolated(register qf16 *RESTRICT const quat, register fix16_t deltaT);
+
+/*!
+* \brief Fetches the time of the current state.
+* \return The timestamp of the gyroscope measurement of the last update in microseconds, see {\ref fusion_set_gyroscope()}
+*/
+HOT LEAF
+uint32_t fusion_get_state_time();
+
+/*!
+* \brief Fetches the filtered angular velocity.
+* \param[out] rate The angular velocity in body coordinates in rad/s
+*
+* The rates are the (bias corrected) gyroscope states of the filter and cached until the next prediction or update.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_angular_rate(register v3d *RESTRICT const rate);
+
+/*!
+* \brief Fetches the gravity compensated acceleration.
+* \param[out] acceleration The linear acceleration in body coordinates in g
+*
+* The estimated gravity direction is subtracted from the last accelerometer reading;
+* The value is cached until the next prediction or update.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_linear_acceleration(register v3d *RESTRICT const acceleration);
+
 /*!
 * \brief Performs a prediction of the current Euler angles based on the time difference to the prediction or observation update call.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
 */
-void fusion_predict(register const fix16_t deltaT) HOT;
+void fusion_predict(register const fix16_t deltaT) HOT RAMFUNC;
 
 /*!
 * \brief Registers accelerometer measurements for the next update
 * \param[in] ax The x-axis accelerometer value.
 * \param[in] ay The y-axis accelerometer value.
 * \param[in] az The z-axis accelerometer value.
+* \param[in] timestamp The sample time in microseconds, see {\ref fusion_set_gyroscope()}
 */
-void fusion_set_accelerometer(register const fix16_t *const ax, register const fix16_t *const ay, register const fix16_t *const az) LEAF HOT NONNULL;
+void fusion_set_accelerometer(register const fix16_t *const ax, register const fix16_t *const ay, register const fix16_t *const az, register const uint32_t timestamp) LEAF HOT NONNULL;
 
 /*!
 * \brief Registers accelerometer measurements for the next update
 * \param[in] data The accelerometer data.
+* \param[in] timestamp The sample time in microseconds
 */
-STATIC_INLINE void fusion_set_accelerometer_v3d(register const v3d *const data)
+STATIC_INLINE void fusion_set_accelerometer_v3d(register const v3d *const data, register const uint32_t timestamp)
 {
-    fusion_set_accelerometer(&data->x, &data->y, &data->z);
+    fusion_set_accelerometer(&data->x, &data->y, &data->z, timestamp);
 }
 
 /*!
@@ -63,16 +214,21 @@ STATIC_INLINE void fusion_set_accelerometer_v3d(register const v3d *const data)
 * \param[in] gx The x-axis gyroscope value.
 * \param[in] gy The y-axis gyroscope value.
 * \param[in] gz The z-axis gyroscope value.
+* \param[in] timestamp The sample time in microseconds, on a free-running, wrapping clock
+*
+* The gyroscope timestamp is the time of the state after the next update; Magnetometer readings
+* taken at a different time are rotated to it, see {\ref FUSION_MAGNETOMETER_MAX_AGE}.
 */
-void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16_t *const gy, register const fix16_t *const gz) LEAF HOT NONNULL;
+void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16_t *const gy, register const fix16_t *const gz, register const uint32_t timestamp) LEAF HOT NONNULL;
 
 /*!
 * \brief Registers gyroscope measurements for the next update
 * \param[in] data The gyroscope data.
+* \param[in] timestamp The sample time in microseconds
 */
-STATIC_INLINE void fusion_set_gyroscope_v3d(register const v3d *const data)
+STATIC_INLINE void fusion_set_gyroscope_v3d(register const v3d *const data, register const uint32_t timestamp)
 {
-    fusion_set_gyroscope(&data->x, &data->y, &data->z);
+    fusion_set_gyroscope(&data->x, &data->y, &data->z, timestamp);
 }
 
 /*!
@@ -80,22 +236,75 @@ STATIC_INLINE void fusion_set_gyroscope_v3d(register const v3d *const data)
 * \param[in] mx The x-axis magnetometer value.
 * \param[in] my The y-axis magnetometer value.
 * \param[in] mz The z-axis magnetometer value.
+* \param[in] timestamp The sample time in microseconds, see {\ref fusion_set_gyroscope()}
 */
-void fusion_set_magnetometer(register const fix16_t *const mx, register const fix16_t *const my, register const fix16_t *const mz) LEAF HOT NONNULL;
+void fusion_set_magnetometer(register const fix16_t *const mx, register const fix16_t *const my, register const fix16_t *const mz, register const uint32_t timestamp) LEAF HOT NONNULL;
 
 /*!
 * \brief Registers magnetometer measurements for the next update
 * \param[in] data The magnetometer data.
+* \param[in] timestamp The sample time in microseconds
 */
-STATIC_INLINE void fusion_set_magnetometer_v3d(register const v3d *const data)
+STATIC_INLINE void fusion_set_magnetometer_v3d(register const v3d *const data, register const uint32_t timestamp)
 {
-    fusion_set_magnetometer(&data->x, &data->y, &data->z);
+    fusion_set_magnetometer(&data->x, &data->y, &data->z, timestamp);
 }
 
 /*!
 * \brief Updates the current prediction with the set measurements.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
 */
-void fusion_update(register const fix16_t deltaT) HOT;
+void fusion_update(register const fix16_t deltaT) HOT RAMFUNC;
+
+/*!
+* \def FUSION_SNAPSHOT_FILTERS Number of Kalman filters of the engine, see {\ref fusion_snapshot_t}
+*/
+/*!
+* \def FUSION_SNAPSHOT_STATES Number of states of each Kalman filter, see {\ref fusion_snapshot_t}
+*/
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+#define FUSION_SNAPSHOT_FILTERS     1
+#define FUSION_SNAPSHOT_STATES      9
+#else
+#define FUSION_SNAPSHOT_FILTERS     2
+#define FUSION_SNAPSHOT_STATES      6
+#endif
+
+/*!
+* \def FUSION_SNAPSHOT_COVARIANCE Number of entries of each packed covariance, see {\ref fusion_snapshot_t}
+*/
+#define FUSION_SNAPSHOT_COVARIANCE  ((FUSION_SNAPSHOT_STATES * (FUSION_SNAPSHOT_STATES + 1)) / 2)
+
+/*!
+* \brief The converged state of the sensor fusion, see {\ref fusion_checkpoint()}
+*
+* The tuning parameters and the process noise are not part of the snapshot.
+*/
+typedef struct {
+    int64_t complementary_integral[3];                                      //!< The integrated error of the complementary filter
+    v3d complementary_c3;                                                   //!< The attitude row of the complementary filter
+    v3d complementary_c2;                                                   //!< The orientation row of the complementary filter
+    fix16_t x[FUSION_SNAPSHOT_FILTERS][FUSION_SNAPSHOT_STATES];             //!< The Kalman state vectors
+    fix16_t P[FUSION_SNAPSHOT_FILTERS][FUSION_SNAPSHOT_COVARIANCE];         //!< The packed Kalman state covariances
+    uint32_t mode;                                                          //!< The {\ref fusion_mode_t}
+} fusion_snapshot_t;
+
+/*!
+* \brief Fetches the converged state, e.g. to keep it across a warm reset.
+* \param[out] snapshot The state
+* \return Zero on success, nonzero if the filters are not bootstrapped yet.
+*/
+COLD NONNULL
+uint8_t fusion_checkpoint(register fusion_snapshot_t *const snapshot);
+
+/*!
+* \brief Continues from a state fetched by {\ref fusion_checkpoint()} instead of bootstrapping.
+* \param[in] snapshot The state
+* \return Zero on success, nonzero if the snapshot is implausible; The fusion is then left as initialized.
+*
+* Must be called after {\ref fusion_initialize()}.
+*/
+COLD NONNULL
+uint8_t fusion_resume(register const fusion_snapshot_t *const snapshot);
 
 #endif // SENSOR_FUNCTION_H_
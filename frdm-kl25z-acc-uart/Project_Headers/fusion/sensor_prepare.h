@@ -10,6 +10,25 @@
 
 #include "fixvector3d.h"
 #include "compiler.h"
+#include "fusion/sensor_calibration.h"
+
+/*!
+* \brief Initializes the sensor data preparation by folding axis permutation, scaling, calibration and unit conversion.
+* \param[in] accelerometer_scaling The MPU6050 accelerometer scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 2g mode, ...
+* \param[in] gyroscope_scaling The MPU6050 gyroscope scaling factor, e.g. F16(131) for 250/s mode ...
+* \param[in] magnetometer_scaling The HMC5883L scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
+*
+* Must be called before any data is prepared and whenever a scaling factor changes.
+*/
+void sensor_prepare_initialize(const fix16_t accelerometer_scaling, const fix16_t gyroscope_scaling, const fix16_t magnetometer_scaling) COLD;
+
+/*!
+* \brief Initializes the MMA8451Q accelerometer data preparation by folding axis permutation, scaling and calibration.
+* \param[in] accelerometer_scaling The MMA8451Q scaling factor, e.g. F16(4096) for 2g mode in 14bit ...
+*
+* Must be called before any MMA8451Q data is prepared and whenever the scaling factor changes.
+*/
+void sensor_prepare_initialize_mma8451q(const fix16_t accelerometer_scaling) COLD;
 
 /*!
 * \brief Prepares MPU6050 accelerometer sensor data for fusion by converting and calibrating them.
@@ -17,19 +36,73 @@
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 4g mode, ...
 */
-void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Prepares MMA8451Q accelerometer sensor data for fusion by converting and calibrating them.
+* \param[out] out The prepared sensor data
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mma8451q_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Fuses the prepared MMA8451Q and MPU6050 accelerometer data, weighted by the inverse of their variances
+* \param[inout] acc The prepared MPU6050 data; Overwritten with the combined data.
+* \param[in] secondary The prepared MMA8451Q data, averaged over the batch
+* \param[in] count The number of MMA8451Q samples averaged; Must be positive.
+*
+* Averaging a batch of n samples divides the MMA8451Q variance by n, so larger batches weigh more.
+*/
+void sensor_prepare_combine_accelerometers(v3d *const acc, const v3d *const secondary, uint_fast8_t count) HOT NONNULL;
 
 /*!
 * \brief Prepares MPU6050 gyroscope sensor data for fusion by converting and calibrating them.
+* \param[out] out The prepared sensor data in rad/s
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief Prepares the accelerometer sensor data of a redundant MPU6050 for fusion by converting and calibrating them.
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
 * \param[out] out The prepared sensor data
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(131) for 250/s mode ...
+*
+* Uses the scaling factors of {\ref sensor_prepare_initialize()}, since all devices are configured alike.
+*/
+void sensor_prepare_redundant_mpu6050_accelerometer_data(uint_fast8_t device, v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Prepares the gyroscope sensor data of a redundant MPU6050 for fusion by converting and calibrating them.
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \param[out] out The prepared sensor data in rad/s
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_redundant_mpu6050_gyroscope_data(uint_fast8_t device, v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+#endif
+
+/*!
+* \brief Averages summed prepared sensor data
+* \param[inout] sum The sum of the prepared data; Overwritten with the average.
+* \param[in] count The number of summed vectors; Must be positive.
+*
+* Rounds to nearest. The variance of the average of n devices with independent noise is
+* that of one device divided by n; The fusion uses the calibrated variances as they are,
+* so they should describe the average.
 */
-void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_average(v3d *const sum, uint_fast8_t count) HOT NONNULL;
 
 /*!
 * \brief Prepares HMC5883L magnetometer sensor data for fusion by converting and calibrating them.
@@ -37,8 +110,14 @@ void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
 */
-void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Converts the MPU6050 temperature sensor output to degree Celsius.
+* \param[in] raw The sensor value
+* \return The temperature in degree Celsius
+*/
+fix16_t sensor_prepare_mpu6050_temperature(int16_t raw) CONST;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+* warm_restart.h
+*
+* Preservation of the converged sensor fusion across warm resets.
+* A CRC protected snapshot of the filter states, their covariances and the
+* learned gyroscope bias is checkpointed to the .noinit SRAM section, which the
+* startup code neither clears nor loads. After a watchdog, lockup, software or
+* brown-out reset the fusion resumes from the last checkpoint instead of
+* bootstrapping and converging from scratch. The SRAM content is undefined after
+* a power-on reset, which is therefore always a cold start.
+*
+*  Created on: Mar 13, 2014
+*      Author: Markus
+*/
+
+#ifndef WARM_RESTART_H_
+#define WARM_RESTART_H_
+
+#include <stdint.h>
+
+#include "compiler.h"
+
+/*!
+* \def WARM_RESTART_ENABLED Set to <code>1</code> to checkpoint the fusion and resume from it after a warm reset
+*/
+#ifndef WARM_RESTART_ENABLED
+#define WARM_RESTART_ENABLED            (1)
+#endif
+
+/*!
+* \def WARM_RESTART_VERSION The layout version of the snapshot block
+*
+* Must be increased whenever {\ref fusion_snapshot_t} or {\ref gyro_bias_snapshot_t} change,
+* so that a block left by the previous firmware is not misinterpreted after an update.
+*/
+#define WARM_RESTART_VERSION            (1)
+
+/*!
+* \def WARM_RESTART_CHECKPOINT_PERIOD The period in milliseconds at which the fusion is checkpointed
+*/
+#define WARM_RESTART_CHECKPOINT_PERIOD  (1000u) /* ms */
+
+/*!
+* \brief The result codes of the warm restart
+*/
+typedef enum {
+    WARM_RESTART_OK = 0,                //!< The fusion resumed from the snapshot
+    WARM_RESTART_COLD = 1,              //!< A power-on reset or no checkpoint was taken
+    WARM_RESTART_INVALID = 2,           //!< The snapshot has a different version or length, a CRC mismatch or invalid values
+} warm_restart_result_t;
+
+/*!
+* \brief Determines if the last reset was a warm reset with a valid snapshot.
+* \return {\ref WARM_RESTART_OK} if {\ref warm_restart_resume()} will resume
+*
+* Lets the startup skip delays that are only needed on a cold start.
+*/
+COLD
+warm_restart_result_t warm_restart_check();
+
+/*!
+* \brief Resumes the fusion and the gyroscope bias estimation from the snapshot after a warm reset.
+* \return {\ref WARM_RESTART_OK} if the snapshot was applied; The fusion bootstraps as usual otherwise.
+*
+* Must be called after {\ref fusion_initialize()} and {\ref gyro_bias_initialize()}.
+*/
+COLD
+warm_restart_result_t warm_restart_resume();
+
+/*!
+* \brief Takes a snapshot of the fusion and the gyroscope bias estimation.
+*
+* Invalidates the snapshot while the fusion is bootstrapping.
+*/
+COLD
+void warm_restart_checkpoint();
+
+/*!
+* \brief Invalidates the snapshot, e.g. when the fusion is restarted on purpose.
+*/
+COLD
+void warm_restart_invalidate();
+
+#endif // WARM_RESTART_H_
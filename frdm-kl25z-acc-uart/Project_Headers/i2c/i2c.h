@@ -17,12 +17,39 @@
 /**
  *  @brief According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). 
  *  Setting this define to a nonzero value activates the proposed workaround (temporarily disabling the multiplier).
+ *
+ *  Not required as long as {@see I2C_ApplyClock()} selects a divider without multiplier, so the workaround is disabled by default.
+ */
+#ifndef I2C_ENABLE_E6070_SPEEDHACK
+#define I2C_ENABLE_E6070_SPEEDHACK 	(0)
+#endif
+
+/**
+ * @brief The maximum SCL frequency supported by all slaves on the bus
  */
-#define I2C_ENABLE_E6070_SPEEDHACK 	(1)
+#define I2C_MAX_SCL_FREQUENCY		(400000u) /* Hz */
+
+/**
+ * @brief The time after which a single bus operation is considered stuck
+ *
+ * A byte takes 24 us at 375 kHz; The margin covers clock stretching by the slaves.
+ */
+#define I2C_TIMEOUT					(250u) /* us */
+
+/**
+ * @brief Error flag: A byte transfer did not complete within {@see I2C_TIMEOUT}
+ */
+#define I2C_ERROR_TIMEOUT			(0x01)
+
+/**
+ * @brief Error flag: The bus stayed busy for longer than {@see I2C_TIMEOUT}
+ */
+#define I2C_ERROR_BUS_BUSY			(0x02)
 
 #include "ARMCM0plus.h"
 #include "derivative.h"
 #include "nice_names.h"
+#include "cpu/timebase.h"
 
 #if I2C_USE_BME
 #include "bme.h"
@@ -48,15 +75,52 @@
  */
 #define I2C_MOD_NO_AND_MASK	(~0x0)
 
+/**
+ * @brief The sticky I2C_ERROR_* flags of the blocking operations since the last {@see I2C_FetchError()}
+ *
+ * Once set, the wait functions return immediately, so that a failed transaction
+ * runs to its end quickly; Its data must be discarded.
+ */
+extern uint8_t I2C_Error;
+
 /**
  * @brief Initializes the SPI interface
  */
 void I2C_Init();
 
 /**
- * @brief Resets the bus by toggling master mode if the bus is busy. This will interrupt ongoing traffic, so use with caution.
+ * @brief Selects the frequency divider for the current bus clock, see {@see Clock_SetLevel()}
+ *
+ * Writes the fastest divider within {@see I2C_MAX_SCL_FREQUENCY} without multiplier to the F register,
+ * so that repeated start conditions can be sent (erratum e6070). Must not be called while a transaction is running.
+ */
+void I2C_ApplyClock();
+
+/**
+ * @brief Recovers a stuck bus. This will interrupt ongoing traffic, so use with caution.
+ * @param[in] port The port of the I2C pins
+ * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] sclMux The I2C mux value for the SCL pin
+ * @param[in] sdaPin The number of the pin used for SDA
+ * @param[in] sdaMux The I2C mux value for the SDA pin
+ * @return Zero if SDA was released, nonzero if the bus is still stuck
+ *
+ * Switches the pins to GPIO, clocks SCL up to nine times until a slave holding SDA low
+ * lets go, creates a stop condition and hands the pins back to the I2C module.
+ * Takes about 100 us; Also clears {@see I2C_Error}.
  */
-void I2C_ResetBus();
+uint8_t I2C_ResetBus(PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux);
+
+/**
+ * @brief Fetches and clears the error flags of the blocking operations
+ * @return The I2C_ERROR_* flags, zero if all operations succeeded
+ */
+__STATIC_INLINE uint8_t I2C_FetchError()
+{
+	register const uint8_t error = I2C_Error;
+	I2C_Error = 0;
+	return error;
+}
 
 /**
  * @brief Reads an 8-bit register from an I2C slave 
@@ -97,10 +161,27 @@ uint8_t I2C_ModifyRegister(register uint8_t slaveId, uint8_t register registerAd
 
 /**
  * @brief Waits for an I2C bus operation to complete
+ *
+ * Gives up after {@see I2C_TIMEOUT} and sets {@see I2C_ERROR_TIMEOUT}.
  */
 __STATIC_INLINE void I2C_Wait()
 {
-	while((I2C0->S & I2C_S_IICIF_MASK)==0) {}	/* loop until interrupt is detected */
+	/* a previous operation of the transaction failed already */
+	if (I2C_Error) return;
+	
+	/* loop until interrupt is detected */
+	if ((I2C0->S & I2C_S_IICIF_MASK)==0)
+	{
+		register const uint32_t start = Timebase_Microseconds();
+		while((I2C0->S & I2C_S_IICIF_MASK)==0)
+		{
+			if ((Timebase_Microseconds() - start) > I2C_TIMEOUT)
+			{
+				I2C_Error |= I2C_ERROR_TIMEOUT;
+				return;
+			}
+		}
+	}
 	
 #if !I2C_USE_BME
 	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
@@ -111,10 +192,25 @@ __STATIC_INLINE void I2C_Wait()
 
 /**
  * @brief Waits for an I2C bus operation to complete
+ *
+ * Gives up after {@see I2C_TIMEOUT} and sets {@see I2C_ERROR_BUS_BUSY}.
  */
 __STATIC_INLINE void I2C_WaitWhileBusy()
 {
-	while((I2C0->S & I2C_S_BUSY_MASK)!=0) {}
+	if (I2C_Error) return;
+	
+	if ((I2C0->S & I2C_S_BUSY_MASK)!=0)
+	{
+		register const uint32_t start = Timebase_Microseconds();
+		while((I2C0->S & I2C_S_BUSY_MASK)!=0)
+		{
+			if ((Timebase_Microseconds() - start) > I2C_TIMEOUT)
+			{
+				I2C_Error |= I2C_ERROR_BUS_BUSY;
+				return;
+			}
+		}
+	}
 }
 
 
@@ -225,6 +321,7 @@ __STATIC_INLINE void I2C_EnterReceiveModeWithoutAck()
  */
 __STATIC_INLINE void I2C_SendRepeatedStart()
 {
+	/* erratum e6070: the multiplier must be off, as selected by I2C_ApplyClock() */
 #if I2C_ENABLE_E6070_SPEEDHACK
 	register uint8_t reg = I2C0->F;
 	I2C0->F = reg & ~I2C_F_MULT_MASK; /* NOTE: According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). A solution is to temporarily disable the multiplier. */
@@ -358,6 +455,22 @@ __STATIC_INLINE void I2C_ReceiverModeDriveClock()
 	I2C_Wait();
 }
 
+/**
+ * @brief Reads a status register and, if it matches, a block of data registers in the same bus session.
+ * @param[in] slaveId The slave device ID
+ * @param[in] statusRegisterAddress The status register address
+ * @param[in] statusMask The status bits to check
+ * @param[in] statusExpected The expected value of the masked status bits
+ * @param[in] startRegisterAddress The first data register address
+ * @param[in] registerCount The number of data registers to read; Must be greater than or equal to two.
+ * @param[out] buffer The buffer to write into; Unchanged if the status does not match.
+ * @return The status register value
+ *
+ * The data is addressed with a repeated start after the status byte, so the bus is kept
+ * between both reads and no other master or slave access can interleave.
+ */
+uint8_t I2C_ReadStatusAndRegisters(register uint8_t slaveId, register uint8_t statusRegisterAddress, register uint8_t statusMask, register uint8_t statusExpected, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer);
+
 /**
  * @brief Initiates a register read after the module was brought into TX mode.
  * @param[in] slaveId The slave id
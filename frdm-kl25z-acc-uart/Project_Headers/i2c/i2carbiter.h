@@ -13,6 +13,16 @@
 
 #include "derivative.h"
 
+/**
+ * @brief Handle of an I2C arbiter entry, the index into the entries passed to {@see I2CArbiter_Configure()}
+ */
+typedef uint8_t i2carbiter_handle_t;
+
+/**
+ * @brief The handle returned for unknown slaves
+ */
+#define I2CARBITER_INVALID_HANDLE	(0xFF)
+
 /**
  * @brief Data structure for the I2C arbiter
  */
@@ -24,6 +34,7 @@ typedef struct {
 	const uint32_t sclPin;			/*< The pin used to drive SCL */
 	const uint8_t sdaMux;			/*< The mux value for the SDA pin */
 	const uint8_t sclMux;			/*< The mux value for the SCL pin */
+	uint8_t group;					/*< Index of the first entry with the same pins; Entries of a group share their mux setup */
 } i2carbiter_entry_t;
 
 /**
@@ -44,6 +55,25 @@ void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress,  P
  */
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount);
 
+/**
+ * @brief Looks up the handle of an I2C slave.
+ * @param[in] slaveAddress The slave address
+ * @return The handle or {@see I2CARBITER_INVALID_HANDLE} if the slave is unknown
+ *
+ * Scans the entries; Intended to be called once, with the handle kept for {@see I2CArbiter_SelectHandle()}.
+ */
+i2carbiter_handle_t I2CArbiter_Lookup(uint8_t slaveAddress);
+
+/**
+ * @brief Selects an I2C slave by handle and prepares the ports.
+ * @param[in] handle The handle
+ * @return Zero if successful, nonzero otherwise
+ *
+ * Does not access the ports if the slave shares its pins with the current one,
+ * and uses bit field insertion through the BME otherwise.
+ */
+uint8_t I2CArbiter_SelectHandle(i2carbiter_handle_t handle);
+
 /**
  * @brief Selects an I2C slave and prepares the ports.
  * @param[in] slaveAddress The slave address
@@ -51,4 +81,10 @@ void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount);
  */
 uint8_t I2CArbiter_Select(uint8_t slaveAddress);
 
+/**
+ * @brief Recovers the bus of the selected slave.
+ * @return Zero if the bus was released, nonzero if it is still stuck or no slave is selected
+ */
+uint8_t I2CArbiter_ResetBus();
+
 #endif /* I2CARBITER_H_ */
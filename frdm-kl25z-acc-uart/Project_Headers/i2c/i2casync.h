@@ -0,0 +1,273 @@
+/*
+ * i2casync.h
+ *
+ * Interrupt driven, non-blocking register burst reads on I2C0.
+ * Transactions are queued and processed by the I2C0 IRQ handler, so that
+ * the bus transfer overlaps with whatever the main loop does meanwhile.
+ *
+ *  Created on: Mar 2, 2014
+ *      Author: Markus
+ */
+
+#ifndef I2CASYNC_H_
+#define I2CASYNC_H_
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+#include "nice_names.h"
+#include "cpu/timebase.h"
+
+/**
+ * @brief Enables or disables DMA driven reception of the data bytes.
+ *
+ * If enabled, the CPU only handles the address phase and the final NACK/STOP;
+ * all other bytes are moved by DMA channel {@see DMA_CHANNEL_I2C0}.
+ */
+#define I2CASYNC_USE_DMA			(1)
+
+/**
+ * @brief Minimum number of registers for a read to use DMA; The last two bytes are always read by the CPU.
+ */
+#define I2CASYNC_DMA_THRESHOLD		(3)
+
+/**
+ * @brief The IRQ number (not exception number!) for I2C0 interrupt
+ */
+#define I2C0_IRQ					(8)
+
+/**
+ * @brief Number of transactions that can be pending at once; Must be a power of two.
+ */
+#define I2CASYNC_QUEUE_SIZE			(4)
+
+/**
+ * @brief The time after which a wait for a transaction gives up and aborts the engine
+ *
+ * Covers a full queue of sensor burst reads at 375 kHz plus clock stretching.
+ */
+#define I2CASYNC_WAIT_TIMEOUT		(2000u) /* us */
+
+/**
+ * @brief Transaction status: Transaction completed successfully
+ */
+#define I2CASYNC_SUCCESS			(0x00)
+
+/**
+ * @brief Transaction status: The slave did not acknowledge an address or register byte
+ */
+#define I2CASYNC_NACK				(0x01)
+
+/**
+ * @brief Transaction status: Bus arbitration was lost
+ */
+#define I2CASYNC_ARBITRATION_LOST	(0x02)
+
+/**
+ * @brief Transaction status: The transaction queue was full, transaction was not queued
+ */
+#define I2CASYNC_QUEUE_FULL			(0x03)
+
+/**
+ * @brief Transaction status: The DMA transfer failed
+ */
+#define I2CASYNC_DMA_ERROR			(0x04)
+
+/**
+ * @brief Transaction status: The transaction did not complete in time, or the bus stayed busy before its start
+ */
+#define I2CASYNC_TIMEOUT			(0x05)
+
+/**
+ * @brief Transaction status: The transaction was still queued when the engine was aborted; The bus is not at fault.
+ */
+#define I2CASYNC_ABORTED			(0x06)
+
+/**
+ * @brief Transaction status: Transaction is queued or in progress
+ */
+#define I2CASYNC_PENDING			(0xFF)
+
+struct i2casync_transaction_t;
+
+/**
+ * @brief Completion callback; Called from within the I2C0 IRQ handler.
+ * @param[in] transaction The transaction that completed
+ */
+typedef void (*i2casync_callback_t)(struct i2casync_transaction_t *const transaction);
+
+/**
+ * @brief An asynchronous register burst read, optionally preceded by a status register check
+ */
+typedef struct i2casync_transaction_t {
+	uint8_t slaveId;					/*< The 7-bit slave address */
+	uint8_t arbiterHandle;				/*< The {@see i2carbiter_handle_t} of the slave, resolved when the transaction is prepared */
+	uint8_t registerAddress;			/*< The first register address */
+	uint8_t registerCount;				/*< The number of registers to read; Must be larger than zero. */
+	uint8_t statusRegisterAddress;		/*< The status register read ahead of the data, see {@see I2CAsync_PrepareStatusReadHandle()} */
+	uint8_t statusMask;					/*< The status bits to check; Zero for a plain burst read. */
+	uint8_t statusExpected;				/*< The expected value of the masked status bits */
+	uint8_t statusRegister;				/*< The status register read by the transaction */
+	uint8_t *buffer;					/*< The buffer to write into */
+	i2casync_callback_t callback;		/*< Optional completion callback, may be NULL */
+	void *context;						/*< User data for the callback */
+	volatile uint8_t status;			/*< The transaction status, {@see I2CASYNC_PENDING} while in flight */
+} i2casync_transaction_t;
+
+/**
+ * @brief Initializes the asynchronous I2C engine and enables the I2C0 IRQ.
+ *
+ * The I2C module must have been initialized using {@see I2C_Init()} beforehand.
+ */
+void I2CAsync_Init();
+
+/**
+ * @brief Prepares a register burst read transaction
+ * @param[inout] transaction The transaction
+ * @param[in] slaveId The slave device ID
+ * @param[in] startRegisterAddress The first register address
+ * @param[in] registerCount The number of registers to read; Must be larger than zero.
+ * @param[out] buffer The buffer to write into
+ * @param[in] callback Optional completion callback, may be NULL
+ * @param[in] context User data for the callback
+ */
+void I2CAsync_PrepareRead(i2casync_transaction_t *const transaction, register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context);
+
+/**
+ * @brief Prepares a register burst read transaction on the pins of a given I2C arbiter entry
+ * @param[inout] transaction The transaction
+ * @param[in] arbiterHandle The {@see i2carbiter_handle_t} of the slave; {@see I2CARBITER_INVALID_HANDLE} looks it up by the slave ID.
+ * @param[in] slaveId The slave device ID
+ * @param[in] startRegisterAddress The first register address
+ * @param[in] registerCount The number of registers to read; Must be larger than zero.
+ * @param[out] buffer The buffer to write into
+ * @param[in] callback Optional completion callback, may be NULL
+ * @param[in] context User data for the callback
+ *
+ * Tells apart slaves of the same address on different pins, which {@see I2CAsync_PrepareRead()} cannot.
+ */
+void I2CAsync_PrepareReadHandle(i2casync_transaction_t *const transaction, register uint8_t arbiterHandle, register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context);
+
+/**
+ * @brief Prepares a status register read that is followed by a register burst read if the status matches
+ * @param[inout] transaction The transaction
+ * @param[in] arbiterHandle The {@see i2carbiter_handle_t} of the slave; {@see I2CARBITER_INVALID_HANDLE} looks it up by the slave ID.
+ * @param[in] slaveId The slave device ID
+ * @param[in] statusRegisterAddress The status register address
+ * @param[in] statusMask The status bits to check; Must be nonzero.
+ * @param[in] statusExpected The expected value of the masked status bits
+ * @param[in] startRegisterAddress The first data register address
+ * @param[in] registerCount The number of data registers to read; Must be larger than zero.
+ * @param[out] buffer The buffer to write into; Unchanged if the status does not match.
+ * @param[in] callback Optional completion callback, may be NULL
+ * @param[in] context User data for the callback
+ *
+ * The asynchronous counterpart of {@see I2C_ReadStatusAndRegisters()}: The data registers are addressed
+ * with a repeated start after the status byte, so both are read in a single bus session.
+ * The transaction succeeds either way; The status is stored in the statusRegister field.
+ */
+void I2CAsync_PrepareStatusReadHandle(i2casync_transaction_t *const transaction, register uint8_t arbiterHandle, register uint8_t slaveId, register uint8_t statusRegisterAddress, register uint8_t statusMask, register uint8_t statusExpected, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context);
+
+/**
+ * @brief Determines if the status read by a transaction matched, i.e. if its buffer was filled
+ * @param[in] transaction The completed transaction
+ * @return Nonzero if the masked status matched the expected value, zero otherwise
+ */
+__STATIC_INLINE uint8_t I2CAsync_StatusMatched(const i2casync_transaction_t *const transaction)
+{
+	return (transaction->statusRegister & transaction->statusMask) == transaction->statusExpected;
+}
+
+/**
+ * @brief Queues a register burst read and returns immediately.
+ * @param[inout] transaction The transaction; Must stay valid until completion.
+ * @return {@see I2CASYNC_SUCCESS} if queued, {@see I2CASYNC_QUEUE_FULL} otherwise
+ *
+ * The I2C arbiter is asked to select the slave when the transaction starts.
+ * Blocking I2C functions must not be used while the engine is busy,
+ * use {@see I2CAsync_WaitWhileBusy()} before. May be called from interrupt handlers;
+ * An idle engine is started from the I2C0 IRQ, which is pended for that purpose.
+ */
+uint8_t I2CAsync_Submit(i2casync_transaction_t *const transaction);
+
+/**
+ * @brief Determines if the engine has no queued or running transactions
+ * @return Nonzero if idle, zero otherwise
+ */
+uint8_t I2CAsync_Idle();
+
+/**
+ * @brief Aborts the running and all queued transactions and stops the bus.
+ *
+ * The running transaction completes with {@see I2CASYNC_TIMEOUT}, the queued ones with
+ * {@see I2CASYNC_ABORTED}; Callbacks are not called. Does not recover a stuck bus,
+ * see {@see I2C_ResetBus()}.
+ */
+void I2CAsync_Abort();
+
+/**
+ * @brief Determines if a transaction has completed (successful or not)
+ * @param[in] transaction The transaction
+ * @return Nonzero if completed, zero otherwise
+ */
+__STATIC_INLINE uint8_t I2CAsync_Completed(const i2casync_transaction_t *const transaction)
+{
+	return transaction->status != I2CASYNC_PENDING;
+}
+
+/**
+ * @brief Waits for a transaction to complete
+ * @param[in] transaction The transaction
+ * @return The transaction status
+ *
+ * Aborts the engine after {@see I2CASYNC_WAIT_TIMEOUT}, in which case the status is
+ * {@see I2CASYNC_TIMEOUT} or {@see I2CASYNC_ABORTED}.
+ */
+__STATIC_INLINE uint8_t I2CAsync_WaitFor(const i2casync_transaction_t *const transaction)
+{
+	if (!I2CAsync_Completed(transaction))
+	{
+		register const uint32_t start = Timebase_Microseconds();
+		while (!I2CAsync_Completed(transaction))
+		{
+			if ((Timebase_Microseconds() - start) > I2CASYNC_WAIT_TIMEOUT)
+			{
+				I2CAsync_Abort();
+				break;
+			}
+			
+			/* sleep until the next interrupt (I2C, DMA or at the latest the SysTick) */
+			__disable_irq();
+			if (!I2CAsync_Completed(transaction)) __WFI();
+			__enable_irq();
+		}
+	}
+	return transaction->status;
+}
+
+/**
+ * @brief Waits until all queued transactions have completed
+ *
+ * Aborts the engine after {@see I2CASYNC_WAIT_TIMEOUT}.
+ */
+__STATIC_INLINE void I2CAsync_WaitWhileBusy()
+{
+	if (!I2CAsync_Idle())
+	{
+		register const uint32_t start = Timebase_Microseconds();
+		while (!I2CAsync_Idle())
+		{
+			if ((Timebase_Microseconds() - start) > I2CASYNC_WAIT_TIMEOUT)
+			{
+				I2CAsync_Abort();
+				break;
+			}
+			
+			/* sleep until the next interrupt (I2C, DMA or at the latest the SysTick) */
+			__disable_irq();
+			if (!I2CAsync_Idle()) __WFI();
+			__enable_irq();
+		}
+	}
+}
+
+#endif /* I2CASYNC_H_ */
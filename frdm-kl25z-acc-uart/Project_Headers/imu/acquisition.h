@@ -0,0 +1,106 @@
+/*
+ * acquisition.h
+ *
+ * Sample acquisition from the interrupt handlers. The data ready interrupt
+ * submits the sensor read to the asynchronous I2C engine, whose completion
+ * decodes it and pushes a timestamped {@see sensor_sample_t} into a lock-free
+ * single-producer single-consumer queue; The main loop drains the queue in batches.
+ * Only reads that the sensor status reports a new sample for are queued, and the
+ * sequence numbers of samples dropped on a full queue are skipped.
+ *
+ * The producers are the completion callbacks, which run in the I2C0 and DMA0
+ * handlers or, for a read failing on a held bus, inside {@see I2CAsync_Submit()}
+ * with interrupts disabled; Either way they never preempt each other.
+ * The consumer is the main loop. The data ready handler runs at a higher
+ * priority (see cpu/irq.h) and leaves a read alone until its callback returned.
+ *
+ *  Created on: Mar 11, 2014
+ *      Author: Markus
+ */
+
+#ifndef ACQUISITION_H_
+#define ACQUISITION_H_
+
+#include <stdint.h>
+#include "i2c/i2carbiter.h"
+#include "imu/sensor_sample.h"
+
+/**
+ * @brief Number of samples the queue holds; Must be a power of two.
+ */
+#define ACQUISITION_QUEUE_SIZE		(16)
+
+/**
+ * @brief The acquisition counters
+ */
+typedef struct {
+	uint16_t overruns;					/*< Data ready interrupts that arrived while the previous read was still pending */
+	uint16_t dropped;					/*< Samples dropped because the queue was full */
+	uint16_t errors;					/*< Failed reads */
+	uint8_t peak;						/*< The highest number of queued samples */
+} acquisition_statistics_t;
+
+/**
+ * @brief Prepares the sensor reads; The acquisition starts suspended.
+ * @param[in] mpu6050Handle The I2C arbiter handle of the MPU6050
+ * @param[in] hmc5883lHandle The I2C arbiter handle of the HMC5883L
+ * @param[in] auxiliaryCount The number of HMC5883L bytes read along with the MPU6050 data
+ * 			  through its auxiliary bus, the status register followed by the data output registers;
+ * 			  Zero if the HMC5883L is read directly.
+ *
+ * Must be called after {@see I2CAsync_Init()}. The first {@see Acquisition_Resume()}
+ * reads the MPU6050 once, so that a data ready edge missed before does not stall it.
+ */
+void Acquisition_Init(i2carbiter_handle_t mpu6050Handle, i2carbiter_handle_t hmc5883lHandle, uint8_t auxiliaryCount);
+
+/**
+ * @brief Submits the MPU6050 read; To be called from the data ready interrupt handler.
+ * @param[in] timestamp The time of the data ready interrupt
+ */
+void Acquisition_MPU6050Ready(uint32_t timestamp);
+
+/**
+ * @brief Submits the HMC5883L read, from its data ready interrupt handler or the main loop
+ * @param[in] timestamp The time of the sample
+ *
+ * Reads the status register and, only if it reports a new sample, the data in the same bus session.
+ * Only one of the two may call it. Ignored while suspended.
+ */
+void Acquisition_ReadHMC5883L(uint32_t timestamp);
+
+/**
+ * @brief Fetches the oldest sample from the queue
+ * @param[out] sample The sample
+ * @return Nonzero if a sample was fetched, zero if the queue is empty
+ */
+uint8_t Acquisition_Fetch(sensor_sample_t *const sample);
+
+/**
+ * @brief Fetches and clears the failure of a read
+ * @return The I2C arbiter handle of the failed device or {@see I2CARBITER_INVALID_HANDLE}
+ *
+ * The bus is not recovered from within the handlers; The caller does it while suspended.
+ * The MPU6050 read is repeated on resume, since its latched interrupt stays asserted.
+ */
+i2carbiter_handle_t Acquisition_FetchFailure();
+
+/**
+ * @brief Stops submitting reads and waits for the pending ones to complete
+ *
+ * Required before blocking I2C functions are used. Calls nest; A data ready
+ * interrupt arriving meanwhile is served by the matching {@see Acquisition_Resume()}.
+ */
+void Acquisition_Suspend();
+
+/**
+ * @brief Resumes submitting reads after {@see Acquisition_Suspend()}
+ */
+void Acquisition_Resume();
+
+/**
+ * @brief Fetches and resets the acquisition counters
+ * @param[out] statistics The counters accumulated since the last fetch
+ */
+void Acquisition_FetchStatistics(acquisition_statistics_t *const statistics);
+
+#endif /* ACQUISITION_H_ */
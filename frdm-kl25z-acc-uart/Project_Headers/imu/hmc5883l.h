@@ -10,6 +10,7 @@
 
 #include "derivative.h"
 #include "nice_names.h"
+#include "i2c/i2casync.h"
 
 /**
  * @brief I2C slave address of the HMC5883L magnetometer
@@ -158,6 +159,14 @@ void HMC5883L_SetAveraging(hmc5883l_confreg_t *const configuration, register hmc
  */
 void HMC5883L_SetOutputRate(hmc5883l_confreg_t *const configuration, register hmc5883l_do_t rate);
 
+/**
+ * Writes the output rate directly to the device
+ * @param[in] rate The output rate
+ *
+ * Blocking; Only the DO bits are modified. Check {@see I2C_FetchError()} for the outcome.
+ */
+void HMC5883L_WriteOutputRate(register hmc5883l_do_t rate);
+
 /**
  * Sets the measurement mode
  * @param[inout] configuration The configuration
@@ -182,10 +191,60 @@ void HMC5883L_SetOperatingMode(hmc5883l_confreg_t *const configuration, register
 
 /**
  * @brief Fetches the data from the HMC5883L
- * @param[inout] data The sensor data
+ * @param[inout] data The sensor data; The values are only updated if the status reports ready and unlocked data.
+ *
+ * The status and data registers are read in a single bus session, see {@see I2C_ReadStatusAndRegisters()}.
  */
 void HMC5883L_ReadData(hmc5883l_data_t *const data);
 
+/**
+ * @brief Number of data output registers (X, Z and Y, MSB first)
+ */
+#define HMC5883L_DATA_REGISTER_COUNT	(6)
+
+/**
+ * @brief Prepares an asynchronous read of the status register and, if it reports a new sample, the data output registers
+ * @param[inout] transaction The transaction to prepare
+ * @param[in] arbiterHandle The {@see i2carbiter_handle_t} of the HMC5883L; {@see I2CARBITER_INVALID_HANDLE} looks it up by its address.
+ * @param[out] buffer The raw register buffer of {@see HMC5883L_DATA_REGISTER_COUNT} bytes; Must stay valid until completion.
+ * @param[in] callback Optional completion callback, may be NULL
+ * @param[in] context User data for the callback
+ *
+ * Both are read in a single bus session, see {@see I2CAsync_PrepareStatusReadHandle()}. Once the transaction
+ * completed, the buffer holds a new sample if {@see HMC5883L_DataReady()} holds for its statusRegister field;
+ * Use {@see HMC5883L_DecodeData()} to convert it.
+ */
+void HMC5883L_PrepareReadDataAsync(i2casync_transaction_t *const transaction, uint8_t arbiterHandle, uint8_t *const buffer, i2casync_callback_t callback, void *const context);
+
+/**
+ * @brief Queues an asynchronous read of the status register and, if it reports a new sample, the data output registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer of {@see HMC5883L_DATA_REGISTER_COUNT} bytes; Must stay valid until completion.
+ * @return Zero if queued, nonzero otherwise
+ *
+ * See {@see HMC5883L_PrepareReadDataAsync()}.
+ */
+uint8_t HMC5883L_ReadDataAsync(i2casync_transaction_t *const transaction, uint8_t *const buffer);
+
+/**
+ * @brief Determines if the status register reports a new sample
+ * @param[in] status The status register contents
+ * @return Nonzero if the data registers hold a complete sample that was not read yet
+ *
+ * RDY is cleared once the data registers were read out; LOCK is set while they are only partially read.
+ */
+static inline uint8_t HMC5883L_DataReady(uint8_t status)
+{
+	return (status & (HMC5883L_SR_LOCK_MASK | HMC5883L_SR_RDY_MASK)) == HMC5883L_SR_RDY_MASK;
+}
+
+/**
+ * @brief Decodes the raw data output registers
+ * @param[in] buffer The raw register contents of {@see HMC5883L_DATA_REGISTER_COUNT} bytes
+ * @param[inout] data The sensor data
+ */
+void HMC5883L_DecodeData(const uint8_t *const buffer, hmc5883l_data_t *const data);
+
 
 /**
 * @brief Prepares a data buffer by clearing its values.
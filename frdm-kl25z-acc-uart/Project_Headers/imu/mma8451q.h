@@ -25,7 +25,13 @@
 #define MMA8451Q_STATUS_Y(status)		(status & 0b00000010)	/*< Y data ready */
 #define MMA8451Q_STATUS_ZDR(status)		(status & 0b00000001)	/*< Z data ready */
 
+#define MMA8451Q_F_STATUS_OVF(status)	(status & 0b10000000)	/*< FIFO overflow, oldest samples were dropped */
+#define MMA8451Q_F_STATUS_WMRK(status)	(status & 0b01000000)	/*< FIFO watermark reached */
+#define MMA8451Q_F_STATUS_COUNT(status)	(status & 0b00111111)	/*< Number of samples in the FIFO */
+
 #define MMA8451Q_REG_STATUS				(0x00)	/*< STATUS register */
+#define MMA8451Q_REG_F_STATUS			(0x00)	/*< F_STATUS register, replaces STATUS if the FIFO is enabled */
+#define MMA8451Q_REG_OUT_X_MSB			(0x01)	/*< OUT_X_MSB register, start of the data registers and FIFO read pointer */
 #define MMA8451Q_REG_F_SETUP			(0x09)	/*< F_SETUP register */
 #define MMA8451Q_REG_SYSMOD				(0x0B)	/*< SYSMOD register for system mode identification */
 #define MMA8451Q_REG_PL_CFG				(0x11)	/*< PL_CFG register for portrait/landscape detection configuration */
@@ -91,6 +97,21 @@ typedef enum {
 	MMA8451Q_OVERSAMPLING_LOWPOWER			= (0b11),		/*< Low Power */
 } mma8451q_oversampling_t;
 
+/**
+ * @brief FIFO buffer mode
+ */
+typedef enum {
+	MMA8451Q_FIFOMODE_DISABLED	= (0b00),	/*< FIFO is disabled */
+	MMA8451Q_FIFOMODE_CIRCULAR	= (0b01),	/*< FIFO holds the most recent samples, the oldest are dropped on overflow */
+	MMA8451Q_FIFOMODE_FILL		= (0b10),	/*< FIFO stops accepting samples on overflow */
+	MMA8451Q_FIFOMODE_TRIGGER	= (0b11)	/*< FIFO holds the samples around a trigger event */
+} mma8451q_fifomode_t;
+
+/**
+ * @brief Number of samples the FIFO holds
+ */
+#define MMA8451Q_FIFO_SIZE	(32)
+
 /**
  * @brief Interrupt pad mode
  */
@@ -227,6 +248,18 @@ static inline void MMA8451Q_InitializeData(mma8451q_acc_t *const data)
  */
 void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data);
 
+/**
+ * @brief Drains the accelerometer samples from the FIFO in one burst read
+ * @param[out] samples The samples, oldest first; Must not be null.
+ * @param[in] max The maximum number of samples to read; At most {@see MMA8451Q_FIFO_SIZE} are read.
+ * @return The number of samples read
+ *
+ * Requires the FIFO to be enabled and fast read mode to be disabled, so that 
+ * the read pointer wraps from OUT_Z_LSB to OUT_X_MSB and pops one sample per
+ * six bytes read. Samples left in the FIFO are read on the next call.
+ */
+uint8_t MMA8451Q_ReadFifo(mma8451q_acc_t *const samples, uint8_t max);
+
 /**
  * @brief Reads the STATUS register from the MMA8451Q.
  * @return Status bits, see MMA8451Q_STATUS_XXXX defines. 
@@ -320,6 +353,16 @@ void MMA8451Q_ConfigureInterrupt(mma8451q_confreg_t *const configuration, mma845
  */
 void MMA8451Q_ClearInterruptConfiguration(mma8451q_confreg_t *const configuration);
 
+/**
+ * @brief Configures the FIFO buffer
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] mode The FIFO mode
+ * @param[in] watermark The number of samples that set the watermark flag and raise the {@see MMA8451Q_INT_FIFO} interrupt; 1..32, or 0 to disable the watermark.
+ *
+ * The FIFO mode can only be changed in passive mode.
+ */
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark);
+
 /**
  * @brief Configures the oversampling modes
  * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
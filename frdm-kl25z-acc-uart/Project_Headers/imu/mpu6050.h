@@ -10,8 +10,10 @@
 #ifndef MPU6050_H_
 #define MPU6050_H_
 
+#include <stddef.h>
 #include "derivative.h"
 #include "nice_names.h"
+#include "i2c/i2casync.h"
 
 /**
  * @brief AD0 bit of the I2C slave address of the MPU6050 IMU
@@ -23,6 +25,11 @@
  */
 #define MPU6050_I2CADDR	(0b1101000 | MPU6050_I2CADDR_AD0)
 
+/**
+ * @brief I2C slave address of an MPU6050 with its AD0 pin at the other level, for a second device on the same pins
+ */
+#define MPU6050_I2CADDR_ALT	(0b1101000 | (MPU6050_I2CADDR_AD0 ^ 0b1))
+
 /**
  * @brief Marker for registers not defined in MPU6000/MPU6050 Register Map document revision 4.0 and 4.3
  * 
@@ -266,6 +273,12 @@ typedef struct __attribute__ ((__packed__))
 	uint8_t GYRO_ZOUT_L; 		/* 0x48 */
 } mpu6050_intdatareg_t;
 
+/**
+ * @brief The data ready flag of the INT_STATUS register; Latched until the register is read.
+ */
+#define MPU6050_INT_STATUS_DATA_RDY_INT_MASK 	(0b00000001)
+#define MPU6050_INT_STATUS_DATA_RDY_INT_SHIFT 	(0)
+
 /**
  * @brief MPU6050 internal and external sensor data registers
  */
@@ -304,6 +317,16 @@ typedef struct __attribute__ ((__packed__))
  */
 #define MPU6050_CONFIGURE_DIRECT ((mpu6050_confreg_t*)0x0)
 
+/**
+ * @brief Selects the MPU6050 the driver talks to
+ * @param[in] slaveAddress The 7-bit slave address, {@see MPU6050_I2CADDR} or {@see MPU6050_I2CADDR_ALT}
+ * @param[in] arbiterHandle The I2C arbiter handle of the device; {@see I2CARBITER_INVALID_HANDLE} looks it up by the address.
+ *
+ * Defaults to {@see MPU6050_I2CADDR}. Does not switch the pins, so that it can be called while
+ * asynchronous reads are in flight; Blocking calls need {@see I2CArbiter_SelectHandle()} as well.
+ */
+void MPU6050_Select(uint8_t slaveAddress, uint8_t arbiterHandle);
+
 /**
  * @brief Reads the WHO_AM_I register from the MPU6050.
  * @return Device identification code; Should be 0b0110100 (0x68)
@@ -331,6 +354,42 @@ void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration);
  */
 void MPU6050_SetGyroscopeSampleRateDivider(mpu6050_confreg_t *const configuration, uint8_t divider);
 
+/**
+ * @brief Digital low pass filter configuration
+ *
+ * With the filter enabled, the gyroscope output rate drops from 8 kHz to 1 kHz.
+ */
+typedef enum {
+	MPU6050_DLPF_260 = (0b000),	/*! accelerometer 260 Hz, gyroscope 256 Hz, 8 kHz gyroscope output rate */
+	MPU6050_DLPF_188 = (0b001),	/*! accelerometer 184 Hz, gyroscope 188 Hz */
+	MPU6050_DLPF_98  = (0b010),	/*! accelerometer 94 Hz, gyroscope 98 Hz */
+	MPU6050_DLPF_42  = (0b011),	/*! accelerometer 44 Hz, gyroscope 42 Hz */
+	MPU6050_DLPF_20  = (0b100),	/*! accelerometer 21 Hz, gyroscope 20 Hz */
+	MPU6050_DLPF_10  = (0b101),	/*! 10 Hz */
+	MPU6050_DLPF_5   = (0b110)	/*! 5 Hz */
+} mpu6050_dlpf_t;
+
+/*!
+* \def MPU6050_GYRO_OUTPUT_RATE Returns the gyroscope output rate in Hz the sample rate divider applies to for a given {\ref mpu6050_dlpf_t} value
+*/
+#define MPU6050_GYRO_OUTPUT_RATE(x) (((x) == MPU6050_DLPF_260) ? 8000 : 1000)
+
+/**
+ * @brief Configures the digital low pass filter
+ * @param[inout] configuration The configuration structure
+ * @param[in] filter The filter bandwidth
+ */
+void MPU6050_SetDigitalLowPass(mpu6050_confreg_t *const configuration, mpu6050_dlpf_t filter);
+
+/**
+ * @brief Writes the sample rate divider and the digital low pass filter directly to the device
+ * @param[in] divider The divider in a range of 1..255, see {@see MPU6050_SetGyroscopeSampleRateDivider()}
+ * @param[in] filter The filter bandwidth
+ *
+ * Blocking; Only the DLPF_CFG bits of the CONFIG register are modified. Check {@see I2C_FetchError()} for the outcome.
+ */
+void MPU6050_WriteSampleRate(uint8_t divider, mpu6050_dlpf_t filter);
+
 /**
  * @brief Scale configuration for the gyroscope
  */
@@ -367,6 +426,11 @@ typedef enum {
 	MPU6050_ACC_FS_16 = (0b11)	/*! +/- 16g */
 } mpu6050_acc_fs_t;
 
+/*!
+* \def MPU6050_ACC_LSB Returns the LSB/g for a given {\ref mpu6050_acc_fs_t} value
+*/
+#define MPU6050_ACC_LSB(x) (16384 >> (x))
+
 /**
  * @brief Configures the accelerometer full scale range
  * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
@@ -374,6 +438,15 @@ typedef enum {
  */
 void MPU6050_SetAccelerometerFullScale(mpu6050_confreg_t *const configuration, mpu6050_acc_fs_t fullScale);
 
+/**
+ * @brief Writes the gyroscope and accelerometer full scale ranges directly to the device
+ * @param[in] gyroscope The gyroscope full scale
+ * @param[in] accelerometer The accelerometer full scale
+ *
+ * Blocking; Only the range bits are modified. Check {@see I2C_FetchError()} for the outcome.
+ */
+void MPU6050_WriteFullScale(mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer);
+
 /**
  * @brief Interrupt level configuration
  */
@@ -507,6 +580,136 @@ typedef struct __attribute__ ((__packed__))
  */
 void MPU6050_ReadData(mpu6050_sensor_t *data);
 
+/**
+ * @brief Queues an asynchronous read of the interrupt status and sensor data registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @return Zero if queued, nonzero otherwise
+ *
+ * Once the transaction completed, use {@see MPU6050_DecodeData()} to convert the buffer.
+ */
+uint8_t MPU6050_ReadDataAsync(i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const buffer);
+
+/**
+ * @brief Queues an asynchronous read of the interrupt status and sensor data registers of a given MPU6050
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] arbiterHandle The I2C arbiter handle of the device
+ * @return Zero if queued, nonzero otherwise
+ *
+ * Leaves the selection of {@see MPU6050_Select()} as is.
+ */
+uint8_t MPU6050_ReadDataAsyncFrom(i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const buffer, uint8_t slaveAddress, uint8_t arbiterHandle);
+
+/**
+ * @brief Decodes the raw interrupt status and sensor data registers
+ * @param[in] buffer The raw register contents
+ * @param[out] data The data
+ */
+void MPU6050_DecodeData(const mpu6050_intdatareg_t *const buffer, mpu6050_sensor_t *const data);
+
+/**
+ * @brief I2C master clock divider for 400 kHz auxiliary bus speed (8 MHz / 20)
+ */
+#define MPU6050_I2CMST_CLK_400KHZ	(13)
+
+/**
+ * @brief Connects or disconnects the auxiliary I2C bus to the host bus
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] enabled Whether the bypass is enabled.
+ *
+ * The bypass must be disabled while the MPU6050 acts as I2C master.
+ */
+void MPU6050_SetAuxiliaryBypass(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled);
+
+/**
+ * @brief Configures the I2C master of the auxiliary bus
+ * @param[inout] configuration The configuration structure
+ * @param[in] enabled Whether the I2C master is enabled.
+ * @param[in] waitForExternal Whether the data ready interrupt is delayed until the external sensor data was loaded.
+ * @param[in] clock The I2C master clock divider, e.g. {@see MPU6050_I2CMST_CLK_400KHZ}
+ */
+void MPU6050_ConfigureI2CMaster(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled, mpu6050_inten_t waitForExternal, uint8_t clock);
+
+/**
+ * @brief Configures an auxiliary bus slave to be read at the sample rate into the EXT_SENS_DATA registers
+ * @param[inout] configuration The configuration structure
+ * @param[in] slave The slave index in a range of 0..3
+ * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] startRegisterAddress The first register address to read
+ * @param[in] registerCount The number of registers to read in a range of 1..15, or zero to disable the slave
+ */
+void MPU6050_ConfigureSlaveRead(mpu6050_confreg_t *const configuration, uint8_t slave, uint8_t slaveAddress, uint8_t startRegisterAddress, uint8_t registerCount);
+
+/**
+ * @brief Queues an asynchronous read of the interrupt status, sensor data and external sensor data registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @param[in] externalCount The number of EXT_SENS_DATA registers to read
+ * @return Zero if queued, nonzero otherwise
+ *
+ * Once the transaction completed, use {@see MPU6050_DecodeData()} on the internal data.
+ */
+uint8_t MPU6050_ReadFullDataAsync(i2casync_transaction_t *const transaction, mpu6050_fulldatareg_t *const buffer, uint8_t externalCount);
+
+/**
+ * @brief Size of one FIFO frame in bytes when accelerometer and gyroscope are written to the FIFO
+ */
+#define MPU6050_FIFO_FRAME_SIZE		(12)
+
+/**
+ * @brief Size of the FIFO in bytes
+ */
+#define MPU6050_FIFO_SIZE			(1024)
+
+/**
+ * @brief Maximum number of frames drained from the FIFO per bus transaction
+ *
+ * The byte count of one transaction must fit into the 8-bit I2C register count.
+ */
+#define MPU6050_FIFO_MAX_BATCH		(16)
+
+/**
+ * @brief Selects the sensor data written into the FIFO
+ * @param[inout] configuration The configuration structure
+ * @param[in] temperature Whether to write the temperature
+ * @param[in] gyroscope Whether to write all gyroscope axes
+ * @param[in] accelerometer Whether to write all accelerometer axes
+ *
+ * {@see MPU6050_ReadFifo()} expects accelerometer and gyroscope data only.
+ */
+void MPU6050_SelectFifoSources(mpu6050_confreg_t *const configuration, mpu6050_inten_t temperature, mpu6050_inten_t gyroscope, mpu6050_inten_t accelerometer);
+
+/**
+ * @brief Enables or disables the FIFO buffer
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] enabled Whether the FIFO is enabled.
+ */
+void MPU6050_EnableFifo(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled);
+
+/**
+ * @brief Clears the FIFO buffer
+ */
+void MPU6050_ResetFifo();
+
+/**
+ * @brief Reads the number of bytes in the FIFO
+ * @return The number of bytes
+ */
+uint16_t MPU6050_ReadFifoCount();
+
+/**
+ * @brief Drains accelerometer and gyroscope frames from the FIFO in one burst read
+ * @param[out] out The sample buffer
+ * @param[in] max The maximum number of samples to read; At most {@see MPU6050_FIFO_MAX_BATCH} are read.
+ * @return The number of samples read, oldest first
+ *
+ * If the FIFO overflowed, it is cleared and no samples are returned since
+ * the frame alignment is lost. Temperature is not available in FIFO mode.
+ */
+size_t MPU6050_ReadFifo(mpu6050_sensor_t *out, size_t max);
+
 /**
  * @brief Prepares a data buffer by clearing its values.
  * @param[inout] data The data buffer to clear. 
@@ -0,0 +1,86 @@
+/*
+ * mpu6050_autorange.h
+ *
+ * Full scale auto-ranging of the MPU6050 gyroscope and accelerometer.
+ * A range is widened as soon as a sample comes close to saturation and
+ * narrowed again after a window of samples stayed well within the lower range.
+ * The thresholds leave a hysteresis, so that a signal around a threshold
+ * does not toggle the range.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef MPU6050_AUTORANGE_H_
+#define MPU6050_AUTORANGE_H_
+
+#include <stdint.h>
+#include "imu/mpu6050.h"
+
+/**
+ * @brief Absolute raw value at or above which the next wider range is selected; About 85% of the range.
+ */
+#define MPU6050_AUTORANGE_HIGH		(28000)
+
+/**
+ * @brief Absolute raw value the peak of a window must stay below to select the next narrower range
+ *
+ * Doubled by the narrower range, it must stay below {@see MPU6050_AUTORANGE_HIGH}.
+ */
+#define MPU6050_AUTORANGE_LOW		(12000)
+
+/**
+ * @brief Number of samples the peak is taken over before narrowing a range
+ */
+#define MPU6050_AUTORANGE_WINDOW	(256)
+
+/**
+ * @brief Number of reads discarded after a switch, since they may still be converted in the previous range
+ */
+#define MPU6050_AUTORANGE_SETTLE	(2)
+
+/**
+ * @brief The auto-ranging state
+ */
+typedef struct {
+	mpu6050_gyro_fs_t gyroscope;			/*! the active gyroscope range */
+	mpu6050_acc_fs_t accelerometer;			/*! the active accelerometer range */
+	mpu6050_gyro_fs_t next_gyroscope;		/*! the requested gyroscope range */
+	mpu6050_acc_fs_t next_accelerometer;	/*! the requested accelerometer range */
+	uint16_t gyroscope_peak;				/*! the absolute gyroscope peak of the current window */
+	uint16_t accelerometer_peak;			/*! the absolute accelerometer peak of the current window */
+	uint16_t samples;						/*! the number of samples in the current window */
+	uint8_t settle;							/*! the number of reads still to discard */
+} mpu6050_autorange_t;
+
+/**
+ * @brief Initializes the auto-ranging with the configured ranges
+ * @param[out] state The state
+ * @param[in] gyroscope The gyroscope range
+ * @param[in] accelerometer The accelerometer range
+ */
+void MPU6050_AutorangeInitialize(mpu6050_autorange_t *const state, mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer);
+
+/**
+ * @brief Updates the auto-ranging with a sample
+ * @param[inout] state The state
+ * @param[in] sample The raw sample
+ * @return Nonzero if a range switch is requested, see {@see mpu6050_autorange_t::next_gyroscope}
+ */
+uint8_t MPU6050_AutorangeUpdate(mpu6050_autorange_t *const state, const mpu6050_sensor_t *const sample);
+
+/**
+ * @brief Completes a requested range switch
+ * @param[inout] state The state
+ * @param[in] success Nonzero if the ranges were written to the device; Otherwise, the request is dropped.
+ */
+void MPU6050_AutorangeSwitched(mpu6050_autorange_t *const state, uint8_t success);
+
+/**
+ * @brief Determines if the current read must be discarded after a range switch
+ * @param[inout] state The state
+ * @return Nonzero if the read must be discarded
+ */
+uint8_t MPU6050_AutorangeSettling(mpu6050_autorange_t *const state);
+
+#endif /* MPU6050_AUTORANGE_H_ */
@@ -0,0 +1,90 @@
+/*
+ * sensor_sample.h
+ *
+ * Sensor samples tagged with a per-sensor sequence number. The number only
+ * advances when the hardware reports a new sample: the MPU6050 DATA_RDY_INT
+ * status bit or a FIFO frame, the HMC5883L status register with RDY set and
+ * LOCK clear, or a sample queued by the interrupt driven acquisition.
+ * Consumers compare it with the number they handled last instead of comparing
+ * the values, so that repeated readings at rest are not dropped and no sample
+ * is handled twice.
+ *
+ *  Created on: Mar 12, 2014
+ *      Author: Markus
+ */
+
+#ifndef SENSOR_SAMPLE_H_
+#define SENSOR_SAMPLE_H_
+
+#include <stdint.h>
+#include "imu/mpu6050.h"
+#include "imu/hmc5883l.h"
+
+/**
+ * @brief The sensor a sample stems from
+ */
+typedef enum {
+	SENSOR_MPU6050		= (1 << 0),	/*< An MPU6050 sample, stamped at its data ready interrupt */
+	SENSOR_HMC5883L		= (1 << 1)	/*< An HMC5883L sample, stamped at its data ready interrupt or request */
+} sensor_source_t;
+
+/**
+ * @brief A timestamped sample
+ */
+typedef struct {
+	uint32_t timestamp;					/*< The time of the sample in microseconds, see {@see Timebase_Microseconds()} */
+	uint16_t sequence;					/*< The number of samples of the sensor up to this one, wrapping; Skipped samples leave gaps. */
+	uint8_t source;						/*< The {@see sensor_source_t} */
+	union {
+		mpu6050_sensor_t mpu6050;		/*< The MPU6050 data */
+		hmc5883l_data_t hmc5883l;		/*< The HMC5883L data */
+	};
+} sensor_sample_t;
+
+/**
+ * @brief Prepares a sample that no data was received for yet
+ * @param[out] sample The sample
+ * @param[in] source The {@see sensor_source_t}
+ */
+static inline void SensorSample_Initialize(sensor_sample_t *const sample, sensor_source_t source)
+{
+	assert_not_null(sample);
+	sample->timestamp = 0;
+	sample->sequence = 0;
+	sample->source = (uint8_t)source;
+	if (SENSOR_MPU6050 == source)
+	{
+		MPU6050_InitializeData(&sample->mpu6050);
+	}
+	else
+	{
+		HMC5883L_InitializeData(&sample->hmc5883l);
+	}
+}
+
+/**
+ * @brief Accounts for new samples the hardware reported
+ * @param[inout] sample The sample; Its data must hold the latest of the new samples.
+ * @param[in] count The number of new samples
+ * @param[in] timestamp The time of the latest of them
+ */
+static inline void SensorSample_Advance(sensor_sample_t *const sample, uint16_t count, uint32_t timestamp)
+{
+	sample->sequence = (uint16_t)(sample->sequence + count);
+	sample->timestamp = timestamp;
+}
+
+/**
+ * @brief Takes the samples that were not handled yet
+ * @param[in] sample The latest sample
+ * @param[inout] handled The sequence number handled last; Set to that of the sample.
+ * @return The number of samples since the one handled last, zero if none; More than one if samples were skipped.
+ */
+static inline uint16_t SensorSample_Take(const sensor_sample_t *const sample, uint16_t *const handled)
+{
+	register const uint16_t count = (uint16_t)(sample->sequence - *handled);
+	*handled = sample->sequence;
+	return count;
+}
+
+#endif /* SENSOR_SAMPLE_H_ */
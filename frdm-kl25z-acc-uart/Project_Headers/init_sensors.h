@@ -8,11 +8,79 @@
 #define MMA8451Q_INT1_PIN	14					/*! Pin at which the MMA8451Q INT1 is attached */
 #define MMA8451Q_INT2_PIN	15					/*! Pin at which the MMA8451Q INT2 is attached */
 
+#define MMA8451Q_FIFO_MODE	1					/*! Used to fetch MMA8451Q samples in batches on its FIFO watermark interrupt instead of on every data ready interrupt */
+#define MMA8451Q_FIFO_WATERMARK	(4)				/*! Number of FIFO samples that raise the watermark interrupt; 1..MMA8451Q_FIFO_SIZE */
+#define MMA8451Q_FUSE_ACCELEROMETER	1			/*! Used to fuse the MMA8451Q with the MPU6050 accelerometer, weighted by their variances */
+
 #define MPU6050_INT_PORT	PORTA				/*! Port at which the MPU6050 INT pin is attached */
 #define MPU6050_INT_GPIO	GPIOA				/*! Port at which the MPU6050 INT pin is attached */
 #define MPU6050_INT_PIN		13					/*! Pin at which the MPU6050 INT is attached */
 
+#define HMC5883L_FETCH_TIMER	0				/*! The HMC5883L is polled on a software timer at its output rate */
+#define HMC5883L_FETCH_DRDY		1				/*! The HMC5883L is read on its DRDY interrupt */
+#define HMC5883L_FETCH_AUX		2				/*! The HMC5883L is slaved to the MPU6050 auxiliary bus and read along with the MPU6050 data */
+#define HMC5883L_FETCH_MODE	HMC5883L_FETCH_TIMER	/*! Selects how the HMC5883L data is fetched */
+
+#define HMC5883L_INT_PORT	PORTA				/*! Port at which the HMC5883L DRDY pin is attached */
+#define HMC5883L_INT_GPIO	GPIOA				/*! Port at which the HMC5883L DRDY pin is attached */
+#define HMC5883L_INT_PIN	12					/*! Pin at which the HMC5883L DRDY is attached */
+
+#define MPU6050_FIFO_MODE	0					/*! Used to fetch MPU6050 samples in batches from its FIFO instead of on every data ready interrupt */
+#define MPU6050_ISR_ACQUISITION	0				/*! Used to read the sensors from the interrupt handlers into a sample queue the main loop drains in batches, see imu/acquisition.h */
+
+#if DEBUG
+#define PERFORMANCE_PRESET_DEFAULT	PRESET_LOW_POWER	/*! The performance preset configured at boot, see performance_preset_t; The unoptimized build is slower */
+#else
+#define PERFORMANCE_PRESET_DEFAULT	PRESET_BALANCED		/*! The performance preset configured at boot, see performance_preset_t */
+#endif
+
+#define MPU6050_GYROSCOPE_FULL_SCALE		MPU6050_GYRO_FS_2000	/*! The gyroscope range configured at boot */
+#define MPU6050_ACCELEROMETER_FULL_SCALE	MPU6050_ACC_FS_4		/*! The accelerometer range configured at boot */
+#define MPU6050_AUTORANGE	0					/*! Used to switch the MPU6050 ranges at runtime, see mpu6050_autorange.h; Raw sample captures do not carry the range. */
+
 #include "fixmath.h"
+#include "i2c/i2carbiter.h"
+#include "imu/mpu6050.h"
+#include "imu/hmc5883l.h"
+#include "fusion/sensor_calibration.h"
+
+/**
+* @brief Number of HMC5883L registers read through the MPU6050 auxiliary bus if HMC5883L_FETCH_MODE is HMC5883L_FETCH_AUX
+*
+* The status register lands in EXT_SENS_DATA_00, followed by the data output registers.
+*/
+#define HMC5883L_AUX_REGISTER_COUNT     (1 + HMC5883L_DATA_REGISTER_COUNT)
+
+/**
+* @brief An MPU6050 of the virtual IMU, see MPU6050_COUNT
+*/
+typedef struct {
+    uint8_t address;                    /*! The 7-bit slave address, MPU6050_I2CADDR or MPU6050_I2CADDR_ALT */
+    i2carbiter_handle_t arbiter_handle; /*! The I2C arbiter handle, telling apart devices of the same address on different pins */
+} mpu6050_instance_t;
+
+/**
+* @brief The performance presets, matching the sensor rates to the CPU budget
+*/
+typedef enum {
+    PRESET_LOW_LATENCY = 0,             /*! 1 kHz, DLPF 188 Hz, magnetometer 75 Hz, output every 10 ms */
+    PRESET_BALANCED = 1,                /*! 200 Hz, DLPF off, magnetometer 75 Hz, output every 100 ms */
+    PRESET_LOW_POWER = 2,               /*! 50 Hz, DLPF 42 Hz, magnetometer 15 Hz, output every 200 ms */
+    PRESET_COUNT                        /*! The number of presets */
+} performance_preset_t;
+
+/**
+* @brief The settings of a performance preset
+*/
+typedef struct {
+    uint8_t sample_rate_divider;        /*! The MPU6050 sample rate divider, see MPU6050_SetGyroscopeSampleRateDivider() */
+    mpu6050_dlpf_t low_pass;            /*! The MPU6050 digital low pass filter */
+    hmc5883l_do_t magnetometer_rate;    /*! The HMC5883L output rate */
+    uint8_t magnetometer_period;        /*! The HMC5883L polling period in milliseconds if HMC5883L_FETCH_MODE is HMC5883L_FETCH_TIMER */
+    uint8_t fifo_period;                /*! The MPU6050 FIFO drain period in milliseconds if MPU6050_FIFO_MODE is set; At most MPU6050_FIFO_MAX_BATCH samples. */
+    uint8_t hybrid_decimation;          /*! The number of samples per Kalman step in the hybrid fusion mode */
+    uint16_t output_period;             /*! The fused output period in milliseconds */
+} performance_preset_config_t;
 
 /**
 * @brief Sets up the MMA8451Q communication
@@ -20,7 +88,26 @@
 void InitMMA8451Q();
 
 /**
-* @brief Sets up the MPU6050 communication
+* @brief Registers an MPU6050 of the virtual IMU
+* @param[in] index The device index in 0 .. MPU6050_COUNT-1; Zero is the device whose data ready interrupt drives the reads.
+* @param[in] address The 7-bit slave address
+* @param[in] arbiter_handle The I2C arbiter handle
+*
+* Must be called for all devices before InitMPU6050(); Device zero defaults to MPU6050_I2CADDR.
+*/
+void SetMPU6050Instance(uint8_t index, uint8_t address, i2carbiter_handle_t arbiter_handle);
+
+/**
+* @brief Fetches an MPU6050 of the virtual IMU
+* @param[in] index The device index in 0 .. MPU6050_COUNT-1
+* @return The device
+*/
+const mpu6050_instance_t* GetMPU6050Instance(uint8_t index);
+
+/**
+* @brief Sets up the MPU6050 communication of all devices
+*
+* All devices are configured alike; The driver is left with device zero selected.
 */
 void InitMPU6050();
 
@@ -29,6 +116,47 @@ void InitMPU6050();
 */
 void InitHMC5883L();
 
+/**
+* @brief Hands the HMC5883L over to the MPU6050 auxiliary I2C master
+*
+* Only effective if HMC5883L_FETCH_MODE is HMC5883L_FETCH_AUX; Must be called after
+* both InitMPU6050() and InitHMC5883L().
+*/
+void InitMPU6050Slaves();
+
+/**
+* @brief Fetches the settings of a performance preset
+* @param[in] preset The preset
+* @return The settings or NULL if the preset is invalid
+*/
+const performance_preset_config_t* GetPerformancePreset(performance_preset_t preset);
+
+/**
+* @brief Switches the MPU6050 sample rate and low pass filter and the HMC5883L output rate of a preset
+* @param[in] preset The preset settings
+* @return Zero on success, the I2C error flags otherwise
+*
+* Blocking; The asynchronous I2C engine must be idle. All MPU6050 are switched. The HMC5883L rate is left as is
+* if the HMC5883L is slaved to the MPU6050, where it is read at the MPU6050 sample rate.
+*/
+uint8_t SetSensorPreset(const performance_preset_config_t *const preset);
+
+/**
+* @brief Switches the MPU6050 full scale ranges along with their scaling values
+* @param[in] gyroscope The gyroscope range
+* @param[in] accelerometer The accelerometer range
+* @return Zero on success; Otherwise, the I2C error flags and the scaling values are unchanged.
+*
+* Blocking; The asynchronous I2C engine must be idle and the MPU6050 selected.
+* The sensor data preparation must be re-initialized with the new scaling values afterwards.
+*/
+uint8_t SetMPU6050FullScale(mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer);
+
+/**
+* @brief Gets the scaling value for the MMA8451Q accelerometer
+*/
+fix16_t mma8451q_accelerometer_get_scaler();
+
 /**
 * @brief Gets the scaling value for the MPU6050 accelerometer
 */
@@ -63,5 +63,7 @@
 
 #define UART0	UART0_BASE_PTR
 #define I2C0	I2C0_BASE_PTR
+#define DMA0	DMA_BASE_PTR
+#define DMAMUX0	DMAMUX0_BASE_PTR
 
 #endif /* NICE_NAMES_H_ */
@@ -16,7 +16,46 @@ typedef enum {
     RPY = 42,               //!< Derived roll/pitch/yaw angles
     QUATERNION = 43,        //!< Fused quaternion only
     QUATERNION_RPY = 44,    //!< Fused quaternion and derived roll/pitch/yaw angles
-
+    QUATERNION_COMPACT = 45,//!< Fused quaternion in smallest-three format, see output_encoding.h
+    RPY_COMPACT = 46,       //!< Derived roll/pitch/yaw angles as 16 bit binary angles
+    QUATERNION_DELTA = 47,  //!< Fused quaternion as Q1.15 deltas with periodic key frames (type 48)
+    RATES_ACCELERATION = 49,//!< Filtered angular rates and gravity compensated linear acceleration
+    QUATERNION_RATES_ACCELERATION = 50, //!< Fused quaternion, filtered angular rates and linear acceleration
 } output_mode_t;
 
+/*!
+* \brief Defines the timing options of the fused output; Flags, combined by or
+*/
+typedef enum {
+    OUTPUT_TIMING_STAMP = 0x01,         //!< Appends the time of the fused state (uint32_t, microseconds on the timebase) to each output frame
+    OUTPUT_TIMING_EXTRAPOLATE = 0x02,   //!< Extrapolates quaternions to the expected end of the transmission; Angles, rates and raw data are not.
+    OUTPUT_TIMING_LATENCY = 0x04,       //!< Appends the delay from the sample latch of the fused state to the submission of the frame (uint32_t, microseconds), after the state time
+} output_timing_t;
+
+/*!
+* \def OUTPUT_TIMING_MASK All output timing flags
+*/
+#define OUTPUT_TIMING_MASK (OUTPUT_TIMING_STAMP | OUTPUT_TIMING_EXTRAPOLATE | OUTPUT_TIMING_LATENCY)
+
+/*!
+* \brief Defines the run modes; Selected at runtime by sending the mode value
+*
+* The values are chosen to not collide with the {\ref output_mode_t} values.
+*/
+typedef enum {
+    RUN_FUSE = 'F',         //!< Sensor fusion with fused output only
+    RUN_FETCH = 'R',        //!< Raw sensor data transmission only; The fusion is suspended
+    RUN_FUSE_FETCH = 'C',   //!< Sensor fusion with fused output and decimated raw sensor data
+} run_mode_t;
+
+/*!
+* \def RUN_MODE_FUSES Determines if the given run mode requires sensor fusion
+*/
+#define RUN_MODE_FUSES(mode) ((mode) != RUN_FETCH)
+
+/*!
+* \def RUN_MODE_FETCHES Determines if the given run mode transmits raw sensor data
+*/
+#define RUN_MODE_FETCHES(mode) ((mode) != RUN_FUSE)
+
 #endif
\ No newline at end of file
@@ -5,6 +5,7 @@
  *      Author: Markus
  */
 
+#include <string.h>
 #include "derivative.h"
 #include "comm/buffer.h"
 
@@ -27,6 +28,58 @@ uint8_t RingBuffer_Init(buffer_t *const buffer, uint8_t (*const data)[], const u
 	*(uint32_t*)(&buffer->size) = size;
 	*(uint32_t*)(&buffer->mask) = size-1;
 	buffer->writeIndex = buffer->readIndex = 0;
+#if RINGBUFFER_TRACK_PEAK
+	buffer->peak = 0;
+#endif
 	
 	return 0;
 }
+
+/**
+ * @brief Writes as many items as fit into the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[in] data The data to write
+ * @param[in] count The number of bytes to write
+ * @return The number of bytes written
+ */
+uint32_t RingBuffer_WriteBlock(buffer_t *const buffer, const uint8_t *const data, const uint32_t count)
+{
+	const uint32_t used = RingBuffer_Count(buffer);
+	const uint32_t free = (used < buffer->size) ? buffer->size - used : 0;
+	const uint32_t length = (count < free) ? count : free;
+	
+	/* copy up to the end of the data array, then wrap around */
+	const uint32_t offset = buffer->mask & buffer->writeIndex;
+	const uint32_t tail = buffer->size - offset;
+	const uint32_t first = (length < tail) ? length : tail;
+	
+	memcpy(&buffer->data[offset], data, first);
+	memcpy(&buffer->data[0], &data[first], length - first);
+	
+	RingBuffer_CommitWrite(buffer, length);
+	return length;
+}
+
+/**
+ * @brief Reads as many items as available from the ring buffer
+ * @param[in] buffer The ring buffer instance
+ * @param[out] data The data read
+ * @param[in] count The maximum number of bytes to read
+ * @return The number of bytes read
+ */
+uint32_t RingBuffer_ReadBlock(buffer_t *const buffer, uint8_t *const data, const uint32_t count)
+{
+	const uint32_t available = RingBuffer_Count(buffer);
+	const uint32_t length = (count < available) ? count : available;
+	
+	/* copy up to the end of the data array, then wrap around */
+	const uint32_t offset = buffer->mask & buffer->readIndex;
+	const uint32_t tail = buffer->size - offset;
+	const uint32_t first = (length < tail) ? length : tail;
+	
+	memcpy(data, &buffer->data[offset], first);
+	memcpy(&data[first], &buffer->data[0], length - first);
+	
+	RingBuffer_Consume(buffer, length);
+	return length;
+}
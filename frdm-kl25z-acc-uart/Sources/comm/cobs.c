@@ -0,0 +1,161 @@
+/*
+ * cobs.c
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#include "nice_names.h"
+#include "comm/cobs.h"
+#include "comm/crc16.h"
+
+/**
+ * @brief The code of a full block, which is not followed by an implied zero
+ */
+#define COBS_FULL_BLOCK				(0xFF)
+
+/**
+ * @brief State of the encoder
+ */
+typedef struct {
+	uint8_t *code;			/*< The position of the code byte of the current block */
+	uint8_t *out;			/*< The write position */
+	uint8_t run;			/*< The code of the current block: one more than its data byte count */
+} cobs_encoder_t;
+
+/**
+ * @brief Encodes a span of bytes
+ * @param[inout] encoder The encoder
+ * @param[in] data The data
+ * @param[in] count The number of bytes
+ */
+static inline void encodeSpan(register cobs_encoder_t *const encoder, register const uint8_t *data, register uint8_t count)
+{
+	while (count--)
+	{
+		register const uint8_t byte = *data++;
+		if (COBS_DELIMITER == byte)
+		{
+			/* the zero ends the block; its code points here */
+			*encoder->code = encoder->run;
+			encoder->code = encoder->out++;
+			encoder->run = 1;
+			continue;
+		}
+		
+		*encoder->out++ = byte;
+		if (++encoder->run == COBS_FULL_BLOCK)
+		{
+			*encoder->code = COBS_FULL_BLOCK;
+			encoder->code = encoder->out++;
+			encoder->run = 1;
+		}
+	}
+}
+
+/**
+ * @brief Encodes a COBS frame with a prefix into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see COBS_MAX_FRAME_LENGTH(prefixCount + dataCount)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes, including the delimiter
+ */
+uint16_t COBS_EncodeFramePrefixed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount)
+{
+	uint16_t crc = CRC16_Update(CRC16_INITIAL, prefix, prefixCount);
+	crc = CRC16_Update(crc, data, dataCount);
+	const uint8_t trailer[2] = { (uint8_t)crc, (uint8_t)(crc >> 8) };
+	
+	cobs_encoder_t encoder = { frame, frame + 1, 1 };
+	encodeSpan(&encoder, prefix, prefixCount);
+	encodeSpan(&encoder, data, dataCount);
+	encodeSpan(&encoder, trailer, sizeof(trailer));
+	
+	/* close the last block and terminate the frame */
+	*encoder.code = encoder.run;
+	*encoder.out++ = COBS_DELIMITER;
+	return (uint16_t)(encoder.out - frame);
+}
+
+/**
+ * @brief Initializes the COBS decoder
+ * @param[out] decoder The decoder
+ * @param[in] buffer The payload buffer; Must hold the payload and the CRC. Larger frames are dropped.
+ * @param[in] size The payload buffer size in bytes
+ */
+void COBSD_Init(register cobsd_decoder_t *const decoder, register uint8_t *const buffer, register uint8_t size)
+{
+	decoder->buffer = buffer;
+	decoder->size = size;
+	decoder->count = 0;
+	decoder->code = 0;
+	decoder->remaining = 0;
+	decoder->overflow = 0;
+}
+
+/**
+ * @brief Stores a decoded byte
+ * @param[inout] decoder The decoder
+ * @param[in] byte The byte
+ */
+static inline void store(register cobsd_decoder_t *const decoder, register uint8_t byte)
+{
+	if (decoder->count >= decoder->size)
+	{
+		decoder->overflow = 1;
+		return;
+	}
+	decoder->buffer[decoder->count++] = byte;
+}
+
+/**
+ * @brief Feeds a received byte to the COBS decoder
+ * @param[inout] decoder The decoder
+ * @param[in] byte The received byte
+ * @return {@see COBSD_FRAME} if the payload of a complete frame is available in the buffer
+ */
+cobsd_result_t COBSD_Decode(register cobsd_decoder_t *const decoder, register uint8_t byte)
+{
+	if (COBS_DELIMITER == byte)
+	{
+		register const uint8_t started = (decoder->code != 0);
+		register const uint8_t truncated = (decoder->remaining != 0) || decoder->overflow || (decoder->count < 2);
+		register const uint8_t count = decoder->count;
+		
+		decoder->count = 0;
+		decoder->code = 0;
+		decoder->remaining = 0;
+		decoder->overflow = 0;
+		
+		/* idle delimiters */
+		if (!started) return COBSD_PENDING;
+		if (truncated) return COBSD_ERROR;
+		
+		/* the implied zero of the last block is not part of the frame */
+		register const uint8_t payloadCount = count - 2;
+		register const uint16_t crc = (uint16_t)decoder->buffer[payloadCount] | ((uint16_t)decoder->buffer[payloadCount + 1] << 8);
+		if (crc != CRC16_Calculate(decoder->buffer, payloadCount)) return COBSD_ERROR;
+		
+		decoder->count = payloadCount;
+		return COBSD_FRAME;
+	}
+	
+	/* a data byte of the current block */
+	if (decoder->remaining > 0)
+	{
+		--decoder->remaining;
+		store(decoder, byte);
+		return COBSD_PENDING;
+	}
+	
+	/* a code byte; the previous block ended with a zero unless it was full */
+	if (decoder->code != 0 && decoder->code != COBS_FULL_BLOCK)
+	{
+		store(decoder, COBS_DELIMITER);
+	}
+	decoder->code = byte;
+	decoder->remaining = byte - 1;
+	return COBSD_PENDING;
+}
@@ -0,0 +1,121 @@
+/*
+ * command.c
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#include "comm/p2pprotocol.h"
+#include "comm/cobs.h"
+#include "comm/io.h"
+#include "comm/command.h"
+#include "cpu/timebase.h"
+
+/**
+ * @brief The payload buffer of the decoder
+ */
+static uint8_t commandBuffer[COMMAND_MAX_LENGTH];
+
+/**
+ * @brief The decoder
+ */
+static p2ppd_decoder_t decoder;
+
+/**
+ * @brief The payload buffer of the COBS decoder; Holds the CRC as well.
+ */
+static uint8_t cobsCommandBuffer[COMMAND_MAX_LENGTH + 2];
+
+/**
+ * @brief The COBS decoder
+ */
+static cobsd_decoder_t cobsDecoder;
+
+/**
+ * @brief The receive statistics
+ */
+static command_statistics_t statistics;
+
+/**
+ * @brief Initializes the command decoder
+ */
+void Command_Init()
+{
+	P2PPD_Init(&decoder, commandBuffer, sizeof(commandBuffer));
+	COBSD_Init(&cobsDecoder, cobsCommandBuffer, sizeof(cobsCommandBuffer));
+	statistics.received = 0;
+	statistics.rejected = 0;
+	statistics.framingErrors = 0;
+}
+
+/**
+ * @brief Feeds the received bytes to the decoder until a command frame is complete
+ * @param[out] command The decoded command
+ * @return Nonzero if a command was decoded, zero if the receive buffer ran empty
+ *
+ * Must only be used after initialization of Uart0 interrupt.
+ * Commands are accepted in both framings, so that the host can switch at any time;
+ * Framing errors are only counted for the framing selected for transmission, since
+ * the other decoder sees noise.
+ */
+uint8_t Command_Poll(command_t *const command)
+{
+	while (IO_HasData())
+	{
+		const uint8_t data = IO_ReadByte();
+		const io_framing_t framing = IO_GetFraming();
+		
+		const p2ppd_result_t result = P2PPD_Decode(&decoder, data);
+		const cobsd_result_t cobsResult = COBSD_Decode(&cobsDecoder, data);
+		
+		if (P2PPD_ERROR == result && IO_FRAMING_COBS != framing) ++statistics.framingErrors;
+		if (COBSD_ERROR == cobsResult && IO_FRAMING_COBS == framing) ++statistics.framingErrors;
+		
+		if (P2PPD_FRAME == result && decoder.count > 0)
+		{
+			++statistics.received;
+			command->id = commandBuffer[0];
+			command->length = decoder.count - 1;
+			command->args = &commandBuffer[1];
+			command->time = Timebase_Microseconds();
+			return 1;
+		}
+		
+		if (COBSD_FRAME == cobsResult && cobsDecoder.count > 0)
+		{
+			++statistics.received;
+			command->id = cobsCommandBuffer[0];
+			command->length = cobsDecoder.count - 1;
+			command->args = &cobsCommandBuffer[1];
+			command->time = Timebase_Microseconds();
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief Sends the acknowledge frame for a command and updates the statistics
+ * @param[in] command The command
+ * @param[in] status The status
+ *
+ * The frame is {@see COMMAND_ACK_FRAME_TYPE}, the command id and the status.
+ */
+void Command_Acknowledge(const command_t *const command, command_status_t status)
+{
+	if (COMMAND_OK != status) ++statistics.rejected;
+	
+	const uint8_t type = COMMAND_ACK_FRAME_TYPE;
+	const uint8_t data[2] = { command->id, (uint8_t)status };
+	IO_SendFrame(&type, 1, data, sizeof(data));
+}
+
+/**
+ * @brief Fetches the receive statistics
+ * @return The statistics
+ */
+const command_statistics_t* Command_GetStatistics()
+{
+	return &statistics;
+}
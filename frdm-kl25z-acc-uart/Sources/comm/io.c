@@ -9,6 +9,8 @@
 #include "derivative.h" /* include peripheral declarations */
 #include "comm/buffer.h"
 #include "comm/uart.h"
+#include "comm/p2pprotocol.h"
+#include "comm/cobs.h"
 
 #include "nice_names.h"
 #include "comm/io.h"
@@ -16,10 +18,101 @@
 extern buffer_t* uartReadFifo; /*< the read buffer, initialized by Uart0_InitializeIrq() */
 extern buffer_t* uartWriteFifo; /*< the write buffer, initialized by Uart0_InitializeIrq() */
 
+/**
+ * @brief The largest payload of a frame sent, excluding trailers
+ *
+ * The largest frames are the raw sensor capture frames (see capture_frame.h).
+ */
+#define IO_MAX_PAYLOAD_LENGTH (64)
+
+/**
+ * @brief Size of a frame buffer in byte; Fits the largest frame sent with every byte escaped.
+ *
+ * COBS frames of the same payload are always shorter.
+ */
+#define IO_FRAME_BUFFER_SIZE (P2PPE_MAX_FRAME_LENGTH(IO_MAX_PAYLOAD_LENGTH + P2PPE_TRAILER_LENGTH))
+
+#if COBS_MAX_FRAME_LENGTH(IO_MAX_PAYLOAD_LENGTH) > IO_FRAME_BUFFER_SIZE
+#error COBS frames do not fit the frame buffer
+#endif
+
+#if UART0_USE_DMA_TX
+
+/**
+ * @brief Ping-pong frame buffers; One is encoded into while the DMA owns the other one.
+ */
+static uint8_t frameBuffers[2][IO_FRAME_BUFFER_SIZE] __attribute__((aligned(4)));
+static uint8_t nextFrameBuffer = 0; /*< index of the buffer to encode the next frame into */
+
+/*
+ * Buffer ownership: The buffer last handed to the UART is either being sent or queued.
+ * If it is queued, the other one is being sent; Otherwise the other one is free. So
+ * {@see nextFrameBuffer} is free whenever no frame is queued.
+ */
+
+#endif
+
+/**
+ * @brief The number of frames dropped by {@see IO_SubmitFrame()}
+ */
+static uint32_t droppedFrames = 0;
+
+/**
+ * @brief The framing of sent frames
+ */
+static io_framing_t framing = IO_FRAMING_P2PPE;
+
+/**
+ * @brief The sequence number of the next frame with trailer
+ */
+static uint16_t sequence = 0;
+
+/**
+ * @brief Encodes a frame with a prefix in the current framing
+ * @param[out] frame The frame buffer of {@see IO_FRAME_BUFFER_SIZE} bytes
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The frame length
+ */
+static inline uint16_t IO_EncodeFrame(uint8_t *const frame, const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount)
+{
+	switch (framing)
+	{
+		case IO_FRAMING_COBS:
+			return COBS_EncodeFramePrefixed(frame, prefix, prefixCount, data, dataCount);
+		case IO_FRAMING_P2PPE_TRAILER:
+			return P2PPE_EncodeFrameTrailed(frame, prefix, prefixCount, data, dataCount, sequence++);
+		case IO_FRAMING_P2PPE:
+		default:
+			return P2PPE_EncodeFramePrefixed(frame, prefix, prefixCount, data, dataCount);
+	}
+}
+
 /*
  * TODO: Add variants with defined endianness by reading the AIRCR.ENDIANNESS bit.
  */
 
+/**
+ * @brief Enqueues a block of bytes, blocking while the buffer is full.
+ * @param[in] data The data to enqueue
+ * @param[in] length The data length
+ */
+static void IO_WriteBlocking(const uint8_t *data, uint32_t length)
+{
+	while (length > 0)
+	{
+		RingBuffer_BlockWhileFull(uartWriteFifo);
+		const uint32_t written = RingBuffer_WriteBlock(uartWriteFifo, data, length);
+		data += written;
+		length -= written;
+		
+		/* let the IRQ drain the buffer while we wait for space */
+		if (length > 0) Uart0_EnableTransmitIrq();
+	}
+}
+
 /**
  * @brief Sends a char without flushing the buffer.
  */
@@ -50,12 +143,8 @@ void IO_SendByte(uint8_t value)
  */
 void IO_SendInt16(int16_t value)
 {
-	/* echo to output */
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0xFF00) >> 8);
-	
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0x00FF));
+	const uint8_t bytes[2] = { (value & 0xFF00) >> 8, (value & 0x00FF) };
+	IO_WriteBlocking(bytes, sizeof(bytes));
 	
 	/* enable transmit IRQ */
 	Uart0_EnableTransmitIrq();
@@ -113,18 +202,8 @@ void IO_SendUInt16AsString(uint16_t value)
  */
 void IO_SendInt32(uint32_t value)
 {
-	/* echo to output */
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0xFF000000) >> 24);
-	
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0x00FF0000) >> 16);
-	
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0x0000FF00) >> 8);
-	
-	RingBuffer_BlockWhileFull(uartWriteFifo);
-	RingBuffer_Write(uartWriteFifo, (value & 0x000000FF));
+	const uint8_t bytes[4] = { (value & 0xFF000000) >> 24, (value & 0x00FF0000) >> 16, (value & 0x0000FF00) >> 8, (value & 0x000000FF) };
+	IO_WriteBlocking(bytes, sizeof(bytes));
 	
 	/* enable transmit IRQ */
 	Uart0_EnableTransmitIrq();
@@ -138,11 +217,7 @@ void IO_SendInt32(uint32_t value)
 void IO_SendString(const char *string, uint8_t length)
 {
 	/* enqueue the bytes */
-	for (uint8_t i=0; i<length; ++i)
-	{
-		RingBuffer_BlockWhileFull(uartWriteFifo);
-		RingBuffer_Write(uartWriteFifo, string[i]);
-	}
+	IO_WriteBlocking((const uint8_t*)string, length);
 	
 	/* enable transmit IRQ */
 	Uart0_EnableTransmitIrq();
@@ -174,14 +249,164 @@ void IO_SendZString(const char *const string)
 void IO_SendBuffer(const uint8_t *const string, uint8_t length)
 {
 	/* enqueue the bytes */
-	for (uint8_t i=0; i<length; ++i)
+	IO_WriteBlocking(string, length);
+	
+	/* enable transmit IRQ */
+	Uart0_EnableTransmitIrq();
+}
+
+/**
+ * @brief Sends a frame with a prefix in the current framing
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * 
+ * Must only be used after initialization of Uart0 interrupt.
+ */
+void IO_SendFrame(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount)
+{
+	assert(prefixCount + dataCount <= IO_MAX_PAYLOAD_LENGTH);
+	
+#if UART0_USE_DMA_TX
+	/* the next buffer is free once the queued frame was started */
+	while (Uart0_DmaTransmitQueued()) {}
+	
+	/* encode while the DMA may still be sending the previous frame from the other buffer */
+	uint8_t *const frame = frameBuffers[nextFrameBuffer];
+	nextFrameBuffer ^= 1;
+	
+	const uint16_t length = IO_EncodeFrame(frame, prefix, prefixCount, data, dataCount);
+	
+	/* ownership of the buffer passes to the DMA */
+	Uart0_TransmitDma(frame, length);
+#else
+	uint8_t frame[IO_FRAME_BUFFER_SIZE];
+	const uint16_t length = IO_EncodeFrame(frame, prefix, prefixCount, data, dataCount);
+	IO_SendBuffer(frame, length);
+#endif
+}
+
+/**
+ * @brief Sends a frame with a prefix in the current framing if it can be queued without waiting
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @return Zero if the frame was queued, nonzero if it was dropped
+ */
+uint8_t IO_SubmitFrame(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount)
+{
+	assert(prefixCount + dataCount <= IO_MAX_PAYLOAD_LENGTH);
+	
+#if UART0_USE_DMA_TX
+	if (Uart0_DmaTransmitQueued())
 	{
-		RingBuffer_BlockWhileFull(uartWriteFifo);
-		RingBuffer_Write(uartWriteFifo, string[i]); /* TODO: RingBuffer_WriteBlocking() */
+#if IO_DROP_POLICY == IO_DROP_OLDEST
+		/* take the queued buffer back; if it was started meanwhile, the next buffer is free anyway */
+		if (Uart0_CancelQueuedDma())
+		{
+			nextFrameBuffer ^= 1;
+			++droppedFrames;
+		}
+#else
+		++droppedFrames;
+		return 1;
+#endif
 	}
 	
-	/* enable transmit IRQ */
+	uint8_t *const frame = frameBuffers[nextFrameBuffer];
+	nextFrameBuffer ^= 1;
+	
+	const uint16_t length = IO_EncodeFrame(frame, prefix, prefixCount, data, dataCount);
+	
+	/* cannot fail, frames are only queued from the main loop */
+	Uart0_QueueDma(frame, length);
+	return 0;
+#else
+	uint8_t frame[IO_FRAME_BUFFER_SIZE];
+	const uint16_t length = IO_EncodeFrame(frame, prefix, prefixCount, data, dataCount);
+	
+	/* bytes already in the ring buffer cannot be taken back, so both policies drop the new frame */
+	if ((uartWriteFifo->size - RingBuffer_Count(uartWriteFifo)) < length)
+	{
+		++droppedFrames;
+		return 1;
+	}
+	
+	RingBuffer_WriteBlock(uartWriteFifo, frame, length);
 	Uart0_EnableTransmitIrq();
+	return 0;
+#endif
+}
+
+/**
+ * @brief Selects the framing of the frames sent from now on
+ * @param[in] value The framing
+ */
+void IO_SetFraming(io_framing_t value)
+{
+	assert(IO_FRAMING_P2PPE == value || IO_FRAMING_COBS == value || IO_FRAMING_P2PPE_TRAILER == value);
+	framing = value;
+}
+
+/**
+ * @brief Fetches the framing of sent frames
+ * @return The framing
+ */
+io_framing_t IO_GetFraming()
+{
+	return framing;
+}
+
+/**
+ * @brief Determines the number of bytes on the wire of a frame in the current framing
+ * @param[in] payloadCount The number of prefix and data bytes
+ * @return The frame length; Assumes no escaping for P2PPE.
+ */
+uint16_t IO_FrameLength(uint8_t payloadCount)
+{
+	switch (framing)
+	{
+		case IO_FRAMING_COBS:
+			return COBS_MAX_FRAME_LENGTH(payloadCount);
+		case IO_FRAMING_P2PPE_TRAILER:
+			return P2PPE_FRAME_LENGTH(payloadCount + P2PPE_TRAILER_LENGTH);
+		case IO_FRAMING_P2PPE:
+		default:
+			return P2PPE_FRAME_LENGTH(payloadCount);
+	}
+}
+
+/**
+ * @brief Fetches the sequence number of the next frame sent with {@see IO_FRAMING_P2PPE_TRAILER}
+ * @return The sequence number
+ */
+uint16_t IO_NextSequence()
+{
+	return sequence;
+}
+
+/**
+ * @brief Fetches the number of frames dropped by {@see IO_SubmitFrame()}
+ * @return The frame count
+ */
+uint32_t IO_DroppedFrames()
+{
+	return droppedFrames;
+}
+
+/**
+ * @brief Determines if a frame sent now would have to wait for the previous transmission
+ * @return Nonzero if the transmitter is busy, zero otherwise
+ */
+uint8_t IO_TransmitBusy()
+{
+#if UART0_USE_DMA_TX
+	return Uart0_DmaTransmitBusy() || !RingBuffer_Empty(uartWriteFifo);
+#else
+	return !RingBuffer_Empty(uartWriteFifo);
+#endif
 }
 
 /**
@@ -201,9 +426,25 @@ void IO_Flush()
  */
 uint8_t IO_HasData()
 {
+#if UART0_USE_DMA_RX
+	Uart0_SyncDmaReceive();
+#endif
 	return !RingBuffer_Empty(uartReadFifo);
 }
 
+/**
+ * @brief Blocks until data is available from IO
+ */
+static inline void IO_BlockWhileEmpty()
+{
+#if UART0_USE_DMA_RX
+	/* the DMA does not update the write index */
+	while (!IO_HasData()) {}
+#else
+	RingBuffer_BlockWhileEmpty(uartReadFifo);
+#endif
+}
+
 /**
  * @brief Reads a byte from IO. 
  * @return The byte or undefined if no data was available.
@@ -214,7 +455,7 @@ uint8_t IO_HasData()
  */
 uint8_t IO_ReadByte()
 {
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	return RingBuffer_Read(uartReadFifo);
 }
 
@@ -228,10 +469,10 @@ uint8_t IO_ReadByte()
  */
 uint16_t IO_ReadInt16()
 {
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	uint8_t high = RingBuffer_Read(uartReadFifo);
 	
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	uint8_t low = RingBuffer_Read(uartReadFifo);
 	return (((uint16_t)high) << 8) | low;
 }
@@ -246,16 +487,16 @@ uint16_t IO_ReadInt16()
  */
 uint32_t IO_ReadInt32()
 {
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	uint32_t value = RingBuffer_Read(uartReadFifo);
 	
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	value = value << 8 | RingBuffer_Read(uartReadFifo);
 	
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	value = value << 8 | RingBuffer_Read(uartReadFifo);
 	
-	RingBuffer_BlockWhileEmpty(uartReadFifo);
+	IO_BlockWhileEmpty();
 	value = value << 8 | RingBuffer_Read(uartReadFifo);
 	return value;
 }
@@ -7,6 +7,7 @@
 
 #include "nice_names.h"
 #include "comm/p2pprotocol.h"
+#include "comm/crc16.h"
 
 /**
  * @brief The length of the default preamble
@@ -104,3 +105,219 @@ void P2PPE_TransmissionPrefixed(register const uint8_t*const prefix, register ui
 #endif
 	sendHandler(EOT);
 }
+
+/**
+ * @brief Encodes a P2PPE frame into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(dataCount)} bytes.
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes
+ */
+uint16_t P2PPE_EncodeFrame(register uint8_t *const frame, register const uint8_t*const data, register uint8_t dataCount)
+{
+	return P2PPE_EncodeFramePrefixed(frame, (uint8_t*)0, 0, data, dataCount);
+}
+
+/**
+ * @brief Encodes a byte into the frame buffer
+ * @param[in] out The write position
+ * @param[in] byte The byte to encode
+ * @return The new write position
+ */
+static inline uint8_t* encodeInto(register uint8_t *out, register uint8_t byte)
+{
+	/* encode special characters; see encodeAndSend() */
+	if (EOT == byte || ESC == byte)
+	{
+		*out++ = ESC;
+		byte ^= ESC_XOR;
+	}
+	
+	*out++ = byte;
+	return out;
+}
+
+/**
+ * @brief Encodes a P2PPE frame with a prefix into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(prefixCount + dataCount)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @return The encoded frame length in bytes
+ */
+uint16_t P2PPE_EncodeFramePrefixed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount)
+{
+	register uint8_t *out = frame;
+	
+	/* preamble and header */
+	for (int i=0; i<DEFAULT_PREAMBLE_LENGTH; ++i)
+	{
+		*out++ = default_preamble[i];
+	}
+	*out++ = SOH;
+	*out++ = dataCount + prefixCount;
+	
+	/* prefix and data */
+	for (int i=0; i<prefixCount; ++i)
+	{
+		out = encodeInto(out, prefix[i]);
+	}
+	for (int i=0; i<dataCount; ++i)
+	{
+		out = encodeInto(out, data[i]);
+	}
+	
+	/* end of transmission */
+	*out++ = EOT;
+	return (uint16_t)(out - frame);
+}
+
+/**
+ * @brief Encodes a P2PPE frame with a prefix and a trailer into a buffer
+ * @param[out] frame The frame buffer; Must hold at least {@see P2PPE_MAX_FRAME_LENGTH(prefixCount + dataCount + P2PPE_TRAILER_LENGTH)} bytes.
+ * @param[in] prefix The prefix data to encode
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to encode
+ * @param[in] dataCount The number of data bytes
+ * @param[in] sequence The sequence number; Truncated to {@see P2PPE_SEQUENCE_BITS}.
+ * @return The encoded frame length in bytes
+ */
+uint16_t P2PPE_EncodeFrameTrailed(register uint8_t *const frame, register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register uint16_t sequence)
+{
+	uint8_t trailer[P2PPE_TRAILER_LENGTH];
+	register uint8_t sequenceCount = 0;
+	trailer[sequenceCount++] = (uint8_t)sequence;
+#if P2PPE_SEQUENCE_BITS == 16
+	trailer[sequenceCount++] = (uint8_t)(sequence >> 8);
+#endif
+	
+	uint16_t crc = CRC16_Update(CRC16_INITIAL, prefix, prefixCount);
+	crc = CRC16_Update(crc, data, dataCount);
+	crc = CRC16_Update(crc, trailer, sequenceCount);
+	trailer[sequenceCount] = (uint8_t)crc;
+	trailer[sequenceCount + 1] = (uint8_t)(crc >> 8);
+	
+	/* encode as usual and move the end of transmission behind the trailer */
+	register uint8_t *out = frame + P2PPE_EncodeFramePrefixed(frame, prefix, prefixCount, data, dataCount) - 1;
+	for (int i=0; i<P2PPE_TRAILER_LENGTH; ++i)
+	{
+		out = encodeInto(out, trailer[i]);
+	}
+	*out++ = EOT;
+	
+	/* the length byte follows preamble and start of header */
+	frame[DEFAULT_PREAMBLE_LENGTH + 1] += P2PPE_TRAILER_LENGTH;
+	return (uint16_t)(out - frame);
+}
+
+/**
+ * @brief The states of the P2PPE decoder
+ */
+enum {
+	DECODE_PREAMBLE = 0,	/*< Awaiting the first preamble byte */
+	DECODE_PREAMBLE2,		/*< Awaiting the second preamble byte */
+	DECODE_SOH,				/*< Awaiting the start of header */
+	DECODE_LENGTH,			/*< Awaiting the payload length */
+	DECODE_DATA,			/*< Awaiting payload bytes */
+	DECODE_EOT,				/*< Awaiting the end of transmission */
+};
+
+/**
+ * @brief Initializes the P2PPE decoder
+ * @param[out] decoder The decoder
+ * @param[in] buffer The payload buffer; Frames with a larger payload are dropped.
+ * @param[in] size The payload buffer size in bytes
+ */
+void P2PPD_Init(register p2ppd_decoder_t *const decoder, register uint8_t *const buffer, register uint8_t size)
+{
+	decoder->buffer = buffer;
+	decoder->size = size;
+	decoder->state = DECODE_PREAMBLE;
+	decoder->length = 0;
+	decoder->count = 0;
+	decoder->escaped = 0;
+}
+
+/**
+ * @brief Resets the P2PPE decoder after a malformed frame
+ * @param[inout] decoder The decoder
+ * @param[in] byte The offending byte; May already start the next preamble.
+ * @return {@see P2PPD_ERROR}
+ */
+static p2ppd_result_t decodeError(register p2ppd_decoder_t *const decoder, register uint8_t byte)
+{
+	decoder->state = (default_preamble[0] == byte) ? DECODE_PREAMBLE2 : DECODE_PREAMBLE;
+	decoder->escaped = 0;
+	return P2PPD_ERROR;
+}
+
+/**
+ * @brief Feeds a received byte to the P2PPE decoder
+ * @param[inout] decoder The decoder
+ * @param[in] byte The received byte
+ * @return {@see P2PPD_FRAME} if the payload of a complete frame is available in the buffer
+ *
+ * On {@see P2PPD_FRAME}, the payload is valid until the next call; Its length is found in {@see p2ppd_decoder_t::count}.
+ * On {@see P2PPD_ERROR}, the decoder resynchronizes on the next preamble.
+ */
+p2ppd_result_t P2PPD_Decode(register p2ppd_decoder_t *const decoder, register uint8_t byte)
+{
+	switch (decoder->state)
+	{
+		case DECODE_PREAMBLE:
+		{
+			if (default_preamble[0] == byte) decoder->state = DECODE_PREAMBLE2;
+			return P2PPD_PENDING;
+		}
+		case DECODE_PREAMBLE2:
+		{
+			if (default_preamble[1] == byte) decoder->state = DECODE_SOH;
+			else if (default_preamble[0] != byte) decoder->state = DECODE_PREAMBLE;
+			return P2PPD_PENDING;
+		}
+		case DECODE_SOH:
+		{
+			if (SOH != byte) return decodeError(decoder, byte);
+			decoder->state = DECODE_LENGTH;
+			return P2PPD_PENDING;
+		}
+		case DECODE_LENGTH:
+		{
+			/* the length is not escaped by the encoder */
+			if (byte > decoder->size) return decodeError(decoder, byte);
+			decoder->length = byte;
+			decoder->count = 0;
+			decoder->escaped = 0;
+			decoder->state = (0 == byte) ? DECODE_EOT : DECODE_DATA;
+			return P2PPD_PENDING;
+		}
+		case DECODE_DATA:
+		{
+			/* an unescaped EOT can only be the end of a truncated frame */
+			if (EOT == byte) return decodeError(decoder, byte);
+			if (ESC == byte)
+			{
+				decoder->escaped = 1;
+				return P2PPD_PENDING;
+			}
+			
+			if (decoder->escaped)
+			{
+				byte ^= ESC_XOR;
+				decoder->escaped = 0;
+			}
+			
+			decoder->buffer[decoder->count++] = byte;
+			if (decoder->count == decoder->length) decoder->state = DECODE_EOT;
+			return P2PPD_PENDING;
+		}
+		case DECODE_EOT:
+		default:
+		{
+			if (EOT != byte) return decodeError(decoder, byte);
+			decoder->state = DECODE_PREAMBLE;
+			return P2PPD_FRAME;
+		}
+	}
+}
@@ -8,72 +8,168 @@
 #ifndef UART_C_
 #define UART_C_
 
-#define UART_115200 115200 /*! UART in 115.2 kbaud mode */
-#define UART_230400 230400 /*! UART in 230.4 kbaud mode */
-#define UART_DEV 0x0815 
-
-/**
- * @brief Configures the UART speed
- */
-#define UART_SPEED_MODE UART_115200
-
-/**
- * @brief Default UART speed mode selection
- */
-#ifndef UART_SPEED_MODE
-#define UART_SPEED_MODE UART_115200
-#endif
-
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
 #include "bme.h"
 
 #include "comm/buffer.h"
 #include "comm/uart.h"
+#include "cpu/ramfunc.h"
+#include "cpu/events.h"
+#include "cpu/instrument.h"
+#include "cpu/irq.h"
+
+#if UART0_USE_DMA_TX || UART0_USE_DMA_RX
+#include "cpu/dma.h"
+#endif
+
+#if UART0_USE_DMA_TX
+
+#if DMA_CHANNEL_UART0_TX != 1
+#error DMA1_Handler expects UART0 transmission on DMA channel 1
+#endif
+#endif
 
 #include "nice_names.h"
 
 buffer_t* uartReadFifo = 0; /*< the read buffer, initialized by Uart0_InitializeIrq() */
 buffer_t* uartWriteFifo = 0; /*< the write buffer, initialized by Uart0_InitializeIrq() */
 
+#if UART0_USE_DMA_TX
+static volatile uint8_t dmaTransmitBusy = 0; /*< nonzero while a DMA transmission is running */
+static const uint8_t *volatile dmaPendingData = 0; /*< the buffer to send after the running transmission, if any */
+static volatile uint16_t dmaPendingLength = 0; /*< the length of the pending buffer */
+
+static void Uart0_StartDmaTransmit(const uint8_t *const data, register uint16_t length);
+#endif
+
+#if UART0_USE_DMA_RX
+#if DMA_CHANNEL_UART0_RX != 2
+#error DMA2_Handler expects UART0 reception on DMA channel 2
+#endif
+
+/**
+ * @brief The transfer count programmed into the receive DMA; Reloaded when it runs out.
+ */
+#define UART0_DMA_RX_COUNT (0x0FFFFFu)
+
+static uint32_t dmaReceiveRemaining = 0; /*< the receive DMA byte count at the last sync */
+#endif
+
+/**
+ * @brief The current baud rate
+ */
+static uint32_t baudRate = 0;
+
+/**
+ * @brief Calculates the baud rate generator settings for a baud rate
+ * @param[in] requested The requested baud rate
+ * @param[out] config The settings
+ * @return Zero if the baud rate can be generated within {@see UART0_MAX_BAUD_ERROR}, nonzero otherwise
+ */
+uint8_t Uart0_CalculateBaud(register uint32_t requested, uart0_baud_t *const config)
+{
+	assert_not_null(config);
+	if (0 == requested) return 1;
+	
+	register uint32_t bestError = 0xFFFFFFFFu;
+	for (register uint32_t ratio = 32; ratio >= 4; --ratio)
+	{
+		/* round to the nearest divisor */
+		register uint32_t sbr = (UART0_CLOCK + (ratio * requested) / 2) / (ratio * requested);
+		if (sbr < 1) sbr = 1;
+		if (sbr > 0x1FFF) continue;
+		
+		const uint32_t actual = UART0_CLOCK / (ratio * sbr);
+		const uint32_t error = (actual > requested) ? (actual - requested) : (requested - actual);
+		if (error < bestError)
+		{
+			bestError = error;
+			config->sbr = (uint16_t)sbr;
+			config->osr = (uint8_t)(ratio - 1);
+			config->baudRate = actual;
+		}
+	}
+	
+	/* both edge sampling is mandatory for ratios 4 to 7 and widens the sampling window at 8 */
+	config->bothEdge = (config->osr <= 7);
+	
+	return (bestError * 1000u > requested * UART0_MAX_BAUD_ERROR);
+}
+
+/**
+ * @brief Writes the baud rate generator settings
+ * @param[in] config The settings
+ *
+ * Transmitter and receiver must be disabled.
+ */
+static void Uart0_WriteBaud(const uart0_baud_t *const config)
+{
+	UART0->BDH =  (0 << UART_BDH_LBKDIE_SHIFT) /* disable line break detect interrupt */
+				| (0 << UART_BDH_RXEDGIE_SHIFT) /* disable RX input active edge interrupt */
+				| (0 << UART_BDH_SBNS_SHIFT) /* use one stop bit */
+				| UART_BDH_SBR((config->sbr & 0x1F00) >> 8); /* set high bits of scaler */
+	UART0->BDL = UART_BDL_SBR(config->sbr & 0x00FF) ; /* set low bits of scaler */
+	
+	/* set oversampling ratio */
+	UART0->C4 &= ~UART0_C4_OSR_MASK;
+	UART0->C4 |= UART0_C4_OSR(config->osr);
+	
+	/* sample on both edges for low oversampling ratios; keeps the DMA enables */
+	if (config->bothEdge)
+	{
+		UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
+	}
+	else
+	{
+		UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+	}
+	
+	baudRate = config->baudRate;
+}
+
+/**
+ * @brief Switches to another baud rate
+ * @param[in] config The settings calculated by {@see Uart0_CalculateBaud()}
+ */
+void Uart0_SetBaud(const uart0_baud_t *const config)
+{
+	assert_not_null(config);
+	
+	/* let the last byte leave the shift register */
+	while (!(UART0->S1 & UART0_S1_TC_MASK)) {}
+	
+	const uint8_t enabled = UART0->C2 & (UART0_C2_TE_MASK | UART0_C2_RE_MASK);
+	UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK;
+	Uart0_WriteBaud(config);
+	UART0->C2 |= enabled;
+}
+
+/**
+ * @brief Fetches the current baud rate
+ * @return The generated baud rate
+ */
+uint32_t Uart0_BaudRate()
+{
+	return baudRate;
+}
+
 /*
- * @brief Sets up the UART0 for 115.2 kbaud on PTA1/RX, PTA2/TX using PLL/2 clocking.
+ * @brief Sets up the UART0 for {@see UART0_BAUD_RATE} on PTA1/RX, PTA2/TX using PLL/2 clocking.
  */
 void InitUart0()
 {
-	/*
-	static const uint32_t uartclk_hz = CORE_CLOCK/2;
-	static const uint32_t baud_rate = 115200U;
-	*/
-	
 #if UART_SPEED_MODE == UART_115200
 #pragma message "Configuring UART0 in 115.200 baud mode."
-	
-	/* 115200 baud: sbr 13, osr 15 is known to work */
-	static const uint16_t sbr = 13U;
-	static const uint8_t osr = 15U;
 #elif UART_SPEED_MODE == UART_230400
 #pragma message "Configuring UART0 in 230.400 baud mode."
-	
-	/* 230400 baud: sbr 7, osr 15 */
-	static const uint16_t sbr = 7U;
-	static const uint8_t osr  = 15U;
-#elif UART_SPEED_MODE == UART_DEV
-	static const uint16_t sbr = 39U;    // 38400 baud
-	static const uint8_t osr  = 15U;
-#else
-#error No UART speed configured
 #endif
 	
-	/*
-	uint32_t calculated_baud = uartclk_hz / ((osr+1)*sbr);
-	int32_t difference = (calculated_baud - baud_rate);
-	if (calculated_baud < baud_rate)
-	{
-		difference = (baud_rate - calculated_baud);
-	}
-	const int8_t valid = difference < (baud_rate/100*3);
-	*/
+	/* 115200 baud yields sbr 8, osr 25 (0.16% error) */
+	uart0_baud_t config;
+	const uint8_t invalid = Uart0_CalculateBaud(UART0_BAUD_RATE, &config);
+	assert(!invalid);
+	(void)invalid;
 	
 	/* enable clock gating to uart0 module */
 	SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
@@ -82,18 +178,8 @@ void InitUart0()
 	UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK;
 	
 	/* set uart clock to PLL/2 clock */
-#if UART_SPEED_MODE == UART_115200
-	SIM->SOPT2 &= ~(SIM_SOPT2_UART0SRC_MASK | SIM_SOPT2_PLLFLLSEL_MASK); 
-	SIM->SOPT2 |= SIM_SOPT2_UART0SRC(0b01U) | SIM_SOPT2_PLLFLLSEL_MASK;
-#elif UART_SPEED_MODE == UART_230400
-	SIM->SOPT2 &= ~(SIM_SOPT2_UART0SRC_MASK | SIM_SOPT2_PLLFLLSEL_MASK); 
-	SIM->SOPT2 |= SIM_SOPT2_UART0SRC(0b01U) | SIM_SOPT2_PLLFLLSEL_MASK;
-#elif UART_SPEED_MODE == UART_DEV
 	SIM->SOPT2 &= ~(SIM_SOPT2_UART0SRC_MASK | SIM_SOPT2_PLLFLLSEL_MASK); 
 	SIM->SOPT2 |= SIM_SOPT2_UART0SRC(0b01U) | SIM_SOPT2_PLLFLLSEL_MASK;
-#else
-#error No UART speed configured
-#endif
 	
 	/* enable clock gating to port A */
 	SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK; /* enable clock to port A (PTA1=rx, PTA2=tx) */
@@ -104,33 +190,8 @@ void InitUart0()
 	PORTA->PCR[2] = PORT_PCR_ISF_MASK | PORT_PCR_MUX(2);	/* alternative 2: TX */
 	
 	/* configure the uart */
-	UART0->BDH =  (0 << UART_BDH_LBKDIE_SHIFT) /* disable line break detect interrupt */
-				| (0 << UART_BDH_RXEDGIE_SHIFT) /* disable RX input active edge interrupt */
-				| (0 << UART_BDH_SBNS_SHIFT) /* use one stop bit */
-				| UART_BDH_SBR((sbr & 0x1F00) >> 8); /* set high bits of scaler */
-	UART0->BDL = UART_BDL_SBR(sbr & 0x00FF) ; /* set low bits of scaler */
-	
-	/* set oversampling ratio */
-	UART0->C4 &= ~UART0_C4_OSR_MASK;
-	UART0->C4 |= UART0_C4_OSR(osr);
-	
-	/* set oversampling ratio when oversampling is between 4 and 7 
-	 * (it is optional for higher oversampling ratios) */
-#if UART_SPEED_MODE == UART_115200
-    UART0->C5 = 0;
-#elif UART_SPEED_MODE == UART_230400
 	UART0->C5 = 0;
-#elif UART_SPEED_MODE == UART_DEV
-	UART0->C5 = 0;
-#else
-	if (osr >= 3 && osr <= 7)
-	{
-		UART0->C5 = UART0_C5_BOTHEDGE_MASK;
-	}
-	else {
-		UART0->C5 = 0;	
-	}
-#endif
+	Uart0_WriteBaud(&config);
 	
 	/* keep default settings for parity and loopback */
 	UART0->C1 = 0;
@@ -167,8 +228,7 @@ void Uart0_InitializeIrq(buffer_t *restrict const receiveFifo, buffer_t *restric
 	Uart0_DisableTransmitIrq();
 	
 	/* prepare interrupts for UART0 */
-	NVIC_ICPR |= 1 << UART0_IRQ;	/* clear pending flag */
-	NVIC_ISER |= 1 << UART0_IRQ;	/* enable interrupt */
+	IRQ_Enable(UART0_IRQ);
 }
 
 /**
@@ -185,6 +245,15 @@ static inline void HandleReceiveInterrupt()
  */
 static inline void HandleTransmitInterrupt()
 {
+#if UART0_USE_DMA_TX
+	/* the DMA owns the data register; DMA1_Handler re-enables the IRQ */
+	if (dmaTransmitBusy)
+	{
+		Uart0_DisableTransmitIrq();
+		return;
+	}
+#endif
+	
 	/* if the buffer is not empty, fetch a byte and send it */
 	if (!RingBuffer_Empty(uartWriteFifo))
 	{
@@ -195,15 +264,28 @@ static inline void HandleTransmitInterrupt()
 	{
 		/* since the buffer was empty, disable the TDRE IRQ */
 		Uart0_DisableTransmitIrq();
+		
+#if UART0_USE_DMA_TX
+		/* a frame queued behind the ring buffer bytes */
+		if (dmaPendingData != 0)
+		{
+			Uart0_StartDmaTransmit(dmaPendingData, dmaPendingLength);
+			dmaPendingData = 0;
+		}
+#endif
 	}
 }
 
 /**
  * @brief IRQ handler for UART0
+ *
+ * Builds at any optimization level since the ring buffer orders its data
+ * accesses for the compiler as well, see {@see RingBuffer_Barrier()}.
  */
-__attribute__((optimize("-O0"))) // fix: no data received in -O3
-void UART0_Handler()
+RAMFUNC void UART0_Handler()
 {
+	INSTRUMENT_ISR(INSTRUMENT_ISR_UART0);
+
     const uint8_t config = UART0->C2;
     const uint8_t status = UART0->S1;
 
@@ -211,12 +293,21 @@ void UART0_Handler()
     if ((config & UART0_C2_RIE_MASK) && (status & UART0_S1_RDRF_MASK))
     {
         HandleReceiveInterrupt();
+        Events_Signal(EVENT_UART_RX);
 
-        // clear flags
-        // TODO: use BME
-        UART0->S1 |= UART0_S1_OR_MASK;  // overrun
+        /* clear the overrun flag only; a read-modify-write would clear the other flags as well */
+        UART0->S1 = UART0_S1_OR_MASK;
     }
 
+#if UART0_USE_DMA_RX
+    /* handle the idle line IRQ; the DMA has stored the burst already */
+    if ((config & UART0_C2_ILIE_MASK) && (status & UART0_S1_IDLE_MASK))
+    {
+        UART0->S1 = UART0_S1_IDLE_MASK | UART0_S1_OR_MASK;
+        Events_Signal(EVENT_UART_RX);
+    }
+#endif
+
 	/* handle the transmitter empty IRQ */
 	if ((config & UART0_C2_TIE_MASK) && (status & UART0_S1_TDRE_MASK))
 	{
@@ -224,4 +315,256 @@ void UART0_Handler()
 	}
 }
 
+#if UART0_USE_DMA_TX
+
+/**
+ * @brief Enables or disables the UART0 transmit DMA request
+ * @param[in] enabled Nonzero to enable, zero to disable
+ */
+static inline void Uart0_SetDmaTransmitRequest(register uint8_t enabled)
+{
+#if !USE_BME
+	if (enabled) UART0->C5 |= UART0_C5_TDMAE_MASK;
+	else UART0->C5 &= ~UART0_C5_TDMAE_MASK;
+#else
+	if (enabled) BME_OR_B(&UART0->C5, (1 << UART0_C5_TDMAE_SHIFT) & UART0_C5_TDMAE_MASK);
+	else BME_AND_B(&UART0->C5, (uint8_t)~((1 << UART0_C5_TDMAE_SHIFT) & UART0_C5_TDMAE_MASK));
+#endif
+}
+
+/**
+ * @brief Routes the UART0 transmit requests to the DMA and enables the DMA channel IRQ.
+ *
+ * Must be called after {@see Uart0_InitializeIrq()}.
+ */
+void Uart0_InitializeDmaTransmit()
+{
+	dmaTransmitBusy = 0;
+	Uart0_SetDmaTransmitRequest(0);
+	
+	/* route the UART0 transmit requests to the DMA channel */
+	DMA_EnableClocks();
+	DMA_RouteSource(DMA_CHANNEL_UART0_TX, DMAMUX_SOURCE_UART0_TX);
+	DMA_ClearDone(DMA_CHANNEL_UART0_TX);
+	
+	/* the destination is always the data register */
+	DMA_DAR_REG(DMA0, DMA_CHANNEL_UART0_TX) = (uint32_t)&UART0->D;
+	
+	/* prepare interrupts for the DMA channel */
+	IRQ_Enable(DMA1_IRQ);
+}
+
+/**
+ * @brief Determines if a DMA transmission is running
+ * @return Nonzero if busy, zero otherwise
+ */
+uint8_t Uart0_DmaTransmitBusy()
+{
+	return dmaTransmitBusy;
+}
+
+/**
+ * @brief Starts or queues a DMA transmission of a buffer.
+ * @param[in] data The data to send; Must stay valid until it was sent.
+ * @param[in] length The number of bytes to send; Must be larger than zero.
+ *
+ * Blocks while another buffer is queued.
+ */
+void Uart0_TransmitDma(const uint8_t *const data, register uint16_t length)
+{
+	while (Uart0_QueueDma(data, length) != 0) {}
+}
+
+/**
+ * @brief Queues a buffer for DMA transmission and returns immediately.
+ * @param[in] data The data to send; Must stay valid until it was sent.
+ * @param[in] length The number of bytes to send; Must be larger than zero.
+ * @return Zero if the buffer was started or queued, nonzero if another buffer is already queued
+ */
+uint8_t Uart0_QueueDma(const uint8_t *const data, register uint16_t length)
+{
+	assert_not_null(data);
+	assert(length > 0);
+	
+	register uint8_t result = 0;
+	__disable_irq();
+	
+	if (dmaPendingData != 0)
+	{
+		result = 1;
+	}
+	else if (!dmaTransmitBusy && RingBuffer_Empty(uartWriteFifo))
+	{
+		Uart0_StartDmaTransmit(data, length);
+	}
+	else
+	{
+		/* started by DMA1_Handler or, after the ring buffer bytes, by the UART0 IRQ */
+		dmaPendingLength = length;
+		dmaPendingData = data;
+	}
+	
+	__enable_irq();
+	return result;
+}
+
+/**
+ * @brief Removes the queued buffer before it was started
+ * @return Nonzero if a buffer was removed and may be reused, zero if none was queued
+ */
+uint8_t Uart0_CancelQueuedDma()
+{
+	__disable_irq();
+	register const uint8_t cancelled = (dmaPendingData != 0);
+	dmaPendingData = 0;
+	__enable_irq();
+	return cancelled;
+}
+
+/**
+ * @brief Determines if a buffer is queued behind the running transmission
+ * @return Nonzero if a buffer is queued, zero otherwise
+ */
+uint8_t Uart0_DmaTransmitQueued()
+{
+	return dmaPendingData != 0;
+}
+
+/**
+ * @brief Starts a DMA transmission
+ * @param[in] data The data to send
+ * @param[in] length The number of bytes to send; Must be larger than zero.
+ *
+ * Must be called with interrupts disabled or from within an IRQ handler,
+ * while no DMA transmission is running and the transmit ring buffer is empty.
+ */
+static void Uart0_StartDmaTransmit(const uint8_t *const data, register uint16_t length)
+{
+	assert_not_null(data);
+	assert(length > 0);
+	
+	dmaTransmitBusy = 1;
+	
+	DMA_ClearDone(DMA_CHANNEL_UART0_TX);
+	DMA_SAR_REG(DMA0, DMA_CHANNEL_UART0_TX) = (uint32_t)data;
+	DMA_DSR_BCR_REG(DMA0, DMA_CHANNEL_UART0_TX) = DMA_DSR_BCR_BCR(length);
+	DMA_DCR_REG(DMA0, DMA_CHANNEL_UART0_TX) = DMA_DCR_EINT_MASK	/* interrupt on completion */
+						| DMA_DCR_ERQ_MASK		/* enable peripheral request */
+						| DMA_DCR_CS_MASK		/* one transfer per request */
+						| DMA_DCR_SINC_MASK		/* increment source */
+						| DMA_DCR_SSIZE(1)		/* 8-bit source */
+						| DMA_DCR_DSIZE(1)		/* 8-bit destination */
+						| DMA_DCR_D_REQ_MASK;	/* clear ERQ when done */
+	
+	/* every TDRE from now on triggers a DMA write to the data register */
+	Uart0_SetDmaTransmitRequest(1);
+}
+
+/**
+ * @brief IRQ handler for DMA channel 1 (UART0 transmission)
+ */
+RAMFUNC void DMA1_Handler()
+{
+	INSTRUMENT_ISR(INSTRUMENT_ISR_DMA1);
+
+	DMA_ClearDone(DMA_CHANNEL_UART0_TX);
+	Uart0_SetDmaTransmitRequest(0);
+	dmaTransmitBusy = 0;
+	
+	/* bytes may have been queued in the ring buffer meanwhile; a queued
+	 * frame follows them, see HandleTransmitInterrupt() */
+	if (!RingBuffer_Empty(uartWriteFifo))
+	{
+		Uart0_EnableTransmitIrq();
+	}
+	else if (dmaPendingData != 0)
+	{
+		Uart0_StartDmaTransmit(dmaPendingData, dmaPendingLength);
+		dmaPendingData = 0;
+	}
+}
+
+#endif /* UART0_USE_DMA_TX */
+
+#if UART0_USE_DMA_RX
+
+/**
+ * @brief Routes the UART0 receive requests to the DMA and enables the idle line IRQ.
+ *
+ * Must be called after {@see Uart0_InitializeIrq()} instead of {@see Uart0_EnableReceiveIrq()}.
+ */
+void Uart0_InitializeDmaReceive()
+{
+	const uint32_t size = uartReadFifo->size;
+	assert(size >= 16 && (size & (size - 1)) == 0);
+	assert(((uint32_t)uartReadFifo->data & (size - 1)) == 0);
+	
+	/* the destination wraps around at the buffer size: 16 bytes is DMOD 1, 32 bytes DMOD 2, ... */
+	register uint32_t modulo = 1;
+	while ((16u << (modulo - 1)) < size) ++modulo;
+	
+	Uart0_DisableReceiveIrq();
+	RingBuffer_Reset(uartReadFifo);
+	dmaReceiveRemaining = UART0_DMA_RX_COUNT;
+	
+	DMA_EnableClocks();
+	DMA_RouteSource(DMA_CHANNEL_UART0_RX, DMAMUX_SOURCE_UART0_RX);
+	DMA_ClearDone(DMA_CHANNEL_UART0_RX);
+	
+	DMA_SAR_REG(DMA0, DMA_CHANNEL_UART0_RX) = (uint32_t)&UART0->D;
+	DMA_DAR_REG(DMA0, DMA_CHANNEL_UART0_RX) = (uint32_t)uartReadFifo->data;
+	DMA_DSR_BCR_REG(DMA0, DMA_CHANNEL_UART0_RX) = DMA_DSR_BCR_BCR(UART0_DMA_RX_COUNT);
+	DMA_DCR_REG(DMA0, DMA_CHANNEL_UART0_RX) = DMA_DCR_EINT_MASK	/* interrupt when the count ran out */
+						| DMA_DCR_ERQ_MASK		/* enable peripheral request */
+						| DMA_DCR_CS_MASK		/* one transfer per request */
+						| DMA_DCR_DINC_MASK		/* increment destination */
+						| DMA_DCR_SSIZE(1)		/* 8-bit source */
+						| DMA_DCR_DSIZE(1)		/* 8-bit destination */
+						| DMA_DCR_DMOD(modulo);	/* circular buffer */
+	
+	/* prepare interrupts for the DMA channel */
+	IRQ_Enable(DMA2_IRQ);
+	
+	/* every RDRF from now on triggers a DMA read; the end of a burst raises IDLE */
+	UART0->S1 = UART0_S1_IDLE_MASK | UART0_S1_OR_MASK;
+	UART0->C5 |= UART0_C5_RDMAE_MASK;
+	UART0->C2 |= UART0_C2_ILIE_MASK;
+}
+
+/**
+ * @brief Publishes the bytes received by DMA in the read buffer
+ */
+void Uart0_SyncDmaReceive()
+{
+	__disable_irq();
+	
+	/* the byte count decrements after each completed transfer */
+	const uint32_t remaining = DMA_DSR_BCR_REG(DMA0, DMA_CHANNEL_UART0_RX) & DMA_DSR_BCR_BCR_MASK;
+	const uint32_t index = uartReadFifo->writeIndex + (dmaReceiveRemaining - remaining);
+	uartReadFifo->writeIndex = index;
+	RingBuffer_TrackPeak(uartReadFifo, index);
+	dmaReceiveRemaining = remaining;
+	
+	__enable_irq();
+}
+
+/**
+ * @brief IRQ handler for DMA channel 2 (UART0 reception)
+ *
+ * Reloads the byte count once it ran out; The destination address keeps wrapping.
+ */
+RAMFUNC void DMA2_Handler()
+{
+	INSTRUMENT_ISR(INSTRUMENT_ISR_DMA2);
+
+	Uart0_SyncDmaReceive();
+	
+	DMA_ClearDone(DMA_CHANNEL_UART0_RX);
+	DMA_DSR_BCR_REG(DMA0, DMA_CHANNEL_UART0_RX) = DMA_DSR_BCR_BCR(UART0_DMA_RX_COUNT);
+	dmaReceiveRemaining = UART0_DMA_RX_COUNT;
+	DMA_DCR_REG(DMA0, DMA_CHANNEL_UART0_RX) |= DMA_DCR_ERQ_MASK;
+}
+
+#endif /* UART0_USE_DMA_RX */
+
 #endif /* UART_C_ */
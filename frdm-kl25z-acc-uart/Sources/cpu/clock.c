@@ -5,11 +5,27 @@
  *      Author: Markus
  */
 
+#include <assert.h>
 #include <stdint.h>
 #include "derivative.h"
 #include "mcg/mcg.h"
 #include "cpu/clock.h"
 
+/**
+ * @brief The current core clock in Hz
+ */
+uint32_t ClockCoreFrequency = CORE_CLOCK;
+
+/**
+ * @brief The current bus clock in Hz
+ */
+uint32_t ClockBusFrequency = BUS_CLOCK;
+
+/**
+ * @brief The current clock level
+ */
+static clock_level_t clockLevel = CLOCK_LEVEL_48MHZ;
+
 /**
  * @brief Initialises the core clock
  * @return none.
@@ -31,4 +47,34 @@ void InitClock()
 
 	pll_init(xtal, LOW_POWER, CRYSTAL, divider, multiplier, MCGOUT);
 	// TODO: assert frequency is correct
+
+	Clock_SetLevel(CLOCK_LEVEL_48MHZ);
+}
+
+/**
+ * @brief Switches the core and bus clock dividers to a clock level
+ * @param[in] level The clock level
+ *
+ * The core divider OUTDIV1 is 1, 2 or 4; The bus and flash divider OUTDIV4
+ * stays at 2, so the flash never exceeds 24 MHz. Both are written at once.
+ */
+void Clock_SetLevel(clock_level_t level)
+{
+	assert(level < CLOCK_LEVEL_COUNT);
+
+	const uint32_t divider = 1u << level;
+	SIM_CLKDIV1 = SIM_CLKDIV1_OUTDIV1(divider - 1) | SIM_CLKDIV1_OUTDIV4(1);
+
+	clockLevel = level;
+	ClockCoreFrequency = CORE_CLOCK / divider;
+	ClockBusFrequency = ClockCoreFrequency / 2u;
+}
+
+/**
+ * @brief Returns the current clock level
+ * @return The level
+ */
+clock_level_t Clock_Level()
+{
+	return clockLevel;
 }
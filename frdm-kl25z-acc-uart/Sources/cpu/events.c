@@ -0,0 +1,13 @@
+/*
+ * events.c
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#include "cpu/events.h"
+
+/**
+ * @brief The pending events
+ */
+volatile uint32_t Events = 0;
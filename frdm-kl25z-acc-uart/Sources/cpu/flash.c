@@ -0,0 +1,121 @@
+/*
+ * flash.c
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+
+#include "cpu/flash.h"
+#include "cpu/ramfunc.h"
+
+/**
+ * @brief The FTFA command codes
+ */
+#define FTFA_CMD_PROGRAM_LONGWORD	(0x06)
+#define FTFA_CMD_ERASE_SECTOR		(0x09)
+
+/**
+ * @brief Launches the command loaded into the FCCOB registers and waits for its completion
+ * @return The FSTAT register after completion
+ *
+ * Must run from SRAM, since the flash is not readable until CCIF is set again.
+ */
+static RAMFUNC uint8_t Flash_Execute()
+{
+	/* launch the command by clearing CCIF */
+	FTFA_BASE_PTR->FSTAT = FTFA_FSTAT_CCIF_MASK;
+	while (0 == (FTFA_BASE_PTR->FSTAT & FTFA_FSTAT_CCIF_MASK)) {}
+
+	return FTFA_BASE_PTR->FSTAT;
+}
+
+/**
+ * @brief Runs a flash command
+ * @param[in] command The FTFA command code
+ * @param[in] address The flash address
+ * @param[in] data The longword argument; Only used by program commands.
+ * @return {@see FLASH_OK} or one of the FLASH_ERROR_* codes
+ */
+static uint8_t Flash_Command(uint8_t command, uint32_t address, uint32_t data)
+{
+	/* a previous command must have completed */
+	while (0 == (FTFA_BASE_PTR->FSTAT & FTFA_FSTAT_CCIF_MASK)) {}
+
+	/* clear the error flags of the previous command */
+	FTFA_BASE_PTR->FSTAT = FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK;
+
+	/* the command, followed by the address and the data, most significant byte first */
+	FTFA_BASE_PTR->FCCOB0 = command;
+	FTFA_BASE_PTR->FCCOB1 = (uint8_t)(address >> 16);
+	FTFA_BASE_PTR->FCCOB2 = (uint8_t)(address >> 8);
+	FTFA_BASE_PTR->FCCOB3 = (uint8_t)(address);
+	FTFA_BASE_PTR->FCCOB4 = (uint8_t)(data >> 24);
+	FTFA_BASE_PTR->FCCOB5 = (uint8_t)(data >> 16);
+	FTFA_BASE_PTR->FCCOB6 = (uint8_t)(data >> 8);
+	FTFA_BASE_PTR->FCCOB7 = (uint8_t)(data);
+
+	/* no flash access (vector fetches included) until the command completes */
+	__disable_irq();
+	const uint8_t status = Flash_Execute();
+	__enable_irq();
+
+	if (status & FTFA_FSTAT_ACCERR_MASK) return FLASH_ERROR_ACCESS;
+	if (status & FTFA_FSTAT_FPVIOL_MASK) return FLASH_ERROR_PROTECTION;
+	if (status & FTFA_FSTAT_MGSTAT0_MASK) return FLASH_ERROR_VERIFY;
+	return FLASH_OK;
+}
+
+/**
+ * @brief Erases a flash sector
+ * @param[in] address The sector aligned address
+ * @return {@see FLASH_OK} or one of the FLASH_ERROR_* codes
+ *
+ * Blocks with interrupts disabled for the duration of the erase (up to 100 ms).
+ */
+uint8_t Flash_EraseSector(uint32_t address)
+{
+	assert(0 == (address & (FLASH_SECTOR_SIZE-1)));
+	return Flash_Command(FTFA_CMD_ERASE_SECTOR, address, 0);
+}
+
+/**
+ * @brief Programs a longword into erased flash
+ * @param[in] address The longword aligned address
+ * @param[in] value The value
+ * @return {@see FLASH_OK} or one of the FLASH_ERROR_* codes
+ */
+uint8_t Flash_ProgramLongword(uint32_t address, uint32_t value)
+{
+	assert(0 == (address & (FLASH_LONGWORD_SIZE-1)));
+	return Flash_Command(FTFA_CMD_PROGRAM_LONGWORD, address, value);
+}
+
+/**
+ * @brief Programs a buffer into erased flash
+ * @param[in] address The longword aligned address
+ * @param[in] data The data
+ * @param[in] length The number of bytes; Must be a multiple of {@see FLASH_LONGWORD_SIZE}.
+ * @return {@see FLASH_OK} or the FLASH_ERROR_* code of the first failing longword
+ */
+uint8_t Flash_Program(uint32_t address, const void *const data, size_t length)
+{
+	assert(0 == (length & (FLASH_LONGWORD_SIZE-1)));
+
+	const uint8_t *bytes = (const uint8_t*)data;
+	for (size_t offset = 0; offset < length; offset += FLASH_LONGWORD_SIZE)
+	{
+		/* the longword is stored in native (little) endianness */
+		uint32_t value;
+		memcpy(&value, &bytes[offset], FLASH_LONGWORD_SIZE);
+
+		const uint8_t status = Flash_ProgramLongword(address + offset, value);
+		if (FLASH_OK != status) return status;
+	}
+	return FLASH_OK;
+}
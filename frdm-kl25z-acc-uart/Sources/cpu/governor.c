@@ -0,0 +1,154 @@
+/*
+ * governor.c
+ *
+ *  Created on: Mar 13, 2014
+ *      Author: Markus
+ */
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+
+#include "cpu/governor.h"
+#include "cpu/delay.h"
+#include "cpu/systick.h"
+#include "cpu/timebase.h"
+#include "i2c/i2c.h"
+#include "i2c/i2casync.h"
+
+/**
+ * @brief The selected mode, a {@see clock_level_t} or {@see GOVERNOR_MODE_AUTOMATIC}
+ */
+static uint8_t mode = GOVERNOR_ENABLED ? GOVERNOR_MODE_AUTOMATIC : CLOCK_LEVEL_48MHZ;
+
+/**
+ * @brief The level to switch to once the I2C bus is idle
+ */
+static clock_level_t targetLevel = CLOCK_LEVEL_48MHZ;
+
+/**
+ * @brief The start of the current measurement period in milliseconds
+ */
+static uint32_t periodStart = 0;
+
+/**
+ * @brief The duty cycle of the last period in permille
+ */
+static uint16_t dutyCycle = 0;
+
+/**
+ * @brief Restarts the measurement, discarding the cycles counted so far
+ */
+static void RestartPeriod()
+{
+	(void)Profile_FetchBusyCycles();
+	periodStart = systemTime();
+}
+
+/**
+ * @brief Switches the clock level and reconfigures the dependent peripherals
+ * @param[in] level The clock level
+ * @return Nonzero if switched, zero if an I2C transaction is queued or running
+ *
+ * The interrupts are disabled throughout, so that no handler starts a transaction
+ * or takes a tick with a mismatching divider. UART0 runs from the PLL and is unaffected.
+ */
+static uint8_t SwitchLevel(clock_level_t level)
+{
+	__disable_irq();
+	if (!I2CAsync_Idle() || 0 != (I2C0->S & I2C_S_BUSY_MASK))
+	{
+		__enable_irq();
+		return 0;
+	}
+
+	Clock_SetLevel(level);
+	SysTick_ApplyClock();
+	Timebase_ApplyClock();
+	I2C_ApplyClock();
+	__enable_irq();
+
+	return 1;
+}
+
+/**
+ * @brief Starts the governor at full speed
+ */
+void Governor_Init()
+{
+	targetLevel = CLOCK_LEVEL_48MHZ;
+	(void)SwitchLevel(targetLevel);
+	RestartPeriod();
+}
+
+/**
+ * @brief Selects a fixed clock level or the automatic clock scaling
+ * @param[in] newMode A {@see clock_level_t} or {@see GOVERNOR_MODE_AUTOMATIC}
+ * @return Zero on success, nonzero if the mode is unknown or automatic scaling is disabled
+ */
+uint8_t Governor_SetMode(uint8_t newMode)
+{
+	if (GOVERNOR_MODE_AUTOMATIC == newMode)
+	{
+		if (!GOVERNOR_ENABLED) return 1;
+
+		/* start from full speed, the load at the fixed level tells nothing */
+		targetLevel = CLOCK_LEVEL_48MHZ;
+	}
+	else if (newMode < CLOCK_LEVEL_COUNT)
+	{
+		targetLevel = (clock_level_t)newMode;
+	}
+	else
+	{
+		return 1;
+	}
+
+	mode = newMode;
+	return 0;
+}
+
+/**
+ * @brief Measures the duty cycle and switches the clock level if required
+ */
+void Governor_Update()
+{
+	if (targetLevel != Clock_Level())
+	{
+		/* the cycles counted at the old clock do not add up with the new ones */
+		if (SwitchLevel(targetLevel)) RestartPeriod();
+		return;
+	}
+
+#if GOVERNOR_ENABLED
+	const uint32_t elapsed = systemTime() - periodStart;
+	if (elapsed < GOVERNOR_PERIOD) return;
+
+	/* one permille of the period in core cycles; The core clock is a multiple of 1 MHz */
+	const uint32_t permille = elapsed * (ClockCoreFrequency / 1000000u);
+	const uint32_t busy = Profile_FetchBusyCycles() / permille;
+	dutyCycle = (busy > 1000u) ? 1000u : (uint16_t)busy;
+	periodStart += elapsed;
+
+	if (GOVERNOR_MODE_AUTOMATIC != mode) return;
+
+	/* race back to full speed, but step down one level at a time */
+	const clock_level_t level = Clock_Level();
+	if (dutyCycle > GOVERNOR_UPSCALE_THRESHOLD && CLOCK_LEVEL_48MHZ != level)
+	{
+		targetLevel = CLOCK_LEVEL_48MHZ;
+	}
+	else if (dutyCycle < GOVERNOR_DOWNSCALE_THRESHOLD && level + 1 < CLOCK_LEVEL_COUNT)
+	{
+		targetLevel = (clock_level_t)(level + 1);
+	}
+#endif
+}
+
+/**
+ * @brief Returns the duty cycle measured over the last period
+ * @return The duty cycle in permille
+ */
+uint16_t Governor_DutyCycle()
+{
+	return dutyCycle;
+}
@@ -0,0 +1,186 @@
+/*
+ * instrument.c
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#include "ARMCM0plus.h"
+#include "cpu/instrument.h"
+#include "cpu/irq.h"
+#include "cpu/dma.h"
+#include "i2c/i2casync.h"
+#include "comm/uart.h"
+
+/**
+ * @brief Linker symbols, see BSP/MKL25Z128xxx4_flash.lds; Only their addresses are meaningful.
+ */
+extern uint32_t _mtb_start[];			/*< The start of the SRAM, where the MTB buffer is placed */
+extern uint32_t end[];					/*< The end of the static data */
+extern uint32_t _estack[];				/*< The initial stack pointer */
+extern uint8_t __stack_size[];			/*< The stack the static data must leave free; An absolute symbol */
+
+#if INSTRUMENT_ENABLED
+
+/**
+ * @brief The bytes below the stack pointer that are left unpainted, for the frame of the painting itself
+ */
+#define INSTRUMENT_PAINT_MARGIN		(32u)
+
+/**
+ * @brief The counters of all interrupt handlers
+ */
+static volatile instrument_isr_counter_t counters[INSTRUMENT_ISR_COUNT];
+
+/**
+ * @brief The IRQ numbers of the instrumented handlers, indexed by {@see instrument_isr_t}
+ */
+static const int8_t irq_numbers[INSTRUMENT_ISR_COUNT] = {
+	SysTick_IRQn, PORTA_IRQ, I2C0_IRQ, DMA0_IRQ, UART0_IRQ, DMA1_IRQ, DMA2_IRQ
+};
+
+/**
+ * @brief Paints the free SRAM between the static data and the stack pointer.
+ */
+void Instrument_PaintStack()
+{
+	register uint32_t *word = end;
+	register uint32_t *const top = (uint32_t*)((__get_MSP() - INSTRUMENT_PAINT_MARGIN) & ~3u);
+
+	while (word < top)
+	{
+		*word++ = INSTRUMENT_STACK_PAINT;
+	}
+}
+
+/**
+ * @brief Fetches the stack usage by scanning for the lowest overwritten paint word
+ * @param[out] stack The stack usage
+ */
+void Instrument_FetchStack(instrument_stack_t *const stack)
+{
+	/* the stack grows down, so the first overwritten word from below is its deepest point */
+	register const uint32_t *word = end;
+	while ((word < _estack) && (INSTRUMENT_STACK_PAINT == *word))
+	{
+		++word;
+	}
+
+	stack->static_size = (uint32_t)end - (uint32_t)_mtb_start;
+	stack->stack_reserved = (uint32_t)__stack_size;
+	stack->stack_used = (uint32_t)_estack - (uint32_t)word;
+	stack->untouched = (uint32_t)word - (uint32_t)end;
+}
+
+/**
+ * @brief Records the cycles an interrupt handler took
+ * @param[in] scope The scope opened by {@see INSTRUMENT_ISR}
+ */
+RAMFUNC void Instrument_IsrExit(register const instrument_isr_scope_t *const scope)
+{
+	/* the SysTick counts down and reloads once per tick */
+	register const uint32_t now = SysTick_BASE_PTR->CVR;
+	register const uint32_t cycles = (scope->start >= now)
+		? scope->start - now
+		: scope->start + SysTick_BASE_PTR->RVR + 1 - now;
+
+	register volatile instrument_isr_counter_t *const counter = &counters[scope->isr];
+	++counter->count;
+	counter->cycles += cycles;
+	if (cycles > counter->max) counter->max = (cycles > 0xFFFF) ? 0xFFFF : (uint16_t)cycles;
+
+	/* the tick pended as the counter reloaded */
+	if (INSTRUMENT_ISR_SYSTICK == scope->isr)
+	{
+		register const uint32_t latency = SysTick_BASE_PTR->RVR - scope->start;
+		if (latency > counter->latency) counter->latency = (latency > 0xFFFF) ? 0xFFFF : (uint16_t)latency;
+	}
+}
+
+/**
+ * @brief Fetches and resets the counters of all interrupt handlers
+ * @param[out] result The counters accumulated since the last fetch, indexed by {@see instrument_isr_t}
+ */
+void Instrument_FetchIsrs(instrument_isr_counter_t result[INSTRUMENT_ISR_COUNT])
+{
+	__disable_irq();
+
+	for (int i = 0; i < INSTRUMENT_ISR_COUNT; ++i)
+	{
+		result[i].count = counters[i].count;
+		result[i].cycles = counters[i].cycles;
+		result[i].max = counters[i].max;
+		result[i].latency = counters[i].latency;
+
+		counters[i].count = 0;
+		counters[i].cycles = 0;
+		counters[i].max = 0;
+		counters[i].latency = 0;
+	}
+
+	__enable_irq();
+
+	/* bound the latencies of the others from the measured maxima */
+	register const uint32_t masked = result[INSTRUMENT_ISR_SYSTICK].latency;
+	for (int i = 0; i < INSTRUMENT_ISR_COUNT; ++i)
+	{
+		if (INSTRUMENT_ISR_SYSTICK == i) continue;
+
+		register const uint8_t priority = IRQ_Priority(irq_numbers[i]);
+		uint32_t higher = 0, same = 0;
+		for (int j = 0; j < INSTRUMENT_ISR_COUNT; ++j)
+		{
+			register const uint8_t other = IRQ_Priority(irq_numbers[j]);
+			if (other < priority) higher += result[j].max;
+			else if ((other == priority) && (j != i) && (result[j].max > same)) same = result[j].max;
+		}
+
+		register const uint32_t latency = masked + higher + same;
+		result[i].latency = (latency > 0xFFFF) ? 0xFFFF : (uint16_t)latency;
+	}
+}
+
+#else
+
+void Instrument_PaintStack() {}
+
+void Instrument_FetchStack(instrument_stack_t *const stack)
+{
+	stack->static_size = (uint32_t)end - (uint32_t)_mtb_start;
+	stack->stack_reserved = (uint32_t)__stack_size;
+	stack->stack_used = 0;
+	stack->untouched = 0;
+}
+
+void Instrument_FetchIsrs(instrument_isr_counter_t result[INSTRUMENT_ISR_COUNT])
+{
+	for (int i = 0; i < INSTRUMENT_ISR_COUNT; ++i)
+	{
+		result[i].count = result[i].cycles = result[i].max = result[i].latency = 0;
+	}
+}
+
+#endif /* INSTRUMENT_ENABLED */
+
+#if INSTRUMENT_TRACE_ENABLED
+
+/**
+ * @brief The trace buffer, see sa_mtb.c
+ */
+extern unsigned char mtb_buf[__SA_MTB_SIZE];
+
+/**
+ * @brief Configures the MTB to capture into the buffer reserved in sa_mtb.c, stopped.
+ *
+ * The buffer wraps at its size, which must be a power of two of at least 16 bytes;
+ * It lies at the start of the SRAM, so it is aligned to its size.
+ */
+void Instrument_InitTrace()
+{
+	MTB_MASTER = 0;
+	MTB_FLOW = 0;
+	MTB_POSITION = MTB_POSITION_POINTER(((uint32_t)mtb_buf - MTB_BASE) >> MTB_POSITION_POINTER_SHIFT);
+	MTB_MASTER = MTB_MASTER_MASK(__builtin_ctz(__SA_MTB_SIZE) - 4);
+}
+
+#endif /* INSTRUMENT_TRACE_ENABLED */
@@ -0,0 +1,63 @@
+/*
+ * irq.c
+ *
+ *  Created on: Mar 11, 2014
+ *      Author: Markus
+ */
+
+#include "cpu/irq.h"
+#include "cpu/dma.h"
+#include "i2c/i2casync.h"
+#include "comm/uart.h"
+#include "nice_names.h"
+
+#if IRQ_PRIORITY_LEVELS > (1 << __NVIC_PRIO_BITS)
+#error The priority scheme uses more levels than the NVIC implements
+#endif
+
+/**
+ * @brief Fetches the priority of an interrupt
+ * @param[in] irq The IRQ number; {@see SysTick_IRQn} for the SysTick.
+ * @return The priority, zero being the highest
+ */
+uint8_t IRQ_Priority(int8_t irq)
+{
+	switch (irq)
+	{
+		case SysTick_IRQn:
+		case PORTA_IRQ:
+			return IRQ_PRIORITY_SAMPLE;
+
+		case I2C0_IRQ:
+		case DMA0_IRQ:
+			return IRQ_PRIORITY_TRANSFER;
+
+		case UART0_IRQ:
+		case DMA1_IRQ:
+		case DMA2_IRQ:
+		default:
+			return IRQ_PRIORITY_COMMUNICATION;
+	}
+}
+
+/**
+ * @brief Assigns the priority of an interrupt according to the scheme
+ * @param[in] irq The IRQ number; {@see SysTick_IRQn} for the SysTick.
+ */
+void IRQ_Configure(int8_t irq)
+{
+	NVIC_SetPriority((IRQn_Type)irq, IRQ_Priority(irq));
+}
+
+/**
+ * @brief Assigns the priority, clears the pending flag and enables an interrupt
+ * @param[in] irq The IRQ number (not exception number!)
+ */
+void IRQ_Enable(int8_t irq)
+{
+	assert(irq >= 0);
+
+	IRQ_Configure(irq);
+	NVIC_ICPR = 1 << irq;	/* clear pending flag */
+	NVIC_ISER = 1 << irq;	/* enable interrupt */
+}
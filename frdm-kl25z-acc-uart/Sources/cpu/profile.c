@@ -0,0 +1,123 @@
+/*
+ * profile.c
+ *
+ *  Created on: Mar 9, 2014
+ *      Author: Markus
+ */
+
+#include "cpu/profile.h"
+#include "comm/io.h"
+
+#if PROFILE_ENABLED
+
+/**
+ * @brief Cycle statistics of a stage within the current report period
+ */
+typedef struct {
+	uint32_t min;						/*< The minimum cycle count */
+	uint32_t max;						/*< The maximum cycle count */
+	uint32_t sum;						/*< The sum of the cycle counts; Fits one second worth of cycles. */
+	uint16_t count;						/*< The number of samples */
+} profile_counter_t;
+
+/**
+ * @brief The counters of all stages
+ */
+static profile_counter_t counters[PROFILE_STAGE_COUNT];
+
+/**
+ * @brief Adds a cycle count to the statistics of a stage
+ * @param[in] stage The stage
+ * @param[in] cycles The number of cycles the stage took
+ */
+static inline void Profile_Count(register profile_stage_t stage, register uint32_t cycles)
+{
+	register profile_counter_t *const counter = &counters[stage];
+
+	/* drop samples rather than wrapping if the report is overdue */
+	if (0xFFFF == counter->count) return;
+
+	if (0 == counter->count || cycles < counter->min) counter->min = cycles;
+	if (0 == counter->count || cycles > counter->max) counter->max = cycles;
+	counter->sum += cycles;
+	++counter->count;
+}
+
+#endif /* PROFILE_ENABLED */
+
+#if PROFILE_SECTIONS_ENABLED
+
+/**
+ * @brief The cycles of the stages bound by the core since the last fetch
+ */
+static uint32_t busyCycles = 0;
+
+/**
+ * @brief Records a cycle count for a stage
+ * @param[in] stage The stage
+ * @param[in] cycles The number of cycles the stage took
+ */
+void Profile_Record(register profile_stage_t stage, register uint32_t cycles)
+{
+	if (PROFILE_STAGE_I2C_READ != stage) busyCycles += cycles;
+
+#if PROFILE_ENABLED
+	Profile_Count(stage, cycles);
+#endif
+}
+
+/**
+ * @brief Fetches and resets the cycles the core spent on the stages bound by it
+ * @return The cycles since the last fetch
+ */
+uint32_t Profile_FetchBusyCycles()
+{
+	register const uint32_t cycles = busyCycles;
+	busyCycles = 0;
+	return cycles;
+}
+
+#else
+
+void Profile_Record(register profile_stage_t stage, register uint32_t cycles) {}
+uint32_t Profile_FetchBusyCycles() { return 0; }
+
+#endif /* PROFILE_SECTIONS_ENABLED */
+
+#if PROFILE_ENABLED
+
+/**
+ * @brief Sends one P2PPE frame per stage with samples and resets the counters.
+ */
+void Profile_Report()
+{
+	for (uint8_t stage = 0; stage < PROFILE_STAGE_COUNT; ++stage)
+	{
+		profile_counter_t *const counter = &counters[stage];
+		if (0 == counter->count) continue;
+
+		const uint8_t prefix[2] = { PROFILE_FRAME_TYPE, stage };
+		struct {
+			uint16_t count;
+			uint32_t min;
+			uint32_t avg;
+			uint32_t max;
+		} __attribute__((packed)) report = {
+			counter->count,
+			counter->min,
+			counter->sum / counter->count,
+			counter->max
+		};
+
+		IO_SendFrame(prefix, sizeof(prefix), (const uint8_t*)&report, sizeof(report));
+
+		counter->count = 0;
+		counter->sum = 0;
+	}
+}
+
+#else
+
+void Profile_Report() {}
+
+#endif /* PROFILE_ENABLED */
@@ -8,7 +8,11 @@
 #include "derivative.h"
 
 #include "cpu/clock.h"
+#include "cpu/ramfunc.h"
 #include "cpu/systick.h"
+#include "cpu/events.h"
+#include "cpu/instrument.h"
+#include "cpu/irq.h"
 
 /**
  * @brief Initializes the SysTick interrupt
@@ -20,28 +24,44 @@
 void InitSysTick()
 {
 	/* see Cortex-M0+ Devices Generic User Guide, Section 4.4 */
-	SysTick_BASE_PTR->RVR = CORE_CLOCK/SYSTICK_FREQUENCY - 1;	/* set the reload value */
+	SysTick_BASE_PTR->RVR = ClockCoreFrequency/SYSTICK_FREQUENCY - 1;	/* set the reload value */
 	SysTick_BASE_PTR->CSR = SysTick_CSR_ENABLE_MASK				/* enable the systick timer */ 
 							| SysTick_CSR_TICKINT_MASK 			/* enable interrupt if timer reaches zero */
 							| SysTick_CSR_CLKSOURCE_MASK;		/* use processor clock instead of external clock */
+
+	/* the tick shares the highest priority with the sensor data ready latch */
+	IRQ_Configure(SysTick_IRQn);
 }
 
 /**
- * @brief The system tick counter
+ * @brief Adapts the reload value to the current core clock
+ *
+ * Must be called with the interrupts disabled. The counter restarts, so that
+ * it never exceeds the new reload value; The current tick is cut short.
  */
-volatile uint32_t SystemMilliseconds = 0;
+void SysTick_ApplyClock()
+{
+	SysTick_BASE_PTR->RVR = ClockCoreFrequency/SYSTICK_FREQUENCY - 1;
+	SysTick_BASE_PTR->CVR = 0;	/* any write clears the counter */
+}
 
 /**
- * @brief 250µs Counter
+ * @brief The system tick counter
  */
-static uint32_t freeRunner = 0;
+volatile uint32_t SystemMilliseconds = 0;
+
+#if SYSTICK_FREQUENCY != 1000u
+#error SysTick_Handler expects a 1 ms tick
+#endif
 
 /**
  * @brief The SysTick interrupt handler
  * @return none.
  */
-void SysTick_Handler() 
+RAMFUNC void SysTick_Handler()
 {
-	SystemMilliseconds += ((++freeRunner) & 0b100) >> 2;
-	freeRunner &= 0b11;
+	INSTRUMENT_ISR(INSTRUMENT_ISR_SYSTICK);
+
+	++SystemMilliseconds;
+	Events_Signal(EVENT_TICK);
 }
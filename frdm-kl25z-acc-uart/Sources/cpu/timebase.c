@@ -0,0 +1,53 @@
+/*
+ * timebase.c
+ *
+ *  Created on: Mar 8, 2014
+ *      Author: Markus
+ */
+
+#include "derivative.h"
+
+#include "cpu/clock.h"
+#include "cpu/timebase.h"
+
+#include "nice_names.h"
+
+#if (BUS_CLOCK % TIMEBASE_FREQUENCY) != 0 || (BUS_CLOCK_MIN % TIMEBASE_FREQUENCY) != 0
+#error The bus clock must be a multiple of the timebase frequency at every clock level
+#endif
+
+/**
+ * @brief Starts the PIT timebase
+ *
+ * \par Channel 0 expires every microsecond, channel 1 is chained to it
+ * and counts down over the full 32 bit range. No interrupts are used.
+ */
+void InitTimebase()
+{
+	/* enable clock gating to the PIT and enable the module */
+	SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+	PIT_MCR = PIT_MCR_FRZ_MASK;						/* stop the timers in debug mode */
+	
+	/* channels must be disabled while reconfiguring */
+	PIT_TCTRL1 = 0;
+	PIT_TCTRL0 = 0;
+	
+	/* channel 1 counts the expirations of channel 0 */
+	PIT_LDVAL1 = 0xFFFFFFFFu;
+	PIT_TCTRL1 = PIT_TCTRL_CHN_MASK | PIT_TCTRL_TEN_MASK;
+	
+	/* channel 0 divides the bus clock down to the timebase frequency */
+	PIT_LDVAL0 = ClockBusFrequency/TIMEBASE_FREQUENCY - 1;
+	PIT_TCTRL0 = PIT_TCTRL_TEN_MASK;
+}
+
+/**
+ * @brief Adapts the divider of channel 0 to the current bus clock
+ *
+ * The new load value takes effect when the current microsecond expires,
+ * so the count neither stops nor jumps.
+ */
+void Timebase_ApplyClock()
+{
+	PIT_LDVAL0 = ClockBusFrequency/TIMEBASE_FREQUENCY - 1;
+}
@@ -0,0 +1,182 @@
+#include <stddef.h>
+
+#include "fusion/complementary_filter.h"
+#include "fusion/fix16_fast.h"
+
+/*!
+* \def cf_mul Multiplication used in the filter; Maps to {\ref fix16_fast_mul} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+#if FIX16_FAST_KERNELS
+#define cf_mul(a, b)    fix16_fast_mul((a), (b))
+#else
+#define cf_mul(a, b)    fix16_mul((a), (b))
+#endif
+
+/*!
+* \brief Normalizes a vector in place
+* \param[inout] v The vector
+*/
+HOT NONNULL
+STATIC_INLINE void normalize(register v3d *const v)
+{
+    register const fix16_t norm2 = fix16_add(cf_mul(v->x, v->x), fix16_add(cf_mul(v->y, v->y), cf_mul(v->z, v->z)));
+    if (0 == norm2) return;
+
+#if FIX16_FAST_KERNELS
+    register const fix16_t inv_norm = fix16_fast_rsqrt(norm2);
+    v->x = fix16_fast_mul(v->x, inv_norm);
+    v->y = fix16_fast_mul(v->y, inv_norm);
+    v->z = fix16_fast_mul(v->z, inv_norm);
+#else
+    register const fix16_t norm = fix16_sqrt(norm2);
+    v->x = fix16_div(v->x, norm);
+    v->y = fix16_div(v->y, norm);
+    v->z = fix16_div(v->z, norm);
+#endif
+}
+
+/*!
+* \brief Calculates the cross product a x b
+* \param[out] result The cross product
+* \param[in] a The left operand
+* \param[in] b The right operand
+*/
+HOT NONNULL
+STATIC_INLINE void cross(register v3d *RESTRICT const result, register const v3d *const a, register const v3d *const b)
+{
+    result->x = fix16_sub(cf_mul(a->y, b->z), cf_mul(a->z, b->y));
+    result->y = fix16_sub(cf_mul(a->z, b->x), cf_mul(a->x, b->z));
+    result->z = fix16_sub(cf_mul(a->x, b->y), cf_mul(a->y, b->x));
+}
+
+/*!
+* \brief Integrates a DCM row with dc/dt = w x c
+* \param[inout] c The row
+* \param[in] w The angular velocity in rad/s
+* \param[in] deltaT The time difference in seconds
+*/
+HOT NONNULL
+STATIC_INLINE void integrate(register v3d *const c, register const v3d *const w, register const fix16_t deltaT)
+{
+    v3d d_c;
+    cross(&d_c, w, c);
+
+    c->x = fix16_add(c->x, cf_mul(d_c.x, deltaT));
+    c->y = fix16_add(c->y, cf_mul(d_c.y, deltaT));
+    c->z = fix16_add(c->z, cf_mul(d_c.z, deltaT));
+}
+
+/*!
+* \brief Re-normalizes the rows and re-orthogonalizes C2 against C3; The attitude is the better observed row.
+* \param[inout] filter The filter
+*/
+HOT NONNULL
+STATIC_INLINE void orthonormalize(register complementary_filter_t *const filter)
+{
+    normalize(&filter->c3);
+
+    register const fix16_t dot = fix16_add(cf_mul(filter->c2.x, filter->c3.x), fix16_add(cf_mul(filter->c2.y, filter->c3.y), cf_mul(filter->c2.z, filter->c3.z)));
+    filter->c2.x = fix16_sub(filter->c2.x, cf_mul(dot, filter->c3.x));
+    filter->c2.y = fix16_sub(filter->c2.y, cf_mul(dot, filter->c3.y));
+    filter->c2.z = fix16_sub(filter->c2.z, cf_mul(dot, filter->c3.z));
+
+    normalize(&filter->c2);
+}
+
+/*!
+* \brief Resets the rows to the initial orientation and clears the rate and the integrated error.
+* \param[out] filter The filter
+*/
+void complementary_filter_initialize(register complementary_filter_t *const filter)
+{
+    filter->c3.x = 0;
+    filter->c3.y = 0;
+    filter->c3.z = F16(1);
+
+    filter->c2.x = 0;
+    filter->c2.y = F16(1);
+    filter->c2.z = 0;
+
+    filter->rate.x = filter->rate.y = filter->rate.z = 0;
+    filter->integral[0] = filter->integral[1] = filter->integral[2] = 0;
+}
+
+/*!
+* \brief Sets the rows, e.g. to continue from the state of another filter.
+* \param[inout] filter The filter
+* \param[in] c3 The attitude DCM row
+* \param[in] c2 The orientation DCM row
+*/
+void complementary_filter_set_rows(register complementary_filter_t *const filter, register const fix16_t *const c3, register const fix16_t *const c2)
+{
+    filter->c3.x = c3[0];
+    filter->c3.y = c3[1];
+    filter->c3.z = c3[2];
+
+    filter->c2.x = c2[0];
+    filter->c2.y = c2[1];
+    filter->c2.z = c2[2];
+}
+
+/*!
+* \brief Integrates the rows with the rate of the last correction.
+* \param[inout] filter The filter
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*/
+void complementary_filter_predict(register complementary_filter_t *const filter, register const fix16_t deltaT)
+{
+    integrate(&filter->c3, &filter->rate, deltaT);
+    integrate(&filter->c2, &filter->rate, deltaT);
+    orthonormalize(filter);
+}
+
+/*!
+* \brief Corrects the rows and the rate for the next predictions.
+* \param[inout] filter The filter
+* \param[in] gyro The gyroscope data in rad/s
+* \param[in] c3 The observed attitude row; May be <code>NULL</code>.
+* \param[in] c2 The observed orientation row; May be <code>NULL</code>.
+* \param[in] deltaT The time in seconds the observations account for, i.e. since the last correction.
+*/
+void complementary_filter_correct(register complementary_filter_t *const filter, register const v3d *const gyro, register const v3d *const c3, register const v3d *const c2, register const fix16_t deltaT)
+{
+    if ((NULL != c3) || (NULL != c2))
+    {
+        // with dc/dt = w x c, a rate along c x c_observed turns c towards c_observed
+        v3d error = { 0, 0, 0 };
+        if (NULL != c3)
+        {
+            cross(&error, &filter->c3, c3);
+        }
+        if (NULL != c2)
+        {
+            v3d e2;
+            cross(&e2, &filter->c2, c2);
+            error.x = fix16_add(error.x, e2.x);
+            error.y = fix16_add(error.y, e2.y);
+            error.z = fix16_add(error.z, e2.z);
+        }
+
+        // integral term; ki * dt * e is Q48 >> 16 = Q32.
+        register const int64_t ki_dt = (int64_t)filter->ki * deltaT;
+        filter->integral[0] += (ki_dt * error.x) >> 16;
+        filter->integral[1] += (ki_dt * error.y) >> 16;
+        filter->integral[2] += (ki_dt * error.z) >> 16;
+
+        // proportional term, applied over the whole interval at once so that sparse
+        // corrections are as effective as frequent ones; kp * dt must stay below one.
+        v3d correction;
+        correction.x = cf_mul(filter->kp, error.x);
+        correction.y = cf_mul(filter->kp, error.y);
+        correction.z = cf_mul(filter->kp, error.z);
+
+        integrate(&filter->c3, &correction, deltaT);
+        integrate(&filter->c2, &correction, deltaT);
+        orthonormalize(filter);
+    }
+
+    // w = gyro + ki * integral(e)
+    filter->rate.x = fix16_add(gyro->x, (fix16_t)(filter->integral[0] >> 16));
+    filter->rate.y = fix16_add(gyro->y, (fix16_t)(filter->integral[1] >> 16));
+    filter->rate.z = fix16_add(gyro->z, (fix16_t)(filter->integral[2] >> 16));
+}
@@ -0,0 +1,257 @@
+/*
+* fix16_fast.c
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#include "fusion/fix16_fast.h"
+
+/************************************************************************/
+/* Reciprocal square root                                               */
+/************************************************************************/
+
+/*!
+* \brief Initial guesses for 1/sqrt(m), m in [1..4), sampled at the center of each 1/8 interval.
+*/
+static const uint16_t rsqrt_table[24] = {
+    63579, 60140, 57205, 54661, 52429, 50450, 48679, 47082,
+    45633, 44310, 43096, 41977, 40940, 39977, 39078, 38238,
+    37449, 36708, 36008, 35347, 34722, 34128, 33564, 33027
+};
+
+/*!
+* \brief Calculates the reciprocal square root of a value.
+* \param[in] x The value; Must be positive.
+* \return 1/sqrt(x) or fix16_maximum if x is not positive.
+*/
+HOT CONST RAMFUNC
+fix16_t fix16_fast_rsqrt(register fix16_t x)
+{
+    if (x <= 0) return fix16_maximum;
+
+    // normalize to m = x * 4^shift in [1..4), so that 1/sqrt(x) = 2^shift / sqrt(m).
+    // the M0+ has no CLZ, but the fusion only normalizes values close to one.
+    register uint32_t m = (uint32_t)x;
+    register int_fast8_t shift = 0;
+    while (m < 0x10000u)
+    {
+        m <<= 2;
+        ++shift;
+    }
+    while (m >= 0x40000u)
+    {
+        m >>= 2;
+        --shift;
+    }
+
+    // initial guess has a relative error below 3%, two Newton steps
+    // y' = y * (3 - m*y^2) / 2 bring that down to the fix16 resolution.
+    register fix16_t y = rsqrt_table[(m - 0x10000u) >> 13];
+    y = fix16_fast_mul(y, F16(3) - fix16_fast_mul((fix16_t)m, fix16_fast_mul(y, y))) >> 1;
+    y = fix16_fast_mul(y, F16(3) - fix16_fast_mul((fix16_t)m, fix16_fast_mul(y, y))) >> 1;
+
+    return (shift >= 0) ? (y << shift) : (y >> -shift);
+}
+
+/************************************************************************/
+/* Arc tangent                                                          */
+/************************************************************************/
+
+/*!
+* \brief Minimax coefficients for atan(z), z in [0..1] (Abramowitz & Stegun 4.4.49)
+*/
+static const fix16_t atan_c1 = F16(0.9998660);
+static const fix16_t atan_c3 = F16(-0.3302995);
+static const fix16_t atan_c5 = F16(0.1801410);
+static const fix16_t atan_c7 = F16(-0.0851330);
+static const fix16_t atan_c9 = F16(0.0208351);
+
+/*!
+* \brief Calculates the four-quadrant arc tangent of y/x.
+* \param[in] y The y coordinate
+* \param[in] x The x coordinate
+* \return The angle in radians, [-pi..pi]
+*/
+HOT CONST
+fix16_t fix16_fast_atan2(register fix16_t y, register fix16_t x)
+{
+    register uint32_t ax = (uint32_t)fix16_abs(x);
+    register uint32_t ay = (uint32_t)fix16_abs(y);
+    if (0 == ax && 0 == ay) return 0;
+
+    // fold into the first octant
+    const uint_fast8_t swapped = ay > ax;
+    register uint32_t num = swapped ? ax : ay;
+    register uint32_t den = swapped ? ay : ax;
+
+    // scale the denominator to [2^14..2^15), so that the quotient
+    // can be formed with a plain unsigned division instead of fix16_div.
+    while (den >= 0x8000u)
+    {
+        den >>= 1;
+        num >>= 1;
+    }
+    while (den < 0x4000u)
+    {
+        den <<= 1;
+        num <<= 1;
+    }
+
+    register const fix16_t z  = (fix16_t)((num << 16) / den);
+    register const fix16_t z2 = fix16_fast_mul(z, z);
+
+    register fix16_t angle = atan_c9;
+    angle = fix16_fast_mul(z2, angle) + atan_c7;
+    angle = fix16_fast_mul(z2, angle) + atan_c5;
+    angle = fix16_fast_mul(z2, angle) + atan_c3;
+    angle = fix16_fast_mul(z2, angle) + atan_c1;
+    angle = fix16_fast_mul(z, angle);
+
+    // unfold
+    if (swapped) angle = (fix16_pi >> 1) - angle;
+    if (x < 0) angle = fix16_pi - angle;
+    return (y < 0) ? -angle : angle;
+}
+
+/************************************************************************/
+/* Verification                                                         */
+/************************************************************************/
+
+/*!
+* \brief Normalizes a three component vector with the libfixmath reference implementations.
+*/
+COLD
+static void normalize3_reference(fix16_t *const a, fix16_t *const b, fix16_t *const c)
+{
+    const fix16_t norm = fix16_sqrt(fix16_add(fix16_sq(*a), fix16_add(fix16_sq(*b), fix16_sq(*c))));
+    *a = fix16_div(*a, norm);
+    *b = fix16_div(*b, norm);
+    *c = fix16_div(*c, norm);
+}
+
+/*!
+* \brief Verifies the fast path kernels against the libfixmath reference implementations.
+* \return Zero if all kernels are within tolerance, the number of the first failing kernel otherwise.
+*/
+COLD
+uint8_t fix16_fast_verify()
+{
+    // 1: multiplication, pseudo random operands in [-8..8)
+    {
+        uint32_t seed = 0x1234567u;
+        for (int i = 0; i < 512; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const fix16_t a = (fix16_t)seed >> 12;
+            seed = seed * 1664525u + 1013904223u;
+            const fix16_t b = (fix16_t)seed >> 12;
+
+            if (fix16_abs(fix16_fast_mul(a, b) - fix16_mul(a, b)) > 1) return 1;
+        }
+    }
+
+    // 2: square root, [1/256..64]
+    for (fix16_t x = F16(1.0/256); x < F16(64); x += (x >> 5) + 1)
+    {
+        const fix16_t reference = fix16_sqrt(x);
+        const fix16_t tolerance = (reference >> 13) + 2;
+        if (fix16_abs(fix16_fast_sqrt(x) - reference) > tolerance) return 2;
+    }
+
+    // 3: arc tangent, full circle at varying radii
+    for (fix16_t angle = -F16(3.1); angle < F16(3.1); angle += F16(0.01))
+    {
+        const fix16_t radius = F16(0.5) + fix16_abs(angle);
+        const fix16_t y = fix16_mul(radius, fix16_sin(angle));
+        const fix16_t x = fix16_mul(radius, fix16_cos(angle));
+        if (fix16_abs(fix16_fast_atan2(y, x) - angle) > F16(0.001)) return 3;
+    }
+
+    // 4: arc sine, away from the poles where asin is ill-conditioned
+    for (fix16_t angle = -F16(1.4); angle < F16(1.4); angle += F16(0.01))
+    {
+        if (fix16_abs(fix16_fast_asin(fix16_sin(angle)) - angle) > F16(0.002)) return 4;
+    }
+
+    // 5: overflow accumulating addition and subtraction, against the exact 64 bit results
+    {
+        const fix16_t operands[] = { 0, 1, -1, F16(1), -F16(1), F16(16384), -F16(16384), fix16_maximum, fix16_minimum };
+        const uint_fast8_t count = sizeof(operands) / sizeof(operands[0]);
+        for (uint_fast8_t i = 0; i < count; ++i)
+        {
+            for (uint_fast8_t j = 0; j < count; ++j)
+            {
+                const int64_t sum = (int64_t)operands[i] + operands[j];
+                const int64_t difference = (int64_t)operands[i] - operands[j];
+
+                uint32_t overflow = 0;
+                const fix16_t fast_sum = fix16_fast_add(operands[i], operands[j], &overflow);
+                if (fix16_fast_overflowed(overflow) != (sum != (fix16_t)sum)) return 5;
+                if (!fix16_fast_overflowed(overflow) && fast_sum != sum) return 5;
+
+                overflow = 0;
+                const fix16_t fast_difference = fix16_fast_sub(operands[i], operands[j], &overflow);
+                if (fix16_fast_overflowed(overflow) != (difference != (fix16_t)difference)) return 5;
+                if (!fix16_fast_overflowed(overflow) && fast_difference != difference) return 5;
+            }
+        }
+    }
+
+    // 6: bounded operand multiplication, [-1..1] times [-8..8), against the reference
+    {
+        uint32_t seed = 0x89ABCDEu;
+        for (int i = 0; i < 512; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const fix16_t u = (fix16_t)seed >> 15;
+            seed = seed * 1664525u + 1013904223u;
+            const fix16_t b = (fix16_t)seed >> 12;
+
+            if (fix16_abs(fix16_fast_mul_unit(u, b) - fix16_mul(u, b)) > 2) return 6;
+        }
+
+        // the extremes of the bounded operand
+        const fix16_t bounds[] = { F16(1) + 1, -F16(1) - 1 };
+        const fix16_t operands[] = { F16(1) - 1, -F16(1) + 1, F16(16383), -F16(16383) };
+        for (uint_fast8_t i = 0; i < 2; ++i)
+        {
+            for (uint_fast8_t j = 0; j < 4; ++j)
+            {
+                if (fix16_abs(fix16_fast_mul_unit(bounds[i], operands[j]) - fix16_mul(bounds[i], operands[j])) > 2) return 6;
+            }
+        }
+    }
+
+    // 7: Q2.30 cross and dot products and squared length of unit vectors, against the reference
+    {
+        uint32_t seed = 0xFEDCBA9u;
+        for (int i = 0; i < 256; ++i)
+        {
+            fix16_t a[3], b[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                a[k] = (fix16_t)seed >> 15;
+                seed = seed * 1664525u + 1013904223u;
+                b[k] = (fix16_t)seed >> 15;
+            }
+            normalize3_reference(&a[0], &a[1], &a[2]);
+            normalize3_reference(&b[0], &b[1], &b[2]);
+
+            fix16_t cross[3];
+            fix16_fast_cross_unit(a, b, cross);
+            if (fix16_abs(cross[0] - fix16_sub(fix16_mul(a[1], b[2]), fix16_mul(a[2], b[1]))) > 3) return 7;
+            if (fix16_abs(cross[1] - fix16_sub(fix16_mul(a[2], b[0]), fix16_mul(a[0], b[2]))) > 3) return 7;
+            if (fix16_abs(cross[2] - fix16_sub(fix16_mul(a[0], b[1]), fix16_mul(a[1], b[0]))) > 3) return 7;
+
+            const fix16_t dot = fix16_add(fix16_mul(a[0], b[0]), fix16_add(fix16_mul(a[1], b[1]), fix16_mul(a[2], b[2])));
+            if (fix16_abs(fix16_fast_dot_unit(a, b) - dot) > 4) return 7;
+
+            const fix16_t norm_sq = fix16_add(fix16_sq(a[0]), fix16_add(fix16_sq(a[1]), fix16_sq(a[2])));
+            if (fix16_abs(fix16_fast_norm_sq_unit(a[0], a[1], a[2]) - norm_sq) > 4) return 7;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+#include "fusion/gyro_bias.h"
+
+/************************************************************************/
+/* Stationary detection                                                 */
+/************************************************************************/
+
+/*!
+* \brief Maximum deviation of the squared accelerometer norm from one while stationary
+*/
+static const fix16_t stationary_accel_threshold = F16(0.05);
+
+/*!
+* \brief Maximum mean absolute deviation of the gyroscope rates in rad/s while stationary
+*/
+static const fix16_t stationary_gyro_deviation = F16(0.01);
+
+/*!
+* \brief Maximum residual rate in rad/s that is accepted as bias; Slow rotations are not learned.
+*/
+static const fix16_t stationary_gyro_rate = F16(0.035);
+
+/*!
+* \def GYRO_BIAS_SETTLE_SAMPLES The number of consecutive stationary samples before the bias is learned
+*/
+#define GYRO_BIAS_SETTLE_SAMPLES 50
+
+/*!
+* \brief Smoothing factor of the rate mean and deviation
+*/
+static const fix16_t smoothing = F16(1.0/16);
+
+/************************************************************************/
+/* Bias learning                                                        */
+/************************************************************************/
+
+/*!
+* \brief Learning rate right after power-up, for fast convergence
+*/
+static const fix16_t learning_rate_initial = F16(1.0/16);
+
+/*!
+* \brief Learning rate after the initial convergence
+*/
+static const fix16_t learning_rate = F16(1.0/64);
+
+/*!
+* \def GYRO_BIAS_INITIAL_SAMPLES The number of learning steps using the initial learning rate
+*/
+#define GYRO_BIAS_INITIAL_SAMPLES 256
+
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+
+/*!
+* \brief Scaling of the temperature coefficient learning rate relative to the bias learning rate
+*/
+static const fix16_t temperature_learning_scale = F16(1.0/64);
+
+/*!
+* \brief Maximum temperature difference in degree Celsius to the reference temperature
+*/
+static const fix16_t temperature_span = F16(32);
+
+#endif
+
+/************************************************************************/
+/* Estimator state                                                      */
+/************************************************************************/
+
+/*!
+* \brief The estimated bias in rad/s (at the reference temperature)
+*/
+static v3d m_bias;
+
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+
+/*!
+* \brief The estimated temperature coefficient in rad/s per degree Celsius
+*/
+static v3d m_bias_temperature;
+
+/*!
+* \brief The reference temperature in degree Celsius; Set by the first learning step.
+*/
+static fix16_t m_reference_temperature;
+
+/*!
+* \brief Set if the reference temperature is valid
+*/
+static uint_fast8_t m_have_reference_temperature;
+
+#endif
+
+/*!
+* \brief The smoothed corrected rates
+*/
+static v3d m_mean;
+
+/*!
+* \brief The smoothed absolute deviation of the corrected rates from their mean
+*/
+static v3d m_deviation;
+
+/*!
+* \brief The number of consecutive stationary samples, saturating
+*/
+static uint_fast16_t m_stationary_count;
+
+/*!
+* \brief The number of learning steps taken, saturating
+*/
+static uint_fast16_t m_learning_count;
+
+/*!
+* \brief Resets the bias estimate and the stationary detection.
+*/
+void gyro_bias_initialize()
+{
+    m_bias.x = m_bias.y = m_bias.z = 0;
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    m_bias_temperature.x = m_bias_temperature.y = m_bias_temperature.z = 0;
+    m_reference_temperature = 0;
+    m_have_reference_temperature = 0;
+#endif
+    m_mean.x = m_mean.y = m_mean.z = 0;
+
+    // start out as not stationary
+    m_deviation.x = m_deviation.y = m_deviation.z = stationary_gyro_deviation;
+    m_stationary_count = 0;
+    m_learning_count = 0;
+}
+
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+
+/*!
+* \brief Fetches the temperature difference to the reference temperature.
+* \param[in] temperature The sensor temperature in degree Celsius
+* \return The clamped difference
+*/
+STATIC_INLINE fix16_t temperature_difference(register const fix16_t temperature)
+{
+    fix16_t difference = fix16_sub(temperature, m_reference_temperature);
+    if (difference > temperature_span) difference = temperature_span;
+    else if (difference < -temperature_span) difference = -temperature_span;
+    return difference;
+}
+
+#endif
+
+/*!
+* \brief Fetches the current bias estimate.
+* \param[out] bias The bias in rad/s
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+void gyro_bias_fetch(register v3d *const bias, register const fix16_t temperature)
+{
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    const fix16_t difference = temperature_difference(temperature);
+    bias->x = fix16_add(m_bias.x, fix16_mul(m_bias_temperature.x, difference));
+    bias->y = fix16_add(m_bias.y, fix16_mul(m_bias_temperature.y, difference));
+    bias->z = fix16_add(m_bias.z, fix16_mul(m_bias_temperature.z, difference));
+#else
+    (void)temperature;
+    *bias = m_bias;
+#endif
+}
+
+/*!
+* \brief Removes the estimated bias from prepared gyroscope data.
+* \param[inout] gyro The prepared gyroscope data in rad/s
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+void gyro_bias_correct(register v3d *const gyro, register const fix16_t temperature)
+{
+    v3d bias;
+    gyro_bias_fetch(&bias, temperature);
+
+    gyro->x = fix16_sub(gyro->x, bias.x);
+    gyro->y = fix16_sub(gyro->y, bias.y);
+    gyro->z = fix16_sub(gyro->z, bias.z);
+}
+
+/*!
+* \brief Smoothes a rate and its absolute deviation.
+* \param[inout] mean The smoothed rate
+* \param[inout] deviation The smoothed absolute deviation
+* \param[in] rate The rate
+*/
+STATIC_INLINE void smooth(register fix16_t *const mean, register fix16_t *const deviation, register const fix16_t rate)
+{
+    *mean = fix16_add(*mean, fix16_mul(fix16_sub(rate, *mean), smoothing));
+    *deviation = fix16_add(*deviation, fix16_mul(fix16_sub(fix16_abs(fix16_sub(rate, *mean)), *deviation), smoothing));
+}
+
+/*!
+* \brief Determines if a smoothed rate qualifies as stationary.
+* \param[in] mean The smoothed rate
+* \param[in] deviation The smoothed absolute deviation
+* \return Nonzero if stationary
+*/
+STATIC_INLINE uint8_t is_stationary(register const fix16_t mean, register const fix16_t deviation)
+{
+    return (deviation < stationary_gyro_deviation) && (fix16_abs(mean) < stationary_gyro_rate);
+}
+
+/*!
+* \brief Detects stationary periods and refines the bias estimate.
+* \param[in] gyro The bias corrected gyroscope data in rad/s, see {\ref gyro_bias_correct()}
+* \param[in] accel The prepared accelerometer data in g
+* \param[in] temperature The sensor temperature in degree Celsius
+*/
+void gyro_bias_update(register const v3d *const gyro, register const v3d *const accel, register const fix16_t temperature)
+{
+    smooth(&m_mean.x, &m_deviation.x, gyro->x);
+    smooth(&m_mean.y, &m_deviation.y, gyro->y);
+    smooth(&m_mean.z, &m_deviation.z, gyro->z);
+
+    // the squared norm avoids the square root
+    const fix16_t norm_square = fix16_add(fix16_sq(accel->x), fix16_add(fix16_sq(accel->y), fix16_sq(accel->z)));
+    const uint8_t stationary = (fix16_abs(fix16_sub(norm_square, F16(1))) < stationary_accel_threshold)
+        && is_stationary(m_mean.x, m_deviation.x)
+        && is_stationary(m_mean.y, m_deviation.y)
+        && is_stationary(m_mean.z, m_deviation.z);
+
+    if (!stationary)
+    {
+        m_stationary_count = 0;
+        return;
+    }
+
+    if (m_stationary_count < GYRO_BIAS_SETTLE_SAMPLES)
+    {
+        ++m_stationary_count;
+        return;
+    }
+
+    // the smoothed corrected rate is the residual bias
+    const fix16_t rate = (m_learning_count < GYRO_BIAS_INITIAL_SAMPLES) ? learning_rate_initial : learning_rate;
+    if (m_learning_count < GYRO_BIAS_INITIAL_SAMPLES) ++m_learning_count;
+
+    const v3d step = {
+        fix16_mul(m_mean.x, rate),
+        fix16_mul(m_mean.y, rate),
+        fix16_mul(m_mean.z, rate)
+    };
+
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    if (!m_have_reference_temperature)
+    {
+        m_reference_temperature = temperature;
+        m_have_reference_temperature = 1;
+    }
+
+    // least mean squares on the regressors (1, temperature difference)
+    const fix16_t difference = fix16_mul(temperature_difference(temperature), temperature_learning_scale);
+    m_bias_temperature.x = fix16_add(m_bias_temperature.x, fix16_mul(step.x, difference));
+    m_bias_temperature.y = fix16_add(m_bias_temperature.y, fix16_mul(step.y, difference));
+    m_bias_temperature.z = fix16_add(m_bias_temperature.z, fix16_mul(step.z, difference));
+#else
+    (void)temperature;
+#endif
+
+    m_bias.x = fix16_add(m_bias.x, step.x);
+    m_bias.y = fix16_add(m_bias.y, step.y);
+    m_bias.z = fix16_add(m_bias.z, step.z);
+
+    // the learned part is gone from the following corrected rates
+    m_mean.x = fix16_sub(m_mean.x, step.x);
+    m_mean.y = fix16_sub(m_mean.y, step.y);
+    m_mean.z = fix16_sub(m_mean.z, step.z);
+}
+
+/*!
+* \brief Determines if the sensor was detected to be stationary by the last update.
+* \return Nonzero if stationary
+*/
+uint8_t gyro_bias_is_stationary()
+{
+    return m_stationary_count >= GYRO_BIAS_SETTLE_SAMPLES;
+}
+
+/*!
+* \brief Fetches the learned state, e.g. to keep it across a warm reset.
+* \param[out] snapshot The learned state
+*/
+void gyro_bias_checkpoint(register gyro_bias_snapshot_t *const snapshot)
+{
+    snapshot->bias = m_bias;
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    snapshot->bias_temperature = m_bias_temperature;
+    snapshot->reference_temperature = m_reference_temperature;
+    snapshot->have_reference_temperature = m_have_reference_temperature;
+#endif
+    snapshot->learning_count = m_learning_count;
+}
+
+/*!
+* \brief Continues learning from a state fetched by {\ref gyro_bias_checkpoint()}.
+* \param[in] snapshot The learned state
+*/
+void gyro_bias_resume(register const gyro_bias_snapshot_t *const snapshot)
+{
+    gyro_bias_initialize();
+
+    m_bias = snapshot->bias;
+#if GYRO_BIAS_TEMPERATURE_COMPENSATION
+    m_bias_temperature = snapshot->bias_temperature;
+    m_reference_temperature = snapshot->reference_temperature;
+    m_have_reference_temperature = snapshot->have_reference_temperature;
+#endif
+    m_learning_count = (snapshot->learning_count < GYRO_BIAS_INITIAL_SAMPLES) ? snapshot->learning_count : GYRO_BIAS_INITIAL_SAMPLES;
+}
@@ -0,0 +1,363 @@
+#include <assert.h>
+
+#include "fixmath.h"
+#include "fusion/mag_calibration.h"
+
+/*!
+* \def MAG_CALIBRATION_TERMS The number of ellipsoid terms x^2, y^2, z^2, xy, xz, yz, x, y, z
+*/
+#define MAG_CALIBRATION_TERMS       (9)
+
+/*!
+* \def MAG_CALIBRATION_OVERFLOW The raw value the HMC5883L reports for an overflowing axis
+*/
+#define MAG_CALIBRATION_OVERFLOW    (-4096)
+
+/*!
+* \brief The polynomial degree of each term
+*/
+static const uint8_t term_degree[MAG_CALIBRATION_TERMS] = { 2, 2, 2, 2, 2, 2, 1, 1, 1 };
+
+/*!
+* \brief The accumulated normal equations D'D v = D'1 of the ellipsoid fit
+*/
+static struct {
+    int64_t dtd[MAG_CALIBRATION_TERMS * (MAG_CALIBRATION_TERMS + 1) / 2];   //!< Upper triangle of D'D, row major
+    int64_t dt1[MAG_CALIBRATION_TERMS];                                     //!< D'1
+    uint32_t count;                                                         //!< The number of samples
+    uint8_t active;                                                         //!< Nonzero while collecting
+} fit;
+
+/*!
+* \brief Discards the accumulated statistics and starts collecting samples.
+*/
+COLD
+void mag_calibration_start()
+{
+    for (uint_fast8_t i = 0; i < sizeof(fit.dtd) / sizeof(fit.dtd[0]); ++i)
+    {
+        fit.dtd[i] = 0;
+    }
+    for (uint_fast8_t i = 0; i < MAG_CALIBRATION_TERMS; ++i)
+    {
+        fit.dt1[i] = 0;
+    }
+    fit.count = 0;
+    fit.active = 1;
+}
+
+/*!
+* \brief Stops collecting samples without solving.
+*/
+COLD
+void mag_calibration_stop()
+{
+    fit.active = 0;
+}
+
+/*!
+* \brief Determines if samples are being collected.
+* \return Nonzero if active
+*/
+LEAF
+uint8_t mag_calibration_is_active()
+{
+    return fit.active;
+}
+
+/*!
+* \brief Fetches the number of samples accumulated.
+* \return The sample count
+*/
+LEAF
+uint32_t mag_calibration_sample_count()
+{
+    return fit.count;
+}
+
+/*!
+* \brief Accumulates a raw magnetometer sample; Does nothing unless active.
+* \param[in] x The raw x value
+* \param[in] y The raw y value
+* \param[in] z The raw z value
+*
+* Overflowing samples (-4096) are ignored.
+*/
+HOT
+void mag_calibration_update(register const int16_t x, register const int16_t y, register const int16_t z)
+{
+    if (!fit.active || fit.count >= MAG_CALIBRATION_MAX_SAMPLES) return;
+    if (x == MAG_CALIBRATION_OVERFLOW || y == MAG_CALIBRATION_OVERFLOW || z == MAG_CALIBRATION_OVERFLOW) return;
+
+    // the terms fit in 32 bit, their products in 64 bit
+    const int32_t d[MAG_CALIBRATION_TERMS] = {
+        (int32_t)x * x, (int32_t)y * y, (int32_t)z * z,
+        (int32_t)x * y, (int32_t)x * z, (int32_t)y * z,
+        x, y, z
+    };
+
+    uint_fast8_t index = 0;
+    for (uint_fast8_t row = 0; row < MAG_CALIBRATION_TERMS; ++row)
+    {
+        fit.dt1[row] += d[row];
+        for (uint_fast8_t column = row; column < MAG_CALIBRATION_TERMS; ++column)
+        {
+            fit.dtd[index++] += (int64_t)d[row] * d[column];
+        }
+    }
+
+    ++fit.count;
+}
+
+/*!
+* \brief Absolute value of a double, without the math library
+*/
+STATIC_INLINE CONST
+double absolute(const double value)
+{
+    return (value < 0) ? -value : value;
+}
+
+/*!
+* \brief Solves a linear system by Gaussian elimination with partial pivoting.
+* \param[inout] a The augmented matrix [A b]; Destroyed in the process.
+* \param[out] x The solution
+* \return Zero on success, nonzero if A is (numerically) singular
+*/
+COLD
+static uint8_t solve_linear(double a[MAG_CALIBRATION_TERMS][MAG_CALIBRATION_TERMS + 1], double x[MAG_CALIBRATION_TERMS])
+{
+    const uint_fast8_t n = MAG_CALIBRATION_TERMS;
+
+    // the pivot threshold is relative to the largest diagonal element
+    double scale = 0;
+    for (uint_fast8_t i = 0; i < n; ++i)
+    {
+        if (a[i][i] > scale) scale = a[i][i];
+    }
+    const double epsilon = scale * 1e-12;
+
+    for (uint_fast8_t k = 0; k < n; ++k)
+    {
+        uint_fast8_t pivot = k;
+        for (uint_fast8_t i = k + 1; i < n; ++i)
+        {
+            if (absolute(a[i][k]) > absolute(a[pivot][k])) pivot = i;
+        }
+        if (absolute(a[pivot][k]) <= epsilon) return 1;
+
+        if (pivot != k)
+        {
+            for (uint_fast8_t j = k; j <= n; ++j)
+            {
+                const double temp = a[k][j];
+                a[k][j] = a[pivot][j];
+                a[pivot][j] = temp;
+            }
+        }
+
+        for (uint_fast8_t i = k + 1; i < n; ++i)
+        {
+            const double factor = a[i][k] / a[k][k];
+            for (uint_fast8_t j = k; j <= n; ++j)
+            {
+                a[i][j] -= factor * a[k][j];
+            }
+        }
+    }
+
+    for (int_fast8_t i = n - 1; i >= 0; --i)
+    {
+        double sum = a[i][n];
+        for (uint_fast8_t j = i + 1; j < n; ++j)
+        {
+            sum -= a[i][j] * x[j];
+        }
+        x[i] = sum / a[i][i];
+    }
+
+    return 0;
+}
+
+/*!
+* \brief Inverts a 3x3 matrix.
+* \param[in] m The matrix
+* \param[out] inverse The inverse; Must not alias the input.
+* \return Zero on success, nonzero if the matrix is singular
+*/
+COLD
+static uint8_t invert3(const double m[3][3], double inverse[3][3])
+{
+    inverse[0][0] =   m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    inverse[0][1] = -(m[0][1] * m[2][2] - m[0][2] * m[2][1]);
+    inverse[0][2] =   m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    inverse[1][0] = -(m[1][0] * m[2][2] - m[1][2] * m[2][0]);
+    inverse[1][1] =   m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    inverse[1][2] = -(m[0][0] * m[1][2] - m[0][2] * m[1][0]);
+    inverse[2][0] =   m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    inverse[2][1] = -(m[0][0] * m[2][1] - m[0][1] * m[2][0]);
+    inverse[2][2] =   m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+    const double determinant = m[0][0] * inverse[0][0] + m[0][1] * inverse[1][0] + m[0][2] * inverse[2][0];
+    if (absolute(determinant) < 1e-30) return 1;
+
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            inverse[i][j] /= determinant;
+        }
+    }
+    return 0;
+}
+
+/*!
+* \brief Calculates the symmetric square root of a symmetric positive definite 3x3 matrix.
+* \param[in] m The matrix
+* \param[out] root The square root
+* \return Zero on success, nonzero if the iteration failed
+*
+* Uses the Denman-Beavers iteration, which needs no eigendecomposition and no square roots.
+*/
+COLD
+static uint8_t sqrt3(const double m[3][3], double root[3][3])
+{
+    double y[3][3], z[3][3], y_inverse[3][3], z_inverse[3][3];
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            y[i][j] = m[i][j];
+            z[i][j] = (i == j) ? 1 : 0;
+        }
+    }
+
+    // converges quadratically for matrices close to the identity (up to the scale)
+    for (uint_fast8_t iteration = 0; iteration < 20; ++iteration)
+    {
+        if (invert3(y, y_inverse) || invert3(z, z_inverse)) return 1;
+
+        double change = 0;
+        for (uint_fast8_t i = 0; i < 3; ++i)
+        {
+            for (uint_fast8_t j = 0; j < 3; ++j)
+            {
+                const double next = (y[i][j] + z_inverse[i][j]) / 2;
+                change += absolute(next - y[i][j]);
+                y[i][j] = next;
+                z[i][j] = (z[i][j] + y_inverse[i][j]) / 2;
+            }
+        }
+
+        if (change < 1e-12) break;
+    }
+
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            root[i][j] = y[i][j];
+        }
+    }
+    return 0;
+}
+
+/*!
+* \brief Stops collecting samples and fits the ellipsoid.
+* \param[in] scaling The HMC5883L scaling factor the raw values are divided by, e.g. F16(1090) for 1.3 gauss mode
+* \param[out] calibration The 3x4 affine transformation, row major
+* \return Zero on success, nonzero if there are too few samples or the samples do not span an ellipsoid
+*
+* The transformation is symmetric, so that it does not rotate the sensor frame, and
+* maps the fitted ellipsoid onto a sphere of the (harmonic) mean semi-axis length.
+*/
+COLD NONNULL
+uint8_t mag_calibration_solve(register const fix16_t scaling, fix16_t calibration[static 3][4])
+{
+    assert(scaling > 0);
+
+    fit.active = 0;
+    if (fit.count < MAG_CALIBRATION_MIN_SAMPLES) return 1;
+
+    // the sums are converted to scaled units (gauss), which also conditions the system
+    const double s = fix16_to_dbl(scaling);
+    const double power[3] = { 1, 1 / s, 1 / (s * s) };
+
+    double a[MAG_CALIBRATION_TERMS][MAG_CALIBRATION_TERMS + 1];
+    uint_fast8_t index = 0;
+    for (uint_fast8_t row = 0; row < MAG_CALIBRATION_TERMS; ++row)
+    {
+        a[row][MAG_CALIBRATION_TERMS] = (double)fit.dt1[row] * power[term_degree[row]];
+        for (uint_fast8_t column = row; column < MAG_CALIBRATION_TERMS; ++column)
+        {
+            const double value = (double)fit.dtd[index++] * power[term_degree[row]] * power[term_degree[column]];
+            a[row][column] = value;
+            a[column][row] = value;
+        }
+    }
+
+    // ax^2 + by^2 + cz^2 + dxy + exz + fyz + gx + hy + iz = 1
+    double v[MAG_CALIBRATION_TERMS];
+    if (solve_linear(a, v)) return 1;
+
+    const double quadric[3][3] = {
+        { v[0],     v[3] / 2, v[4] / 2 },
+        { v[3] / 2, v[1],     v[5] / 2 },
+        { v[4] / 2, v[5] / 2, v[2] }
+    };
+
+    // (m - center)' Q (m - center) = k with center = -Q^-1 [g h i]' / 2
+    double quadric_inverse[3][3];
+    if (invert3(quadric, quadric_inverse)) return 1;
+
+    double center[3], k = 1;
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        center[i] = -(quadric_inverse[i][0] * v[6] + quadric_inverse[i][1] * v[7] + quadric_inverse[i][2] * v[8]) / 2;
+    }
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        k += center[i] * (quadric[i][0] * center[0] + quadric[i][1] * center[1] + quadric[i][2] * center[2]);
+    }
+    if (k <= 0) return 1;
+
+    // the shape matrix must be positive definite (leading principal minors)
+    double shape[3][3];
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            shape[i][j] = quadric[i][j] / k;
+        }
+    }
+    const double minor2 = shape[0][0] * shape[1][1] - shape[0][1] * shape[1][0];
+    const double minor3 = shape[0][0] * (shape[1][1] * shape[2][2] - shape[1][2] * shape[2][1])
+                        - shape[0][1] * (shape[1][0] * shape[2][2] - shape[1][2] * shape[2][0])
+                        + shape[0][2] * (shape[1][0] * shape[2][1] - shape[1][1] * shape[2][0]);
+    if (shape[0][0] <= 0 || minor2 <= 0 || minor3 <= 0) return 1;
+
+    // W = shape^(1/2) maps the ellipsoid onto the unit sphere
+    double w[3][3];
+    if (sqrt3(shape, w)) return 1;
+
+    // scale to the harmonic mean of the semi-axes, 3 / trace(W), to keep the field magnitude
+    const double radius = 3 / (w[0][0] + w[1][1] + w[2][2]);
+
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        double offset = 0;
+        for (uint_fast8_t column = 0; column < 3; ++column)
+        {
+            const double coefficient = w[row][column] * radius;
+            if (absolute(coefficient) >= 32767) return 1;
+
+            calibration[row][column] = fix16_from_dbl(coefficient);
+            offset -= coefficient * center[column];
+        }
+
+        if (absolute(offset) >= 32767) return 1;
+        calibration[row][3] = fix16_from_dbl(offset);
+    }
+
+    return 0;
+}
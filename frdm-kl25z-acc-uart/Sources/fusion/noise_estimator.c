@@ -0,0 +1,102 @@
+#include "fusion/noise_estimator.h"
+
+/*!
+* \brief The lower bound of the variance ratio
+*/
+static const fix16_t scale_min = F16(0.25);
+
+/*!
+* \brief The upper bound of the variance ratio
+*/
+static const fix16_t scale_max = F16(64);
+
+/*!
+* \brief Initializes an estimator with the calibrated variances.
+* \param[out] estimator The estimator
+* \param[in] x The calibrated x axis variance in Q32
+* \param[in] y The calibrated y axis variance in Q32
+* \param[in] z The calibrated z axis variance in Q32
+* \param[in] gain The unit conversion factor the calibrated variances are given without, e.g. degree to radians
+*/
+void noise_estimator_initialize(register noise_estimator_t *const estimator, register const int64_t x, register const int64_t y, register const int64_t z, register const fix16_t gain)
+{
+    const int64_t nominal[3] = { x, y, z };
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        // Q32 * Q16 >> 16, twice; The squared gain would underflow in fix16.
+        int64_t value = (nominal[i] * gain) >> 16;
+        value = (value * gain) >> 16;
+
+        // axes without a calibration are not scaled, see noise_estimator_scale()
+        estimator->nominal[i] = (value > 0) ? value : 0;
+        estimator->var[i] = estimator->nominal[i];
+        estimator->mean[i] = 0;
+    }
+    estimator->seeded = 0;
+}
+
+/*!
+* \brief Updates the estimate of one axis.
+* \param[inout] mean The smoothed value in Q32
+* \param[inout] var The smoothed variance in Q32
+* \param[in] value The sample
+*/
+HOT
+STATIC_INLINE void update_axis(register int64_t *const mean, register int64_t *const var, register const fix16_t value)
+{
+    // deviation from the previous mean, fix16; Multiplied, since the values may be negative.
+    const int64_t delta = ((int64_t)value * 65536 - *mean) >> 16;
+
+    // mean += a * delta;  var = (1 - a) * (var + a * delta^2), dropping the a^2 term
+    *mean += (delta * 65536) >> NOISE_ESTIMATOR_SHIFT;
+    *var += ((delta * delta) >> NOISE_ESTIMATOR_SHIFT) - (*var >> NOISE_ESTIMATOR_SHIFT);
+}
+
+/*!
+* \brief Updates the estimates with a sample.
+* \param[inout] estimator The estimator
+* \param[in] sample The prepared sensor data
+*/
+void noise_estimator_update(register noise_estimator_t *const estimator, register const v3d *const sample)
+{
+    // without a previous mean, the first deviation would be the full value
+    if (!estimator->seeded)
+    {
+        estimator->mean[0] = (int64_t)sample->x * 65536;
+        estimator->mean[1] = (int64_t)sample->y * 65536;
+        estimator->mean[2] = (int64_t)sample->z * 65536;
+        estimator->seeded = 1;
+        return;
+    }
+
+    update_axis(&estimator->mean[0], &estimator->var[0], sample->x);
+    update_axis(&estimator->mean[1], &estimator->var[1], sample->y);
+    update_axis(&estimator->mean[2], &estimator->var[2], sample->z);
+}
+
+/*!
+* \brief Fetches the ratio of the estimated to the calibrated variances, averaged over the axes.
+* \param[in] estimator The estimator
+* \return The ratio, clamped to [1/4, 64]; One if no axis has a calibrated variance.
+*/
+fix16_t noise_estimator_scale(register const noise_estimator_t *const estimator)
+{
+    int64_t sum = 0;
+    uint_fast8_t axes = 0;
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        if (0 == estimator->nominal[i]) continue;
+
+        // Q32 << 16 / Q32 = Q16; Clamp each axis first, so that the shift cannot overflow.
+        const int64_t limit = estimator->nominal[i] * (scale_max >> 16);
+        const int64_t var = (estimator->var[i] < limit) ? estimator->var[i] : limit;
+        sum += (var << 16) / estimator->nominal[i];
+        ++axes;
+    }
+    if (0 == axes) return fix16_one;
+
+    const fix16_t scale = (fix16_t)(sum / axes);
+    if (scale < scale_min) return scale_min;
+    if (scale > scale_max) return scale_max;
+    return scale;
+}
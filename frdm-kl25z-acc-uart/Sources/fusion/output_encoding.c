@@ -0,0 +1,165 @@
+/*
+* output_encoding.c
+*
+*  Created on: Mar 10, 2014
+*      Author: Markus
+*/
+
+#include "fusion/output_encoding.h"
+
+/*!
+* \def Q15_SCALE The Q1.15 value of one, minus one LSB
+*/
+#define Q15_SCALE               (32767)
+
+/*!
+* \def SMALLEST_THREE_SCALE The scale of the smallest-three components: sqrt(2) * 16383
+*/
+#define SMALLEST_THREE_SCALE    (23169)
+
+/*!
+* \def BINARY_ANGLE_SCALE Half the scale of the binary angles: 32768 / pi / 2
+*/
+#define BINARY_ANGLE_SCALE      (5215)
+
+/*!
+* \brief Scales a fix16_t value of at most one in magnitude and rounds it to an integer
+* \param[in] value The value
+* \param[in] scale The scale; The product must not exceed 31 bit.
+* \return The rounded product
+*/
+STATIC_INLINE CONST
+int32_t scale_round(register fix16_t value, register int32_t scale)
+{
+    return (value * scale + (1 << 15)) >> 16;
+}
+
+/*!
+* \brief Converts a unit quaternion to Q1.15
+*/
+HOT NONNULL LEAF
+void output_encode_q15(register int16_t out[static 4], register const qf16 *const quat)
+{
+    const fix16_t components[4] = { quat->a, quat->b, quat->c, quat->d };
+    for (int i = 0; i < 4; ++i)
+    {
+        register fix16_t value = components[i];
+        if (value > fix16_one) value = fix16_one;
+        else if (value < -fix16_one) value = -fix16_one;
+
+        out[i] = (int16_t)scale_round(value, Q15_SCALE);
+    }
+}
+
+/*!
+* \brief Encodes a unit quaternion in smallest-three format
+*/
+HOT NONNULL LEAF
+void output_encode_smallest_three(register uint8_t out[static OUTPUT_SMALLEST_THREE_SIZE], register const qf16 *const quat)
+{
+    const fix16_t components[4] = { quat->a, quat->b, quat->c, quat->d };
+
+    /* find the largest component */
+    uint_fast8_t largest = 0;
+    fix16_t largest_magnitude = fix16_abs(components[0]);
+    for (uint_fast8_t i = 1; i < 4; ++i)
+    {
+        const fix16_t magnitude = fix16_abs(components[i]);
+        if (magnitude > largest_magnitude)
+        {
+            largest = i;
+            largest_magnitude = magnitude;
+        }
+    }
+
+    /* q and -q are the same rotation; flip so that the dropped component is positive */
+    const uint_fast8_t negate = components[largest] < 0;
+
+    /* the remaining components are at most 1/sqrt(2) in magnitude */
+    uint64_t bits = (uint64_t)largest << 45;
+    uint_fast8_t shift = 30;
+    for (uint_fast8_t i = 0; i < 4; ++i)
+    {
+        if (i == largest) continue;
+
+        register int32_t value = scale_round(negate ? -components[i] : components[i], SMALLEST_THREE_SCALE);
+        if (value > 16383) value = 16383;
+        else if (value < -16383) value = -16383;
+
+        bits |= (uint64_t)((uint32_t)value & 0x7FFF) << shift;
+        shift -= 15;
+    }
+
+    for (uint_fast8_t i = 0; i < OUTPUT_SMALLEST_THREE_SIZE; ++i)
+    {
+        out[i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+/*!
+* \brief Converts angles to 16 bit binary angles
+*/
+HOT NONNULL LEAF
+void output_encode_angles(register int16_t out[static 3], register fix16_t roll, register fix16_t pitch, register fix16_t yaw)
+{
+    /* |angle| <= pi, so the product stays within 31 bit */
+    out[0] = (int16_t)((roll * BINARY_ANGLE_SCALE + (1 << 14)) >> 15);
+    out[1] = (int16_t)((pitch * BINARY_ANGLE_SCALE + (1 << 14)) >> 15);
+    out[2] = (int16_t)((yaw * BINARY_ANGLE_SCALE + (1 << 14)) >> 15);
+}
+
+/*!
+* \brief Resets the delta encoder, so that the next frame is a key frame
+*/
+COLD NONNULL LEAF
+void output_delta_initialize(register output_delta_t *const state)
+{
+    state->sequence = 0;
+    state->since_keyframe = OUTPUT_DELTA_KEYFRAME_INTERVAL;
+}
+
+/*!
+* \brief Encodes a quaternion as key frame or delta frame
+*/
+HOT NONNULL
+uint8_t output_delta_encode(register output_delta_t *const state, register const qf16 *const quat, uint8_t *const type, uint8_t delta_type, uint8_t payload[static OUTPUT_DELTA_MAX_PAYLOAD])
+{
+    int16_t current[4];
+    output_encode_q15(current, quat);
+
+    payload[0] = state->sequence++;
+
+    /* differences against what the receiver has */
+    uint_fast8_t keyframe = state->since_keyframe >= OUTPUT_DELTA_KEYFRAME_INTERVAL;
+    int16_t delta[4];
+    for (uint_fast8_t i = 0; i < 4; ++i)
+    {
+        delta[i] = current[i] - state->reference[i];
+        keyframe |= (delta[i] > INT8_MAX) || (delta[i] < INT8_MIN);
+    }
+
+    if (keyframe)
+    {
+        state->since_keyframe = 0;
+        for (uint_fast8_t i = 0; i < 4; ++i)
+        {
+            state->reference[i] = current[i];
+            payload[1 + 2*i] = (uint8_t)current[i];
+            payload[2 + 2*i] = (uint8_t)((uint16_t)current[i] >> 8);
+        }
+
+        *type = OUTPUT_DELTA_KEYFRAME_TYPE;
+        return 1 + 4 * sizeof(int16_t);
+    }
+
+    /* the reference follows the reconstruction exactly, so no error accumulates */
+    ++state->since_keyframe;
+    for (uint_fast8_t i = 0; i < 4; ++i)
+    {
+        state->reference[i] += delta[i];
+        payload[1 + i] = (uint8_t)(int8_t)delta[i];
+    }
+
+    *type = delta_type;
+    return 1 + 4 * sizeof(int8_t);
+}
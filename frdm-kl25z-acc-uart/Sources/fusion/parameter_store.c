@@ -0,0 +1,146 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "comm/crc16.h"
+#include "cpu/flash.h"
+#include "fusion/sensor_calibration.h"
+#include "fusion/sensor_fusion.h"
+#include "fusion/parameter_store.h"
+
+/*!
+* \def PARAMETER_STORE_MAGIC Identifies a programmed parameter block ("MARG")
+*/
+#define PARAMETER_STORE_MAGIC           (0x4752414Du)
+
+/*!
+* \brief Start of the flash sector reserved for the parameter block, defined by the linker script
+*/
+extern const uint8_t _sparameters[];
+
+/*!
+* \brief The parameter block
+*
+* The CRC covers all preceding bytes; An erased sector reads as all ones and fails the magic check.
+*/
+typedef struct {
+    uint32_t magic;                                 //!< {\ref PARAMETER_STORE_MAGIC}
+    uint16_t version;                               //!< {\ref PARAMETER_STORE_VERSION}
+    uint16_t length;                                //!< The size of the block in byte
+    sensor_calibration_t calibration;               //!< The sensor calibration
+    fix16_t fusion[FUSION_PARAMETER_COUNT];         //!< The fusion tuning parameters, indexed by {\ref fusion_parameter_t}
+    uint16_t reserved;                              //!< Zero; Pads the block to a whole number of longwords
+    uint16_t crc;                                   //!< CRC-16/CCITT of the preceding fields
+} parameter_block_t;
+
+// the block is programmed in longwords and must fit the reserved sector
+typedef char parameter_block_alignment_check[(sizeof(parameter_block_t) % FLASH_LONGWORD_SIZE) == 0 ? 1 : -1];
+typedef char parameter_block_size_check[sizeof(parameter_block_t) <= FLASH_SECTOR_SIZE ? 1 : -1];
+
+/*!
+* \brief Staging buffer for the block to be programmed
+*/
+static parameter_block_t staged_block;
+
+/*!
+* \brief Calculates the CRC of a parameter block
+* \param[in] block The block
+* \return The CRC
+*/
+STATIC_INLINE NONNULL
+uint16_t parameter_block_crc(register const parameter_block_t *const block)
+{
+    return CRC16_Calculate((const uint8_t*)block, offsetof(parameter_block_t, crc));
+}
+
+/*!
+* \brief Checks that a parameter block is complete, intact and holds valid values
+* \param[in] block The block
+* \return {\ref PARAMETER_STORE_OK} if the block can be applied
+*/
+COLD NONNULL
+static parameter_store_result_t parameter_block_validate(register const parameter_block_t *const block)
+{
+    if (block->magic != PARAMETER_STORE_MAGIC) return PARAMETER_STORE_EMPTY;
+    if (block->version != PARAMETER_STORE_VERSION) return PARAMETER_STORE_INVALID;
+    if (block->length != sizeof(parameter_block_t)) return PARAMETER_STORE_INVALID;
+    if (block->crc != parameter_block_crc(block)) return PARAMETER_STORE_INVALID;
+
+    for (uint_fast8_t i = 0; i < FUSION_PARAMETER_COUNT; ++i)
+    {
+        if (block->fusion[i] < 0) return PARAMETER_STORE_INVALID;
+    }
+
+    if (!sensor_calibration_valid(&block->calibration)) return PARAMETER_STORE_INVALID;
+    return PARAMETER_STORE_OK;
+}
+
+/*!
+* \brief Loads the stored parameters into the sensor calibration and the fusion.
+* \return {\ref PARAMETER_STORE_OK} if the parameters were applied; The compiled-in defaults remain in effect otherwise.
+*
+* Must be called before {\ref sensor_prepare_initialize()} and {\ref fusion_initialize()}.
+*/
+COLD
+parameter_store_result_t parameter_store_load()
+{
+    const parameter_block_t *const block = (const parameter_block_t*)_sparameters;
+
+    // validate everything before applying anything, so that a bad block never takes effect partially
+    const parameter_store_result_t result = parameter_block_validate(block);
+    if (PARAMETER_STORE_OK != result) return result;
+
+    if (0 != sensor_calibration_apply(&block->calibration)) return PARAMETER_STORE_INVALID;
+
+    for (uint_fast8_t i = 0; i < FUSION_PARAMETER_COUNT; ++i)
+    {
+        fusion_set_parameter((fusion_parameter_t)i, block->fusion[i]);
+    }
+
+    return PARAMETER_STORE_OK;
+}
+
+/*!
+* \brief Stores the current sensor calibration and fusion parameters.
+* \return {\ref PARAMETER_STORE_OK} on success, {\ref PARAMETER_STORE_INVALID} if the values would not load again
+*
+* Blocks with interrupts disabled while the sector is erased and programmed.
+* The programmed block is read back and validated like {\ref parameter_store_load()} does.
+*/
+COLD
+parameter_store_result_t parameter_store_save()
+{
+    memset(&staged_block, 0, sizeof(staged_block));
+    staged_block.magic = PARAMETER_STORE_MAGIC;
+    staged_block.version = PARAMETER_STORE_VERSION;
+    staged_block.length = sizeof(parameter_block_t);
+
+    sensor_calibration_fetch(&staged_block.calibration);
+    for (uint_fast8_t i = 0; i < FUSION_PARAMETER_COUNT; ++i)
+    {
+        staged_block.fusion[i] = fusion_get_parameter((fusion_parameter_t)i);
+    }
+
+    staged_block.crc = parameter_block_crc(&staged_block);
+
+    // a block that would be rejected by the next load must not replace the stored one
+    if (PARAMETER_STORE_OK != parameter_block_validate(&staged_block)) return PARAMETER_STORE_INVALID;
+
+    const uint32_t address = (uint32_t)_sparameters;
+    if (FLASH_OK != Flash_EraseSector(address)) return PARAMETER_STORE_FLASH_ERROR;
+    if (FLASH_OK != Flash_Program(address, &staged_block, sizeof(staged_block))) return PARAMETER_STORE_FLASH_ERROR;
+
+    // read back, then check that the programmed block loads again
+    if (0 != memcmp(_sparameters, &staged_block, sizeof(staged_block))) return PARAMETER_STORE_FLASH_ERROR;
+    return parameter_block_validate((const parameter_block_t*)_sparameters);
+}
+
+/*!
+* \brief Erases the stored parameters, so that the compiled-in defaults are used after the next reset.
+* \return {\ref PARAMETER_STORE_OK} on success
+*/
+COLD
+parameter_store_result_t parameter_store_erase()
+{
+    if (FLASH_OK != Flash_EraseSector((uint32_t)_sparameters)) return PARAMETER_STORE_FLASH_ERROR;
+    return PARAMETER_STORE_OK;
+}
@@ -1,27 +1,25 @@
 #include <assert.h>
+#include <string.h>
 
 #include "compiler.h"
 #include "fixmatrix.h"
 #include "fixarray.h"
 
+#include "fusion/sensor_calibration.h"
+
 #if !defined(FIXMATRIX_MAX_SIZE) || (FIXMATRIX_MAX_SIZE < 4)
 #error FIXMATRIX_MAX_SIZE must be defined to value greater or equal 4.
 #endif
 
-#ifdef __GNUC__
-#define STORE_IN_ROM __attribute__((section("ROM")))
-#else
-#define STORE_IN_ROM
-#endif
-
 
 /*!
 * \brief Affine transformation matrix for HMC5883L sensor data calibration
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
 */
-const static fix16_t hmc5883l_calibration_data[3][4] = {
+static fix16_t hmc5883l_calibration_data[3][4] = {
         { F16(0.98308),     F16(0.0025144),     F16(0.02777),       F16(0.0064502) },
         { F16(0.0025144),   F16(0.92661),       F16(-0.043022),     F16(0.10543) },
         { F16(0.02777),     F16(-0.043022),     F16(1.1128),        F16(-0.020258) }
@@ -31,9 +29,10 @@ const static fix16_t hmc5883l_calibration_data[3][4] = {
 * \brief Affine transformation matrix for MPU6050 accelerometer sensor data calibration
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
 */
-const static fix16_t mpu6050_accelerometer_calibration_data[3][4] = {
+static fix16_t mpu6050_accelerometer_calibration_data[3][4] = {
         { F16(1.0062),      F16(0.0034341),     F16(-0.0027532),    F16(-0.0164) },
         { F16(0.0034341),   F16(1.0008),        F16(-0.0056162),    F16(-0.016173) },
         { F16(-0.0027532),  F16(-0.0056162),    F16(0.9931),        F16(0.02059) }
@@ -43,40 +42,136 @@ const static fix16_t mpu6050_accelerometer_calibration_data[3][4] = {
 * \brief Affine transformation matrix for MPU6050 gyroscope sensor data calibration
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
 */
-const static fix16_t mpu6050_gyroscope_calibration_data[3][4] = {
+static fix16_t mpu6050_gyroscope_calibration_data[3][4] = {
         { F16(1),           0,                  0,                  F16(-4.5446) },
         { 0,                F16(1),             0,                  F16(-0.048858) },
         { 0,                0,                  F16(1),             F16(-1.1197) }
     };
 
+/*!
+* \brief Affine transformation matrix for MMA8451Q accelerometer sensor data calibration
+*
+* Not part of the persisted {\ref sensor_calibration_t}, since the MMA8451Q is optional;
+* Replace the identity with the values retrieved via MATLAB script for your board.
+*/
+static const fix16_t mma8451q_accelerometer_calibration_data[3][4] = {
+        { F16(1),           0,                  0,                  0 },
+        { 0,                F16(1),             0,                  0 },
+        { 0,                0,                  F16(1),             0 }
+    };
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief Affine transformation matrices for the redundant MPU6050 accelerometers
+*
+* Not part of the persisted {\ref sensor_calibration_t}; Replace the identities with the values
+* retrieved via MATLAB script for your boards, relative to the axes of the first MPU6050.
+*/
+static const fix16_t mpu6050_redundant_accelerometer_calibration_data[MPU6050_COUNT - 1][3][4] = {
+        {
+            { F16(1),           0,                  0,                  0 },
+            { 0,                F16(1),             0,                  0 },
+            { 0,                0,                  F16(1),             0 }
+        },
+#if MPU6050_COUNT > 2
+        {
+            { F16(1),           0,                  0,                  0 },
+            { 0,                F16(1),             0,                  0 },
+            { 0,                0,                  F16(1),             0 }
+        },
+#endif
+    };
+
+/*!
+* \brief Affine transformation matrices for the redundant MPU6050 gyroscopes
+*
+* Not part of the persisted {\ref sensor_calibration_t}; The offsets are the zero rate biases
+* of each device, the remaining bias is tracked by the bias estimation of the averaged rates.
+*/
+static const fix16_t mpu6050_redundant_gyroscope_calibration_data[MPU6050_COUNT - 1][3][4] = {
+        {
+            { F16(1),           0,                  0,                  0 },
+            { 0,                F16(1),             0,                  0 },
+            { 0,                0,                  F16(1),             0 }
+        },
+#if MPU6050_COUNT > 2
+        {
+            { F16(1),           0,                  0,                  0 },
+            { 0,                F16(1),             0,                  0 },
+            { 0,                0,                  F16(1),             0 }
+        },
+#endif
+    };
+
+#endif
+
+/*!
+* \brief Sensor variances for the MMA8451Q accelerometer.
+*
+* In 2g low noise mode at 100 Hz the noise is well below the fix16 resolution of
+* about 1.5e-5 g, so the variances are clamped to one LSB. Batches of averaged
+* samples are weighted by their sample count on top of this.
+*/
+static const fix16_t var_mma8451q_accelerometer[3] = { 1,                  1,                  1 };
+
 /*!
 * \brief Sensor variances for the MPU6050 accelerometer.
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
 */
-STORE_IN_ROM
-const static fix16_t var_mpu6050_accelerometer[3]   = { F16(9.8036e-06),    F16(9.6462e-06),    F16(2.4831e-05) };
+static fix16_t var_mpu6050_accelerometer[3]   = { F16(9.8036e-06),    F16(9.6462e-06),    F16(2.4831e-05) };
 
 /*!
 * \brief Sensor variances for the MPU6050 gyroscope.
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
 */
-STORE_IN_ROM
-const static fix16_t var_mpu6050_gyroscope[3]       = { F16(0.016307),      F16(0.0084706),     F16(0.0129) };
+static fix16_t var_mpu6050_gyroscope[3]       = { F16(0.016307),      F16(0.0084706),     F16(0.0129) };
 
 /*!
 * \brief Sensor variances for the HMC5883L magnetometer.
 *
 * Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
+* Be sure to provide your own values here or YMMV; They are the defaults that a
+* calibration loaded from the parameter store replaces.
+*
+* The measured variances of about 2e-6 are below the fix16 resolution of about 1.5e-5
+* and would read as zero, so they are clamped to one LSB like those of the MMA8451Q;
+* See {\ref var_q32_hmc5883l} for the measured values.
+*/
+static fix16_t var_hmc5883l[3]                = { 1,                  1,                  1 };
+
+/*!
+* \def VAR_Q32 Converts a variance to Q32
+*/
+#define VAR_Q32(value) ((int64_t)((value) * 4294967296.0 + 0.5))
+
+/*!
+* \brief Sensor variances for the MPU6050 accelerometer in Q32.
+*
+* The variances above at the full resolution; Used to seed the noise estimation,
+* since the fix16 values round the accelerometer variances to one LSB.
+* A calibration replaces an axis if it changes the fix16 value, see {\ref sensor_calibration_apply()}.
 */
-STORE_IN_ROM
-const static fix16_t var_hmc5883l[3]                = { F16(2.0347e-06),    F16(1.9233e-06),    F16(2.3021e-06) };
+static int64_t var_q32_mpu6050_accelerometer[3] = { VAR_Q32(9.8036e-06), VAR_Q32(9.6462e-06), VAR_Q32(2.4831e-05) };
+
+/*!
+* \brief Sensor variances for the MPU6050 gyroscope in Q32, see {\ref var_q32_mpu6050_accelerometer}.
+*/
+static int64_t var_q32_mpu6050_gyroscope[3]     = { VAR_Q32(0.016307),   VAR_Q32(0.0084706),  VAR_Q32(0.0129) };
+
+/*!
+* \brief Sensor variances for the HMC5883L magnetometer in Q32, see {\ref var_q32_mpu6050_accelerometer}.
+*/
+static int64_t var_q32_hmc5883l[3]              = { VAR_Q32(2.0347e-06), VAR_Q32(1.9233e-06), VAR_Q32(2.3021e-06) };
 
 /*!
 * \brief Retrieves the variances of the MPU6050 accelerometer
@@ -90,12 +185,25 @@ void mpu6050_var_accelerometer(register fix16_t *const RESTRICT x, register fix1
     *y = var_mpu6050_accelerometer[1];
     *z = var_mpu6050_accelerometer[2];
 
-    // these should really be compile-time checks
+    // guaranteed by sensor_calibration_apply()
     assert(*x > 0);
     assert(*y > 0);
     assert(*z > 0);
 }
 
+/*!
+* \brief Retrieves the variances of the MMA8451Q accelerometer
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+void mma8451q_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
+{
+    *x = var_mma8451q_accelerometer[0];
+    *y = var_mma8451q_accelerometer[1];
+    *z = var_mma8451q_accelerometer[2];
+}
+
 /*!
 * \brief Retrieves the variances of the MPU6050 gyroscope
 * \param[out] x The x axis variances
@@ -108,7 +216,7 @@ void mpu6050_var_gyroscope(register fix16_t *const RESTRICT x, register fix16_t
     *y = var_mpu6050_gyroscope[1];
     *z = var_mpu6050_gyroscope[2];
 
-    // these should really be compile-time checks
+    // guaranteed by sensor_calibration_apply()
     assert(*x > 0);
     assert(*y > 0);
     assert(*z > 0);
@@ -126,12 +234,203 @@ void hmc5883l_var(register fix16_t *const RESTRICT x, register fix16_t *const RE
     *y = var_hmc5883l[1];
     *z = var_hmc5883l[2];
 
-    // these should really be compile-time checks
+    // guaranteed by sensor_calibration_apply()
     assert(*x > 0);
     assert(*y > 0);
     assert(*z > 0);
 }
 
+/*!
+* \brief Retrieves the variances of the MPU6050 accelerometer in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+void mpu6050_var_accelerometer_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z)
+{
+    *x = var_q32_mpu6050_accelerometer[0];
+    *y = var_q32_mpu6050_accelerometer[1];
+    *z = var_q32_mpu6050_accelerometer[2];
+}
+
+/*!
+* \brief Retrieves the variances of the MPU6050 gyroscope in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+void mpu6050_var_gyroscope_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z)
+{
+    *x = var_q32_mpu6050_gyroscope[0];
+    *y = var_q32_mpu6050_gyroscope[1];
+    *z = var_q32_mpu6050_gyroscope[2];
+}
+
+/*!
+* \brief Retrieves the variances of the HMC5883L magnetometer in Q32
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+void hmc5883l_var_q32(register int64_t *const RESTRICT x, register int64_t *const RESTRICT y, register int64_t *const RESTRICT z)
+{
+    *x = var_q32_hmc5883l[0];
+    *y = var_q32_hmc5883l[1];
+    *z = var_q32_hmc5883l[2];
+}
+
+/*!
+* \brief Retrieves the MPU6050 accelerometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* mpu6050_accelerometer_calibration_matrix()
+{
+    return &mpu6050_accelerometer_calibration_data[0][0];
+}
+
+/*!
+* \brief Retrieves the MMA8451Q accelerometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* mma8451q_accelerometer_calibration_matrix()
+{
+    return &mma8451q_accelerometer_calibration_data[0][0];
+}
+
+/*!
+* \brief Retrieves the MPU6050 gyroscope calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* mpu6050_gyroscope_calibration_matrix()
+{
+    return &mpu6050_gyroscope_calibration_data[0][0];
+}
+
+/*!
+* \brief Retrieves the HMC5883L magnetometer calibration
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* hmc5883l_calibration_matrix()
+{
+    return &hmc5883l_calibration_data[0][0];
+}
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief Retrieves the accelerometer calibration of a redundant MPU6050
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* mpu6050_redundant_accelerometer_calibration_matrix(uint_fast8_t device)
+{
+    assert(device > 0 && device < MPU6050_COUNT);
+    return &mpu6050_redundant_accelerometer_calibration_data[device - 1][0][0];
+}
+
+/*!
+* \brief Retrieves the gyroscope calibration of a redundant MPU6050
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \return The 3x4 affine transformation matrix, row major
+*/
+const fix16_t* mpu6050_redundant_gyroscope_calibration_matrix(uint_fast8_t device)
+{
+    assert(device > 0 && device < MPU6050_COUNT);
+    return &mpu6050_redundant_gyroscope_calibration_data[device - 1][0][0];
+}
+
+#endif
+
+/*!
+* \brief Fetches the current calibration
+* \param[out] calibration The calibration
+*/
+void sensor_calibration_fetch(register sensor_calibration_t *const calibration)
+{
+    memcpy(calibration->mpu6050_accelerometer, mpu6050_accelerometer_calibration_data, sizeof(calibration->mpu6050_accelerometer));
+    memcpy(calibration->mpu6050_gyroscope, mpu6050_gyroscope_calibration_data, sizeof(calibration->mpu6050_gyroscope));
+    memcpy(calibration->hmc5883l, hmc5883l_calibration_data, sizeof(calibration->hmc5883l));
+    memcpy(calibration->var_mpu6050_accelerometer, var_mpu6050_accelerometer, sizeof(calibration->var_mpu6050_accelerometer));
+    memcpy(calibration->var_mpu6050_gyroscope, var_mpu6050_gyroscope, sizeof(calibration->var_mpu6050_gyroscope));
+    memcpy(calibration->var_hmc5883l, var_hmc5883l, sizeof(calibration->var_hmc5883l));
+}
+
+/*!
+* \brief Checks that all variances of a calibration are positive
+* \param[in] var The variances
+* \return Nonzero if valid
+*/
+STATIC_INLINE LEAF NONNULL
+uint8_t sensor_calibration_variances_valid(register const fix16_t var[static 3])
+{
+    return (var[0] > 0) && (var[1] > 0) && (var[2] > 0);
+}
+
+/*!
+* \brief Replaces the HMC5883L affine transformation, leaving the rest of the calibration unchanged
+* \param[in] transformation The 3x4 affine transformation, row major
+*
+* The folded sensor transforms must be rebuilt with {\ref sensor_prepare_initialize()} afterwards.
+*/
+void sensor_calibration_apply_hmc5883l(register const fix16_t transformation[static 3][4])
+{
+    memcpy(hmc5883l_calibration_data, transformation, sizeof(hmc5883l_calibration_data));
+}
+
+/*!
+* \brief Checks a calibration before it is applied or stored
+* \param[in] calibration The calibration
+* \return Nonzero if all variances are positive
+*/
+uint8_t sensor_calibration_valid(register const sensor_calibration_t *const calibration)
+{
+    return sensor_calibration_variances_valid(calibration->var_mpu6050_accelerometer)
+        && sensor_calibration_variances_valid(calibration->var_mpu6050_gyroscope)
+        && sensor_calibration_variances_valid(calibration->var_hmc5883l);
+}
+
+/*!
+* \brief Updates the Q32 variances of a sensor from the fix16 variances of a calibration
+* \param[inout] var_q32 The Q32 variances
+* \param[in] var The fix16 variances
+*
+* An axis keeps its Q32 variance if it rounds to the same fix16 value, clamped to one LSB
+* like the defaults, so that storing and loading a calibration does not lose the resolution.
+*/
+STATIC_INLINE NONNULL
+void sensor_calibration_apply_variances_q32(register int64_t var_q32[static 3], register const fix16_t var[static 3])
+{
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        fix16_t rounded = (fix16_t)((var_q32[i] + 32768) >> 16);
+        if (rounded < 1) rounded = 1;
+        if (rounded != var[i]) var_q32[i] = (int64_t)var[i] * 65536;
+    }
+}
+
+/*!
+* \brief Replaces the current calibration
+* \param[in] calibration The calibration
+* \return Zero on success, nonzero if a variance is not positive; The calibration is unchanged then.
+*
+* The folded sensor transforms must be rebuilt with {\ref sensor_prepare_initialize()} afterwards.
+*/
+uint8_t sensor_calibration_apply(register const sensor_calibration_t *const calibration)
+{
+    if (!sensor_calibration_valid(calibration)) return 1;
+
+    memcpy(mpu6050_accelerometer_calibration_data, calibration->mpu6050_accelerometer, sizeof(calibration->mpu6050_accelerometer));
+    memcpy(mpu6050_gyroscope_calibration_data, calibration->mpu6050_gyroscope, sizeof(calibration->mpu6050_gyroscope));
+    memcpy(hmc5883l_calibration_data, calibration->hmc5883l, sizeof(calibration->hmc5883l));
+    memcpy(var_mpu6050_accelerometer, calibration->var_mpu6050_accelerometer, sizeof(calibration->var_mpu6050_accelerometer));
+    memcpy(var_mpu6050_gyroscope, calibration->var_mpu6050_gyroscope, sizeof(calibration->var_mpu6050_gyroscope));
+    memcpy(var_hmc5883l, calibration->var_hmc5883l, sizeof(calibration->var_hmc5883l));
+    sensor_calibration_apply_variances_q32(var_q32_mpu6050_accelerometer, calibration->var_mpu6050_accelerometer);
+    sensor_calibration_apply_variances_q32(var_q32_mpu6050_gyroscope, calibration->var_mpu6050_gyroscope);
+    sensor_calibration_apply_variances_q32(var_q32_hmc5883l, calibration->var_hmc5883l);
+    return 0;
+}
+
 /*!
 * \brief Calibrates a given sensor using a 3x4 affine transformation
 * \param[inout] x The x data (will be overwritten with the calibrated version)
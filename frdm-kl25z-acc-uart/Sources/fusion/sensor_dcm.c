@@ -1,6 +1,25 @@
 #include "fixmath.h"
+#include "fusion/fix16_fast.h"
 #include "fusion/sensor_dcm.h"
 
+/*!
+* \def dcm_mul Multiplication used by the rotation matrix conversions; Maps to {\ref fix16_fast_mul} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+/*!
+* \def dcm_mul_unit Multiplication of a unit bounded value with an arbitrary one; Maps to {\ref fix16_fast_mul_unit} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+#if FIX16_FAST_KERNELS
+#define dcm_mul(a, b)       fix16_fast_mul((a), (b))
+#define dcm_mul_unit(u, b)  fix16_fast_mul_unit((u), (b))
+#define dcm_atan2(y, x)     fix16_fast_atan2((y), (x))
+#define dcm_asin(x)         fix16_fast_asin((x))
+#else
+#define dcm_mul(a, b)       fix16_mul((a), (b))
+#define dcm_mul_unit(u, b)  fix16_mul((u), (b))
+#define dcm_atan2(y, x)     fix16_atan2((y), (x))
+#define dcm_asin(x)         fix16_asin((x))
+#endif
+
 static v3d coordinate_system[3] = { { F16(1), 0, 0 }, { 0, F16(1), 0 }, { 0, 0, F16(1) } };
 
 /*!
@@ -123,6 +142,40 @@ void sensor_dcm2rpy(const mf16 *RESTRICT const dcm, fix16_t *RESTRICT const roll
 #endif
 }
 
+/*!
+* \brief Multiplies two 3x3 matrices, dest = a * b'
+* \param[out] dest The product
+* \param[in] a The left operand
+* \param[in] b The right operand, transposed
+*
+* Fully unrolled replacement for mf16_mul_bt(), which loops over the dynamic sizes and
+* checks every element for overflow; The overflow is accumulated and tested once instead.
+*/
+HOT NONNULL
+STATIC_INLINE void mul_bt_3x3(mf16 *RESTRICT const dest, const mf16 *RESTRICT const a, const mf16 *RESTRICT const b)
+{
+    uint32_t overflow = 0;
+
+    #define DOT_ROWS(i, j) \
+        fix16_fast_add(fix16_fast_add(fix16_mul(a->data[i][0], b->data[j][0]), fix16_mul(a->data[i][1], b->data[j][1]), &overflow), \
+                       fix16_mul(a->data[i][2], b->data[j][2]), &overflow)
+
+    dest->data[0][0] = DOT_ROWS(0, 0);
+    dest->data[0][1] = DOT_ROWS(0, 1);
+    dest->data[0][2] = DOT_ROWS(0, 2);
+    dest->data[1][0] = DOT_ROWS(1, 0);
+    dest->data[1][1] = DOT_ROWS(1, 1);
+    dest->data[1][2] = DOT_ROWS(1, 2);
+    dest->data[2][0] = DOT_ROWS(2, 0);
+    dest->data[2][1] = DOT_ROWS(2, 1);
+    dest->data[2][2] = DOT_ROWS(2, 2);
+
+    #undef DOT_ROWS
+
+    dest->rows = dest->columns = 3;
+    dest->errors = (a->errors | b->errors) | (fix16_fast_overflowed(overflow) ? FIXMATRIX_OVERFLOW : 0);
+}
+
 /*!
 * \brief Gets roll, pitch, yaw angular velocities from difference DCM.
 * \param[in] current_dcm The DCM matrix
@@ -134,6 +187,153 @@ void sensor_dcm2rpy(const mf16 *RESTRICT const dcm, fix16_t *RESTRICT const roll
 void sensor_ddcm(const mf16 *RESTRICT const current_dcm, const mf16 *RESTRICT const previous_dcm, fix16_t *RESTRICT const omega_roll, fix16_t *RESTRICT const omega_pitch, fix16_t *RESTRICT const omega_yaw)
 {
     mf16 ddcm;
-    mf16_mul_bt(&ddcm, current_dcm, previous_dcm);
+    mul_bt_3x3(&ddcm, current_dcm, previous_dcm);
     sensor_dcm2rpy(&ddcm, omega_roll, omega_pitch, omega_yaw);
-}
\ No newline at end of file
+}
+
+/*!
+* \brief Builds the rotation matrix from the attitude and orientation rows of the filter state
+* \param[out] dcm The rotation matrix with the rows C3 x C2, C2 and -C3
+* \param[in] c2 The orientation row; Unit length
+* \param[in] c3 The attitude row; Unit length
+*/
+void sensor_dcm3_from_rows(dcm3_t *RESTRICT const dcm, const fix16_t *RESTRICT const c2, const fix16_t *RESTRICT const c3)
+{
+    const fix16_t m20 = -c3[0];
+    const fix16_t m21 = -c3[1];
+    const fix16_t m22 = -c3[2];
+
+    // Gram-Schmidt: remove the component of C2 along C3, so that the quaternion and the
+    // angles, which read different elements, describe the same rotation
+#if FIX16_FAST_KERNELS
+    const fix16_t d = fix16_fast_dot_unit(c2, c3);
+#else
+    const fix16_t d = fix16_add(dcm_mul(c2[0], c3[0]), fix16_add(dcm_mul(c2[1], c3[1]), dcm_mul(c2[2], c3[2])));
+#endif
+    fix16_t m10 = fix16_sub(c2[0], dcm_mul_unit(d, c3[0]));
+    fix16_t m11 = fix16_sub(c2[1], dcm_mul_unit(d, c3[1]));
+    fix16_t m12 = fix16_sub(c2[2], dcm_mul_unit(d, c3[2]));
+
+    // |m1| = sqrt(1 - d^2) for unit rows
+#if FIX16_FAST_KERNELS
+    const fix16_t inv_norm = fix16_fast_rsqrt(fix16_fast_norm_sq_unit(m10, m11, m12));
+#else
+    const fix16_t inv_norm = fix16_div(F16(1), fix16_sqrt(fix16_add(dcm_mul(m10, m10), fix16_add(dcm_mul(m11, m11), dcm_mul(m12, m12)))));
+#endif
+    m10 = dcm_mul(m10, inv_norm);
+    m11 = dcm_mul(m11, inv_norm);
+    m12 = dcm_mul(m12, inv_norm);
+
+    // m0 = cross(m1, m2); Orthogonal unit rows need no further scaling.
+#if FIX16_FAST_KERNELS
+    // all rows are unit bounded, so the products are formed in Q2.30
+    const fix16_t m1[3] = { m10, m11, m12 };
+    const fix16_t m2[3] = { m20, m21, m22 };
+    fix16_t m0[3];
+    fix16_fast_cross_unit(m1, m2, m0);
+    const fix16_t m00 = m0[0];
+    const fix16_t m01 = m0[1];
+    const fix16_t m02 = m0[2];
+#else
+    const fix16_t m00 = fix16_sub(dcm_mul(m11, m22), dcm_mul(m12, m21));
+    const fix16_t m01 = fix16_sub(dcm_mul(m12, m20), dcm_mul(m10, m22));
+    const fix16_t m02 = fix16_sub(dcm_mul(m10, m21), dcm_mul(m11, m20));
+#endif
+
+    dcm->data[0][0] = m00;
+    dcm->data[0][1] = m01;
+    dcm->data[0][2] = m02;
+    dcm->data[1][0] = m10;
+    dcm->data[1][1] = m11;
+    dcm->data[1][2] = m12;
+    dcm->data[2][0] = m20;
+    dcm->data[2][1] = m21;
+    dcm->data[2][2] = m22;
+}
+
+/*!
+* \brief Converts a rotation matrix to a quaternion.
+* \param[in] dcm The rotation matrix
+* \param[out] quat The normalized quaternion
+*
+* "Angel" code, see http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+*/
+void sensor_dcm3_to_quaternion(const dcm3_t *RESTRICT const dcm, qf16 *RESTRICT const quat)
+{
+    const fix16_t m00 = dcm->data[0][0], m01 = dcm->data[0][1], m02 = dcm->data[0][2];
+    const fix16_t m10 = dcm->data[1][0], m11 = dcm->data[1][1], m12 = dcm->data[1][2];
+    const fix16_t m20 = dcm->data[2][0], m21 = dcm->data[2][1], m22 = dcm->data[2][2];
+
+    fix16_t qw, qx, qy, qz;
+
+    // check the matrice's trace
+    const register fix16_t trace = fix16_add(m00, fix16_add(m11, m22));
+    if (trace > 0)
+    {
+        // s = 0.5 / sqrt(trace + 1.0);
+        const fix16_t s = fix16_div(F16(0.5), fix16_sqrt(fix16_add(F16(1.0), trace)));
+
+        // s is at most one half, the differences are not unit bounded
+        qw = fix16_div(F16(0.25), s);
+        qx = dcm_mul_unit(s, fix16_sub(m21, m12));
+        qy = dcm_mul_unit(s, fix16_sub(m02, m20));
+        qz = dcm_mul_unit(s, fix16_sub(m10, m01));
+    }
+    else if (m00 > m11 && m00 > m22)
+    {
+        // s = 2.0 * sqrt(1.0 + R(1,1) - R(2,2) - R(3,3));
+        const fix16_t s = dcm_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m00, fix16_add(m11, m22)))));
+
+        qw = fix16_div(fix16_sub(m21, m12), s);
+        qx = dcm_mul(F16(0.25), s);
+        qy = fix16_div(fix16_add(m01, m10), s);
+        qz = fix16_div(fix16_add(m02, m20), s);
+    }
+    else if (m11 > m22)
+    {
+        // s = 2.0 * sqrt(1.0 + R(2,2) - R(1,1) - R(3,3));
+        const fix16_t s = dcm_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m11, fix16_add(m00, m22)))));
+
+        qw = fix16_div(fix16_sub(m02, m20), s);
+        qx = fix16_div(fix16_add(m01, m10), s);
+        qy = dcm_mul(F16(0.25), s);
+        qz = fix16_div(fix16_add(m12, m21), s);
+    }
+    else
+    {
+        // s = 2.0 * sqrt(1.0 + R(3,3) - R(1,1) - R(2,2));
+        const fix16_t s = dcm_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m22, fix16_add(m00, m11)))));
+
+        qw = fix16_div(fix16_sub(m10, m01), s);
+        qx = fix16_div(fix16_add(m02, m20), s);
+        qy = fix16_div(fix16_add(m12, m21), s);
+        qz = dcm_mul(F16(0.25), s);
+    }
+
+    quat->a = qw;
+    quat->b = qx;
+    quat->c = qy;
+    quat->d = qz;
+
+    qf16_normalize(quat, quat);
+}
+
+/*!
+* \brief Gets roll, pitch, yaw from a rotation matrix.
+* \param[in] dcm The rotation matrix
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch(elevation) angle in radians.
+* \param[out] yaw The yaw(heading, azimuth) angle in radians.
+*/
+void sensor_dcm3_to_rpy(const dcm3_t *RESTRICT const dcm, fix16_t *RESTRICT const roll, fix16_t *RESTRICT const pitch, fix16_t *RESTRICT const yaw)
+{
+    // pitch = asin(R31); Rounding may push it past one.
+    fix16_t r31 = dcm->data[2][0];
+    if (r31 > F16(1)) r31 = F16(1);
+    if (r31 < -F16(1)) r31 = -F16(1);
+    *pitch = dcm_asin(r31);
+
+    // roll = atan2(R32, R33), yaw = atan2(R21, R11)
+    *roll = dcm_atan2(dcm->data[2][1], dcm->data[2][2]);
+    *yaw = dcm_atan2(dcm->data[1][0], dcm->data[0][0]);
+}
@@ -1,14 +1,10 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "fixmath.h"
-#include "fixkalman.h"
 #include "fixvector3d.h"
-#include "fixmatrix.h"
-
-#if !defined(FIXMATRIX_MAX_SIZE) || (FIXMATRIX_MAX_SIZE < 6)
-#error FIXMATRIX_MAX_SIZE must be defined to value greater or equal 6.
-#endif
 
 /*! 
 * \def TEST_ENABLED Unit-globally enables or disables accelerometer/magnetometer or gyroscope testing
@@ -31,6 +27,12 @@
 #undef TEST_ACCEL
 #endif
 
+#include "cpu/profile.h"
+#include "cpu/ramfunc.h"
+#include "fusion/complementary_filter.h"
+#include "fusion/fix16_fast.h"
+#include "fusion/noise_estimator.h"
+#include "fusion/sensor_calibration.h"
 #include "fusion/sensor_dcm.h"
 #include "fusion/sensor_fusion.h"
 
@@ -41,80 +43,345 @@
 /*
 * \brief Observation axis uncertainty (accelerometer)
 */
-static const fix16_t initial_r_axis = F16(0.05);
+static fix16_t initial_r_axis = F16(0.05);
 
 /*
 * \brief Observation projection uncertainty (magnetometer)
 */
-static const fix16_t initial_r_projection = F16(0.02);
+static fix16_t initial_r_projection = F16(0.02);
 
 /*
 * \brief Observation gyro uncertainty
 */
-static const fix16_t initial_r_gyro = F16(0.02);
+static fix16_t initial_r_gyro = F16(0.02);
 
 /*
 * \brief Accelerometer process noise. Since the accelerometer readings are never used directly, this should always be set to zero.
 */
 #ifdef TEST_ACCEL
-static const fix16_t q_axis = F16(.1);
+static fix16_t q_axis = F16(.1);
 #else
-static const fix16_t q_axis = F16(0);
+static fix16_t q_axis = F16(0);
 #endif
 
 /*
 * \brief Gyro process noise
 */
-static const fix16_t q_gyro = F16(1);
+static fix16_t q_gyro = F16(1);
 
 /*
 * \brief Tuning factor for the axis observation
 */
-static const fix16_t alpha1 = F16(5);
+static fix16_t alpha1 = F16(5);
 
 /*
 * \brief Tuning factor for the gyro observation
 */
-static const fix16_t alpha2 = F16(.8);
+static fix16_t alpha2 = F16(.8);
 
 /*!
 * \brief Threshold value for attitude detection. Difference to norm.
 */
-static const fix16_t attitude_threshold = F16(0.14);
+static fix16_t attitude_threshold = F16(0.14);
 
 /*!
 * \brief Threshold value for singularity detection. Difference to cos(pitch).
 */
 static const fix16_t singularity_cos_threshold = F16(0.17365);
 
+/*!
+* \brief Threshold value for magnetic disturbance detection. Relative difference of the squared field strength to the reference.
+*
+* 0.2 allows for about 10% deviation of the field strength.
+*/
+static const fix16_t magnetic_norm_sq_threshold = F16(0.2);
+
+/*!
+* \brief Threshold value for magnetic disturbance detection. Squared difference of the vertical field component to the reference, relative to the squared field strength.
+*
+* 0.01 allows for a vertical deviation of 10% of the field strength, i.e. about 6 of dip.
+*/
+static const fix16_t magnetic_vertical_sq_threshold = F16(0.01);
+
+/*!
+* \def FUSION_ADAPTIVE_NOISE Set to <code>1</code> to scale the measurement noise by the live sensor variances
+*
+* The R values above are then the noise at the calibrated sensor variances and grow
+* or shrink with the vibration level, see {\ref noise_estimator_scale()}.
+*/
+#ifndef FUSION_ADAPTIVE_NOISE
+#define FUSION_ADAPTIVE_NOISE 1
+#endif
+
+/************************************************************************/
+/* Correction scheduling                                                */
+/************************************************************************/
+
+/*!
+* \def FUSION_ATTITUDE_CORRECTION_RATE Rate in Hz at which accelerometer data is used to correct the attitude.
+*
+* In between, the attitude filter is only corrected with gyroscope data.
+*/
+#define FUSION_ATTITUDE_CORRECTION_RATE 100
+
+/*!
+* \brief The time in seconds between two accelerometer corrections
+*/
+static const fix16_t attitude_correction_period = F16(1.0 / FUSION_ATTITUDE_CORRECTION_RATE);
+
+/*!
+* \def FUSION_ORIENTATION_CORRECTION_RATE Maximum rate in Hz at which magnetometer data is used to correct the orientation.
+*
+* Above the 75 Hz of the HMC5883L, so that its readings are used as they arrive, allowing for
+* jitter; Readings that arrive faster are skipped and the orientation filter is only corrected
+* with gyroscope data instead.
+*/
+#define FUSION_ORIENTATION_CORRECTION_RATE 100
+
+/*!
+* \brief The minimum time in seconds between two magnetometer corrections
+*/
+static const fix16_t orientation_correction_period = F16(1.0 / FUSION_ORIENTATION_CORRECTION_RATE);
+
+/*!
+* \brief The time in seconds since the last accelerometer correction of the attitude filter
+*/
+static fix16_t m_attitude_correction_age = 0;
+
+/*!
+* \brief The time in seconds since the last magnetometer correction of the orientation filter
+*/
+static fix16_t m_orientation_correction_age = 0;
+
+/************************************************************************/
+/* Magnetic disturbance detection                                       */
+/************************************************************************/
+
+/*!
+* \brief The metrics of a magnetic field reading, see {\ref magnetometer_project()}
+*/
+typedef struct {
+    fix16_t norm_sq;        //!< The squared field strength
+    fix16_t vertical;       //!< The field component along the attitude axis; Encodes the dip angle.
+} magnetic_field_t;
+
+/*!
+* \def FUSION_MAGNETIC_REFERENCE_RATE Inverse rate at which undisturbed readings are blended into the reference field
+*/
+#define FUSION_MAGNETIC_REFERENCE_RATE 256
+
+/*!
+* \def FUSION_MAGNETIC_DISTURBANCE_LIMIT Time in microseconds after which a persisting disturbance is taken as the new reference
+*
+* A disturbance that persists for this long is rather a different environment,
+* e.g. the inside of a vehicle, than a passing magnet. The limit is measured with the
+* magnetometer timestamps, so it holds for any magnetometer rate.
+*/
+#define FUSION_MAGNETIC_DISTURBANCE_LIMIT 5000000UL
+
+/*!
+* \brief The learned undisturbed magnetic field
+*/
+static magnetic_field_t m_magnetic_reference;
+
+/*!
+* \brief Determines if {\ref m_magnetic_reference} was seeded
+*/
+static bool m_magnetic_reference_valid = false;
+
+/*!
+* \brief Determines if the current magnetometer reading was already checked for a disturbance
+*
+* Cleared by {\ref fusion_set_magnetometer()}, so that each reading is evaluated once.
+*/
+static bool m_magnetic_disturbance_evaluated = false;
+
+/*!
+* \brief Determines if the last evaluated magnetometer reading was disturbed
+*/
+static bool m_magnetic_disturbed = false;
+
+/*!
+* \brief The timestamp of the first reading of the current disturbance in microseconds
+*/
+static uint32_t m_magnetic_disturbance_timestamp = 0;
+
+/************************************************************************/
+/* Fusion mode                                                          */
+/************************************************************************/
+
+/*!
+* \def FUSION_HYBRID_DECIMATION Default number of samples per Kalman step in {\ref FUSION_MODE_HYBRID}
+*/
+#define FUSION_HYBRID_DECIMATION 10
+
+/*!
+* \brief The selected fusion mode
+*/
+static fusion_mode_t m_mode = FUSION_MODE_KALMAN;
+
+/*!
+* \brief The complementary filter used in {\ref FUSION_MODE_COMPLEMENTARY} and {\ref FUSION_MODE_HYBRID}
+*/
+static complementary_filter_t m_complementary = { .kp = F16(1), .ki = F16(0.02) };
+
+/*!
+* \brief The number of samples since the last Kalman step in {\ref FUSION_MODE_HYBRID}
+*/
+static uint_fast8_t m_hybrid_samples = 0;
+
+/*!
+* \brief The number of samples per Kalman step in {\ref FUSION_MODE_HYBRID}
+*/
+static uint_fast8_t m_hybrid_decimation = FUSION_HYBRID_DECIMATION;
+
+/*!
+* \brief The time in seconds since the last Kalman step in {\ref FUSION_MODE_HYBRID}
+*/
+static fix16_t m_hybrid_deltaT = 0;
+
 /************************************************************************/
 /* Kalman filter structure definition                                   */
 /************************************************************************/
 
 /*!
-* \brief The Kalman filter instance used to predict the orientation.
+* \def KF_AXES Number of DCM rows estimated by each filter
+*
+* The dual engine runs one filter for the attitude and one for the orientation row,
+* the joint engine estimates both rows with a single filter and shared angular velocities.
+*/
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+#define KF_AXES 2
+#else
+#define KF_AXES 1
+#endif
+
+/*!
+* \def KF_GYRO_STATE Index of the first angular velocity state
+*/
+#define KF_GYRO_STATE (3 * KF_AXES)
+
+/*!
+* \def KF_STATES Number of states of each filter; three DCM components per row and three angular velocities
+*/
+#define KF_STATES (KF_GYRO_STATE + 3)
+
+/*!
+* \def KF_COVARIANCE_SIZE Number of entries of the packed, upper triangular covariance matrix
+*/
+#define KF_COVARIANCE_SIZE ((KF_STATES * (KF_STATES + 1)) / 2)
+
+/*!
+* \def KFM_MAX_OBSERVATIONS Largest number of observation variables of any measurement
+*/
+#define KFM_MAX_OBSERVATIONS 6
+
+/*!
+* \brief A Kalman filter for {\ref KF_AXES} DCM rows.
+*
+* The transition matrix is A = [I B; 0 I], so only the skew-symmetric blocks of B, one per row, are stored.
+* The covariance P is symmetric and stored as its upper triangle in row-major order,
+* the process noise Q is diagonal.
+*/
+typedef struct {
+    fix16_t x[KF_STATES];           //!< The state vector
+    fix16_t P[KF_COVARIANCE_SIZE];  //!< The packed state covariance
+    fix16_t q[KF_STATES];           //!< The diagonal of the process noise
+    fix16_t B[KF_AXES][3][3];       //!< The upper right blocks of the state transition matrix
+} fusion_filter_t;
+
+/*!
+* \brief An observation model whose rows each observe a single state with unit gain.
+*
+* H is stored as the index of the observed state per row, the observation noise R is diagonal.
+*/
+typedef struct {
+    uint_fast8_t count;                     //!< The number of observation variables
+    uint8_t state[KFM_MAX_OBSERVATIONS];    //!< The observed state per observation variable
+    fix16_t z[KFM_MAX_OBSERVATIONS];        //!< The observation vector
+    fix16_t r[KFM_MAX_OBSERVATIONS];        //!< The diagonal of the observation noise
+} fusion_observation_t;
+
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+
+/*!
+* \brief The Kalman filter instance used to predict attitude and orientation.
+*/
+static fusion_filter_t kf_joint;
+
+/*!
+* \def kf_attitude The filter estimating the attitude
+*/
+#define kf_attitude kf_joint
+
+/*!
+* \def kf_orientation The filter estimating the orientation
+*/
+#define kf_orientation kf_joint
+
+/*!
+* \def ATTITUDE_STATE Index of the first attitude DCM component in {\ref kf_attitude}
+*/
+#define ATTITUDE_STATE 0
+
+/*!
+* \def ORIENTATION_STATE Index of the first orientation DCM component in {\ref kf_orientation}
 */
-static kalman16_uc_t kf_attitude;
+#define ORIENTATION_STATE 3
+
+#else
 
 /*!
-* \def KF_STATES Number of states
+* \brief The Kalman filter instance used to predict the attitude.
 */
-#define KF_ATTITUDE_STATES 6
+static fusion_filter_t kf_attitude;
 
 /*!
 * \brief The Kalman filter instance used to predict the orientation.
 */
-static kalman16_uc_t kf_orientation;
+static fusion_filter_t kf_orientation;
+
+/*!
+* \def ATTITUDE_STATE Index of the first attitude DCM component in {\ref kf_attitude}
+*/
+#define ATTITUDE_STATE 0
+
+/*!
+* \def ORIENTATION_STATE Index of the first orientation DCM component in {\ref kf_orientation}
+*/
+#define ORIENTATION_STATE 0
+
+#endif
+
+/*!
+* \def ATTITUDE_AXIS The estimated attitude DCM row (C3)
+*/
+#define ATTITUDE_AXIS (&kf_attitude.x[ATTITUDE_STATE])
+
+/*!
+* \def ORIENTATION_AXIS The estimated orientation DCM row (C2)
+*/
+#define ORIENTATION_AXIS (&kf_orientation.x[ORIENTATION_STATE])
 
 /*!
-* \def KF_STATES Number of states
+* \def OUTPUT_ATTITUDE_AXIS The attitude DCM row of the filter driving the outputs; The v3d components are contiguous.
 */
-#define KF_ORIENTATION_STATES 6
+#define OUTPUT_ATTITUDE_AXIS ((FUSION_MODE_KALMAN == m_mode) ? (const fix16_t *)ATTITUDE_AXIS : &m_complementary.c3.x)
+
+/*!
+* \def OUTPUT_ORIENTATION_AXIS The orientation DCM row of the filter driving the outputs
+*/
+#define OUTPUT_ORIENTATION_AXIS ((FUSION_MODE_KALMAN == m_mode) ? (const fix16_t *)ORIENTATION_AXIS : &m_complementary.c2.x)
+
+/*!
+* \def OUTPUT_RATE The angular velocity estimate of the filter driving the outputs
+*/
+#define OUTPUT_RATE ((FUSION_MODE_KALMAN == m_mode) ? (const fix16_t *)&kf_attitude.x[KF_GYRO_STATE] : &m_complementary.rate.x)
 
 /*!
 * \brief The Kalman filter observation instance used to update the prediction with accelerometer data
 */
-static kalman16_observation_t kfm_accel;
+static fusion_observation_t kfm_accel;
 
 /*!
 * \def KFM_ACCEL Number of observation variables for accelerometer updates
@@ -124,28 +391,29 @@ static kalman16_observation_t kfm_accel;
 /*!
 * \brief The Kalman filter observation instance used to update the prediction with magnetometer data
 */
-static kalman16_observation_t kfm_magneto;
+static fusion_observation_t kfm_magneto;
 
 /*!
 * \def KFM_MAGNETO Number of observation variables for magnetometer updates
+*
+* The joint engine already observed the gyroscope in the attitude update.
 */
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+#define KFM_MAGNETO 3
+#else
 #define KFM_MAGNETO 6
+#endif
 
 /*!
-* \brief The Kalman filter observation instance used to update the prediction with magnetometer data
+* \brief The Kalman filter observation instance used to update the prediction with gyroscope data
 */
-static kalman16_observation_t kfm_gyro;
+static fusion_observation_t kfm_gyro;
 
 /*!
 * \def KFM_GYRO Number of observation variables for gyroscope-only updates
 */
 #define KFM_GYRO 3
 
-/*!
-* \brief Lambda parameter for certainty tuning
-*/
-static fix16_t lambda = F16(1);
-
 /************************************************************************/
 /* Sensor data buffers                                                  */
 /************************************************************************/
@@ -165,6 +433,48 @@ static v3d m_gyroscope = { 0, 0, 0 };
 */
 static v3d m_magnetometer = { 0, 0, 0 };
 
+/*!
+* \brief The time of {\ref m_accelerometer} in microseconds
+*/
+static uint32_t m_accelerometer_timestamp = 0;
+
+/*!
+* \brief The time of {\ref m_gyroscope} in microseconds; The time of the state after the update.
+*/
+static uint32_t m_gyroscope_timestamp = 0;
+
+/*!
+* \brief The time of {\ref m_magnetometer} in microseconds
+*/
+static uint32_t m_magnetometer_timestamp = 0;
+
+/*!
+* \def FUSION_MAGNETOMETER_MAX_AGE Maximum time difference in microseconds between a magnetometer reading and the state
+*
+* Readings within this time are rotated to the state time with the gyroscope data, older ones are dropped.
+* The HMC5883L runs at 75 Hz, so that a reading is up to 13.3 ms old when fused with the MPU6050 data.
+*/
+#define FUSION_MAGNETOMETER_MAX_AGE 50000
+
+#if FUSION_ADAPTIVE_NOISE
+
+/*!
+* \brief The running noise estimate of the accelerometer
+*/
+static noise_estimator_t m_accelerometer_noise;
+
+/*!
+* \brief The running noise estimate of the gyroscope
+*/
+static noise_estimator_t m_gyroscope_noise;
+
+/*!
+* \brief The running noise estimate of the magnetometer
+*/
+static noise_estimator_t m_magnetometer_noise;
+
+#endif
+
 /*!
 * \brief Determines if an accelerometer measurement is available
 */
@@ -194,33 +504,73 @@ static bool m_attitude_bootstrapped = false;
 */
 static bool m_orientation_bootstrapped = false;
 
+/*!
+* \def FUSION_BOOTSTRAP_ACCELEROMETER_SAMPLES Number of accelerometer samples averaged for the initial attitude
+*/
+#define FUSION_BOOTSTRAP_ACCELEROMETER_SAMPLES 16
+
+/*!
+* \def FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES Number of magnetometer samples averaged for the initial orientation
+*/
+#define FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES 8
+
+/*!
+* \brief The variance added to the seeded axis variances; Covers motion during the bootstrap.
+*/
+static const fix16_t bootstrap_motion_variance = F16(0.01);
+
+/*!
+* \brief The sum of the accelerometer samples collected for the bootstrap
+*/
+static v3d m_bootstrap_accelerometer;
+
+/*!
+* \brief The sum of the magnetometer samples collected for the bootstrap
+*/
+static v3d m_bootstrap_magnetometer;
+
+/*!
+* \brief The number of samples in {\ref m_bootstrap_accelerometer}
+*/
+static uint_fast8_t m_bootstrap_accelerometer_count = 0;
+
+/*!
+* \brief The number of samples in {\ref m_bootstrap_magnetometer}
+*/
+static uint_fast8_t m_bootstrap_magnetometer_count = 0;
+
 /************************************************************************/
 /* Helper macros                                                        */
 /************************************************************************/
 
 /*!
-* \def matrix_set Helper macro to set a value in a specific matrix field
-*/
-#define matrix_set(matrix, row, column, value) \
-    assert(row <= FIXMATRIX_MAX_SIZE); \
-    assert(column <= FIXMATRIX_MAX_SIZE); \
-    assert(row < matrix->rows); \
-    assert(column < matrix->columns); \
-    matrix->data[row][column] = value
+* \brief Maps a row and column index to the packed covariance storage
+*/
+static const uint8_t packed_index[KF_STATES][KF_STATES] = {
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8 },
+    {  1,  9, 10, 11, 12, 13, 14, 15, 16 },
+    {  2, 10, 17, 18, 19, 20, 21, 22, 23 },
+    {  3, 11, 18, 24, 25, 26, 27, 28, 29 },
+    {  4, 12, 19, 25, 30, 31, 32, 33, 34 },
+    {  5, 13, 20, 26, 31, 35, 36, 37, 38 },
+    {  6, 14, 21, 27, 32, 36, 39, 40, 41 },
+    {  7, 15, 22, 28, 33, 37, 40, 42, 43 },
+    {  8, 16, 23, 29, 34, 38, 41, 43, 44 }
+#else
+    {  0,  1,  2,  3,  4,  5 },
+    {  1,  6,  7,  8,  9, 10 },
+    {  2,  7, 11, 12, 13, 14 },
+    {  3,  8, 12, 15, 16, 17 },
+    {  4,  9, 13, 16, 18, 19 },
+    {  5, 10, 14, 17, 19, 20 }
+#endif
+};
 
 /*!
-* \def matrix_set_symmetric Helper macro to set a value symmetrically in a matrix
+* \def P_AT Helper macro to access a field of a packed covariance matrix
 */
-#define matrix_set_symmetric(matrix, row, column, value) \
-    assert(row <= FIXMATRIX_MAX_SIZE); \
-    assert(column <= FIXMATRIX_MAX_SIZE); \
-    assert(row <= matrix->rows); \
-    assert(column <= matrix->columns); \
-    assert(row <= matrix->columns); \
-    assert(column <= matrix->rows); \
-    matrix->data[row][column] = value; \
-    matrix->data[column][row] = value
-
+#define P_AT(kf, row, column) ((kf)->P[packed_index[row][column]])
 
 /*!
 * \def F16_ONE The value 1 in Q16
@@ -249,6 +599,57 @@ static bool m_orientation_bootstrapped = false;
 */
 #define initial_dT          (F16_ONE)
 
+/*!
+* \def fusion_mul Multiplication used in the filter kernels; Maps to {\ref fix16_fast_mul} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+/*!
+* \def fusion_mul_unit Multiplication of a unit bounded value, e.g. a DCM component, with an arbitrary one; Maps to {\ref fix16_fast_mul_unit} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+/*!
+* \def fusion_atan2 Arc tangent used for the output angles; Maps to {\ref fix16_fast_atan2} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+/*!
+* \def fusion_asin Arc sine used for the output angles; Maps to {\ref fix16_fast_asin} if {\ref FIX16_FAST_KERNELS} is set.
+*/
+/*!
+* \def fusion_add Addition used in the filter kernels, accumulating the overflow into a flag word; See {\ref fix16_fast_add}.
+*/
+/*!
+* \def fusion_sub Subtraction used in the filter kernels, accumulating the overflow into a flag word; See {\ref fix16_fast_sub}.
+*/
+#if FIX16_FAST_KERNELS
+#define fusion_mul(a, b)    fix16_fast_mul((a), (b))
+#define fusion_mul_unit(u, b)   fix16_fast_mul_unit((u), (b))
+#define fusion_atan2(y, x)  fix16_fast_atan2((y), (x))
+#define fusion_asin(x)      fix16_fast_asin((x))
+#define fusion_add(a, b, overflow)  fix16_fast_add((a), (b), &(overflow))
+#define fusion_sub(a, b, overflow)  fix16_fast_sub((a), (b), &(overflow))
+#else
+#define fusion_mul(a, b)    fix16_mul((a), (b))
+#define fusion_mul_unit(u, b)   fix16_mul((u), (b))
+#define fusion_atan2(y, x)  fix16_atan2((y), (x))
+#define fusion_asin(x)      fix16_asin((x))
+#define fusion_add(a, b, overflow)  fusion_checked(fix16_add((a), (b)), &(overflow))
+#define fusion_sub(a, b, overflow)  fusion_checked(fix16_sub((a), (b)), &(overflow))
+
+/*!
+* \brief Accumulates the overflow of a libfixmath result into a flag word like {\ref fix16_fast_add}
+* \param[in] value The result
+* \param[inout] overflow The flag word
+* \return The result
+*/
+HOT NONNULL
+STATIC_INLINE fix16_t fusion_checked(register const fix16_t value, register uint32_t *const overflow)
+{
+    *overflow |= (fix16_overflow == value) ? 0x80000000u : 0;
+    return value;
+}
+#endif
+
+#if FUSION_GENERATED_KERNELS
+#include "fusion/kalman_kernels.h"
+#endif
+
 /************************************************************************/
 /* Helper functions                                                     */
 /************************************************************************/
@@ -290,36 +691,56 @@ STATIC_INLINE fix16_t norm2(register const fix16_t a, register const fix16_t b)
     return fix16_sqrt(fix16_add(fix16_sq(a), fix16_sq(b)));
 }
 
-
-// Calculates dest = A + B * s
+/*!*
+* \brief Normalizes a three component vector in place
+*
+* With {\ref FIX16_FAST_KERNELS} the vector is scaled by the reciprocal norm,
+* which replaces the square root and the three (software) divisions by multiplications.
+*/
 HOT NONNULL
-STATIC_INLINE void mf16_add_scaled(mf16 *dest, const mf16 *RESTRICT a, const mf16 *RESTRICT b, const fix16_t s)
-{
-    int row, column;
-
-    if (dest->columns != a->columns || dest->rows != a->rows)
-        dest->errors |= FIXMATRIX_DIMERR;
-
-    if (a->columns != b->columns || a->rows != b->rows)
-        dest->errors |= FIXMATRIX_DIMERR;
+STATIC_INLINE void normalize3(register fix16_t *RESTRICT const a, register fix16_t *RESTRICT const b, register fix16_t *RESTRICT const c) {
+#if FIX16_FAST_KERNELS
+    register const fix16_t inv_norm = fix16_fast_rsqrt(fix16_add(fix16_fast_mul(*a, *a), fix16_add(fix16_fast_mul(*b, *b), fix16_fast_mul(*c, *c))));
+    *a = fix16_fast_mul(*a, inv_norm);
+    *b = fix16_fast_mul(*b, inv_norm);
+    *c = fix16_fast_mul(*c, inv_norm);
+#else
+    register const fix16_t norm = norm3(*a, *b, *c);
+    *a = fix16_div(*a, norm);
+    *b = fix16_div(*b, norm);
+    *c = fix16_div(*c, norm);
+#endif
+}
 
-    for (row = 0; row < dest->rows; row++)
+/*!*
+* \brief Normalizes a three component vector of about unit length in place, e.g. a DCM row
+*
+* With {\ref FIX16_FAST_KERNELS} the squared length is summed in Q2.30 and each component is
+* corrected by its product with the deviation of the reciprocal length from one, which is bounded,
+* see {\ref fix16_fast_mul_unit()}. Vectors out of that range are left to {\ref normalize3()}.
+*/
+HOT NONNULL
+STATIC_INLINE void normalize3_unit(register fix16_t *RESTRICT const a, register fix16_t *RESTRICT const b, register fix16_t *RESTRICT const c) {
+#if FIX16_FAST_KERNELS
+    // components within +/-1.125 keep the squared length within the Q2.30 range
+    #define WITHIN_UNIT(x) ((uint32_t)((x) + F16(1.125)) <= (uint32_t)F16(2.25))
+    if (WITHIN_UNIT(*a) && WITHIN_UNIT(*b) && WITHIN_UNIT(*c))
     {
-        for (column = 0; column < dest->columns; column++)
+        register const fix16_t deviation = fix16_fast_rsqrt(fix16_fast_norm_sq_unit(*a, *b, *c)) - F16(1);
+        if (fix16_abs(deviation) <= F16(1))
         {
-            register const fix16_t scaled = fix16_mul(b->data[row][column], s);
-            register fix16_t sum = fix16_add(a->data[row][column], scaled);
-
-#ifndef FIXMATH_NO_OVERFLOW
-            if (sum == fix16_overflow)
-                dest->errors |= FIXMATRIX_OVERFLOW;
-#endif
-
-            dest->data[row][column] = sum;
+            *a += fix16_fast_mul_unit(deviation, *a);
+            *b += fix16_fast_mul_unit(deviation, *b);
+            *c += fix16_fast_mul_unit(deviation, *c);
+            return;
         }
     }
+    #undef WITHIN_UNIT
+#endif
+    normalize3(a, b, c);
 }
 
+
 /************************************************************************/
 /* System initialization                                                */
 /************************************************************************/
@@ -330,83 +751,98 @@ STATIC_INLINE void mf16_add_scaled(mf16 *dest, const mf16 *RESTRICT a, const mf1
 * \param[in] deltaT The time differential
 */
 HOT NONNULL LEAF
-STATIC_INLINE void update_state_matrix_from_state(kalman16_uc_t *const kf, register fix16_t deltaT)
+STATIC_INLINE void update_state_matrix_from_state(fusion_filter_t *const kf, register fix16_t deltaT)
 {
-    mf16 *const A = &kf->A;
-    const mf16 *const x = &kf->x;
-
-    fix16_t c1 = x->data[0][0];
-    fix16_t c2 = x->data[1][0];
-    fix16_t c3 = x->data[2][0];
-
-    //matrix_set(A, 0, 3,   0);
-    matrix_set(A, 0, 4,  fix16_mul(c3, deltaT));
-    matrix_set(A, 0, 5, -fix16_mul(c2, deltaT));
-
-    matrix_set(A, 1, 3, -fix16_mul(c3, deltaT));
-    //matrix_set(A, 1, 4,   0);
-    matrix_set(A, 1, 5,  fix16_mul(c1, deltaT));
-
-    matrix_set(A, 2, 3,  fix16_mul(c2, deltaT));
-    matrix_set(A, 2, 4, -fix16_mul(c1, deltaT));
-    //matrix_set(A, 2, 5,   0);
+    for (uint_fast8_t axis = 0; axis < KF_AXES; ++axis)
+    {
+        const fix16_t c1 = kf->x[3 * axis + 0];
+        const fix16_t c2 = kf->x[3 * axis + 1];
+        const fix16_t c3 = kf->x[3 * axis + 2];
+        fix16_t (*const B)[3] = kf->B[axis];
+
+        //B[0][0] = 0;
+        B[0][1] =  fusion_mul_unit(c3, deltaT);
+        B[0][2] = -fusion_mul_unit(c2, deltaT);
+
+        B[1][0] = -fusion_mul_unit(c3, deltaT);
+        //B[1][1] = 0;
+        B[1][2] =  fusion_mul_unit(c1, deltaT);
+
+        B[2][0] =  fusion_mul_unit(c2, deltaT);
+        B[2][1] = -fusion_mul_unit(c1, deltaT);
+        //B[2][2] = 0;
+    }
 }
 
 /*!
-* \brief Initialization of a specific filter
+* \brief Sets the diagonal of the process noise of a specific filter
+* \param[in] kf The filter to update
 */
 COLD NONNULL
-static void initialize_system_filter(kalman16_uc_t *const kf, const uint_fast8_t states)
+static void set_process_noise(fusion_filter_t *const kf)
 {
-    kalman_filter_initialize_uc(kf, states);
+    // axis process noise
+    for (uint_fast8_t i = 0; i < KF_GYRO_STATE; ++i)
+    {
+        kf->q[i] = q_axis;
+    }
+
+    // gyro process noise
+    kf->q[KF_GYRO_STATE + 0] = q_gyro;
+    kf->q[KF_GYRO_STATE + 1] = q_gyro;
+    kf->q[KF_GYRO_STATE + 2] = q_gyro;
+}
 
+/*!
+* \brief Initialization of a specific filter
+*/
+COLD NONNULL
+static void initialize_system_filter(fusion_filter_t *const kf)
+{
     /************************************************************************/
     /* Prepare initial state estimation                                     */
     /************************************************************************/
-    // intentionally left blank, because the initialize function already set the vector to zero
+    for (uint_fast8_t i = 0; i < KF_STATES; ++i)
+    {
+        kf->x[i] = 0;
+    }
 
     /************************************************************************/
     /* Set state transition model                                           */
     /************************************************************************/
+    for (uint_fast8_t axis = 0; axis < KF_AXES; ++axis)
     {
-        mf16 *const A = &kf->A;
-        mf16_fill_diagonal(A, F16(1));
-        update_state_matrix_from_state(kf, F16(1)); // assume bootstrap dT := 1
+        for (uint_fast8_t i = 0; i < 3; ++i)
+        {
+            kf->B[axis][i][0] = kf->B[axis][i][1] = kf->B[axis][i][2] = 0;
+        }
     }
+    update_state_matrix_from_state(kf, F16(1)); // assume bootstrap dT := 1
 
     /************************************************************************/
     /* Set state variances                                                  */
     /************************************************************************/
+    for (uint_fast8_t i = 0; i < KF_COVARIANCE_SIZE; ++i)
     {
-        mf16 *const P = &kf->P;
-
-        // initial axis (accelerometer/magnetometer) variances
-        matrix_set(P, 0, 0, F16(5));
-        matrix_set(P, 1, 1, F16(5));
-        matrix_set(P, 2, 2, F16(5));
+        kf->P[i] = 0;
+    }
 
-        // initial gyro variances
-        matrix_set(P, 3, 3, F16(1));
-        matrix_set(P, 4, 4, F16(1));
-        matrix_set(P, 5, 5, F16(1));
+    // initial axis (accelerometer/magnetometer) variances
+    for (uint_fast8_t i = 0; i < KF_GYRO_STATE; ++i)
+    {
+        P_AT(kf, i, i) = F16(5);
     }
+
+    // initial gyro variances
+    P_AT(kf, KF_GYRO_STATE + 0, KF_GYRO_STATE + 0) = F16(1);
+    P_AT(kf, KF_GYRO_STATE + 1, KF_GYRO_STATE + 1) = F16(1);
+    P_AT(kf, KF_GYRO_STATE + 2, KF_GYRO_STATE + 2) = F16(1);
     
     /************************************************************************/
     /* Set system process noise                                             */
     /************************************************************************/
-    {
-        mf16 *const Q = &kf->Q;
 
-        // axis process noise
-        matrix_set(Q, 0, 0, q_axis);
-        matrix_set(Q, 1, 1, q_axis);
-        matrix_set(Q, 2, 2, q_axis);
-
-        // gyro process noise
-        matrix_set(Q, 3, 3, q_gyro);
-        matrix_set(Q, 4, 4, q_gyro);
-        matrix_set(Q, 5, 5, q_gyro);
-    }
+    set_process_noise(kf);
 }
 
 /*!
@@ -415,17 +851,37 @@ static void initialize_system_filter(kalman16_uc_t *const kf, const uint_fast8_t
 COLD
 static void initialize_system()
 {
-    initialize_system_filter(&kf_orientation, KF_ORIENTATION_STATES);
-    initialize_system_filter(&kf_attitude, KF_ATTITUDE_STATES);
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+    initialize_system_filter(&kf_joint);
+#else
+    initialize_system_filter(&kf_orientation);
+    initialize_system_filter(&kf_attitude);
+#endif
 
     // set intial state estimate
-    kf_attitude.x.data[0][0] = 0;
-    kf_attitude.x.data[1][0] = 0;
-    kf_attitude.x.data[2][0] = 1;
+    ATTITUDE_AXIS[0] = 0;
+    ATTITUDE_AXIS[1] = 0;
+    ATTITUDE_AXIS[2] = 1;
 
-    kf_orientation.x.data[0][0] = 0;
-    kf_orientation.x.data[1][0] = 1;
-    kf_orientation.x.data[2][0] = 0;
+    ORIENTATION_AXIS[0] = 0;
+    ORIENTATION_AXIS[1] = 1;
+    ORIENTATION_AXIS[2] = 0;
+
+    // forget previous measurements, so that the filters can be re-initialized
+    m_have_accelerometer = false;
+    m_have_gyroscope = false;
+    m_have_magnetometer = false;
+    m_attitude_bootstrapped = false;
+    m_orientation_bootstrapped = false;
+    m_bootstrap_accelerometer.x = m_bootstrap_accelerometer.y = m_bootstrap_accelerometer.z = 0;
+    m_bootstrap_magnetometer.x = m_bootstrap_magnetometer.y = m_bootstrap_magnetometer.z = 0;
+    m_bootstrap_accelerometer_count = 0;
+    m_bootstrap_magnetometer_count = 0;
+    m_attitude_correction_age = 0;
+    m_orientation_correction_age = 0;
+    m_magnetic_reference_valid = false;
+    m_magnetic_disturbance_evaluated = false;
+    m_magnetic_disturbed = false;
 }
 
 /*!
@@ -435,17 +891,15 @@ static void initialize_system()
 * \param[in] gyroXYZ The gyro observation noise
 */
 HOT NONNULL
-STATIC_INLINE void update_measurement_noise(kalman16_observation_t *const kfm, register const fix16_t axisXYZ, register const fix16_t gyroXYZ)
+STATIC_INLINE void update_measurement_noise(fusion_observation_t *const kfm, register const fix16_t axisXYZ, register const fix16_t gyroXYZ)
 {
-    mf16 *const R = &kfm->R;
-
-    matrix_set(R, 0, 0, axisXYZ);
-    matrix_set(R, 1, 1, axisXYZ);
-    matrix_set(R, 2, 2, axisXYZ);
+    kfm->r[0] = axisXYZ;
+    kfm->r[1] = axisXYZ;
+    kfm->r[2] = axisXYZ;
 
-    matrix_set(R, 3, 3, gyroXYZ);
-    matrix_set(R, 4, 4, gyroXYZ);
-    matrix_set(R, 5, 5, gyroXYZ);
+    kfm->r[3] = gyroXYZ;
+    kfm->r[4] = gyroXYZ;
+    kfm->r[5] = gyroXYZ;
 }
 
 /*!
@@ -464,47 +918,45 @@ STATIC_INLINE uint_fast8_t acceleration_detected()
     return 1;
 }
 
+/*!
+* \def NOISE_SCALE Fetches the factor the observation noise of a sensor is scaled with
+* \param[in] estimator The noise estimator of the sensor
+*/
+#if FUSION_ADAPTIVE_NOISE
+#define NOISE_SCALE(estimator) noise_estimator_scale(&(estimator))
+#else
+#define NOISE_SCALE(estimator) fix16_one
+#endif
+
 /*!
 * \brief Dynamic measurement noise updating
+* \param[in] kfm The measurement to update
+* \param[in] axis_scale The factor the axis observation noise is scaled with, see {\ref NOISE_SCALE}
 */
 HOT NONNULL
-STATIC_INLINE void tune_measurement_noise(kalman16_observation_t *const kfm)
+STATIC_INLINE void tune_measurement_noise(fusion_observation_t *const kfm, register const fix16_t axis_scale)
 {
-    mf16 *const R = &kfm->R;
-  
-
-    matrix_set(R, 0, 0, fix16_mul(initial_r_axis, alpha1));
-    matrix_set(R, 1, 1, fix16_mul(initial_r_axis, alpha1));
-    matrix_set(R, 2, 2, fix16_mul(initial_r_axis, alpha1));
-
-    matrix_set(R, 3, 3, fix16_mul(initial_r_gyro, alpha2));
-    matrix_set(R, 4, 4, fix16_mul(initial_r_gyro, alpha2));
-    matrix_set(R, 5, 5, fix16_mul(initial_r_gyro, alpha2));
+    update_measurement_noise(kfm,
+        fix16_mul(fix16_mul(initial_r_axis, alpha1), axis_scale),
+        fix16_mul(fix16_mul(initial_r_gyro, alpha2), NOISE_SCALE(m_gyroscope_noise)));
 }
 
 /*!
 * \brief Initialization of a specific measurement
 */
 COLD
-static void initialize_observation(kalman16_observation_t *const kfm, const uint_fast8_t states, const uint_fast8_t observations)
+static void initialize_observation(fusion_observation_t *const kfm, const uint_fast8_t observations, const uint_fast8_t axis_state)
 {
-    kalman_observation_initialize(kfm, states, observations);
+    kfm->count = observations;
 
     /************************************************************************/
     /* Set observation model                                                */
     /************************************************************************/
+    for (uint_fast8_t i = 0; i < observations; ++i)
     {
-        mf16 *const H = &kfm->H;
-
-        // axes
-        matrix_set(H, 0, 0, F16_ONE);
-        matrix_set(H, 1, 1, F16_ONE);
-        matrix_set(H, 2, 2, F16_ONE);
-
-        // gyro
-        matrix_set(H, 3, 3, F16_ONE);
-        matrix_set(H, 4, 4, F16_ONE);
-        matrix_set(H, 5, 5, F16_ONE);
+        // axes, then gyro
+        kfm->state[i] = (i < 3) ? (axis_state + i) : (KF_GYRO_STATE + i - 3);
+        kfm->z[i] = 0;
     }
 
     /************************************************************************/
@@ -519,8 +971,7 @@ static void initialize_observation(kalman16_observation_t *const kfm, const uint
 COLD
 static void initialize_observation_accel()
 {
-    kalman16_observation_t *const kfm = &kfm_accel;
-    initialize_observation(kfm, KF_ATTITUDE_STATES, KFM_ACCEL);
+    initialize_observation(&kfm_accel, KFM_ACCEL, ATTITUDE_STATE);
 }
 
 /*!
@@ -529,8 +980,7 @@ static void initialize_observation_accel()
 COLD
 static void initialize_observation_magneto()
 {
-    kalman16_observation_t *const kfm = &kfm_magneto;
-    initialize_observation(kfm, KF_ORIENTATION_STATES, KFM_MAGNETO);
+    initialize_observation(&kfm_magneto, KFM_MAGNETO, ORIENTATION_STATE);
 }
 
 /*!
@@ -539,31 +989,22 @@ static void initialize_observation_magneto()
 COLD
 static void initialize_observation_gyro()
 {
-    kalman_observation_initialize(&kfm_gyro, KF_ORIENTATION_STATES, KFM_GYRO);
+    kfm_gyro.count = KFM_GYRO;
 
     /************************************************************************/
     /* Set observation model                                                */
     /************************************************************************/
+    for (uint_fast8_t i = 0; i < KFM_GYRO; ++i)
     {
-        mf16 *const H = &kfm_gyro.H;
-
         // gyro
-        matrix_set(H, 0, 3, F16_ONE);
-        matrix_set(H, 1, 4, F16_ONE);
-        matrix_set(H, 2, 5, F16_ONE);
-    }
-
-    /************************************************************************/
-    /* Set observation process noise covariance                             */
-    /************************************************************************/
-    {
-        mf16 *const R = &kfm_gyro.R;
+        kfm_gyro.state[i] = KF_GYRO_STATE + i;
+        kfm_gyro.z[i] = 0;
 
-        matrix_set(R, 0, 0, initial_r_gyro);
-        matrix_set(R, 1, 1, initial_r_gyro);
-        matrix_set(R, 2, 2, initial_r_gyro);
+        /************************************************************************/
+        /* Set observation process noise covariance                             */
+        /************************************************************************/
+        kfm_gyro.r[i] = initial_r_gyro;
     }
-
 }
 
 /*!
@@ -571,119 +1012,166 @@ static void initialize_observation_gyro()
 */
 void fusion_initialize()
 {
+#if FIX16_FAST_KERNELS
+    assert(fix16_fast_verify() == 0);
+#endif
+
     initialize_system();
     initialize_observation_gyro();
     initialize_observation_accel();
     initialize_observation_magneto();
-}
 
-/************************************************************************/
-/* State calculation helpers                                            */
-/************************************************************************/
+    complementary_filter_initialize(&m_complementary);
+    m_hybrid_samples = 0;
+    m_hybrid_deltaT = 0;
+
+#if FUSION_ADAPTIVE_NOISE
+    // start out at the calibrated variances in Q32, which resolves those below one fix16 LSB; The gyroscope variances are in degree/s.
+    int64_t x, y, z;
+    mpu6050_var_accelerometer_q32(&x, &y, &z);
+    noise_estimator_initialize(&m_accelerometer_noise, x, y, z, fix16_one);
+    mpu6050_var_gyroscope_q32(&x, &y, &z);
+    noise_estimator_initialize(&m_gyroscope_noise, x, y, z, F16(3.14159265358979 / 180));
+    hmc5883l_var_q32(&x, &y, &z);
+    noise_estimator_initialize(&m_magnetometer_noise, x, y, z, fix16_one);
+#endif
+}
 
 /*!
-* \brief Sanitizes the state variables
+* \brief Sets a tuning parameter of the sensor fusion.
+* \param[in] parameter The parameter
+* \param[in] value The value; Must not be negative.
+* \return Zero on success, nonzero if the parameter or value is invalid.
 */
-HOT NONNULL
-STATIC_INLINE void fusion_sanitize_state(kalman16_uc_t *const kf)
+COLD
+uint8_t fusion_set_parameter(register const fusion_parameter_t parameter, register const fix16_t value)
 {
-    mf16 *const A = &kf->A;
-    mf16 *const x = &kf->x;
-    
-    // fetch axes
-    fix16_t c1 = x->data[0][0];
-    fix16_t c2 = x->data[1][0];
-    fix16_t c3 = x->data[2][0];
-
-    // calculate vector norm
-    fix16_t norm = norm3(c1, c2, c3);
-
-    // normalize vectors
-    c1 = fix16_div(c1, norm);
-    c2 = fix16_div(c2, norm);
-    c3 = fix16_div(c3, norm);
-
-    // re-set to state and state matrix
-    x->data[0][0] = c1;
-    x->data[1][0] = c2;
-    x->data[2][0] = c3;
+    if (value < 0) return 1;
+
+    switch (parameter)
+    {
+        case FUSION_PARAMETER_R_AXIS:
+        {
+            initial_r_axis = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_R_PROJECTION:
+        {
+            initial_r_projection = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_R_GYRO:
+        {
+            initial_r_gyro = value;
+            for (uint_fast8_t i = 0; i < KFM_GYRO; ++i)
+            {
+                kfm_gyro.r[i] = value;
+            }
+            return 0;
+        }
+        case FUSION_PARAMETER_Q_AXIS:
+        {
+            q_axis = value;
+            set_process_noise(&kf_attitude);
+            set_process_noise(&kf_orientation);
+            return 0;
+        }
+        case FUSION_PARAMETER_Q_GYRO:
+        {
+            q_gyro = value;
+            set_process_noise(&kf_attitude);
+            set_process_noise(&kf_orientation);
+            return 0;
+        }
+        case FUSION_PARAMETER_ALPHA1:
+        {
+            alpha1 = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_ALPHA2:
+        {
+            alpha2 = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_ATTITUDE_THRESHOLD:
+        {
+            attitude_threshold = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_COMPLEMENTARY_KP:
+        {
+            m_complementary.kp = value;
+            return 0;
+        }
+        case FUSION_PARAMETER_COMPLEMENTARY_KI:
+        {
+            m_complementary.ki = value;
+            return 0;
+        }
+        default:
+        {
+            return 1;
+        }
+    }
 }
 
 /*!
-* \brief Fetches the values without any modification
-* \param[out] roll The roll angle in radians.
-* \param[out] pitch The pitch (elevation) angle in radians.
+* \brief Fetches a tuning parameter of the sensor fusion.
+* \param[in] parameter The parameter
+* \return The value, or -1 if the parameter is invalid.
 */
-HOT NONNULL LEAF
-STATIC_INLINE void calculate_roll_pitch(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch)
+COLD LEAF
+fix16_t fusion_get_parameter(register const fusion_parameter_t parameter)
 {
-    const mf16 *const x = kalman_get_state_vector_uc(&kf_attitude);
-
-    // fetch axes
-    fix16_t c31 =  x->data[0][0];
-    fix16_t c32 =  x->data[1][0];
-    fix16_t c33 =  x->data[2][0];
-    
-    // calculate pitch
-    *pitch = -fix16_asin(c31);
-
-    // calculate roll
-    *roll = -fix16_atan2(c32, -c33);
+    switch (parameter)
+    {
+        case FUSION_PARAMETER_R_AXIS:               return initial_r_axis;
+        case FUSION_PARAMETER_R_PROJECTION:         return initial_r_projection;
+        case FUSION_PARAMETER_R_GYRO:               return initial_r_gyro;
+        case FUSION_PARAMETER_Q_AXIS:               return q_axis;
+        case FUSION_PARAMETER_Q_GYRO:               return q_gyro;
+        case FUSION_PARAMETER_ALPHA1:               return alpha1;
+        case FUSION_PARAMETER_ALPHA2:               return alpha2;
+        case FUSION_PARAMETER_ATTITUDE_THRESHOLD:   return attitude_threshold;
+        case FUSION_PARAMETER_COMPLEMENTARY_KP:     return m_complementary.kp;
+        case FUSION_PARAMETER_COMPLEMENTARY_KI:     return m_complementary.ki;
+        default:                                    return -fix16_one;
+    }
 }
 
+/************************************************************************/
+/* State calculation helpers                                            */
+/************************************************************************/
+
 /*!
-* \brief Fetches the values without any modification
-* \param[in] roll The roll angle in radians.
-* \param[in] pitch The pitch (elevation) angle in radians.
-* \param[out] yaw The yaw angle in radians
+* \brief Sanitizes the state variables
 */
-HOT NONNULL LEAF
-STATIC_INLINE void calculate_yaw(register const fix16_t roll, register const fix16_t pitch, register fix16_t *RESTRICT const yaw)
+HOT NONNULL
+STATIC_INLINE void fusion_sanitize_state(fusion_filter_t *const kf)
 {
-    const mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
-
-    // fetch axes
-    const fix16_t c21 = x2->data[0][0];
-    const fix16_t c22 = x2->data[1][0];
-    const fix16_t c23 = x2->data[2][0];
+    for (uint_fast8_t axis = 0; axis < KF_AXES; ++axis)
+    {
+        fix16_t *const x = &kf->x[3 * axis];
 
-    const fix16_t c31 = x3->data[0][0];
-    const fix16_t c32 = x3->data[1][0];
-    const fix16_t c33 = x3->data[2][0];
+        // fetch axes
+        fix16_t c1 = x[0];
+        fix16_t c2 = x[1];
+        fix16_t c3 = x[2];
 
-    // calculate partial cross product for C11
-    // C1  = cross([C21 C22 C23], [C31 C32 C33])
-    // -->
-    //      C11 = C22*C33 - C23*C32
-    //      C12 = C23*C31 - C21*C33
-    //      C13 = C21*C32 - C22*C31
-    fix16_t c11 = fix16_sub(fix16_mul(c22, c33), fix16_mul(c23, c32));
+        // normalize vectors; the rows are close to unit length
+        normalize3_unit(&c1, &c2, &c3);
 
-    // calculate pitch
-    *yaw = fix16_atan2(c21, -c11);
+        // re-set to state and state matrix
+        x[0] = c1;
+        x[1] = c2;
+        x[2] = c3;
+    }
 }
 
 /************************************************************************/
 /* Convenience functions                                                */
 /************************************************************************/
 
-/*!
-* \brief Fetches the values without any modification
-* \param[out] roll The roll angle in degree.
-* \param[out] pitch The pitch (elevation) angle in degree.
-* \param[out] yaw The yaw (heading, azimuth) angle in degree.
-*/
-HOT NONNULL LEAF
-void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
-{
-    // calculate roll and pitch
-    calculate_roll_pitch(roll, pitch);
-
-    // calculate yaw
-    calculate_yaw(*roll, *pitch, yaw);
-}
-
 /*!
 * \brief  Returns the maximum value of two 
 */
@@ -698,26 +1186,26 @@ STATIC_INLINE const fix16_t zero_or_value(register const fix16_t value)
 * \param[out] quat The orientation quaternion
 *
 * While this method, described at http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/index.htm
-* should be computationally faster than opt2, it would result in glitches (i.e. flipping of the rotation axis' signs) around pitch 0, yaw 180.
+* should be computationally faster than {\ref sensor_dcm3_to_quaternion()}, it would result in glitches (i.e. flipping of the rotation axis' signs) around pitch 0, yaw 180.
 *
 */
 HOT NONNULL LEAF
 static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
 {
-    const register mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const register mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
+    const register fix16_t *const x2 = OUTPUT_ORIENTATION_AXIS;
+    const register fix16_t *const x3 = OUTPUT_ATTITUDE_AXIS;
 
     // m00 = R(1, 1);    m01 = R(1, 2);    m02 = R(1, 3);
     // m10 = R(2, 1);    m11 = R(2, 2);    m12 = R(2, 3);
     // m20 = R(3, 1);    m21 = R(3, 2);    m22 = R(3, 3);
 
-    const fix16_t m10 = x2->data[0][0];
-    const fix16_t m11 = x2->data[1][0];
-    const fix16_t m12 = x2->data[2][0];
+    const fix16_t m10 = x2[0];
+    const fix16_t m11 = x2[1];
+    const fix16_t m12 = x2[2];
 
-    const fix16_t m20 = x3->data[0][0];
-    const fix16_t m21 = x3->data[1][0];
-    const fix16_t m22 = x3->data[2][0];
+    const fix16_t m20 = x3[0];
+    const fix16_t m21 = x3[1];
+    const fix16_t m22 = x3[2];
 
     // calculate cross product for C1
     // m0 = cross([m10 m11 m12], [m20 m21 m22])
@@ -730,10 +1218,7 @@ static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
     fix16_t m02 = fix16_sub(fix16_mul(m10, m21), fix16_mul(m11, m20));
 
     // normalize C1 
-    const register fix16_t norm = norm3(m00, m01, m02);
-    m00 = fix16_div(m00, norm);
-    m01 = fix16_div(m01, norm);
-    m02 = fix16_div(m02, norm);
+    normalize3(&m00, &m01, &m02);
 
     /*
     From MATLAB code:
@@ -790,128 +1275,97 @@ static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
     qf16_normalize(quat, quat);
 }
 
+/************************************************************************/
+/* Output cache                                                         */
+/************************************************************************/
+
 /*!
-* \brief Fetches the orientation quaternion.
-* \param[out] quat The orientation quaternion
+* \brief The orientation quaternion calculated from the current state
 */
-HOT NONNULL LEAF
-static void fetch_quaternion_opt2(register qf16 *RESTRICT const quat)
-{
-    const register mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const register mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
-
-    // m00 = R(1, 1);    m01 = R(1, 2);    m02 = R(1, 3);
-    // m10 = R(2, 1);    m11 = R(2, 2);    m12 = R(2, 3);
-    // m20 = R(3, 1);    m21 = R(3, 2);    m22 = R(3, 3);
+static qf16 m_output_quaternion;
 
-    const fix16_t m10 = x2->data[0][0];
-    const fix16_t m11 = x2->data[1][0];
-    const fix16_t m12 = x2->data[2][0];
+/*!
+* \brief The Euler angles derived from {\ref m_output_quaternion}
+*/
+static fix16_t m_output_roll, m_output_pitch, m_output_yaw;
 
-    const fix16_t m20 = -x3->data[0][0];
-    const fix16_t m21 = -x3->data[1][0];
-    const fix16_t m22 = -x3->data[2][0];
+/*!
+* \brief The filtered angular velocity in rad/s
+*/
+static v3d m_output_rate;
 
-    // calculate cross product for C1
-    // m0 = cross([m10 m11 m12], [m20 m21 m22])
-    // -->
-    //      m00 = m11*m22 - m12*m21
-    //      m01 = m12*m20 - m10*m22
-    //      m02 = m10*m21 - m11*m20
-    fix16_t m00 = fix16_sub(fix16_mul(m11, m22), fix16_mul(m12, m21));
-    fix16_t m01 = fix16_sub(fix16_mul(m12, m20), fix16_mul(m10, m22));
-    fix16_t m02 = fix16_sub(fix16_mul(m10, m21), fix16_mul(m11, m20));
+/*!
+* \brief The gravity compensated acceleration in g
+*/
+static v3d m_output_linear_acceleration;
 
-    // normalize C1 
-    const register fix16_t norm = norm3(m00, m01, m02);
-    m00 = fix16_div(m00, norm);
-    m01 = fix16_div(m01, norm);
-    m02 = fix16_div(m02, norm);
+/*!
+* \brief Determines if the cached outputs must be recalculated
+*/
+static bool m_output_dirty = true;
 
-    // "Angel" code
-    // http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+/*!
+* \brief Determines if the cached rate and acceleration must be recalculated; Separate, so that they do not require the quaternion.
+*/
+static bool m_output_motion_dirty = true;
 
-    fix16_t qw, qx, qy, qz;
+/*!
+* \brief Marks the cached outputs as outdated after the state changed
+*/
+HOT LEAF
+STATIC_INLINE void invalidate_output()
+{
+    m_output_dirty = true;
+    m_output_motion_dirty = true;
+}
 
-    // check the matrice's trace
-    const register fix16_t trace = fix16_add(m00, fix16_add(m11, m22));
-    if (trace > 0)
+/*!
+* \brief Recalculates the angular velocity and the linear acceleration from the state if required
+*
+* C3 is the observed direction of the accelerometer reading at rest, so that
+* the calibrated specific force minus C3 leaves the acceleration in g.
+*/
+HOT LEAF
+static void update_motion_output()
+{
+    if (false == m_output_motion_dirty)
     {
-        /*
-        s = 0.5 / sqrt(trace + 1.0);
-        qw = 0.25 / s;
-        qx = ( R(3,2) - R(2,3) ) * s;
-        qy = ( R(1,3) - R(3,1) ) * s;
-        qz = ( R(2,1) - R(1,2) ) * s;
-        */
+        return;
+    }
 
-        const fix16_t s = fix16_div(F16(0.5), fix16_sqrt(fix16_add(F16(1.0), trace)));
+    const fix16_t *const rate = OUTPUT_RATE;
+    m_output_rate.x = rate[0];
+    m_output_rate.y = rate[1];
+    m_output_rate.z = rate[2];
 
-        qw = fix16_div(F16(0.25), s);
-        qx = fix16_mul(fix16_sub(m21, m12), s);
-        qy = fix16_mul(fix16_sub(m02, m20), s);
-        qz = fix16_mul(fix16_sub(m10, m01), s);
-    }
-    else
+    const fix16_t *const c3 = OUTPUT_ATTITUDE_AXIS;
+    m_output_linear_acceleration.x = fix16_sub(m_accelerometer.x, c3[0]);
+    m_output_linear_acceleration.y = fix16_sub(m_accelerometer.y, c3[1]);
+    m_output_linear_acceleration.z = fix16_sub(m_accelerometer.z, c3[2]);
+
+    m_output_motion_dirty = false;
+}
+
+/*!
+* \brief Recalculates the quaternion and the Euler angles from the state if required
+*
+* Both are taken from the same rotation matrix, whose rows are C1, C2 and -C3 of the state.
+* The rows are unit length after the update, so that only C1 needs to be derived.
+*/
+HOT LEAF
+static void update_output()
+{
+    if (false == m_output_dirty)
     {
-        if (m00 > m11 && m00 > m22)
-        {
-            /*
-            s = 2.0 * sqrt( 1.0 + R(1,1) - R(2,2) - R(3,3));
-            qw = (R(3,2) - R(2,3) ) / s;
-            qx = 0.25 * s;
-            qy = (R(1,2) + R(2,1) ) / s;
-            qz = (R(1,3) + R(3,1) ) / s;
-            */
-            const fix16_t s = fix16_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m00, fix16_add(m11, m22)))));
-
-            qw = fix16_div(fix16_sub(m21, m12), s);
-            qx = fix16_mul(F16(0.25), s);
-            qy = fix16_div(fix16_add(m01, m10), s);
-            qz = fix16_div(fix16_add(m02, m20), s);
-        }
-        else if (m11 > m22)
-        {
-            /*
-            s = 2.0 * sqrt( 1.0 + R(2,2) - R(1,1) - R(3,3));
-            qw = (R(1,3) - R(3,1) ) / s;
-            qx = (R(1,2) + R(2,1) ) / s;
-            qy = 0.25 * s;
-            qz = (R(2,3) + R(3,2) ) / s;
-            */
-            const fix16_t s = fix16_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m11, fix16_add(m00, m22)))));
-
-            qw = fix16_div(fix16_sub(m02, m20), s);
-            qx = fix16_div(fix16_add(m01, m10), s);
-            qy = fix16_mul(F16(0.25), s);
-            qz = fix16_div(fix16_add(m12, m21), s);
-        }
-        else
-        {
-            /*
-            s = 2.0 * sqrt( 1.0 + R(3,3) - R(1,1) - R(2,2) );
-            qw = (R(2,1) - R(1,2) ) / s;
-            qx = (R(1,3) + R(3,1) ) / s;
-            qy = (R(2,3) + R(3,2) ) / s;
-            qz = 0.25 * s;
-            */
-            const fix16_t s = fix16_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m22, fix16_add(m00, m11)))));
-
-            qw = fix16_div(fix16_sub(m10, m01), s);
-            qx = fix16_div(fix16_add(m02, m20), s);
-            qy = fix16_div(fix16_add(m12, m21), s);
-            qz = fix16_mul(F16(0.25), s);
-        }
+        return;
     }
 
-    // compose quaternion
-    quat->a = qw;
-    quat->b = qx;
-    quat->c = qy;
-    quat->d = qz;
+    dcm3_t dcm;
+    sensor_dcm3_from_rows(&dcm, OUTPUT_ORIENTATION_AXIS, OUTPUT_ATTITUDE_AXIS);
+    sensor_dcm3_to_quaternion(&dcm, &m_output_quaternion);
+    sensor_dcm3_to_rpy(&dcm, &m_output_roll, &m_output_pitch, &m_output_yaw);
 
-    // normalizify
-    qf16_normalize(quat, quat);
+    m_output_dirty = false;
 }
 
 /*!
@@ -921,7 +1375,104 @@ static void fetch_quaternion_opt2(register qf16 *RESTRICT const quat)
 HOT NONNULL LEAF
 void fusion_fetch_quaternion(register qf16 *RESTRICT const quat)
 {
-    fetch_quaternion_opt2(quat);
+    update_output();
+    *quat = m_output_quaternion;
+}
+
+/*!
+* \brief Fetches the values without any modification
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch (elevation) angle in radians.
+* \param[out] yaw The yaw (heading, azimuth) angle in radians.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
+{
+    update_output();
+    *roll = m_output_roll;
+    *pitch = m_output_pitch;
+    *yaw = m_output_yaw;
+}
+
+/*!
+* \brief Fetches the filtered angular velocity.
+* \param[out] rate The angular velocity in body coordinates in rad/s
+*/
+HOT NONNULL LEAF
+void fusion_fetch_angular_rate(register v3d *RESTRICT const rate)
+{
+    update_motion_output();
+    *rate = m_output_rate;
+}
+
+/*!
+* \brief Fetches the gravity compensated acceleration.
+* \param[out] acceleration The linear acceleration in body coordinates in g
+*/
+HOT NONNULL LEAF
+void fusion_fetch_linear_acceleration(register v3d *RESTRICT const acceleration)
+{
+    update_motion_output();
+    *acceleration = m_output_linear_acceleration;
+}
+
+/*!
+* \brief The longest time in seconds {\ref fusion_fetch_quaternion_extrapolated()} extrapolates over
+*/
+static const fix16_t extrapolation_limit = F16(0.1);
+
+/*!
+* \brief Extrapolates a DCM row with an angular velocity in a single first order step
+* \param[out] out The extrapolated, normalized row
+* \param[in] row The row
+* \param[in] rate The angular velocity multiplied by the time step, in radians
+*
+* The rows move like in the prediction, see {\ref update_state_matrix_from_state()}.
+*/
+HOT NONNULL LEAF
+STATIC_INLINE void extrapolate_row(v3d *RESTRICT const out, const fix16_t *RESTRICT const row, const v3d *RESTRICT const rate)
+{
+    out->x = fix16_add(row[0], fix16_sub(fusion_mul_unit(row[2], rate->y), fusion_mul_unit(row[1], rate->z)));
+    out->y = fix16_add(row[1], fix16_sub(fusion_mul_unit(row[0], rate->z), fusion_mul_unit(row[2], rate->x)));
+    out->z = fix16_add(row[2], fix16_sub(fusion_mul_unit(row[1], rate->x), fusion_mul_unit(row[0], rate->y)));
+    normalize3(&out->x, &out->y, &out->z);
+}
+
+/*!
+* \brief Fetches the orientation quaternion extrapolated with the estimated angular velocity.
+* \param[out] quat The orientation quaternion
+* \param[in] deltaT The time in seconds past the state, see {\ref fusion_get_state_time()}
+*/
+HOT NONNULL
+void fusion_fetch_quaternion_extrapolated(register qf16 *RESTRICT const quat, register fix16_t deltaT)
+{
+    if (deltaT <= 0)
+    {
+        fusion_fetch_quaternion(quat);
+        return;
+    }
+    if (deltaT > extrapolation_limit) deltaT = extrapolation_limit;
+
+    const fix16_t *const omega = OUTPUT_RATE;
+    const v3d rate = { fix16_mul(omega[0], deltaT), fix16_mul(omega[1], deltaT), fix16_mul(omega[2], deltaT) };
+
+    v3d attitude, orientation;
+    extrapolate_row(&attitude, OUTPUT_ATTITUDE_AXIS, &rate);
+    extrapolate_row(&orientation, OUTPUT_ORIENTATION_AXIS, &rate);
+
+    dcm3_t dcm;
+    sensor_dcm3_from_rows(&dcm, &orientation.x, &attitude.x);
+    sensor_dcm3_to_quaternion(&dcm, quat);
+}
+
+/*!
+* \brief Fetches the time of the current state.
+* \return The timestamp of the gyroscope measurement of the last update in microseconds, see {\ref fusion_set_gyroscope()}
+*/
+HOT LEAF
+uint32_t fusion_get_state_time()
+{
+    return m_gyroscope_timestamp;
 }
 
 /************************************************************************/
@@ -934,9 +1485,9 @@ void fusion_fetch_quaternion(register qf16 *RESTRICT const quat)
 * \param[in] deltaT The time differential
 */
 HOT NONNULL
-STATIC_INLINE void fusion_fastpredict_X(kalman16_uc_t *const kf, const register fix16_t deltaT)
+STATIC_INLINE void fusion_fastpredict_X(fusion_filter_t *const kf, const register fix16_t deltaT)
 {
-    mf16 *const x = kalman_get_state_vector_uc(kf);
+    fix16_t *const x = kf->x;
 
     /*
         Transition matrix layout:
@@ -950,61 +1501,166 @@ STATIC_INLINE void fusion_fastpredict_X(kalman16_uc_t *const kf, const register
                 0 0 0,     0 0 0];
     */
 
-    // fetch estimated DCM components
-    register const fix16_t c1 = x->data[0][0];
-    register const fix16_t c2 = x->data[1][0];
-    register const fix16_t c3 = x->data[2][0];
+    // fetch estimated angular velocities; they are kept constant.
+    register const fix16_t gx = x[KF_GYRO_STATE + 0];
+    register const fix16_t gy = x[KF_GYRO_STATE + 1];
+    register const fix16_t gz = x[KF_GYRO_STATE + 2];
 
-    // fetch estimated angular velocities
-    register const fix16_t gx = x->data[3][0];
-    register const fix16_t gy = x->data[4][0];
-    register const fix16_t gz = x->data[5][0];
-    
-    // solve differential equations
-    register const fix16_t d_c1 = fix16_sub(fix16_mul(c3, gy), fix16_mul(c2, gz)); //    0*gx  +   c3*gy  + (-c2*gz) = c3*gy - c2*gz
-    register const fix16_t d_c2 = fix16_sub(fix16_mul(c1, gz), fix16_mul(c3, gx)); // (-c3*gx) +    0*gy  +   c1*gz  = c1*gz - c3*gx
-    register const fix16_t d_c3 = fix16_sub(fix16_mul(c2, gx), fix16_mul(c1, gy)); //   c2*gx  + (-c1*gy) +    0*gz  = c2*gx - c1*gy
-
-    // integrate
-    x->data[0][0] = fix16_add(c1, fix16_mul(d_c1, deltaT));
-    x->data[1][0] = fix16_add(c2, fix16_mul(d_c2, deltaT));
-    x->data[2][0] = fix16_add(c3, fix16_mul(d_c3, deltaT));
-
-    // keep constant.
-    x->data[3][0] = gx;
-    x->data[4][0] = gy;
-    x->data[5][0] = gz;
+    for (uint_fast8_t axis = 0; axis < KF_AXES; ++axis)
+    {
+        fix16_t *const c = &x[3 * axis];
+
+        // fetch estimated DCM components
+        register const fix16_t c1 = c[0];
+        register const fix16_t c2 = c[1];
+        register const fix16_t c3 = c[2];
+
+        // solve differential equations; the DCM components are unit bounded, the angular velocities are not
+        register const fix16_t d_c1 = fix16_sub(fusion_mul_unit(c3, gy), fusion_mul_unit(c2, gz)); //    0*gx  +   c3*gy  + (-c2*gz) = c3*gy - c2*gz
+        register const fix16_t d_c2 = fix16_sub(fusion_mul_unit(c1, gz), fusion_mul_unit(c3, gx)); // (-c3*gx) +    0*gy  +   c1*gz  = c1*gz - c3*gx
+        register const fix16_t d_c3 = fix16_sub(fusion_mul_unit(c2, gx), fusion_mul_unit(c1, gy)); //   c2*gx  + (-c1*gy) +    0*gz  = c2*gx - c1*gy
+
+        // integrate
+        c[0] = fix16_add(c1, fusion_mul(d_c1, deltaT));
+        c[1] = fix16_add(c2, fusion_mul(d_c2, deltaT));
+        c[2] = fix16_add(c3, fusion_mul(d_c3, deltaT));
+    }
 }
 
 /*!
-* \brief Performs a prediction of the current Euler angles based on the time difference to the previous prediction/update iteration.
-* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+* \brief Performs a fast covariance update by using knowledge about the matrix structure
+* \param[in] kf The filter whose covariance to update
+*
+* The transition matrix is A = [I B; 0 I] with B being the stacked skew-symmetric blocks set in
+* {\ref update_state_matrix_from_state}. With P = [P11 P12; P21 P22] this gives
+*
+*   P12 := P12 + B*P22
+*   P11 := P11 + B*P21 + (P12 + B*P22)*B'
+*   P22 := P22
+*
+* so that the dense A*P*A' product is not required. Since P is symmetric, only the
+* upper triangle of P11 is calculated. The process noise Q is diagonal.
 */
-HOT
-void fusion_predict(register const fix16_t deltaT)
+HOT NONNULL
+STATIC_INLINE void fusion_fastpredict_P(fusion_filter_t *const kf)
 {
-    mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
-    
-    mf16 *const P2 = kalman_get_system_covariance_uc(&kf_orientation);
-    mf16 *const P3 = kalman_get_system_covariance_uc(&kf_attitude);
-    
-    // update state matrix
-    update_state_matrix_from_state(&kf_attitude, deltaT);
-    update_state_matrix_from_state(&kf_orientation, deltaT);
-
-    // predict state
-    fusion_fastpredict_X(&kf_attitude, deltaT);
-    fusion_fastpredict_X(&kf_orientation, deltaT);
+    // the overflow of all additions, tested once
+    uint32_t overflow = 0;
 
-    // predict covariance
-    kalman_predict_P_uc(&kf_attitude);
-    kalman_predict_P_uc(&kf_orientation);
+#if FUSION_GENERATED_KERNELS
+    fusion_predict_P_generated(kf, &overflow);
+#else
+    // row i of the stacked B is row i%3 of block i/3
+    #define B_AT(kf, i, k) ((kf)->B[(i) / 3][(i) % 3][k])
 
-    // re-orthogonalize and update state matrix
-    fusion_sanitize_state(&kf_attitude);
-    fusion_sanitize_state(&kf_orientation);
-}
+    // M = P12 + B*P22; the diagonal of each block of B is zero
+    fix16_t M[KF_GYRO_STATE][3];
+    for (uint_fast8_t i = 0; i < KF_GYRO_STATE; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            register fix16_t value = P_AT(kf, i, KF_GYRO_STATE + j);
+            for (uint_fast8_t k = 0; k < 3; ++k)
+            {
+                if (k == i % 3) continue;
+                value = fusion_add(value, fusion_mul(B_AT(kf, i, k), P_AT(kf, KF_GYRO_STATE + k, KF_GYRO_STATE + j)), overflow);
+            }
+            M[i][j] = value;
+        }
+    }
+
+    // P11 = P11 + B*P21 + M*B' (upper triangle)
+    for (uint_fast8_t i = 0; i < KF_GYRO_STATE; ++i)
+    {
+        for (uint_fast8_t j = i; j < KF_GYRO_STATE; ++j)
+        {
+            register fix16_t value = P_AT(kf, i, j);
+            for (uint_fast8_t k = 0; k < 3; ++k)
+            {
+                if (k != i % 3) value = fusion_add(value, fusion_mul(B_AT(kf, i, k), P_AT(kf, KF_GYRO_STATE + k, j)), overflow);
+                if (k != j % 3) value = fusion_add(value, fusion_mul(M[i][k], B_AT(kf, j, k)), overflow);
+            }
+            P_AT(kf, i, j) = value;
+        }
+    }
+
+    // P12 = M
+    for (uint_fast8_t i = 0; i < KF_GYRO_STATE; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            P_AT(kf, i, KF_GYRO_STATE + j) = M[i][j];
+        }
+    }
+
+    #undef B_AT
+
+    // P = P + Q
+    for (uint_fast8_t i = 0; i < KF_STATES; ++i)
+    {
+        P_AT(kf, i, i) = fusion_add(P_AT(kf, i, i), kf->q[i], overflow);
+    }
+#endif
+
+    // a diverged covariance cannot recover by itself
+    if (fix16_fast_overflowed(overflow))
+    {
+        initialize_system_filter(kf);
+    }
+}
+
+/*!
+* \brief Performs a Kalman prediction based on the time difference to the previous prediction/update iteration.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*/
+HOT RAMFUNC
+static void fusion_predict_kalman(register const fix16_t deltaT)
+{
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+    // both rows share the angular velocities, so they are integrated once
+    update_state_matrix_from_state(&kf_joint, deltaT);
+    fusion_fastpredict_X(&kf_joint, deltaT);
+    fusion_fastpredict_P(&kf_joint);
+    fusion_sanitize_state(&kf_joint);
+#else
+    // update state matrix
+    update_state_matrix_from_state(&kf_attitude, deltaT);
+    update_state_matrix_from_state(&kf_orientation, deltaT);
+
+    // predict state
+    fusion_fastpredict_X(&kf_attitude, deltaT);
+    fusion_fastpredict_X(&kf_orientation, deltaT);
+
+    // predict covariance
+    fusion_fastpredict_P(&kf_attitude);
+    fusion_fastpredict_P(&kf_orientation);
+
+    // re-orthogonalize and update state matrix
+    fusion_sanitize_state(&kf_attitude);
+    fusion_sanitize_state(&kf_orientation);
+#endif
+}
+
+/*!
+* \brief Performs a prediction of the current Euler angles based on the time difference to the previous prediction/update iteration.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*
+* In {\ref FUSION_MODE_HYBRID}, the Kalman prediction is deferred to the next Kalman step.
+*/
+HOT RAMFUNC
+void fusion_predict(register const fix16_t deltaT)
+{
+    if (FUSION_MODE_KALMAN == m_mode)
+    {
+        fusion_predict_kalman(deltaT);
+    }
+    else
+    {
+        complementary_filter_predict(&m_complementary, deltaT);
+    }
+
+    invalidate_output();
+}
 
 /************************************************************************/
 /* Setters for sensor data                                              */
@@ -1015,12 +1671,14 @@ void fusion_predict(register const fix16_t deltaT)
 * \param[in] ax The x-axis accelerometer value.
 * \param[in] ay The y-axis accelerometer value.
 * \param[in] az The z-axis accelerometer value.
+* \param[in] timestamp The sample time in microseconds
 */
-void fusion_set_accelerometer(register const fix16_t *const ax, register const fix16_t *const ay, register const fix16_t *const az)
+void fusion_set_accelerometer(register const fix16_t *const ax, register const fix16_t *const ay, register const fix16_t *const az, register const uint32_t timestamp)
 {
     m_accelerometer.x = *ax;
     m_accelerometer.y = *ay;
     m_accelerometer.z = *az;
+    m_accelerometer_timestamp = timestamp;
     m_have_accelerometer = true;
 }
 
@@ -1029,12 +1687,14 @@ void fusion_set_accelerometer(register const fix16_t *const ax, register const f
 * \param[in] gx The x-axis gyroscope value.
 * \param[in] gy The y-axis gyroscope value.
 * \param[in] gz The z-axis gyroscope value.
+* \param[in] timestamp The sample time in microseconds
 */
-void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16_t *const gy, register const fix16_t *const gz)
+void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16_t *const gy, register const fix16_t *const gz, register const uint32_t timestamp)
 {
     m_gyroscope.x = *gx;
     m_gyroscope.y = *gy;
     m_gyroscope.z = *gz;
+    m_gyroscope_timestamp = timestamp;
     m_have_gyroscope = true;
 }
 
@@ -1043,41 +1703,107 @@ void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16
 * \param[in] mx The x-axis magnetometer value.
 * \param[in] my The y-axis magnetometer value.
 * \param[in] mz The z-axis magnetometer value.
+* \param[in] timestamp The sample time in microseconds
 */
-void fusion_set_magnetometer(register const fix16_t *const mx, register const fix16_t *const my, register const fix16_t *const mz)
+void fusion_set_magnetometer(register const fix16_t *const mx, register const fix16_t *const my, register const fix16_t *const mz, register const uint32_t timestamp)
 {
     m_magnetometer.x = *mx;
     m_magnetometer.y = *my;
     m_magnetometer.z = *mz;
+    m_magnetometer_timestamp = timestamp;
     m_have_magnetometer = true;
+    m_magnetic_disturbance_evaluated = false;
 }
 
 /************************************************************************/
 /* State udpate                                                         */
 /************************************************************************/
 
+/*!
+* \brief Performs a Kalman correction by sequentially processing scalar observations
+* \param[inout] kf The filter to correct
+* \param[in] kfm The observation
+*
+* Since R is diagonal, processing the observations one row at a time yields the same result
+* as the batch update, but the innovation covariance degenerates to a scalar, so that
+* only a single division per observation is required instead of a matrix inversion.
+* Each row of H selects a single state, so P*h' is a column of P.
+*/
+HOT NONNULL RAMFUNC
+static void fusion_correct(fusion_filter_t *const kf, const fusion_observation_t *const kfm)
+{
+    // the overflow of all additions, tested once
+    uint32_t overflow = 0;
+
+    // the rows left to the generic loop; None if a generated kernel matches the model
+#if FUSION_GENERATED_KERNELS
+    const uint_fast8_t count = fusion_correct_generated(kf, kfm, &overflow) ? 0 : kfm->count;
+#else
+    const uint_fast8_t count = kfm->count;
+#endif
+
+    for (uint_fast8_t i = 0; i < count; ++i)
+    {
+        const uint_fast8_t observed = kfm->state[i];
+
+        // Ph = P*h'
+        fix16_t Ph[KF_STATES];
+        for (uint_fast8_t j = 0; j < KF_STATES; ++j)
+        {
+            Ph[j] = P_AT(kf, j, observed);
+        }
+
+        // scalar innovation covariance s = h*P*h' + r
+        const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(Ph[observed], kfm->r[i], overflow));
+        const fix16_t innovation = fusion_sub(kfm->z[i], kf->x[observed], overflow);
+
+        // K = Ph/s; x = x + K*y
+        fix16_t K[KF_STATES];
+        for (uint_fast8_t j = 0; j < KF_STATES; ++j)
+        {
+            K[j] = fusion_mul(Ph[j], inv_s);
+            kf->x[j] = fusion_add(kf->x[j], fusion_mul(K[j], innovation), overflow);
+        }
+
+        // P = P - K*Ph'; symmetric, so only the upper triangle is calculated
+        for (uint_fast8_t j = 0; j < KF_STATES; ++j)
+        {
+            for (uint_fast8_t k = j; k < KF_STATES; ++k)
+            {
+                P_AT(kf, j, k) = fusion_sub(P_AT(kf, j, k), fusion_mul(K[j], Ph[k]), overflow);
+            }
+        }
+    }
+
+    // a diverged covariance cannot recover by itself; The state is re-normalized by the caller.
+    if (fix16_fast_overflowed(overflow))
+    {
+        initialize_system_filter(kf);
+    }
+}
+
 /*!
 * \brief Updates the current prediction with gyroscope data
 */
-HOT
+HOT RAMFUNC
 void fusion_update_attitude_gyro(register const fix16_t deltaT)
 {
     /************************************************************************/
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_gyro.z;
+        fix16_t *const z = kfm_gyro.z;
 
-        matrix_set(z, 0, 0, m_gyroscope.x);
-        matrix_set(z, 1, 0, m_gyroscope.y);
-        matrix_set(z, 2, 0, m_gyroscope.z);
+        z[0] = m_gyroscope.x;
+        z[1] = m_gyroscope.y;
+        z[2] = m_gyroscope.z;
     }
 
     /************************************************************************/
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_attitude, &kfm_gyro);
+    fusion_correct(&kf_attitude, &kfm_gyro);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1089,7 +1815,7 @@ void fusion_update_attitude_gyro(register const fix16_t deltaT)
 /*!
 * \brief Updates the current prediction with accelerometer data
 */
-HOT
+HOT RAMFUNC
 void fusion_update_attitude(register const fix16_t deltaT)
 {
     /************************************************************************/
@@ -1106,30 +1832,29 @@ void fusion_update_attitude(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_accel.z;
+        fix16_t *const z = kfm_accel.z;
 
-        fix16_t norm = v3d_norm(&m_accelerometer);
-        
-        matrix_set(z, 0, 0, fix16_div(m_accelerometer.x, norm));
-        matrix_set(z, 1, 0, fix16_div(m_accelerometer.y, norm));
-        matrix_set(z, 2, 0, fix16_div(m_accelerometer.z, norm));
+        z[0] = m_accelerometer.x;
+        z[1] = m_accelerometer.y;
+        z[2] = m_accelerometer.z;
+        normalize3(&z[0], &z[1], &z[2]);
 
-        matrix_set(z, 3, 0, m_gyroscope.x);
-        matrix_set(z, 4, 0, m_gyroscope.y);
-        matrix_set(z, 5, 0, m_gyroscope.z);
+        z[3] = m_gyroscope.x;
+        z[4] = m_gyroscope.y;
+        z[5] = m_gyroscope.z;
     }
 
     /************************************************************************/
     /* Prepare noise                                                        */
     /************************************************************************/
 
-    tune_measurement_noise(&kfm_accel);
+    tune_measurement_noise(&kfm_accel, NOISE_SCALE(m_accelerometer_noise));
 
     /************************************************************************/
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_attitude, &kfm_accel);
+    fusion_correct(&kf_attitude, &kfm_accel);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1139,22 +1864,20 @@ void fusion_update_attitude(register const fix16_t deltaT)
 }
 
 /*!
-* \brief Projects the current magnetometer readings in m_magnetometer into the X/Y plane
-* \param[in] roll The roll angle
-* \param[in] pitch The pitch angle
+* \brief Projects magnetometer readings into the X/Y plane
+* \param[in] x The attitude DCM row (C3) to project with
+* \param[in] m The magnetometer readings, usually {\ref m_magnetometer}
 * \param[out] mx The projected x component
 * \param[out] my The projected y component
 * \param[out] mz The projected z component
-* \return Cosine of pitch. Used to detect singularity.
+* \param[out] field The field strength and vertical component, see {\ref magnetic_disturbance_detected()}
 */
 HOT LEAF NONNULL
-STATIC_INLINE void magnetometer_project(fix16_t *RESTRICT const mx, fix16_t *RESTRICT const my, fix16_t *RESTRICT const mz)
+STATIC_INLINE void magnetometer_project(const fix16_t *const x, const v3d *const m, fix16_t *RESTRICT const mx, fix16_t *RESTRICT const my, fix16_t *RESTRICT const mz, magnetic_field_t *RESTRICT const field)
 {
-    const mf16 *const x = kalman_get_state_vector_uc(&kf_attitude);
-
-    register const fix16_t acc_x = x->data[0][0];
-    register const fix16_t acc_y = x->data[1][0];
-    register const fix16_t acc_z = x->data[2][0];
+    register const fix16_t acc_x = x[0];
+    register const fix16_t acc_y = x[1];
+    register const fix16_t acc_z = x[2];
 
     /************************************************************************/
     /* Instead of tilt corrected magnetometer, use TRIAD algorithm          */
@@ -1166,39 +1889,100 @@ STATIC_INLINE void magnetometer_project(fix16_t *RESTRICT const mx, fix16_t *RES
     //      mx = m_magnetometer.y*m_accelerometer.z - m_magnetometer.z*m_accelerometer.y
     //      my = m_magnetometer.z*m_accelerometer.x - m_magnetometer.x*m_accelerometer.z
     //      mz = m_magnetometer.x*m_accelerometer.y - m_magnetometer.y*m_accelerometer.x
-    *mx = fix16_sub(fix16_mul(m_magnetometer.y, acc_z), fix16_mul(m_magnetometer.z, acc_y));
-    *my = fix16_sub(fix16_mul(m_magnetometer.z, acc_x), fix16_mul(m_magnetometer.x, acc_z));
-    *mz = fix16_sub(fix16_mul(m_magnetometer.x, acc_y), fix16_mul(m_magnetometer.y, acc_x));
+    // the attitude row is unit bounded, the magnetometer readings are not
+    *mx = fix16_sub(fusion_mul_unit(acc_z, m->y), fusion_mul_unit(acc_y, m->z));
+    *my = fix16_sub(fusion_mul_unit(acc_x, m->z), fusion_mul_unit(acc_z, m->x));
+    *mz = fix16_sub(fusion_mul_unit(acc_y, m->x), fusion_mul_unit(acc_x, m->y));
+
+    // the field metrics come with the same operands; the vertical component is |m|*sin(dip)
+    field->norm_sq = fix16_add(fix16_add(fusion_mul(m->x, m->x), fusion_mul(m->y, m->y)), fusion_mul(m->z, m->z));
+    field->vertical = fix16_add(fix16_add(fusion_mul_unit(acc_x, m->x), fusion_mul_unit(acc_y, m->y)), fusion_mul_unit(acc_z, m->z));
 
     // normalize C1 
-    const register fix16_t norm = norm3(*mx, *my, *mz);
-    *mx = fix16_div(*mx, norm);
-    *my = fix16_div(*my, norm);
-    *mz = fix16_div(*mz, norm);
+    normalize3(mx, my, mz);
+}
+
+/*!
+* \brief Detects magnetic disturbances by comparing field strength and dip with the learned reference
+* \param[in] field The field metrics of the current reading, see {\ref magnetometer_project()}
+* \return <code>true</code> if the reading should not be used to correct the orientation
+*
+* Undisturbed readings slowly update the reference, so that it follows temperature drift;
+* A disturbance that persists for {\ref FUSION_MAGNETIC_DISTURBANCE_LIMIT} replaces it.
+* Each reading is evaluated once; Further calls for it return the same result.
+*/
+HOT NONNULL
+static bool magnetic_disturbance_detected(const magnetic_field_t *const field)
+{
+    if (true == m_magnetic_disturbance_evaluated)
+    {
+        return m_magnetic_disturbed;
+    }
+    m_magnetic_disturbance_evaluated = true;
+
+    if (false == m_magnetic_reference_valid)
+    {
+        m_magnetic_reference = *field;
+        m_magnetic_reference_valid = true;
+        m_magnetic_disturbed = false;
+        return false;
+    }
+
+    const fix16_t norm_sq_deviation = fix16_abs(fix16_sub(field->norm_sq, m_magnetic_reference.norm_sq));
+    const fix16_t vertical_deviation = fix16_sub(field->vertical, m_magnetic_reference.vertical);
+
+    const bool disturbed = (norm_sq_deviation > fix16_mul(magnetic_norm_sq_threshold, m_magnetic_reference.norm_sq))
+        || (fix16_mul(vertical_deviation, vertical_deviation) > fix16_mul(magnetic_vertical_sq_threshold, m_magnetic_reference.norm_sq));
+
+    if (!disturbed)
+    {
+        m_magnetic_disturbed = false;
+        m_magnetic_reference.norm_sq = fix16_add(m_magnetic_reference.norm_sq, fix16_sub(field->norm_sq, m_magnetic_reference.norm_sq) / FUSION_MAGNETIC_REFERENCE_RATE);
+        m_magnetic_reference.vertical = fix16_add(m_magnetic_reference.vertical, vertical_deviation / FUSION_MAGNETIC_REFERENCE_RATE);
+        return false;
+    }
+
+    if (false == m_magnetic_disturbed)
+    {
+        m_magnetic_disturbed = true;
+        m_magnetic_disturbance_timestamp = m_magnetometer_timestamp;
+        return true;
+    }
+
+    // the age of the disturbance, independent of the magnetometer rate
+    if ((uint32_t)(m_magnetometer_timestamp - m_magnetic_disturbance_timestamp) >= FUSION_MAGNETIC_DISTURBANCE_LIMIT)
+    {
+        m_magnetic_reference = *field;
+        m_magnetic_disturbed = false;
+        return false;
+    }
+
+    return true;
 }
 
 /*!
 * \brief Updates the current prediction with gyroscope data
 */
-HOT
+#if FUSION_ENGINE != FUSION_ENGINE_JOINT
+HOT RAMFUNC
 static void fusion_update_orientation_gyro(register const fix16_t deltaT)
 {
     /************************************************************************/
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_gyro.z;
+        fix16_t *const z = kfm_gyro.z;
 
-        matrix_set(z, 0, 0, m_gyroscope.x);
-        matrix_set(z, 1, 0, m_gyroscope.y);
-        matrix_set(z, 2, 0, m_gyroscope.z);
+        z[0] = m_gyroscope.x;
+        z[1] = m_gyroscope.y;
+        z[2] = m_gyroscope.z;
     }
 
     /************************************************************************/
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_orientation, &kfm_gyro);
+    fusion_correct(&kf_orientation, &kfm_gyro);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1206,18 +1990,29 @@ static void fusion_update_orientation_gyro(register const fix16_t deltaT)
 
     fusion_sanitize_state(&kf_orientation);
 }
+#endif
 
 /*!
 * \brief Updates the current prediction with magnetometer data
 */
-HOT
+HOT RAMFUNC
 static void fusion_update_orientation(register const fix16_t deltaT)
 {
     /************************************************************************/
     /* Calculate metrics required for update                                */
     /************************************************************************/
     fix16_t mx, my, mz;
-    magnetometer_project(&mx, &my, &mz);
+    magnetic_field_t field;
+    magnetometer_project(ATTITUDE_AXIS, &m_magnetometer, &mx, &my, &mz, &field);
+
+    // a disturbed field would pull the heading; the joint filter already observed the gyroscope with the attitude.
+    if (magnetic_disturbance_detected(&field))
+    {
+#if FUSION_ENGINE != FUSION_ENGINE_JOINT
+        fusion_update_orientation_gyro(deltaT);
+#endif
+        return;
+    }
     
 #if 0
     // check for singularity
@@ -1232,14 +2027,16 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     /* Prepare noise                                                        */
     /************************************************************************/
 
-    tune_measurement_noise(&kfm_magneto);
+    const fix16_t magnetometer_scale = NOISE_SCALE(m_magnetometer_noise);
+    tune_measurement_noise(&kfm_magneto, magnetometer_scale);
     {
-        mf16 *const R = &kfm_magneto.R;
+        fix16_t *const r = kfm_magneto.r;
 
         // anyway, overwrite covariance of projection
-        matrix_set(R, 0, 0, fix16_mul(initial_r_projection, alpha1));
-        matrix_set(R, 1, 1, fix16_mul(initial_r_projection, alpha1));
-        matrix_set(R, 2, 2, fix16_mul(initial_r_projection, alpha1));
+        const fix16_t r_projection = fix16_mul(fix16_mul(initial_r_projection, alpha1), magnetometer_scale);
+        r[0] = r_projection;
+        r[1] = r_projection;
+        r[2] = r_projection;
     }
 
     
@@ -1248,20 +2045,22 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_magneto.z;
-
-        matrix_set(z, 0, 0, mx);
-        matrix_set(z, 1, 0, my);
-        matrix_set(z, 2, 0, mz);
-
-#if 1
-        matrix_set(z, 3, 0, m_gyroscope.x);
-        matrix_set(z, 4, 0, m_gyroscope.y);
-        matrix_set(z, 5, 0, m_gyroscope.z);
+        fix16_t *const z = kfm_magneto.z;
+
+        z[0] = mx;
+        z[1] = my;
+        z[2] = mz;
+
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+        // the gyroscope was already observed by the attitude update
+#elif 1
+        z[3] = m_gyroscope.x;
+        z[4] = m_gyroscope.y;
+        z[5] = m_gyroscope.z;
 #else
-        matrix_set(z, 3, 0, kf_attitude.x.data[3][0]);
-        matrix_set(z, 4, 0, kf_attitude.x.data[4][0]);
-        matrix_set(z, 5, 0, kf_attitude.x.data[5][0]);
+        z[3] = kf_attitude.x[3];
+        z[4] = kf_attitude.x[4];
+        z[5] = kf_attitude.x[5];
 #endif
     }
 
@@ -1269,7 +2068,7 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_orientation, &kfm_magneto);
+    fusion_correct(&kf_orientation, &kfm_magneto);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1278,11 +2077,136 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     fusion_sanitize_state(&kf_orientation);
 }
 
+/************************************************************************/
+/* Time alignment                                                       */
+/************************************************************************/
+
 /*!
-* \brief Updates the current prediction with the set measurements.
+* \brief Rotates the magnetometer reading from its sample time to the state time
+* \return <code>false</code> if the reading is too old to be used
+*
+* The field is constant in the world frame, so that in the body frame it follows
+* dm/dt = w x m like the DCM rows do. Without this, the orientation filter would see
+* the heading of up to one magnetometer period ago, lagging behind during fast turns.
+*/
+HOT
+static bool align_magnetometer()
+{
+    // signed, so that readings taken after the MPU6050 sample are rotated back
+    const int32_t age = (int32_t)(m_gyroscope_timestamp - m_magnetometer_timestamp);
+    if ((age > FUSION_MAGNETOMETER_MAX_AGE) || (age < -FUSION_MAGNETOMETER_MAX_AGE))
+    {
+        return false;
+    }
+
+    // microseconds to seconds; 2^16/10^6 as 0.32 fixed point, see Timebase_ToSeconds()
+    const fix16_t dt = (fix16_t)(((int64_t)age * 281474977) >> 32);
+
+    const v3d m = m_magnetometer;
+    m_magnetometer.x = fix16_add(m.x, fusion_mul(fix16_sub(fusion_mul(m_gyroscope.y, m.z), fusion_mul(m_gyroscope.z, m.y)), dt));
+    m_magnetometer.y = fix16_add(m.y, fusion_mul(fix16_sub(fusion_mul(m_gyroscope.z, m.x), fusion_mul(m_gyroscope.x, m.z)), dt));
+    m_magnetometer.z = fix16_add(m.z, fusion_mul(fix16_sub(fusion_mul(m_gyroscope.x, m.y), fusion_mul(m_gyroscope.y, m.x)), dt));
+
+    // the reading is now taken at the state time
+    m_magnetometer_timestamp = m_gyroscope_timestamp;
+    return true;
+}
+
+/************************************************************************/
+/* Bootstrapping                                                        */
+/************************************************************************/
+
+/*!
+* \brief Adds a sample to a bootstrap sum
+* \param[inout] sum The sum
+* \param[in] sample The sample
+*/
+HOT NONNULL
+STATIC_INLINE void bootstrap_accumulate(register v3d *const sum, register const v3d *const sample)
+{
+    sum->x = fix16_add(sum->x, sample->x);
+    sum->y = fix16_add(sum->y, sample->y);
+    sum->z = fix16_add(sum->z, sample->z);
+}
+
+/*!
+* \brief Collects the accelerometer data and calculates the initial attitude from the average
+* \param[out] c3 The attitude DCM row, set once the average is complete
+* \return <code>true</code> once the average is complete
+*
+* Averaging suppresses the sensor noise, so that the filter can start with a small covariance
+* instead of converging from a single noisy sample.
+*/
+HOT NONNULL
+static bool bootstrap_attitude(fix16_t *const c3)
+{
+    bootstrap_accumulate(&m_bootstrap_accelerometer, &m_accelerometer);
+    if (++m_bootstrap_accelerometer_count < FUSION_BOOTSTRAP_ACCELEROMETER_SAMPLES)
+    {
+        return false;
+    }
+
+    // the direction of the sum is the direction of the mean
+    c3[0] = m_bootstrap_accelerometer.x;
+    c3[1] = m_bootstrap_accelerometer.y;
+    c3[2] = m_bootstrap_accelerometer.z;
+    normalize3(&c3[0], &c3[1], &c3[2]);
+    return true;
+}
+
+/*!
+* \brief Collects the magnetometer data and calculates the initial orientation from the average
+* \param[in] c3 The bootstrapped attitude DCM row
+* \param[out] c2 The orientation DCM row, set once the average is complete
+* \return <code>true</code> once the average is complete
+*
+* The average is projected with the same TRIAD construction as the measurements, see {\ref magnetometer_project()}.
+*/
+HOT NONNULL
+static bool bootstrap_orientation(const fix16_t *const c3, fix16_t *const c2)
+{
+    bootstrap_accumulate(&m_bootstrap_magnetometer, &m_magnetometer);
+    if (++m_bootstrap_magnetometer_count < FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES)
+    {
+        return false;
+    }
+
+    // the accumulated field is no reading; the reference is seeded by the next one
+    magnetic_field_t field;
+    magnetometer_project(c3, &m_bootstrap_magnetometer, &c2[0], &c2[1], &c2[2], &field);
+    m_magnetic_reference_valid = false;
+    return true;
+}
+
+/*!
+* \brief Seeds the covariance of a bootstrapped DCM row from the sensor variances
+* \param[inout] kf The filter
+* \param[in] state The index of the first DCM component of the row
+* \param[in] x The x axis variance of the sensor with respect to its norm; Must be positive.
+* \param[in] y The y axis variance of the sensor with respect to its norm; Must be positive.
+* \param[in] z The z axis variance of the sensor with respect to its norm; Must be positive.
+* \param[in] samples The number of averaged samples
+*/
+COLD NONNULL
+static void bootstrap_seed_covariance(fusion_filter_t *const kf, const uint_fast8_t state, const fix16_t x, const fix16_t y, const fix16_t z, const uint_fast8_t samples)
+{
+    const fix16_t variance[3] = { x, y, z };
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        assert(variance[i] > 0);
+
+        // the variance of the mean, rounded up so that it stays representable, plus the motion allowance
+        const fix16_t value = (variance[i] + samples - 1) / samples;
+        P_AT(kf, state + i, state + i) = fix16_add(value, bootstrap_motion_variance);
+    }
+}
+
+/*!
+* \brief Updates the current Kalman prediction with the set measurements.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
 */
-void fusion_update(register const fix16_t deltaT)
+HOT RAMFUNC
+static void fusion_update_kalman(register const fix16_t deltaT)
 {
 #if TEST_ENABLED
 #if TEST_GYROS // force gyro-only
@@ -1298,56 +2222,353 @@ void fusion_update(register const fix16_t deltaT)
 #endif
 #endif
 
-    // perform roll and pitch updates
-    if (true == m_have_accelerometer)
+#if FUSION_ADAPTIVE_NOISE
+    // track the noise of every sample, including those not used for a correction
+    if (true == m_have_accelerometer) noise_estimator_update(&m_accelerometer_noise, &m_accelerometer);
+    if (true == m_have_gyroscope) noise_estimator_update(&m_gyroscope_noise, &m_gyroscope);
+    if (true == m_have_magnetometer) noise_estimator_update(&m_magnetometer_noise, &m_magnetometer);
+#endif
+
+    // track the time since the last full corrections
+    m_attitude_correction_age = fix16_add(m_attitude_correction_age, deltaT);
+    m_orientation_correction_age = fix16_add(m_orientation_correction_age, deltaT);
+
+    // bootstrap the attitude filter from the averaged first samples; Until then, only the gyroscope is used.
+    if ((true == m_have_accelerometer) && (false == m_attitude_bootstrapped))
     {
-        // bootstrap filter
-        if (false == m_attitude_bootstrapped)
+        if (bootstrap_attitude(ATTITUDE_AXIS))
         {
-            fix16_t norm = v3d_norm(&m_accelerometer);
+            fix16_t x, y, z;
+            mpu6050_var_accelerometer(&x, &y, &z);
+            bootstrap_seed_covariance(&kf_attitude, ATTITUDE_STATE, x, y, z, FUSION_BOOTSTRAP_ACCELEROMETER_SAMPLES);
+            m_attitude_bootstrapped = true;
+        }
+        m_have_accelerometer = m_attitude_bootstrapped;
+    }
 
-            kf_attitude.x.data[0][0] = fix16_div(m_accelerometer.x, norm);
-            kf_attitude.x.data[1][0] = fix16_div(m_accelerometer.y, norm);
-            kf_attitude.x.data[2][0] = fix16_div(m_accelerometer.z, norm);
+    // accelerometer corrections are only required at a lower rate than the gyro updates
+    if ((true == m_have_accelerometer) && (m_attitude_correction_age < attitude_correction_period))
+    {
+        m_have_accelerometer = false;
+    }
 
-            m_attitude_bootstrapped = true;
+    // bootstrap the orientation filter likewise; The magnetometer can only be projected with a known attitude.
+    if ((true == m_have_magnetometer) && (false == m_orientation_bootstrapped))
+    {
+        if ((true == m_attitude_bootstrapped) && bootstrap_orientation(ATTITUDE_AXIS, ORIENTATION_AXIS))
+        {
+            // the direction varies with the variance relative to the squared field strength
+            const fix16_t mx = m_bootstrap_magnetometer.x / FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES;
+            const fix16_t my = m_bootstrap_magnetometer.y / FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES;
+            const fix16_t mz = m_bootstrap_magnetometer.z / FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES;
+            const fix16_t norm_sq = fix16_add(fix16_sq(mx), fix16_add(fix16_sq(my), fix16_sq(mz)));
+
+            fix16_t x, y, z;
+            hmc5883l_var(&x, &y, &z);
+            if (norm_sq > 0)
+            {
+                // fields stronger than one unit shrink the relative variances below the resolution
+                x = fix16_div(x, norm_sq);
+                y = fix16_div(y, norm_sq);
+                z = fix16_div(z, norm_sq);
+                if (x < 1) x = 1;
+                if (y < 1) y = 1;
+                if (z < 1) z = 1;
+            }
+            bootstrap_seed_covariance(&kf_orientation, ORIENTATION_STATE, x, y, z, FUSION_BOOTSTRAP_MAGNETOMETER_SAMPLES);
+            m_orientation_bootstrapped = true;
         }
+        m_have_magnetometer = m_orientation_bootstrapped;
+    }
+
+    // magnetometer corrections are limited likewise, see FUSION_ORIENTATION_CORRECTION_RATE
+    if ((true == m_have_magnetometer) && (m_orientation_correction_age < orientation_correction_period))
+    {
+        m_have_magnetometer = false;
+    }
 
+    // perform roll and pitch updates
+    if (true == m_have_accelerometer)
+    {
+        PROFILE_START(attitude_start);
         fusion_update_attitude(deltaT);
+        PROFILE_STOP(PROFILE_STAGE_UPDATE_ATTITUDE, attitude_start);
+        m_attitude_correction_age = 0;
     }
     else
     {
         // perform only rotational update
+        PROFILE_START(attitude_start);
         fusion_update_attitude_gyro(deltaT);
+        PROFILE_STOP(PROFILE_STAGE_UPDATE_ATTITUDE_GYRO, attitude_start);
     }
 
-    // perform yaw updates
+    // perform yaw updates; the magnetometer flag is only set for fresh samples
     if (true == m_have_magnetometer)
     {
-        // bootstrap filter
-        // make sure that the attitude filter was already bootstrapped in order to be able to project the
-        // magnetometer readings
-        if ((false == m_orientation_bootstrapped) && (true == m_attitude_bootstrapped))
-        {
-            fix16_t mx, my, mz;
-            magnetometer_project(&mx, &my, &mz);
-
-            kf_orientation.x.data[0][0] = mx;
-            kf_orientation.x.data[1][0] = my;
-            kf_orientation.x.data[2][0] = mz;
-
-            m_orientation_bootstrapped = true;
-        }
-
+        PROFILE_START(orientation_start);
         fusion_update_orientation(deltaT);
+        PROFILE_STOP(PROFILE_STAGE_UPDATE_ORIENTATION, orientation_start);
+        m_orientation_correction_age = 0;
     }
+#if FUSION_ENGINE != FUSION_ENGINE_JOINT
     else
     {
-        // perform only rotational update
+        // perform only rotational update; the joint filter did so with the attitude.
+        PROFILE_START(orientation_start);
         fusion_update_orientation_gyro(deltaT);
+        PROFILE_STOP(PROFILE_STAGE_UPDATE_ORIENTATION_GYRO, orientation_start);
     }
+#endif
     
     // reset information
     m_have_accelerometer = false;
     m_have_magnetometer = false;
 }
+
+/*!
+* \brief Updates the complementary filter with the set measurements.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*/
+HOT RAMFUNC
+static void fusion_update_complementary(register const fix16_t deltaT)
+{
+    const v3d *c3 = NULL;
+    const v3d *c2 = NULL;
+    v3d attitude, orientation;
+
+    // bootstrap from the averaged first samples, see fusion_update_kalman()
+    if ((true == m_have_accelerometer) && (false == m_attitude_bootstrapped))
+    {
+        m_attitude_bootstrapped = bootstrap_attitude(&m_complementary.c3.x);
+        m_have_accelerometer = false;
+    }
+    if ((true == m_have_magnetometer) && (false == m_orientation_bootstrapped))
+    {
+        m_orientation_bootstrapped = m_attitude_bootstrapped && bootstrap_orientation(&m_complementary.c3.x, &m_complementary.c2.x);
+        m_have_magnetometer = false;
+    }
+
+    // the accelerometer only observes the attitude if there is no external acceleration
+    if ((true == m_have_accelerometer) && !acceleration_detected())
+    {
+        attitude = m_accelerometer;
+        normalize3(&attitude.x, &attitude.y, &attitude.z);
+        c3 = &attitude;
+    }
+
+    // the magnetometer is projected with the estimated attitude, see fusion_update_orientation()
+    if (true == m_have_magnetometer)
+    {
+        magnetic_field_t field;
+        magnetometer_project(&m_complementary.c3.x, &m_magnetometer, &orientation.x, &orientation.y, &orientation.z, &field);
+        if (!magnetic_disturbance_detected(&field)) c2 = &orientation;
+    }
+
+    complementary_filter_correct(&m_complementary, &m_gyroscope, c3, c2, deltaT);
+
+    // reset information
+    m_have_accelerometer = false;
+    m_have_magnetometer = false;
+}
+
+/*!
+* \brief Updates the complementary filter with the set gyroscope data and runs a Kalman step every {\ref m_hybrid_decimation} samples.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*
+* The complementary filter then uses the Kalman estimate as its observation, so that the
+* outputs have the latency of the complementary filter and the precision of the Kalman filter.
+* Samples in between Kalman steps only contribute their gyroscope data.
+*/
+HOT RAMFUNC
+static void fusion_update_hybrid(register const fix16_t deltaT)
+{
+    m_hybrid_deltaT = fix16_add(m_hybrid_deltaT, deltaT);
+    if (++m_hybrid_samples < m_hybrid_decimation)
+    {
+        complementary_filter_correct(&m_complementary, &m_gyroscope, NULL, NULL, deltaT);
+        return;
+    }
+
+    // the Kalman filter integrates the latest gyroscope data over the whole interval
+    const bool bootstrapped = m_attitude_bootstrapped && m_orientation_bootstrapped;
+    fusion_predict_kalman(m_hybrid_deltaT);
+    fusion_update_kalman(m_hybrid_deltaT);
+
+    // take over the bootstrapped orientation instead of converging to it
+    if (!bootstrapped)
+    {
+        complementary_filter_set_rows(&m_complementary, ATTITUDE_AXIS, ORIENTATION_AXIS);
+    }
+
+    const v3d attitude = { ATTITUDE_AXIS[0], ATTITUDE_AXIS[1], ATTITUDE_AXIS[2] };
+    const v3d orientation = { ORIENTATION_AXIS[0], ORIENTATION_AXIS[1], ORIENTATION_AXIS[2] };
+    complementary_filter_correct(&m_complementary, &m_gyroscope, &attitude, &orientation, m_hybrid_deltaT);
+
+    m_hybrid_samples = 0;
+    m_hybrid_deltaT = 0;
+}
+
+/*!
+* \brief Updates the current prediction with the set measurements.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*/
+HOT RAMFUNC
+void fusion_update(register const fix16_t deltaT)
+{
+    // the magnetometer runs on its own clock
+    if ((true == m_have_magnetometer) && (true == m_have_gyroscope))
+    {
+        m_have_magnetometer = align_magnetometer();
+    }
+
+    switch (m_mode)
+    {
+        case FUSION_MODE_COMPLEMENTARY:
+        {
+            fusion_update_complementary(deltaT);
+            break;
+        }
+        case FUSION_MODE_HYBRID:
+        {
+            fusion_update_hybrid(deltaT);
+            break;
+        }
+        default:
+        {
+            fusion_update_kalman(deltaT);
+            break;
+        }
+    }
+
+    invalidate_output();
+}
+
+/*!
+* \brief Selects the fusion mode.
+* \param[in] mode The mode
+* \return Zero on success, nonzero if the mode is invalid.
+*/
+COLD
+uint8_t fusion_set_mode(register const fusion_mode_t mode)
+{
+    if (FUSION_MODE_KALMAN != mode && FUSION_MODE_COMPLEMENTARY != mode && FUSION_MODE_HYBRID != mode) return 1;
+    if (mode == m_mode) return 0;
+
+    if (FUSION_MODE_KALMAN == m_mode)
+    {
+        // the complementary filter continues from the Kalman estimate
+        complementary_filter_set_rows(&m_complementary, ATTITUDE_AXIS, ORIENTATION_AXIS);
+    }
+    else if (FUSION_MODE_COMPLEMENTARY == m_mode)
+    {
+        // the Kalman filter did not follow the complementary filter; Start over.
+        initialize_system();
+    }
+
+    m_hybrid_samples = 0;
+    m_hybrid_deltaT = 0;
+    m_mode = mode;
+
+    invalidate_output();
+    return 0;
+}
+
+/*!
+* \brief Fetches the fusion mode.
+* \return The mode
+*/
+COLD LEAF
+fusion_mode_t fusion_get_mode()
+{
+    return m_mode;
+}
+
+/************************************************************************/
+/* Warm restart                                                         */
+/************************************************************************/
+
+// the snapshot layout in the header must match the engine
+typedef char fusion_snapshot_states_check[(FUSION_SNAPSHOT_STATES == KF_STATES) ? 1 : -1];
+typedef char fusion_snapshot_covariance_check[(FUSION_SNAPSHOT_COVARIANCE == KF_COVARIANCE_SIZE) ? 1 : -1];
+
+/*!
+* \brief The Kalman filters in the order of {\ref fusion_snapshot_t}
+*/
+static fusion_filter_t *const snapshot_filters[FUSION_SNAPSHOT_FILTERS] = {
+#if FUSION_ENGINE == FUSION_ENGINE_JOINT
+    &kf_joint
+#else
+    &kf_attitude, &kf_orientation
+#endif
+};
+
+/*!
+* \brief Fetches the converged state, e.g. to keep it across a warm reset.
+* \param[out] snapshot The state
+* \return Zero on success, nonzero if the filters are not bootstrapped yet.
+*/
+COLD NONNULL
+uint8_t fusion_checkpoint(register fusion_snapshot_t *const snapshot)
+{
+    if (!m_attitude_bootstrapped || !m_orientation_bootstrapped) return 1;
+
+    for (uint_fast8_t filter = 0; filter < FUSION_SNAPSHOT_FILTERS; ++filter)
+    {
+        memcpy(snapshot->x[filter], snapshot_filters[filter]->x, sizeof(snapshot->x[filter]));
+        memcpy(snapshot->P[filter], snapshot_filters[filter]->P, sizeof(snapshot->P[filter]));
+    }
+
+    memcpy(snapshot->complementary_integral, m_complementary.integral, sizeof(snapshot->complementary_integral));
+    snapshot->complementary_c3 = m_complementary.c3;
+    snapshot->complementary_c2 = m_complementary.c2;
+    snapshot->mode = (uint32_t)m_mode;
+    return 0;
+}
+
+/*!
+* \brief Continues from a state fetched by {\ref fusion_checkpoint()} instead of bootstrapping.
+* \param[in] snapshot The state
+* \return Zero on success, nonzero if the snapshot is implausible; The fusion is then left as initialized.
+*/
+COLD NONNULL
+uint8_t fusion_resume(register const fusion_snapshot_t *const snapshot)
+{
+    if (FUSION_MODE_KALMAN != snapshot->mode && FUSION_MODE_COMPLEMENTARY != snapshot->mode && FUSION_MODE_HYBRID != snapshot->mode) return 1;
+
+    // validate everything before applying anything; A negative variance would never recover.
+    for (uint_fast8_t filter = 0; filter < FUSION_SNAPSHOT_FILTERS; ++filter)
+    {
+        for (uint_fast8_t i = 0; i < KF_STATES; ++i)
+        {
+            if (snapshot->P[filter][packed_index[i][i]] < 0) return 1;
+        }
+    }
+
+    for (uint_fast8_t filter = 0; filter < FUSION_SNAPSHOT_FILTERS; ++filter)
+    {
+        memcpy(snapshot_filters[filter]->x, snapshot->x[filter], sizeof(snapshot->x[filter]));
+        memcpy(snapshot_filters[filter]->P, snapshot->P[filter], sizeof(snapshot->P[filter]));
+        fusion_sanitize_state(snapshot_filters[filter]);
+    }
+
+    memcpy(m_complementary.integral, snapshot->complementary_integral, sizeof(m_complementary.integral));
+    complementary_filter_set_rows(&m_complementary, &snapshot->complementary_c3.x, &snapshot->complementary_c2.x);
+
+    m_mode = (fusion_mode_t)snapshot->mode;
+    m_attitude_bootstrapped = true;
+    m_orientation_bootstrapped = true;
+
+    invalidate_output();
+    return 0;
+}
+
+/*!
+* \brief Sets the number of samples per Kalman step in {\ref FUSION_MODE_HYBRID}.
+* \param[in] samples The number of samples; Zero is treated as one.
+*/
+COLD LEAF
+void fusion_set_hybrid_decimation(register const uint8_t samples)
+{
+    m_hybrid_decimation = (samples > 0) ? samples : 1;
+}
@@ -1,93 +1,365 @@
+#include <assert.h>
+
 #include "fixmath.h"
 #include "fusion/sensor_calibration.h"
 #include "fusion/sensor_prepare.h"
 
+/*!
+* \brief A combined axis permutation, scaling, calibration and unit conversion
+*
+* Maps raw int16 sensor values to calibrated fix16 values with a single
+* matrix-vector product. The coefficients carry {\ref sensor_transform_t::shift}
+* additional fraction bits, since scaled per-LSB coefficients would otherwise
+* have only a few significant bits in fix16.
+*/
+typedef struct {
+    int32_t m[3][3];        //!< The coefficients in Q(16+shift)
+    int32_t offset[3];      //!< The offsets in Q(16+shift)
+    uint_fast8_t shift;     //!< The number of additional fraction bits
+} sensor_transform_t;
+
+/*!
+* \brief The MPU6050 accelerometer transform
+*/
+static sensor_transform_t mpu6050_accelerometer_transform;
+
+/*!
+* \brief The MPU6050 gyroscope transform
+*/
+static sensor_transform_t mpu6050_gyroscope_transform;
+
+/*!
+* \brief The HMC5883L magnetometer transform
+*/
+static sensor_transform_t hmc5883l_transform;
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief The accelerometer transforms of the redundant MPU6050
+*/
+static sensor_transform_t mpu6050_redundant_accelerometer_transforms[MPU6050_COUNT - 1];
+
+/*!
+* \brief The gyroscope transforms of the redundant MPU6050
+*/
+static sensor_transform_t mpu6050_redundant_gyroscope_transforms[MPU6050_COUNT - 1];
+
+#endif
+
+/*!
+* \brief Axis permutation of the MPU6050 accelerometer
+*
+* Swaps X and Y axis and flips X and Z signs in order to convert from AHRS to regular coordinate system
+*/
+static const int8_t mpu6050_accelerometer_axes[3][3] = {
+    {  0, -1,  0 },
+    {  1,  0,  0 },
+    {  0,  0, -1 }
+};
+
+/*!
+* \brief The MMA8451Q accelerometer transform
+*/
+static sensor_transform_t mma8451q_accelerometer_transform;
+
+/*!
+* \brief Axis permutation of the MMA8451Q accelerometer
+*
+* Equal to the MPU6050 accelerometer permutation, assuming the MPU6050 board is mounted
+* with its axes parallel to those of the FRDM-KL25Z.
+*/
+static const int8_t mma8451q_accelerometer_axes[3][3] = {
+    {  0, -1,  0 },
+    {  1,  0,  0 },
+    {  0,  0, -1 }
+};
+
+/*!
+* \brief Axis permutation of the MPU6050 gyroscope
+*
+* Swaps X and Y axis and flips X sign in order to convert from AHRS to regular coordinate system
+*/
+static const int8_t mpu6050_gyroscope_axes[3][3] = {
+    {  0, -1,  0 },
+    {  1,  0,  0 },
+    {  0,  0,  1 }
+};
+
+/*!
+* \brief Axis permutation of the HMC5883L magnetometer
+*/
+static const int8_t hmc5883l_axes[3][3] = {
+    {  1,  0,  0 },
+    {  0,  1,  0 },
+    {  0,  0,  1 }
+};
+
+/*!
+* \brief Divides, rounding to nearest.
+* \param[in] numerator The numerator
+* \param[in] denominator The denominator; Must be positive.
+* \return The rounded quotient
+*/
+COLD
+static int64_t divide_rounded(const int64_t numerator, const int64_t denominator)
+{
+    const int64_t half = denominator / 2;
+    return (numerator >= 0) ? (numerator + half) / denominator : -((-numerator + half) / denominator);
+}
+
+/*!
+* \brief Folds the transformation steps into a single transform.
+* \param[out] transform The transform
+* \param[in] axes The axis permutation applied to the raw values
+* \param[in] scaling The scaling factor the permuted values are divided by
+* \param[in] calibration The 3x4 affine calibration matrix, row major
+* \param[in] gain The per-axis factors applied to the calibrated values, e.g. for unit conversion
+*
+* Implements out = diag(gain) * (C * axes * raw / scaling + c). The number of additional fraction bits
+* is chosen as large as possible without overflowing for any raw input.
+*/
+COLD
+static void fold_transform(sensor_transform_t *const transform, const int8_t axes[3][3], const fix16_t scaling, const fix16_t *const calibration, const fix16_t gain[3])
+{
+    assert(scaling > 0);
+
+    // combined calibration and permutation, in fix16
+    int64_t a[3][3];
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        for (uint_fast8_t column = 0; column < 3; ++column)
+        {
+            a[row][column] = 0;
+            for (uint_fast8_t k = 0; k < 3; ++k)
+            {
+                a[row][column] += (int64_t)calibration[row * 4 + k] * axes[k][column];
+            }
+
+            // apply the gain, Q32
+            a[row][column] *= gain[row];
+        }
+    }
+
+    for (int_fast8_t shift = 15; shift >= 0; --shift)
+    {
+        uint_fast8_t fits = 1;
+        for (uint_fast8_t row = 0; row < 3; ++row)
+        {
+            // Q32 / Q16 << shift = Q(16+shift), rounded
+            int64_t bound = 0;
+            for (uint_fast8_t column = 0; column < 3; ++column)
+            {
+                const int64_t coefficient = divide_rounded(a[row][column] * ((int64_t)1 << shift), scaling);
+                transform->m[row][column] = (int32_t)coefficient;
+
+                bound += ((coefficient < 0) ? -coefficient : coefficient) * 32768;
+            }
+
+            // Q32 >> 16 << shift = Q(16+shift), rounded
+            const int64_t offset = divide_rounded((int64_t)calibration[row * 4 + 3] * gain[row] * ((int64_t)1 << shift), F16(1));
+            transform->offset[row] = (int32_t)offset;
+
+            // one extra bit of headroom for the rounding
+            bound += (offset < 0) ? -offset : offset;
+            if (bound >= ((int64_t)1 << 30)) fits = 0;
+        }
+
+        transform->shift = shift;
+        if (fits) return;
+    }
+
+    // even without additional fraction bits, the transform overflows
+    assert(0);
+}
+
+/*!
+* \brief Applies a transform to raw sensor values.
+* \param[out] out The transformed values
+* \param[in] transform The transform
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+HOT NONNULL
+STATIC_INLINE void apply_transform(v3d *const out, const sensor_transform_t *const transform, register const int32_t rawx, register const int32_t rawy, register const int32_t rawz)
+{
+    const uint_fast8_t shift = transform->shift;
+    const int32_t rounding = (1 << shift) >> 1;
+
+    out->x = (transform->m[0][0] * rawx + transform->m[0][1] * rawy + transform->m[0][2] * rawz + transform->offset[0] + rounding) >> shift;
+    out->y = (transform->m[1][0] * rawx + transform->m[1][1] * rawy + transform->m[1][2] * rawz + transform->offset[1] + rounding) >> shift;
+    out->z = (transform->m[2][0] * rawx + transform->m[2][1] * rawy + transform->m[2][2] * rawz + transform->offset[2] + rounding) >> shift;
+}
+
+/*!
+* \brief Initializes the sensor data preparation by folding axis permutation, scaling, calibration and unit conversion.
+* \param[in] accelerometer_scaling The MPU6050 accelerometer scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 2g mode, ...
+* \param[in] gyroscope_scaling The MPU6050 gyroscope scaling factor, e.g. F16(131) for 250/s mode ...
+* \param[in] magnetometer_scaling The HMC5883L scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
+*/
+void sensor_prepare_initialize(const fix16_t accelerometer_scaling, const fix16_t gyroscope_scaling, const fix16_t magnetometer_scaling)
+{
+    static const fix16_t unit_gain[3] = { F16(1), F16(1), F16(1) };
+
+    // gyroscope data in degree, so convert to radians; Z is flipped in the process.
+    static const fix16_t gyroscope_gain[3] = { F16(3.14159265358979 / 180), F16(3.14159265358979 / 180), -F16(3.14159265358979 / 180) };
+
+    fold_transform(&mpu6050_accelerometer_transform, mpu6050_accelerometer_axes, accelerometer_scaling, mpu6050_accelerometer_calibration_matrix(), unit_gain);
+    fold_transform(&mpu6050_gyroscope_transform, mpu6050_gyroscope_axes, gyroscope_scaling, mpu6050_gyroscope_calibration_matrix(), gyroscope_gain);
+    fold_transform(&hmc5883l_transform, hmc5883l_axes, magnetometer_scaling, hmc5883l_calibration_matrix(), unit_gain);
+
+#if MPU6050_COUNT > 1
+    // the redundant devices are mounted with the same axes
+    for (uint_fast8_t device = 1; device < MPU6050_COUNT; ++device)
+    {
+        fold_transform(&mpu6050_redundant_accelerometer_transforms[device - 1], mpu6050_accelerometer_axes, accelerometer_scaling, mpu6050_redundant_accelerometer_calibration_matrix(device), unit_gain);
+        fold_transform(&mpu6050_redundant_gyroscope_transforms[device - 1], mpu6050_gyroscope_axes, gyroscope_scaling, mpu6050_redundant_gyroscope_calibration_matrix(device), gyroscope_gain);
+    }
+#endif
+}
+
+/*!
+* \brief Initializes the MMA8451Q accelerometer data preparation by folding axis permutation, scaling and calibration.
+* \param[in] accelerometer_scaling The MMA8451Q scaling factor, e.g. F16(4096) for 2g mode in 14bit ...
+*/
+void sensor_prepare_initialize_mma8451q(const fix16_t accelerometer_scaling)
+{
+    static const fix16_t unit_gain[3] = { F16(1), F16(1), F16(1) };
+    fold_transform(&mma8451q_accelerometer_transform, mma8451q_accelerometer_axes, accelerometer_scaling, mma8451q_accelerometer_calibration_matrix(), unit_gain);
+}
+
 /*!
 * \brief Prepares MPU6050 accelerometer sensor data for fusion by converting and calibrating them.
 * \param[out] out The prepared sensor data
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 4g mode, ...
 */
-void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
+void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
 {
-    // fetch value
-    v3d value = {
-        // note that we are swapping X and Y axis here and flipping X and Z signs
-        // in order to convert from AHRS to regular coordinate system
-        -fix16_from_int(rawy),
-         fix16_from_int(rawx),
-        -fix16_from_int(rawz)
-    };
+    apply_transform(out, &mpu6050_accelerometer_transform, rawx, rawy, rawz);
+}
 
-    // scale
-    v3d_div_s(out, &value, scaling);
+/*!
+* \brief Prepares MMA8451Q accelerometer sensor data for fusion by converting and calibrating them.
+* \param[out] out The prepared sensor data
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mma8451q_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
+{
+    apply_transform(out, &mma8451q_accelerometer_transform, rawx, rawy, rawz);
+}
+
+/*!
+* \brief Combines two variances to the weight of the second measurement
+* \param[in] primary The variance of the primary measurement
+* \param[in] secondary The variance of a single secondary measurement
+* \param[in] count The number of averaged secondary measurements
+* \return The weight in [0, 1]
+*/
+HOT CONST
+STATIC_INLINE fix16_t inverse_variance_weight(register const fix16_t primary, register const fix16_t secondary, register const uint_fast8_t count)
+{
+    // averaging divides the secondary variance by the count, so scale the primary instead
+    // of losing the small variances to the fix16 resolution
+    const int64_t scaled = (int64_t)primary * count;
+    return (fix16_t)((scaled << 16) / (scaled + secondary));
+}
+
+/*!
+* \brief Fuses the prepared MMA8451Q and MPU6050 accelerometer data, weighted by the inverse of their variances
+* \param[inout] acc The prepared MPU6050 data; Overwritten with the combined data.
+* \param[in] secondary The prepared MMA8451Q data, averaged over the batch
+* \param[in] count The number of MMA8451Q samples averaged; Must be positive.
+*/
+void sensor_prepare_combine_accelerometers(v3d *const acc, const v3d *const secondary, uint_fast8_t count)
+{
+    assert(count > 0);
 
-    // calibrate!
-    mpu6050_calibrate_accelerometer_v3d(out);
+    fix16_t primary_x, primary_y, primary_z;
+    fix16_t secondary_x, secondary_y, secondary_z;
+    mpu6050_var_accelerometer(&primary_x, &primary_y, &primary_z);
+    mma8451q_var_accelerometer(&secondary_x, &secondary_y, &secondary_z);
 
-    value = *out;
-    out->x =  value.x;
-    out->y =  value.y;
-    out->z =  value.z;
+    // a + w * (b - a) == (a/va + b/vb) / (1/va + 1/vb) with w = va / (va + vb)
+    acc->x += fix16_mul(inverse_variance_weight(primary_x, secondary_x, count), secondary->x - acc->x);
+    acc->y += fix16_mul(inverse_variance_weight(primary_y, secondary_y, count), secondary->y - acc->y);
+    acc->z += fix16_mul(inverse_variance_weight(primary_z, secondary_z, count), secondary->z - acc->z);
 }
 
 /*!
 * \brief Prepares MPU6050 gyroscope sensor data for fusion by converting and calibrating them.
+* \param[out] out The prepared sensor data in rad/s
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
+{
+    apply_transform(out, &mpu6050_gyroscope_transform, rawx, rawy, rawz);
+}
+
+#if MPU6050_COUNT > 1
+
+/*!
+* \brief Prepares the accelerometer sensor data of a redundant MPU6050 for fusion by converting and calibrating them.
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
 * \param[out] out The prepared sensor data
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(131) for 250/s mode ...
-*/
-void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
-{
-#if 1
-    // fetch value
-    v3d value = {
-        // note that we are swapping X and Y axis here and flipping X sign
-        // in order to convert from AHRS to regular coordinate system
-        -fix16_from_int(rawy),
-         fix16_from_int(rawx),
-         fix16_from_int(rawz)
-    };
-#else
-    // fetch value
-    v3d value = {
-        fix16_from_int(rawx),
-        fix16_from_int(rawy),
-        fix16_from_int(rawz)
-    };
-#endif
+*/
+void sensor_prepare_redundant_mpu6050_accelerometer_data(uint_fast8_t device, v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
+{
+    assert(device > 0 && device < MPU6050_COUNT);
+    apply_transform(out, &mpu6050_redundant_accelerometer_transforms[device - 1], rawx, rawy, rawz);
+}
 
-#if 0
-    float tx = fix16_to_float(value.x);
-    float ty = fix16_to_float(value.y);
-    float tz = fix16_to_float(value.z);
-#endif
+/*!
+* \brief Prepares the gyroscope sensor data of a redundant MPU6050 for fusion by converting and calibrating them.
+* \param[in] device The device in 1 .. MPU6050_COUNT-1
+* \param[out] out The prepared sensor data in rad/s
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_redundant_mpu6050_gyroscope_data(uint_fast8_t device, v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
+{
+    assert(device > 0 && device < MPU6050_COUNT);
+    apply_transform(out, &mpu6050_redundant_gyroscope_transforms[device - 1], rawx, rawy, rawz);
+}
 
-    // scale
-    v3d_div_s(out, &value, scaling);
-
-    // calibrate!
-    mpu6050_calibrate_gyroscope_v3d(out);
-
-    // data in degree, so convert to radians
-
-#if 0
-    out->x = fix16_deg_to_rad( out->x);
-    out->y = fix16_deg_to_rad(-out->y);
-    out->z = fix16_deg_to_rad( out->z);
-#elseif 0
-    out->x = fix16_deg_to_rad(-out->x);
-    out->y = fix16_deg_to_rad( out->y);
-    out->z = fix16_deg_to_rad(-out->z);
-#else
-    out->x = fix16_deg_to_rad(out->x);
-    out->y = fix16_deg_to_rad(out->y);
-    out->z = fix16_deg_to_rad(-out->z);
 #endif
+
+/*!
+* \brief Divides a fix16 value by a small count, rounding to nearest.
+* \param[in] value The value
+* \param[in] count The count; Must be positive.
+* \return The quotient
+*/
+HOT CONST
+STATIC_INLINE fix16_t divide_count(register const fix16_t value, register const uint_fast8_t count)
+{
+    const int32_t half = (int32_t)(count / 2);
+    return (value + (value >= 0 ? half : -half)) / (int32_t)count;
+}
+
+/*!
+* \brief Averages summed prepared sensor data
+* \param[inout] sum The sum of the prepared data; Overwritten with the average.
+* \param[in] count The number of summed vectors; Must be positive.
+*/
+void sensor_prepare_average(v3d *const sum, uint_fast8_t count)
+{
+    assert(count > 0);
+    if (count == 1) return;
+
+    sum->x = divide_count(sum->x, count);
+    sum->y = divide_count(sum->y, count);
+    sum->z = divide_count(sum->z, count);
 }
 
 /*!
@@ -96,21 +368,19 @@ void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
 */
-void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
+void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
 {
-    // fetch value
-    const register fix16_t invScaling = fix16_div(F16(1), scaling);
-    out->x = fix16_mul(fix16_from_int(rawx), invScaling);
-    out->y = fix16_mul(fix16_from_int(rawy), invScaling);
-    out->z = fix16_mul(fix16_from_int(rawz), invScaling);
-
-    // calibrate!
-    hmc5883l_calibrate_v3d(out);
+    apply_transform(out, &hmc5883l_transform, rawx, rawy, rawz);
+}
 
-    v3d value = *out;
-    out->x =  value.x;
-    out->y =  value.y;
-    out->z =  value.z;
+/*!
+* \brief Converts the MPU6050 temperature sensor output to degree Celsius.
+* \param[in] raw The sensor value
+* \return The temperature in degree Celsius
+*/
+fix16_t sensor_prepare_mpu6050_temperature(int16_t raw)
+{
+    // see MPU-6000/MPU-6050 register map, TEMP_OUT
+    return fix16_add(fix16_div(fix16_from_int(raw), F16(340)), F16(36.53));
 }
\ No newline at end of file
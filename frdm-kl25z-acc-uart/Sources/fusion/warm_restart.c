@@ -0,0 +1,117 @@
+#include <stddef.h>
+
+#include "derivative.h"
+#include "comm/crc16.h"
+#include "fusion/gyro_bias.h"
+#include "fusion/sensor_fusion.h"
+#include "fusion/warm_restart.h"
+
+/*!
+* \def WARM_RESTART_MAGIC Identifies a written snapshot block ("WARM")
+*/
+#define WARM_RESTART_MAGIC              (0x4D524157u)
+
+/*!
+* \brief The snapshot block
+*
+* The CRC covers all preceding bytes; A reset in the middle of a checkpoint leaves a CRC mismatch.
+*/
+typedef struct {
+    uint32_t magic;                                 //!< {\ref WARM_RESTART_MAGIC}
+    uint16_t version;                               //!< {\ref WARM_RESTART_VERSION}
+    uint16_t length;                                //!< The size of the block in byte
+    fusion_snapshot_t fusion;                       //!< The fusion state
+    gyro_bias_snapshot_t gyro_bias;                 //!< The learned gyroscope bias
+    uint16_t reserved;                              //!< Zero
+    uint16_t crc;                                   //!< CRC-16/CCITT of the preceding fields
+} warm_restart_block_t;
+
+/*!
+* \brief The snapshot; Placed in the .noinit section of the linker script, so that it survives warm resets.
+*/
+static warm_restart_block_t m_block __attribute__((section(".noinit")));
+
+/*!
+* \brief Calculates the CRC of the snapshot block
+* \return The CRC
+*/
+STATIC_INLINE
+uint16_t warm_restart_crc()
+{
+    return CRC16_Calculate((const uint8_t*)&m_block, offsetof(warm_restart_block_t, crc));
+}
+
+/*!
+* \brief Determines if the last reset was a warm reset with a valid snapshot.
+* \return {\ref WARM_RESTART_OK} if {\ref warm_restart_resume()} will resume
+*/
+COLD
+warm_restart_result_t warm_restart_check()
+{
+#if WARM_RESTART_ENABLED
+    // the power-on detection also flags the LVD bit; A brown-out alone keeps the SRAM content.
+    if (RCM_SRS0 & RCM_SRS0_POR_MASK) return WARM_RESTART_COLD;
+
+    if (m_block.magic != WARM_RESTART_MAGIC) return WARM_RESTART_COLD;
+    if (m_block.version != WARM_RESTART_VERSION) return WARM_RESTART_INVALID;
+    if (m_block.length != sizeof(warm_restart_block_t)) return WARM_RESTART_INVALID;
+    if (m_block.crc != warm_restart_crc()) return WARM_RESTART_INVALID;
+    return WARM_RESTART_OK;
+#else
+    return WARM_RESTART_COLD;
+#endif
+}
+
+/*!
+* \brief Resumes the fusion and the gyroscope bias estimation from the snapshot after a warm reset.
+* \return {\ref WARM_RESTART_OK} if the snapshot was applied; The fusion bootstraps as usual otherwise.
+*/
+COLD
+warm_restart_result_t warm_restart_resume()
+{
+    const warm_restart_result_t result = warm_restart_check();
+    if (WARM_RESTART_OK != result)
+    {
+        warm_restart_invalidate();
+        return result;
+    }
+
+    if (0 != fusion_resume(&m_block.fusion))
+    {
+        warm_restart_invalidate();
+        return WARM_RESTART_INVALID;
+    }
+
+    gyro_bias_resume(&m_block.gyro_bias);
+    return WARM_RESTART_OK;
+}
+
+/*!
+* \brief Takes a snapshot of the fusion and the gyroscope bias estimation.
+*/
+COLD
+void warm_restart_checkpoint()
+{
+#if WARM_RESTART_ENABLED
+    // invalidate first, so that a reset in between never resumes from a partial block
+    m_block.magic = 0;
+
+    if (0 != fusion_checkpoint(&m_block.fusion)) return;
+    gyro_bias_checkpoint(&m_block.gyro_bias);
+
+    m_block.version = WARM_RESTART_VERSION;
+    m_block.length = sizeof(warm_restart_block_t);
+    m_block.reserved = 0;
+    m_block.magic = WARM_RESTART_MAGIC;
+    m_block.crc = warm_restart_crc();
+#endif
+}
+
+/*!
+* \brief Invalidates the snapshot, e.g. when the fusion is restarted on purpose.
+*/
+COLD
+void warm_restart_invalidate()
+{
+    m_block.magic = 0;
+}
@@ -6,8 +6,53 @@
  */
 
 #include "i2c/i2c.h"
+#include "cpu/clock.h"
 #include "cpu/delay.h"
 
+/**
+ * @brief The sticky I2C_ERROR_* flags of the blocking operations
+ */
+uint8_t I2C_Error = 0;
+
+/**
+ * @brief The SCL dividers by ICR value, see table 38-41, I2C divider and hold values
+ */
+static const uint16_t I2C_SclDividers[64] = {
+	  20,   22,   24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+	  48,   56,   64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+	 160,  192,  224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+	 640,  768,  896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+
+/**
+ * @brief Finds the fastest frequency divider within {@see I2C_MAX_SCL_FREQUENCY} without multiplier
+ * @return The F register value
+ *
+ * The multiplier is not used, since repeated start conditions can not be sent with it (erratum e6070).
+ * The divider of ICR values below 0x10 might vary by +/- 4 according to a note in the reference manual;
+ * The limit is checked against the variation.
+ */
+static uint8_t I2C_SelectDivider()
+{
+	/* the smallest divider that does not exceed the maximum SCL frequency */
+	const uint32_t minimumDivider = (ClockBusFrequency + I2C_MAX_SCL_FREQUENCY - 1) / I2C_MAX_SCL_FREQUENCY;
+	
+	uint32_t bestDivider = 0xFFFFFFFFu;
+	uint8_t best = I2C_F_MULT(0x00) | I2C_F_ICR(0x3F);
+	for (uint8_t icr = 0; icr < 64; ++icr)
+	{
+		const uint32_t divider = I2C_SclDividers[icr];
+		const uint32_t variation = (icr < 0x10) ? 4u : 0;
+		
+		if (divider >= minimumDivider + variation && divider < bestDivider)
+		{
+			bestDivider = divider;
+			best = I2C_F_MULT(0x00) | I2C_F_ICR(icr);
+		}
+	}
+	return best;
+}
+
 /**
  * @brief Initialises the I2C interface
  */
@@ -42,24 +87,26 @@ void I2C_Init()
 	 * maximum SCL frequency is 400 kHz.
 	 * Assuming PEE mode with core=48MHz, 400 kHz = 48MHz/2 / 60,
 	 * which means a prescaler (SCL divider) of 60.
-	 * According to table 38-41, I2C divider and hold values,
-	 * the closest SCL diver is 64 (375 kHz SCL), which is ICR value 0x12.
-	 * Alternatively, the SCL divider of 30 can be used (ICR=0x05) in combination
-	 * with a multiplicator of 2 (MULT=0x01).
-	 * A note states that ICR values lower than 0x10 might result in a varying
-	 * SCL divider (+/- 4). However the data sheet does not state anything
-	 * useful about that.
+	 * Without multiplier, the closest SCL divider is 64 (375 kHz SCL), which is ICR value 0x12.
+	 * With a multiplier of 2 (MULT=0x01), the SCL divider of 30 (ICR=0x05) would yield exactly 400 kHz,
+	 * but according to KINETIS_L_2N97F errata (e6070), repeated start conditions can not be sent then,
+	 * and the divider of ICR values below 0x10 is not exact. The divider is thus selected without
+	 * multiplier for the current bus clock, see I2C_ApplyClock().
 	 */
-#if ENABLE_SPEEDHACK
-	I2C0->F = I2C_F_MULT(0x01) | I2C_F_ICR(0x05); /* NOTE: According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). */
-#else
-	I2C0->F = I2C_F_MULT(0x00) | I2C_F_ICR(0x12); /* divide by 64 instead, so 375 kHz */
-#endif
+	I2C_ApplyClock();
 	
 	/* enable the I2C module */
 	I2C0->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
 }
 
+/**
+ * @brief Selects the frequency divider for the current bus clock
+ */
+void I2C_ApplyClock()
+{
+	I2C0->F = I2C_SelectDivider();
+}
+
 /**
  * @brief Reads an 8-bit register from an I2C slave 
  */
@@ -192,7 +239,7 @@ void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddres
 	/* loop while the bus is still busy */
 	I2C_WaitWhileBusy();	
 	
-	/* send I2C start signal and set write direction*/
+	/* send I2C start signal and set write direction, also enables ACK */
 	I2C_SendStart();
 		
 	/* send the slave address and wait for the I2C bus operation to complete */
@@ -259,44 +306,128 @@ uint8_t I2C_ModifyRegister(register uint8_t slaveId, register uint8_t registerAd
 }
 
 /**
- * @brief Resets the bus by toggling master mode if the bus is busy. This will interrupt ongoing traffic, so use with caution.
+ * @brief Reads a status register and, if it matches, a block of data registers in the same bus session.
+ * @param[in] slaveId The slave device ID
+ * @param[in] statusRegisterAddress The status register address
+ * @param[in] statusMask The status bits to check
+ * @param[in] statusExpected The expected value of the masked status bits
+ * @param[in] startRegisterAddress The first data register address
+ * @param[in] registerCount The number of data registers to read; Must be greater than or equal to two.
+ * @param[out] buffer The buffer to write into; Unchanged if the status does not match.
+ * @return The status register value
  */
-void I2C_ResetBus()
+uint8_t I2C_ReadStatusAndRegisters(register uint8_t slaveId, register uint8_t statusRegisterAddress, register uint8_t statusMask, register uint8_t statusExpected, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer)
 {
-#if !I2C_USE_BME
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
-#else
-	BME_OR_B(&I2C0->S, ((1 << I2C_S_IICIF_SHIFT) << I2C_S_IICIF_MASK));
-#endif	
+	assert(registerCount >= 2);
+	
+	/* loop while the bus is still busy */
+	I2C_WaitWhileBusy();
+
+	/* address the status register and read it without ACK */
+	I2C_SendStart();
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(statusRegisterAddress);
+	I2C_SendRepeatedStart();
+	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
+	I2C_EnterReceiveModeWithoutAck();
+	I2C_ReceiverModeDriveClock();
 	
-#if 0
-	while (I2C0->S & I2C_S_BUSY_MASK)
+	/* in transmit mode, reading the status byte does not clock in another one */
+	I2C_EnterTransmitMode();
+	register const uint8_t status = I2C0->D;
+	
+	/* data not ready (or locked): release the bus */
+	if ((status & statusMask) != statusExpected)
 	{
-		/**
-		 * TODO: This is obviously not working. 
-		 * The proposed solution is to switch the SCL pin to GPIO mode
-		 * and toggle it a few times.
-		 */
-		
-		I2C_SendStart();
-		delay_ms(2);
-		I2C0->D = 0xAA;
-		delay_ms(2);
-		I2C0->D = 0x05;
-		delay_ms(2);
-		I2C0->D = 0x50;
-		delay_ms(2);
-		I2C0->D = 0xAA;
-		delay_ms(2);
 		I2C_SendStop();
+		return status;
 	}
-#endif
 	
-#if !I2C_USE_BME
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
-#else
-	BME_OR_B(&I2C0->S, ((1 << I2C_S_IICIF_SHIFT) << I2C_S_IICIF_MASK));
-#endif	
+	/* keep the bus and address the data registers using a repeated start */
+	I2C_SendRepeatedStart();
+	I2C_InitiateRegisterReadAt(slaveId, startRegisterAddress);
+	
+	/* drive the clock for all but the last two bytes with ACK */
+	uint8_t index = 0;
+	while (index < registerCount - 2)
+	{
+		buffer[index++] = I2C_ReceiveDriving();
+	}
+	
+	/* NACK the last byte and stop */
+	buffer[index++] = I2C_ReceiveDrivingWithNack();
+	buffer[index++] = I2C_ReceiveAndStop();
+	return status;
+}
+
+/**
+ * @brief Busy-waits for a quarter of a 100 kHz SCL period
+ */
+static void I2C_RecoveryDelay()
+{
+	register const uint32_t start = Timebase_Microseconds();
+	while ((Timebase_Microseconds() - start) < 3) {}
+}
+
+/**
+ * @brief Recovers a stuck bus. This will interrupt ongoing traffic, so use with caution.
+ * @param[in] port The port of the I2C pins
+ * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] sclMux The I2C mux value for the SCL pin
+ * @param[in] sdaPin The number of the pin used for SDA
+ * @param[in] sdaMux The I2C mux value for the SDA pin
+ * @return Zero if SDA was released, nonzero if the bus is still stuck
+ */
+uint8_t I2C_ResetBus(PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux)
+{
+	/* the GPIO registers of the port; ports are 4 KiB apart, GPIOs 64 byte */
+	register const uint32_t portIndex = ((uint32_t)port - (uint32_t)PORTA_BASE_PTR) >> 12;
+	register const GPIO_MemMapPtr gpio = (GPIO_MemMapPtr)((uint32_t)PTA_BASE_PTR + (portIndex << 6));
+	register const uint32_t scl = 1 << sclPin;
+	register const uint32_t sda = 1 << sdaPin;
+	
+	/* release the pins from the module */
+	I2C0->C1 = 0;
+	
+	/* emulate open drain: the output latch stays low, the direction selects between
+	 * driving low and releasing the line to the pull-up */
+	gpio->PCOR = scl | sda;
+	gpio->PDDR &= ~(scl | sda);
+	port->PCR[sclPin] = (port->PCR[sclPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(1);
+	port->PCR[sdaPin] = (port->PCR[sdaPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(1);
+	I2C_RecoveryDelay();
+	
+	/* clock out whatever the slave is still sending, up to a full byte plus ACK */
+	for (uint8_t clock = 0; clock < 9 && 0 == (gpio->PDIR & sda); ++clock)
+	{
+		gpio->PDDR |= scl;
+		I2C_RecoveryDelay();
+		I2C_RecoveryDelay();
+		gpio->PDDR &= ~scl;
+		I2C_RecoveryDelay();
+		I2C_RecoveryDelay();
+	}
+	
+	/* stop condition: SDA rises while SCL is high */
+	gpio->PDDR |= scl;
+	I2C_RecoveryDelay();
+	gpio->PDDR |= sda;
+	I2C_RecoveryDelay();
+	gpio->PDDR &= ~scl;
+	I2C_RecoveryDelay();
+	gpio->PDDR &= ~sda;
+	I2C_RecoveryDelay();
+	
+	register const uint8_t stuck = (0 == (gpio->PDIR & sda));
+	
+	/* hand the pins back and restart the module */
+	port->PCR[sclPin] = (port->PCR[sclPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(sclMux);
+	port->PCR[sdaPin] = (port->PCR[sdaPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(sdaMux);
+	I2C0->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+	I2C0->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
+	
+	I2C_Error = 0;
+	return stuck;
 }
 
 /**
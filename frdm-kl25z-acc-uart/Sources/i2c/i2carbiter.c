@@ -5,17 +5,19 @@
  *      Author: Markus
  */
 
+#include <assert.h>
+
 #include "derivative.h"
 #include "bme.h"
+#include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
 
 /**
  * @brief Control structure for the I2C arbiter
  */
 typedef struct {
-	uint32_t lastSelectedHash;		/*< The last selected hash */
-	uint8_t lastSelectedSlave;		/*< The last selected slave address */
-	uint8_t lastSelectedSlaveIndex;	/*< The list index of the last selected slave */
+	i2carbiter_handle_t selectedHandle;	/*< The handle of the selected slave */
+	uint8_t selectedGroup;			/*< The pin group of the selected slave */
 	i2carbiter_entry_t* entries;	/*< The arbiter entries */
 	const uint8_t entryCount;		/*< The number of arbiter entries */
 } i2carbiter_t;
@@ -25,6 +27,11 @@ typedef struct {
  */
 static i2carbiter_t configuration;
 
+/**
+ * @brief Width of the {@see PORT_PCR_MUX_MASK} field
+ */
+#define PORT_PCR_MUX_WIDTH		(3)
+
 /**
  * @brief Configures n I2C arbiter entry
  * @param[inout] entry The entry
@@ -48,6 +55,8 @@ void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, PO
 	hash = hash * 23 + (uint32_t)entry->port;
 	hash = hash * 23 + sclPin;
 	hash = hash * 23 + sdaPin;
+	hash = hash * 23 + sclMux;
+	hash = hash * 23 + sdaMux;
 	
 	*(uint32_t*)&entry->hash = hash;
 }
@@ -60,13 +69,84 @@ void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, PO
  */
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount)
 {
-	configuration.lastSelectedSlave = 0;
-	configuration.lastSelectedHash = 0;
+	assert(entryCount > 0 && entryCount < I2CARBITER_INVALID_HANDLE);
+
+	configuration.selectedHandle = I2CARBITER_INVALID_HANDLE;
+	configuration.selectedGroup = I2CARBITER_INVALID_HANDLE;
 	configuration.entries = entries;
 	*(uint32_t*)&configuration.entryCount = entryCount;
 	
+	/* entries with the same port, pins and muxes form a group, named after its first entry; switching within a group is free */
+	for (uint8_t i=0; i<entryCount; ++i)
+	{
+		uint8_t group = 0;
+		while (entries[group].hash != entries[i].hash) ++group;
+		entries[i].group = group;
+	}
+	
 	/* assume the first slave will be used first */ 
-	I2CArbiter_Select(entries[0].slaveAddress);
+	I2CArbiter_SelectHandle(0);
+}
+
+/**
+ * @brief Looks up the handle of an I2C slave.
+ * @param[in] slaveAddress The slave address
+ * @return The handle or {@see I2CARBITER_INVALID_HANDLE} if the slave is unknown
+ *
+ * Scans the entries; Intended to be called once, with the handle kept for {@see I2CArbiter_SelectHandle()}.
+ */
+i2carbiter_handle_t I2CArbiter_Lookup(uint8_t slaveAddress)
+{
+	register int count = configuration.entryCount;
+	for (int i=0; i<count; ++i)
+	{
+		if (configuration.entries[i].slaveAddress == slaveAddress)
+		{
+			return (i2carbiter_handle_t)i;
+		}
+	}
+	return I2CARBITER_INVALID_HANDLE;
+}
+
+/**
+ * @brief Selects an I2C slave by handle and prepares the ports.
+ * @param[in] handle The handle
+ * @return Zero if successful, nonzero otherwise
+ *
+ * Does not access the ports if the slave shares its pins with the current one,
+ * and uses bit field insertion through the BME otherwise.
+ */
+uint8_t I2CArbiter_SelectHandle(i2carbiter_handle_t handle)
+{
+	if (handle >= configuration.entryCount)
+	{
+		return 1;
+	}
+	
+	register const i2carbiter_entry_t *const token = &configuration.entries[handle];
+	register const uint8_t lastSelectedGroup = configuration.selectedGroup;
+	configuration.selectedHandle = handle;
+	
+	/* early exit if the pins are shared */
+	if (token->group == lastSelectedGroup)
+	{
+		return 0;
+	}
+	
+	/* disable the pins of the last selected slave */
+	if (lastSelectedGroup != I2CARBITER_INVALID_HANDLE)
+	{
+		register const i2carbiter_entry_t *const entry = &configuration.entries[lastSelectedGroup];
+		BME_BFI_W(&entry->port->PCR[entry->sdaPin], 0, PORT_PCR_MUX_SHIFT, PORT_PCR_MUX_WIDTH);
+		BME_BFI_W(&entry->port->PCR[entry->sclPin], 0, PORT_PCR_MUX_SHIFT, PORT_PCR_MUX_WIDTH);
+	}
+	
+	/* enable the pins of the new slave */
+	BME_BFI_W(&token->port->PCR[token->sdaPin], PORT_PCR_MUX(token->sdaMux), PORT_PCR_MUX_SHIFT, PORT_PCR_MUX_WIDTH);
+	BME_BFI_W(&token->port->PCR[token->sclPin], PORT_PCR_MUX(token->sclMux), PORT_PCR_MUX_SHIFT, PORT_PCR_MUX_WIDTH);
+	
+	configuration.selectedGroup = token->group;
+	return 0;
 }
 
 /**
@@ -76,51 +156,31 @@ void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount)
  */
 uint8_t I2CArbiter_Select(uint8_t slaveAddress)
 {
-	register uint32_t lastSelectedSlave = configuration.lastSelectedSlave;
-	
 	/* early exit */
-	if (lastSelectedSlave == slaveAddress) 
+	register const i2carbiter_handle_t selectedHandle = configuration.selectedHandle;
+	if (selectedHandle != I2CARBITER_INVALID_HANDLE && configuration.entries[selectedHandle].slaveAddress == slaveAddress) 
 	{
 		return 0;
 	}
 	
-	/* find the current slave */
-	register uint32_t lastSelectedHash = configuration.lastSelectedHash;
-	register int count = configuration.entryCount;
-	for (int i=0; i<count; ++i)
+	return I2CArbiter_SelectHandle(I2CArbiter_Lookup(slaveAddress));
+}
+
+/**
+ * @brief Recovers the bus of the selected slave.
+ * @return Zero if the bus was released, nonzero if it is still stuck or no slave is selected
+ *
+ * Clocks the pins of the selected group through {@see I2C_ResetBus()}; The pins
+ * stay selected afterwards.
+ */
+uint8_t I2CArbiter_ResetBus()
+{
+	register const uint8_t group = configuration.selectedGroup;
+	if (group == I2CARBITER_INVALID_HANDLE)
 	{
-		i2carbiter_entry_t* token = &configuration.entries[i];
-		if (token->slaveAddress == slaveAddress)
-		{
-			/* try to avoid switching by comparing the port address / pin hashes */
-			if (token->hash != lastSelectedHash)
-			{
-				/* disable last slave */
-				if (lastSelectedSlave != 0)
-				{
-					/* disable last selected slave */
-					i2carbiter_entry_t* entry = &configuration.entries[configuration.lastSelectedSlaveIndex];
-					entry->port->PCR[entry->sdaPin] &= ~PORT_PCR_MUX_MASK;
-					entry->port->PCR[entry->sclPin] &= ~PORT_PCR_MUX_MASK;
-				}
-	
-				/* TODO: candidate for BME */
-				
-				/* enable new slave */
-				token->port->PCR[token->sdaPin] &= ~PORT_PCR_MUX_MASK;
-				token->port->PCR[token->sdaPin] |= PORT_PCR_MUX(token->sdaMux);
-				token->port->PCR[token->sclPin] &= ~PORT_PCR_MUX_MASK;
-				token->port->PCR[token->sclPin] |= PORT_PCR_MUX(token->sclMux);
-			}
-			
-			/* set up lookup */
-			configuration.lastSelectedHash = token->hash;
-			configuration.lastSelectedSlave = slaveAddress;
-			configuration.lastSelectedSlaveIndex = i;
-			
-			return 0;
-		}
+		return 1;
 	}
 	
-	return 1;
+	register const i2carbiter_entry_t *const entry = &configuration.entries[group];
+	return I2C_ResetBus(entry->port, entry->sclPin, entry->sclMux, entry->sdaPin, entry->sdaMux);
 }
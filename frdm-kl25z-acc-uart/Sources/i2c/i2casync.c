@@ -0,0 +1,580 @@
+/*
+ * i2casync.c
+ *
+ *  Created on: Mar 2, 2014
+ *      Author: Markus
+ */
+
+#include "i2c/i2c.h"
+#include "i2c/i2casync.h"
+#include "i2c/i2carbiter.h"
+#include "cpu/ramfunc.h"
+#include "cpu/events.h"
+#include "cpu/instrument.h"
+#include "cpu/irq.h"
+
+#if I2CASYNC_USE_DMA
+#include "cpu/dma.h"
+
+#if DMA_CHANNEL_I2C0 != 0
+#error DMA0_Handler expects I2C0 reception on DMA channel 0
+#endif
+#endif
+
+/**
+ * @brief States of the transaction state machine
+ */
+typedef enum {
+	I2CASYNC_STATE_IDLE = 0,			/*< No transaction in progress */
+	I2CASYNC_STATE_START,				/*< The I2C0 IRQ was pended to start the next transaction */
+	I2CASYNC_STATE_WRITE_ADDRESS,		/*< Start condition and write address were sent */
+	I2CASYNC_STATE_REGISTER_ADDRESS,	/*< The register address was sent */
+	I2CASYNC_STATE_READ_ADDRESS,		/*< Repeated start and read address were sent */
+	I2CASYNC_STATE_STATUS,				/*< The status byte is being received */
+	I2CASYNC_STATE_RECEIVE,				/*< Data bytes are being received */
+	I2CASYNC_STATE_DMA_RECEIVE			/*< Data bytes are being received by DMA */
+} i2casync_state_t;
+
+/**
+ * @brief Control structure of the engine
+ */
+typedef struct {
+	i2casync_transaction_t *queue[I2CASYNC_QUEUE_SIZE];	/*< The pending transactions */
+	volatile uint8_t writeIndex;						/*< Free running queue write index */
+	volatile uint8_t readIndex;							/*< Free running queue read index */
+	i2casync_transaction_t *volatile current;			/*< The transaction in progress */
+	volatile i2casync_state_t state;					/*< The state of the current transaction */
+	uint8_t index;										/*< Index of the next byte to store */
+	uint8_t remaining;									/*< Number of bytes still to be fetched from the data register */
+	uint8_t statusPending;								/*< Nonzero while the status register of the current transaction was not read yet */
+} i2casync_t;
+
+/**
+ * @brief The engine
+ */
+static i2casync_t engine;
+
+/**
+ * @brief Enables the I2C0 interrupt in the module
+ */
+__STATIC_INLINE void I2CAsync_EnableModuleIrq()
+{
+#if !I2C_USE_BME
+	I2C0->C1 |= I2C_C1_IICIE_MASK;
+#else
+	BME_OR_B(&I2C0->C1, (1 << I2C_C1_IICIE_SHIFT) & I2C_C1_IICIE_MASK);
+#endif
+}
+
+/**
+ * @brief Disables the I2C0 interrupt in the module
+ */
+__STATIC_INLINE void I2CAsync_DisableModuleIrq()
+{
+#if !I2C_USE_BME
+	I2C0->C1 &= ~I2C_C1_IICIE_MASK;
+#else
+	BME_AND_B(&I2C0->C1, (uint8_t)~((1 << I2C_C1_IICIE_SHIFT) & I2C_C1_IICIE_MASK));
+#endif
+}
+
+/**
+ * @brief Initializes the asynchronous I2C engine and enables the I2C0 IRQ.
+ */
+void I2CAsync_Init()
+{
+	engine.writeIndex = 0;
+	engine.readIndex = 0;
+	engine.current = NULL;
+	engine.state = I2CASYNC_STATE_IDLE;
+
+	/* the module interrupt is only enabled while a transaction is running
+	 * so that the blocking functions keep polling IICIF undisturbed */
+	I2CAsync_DisableModuleIrq();
+
+	/* prepare interrupts for I2C0 */
+	IRQ_Enable(I2C0_IRQ);
+
+#if I2CASYNC_USE_DMA
+	/* route the I2C0 requests to the DMA channel */
+	DMA_EnableClocks();
+	DMA_RouteSource(DMA_CHANNEL_I2C0, DMAMUX_SOURCE_I2C0);
+	DMA_ClearDone(DMA_CHANNEL_I2C0);
+	
+	/* prepare interrupts for the DMA channel */
+	IRQ_Enable(DMA0_IRQ);
+#endif
+}
+
+/**
+ * @brief Prepares a register burst read transaction
+ */
+void I2CAsync_PrepareRead(i2casync_transaction_t *const transaction, register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context)
+{
+	I2CAsync_PrepareReadHandle(transaction, I2CARBITER_INVALID_HANDLE, slaveId, startRegisterAddress, registerCount, buffer, callback, context);
+}
+
+/**
+ * @brief Prepares a register burst read transaction on the pins of a given I2C arbiter entry
+ */
+void I2CAsync_PrepareReadHandle(i2casync_transaction_t *const transaction, register uint8_t arbiterHandle, register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context)
+{
+	assert_not_null(transaction);
+	assert_not_null(buffer);
+	assert(registerCount > 0);
+
+	transaction->slaveId = slaveId;
+	transaction->arbiterHandle = (I2CARBITER_INVALID_HANDLE == arbiterHandle) ? I2CArbiter_Lookup(slaveId) : arbiterHandle;
+	transaction->registerAddress = startRegisterAddress;
+	transaction->registerCount = registerCount;
+	transaction->statusRegisterAddress = 0;
+	transaction->statusMask = 0;
+	transaction->statusExpected = 0;
+	transaction->statusRegister = 0;
+	transaction->buffer = buffer;
+	transaction->callback = callback;
+	transaction->context = context;
+	transaction->status = I2CASYNC_SUCCESS;
+}
+
+/**
+ * @brief Prepares a status register read that is followed by a register burst read if the status matches
+ */
+void I2CAsync_PrepareStatusReadHandle(i2casync_transaction_t *const transaction, register uint8_t arbiterHandle, register uint8_t slaveId, register uint8_t statusRegisterAddress, register uint8_t statusMask, register uint8_t statusExpected, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer, i2casync_callback_t callback, void *const context)
+{
+	assert(statusMask != 0);
+
+	I2CAsync_PrepareReadHandle(transaction, arbiterHandle, slaveId, startRegisterAddress, registerCount, buffer, callback, context);
+	transaction->statusRegisterAddress = statusRegisterAddress;
+	transaction->statusMask = statusMask;
+	transaction->statusExpected = statusExpected;
+}
+
+/**
+ * @brief Starts the next queued transaction or brings the engine to idle.
+ *
+ * Must only be called from within the I2C0 handler, so that waiting for the
+ * bus and the failure callbacks do not run in the context of a submitter.
+ */
+static void I2CAsync_StartNext()
+{
+	for (;;)
+	{
+		/* handlers of a higher priority may submit between the check and the state change */
+		register const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+
+		/* nothing left to do */
+		if (engine.readIndex == engine.writeIndex)
+		{
+			engine.current = NULL;
+			engine.state = I2CASYNC_STATE_IDLE;
+			I2CAsync_DisableModuleIrq();
+			__set_PRIMASK(primask);
+			return;
+		}
+	
+		register i2casync_transaction_t *const transaction = engine.queue[engine.readIndex & (I2CASYNC_QUEUE_SIZE-1)];
+		++engine.readIndex;
+	
+		engine.current = transaction;
+		engine.index = 0;
+		engine.remaining = transaction->registerCount;
+		engine.statusPending = (transaction->statusMask != 0);
+		engine.state = I2CASYNC_STATE_WRITE_ADDRESS;
+		__set_PRIMASK(primask);
+	
+		/* switch the pins to the slave; this is a no-op if they are shared */
+		I2CArbiter_SelectHandle(transaction->arbiterHandle);
+	
+		/* a stop condition from the previous transaction may still be in flight */
+		I2C_WaitWhileBusy();
+		
+		/* the bus is held by someone else; fail this one and try the next */
+		if (I2C_FetchError())
+		{
+			transaction->status = I2CASYNC_TIMEOUT;
+			if (transaction->callback != NULL)
+			{
+				transaction->callback(transaction);
+			}
+			continue;
+		}
+	
+		/* send I2C start signal and the write address; the rest is up to the IRQ */
+		I2CAsync_EnableModuleIrq();
+		I2C_SendStart();
+		I2C0->D = I2C_WRITE_ADDRESS(transaction->slaveId);
+		return;
+	}
+}
+
+/**
+ * @brief Finishes the current transaction and starts the next one
+ * @param[in] status The transaction status
+ */
+static void I2CAsync_Finish(register uint8_t status)
+{
+	register i2casync_transaction_t *const transaction = engine.current;
+
+	transaction->status = status;
+	if (transaction->callback != NULL)
+	{
+		transaction->callback(transaction);
+	}
+	Events_Signal(EVENT_I2C);
+
+	I2CAsync_StartNext();
+}
+
+/**
+ * @brief Queues a register burst read and returns immediately.
+ */
+uint8_t I2CAsync_Submit(i2casync_transaction_t *const transaction)
+{
+	assert_not_null(transaction);
+	assert(transaction->registerCount > 0);
+
+	/* restore rather than enable, as handlers may submit too */
+	register const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if ((uint8_t)(engine.writeIndex - engine.readIndex) >= I2CASYNC_QUEUE_SIZE)
+	{
+		__set_PRIMASK(primask);
+		transaction->status = I2CASYNC_QUEUE_FULL;
+		return I2CASYNC_QUEUE_FULL;
+	}
+
+	transaction->status = I2CASYNC_PENDING;
+	engine.queue[engine.writeIndex & (I2CASYNC_QUEUE_SIZE-1)] = transaction;
+	++engine.writeIndex;
+
+	/* kick off the state machine if it is not already running; The handler starts the
+	 * transfer, so that the bus is not waited for with the interrupts disabled here */
+	if (engine.state == I2CASYNC_STATE_IDLE)
+	{
+		engine.state = I2CASYNC_STATE_START;
+		NVIC_ISPR = 1 << I2C0_IRQ;
+	}
+
+	__set_PRIMASK(primask);
+	return I2CASYNC_SUCCESS;
+}
+
+/**
+ * @brief Determines if the engine has no queued or running transactions
+ */
+uint8_t I2CAsync_Idle()
+{
+	return engine.state == I2CASYNC_STATE_IDLE;
+}
+
+/**
+ * @brief Stores a received byte and drives the clock for the next one, or finishes the transaction after the last.
+ * @param[in] transaction The current transaction
+ *
+ * Must only be called with a byte in the data register, i.e. TCF set.
+ */
+static void I2CAsync_Receive(register i2casync_transaction_t *const transaction)
+{
+	if (engine.remaining == 1)
+	{
+		/* stop signal, then fetch the last received byte */
+		I2C_SendStop();
+		transaction->buffer[engine.index++] = I2C0->D;
+		I2CAsync_Finish(I2CASYNC_SUCCESS);
+		return;
+	}
+
+	/* disable ACK before reading the second-to-last byte */
+	if (engine.remaining == 2)
+	{
+		I2C_DisableAck();
+	}
+
+	/* fetch and store value, driving the clock for the next one */
+	--engine.remaining;
+	transaction->buffer[engine.index++] = I2C0->D;
+}
+
+#if I2CASYNC_USE_DMA
+
+/**
+ * @brief Enables or disables the I2C0 DMA request
+ * @param[in] enabled Nonzero to enable, zero to disable
+ */
+__STATIC_INLINE void I2CAsync_SetDmaRequest(register uint8_t enabled)
+{
+#if !I2C_USE_BME
+	if (enabled) I2C0->C1 |= I2C_C1_DMAEN_MASK;
+	else I2C0->C1 &= ~I2C_C1_DMAEN_MASK;
+#else
+	if (enabled) BME_OR_B(&I2C0->C1, (1 << I2C_C1_DMAEN_SHIFT) & I2C_C1_DMAEN_MASK);
+	else BME_AND_B(&I2C0->C1, (uint8_t)~((1 << I2C_C1_DMAEN_SHIFT) & I2C_C1_DMAEN_MASK));
+#endif
+}
+
+/**
+ * @brief Hands all but the last two data bytes to the DMA channel.
+ * @param[in] transaction The current transaction
+ *
+ * Called after the read address was acknowledged.
+ */
+static void I2CAsync_StartDmaReceive(register i2casync_transaction_t *const transaction)
+{
+	register const uint8_t dmaCount = engine.remaining - 2;
+	
+	/* the DMA moves the bytes; the module IRQ is not needed until it is done */
+	I2CAsync_DisableModuleIrq();
+	
+	/* single byte transfers from the data register into the buffer */
+	DMA_ClearDone(DMA_CHANNEL_I2C0);
+	DMA_SAR_REG(DMA0, DMA_CHANNEL_I2C0) = (uint32_t)&I2C0->D;
+	DMA_DAR_REG(DMA0, DMA_CHANNEL_I2C0) = (uint32_t)transaction->buffer;
+	DMA_DSR_BCR_REG(DMA0, DMA_CHANNEL_I2C0) = DMA_DSR_BCR_BCR(dmaCount);
+	DMA_DCR_REG(DMA0, DMA_CHANNEL_I2C0) = DMA_DCR_EINT_MASK	/* interrupt on completion */
+						| DMA_DCR_ERQ_MASK		/* enable peripheral request */
+						| DMA_DCR_CS_MASK		/* one transfer per request */
+						| DMA_DCR_DINC_MASK		/* increment destination */
+						| DMA_DCR_SSIZE(1)		/* 8-bit source */
+						| DMA_DCR_DSIZE(1)		/* 8-bit destination */
+						| DMA_DCR_D_REQ_MASK;	/* clear ERQ when done */
+	
+	engine.index = dmaCount;
+	engine.remaining = 2;
+	engine.state = I2CASYNC_STATE_DMA_RECEIVE;
+	
+	/* switch to receive mode with ACK and read a dummy byte to drive the clock;
+	 * every byte received from now on triggers a DMA read of the data register */
+	I2CAsync_SetDmaRequest(1);
+	I2C_EnterReceiveModeWithAck();
+	INTENTIONALLY_UNUSED(register uint8_t) = I2C0->D;
+}
+
+/**
+ * @brief IRQ handler for DMA channel 0 (I2C0 reception)
+ */
+RAMFUNC void DMA0_Handler()
+{
+	INSTRUMENT_ISR(INSTRUMENT_ISR_DMA0);
+
+	register const uint8_t failed = (DMA_HasError(DMA_CHANNEL_I2C0) != 0);
+	DMA_ClearDone(DMA_CHANNEL_I2C0);
+	I2CAsync_SetDmaRequest(0);
+	
+	if (engine.state != I2CASYNC_STATE_DMA_RECEIVE)
+	{
+		return;
+	}
+	
+	if (failed)
+	{
+		I2C_SendStop();
+		I2CAsync_Finish(I2CASYNC_DMA_ERROR);
+		return;
+	}
+	
+	/* The last DMA read started reception of the second-to-last byte,
+	 * which takes nine SCL cycles. Clear the flags stacked up by the DMA
+	 * bytes first, then check whether that byte has arrived meanwhile;
+	 * Its flag may have been cleared along with them, so it is serviced
+	 * here instead of by the IRQ. The CPU takes over from here and sends
+	 * the final NACK/STOP. */
+	I2C0->S = I2C_S_IICIF_MASK;
+	engine.state = I2CASYNC_STATE_RECEIVE;
+	
+	if (I2C0->S & I2C_S_TCF_MASK)
+	{
+		/* the byte may have completed after the flags were cleared */
+		I2C0->S = I2C_S_IICIF_MASK;
+		I2CAsync_Receive(engine.current);
+	}
+	
+	/* the reception of the last byte, if any, raises the IRQ */
+	if (engine.state == I2CASYNC_STATE_RECEIVE)
+	{
+		I2CAsync_EnableModuleIrq();
+	}
+}
+
+#endif /* I2CASYNC_USE_DMA */
+
+/**
+ * @brief Aborts the running and all queued transactions and stops the bus.
+ */
+void I2CAsync_Abort()
+{
+	__disable_irq();
+	
+	I2CAsync_DisableModuleIrq();
+#if I2CASYNC_USE_DMA
+	/* stop the requests, then the channel */
+	I2CAsync_SetDmaRequest(0);
+	DMA_DCR_REG(DMA0, DMA_CHANNEL_I2C0) &= ~DMA_DCR_ERQ_MASK;
+	DMA_ClearDone(DMA_CHANNEL_I2C0);
+	NVIC_ICPR |= 1 << DMA0_IRQ;
+#endif
+	
+	if (engine.current != NULL)
+	{
+		engine.current->status = I2CASYNC_TIMEOUT;
+	}
+	
+	while (engine.readIndex != engine.writeIndex)
+	{
+		engine.queue[engine.readIndex & (I2CASYNC_QUEUE_SIZE-1)]->status = I2CASYNC_ABORTED;
+		++engine.readIndex;
+	}
+	
+	engine.current = NULL;
+	engine.state = I2CASYNC_STATE_IDLE;
+	
+	/* leave master mode and drop whatever the module flagged meanwhile */
+	I2C_SendStop();
+	I2C0->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+	NVIC_ICPR |= 1 << I2C0_IRQ;
+	
+	__enable_irq();
+}
+
+/**
+ * @brief IRQ handler for I2C0
+ */
+RAMFUNC void I2C0_Handler()
+{
+	INSTRUMENT_ISR(INSTRUMENT_ISR_I2C0);
+
+	/* pended by I2CAsync_Submit(); The module has not flagged anything yet */
+	if (engine.state == I2CASYNC_STATE_START)
+	{
+		I2CAsync_StartNext();
+		return;
+	}
+
+	register const uint8_t status = I2C0->S;
+
+	/* clear interrupt flag */
+	I2C0->S = I2C_S_IICIF_MASK;
+
+	/* spurious interrupt */
+	if (engine.state == I2CASYNC_STATE_IDLE)
+	{
+		I2CAsync_DisableModuleIrq();
+		return;
+	}
+
+	/* lost arbitration; the module has already left master mode */
+	if (status & I2C_S_ARBL_MASK)
+	{
+		I2C0->S = I2C_S_ARBL_MASK;
+		I2C_SendStop();
+		I2CAsync_Finish(I2CASYNC_ARBITRATION_LOST);
+		return;
+	}
+
+	register i2casync_transaction_t *const transaction = engine.current;
+	switch (engine.state)
+	{
+		case I2CASYNC_STATE_WRITE_ADDRESS:
+		{
+			if (status & I2C_S_RXAK_MASK)
+			{
+				I2C_SendStop();
+				I2CAsync_Finish(I2CASYNC_NACK);
+				return;
+			}
+
+			/* send the status or the first data register address */
+			engine.state = I2CASYNC_STATE_REGISTER_ADDRESS;
+			I2C0->D = engine.statusPending ? transaction->statusRegisterAddress : transaction->registerAddress;
+			return;
+		}
+		case I2CASYNC_STATE_REGISTER_ADDRESS:
+		{
+			if (status & I2C_S_RXAK_MASK)
+			{
+				I2C_SendStop();
+				I2CAsync_Finish(I2CASYNC_NACK);
+				return;
+			}
+
+			/* signal a repeated start condition and send the read address */
+			engine.state = I2CASYNC_STATE_READ_ADDRESS;
+			I2C_SendRepeatedStart();
+			I2C0->D = I2C_READ_ADDRESS(transaction->slaveId);
+			return;
+		}
+		case I2CASYNC_STATE_READ_ADDRESS:
+		{
+			if (status & I2C_S_RXAK_MASK)
+			{
+				I2C_SendStop();
+				I2CAsync_Finish(I2CASYNC_NACK);
+				return;
+			}
+
+			/* receive the status byte without ACK, so that a repeated start may follow */
+			if (engine.statusPending)
+			{
+				engine.state = I2CASYNC_STATE_STATUS;
+				I2C_EnterReceiveModeWithoutAck();
+				INTENTIONALLY_UNUSED(register uint8_t) = I2C0->D;
+				return;
+			}
+
+#if I2CASYNC_USE_DMA
+			if (engine.remaining >= I2CASYNC_DMA_THRESHOLD)
+			{
+				I2CAsync_StartDmaReceive(transaction);
+				return;
+			}
+#endif
+
+			/* switch to receive mode; NACK right away if only one byte will be read */
+			engine.state = I2CASYNC_STATE_RECEIVE;
+			if (engine.remaining == 1)
+			{
+				I2C_EnterReceiveModeWithoutAck();
+			}
+			else
+			{
+				I2C_EnterReceiveModeWithAck();
+			}
+
+			/* read a dummy byte to drive the clock */
+			INTENTIONALLY_UNUSED(register uint8_t) = I2C0->D;
+			return;
+		}
+		case I2CASYNC_STATE_STATUS:
+		{
+			/* in transmit mode, reading the status byte does not clock in another one */
+			I2C_EnterTransmitMode();
+			transaction->statusRegister = I2C0->D;
+			engine.statusPending = 0;
+
+			/* data not ready (or locked): release the bus, the buffer stays untouched */
+			if (!I2CAsync_StatusMatched(transaction))
+			{
+				I2C_SendStop();
+				I2CAsync_Finish(I2CASYNC_SUCCESS);
+				return;
+			}
+
+			/* keep the bus and address the data registers using a repeated start */
+			engine.state = I2CASYNC_STATE_WRITE_ADDRESS;
+			I2C_SendRepeatedStart();
+			I2C0->D = I2C_WRITE_ADDRESS(transaction->slaveId);
+			return;
+		}
+		case I2CASYNC_STATE_RECEIVE:
+		{
+			I2CAsync_Receive(transaction);
+			return;
+		}
+		default:
+		{
+			return;
+		}
+	}
+}
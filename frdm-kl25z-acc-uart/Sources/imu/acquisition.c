@@ -0,0 +1,349 @@
+/*
+ * acquisition.c
+ *
+ *  Created on: Mar 11, 2014
+ *      Author: Markus
+ */
+
+#include "ARMCM0plus.h"
+#include "cpu/events.h"
+#include "i2c/i2casync.h"
+#include "imu/acquisition.h"
+
+/**
+ * @brief The sample queue
+ *
+ * The producer only writes the write index, the consumer only the read index;
+ * The indices run freely and wrap at 256, a multiple of the queue size.
+ */
+static struct {
+	sensor_sample_t samples[ACQUISITION_QUEUE_SIZE];
+	volatile uint8_t writeIndex;
+	volatile uint8_t readIndex;
+} queue;
+
+/**
+ * @brief The MPU6050 read
+ */
+static struct {
+	i2casync_transaction_t transaction;
+	mpu6050_fulldatareg_t raw;			/*< The internal data, followed by the HMC5883L data if read through the auxiliary bus */
+	uint32_t timestamp;					/*< The time of the data ready interrupt being read */
+	uint8_t auxiliaryCount;				/*< The number of HMC5883L bytes read along */
+	uint16_t sequence;					/*< The sequence number of the last sample */
+	uint16_t auxiliarySequence;			/*< The sequence number of the last HMC5883L sample read along */
+	volatile uint8_t reading;			/*< Nonzero from the submission until the callback returned */
+	volatile uint8_t pending;			/*< Nonzero if a data ready interrupt was not served yet */
+} mpu6050;
+
+/**
+ * @brief The HMC5883L read
+ */
+static struct {
+	i2casync_transaction_t transaction;	/*< The status and data read, see {@see HMC5883L_PrepareReadDataAsync()} */
+	uint8_t raw[HMC5883L_DATA_REGISTER_COUNT];
+	uint32_t timestamp;					/*< The time of the sample being read */
+	uint16_t sequence;					/*< The sequence number of the last sample */
+	volatile uint8_t reading;			/*< Nonzero from the submission until the callback returned */
+} hmc5883l;
+
+/**
+ * @brief The suspension depth; Starts suspended until the first {@see Acquisition_Resume()}.
+ */
+static volatile uint8_t suspended = 1;
+
+/**
+ * @brief The handle of the last failed device
+ */
+static volatile i2carbiter_handle_t failure = I2CARBITER_INVALID_HANDLE;
+
+/**
+ * @brief The counters
+ */
+static volatile acquisition_statistics_t counters;
+
+/**
+ * @brief Fetches the next free sample of the queue
+ * @return The sample or NULL if the queue is full
+ */
+static sensor_sample_t* Reserve()
+{
+	register const uint8_t index = queue.writeIndex;
+	if ((uint8_t)(index - queue.readIndex) >= ACQUISITION_QUEUE_SIZE)
+	{
+		++counters.dropped;
+		return NULL;
+	}
+	return &queue.samples[index & (ACQUISITION_QUEUE_SIZE-1)];
+}
+
+/**
+ * @brief Hands the sample fetched by {@see Reserve()} to the consumer
+ */
+static void Publish()
+{
+	/* the sample must be complete before the consumer sees the index */
+	__DMB();
+	register const uint8_t count = (uint8_t)(++queue.writeIndex - queue.readIndex);
+	if (count > counters.peak) counters.peak = count;
+}
+
+/**
+ * @brief Records a failed read for the main loop to recover from
+ * @param[in] transaction The transaction
+ */
+static void Fail(const i2casync_transaction_t *const transaction)
+{
+	++counters.errors;
+	failure = transaction->arbiterHandle;
+}
+
+/**
+ * @brief Decodes a completed MPU6050 read into the queue
+ * @param[in] transaction The transaction
+ */
+static void MPU6050Completed(i2casync_transaction_t *const transaction)
+{
+	if (I2CASYNC_SUCCESS != transaction->status)
+	{
+		/* the latched interrupt stays asserted until the status is read */
+		mpu6050.pending = 1;
+		mpu6050.reading = 0;
+		Fail(transaction);
+		return;
+	}
+
+	/* a cleared data ready flag means the latched interrupt was served already */
+	if (mpu6050.raw.internalData.INT_STATUS & MPU6050_INT_STATUS_DATA_RDY_INT_MASK)
+	{
+		sensor_sample_t *const sample = Reserve();
+		++mpu6050.sequence;
+		if (sample != NULL)
+		{
+			sample->timestamp = mpu6050.timestamp;
+			sample->sequence = mpu6050.sequence;
+			sample->source = SENSOR_MPU6050;
+			MPU6050_DecodeData(&mpu6050.raw.internalData, &sample->mpu6050);
+			Publish();
+		}
+	}
+
+	/* the status register was read right before the data output registers */
+	if ((mpu6050.auxiliaryCount > 0) && HMC5883L_DataReady(mpu6050.raw.EXT_SENS_DATA_00))
+	{
+		sensor_sample_t *const sample = Reserve();
+		++mpu6050.auxiliarySequence;
+		if (sample != NULL)
+		{
+			sample->timestamp = mpu6050.timestamp;
+			sample->sequence = mpu6050.auxiliarySequence;
+			sample->source = SENSOR_HMC5883L;
+			sample->hmc5883l.status = mpu6050.raw.EXT_SENS_DATA_00;
+			HMC5883L_DecodeData(&mpu6050.raw.EXT_SENS_DATA_01, &sample->hmc5883l);
+			Publish();
+		}
+	}
+
+	/* the data ready handler may preempt the callback; it must not touch the buffers before */
+	mpu6050.reading = 0;
+	Events_Signal(EVENT_MPU6050);
+}
+
+/**
+ * @brief Decodes a completed HMC5883L read into the queue
+ * @param[in] transaction The transaction
+ */
+static void HMC5883LCompleted(i2casync_transaction_t *const transaction)
+{
+	if (I2CASYNC_SUCCESS != transaction->status)
+	{
+		hmc5883l.reading = 0;
+		Fail(transaction);
+		return;
+	}
+
+	/* nothing new, so the data registers were not read; the next request asks again */
+	if (!HMC5883L_DataReady(transaction->statusRegister))
+	{
+		hmc5883l.reading = 0;
+		return;
+	}
+
+	sensor_sample_t *const sample = Reserve();
+	++hmc5883l.sequence;
+	if (sample != NULL)
+	{
+		sample->timestamp = hmc5883l.timestamp;
+		sample->sequence = hmc5883l.sequence;
+		sample->source = SENSOR_HMC5883L;
+		sample->hmc5883l.status = transaction->statusRegister;
+		HMC5883L_DecodeData(hmc5883l.raw, &sample->hmc5883l);
+		Publish();
+	}
+
+	hmc5883l.reading = 0;
+	Events_Signal(EVENT_HMC5883L);
+}
+
+/**
+ * @brief Submits the prepared MPU6050 read
+ */
+static void SubmitMPU6050()
+{
+	mpu6050.reading = 1;
+	if (I2CASYNC_SUCCESS != I2CAsync_Submit(&mpu6050.transaction))
+	{
+		mpu6050.pending = 1;
+		mpu6050.reading = 0;
+		Fail(&mpu6050.transaction);
+	}
+}
+
+/**
+ * @brief Prepares the sensor reads; The acquisition starts suspended.
+ * @param[in] mpu6050Handle The I2C arbiter handle of the MPU6050
+ * @param[in] hmc5883lHandle The I2C arbiter handle of the HMC5883L
+ * @param[in] auxiliaryCount The number of HMC5883L bytes read along with the MPU6050 data
+ */
+void Acquisition_Init(i2carbiter_handle_t mpu6050Handle, i2carbiter_handle_t hmc5883lHandle, uint8_t auxiliaryCount)
+{
+	assert(auxiliaryCount <= 24);
+
+	mpu6050.auxiliaryCount = auxiliaryCount;
+	I2CAsync_PrepareReadHandle(&mpu6050.transaction, mpu6050Handle, MPU6050_I2CADDR, MPU6050_REG_INT_STATUS, sizeof(mpu6050_intdatareg_t) + auxiliaryCount, (uint8_t*)&mpu6050.raw, MPU6050Completed, NULL);
+	HMC5883L_PrepareReadDataAsync(&hmc5883l.transaction, hmc5883lHandle, hmc5883l.raw, HMC5883LCompleted, NULL);
+
+	/* read once on resume, whether or not an edge was seen */
+	mpu6050.pending = 1;
+}
+
+/**
+ * @brief Submits the MPU6050 read; To be called from the data ready interrupt handler.
+ * @param[in] timestamp The time of the data ready interrupt
+ */
+void Acquisition_MPU6050Ready(uint32_t timestamp)
+{
+	if (suspended)
+	{
+		mpu6050.timestamp = timestamp;
+		mpu6050.pending = 1;
+		return;
+	}
+
+	/* the pending read fetches the newer data, if at all, under the older time */
+	if (mpu6050.reading)
+	{
+		++counters.overruns;
+		return;
+	}
+
+	mpu6050.timestamp = timestamp;
+	SubmitMPU6050();
+}
+
+/**
+ * @brief Submits the HMC5883L read, from its data ready interrupt handler or the main loop
+ * @param[in] timestamp The time of the sample
+ */
+void Acquisition_ReadHMC5883L(uint32_t timestamp)
+{
+	if (suspended) return;
+
+	if (hmc5883l.reading)
+	{
+		++counters.overruns;
+		return;
+	}
+
+	hmc5883l.timestamp = timestamp;
+	hmc5883l.reading = 1;
+	if (I2CASYNC_SUCCESS != I2CAsync_Submit(&hmc5883l.transaction))
+	{
+		hmc5883l.reading = 0;
+		Fail(&hmc5883l.transaction);
+	}
+}
+
+/**
+ * @brief Fetches the oldest sample from the queue
+ * @param[out] sample The sample
+ * @return Nonzero if a sample was fetched, zero if the queue is empty
+ */
+uint8_t Acquisition_Fetch(sensor_sample_t *const sample)
+{
+	register const uint8_t index = queue.readIndex;
+	if (index == queue.writeIndex) return 0;
+
+	/* read the sample only after the index, and free it only after the copy */
+	__DMB();
+	*sample = queue.samples[index & (ACQUISITION_QUEUE_SIZE-1)];
+	__DMB();
+
+	queue.readIndex = index + 1;
+	return 1;
+}
+
+/**
+ * @brief Fetches and clears the failure of a read
+ * @return The I2C arbiter handle of the failed device or {@see I2CARBITER_INVALID_HANDLE}
+ */
+i2carbiter_handle_t Acquisition_FetchFailure()
+{
+	__disable_irq();
+	register const i2carbiter_handle_t handle = failure;
+	failure = I2CARBITER_INVALID_HANDLE;
+	__enable_irq();
+	return handle;
+}
+
+/**
+ * @brief Stops submitting reads and waits for the pending ones to complete
+ */
+void Acquisition_Suspend()
+{
+	++suspended;
+	I2CAsync_WaitWhileBusy();
+
+	/* a read aborted by the wait never reached its callback */
+	if (mpu6050.reading)
+	{
+		mpu6050.reading = 0;
+		mpu6050.pending = 1;
+	}
+	hmc5883l.reading = 0;
+}
+
+/**
+ * @brief Resumes submitting reads after {@see Acquisition_Suspend()}
+ */
+void Acquisition_Resume()
+{
+	__disable_irq();
+	if ((suspended > 0) && (0 == --suspended) && mpu6050.pending)
+	{
+		mpu6050.pending = 0;
+		SubmitMPU6050();
+	}
+	__enable_irq();
+}
+
+/**
+ * @brief Fetches and resets the acquisition counters
+ * @param[out] statistics The counters accumulated since the last fetch
+ */
+void Acquisition_FetchStatistics(acquisition_statistics_t *const statistics)
+{
+	__disable_irq();
+
+	statistics->overruns = counters.overruns;
+	statistics->dropped = counters.dropped;
+	statistics->errors = counters.errors;
+	statistics->peak = counters.peak;
+
+	counters.overruns = 0;
+	counters.dropped = 0;
+	counters.errors = 0;
+	counters.peak = 0;
+
+	__enable_irq();
+}
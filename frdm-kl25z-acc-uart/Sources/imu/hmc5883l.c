@@ -8,6 +8,8 @@
 #include "imu/hmc5883l.h"
 #include "endian.h"
 #include "i2c/i2c.h"
+#include "i2c/i2casync.h"
+#include "i2c/i2carbiter.h"
 
 /**
  * @brief Helper macro to set bits in configuration->REGISTER_NAME
@@ -36,49 +38,71 @@ uint32_t HMC5883L_Identification()
 
 /**
  * @brief Fetches the data from the HMC5883L
- * @param[inout] data The sensor data
+ * @param[inout] data The sensor data; The values are only updated if the status reports ready and unlocked data.
+ *
+ * The status and data registers are read in a single bus session, see {@see I2C_ReadStatusAndRegisters()}.
  */
 void HMC5883L_ReadData(hmc5883l_data_t *const data)
 {
 	assert_not_null(data);
-	register uint8_t bufferA, bufferB;
+	uint8_t buffer[HMC5883L_DATA_REGISTER_COUNT];
 	
-	/* fetch the data */
-#if 0
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(HMC5883L_I2CADDR, HMC5883L_REG_SR);
-	I2C_DisableAck();
-	bufferA = I2C_ReceiveAndStop();
-	if ((bufferA & HMC5883L_SR_LOCK_MASK) || !(bufferA & HMC5883L_SR_RDY_MASK))
+	/* read the status and, if data is available and not locked, the data registers in one bus session */
+	data->status = I2C_ReadStatusAndRegisters(HMC5883L_I2CADDR, 
+			HMC5883L_REG_SR, HMC5883L_SR_LOCK_MASK | HMC5883L_SR_RDY_MASK, HMC5883L_SR_RDY_MASK, 
+			HMC5883L_REG_DXRA, HMC5883L_DATA_REGISTER_COUNT, buffer);
+	
+	if (HMC5883L_DataReady(data->status))
 	{
-		/* data is either locked - a write process is in process -
-		 * or not ready. 
-		 */
-		data->status = bufferA;
-		return;
+		HMC5883L_DecodeData(buffer, data);
 	}
-#endif
-	/* TODO: find a way to keep the wire here using repeated start */
-	
-	/* if there is data available and no lock, read data */
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(HMC5883L_I2CADDR, HMC5883L_REG_DXRA);
+}
+
+/**
+ * @brief Prepares an asynchronous read of the status register and, if it reports a new sample, the data output registers
+ * @param[inout] transaction The transaction to prepare
+ * @param[in] arbiterHandle The I2C arbiter handle of the HMC5883L
+ * @param[out] buffer The raw register buffer of {@see HMC5883L_DATA_REGISTER_COUNT} bytes; Must stay valid until completion.
+ * @param[in] callback Optional completion callback, may be NULL
+ * @param[in] context User data for the callback
+ */
+void HMC5883L_PrepareReadDataAsync(i2casync_transaction_t *const transaction, uint8_t arbiterHandle, uint8_t *const buffer, i2casync_callback_t callback, void *const context)
+{
+	assert_not_null(transaction);
+	assert_not_null(buffer);
 	
-	/* read x */
-	bufferA = I2C_ReceiveDriving();
-	bufferB = I2C_ReceiveDriving();
-	data->x = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB) & 0x00FF));
-		
-	/* read z - note that this is not a bug but the 
-    * actual ordering of the sensor data registers */
-    bufferA = I2C_ReceiveDriving();
-    bufferB = I2C_ReceiveDriving();
-	data->z = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB) & 0x00FF));
+	/* same as HMC5883L_ReadData(): the data registers follow the status with a repeated start */
+	I2CAsync_PrepareStatusReadHandle(transaction, arbiterHandle, HMC5883L_I2CADDR, 
+			HMC5883L_REG_SR, HMC5883L_SR_LOCK_MASK | HMC5883L_SR_RDY_MASK, HMC5883L_SR_RDY_MASK, 
+			HMC5883L_REG_DXRA, HMC5883L_DATA_REGISTER_COUNT, buffer, callback, context);
+}
 
-    /* read y */
-    bufferA = I2C_ReceiveDrivingWithNack();
-    bufferB = I2C_ReceiveAndStop();
-    data->y = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB)& 0x00FF));
+/**
+ * @brief Queues an asynchronous read of the status register and, if it reports a new sample, the data output registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer of {@see HMC5883L_DATA_REGISTER_COUNT} bytes; Must stay valid until completion.
+ * @return Zero if queued, nonzero otherwise
+ */
+uint8_t HMC5883L_ReadDataAsync(i2casync_transaction_t *const transaction, uint8_t *const buffer)
+{
+	HMC5883L_PrepareReadDataAsync(transaction, I2CARBITER_INVALID_HANDLE, buffer, NULL, NULL);
+	return I2CAsync_Submit(transaction);
+}
+
+/**
+ * @brief Decodes the raw data output registers
+ * @param[in] buffer The raw register contents of {@see HMC5883L_DATA_REGISTER_COUNT} bytes
+ * @param[inout] data The sensor data
+ */
+void HMC5883L_DecodeData(const uint8_t *const buffer, hmc5883l_data_t *const data)
+{
+	assert_not_null(buffer);
+	assert_not_null(data);
+	
+	/* note that the register order is x, z, y */
+	data->x = (int16_t)(((buffer[0] << 8) & 0xFF00) | ((buffer[1]) & 0x00FF));
+	data->z = (int16_t)(((buffer[2] << 8) & 0xFF00) | ((buffer[3]) & 0x00FF));
+	data->y = (int16_t)(((buffer[4] << 8) & 0xFF00) | ((buffer[5]) & 0x00FF));
 }
 
 /**
@@ -143,6 +167,17 @@ void HMC5883L_SetOutputRate(hmc5883l_confreg_t *const configuration, register hm
 	HMC5883L_CONFIG_SET(CRA, DO, rate);
 }
 
+/**
+ * Writes the output rate directly to the device
+ * @param[in] rate The output rate
+ */
+void HMC5883L_WriteOutputRate(register hmc5883l_do_t rate)
+{
+	I2C_ModifyRegister(HMC5883L_I2CADDR, HMC5883L_REG_CRA,
+		(uint8_t)~HMC5883L_CRA_DO_MASK,
+		(uint8_t)((rate << HMC5883L_CRA_DO_SHIFT) & HMC5883L_CRA_DO_MASK));
+}
+
 /**
  * Sets the measurement mode
  * @param[inout] configuration The configuration
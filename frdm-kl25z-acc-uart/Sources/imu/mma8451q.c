@@ -29,6 +29,11 @@
 #define CTRL_REG3_PPOD_MASK 	(0x1u)
 #define CTRL_REG3_PPOD_SHIFT 	(0x00u)
 
+#define F_SETUP_F_MODE_MASK 	(0xC0u)
+#define F_SETUP_F_MODE_SHIFT 	(0x6u)
+#define F_SETUP_F_WMRK_MASK 	(0x3Fu)
+#define F_SETUP_F_WMRK_SHIFT 	(0x0u)
+
 #define XYZ_DATA_CFG_FS_SHIFT 	(0x0u)
 #define XYZ_DATA_CFG_FS_MASK 	(0x03u)
 #define XYZ_DATA_CFG_HPF_OUT_SHIFT (0x04u)
@@ -63,6 +68,46 @@ void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data)
 	data->z >>= 2;
 }
 
+/**
+ * @brief Drains the accelerometer samples from the FIFO in one burst read
+ * @param[out] samples The samples, oldest first; Must not be null.
+ * @param[in] max The maximum number of samples to read
+ * @return The number of samples read
+ */
+uint8_t MMA8451Q_ReadFifo(mma8451q_acc_t *const samples, uint8_t max)
+{
+	assert_not_null(samples);
+	
+	/* 6 data registers per sample */
+	static const uint8_t frameSize = 6;
+	uint8_t buffer[MMA8451Q_FIFO_SIZE * 6];
+	
+	/* determine the number of samples to fetch */
+	register uint8_t count = MMA8451Q_F_STATUS_COUNT(I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_F_STATUS));
+	if (count > max) count = max;
+	if (count > MMA8451Q_FIFO_SIZE) count = MMA8451Q_FIFO_SIZE;
+	if (count == 0)
+	{
+		return 0;
+	}
+	
+	/* the read pointer wraps around the data registers, so a burst read pops the samples */
+	I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_OUT_X_MSB, (uint8_t)(count * frameSize), buffer);
+	
+	/* decode the big endian 14bit samples */
+	register const uint8_t *frame = buffer;
+	for (uint8_t i = 0; i < count; ++i, frame += frameSize)
+	{
+		mma8451q_acc_t *const data = &samples[i];
+		data->status = MMA8451Q_STATUS_XYZDR(0xFF);
+		data->x = (int16_t)((((uint16_t)frame[0] << 8) & 0xFF00) | (((uint16_t)frame[1]) & 0x00FF)) >> 2;
+		data->y = (int16_t)((((uint16_t)frame[2] << 8) & 0xFF00) | (((uint16_t)frame[3]) & 0x00FF)) >> 2;
+		data->z = (int16_t)((((uint16_t)frame[4] << 8) & 0xFF00) | (((uint16_t)frame[5]) & 0x00FF)) >> 2;
+	}
+	
+	return count;
+}
+
 /**
  * @brief Sets the data rate and the active mode
  */
@@ -99,6 +144,26 @@ uint8_t MMA8451Q_LandscapePortraitConfig()
 	return I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_PL_CFG);
 }
 
+/**
+ * @brief Configures the FIFO buffer
+ * @param[in] mode The FIFO mode
+ * @param[in] watermark The watermark sample count
+ */
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark)
+{
+	assert(watermark <= MMA8451Q_FIFO_SIZE);
+	
+	const register uint8_t value = ((mode << F_SETUP_F_MODE_SHIFT) & F_SETUP_F_MODE_MASK) | ((watermark << F_SETUP_F_WMRK_SHIFT) & F_SETUP_F_WMRK_MASK);
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_F_SETUP, value);
+	}
+	else
+	{
+		configuration->F_SETUP = value;
+	}
+}
+
 /**
  * @brief Configures the oversampling modes
  * @param[in] oversampling The oversampling mode
@@ -7,6 +7,8 @@
 
 #include "imu/mpu6050.h"
 #include "i2c/i2c.h"
+#include "i2c/i2casync.h"
+#include "i2c/i2carbiter.h"
 #include "nice_names.h"
 #include "led/led.h"
 
@@ -37,13 +39,32 @@
     variable &= (uint8_t)~(MPU6050_ ## reg ## _ ## bits ## _MASK); \
     variable |= (value << MPU6050_## reg ## _ ## bits ## _SHIFT) & MPU6050_ ## reg ## _ ## bits ## _MASK
 
+/**
+ * @brief The MPU6050 the driver talks to, see {@see MPU6050_Select()}
+ */
+static struct {
+	uint8_t address;				/*< The 7-bit slave address */
+	uint8_t arbiterHandle;			/*< The I2C arbiter handle */
+} selected = { MPU6050_I2CADDR, I2CARBITER_INVALID_HANDLE };
+
+/**
+ * @brief Selects the MPU6050 the driver talks to
+ * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] arbiterHandle The I2C arbiter handle of the device
+ */
+void MPU6050_Select(uint8_t slaveAddress, uint8_t arbiterHandle)
+{
+	selected.address = slaveAddress;
+	selected.arbiterHandle = arbiterHandle;
+}
+
 /**
  * @brief Reads the WHO_AM_I register from the MPU6050.
  * @return Device identification code; Should be 0b0110100 (0x68)
  */
 uint8_t MPU6050_WhoAmI()
 {
-	return I2C_ReadRegister(MPU6050_I2CADDR, MPU6050_REG_WHO_AM_I);
+	return I2C_ReadRegister(selected.address, MPU6050_REG_WHO_AM_I);
 }
 
 /**
@@ -59,7 +80,7 @@ void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration)
 	
 	/* start register addressing */
 	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_SMPLRT_DIV);
+	I2C_InitiateRegisterReadAt(selected.address, MPU6050_REG_SMPLRT_DIV);
 	
 	/* read the registers */
 	configuration->SMPLRT_DIV = I2C_ReceiveDriving();
@@ -68,12 +89,12 @@ void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration)
 	configuration->ACCEL_CONFIG = I2C_ReceiveAndRestart();
 	
 	/* restart read at 0x23 */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_FIFO_EN);
+	I2C_InitiateRegisterReadAt(selected.address, MPU6050_REG_FIFO_EN);
 	configuration->FIFO_EN = I2C_ReceiveDriving();
 	configuration->I2C_MST_CTRL = I2C_ReceiveDriving();
 	configuration->I2C_SLV0_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV0_CTRL = I2C_ReceiveDriving();
 	configuration->I2C_SLV0_REG = I2C_ReceiveDriving();
+	configuration->I2C_SLV0_CTRL = I2C_ReceiveDriving();
 	
 	configuration->I2C_SLV1_ADDR = I2C_ReceiveDriving();
 	configuration->I2C_SLV1_REG = I2C_ReceiveDriving();
@@ -94,7 +115,7 @@ void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration)
 	configuration->INT_ENABLE = I2C_ReceiveAndRestart(); /* 0x38 */
 	
 	/* restart read at 0x63 */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_I2C_SLV0_DO);
+	I2C_InitiateRegisterReadAt(selected.address, MPU6050_REG_I2C_SLV0_DO);
 	configuration->I2C_SLV0_DO = I2C_ReceiveDriving();
 	configuration->I2C_SLV1_DO = I2C_ReceiveDriving();
 	configuration->I2C_SLV2_DO = I2C_ReceiveDriving();
@@ -107,7 +128,7 @@ void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration)
 	configuration->PWR_MGMT_2 = I2C_ReceiveAndRestart();
 	
 	/* restart read at 0x6D */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_FIFO_COUNTH);
+	I2C_InitiateRegisterReadAt(selected.address, MPU6050_REG_FIFO_COUNTH);
 	configuration->FIFO_COUNTH = I2C_ReceiveDriving();
 	configuration->FIFO_COUNTL = I2C_ReceiveDriving();
 	configuration->FIFO_R_W = I2C_ReceiveDrivingWithNack();
@@ -127,7 +148,7 @@ void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration)
 	
 	/* start register addressing at 0x19 */
 	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
 	I2C_SendBlocking(MPU6050_REG_SMPLRT_DIV);
 	I2C_SendBlocking(configuration->SMPLRT_DIV);
 	I2C_SendBlocking(configuration->CONFIG);
@@ -136,13 +157,13 @@ void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration)
 
     /* restart register addressing at 0x6B */
     I2C_SendRepeatedStart();
-    I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+    I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
     I2C_SendBlocking(MPU6050_REG_PWR_MGMT_1);
     I2C_SendBlocking(configuration->PWR_MGMT_1);
 
 	/* restart register addressing at 0x23 */
 	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
 	I2C_SendBlocking(MPU6050_REG_FIFO_EN);
 	I2C_SendBlocking(configuration->FIFO_EN);
 	I2C_SendBlocking(configuration->I2C_MST_CTRL);
@@ -165,14 +186,14 @@ void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration)
 	
 	/* restart register addressing at 0x37 */
 	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
 	I2C_SendBlocking(MPU6050_REG_INT_PIN_CFG);
 	I2C_SendBlocking(configuration->INT_PIN_CFG);
 	I2C_SendBlocking(configuration->INT_ENABLE);
 	
 	/* restart register addressing at 0x63 */
 	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
 	I2C_SendBlocking(MPU6050_REG_I2C_SLV0_DO);
 	I2C_SendBlocking(configuration->I2C_SLV0_DO);
 	I2C_SendBlocking(configuration->I2C_SLV1_DO);
@@ -187,7 +208,7 @@ void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration)
 	
 	/* restart register addressing at 0x71 */
 	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
 	I2C_SendBlocking(MPU6050_REG_FIFO_COUNTH);
 	I2C_SendBlocking(configuration->FIFO_COUNTH);
 	I2C_SendBlocking(configuration->FIFO_COUNTL);
@@ -217,6 +238,35 @@ void MPU6050_SetGyroscopeSampleRateDivider(mpu6050_confreg_t *const configuratio
 	MPU6050_CONFIG_SET(SMPLRT_DIV, SMPLRT_DIV, divider);
 }
 
+#define MPU6050_CONFIG_DLPF_CFG_MASK		(0b00000111)
+#define MPU6050_CONFIG_DLPF_CFG_SHIFT		(0)
+
+/**
+ * @brief Configures the digital low pass filter
+ * @param[inout] configuration The configuration structure
+ * @param[in] filter The filter bandwidth
+ */
+void MPU6050_SetDigitalLowPass(mpu6050_confreg_t *const configuration, mpu6050_dlpf_t filter)
+{
+	assert_not_null(configuration);
+	MPU6050_CONFIG_SET(CONFIG, DLPF_CFG, filter);
+}
+
+/**
+ * @brief Writes the sample rate divider and the digital low pass filter directly to the device
+ * @param[in] divider The divider in a range of 1..255
+ * @param[in] filter The filter bandwidth
+ */
+void MPU6050_WriteSampleRate(uint8_t divider, mpu6050_dlpf_t filter)
+{
+	if (divider == 0) divider = 1;
+
+	I2C_WriteRegister(selected.address, MPU6050_REG_SMPLRT_DIV, (uint8_t)(divider - 1));
+	I2C_ModifyRegister(selected.address, MPU6050_REG_CONFIG,
+		(uint8_t)~MPU6050_CONFIG_DLPF_CFG_MASK,
+		(uint8_t)((filter << MPU6050_CONFIG_DLPF_CFG_SHIFT) & MPU6050_CONFIG_DLPF_CFG_MASK));
+}
+
 #define MPU6050_GYRO_CONFIG_FS_SEL_MASK		(0b00011000)
 #define MPU6050_GYRO_CONFIG_FS_SEL_SHIFT	(3)
 
@@ -245,6 +295,21 @@ void MPU6050_SetAccelerometerFullScale(mpu6050_confreg_t *const configuration, m
 	MPU6050_CONFIG_SET(ACCEL_CONFIG, AFS_SEL, fullScale);
 }
 
+/**
+ * @brief Writes the gyroscope and accelerometer full scale ranges directly to the device
+ * @param[in] gyroscope The gyroscope full scale
+ * @param[in] accelerometer The accelerometer full scale
+ */
+void MPU6050_WriteFullScale(mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer)
+{
+	I2C_ModifyRegister(selected.address, MPU6050_REG_GYRO_CONFIG,
+		(uint8_t)~MPU6050_GYRO_CONFIG_FS_SEL_MASK,
+		(uint8_t)((gyroscope << MPU6050_GYRO_CONFIG_FS_SEL_SHIFT) & MPU6050_GYRO_CONFIG_FS_SEL_MASK));
+	I2C_ModifyRegister(selected.address, MPU6050_REG_ACCEL_CONFIG,
+		(uint8_t)~MPU6050_ACCEL_CONFIG_AFS_SEL_MASK,
+		(uint8_t)((accelerometer << MPU6050_ACCEL_CONFIG_AFS_SEL_SHIFT) & MPU6050_ACCEL_CONFIG_AFS_SEL_MASK));
+}
+
 #define MPU6050_INT_PIN_CFG_INT_LEVEL_MASK 		(0b10000000)
 #define MPU6050_INT_PIN_CFG_INT_LEVEL_SHIFT 	(7)
 #define MPU6050_INT_PIN_CFG_INT_OPEN_MASK 		(0b01000000)
@@ -274,7 +339,7 @@ void MPU6050_ConfigureInterrupts(mpu6050_confreg_t *const configuration, mpu6050
 
         I2C_WaitWhileBusy();
         I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+        I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
         I2C_SendBlocking(MPU6050_REG_INT_PIN_CFG);
         I2C_SendBlocking(value);
         I2C_SendStop();
@@ -313,7 +378,7 @@ void MPU6050_EnableInterrupts(mpu6050_confreg_t *const configuration, mpu6050_in
 
         I2C_WaitWhileBusy();
         I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+        I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
         I2C_SendBlocking(MPU6050_REG_INT_ENABLE);
         I2C_SendBlocking(value);
         I2C_SendStop();
@@ -343,7 +408,7 @@ void MPU6050_SelectClockSource(mpu6050_confreg_t *const configuration, mpu6050_c
 
         I2C_WaitWhileBusy();
         I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
+        I2C_SendBlocking(I2C_WRITE_ADDRESS(selected.address));
         I2C_SendBlocking(MPU6050_REG_PWR_MGMT_1);
         I2C_SendBlocking(value);
         I2C_SendStop();
@@ -368,8 +433,197 @@ void MPU6050_SetSleepMode(mpu6050_confreg_t *const configuration, mpu6050_sleep_
 	MPU6050_CONFIG_SET(PWR_MGMT_1, SLEEP, mode);
 }
 
-#define MPU6050_INT_STATUS_DATA_RDY_INT_MASK 	(0b00000001)
-#define MPU6050_INT_STATUS_DATA_RDY_INT_SHIFT 	(0)
+#define MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_MASK	(0b00000010)
+#define MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_SHIFT	(1)
+
+/**
+ * @brief Connects or disconnects the auxiliary I2C bus to the host bus
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] enabled Whether the bypass is enabled.
+ */
+void MPU6050_SetAuxiliaryBypass(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled)
+{
+    if (configuration == MPU6050_CONFIGURE_DIRECT)
+    {
+        uint8_t value = 0;
+        MPU6050_VALUE_SET(value, INT_PIN_CFG, I2C_BYPASS_EN, enabled);
+        I2C_ModifyRegister(selected.address, MPU6050_REG_INT_PIN_CFG, (uint8_t)~MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_MASK, value);
+    }
+    else
+    {
+        MPU6050_CONFIG_SET(INT_PIN_CFG, I2C_BYPASS_EN, enabled);
+    }
+}
+
+#define MPU6050_USER_CTRL_I2C_MST_EN_MASK		(0b00100000)
+#define MPU6050_USER_CTRL_I2C_MST_EN_SHIFT		(5)
+#define MPU6050_I2C_MST_CTRL_WAIT_FOR_ES_MASK	(0b01000000)
+#define MPU6050_I2C_MST_CTRL_WAIT_FOR_ES_SHIFT	(6)
+#define MPU6050_I2C_MST_CTRL_I2C_MST_CLK_MASK	(0b00001111)
+#define MPU6050_I2C_MST_CTRL_I2C_MST_CLK_SHIFT	(0)
+
+/**
+ * @brief Configures the I2C master of the auxiliary bus
+ * @param[inout] configuration The configuration structure
+ * @param[in] enabled Whether the I2C master is enabled.
+ * @param[in] waitForExternal Whether the data ready interrupt is delayed until the external sensor data was loaded.
+ * @param[in] clock The I2C master clock divider
+ */
+void MPU6050_ConfigureI2CMaster(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled, mpu6050_inten_t waitForExternal, uint8_t clock)
+{
+	assert_not_null(configuration);
+	MPU6050_CONFIG_SET(USER_CTRL, I2C_MST_EN, enabled);
+	MPU6050_CONFIG_SET(I2C_MST_CTRL, WAIT_FOR_ES, waitForExternal);
+	MPU6050_CONFIG_SET(I2C_MST_CTRL, I2C_MST_CLK, clock);
+}
+
+#define MPU6050_I2C_SLV_ADDR_RW_MASK	(0b10000000)
+#define MPU6050_I2C_SLV_CTRL_EN_MASK	(0b10000000)
+#define MPU6050_I2C_SLV_CTRL_LEN_MASK	(0b00001111)
+
+/**
+ * @brief Configures an auxiliary bus slave to be read at the sample rate into the EXT_SENS_DATA registers
+ * @param[inout] configuration The configuration structure
+ * @param[in] slave The slave index in a range of 0..3
+ * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] startRegisterAddress The first register address to read
+ * @param[in] registerCount The number of registers to read in a range of 1..15, or zero to disable the slave
+ */
+void MPU6050_ConfigureSlaveRead(mpu6050_confreg_t *const configuration, uint8_t slave, uint8_t slaveAddress, uint8_t startRegisterAddress, uint8_t registerCount)
+{
+	assert_not_null(configuration);
+	assert(slave <= 3);
+	assert(registerCount <= MPU6050_I2C_SLV_CTRL_LEN_MASK);
+	
+	/* ADDR, REG and CTRL registers of slaves 0..3 are laid out consecutively */
+	uint8_t *const registers = &configuration->I2C_SLV0_ADDR + 3*slave;
+	registers[0] = MPU6050_I2C_SLV_ADDR_RW_MASK | (slaveAddress & 0x7F); /* read transfer */
+	registers[1] = startRegisterAddress;
+	registers[2] = (registerCount > 0)
+					? (MPU6050_I2C_SLV_CTRL_EN_MASK | (registerCount & MPU6050_I2C_SLV_CTRL_LEN_MASK))
+					: 0;
+}
+
+#define MPU6050_FIFO_EN_TEMP_FIFO_EN_MASK	(0b10000000)
+#define MPU6050_FIFO_EN_TEMP_FIFO_EN_SHIFT	(7)
+#define MPU6050_FIFO_EN_XG_FIFO_EN_MASK		(0b01000000)
+#define MPU6050_FIFO_EN_XG_FIFO_EN_SHIFT	(6)
+#define MPU6050_FIFO_EN_YG_FIFO_EN_MASK		(0b00100000)
+#define MPU6050_FIFO_EN_YG_FIFO_EN_SHIFT	(5)
+#define MPU6050_FIFO_EN_ZG_FIFO_EN_MASK		(0b00010000)
+#define MPU6050_FIFO_EN_ZG_FIFO_EN_SHIFT	(4)
+#define MPU6050_FIFO_EN_ACCEL_FIFO_EN_MASK	(0b00001000)
+#define MPU6050_FIFO_EN_ACCEL_FIFO_EN_SHIFT	(3)
+
+/**
+ * @brief Selects the sensor data written into the FIFO
+ * @param[inout] configuration The configuration structure
+ * @param[in] temperature Whether to write the temperature
+ * @param[in] gyroscope Whether to write all gyroscope axes
+ * @param[in] accelerometer Whether to write all accelerometer axes
+ */
+void MPU6050_SelectFifoSources(mpu6050_confreg_t *const configuration, mpu6050_inten_t temperature, mpu6050_inten_t gyroscope, mpu6050_inten_t accelerometer)
+{
+	assert_not_null(configuration);
+	MPU6050_CONFIG_SET(FIFO_EN, TEMP_FIFO_EN, temperature);
+	MPU6050_CONFIG_SET(FIFO_EN, XG_FIFO_EN, gyroscope);
+	MPU6050_CONFIG_SET(FIFO_EN, YG_FIFO_EN, gyroscope);
+	MPU6050_CONFIG_SET(FIFO_EN, ZG_FIFO_EN, gyroscope);
+	MPU6050_CONFIG_SET(FIFO_EN, ACCEL_FIFO_EN, accelerometer);
+}
+
+#define MPU6050_USER_CTRL_FIFO_EN_MASK		(0b01000000)
+#define MPU6050_USER_CTRL_FIFO_EN_SHIFT		(6)
+#define MPU6050_USER_CTRL_FIFO_RESET_MASK	(0b00000100)
+#define MPU6050_USER_CTRL_FIFO_RESET_SHIFT	(2)
+
+/**
+ * @brief Enables or disables the FIFO buffer
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] enabled Whether the FIFO is enabled.
+ */
+void MPU6050_EnableFifo(mpu6050_confreg_t *const configuration, mpu6050_inten_t enabled)
+{
+    if (configuration == MPU6050_CONFIGURE_DIRECT)
+    {
+        uint8_t value = 0;
+        MPU6050_VALUE_SET(value, USER_CTRL, FIFO_EN, enabled);
+        I2C_ModifyRegister(selected.address, MPU6050_REG_USER_CTRL, (uint8_t)~MPU6050_USER_CTRL_FIFO_EN_MASK, value);
+    }
+    else
+    {
+        MPU6050_CONFIG_SET(USER_CTRL, FIFO_EN, enabled);
+    }
+}
+
+/**
+ * @brief Clears the FIFO buffer
+ */
+void MPU6050_ResetFifo()
+{
+	/* the reset bit clears itself */
+	I2C_ModifyRegister(selected.address, MPU6050_REG_USER_CTRL, I2C_MOD_NO_AND_MASK, MPU6050_USER_CTRL_FIFO_RESET_MASK);
+}
+
+/**
+ * @brief Reads the number of bytes in the FIFO
+ * @return The number of bytes
+ */
+uint16_t MPU6050_ReadFifoCount()
+{
+	uint8_t buffer[2];
+	I2C_ReadRegisters(selected.address, MPU6050_REG_FIFO_COUNTH, sizeof(buffer), buffer);
+	return (uint16_t)((((uint16_t)buffer[0] << 8) & 0xFF00) | (((uint16_t)buffer[1]) & 0x00FF));
+}
+
+/**
+ * @brief Drains accelerometer and gyroscope frames from the FIFO in one burst read
+ * @param[out] out The sample buffer
+ * @param[in] max The maximum number of samples to read; At most {@see MPU6050_FIFO_MAX_BATCH} are read.
+ * @return The number of samples read, oldest first
+ */
+size_t MPU6050_ReadFifo(mpu6050_sensor_t *out, size_t max)
+{
+	assert_not_null(out);
+	uint8_t buffer[MPU6050_FIFO_MAX_BATCH * MPU6050_FIFO_FRAME_SIZE];
+	
+	/* a full FIFO has overflowed (or is about to), so frame alignment is lost */
+	register const uint16_t count = MPU6050_ReadFifoCount();
+	if (count >= MPU6050_FIFO_SIZE - MPU6050_FIFO_FRAME_SIZE)
+	{
+		MPU6050_ResetFifo();
+		return 0;
+	}
+	
+	/* determine the number of complete frames to fetch */
+	register size_t frames = count / MPU6050_FIFO_FRAME_SIZE;
+	if (frames > max) frames = max;
+	if (frames > MPU6050_FIFO_MAX_BATCH) frames = MPU6050_FIFO_MAX_BATCH;
+	if (frames == 0)
+	{
+		return 0;
+	}
+	
+	/* the FIFO register does not auto-increment, so a burst read pops the frames */
+	I2C_ReadRegisters(selected.address, MPU6050_REG_FIFO_R_W, (uint8_t)(frames * MPU6050_FIFO_FRAME_SIZE), buffer);
+	
+	/* decode the frames; the FIFO order is accelerometer, then gyroscope */
+	register const uint8_t *frame = buffer;
+	for (size_t i = 0; i < frames; ++i, frame += MPU6050_FIFO_FRAME_SIZE)
+	{
+		mpu6050_sensor_t *const data = &out[i];
+		data->status = MPU6050_INT_STATUS_DATA_RDY_INT_MASK;
+		data->accel.x = (int16_t)((((uint16_t)frame[0] << 8) & 0xFF00) | (((uint16_t)frame[1]) & 0x00FF));
+		data->accel.y = (int16_t)((((uint16_t)frame[2] << 8) & 0xFF00) | (((uint16_t)frame[3]) & 0x00FF));
+		data->accel.z = (int16_t)((((uint16_t)frame[4] << 8) & 0xFF00) | (((uint16_t)frame[5]) & 0x00FF));
+		data->gyro.x  = (int16_t)((((uint16_t)frame[6] << 8) & 0xFF00)  | (((uint16_t)frame[7]) & 0x00FF));
+		data->gyro.y  = (int16_t)((((uint16_t)frame[8] << 8) & 0xFF00)  | (((uint16_t)frame[9]) & 0x00FF));
+		data->gyro.z  = (int16_t)((((uint16_t)frame[10] << 8) & 0xFF00) | (((uint16_t)frame[11]) & 0x00FF));
+		data->temperature = 0;
+	}
+	
+	return frames;
+}
 
 /**
  * @brief Reads accelerometer, gyro and temperature data from the MPU6050
@@ -382,7 +636,7 @@ void MPU6050_ReadData(mpu6050_sensor_t *data)
 	
 	/* fetch the data */
 	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_INT_STATUS);
+	I2C_InitiateRegisterReadAt(selected.address, MPU6050_REG_INT_STATUS);
 	buffer.INT_STATUS = I2C_ReceiveDriving();
 	
 	/* early exit */
@@ -413,14 +667,79 @@ void MPU6050_ReadData(mpu6050_sensor_t *data)
 	buffer.GYRO_ZOUT_L = I2C_ReceiveAndStop();
 	
 	/* assign the data */
-	data->status = buffer.INT_STATUS;
-	data->accel.x = (int16_t)((((uint16_t)buffer.ACCEL_XOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_XOUT_L) & 0x00FF));
-	data->accel.y = (int16_t)((((uint16_t)buffer.ACCEL_YOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_YOUT_L) & 0x00FF));
-	data->accel.z = (int16_t)((((uint16_t)buffer.ACCEL_ZOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_ZOUT_L) & 0x00FF));
-	data->gyro.x  = (int16_t)((((uint16_t)buffer.GYRO_XOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_XOUT_L) & 0x00FF));
-	data->gyro.y  = (int16_t)((((uint16_t)buffer.GYRO_YOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_YOUT_L) & 0x00FF));
-	data->gyro.z  = (int16_t)((((uint16_t)buffer.GYRO_ZOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_ZOUT_L) & 0x00FF));
+	MPU6050_DecodeData(&buffer, data);
+}
+
+/**
+ * @brief Decodes the raw interrupt status and sensor data registers
+ * @param[in] buffer The raw register contents
+ * @param[out] data The data
+ */
+void MPU6050_DecodeData(const mpu6050_intdatareg_t *const buffer, mpu6050_sensor_t *const data)
+{
+	assert_not_null(buffer);
+	assert_not_null(data);
+
+	/* data registers are only valid if the data ready flag is set */
+	if (!(buffer->INT_STATUS & MPU6050_INT_STATUS_DATA_RDY_INT_MASK))
+	{
+		data->status = 0;
+		return;
+	}
+
+	data->status = buffer->INT_STATUS;
+	data->accel.x = (int16_t)((((uint16_t)buffer->ACCEL_XOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_XOUT_L) & 0x00FF));
+	data->accel.y = (int16_t)((((uint16_t)buffer->ACCEL_YOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_YOUT_L) & 0x00FF));
+	data->accel.z = (int16_t)((((uint16_t)buffer->ACCEL_ZOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_ZOUT_L) & 0x00FF));
+	data->gyro.x  = (int16_t)((((uint16_t)buffer->GYRO_XOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_XOUT_L) & 0x00FF));
+	data->gyro.y  = (int16_t)((((uint16_t)buffer->GYRO_YOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_YOUT_L) & 0x00FF));
+	data->gyro.z  = (int16_t)((((uint16_t)buffer->GYRO_ZOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_ZOUT_L) & 0x00FF));
 	
 	/* Temperature in degrees C = (TEMP_OUT Register Value as a signed quantity)/340 + 36.53 */
-	data->temperature  = (((int16_t)buffer.TEMP_OUT_H << 8) & 0xFF00)  | (((int16_t)buffer.TEMP_OUT_L) & 0x00FF);
+	data->temperature  = (((int16_t)buffer->TEMP_OUT_H << 8) & 0xFF00)  | (((int16_t)buffer->TEMP_OUT_L) & 0x00FF);
+}
+
+/**
+ * @brief Queues an asynchronous read of the interrupt status, sensor data and external sensor data registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @param[in] externalCount The number of EXT_SENS_DATA registers to read
+ * @return Zero if queued, nonzero otherwise
+ */
+uint8_t MPU6050_ReadFullDataAsync(i2casync_transaction_t *const transaction, mpu6050_fulldatareg_t *const buffer, uint8_t externalCount)
+{
+	assert_not_null(transaction);
+	assert_not_null(buffer);
+	assert(externalCount <= 24);
+	
+	I2CAsync_PrepareReadHandle(transaction, selected.arbiterHandle, selected.address, MPU6050_REG_INT_STATUS, sizeof(mpu6050_intdatareg_t) + externalCount, (uint8_t*)buffer, NULL, NULL);
+	return I2CAsync_Submit(transaction);
+}
+
+/**
+ * @brief Queues an asynchronous read of the interrupt status and sensor data registers
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @return Zero if queued, nonzero otherwise
+ */
+uint8_t MPU6050_ReadDataAsync(i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const buffer)
+{
+	return MPU6050_ReadDataAsyncFrom(transaction, buffer, selected.address, selected.arbiterHandle);
+}
+
+/**
+ * @brief Queues an asynchronous read of the interrupt status and sensor data registers of a given MPU6050
+ * @param[inout] transaction The transaction to use
+ * @param[out] buffer The raw register buffer; Must stay valid until completion.
+ * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] arbiterHandle The I2C arbiter handle of the device
+ * @return Zero if queued, nonzero otherwise
+ */
+uint8_t MPU6050_ReadDataAsyncFrom(i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const buffer, uint8_t slaveAddress, uint8_t arbiterHandle)
+{
+	assert_not_null(transaction);
+	assert_not_null(buffer);
+
+	I2CAsync_PrepareReadHandle(transaction, arbiterHandle, slaveAddress, MPU6050_REG_INT_STATUS, sizeof(mpu6050_intdatareg_t), (uint8_t*)buffer, NULL, NULL);
+	return I2CAsync_Submit(transaction);
 }
@@ -0,0 +1,120 @@
+/*
+ * mpu6050_autorange.c
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#include "imu/mpu6050_autorange.h"
+
+/**
+ * @brief Fetches the largest absolute value of a raw sensor triple
+ * @param[in] xyz The values
+ * @return The peak
+ */
+static uint16_t AbsolutePeak(const int16_t xyz[3])
+{
+	uint16_t peak = 0;
+	for (uint_fast8_t i = 0; i < 3; ++i)
+	{
+		/* -32768 does not fit int16_t when negated */
+		const int32_t value = xyz[i];
+		const uint16_t magnitude = (uint16_t)(value < 0 ? -value : value);
+		if (magnitude > peak) peak = magnitude;
+	}
+	return peak;
+}
+
+/**
+ * @brief Initializes the auto-ranging with the configured ranges
+ * @param[out] state The state
+ * @param[in] gyroscope The gyroscope range
+ * @param[in] accelerometer The accelerometer range
+ */
+void MPU6050_AutorangeInitialize(mpu6050_autorange_t *const state, mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer)
+{
+	state->gyroscope = state->next_gyroscope = gyroscope;
+	state->accelerometer = state->next_accelerometer = accelerometer;
+	state->gyroscope_peak = state->accelerometer_peak = 0;
+	state->samples = 0;
+	state->settle = 0;
+}
+
+/**
+ * @brief Updates the auto-ranging with a sample
+ * @param[inout] state The state
+ * @param[in] sample The raw sample
+ * @return Nonzero if a range switch is requested
+ */
+uint8_t MPU6050_AutorangeUpdate(mpu6050_autorange_t *const state, const mpu6050_sensor_t *const sample)
+{
+	const uint16_t gyroscope = AbsolutePeak(sample->gyro.xyz);
+	const uint16_t accelerometer = AbsolutePeak(sample->accel.xyz);
+
+	if (gyroscope > state->gyroscope_peak) state->gyroscope_peak = gyroscope;
+	if (accelerometer > state->accelerometer_peak) state->accelerometer_peak = accelerometer;
+
+	/* widen right away, the next samples are likely to clip */
+	if (gyroscope >= MPU6050_AUTORANGE_HIGH && state->gyroscope < MPU6050_GYRO_FS_2000)
+	{
+		state->next_gyroscope = (mpu6050_gyro_fs_t)(state->gyroscope + 1);
+	}
+	if (accelerometer >= MPU6050_AUTORANGE_HIGH && state->accelerometer < MPU6050_ACC_FS_16)
+	{
+		state->next_accelerometer = (mpu6050_acc_fs_t)(state->accelerometer + 1);
+	}
+
+	/* narrow only after a whole window fits the lower range */
+	if (++state->samples >= MPU6050_AUTORANGE_WINDOW)
+	{
+		if (state->gyroscope_peak < MPU6050_AUTORANGE_LOW && state->gyroscope > MPU6050_GYRO_FS_250)
+		{
+			state->next_gyroscope = (mpu6050_gyro_fs_t)(state->gyroscope - 1);
+		}
+		if (state->accelerometer_peak < MPU6050_AUTORANGE_LOW && state->accelerometer > MPU6050_ACC_FS_2)
+		{
+			state->next_accelerometer = (mpu6050_acc_fs_t)(state->accelerometer - 1);
+		}
+
+		state->gyroscope_peak = state->accelerometer_peak = 0;
+		state->samples = 0;
+	}
+
+	return (state->next_gyroscope != state->gyroscope) || (state->next_accelerometer != state->accelerometer);
+}
+
+/**
+ * @brief Completes a requested range switch
+ * @param[inout] state The state
+ * @param[in] success Nonzero if the ranges were written to the device; Otherwise, the request is dropped.
+ */
+void MPU6050_AutorangeSwitched(mpu6050_autorange_t *const state, uint8_t success)
+{
+	if (success)
+	{
+		state->gyroscope = state->next_gyroscope;
+		state->accelerometer = state->next_accelerometer;
+		state->settle = MPU6050_AUTORANGE_SETTLE;
+	}
+	else
+	{
+		state->next_gyroscope = state->gyroscope;
+		state->next_accelerometer = state->accelerometer;
+	}
+
+	/* the peaks were taken in the previous range */
+	state->gyroscope_peak = state->accelerometer_peak = 0;
+	state->samples = 0;
+}
+
+/**
+ * @brief Determines if the current read must be discarded after a range switch
+ * @param[inout] state The state
+ * @return Nonzero if the read must be discarded
+ */
+uint8_t MPU6050_AutorangeSettling(mpu6050_autorange_t *const state)
+{
+	if (0 == state->settle) return 0;
+	--state->settle;
+	return 1;
+}
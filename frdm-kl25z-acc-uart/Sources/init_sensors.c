@@ -1,4 +1,5 @@
 #include "comm/io.h"
+#include "cpu/irq.h"
 #include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
 #include "imu/mma8451q.h"
@@ -21,6 +22,38 @@ static union {
 } config_buffer;
 
 
+/**
+* @brief The performance presets, see performance_preset_t
+*
+* The HMC5883L polling period is rounded down, so that no reading is missed.
+*/
+static const performance_preset_config_t performance_presets[PRESET_COUNT] = {
+    [PRESET_LOW_LATENCY] = {
+        .sample_rate_divider = 1, .low_pass = MPU6050_DLPF_188,                     /* 1 kHz / 1 --> 1 kHz */
+        .magnetometer_rate = HMC5883L_DO_75Hz, .magnetometer_period = 1000 / 75,
+        .fifo_period = 10, .hybrid_decimation = 10, .output_period = 10 },
+    [PRESET_BALANCED] = {
+        .sample_rate_divider = 40, .low_pass = MPU6050_DLPF_260,                    /* 8 kHz / 40 --> 200 Hz */
+        .magnetometer_rate = HMC5883L_DO_75Hz, .magnetometer_period = 1000 / 75,
+        .fifo_period = 20, .hybrid_decimation = 10, .output_period = 100 },
+    [PRESET_LOW_POWER] = {
+        .sample_rate_divider = 20, .low_pass = MPU6050_DLPF_42,                     /* 1 kHz / 20 --> 50 Hz */
+        .magnetometer_rate = HMC5883L_DO_15Hz, .magnetometer_period = 1000 / 15,
+        .fifo_period = 80, .hybrid_decimation = 2, .output_period = 200 },
+};
+
+/**
+* @brief The MPU6050 of the virtual IMU, see SetMPU6050Instance()
+*/
+static mpu6050_instance_t mpu6050_instances[MPU6050_COUNT] = {
+    [0] = { .address = MPU6050_I2CADDR, .arbiter_handle = I2CARBITER_INVALID_HANDLE },
+};
+
+/**
+* @brief Gets the scaling value for the MMA8451Q accelerometer
+*/
+static fix16_t mma8451q_accelerometer_scaler = 0;
+
 /**
 * @brief Gets the scaling value for the MPU6050 accelerometer
 */
@@ -42,7 +75,7 @@ static fix16_t hmc5883l_magnetometer_scaler = 0;
 void InitMMA8451Q()
 {
 #if ENABLE_MMA8451Q
-    mpu6050_confreg_t *configuration = &config_buffer.mma8451q_configuration;
+    mma8451q_confreg_t *configuration = &config_buffer.mma8451q_configuration;
 
     IO_SendZString("MMA8451Q: initializing ...\r\n");
 
@@ -54,8 +87,7 @@ void InitMMA8451Q()
     MMA8451Q_INT_GPIO->PDDR &= ~(GPIO_PDDR_PDD(1 << MMA8451Q_INT1_PIN) | GPIO_PDDR_PDD(1 << MMA8451Q_INT2_PIN));
 
     /* prepare interrupts for pin change / PORTA */
-    NVIC_ICPR |= 1 << 30;	/* clear pending flag */
-    NVIC_ISER |= 1 << 30;	/* enable interrupt */
+    IRQ_Enable(PORTA_IRQ);
 
     /* switch to the correct port */
     I2CArbiter_Select(MMA8451Q_I2CADDR);
@@ -80,7 +112,15 @@ void InitMMA8451Q()
     MMA8451Q_SetOversampling(configuration, MMA8451Q_OVERSAMPLING_HIGHRESOLUTION);
     MMA8451Q_ClearInterruptConfiguration(configuration);
     MMA8451Q_SetInterruptMode(configuration, MMA8451Q_INTMODE_OPENDRAIN, MMA8451Q_INTPOL_ACTIVELOW);
+#if MMA8451Q_FIFO_MODE
+    /* keep the most recent samples and signal batches instead of single samples */
+    MMA8451Q_SetFifo(configuration, MMA8451Q_FIFOMODE_CIRCULAR, MMA8451Q_FIFO_WATERMARK);
+    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_FIFO, MMA8451Q_INTPIN_INT2);
+#else
+    MMA8451Q_SetFifo(configuration, MMA8451Q_FIFOMODE_DISABLED, 0);
     MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_DRDY, MMA8451Q_INTPIN_INT2);
+#endif
+    mma8451q_accelerometer_scaler = fix16_from_int(4096);   /* scaler value for 2G in 14bit mode */
 
     MMA8451Q_StoreConfiguration(configuration);
     MMA8451Q_EnterActiveMode();
@@ -90,9 +130,52 @@ void InitMMA8451Q()
 }
 
 /**
-* @brief Sets up the MPU6050 communication
+* @brief Registers an MPU6050 of the virtual IMU
+* @param[in] index The device index in 0 .. MPU6050_COUNT-1
+* @param[in] address The 7-bit slave address
+* @param[in] arbiter_handle The I2C arbiter handle
 */
-void InitMPU6050()
+void SetMPU6050Instance(uint8_t index, uint8_t address, i2carbiter_handle_t arbiter_handle)
+{
+    assert(index < MPU6050_COUNT);
+    mpu6050_instances[index].address = address;
+    mpu6050_instances[index].arbiter_handle = arbiter_handle;
+}
+
+/**
+* @brief Fetches an MPU6050 of the virtual IMU
+* @param[in] index The device index in 0 .. MPU6050_COUNT-1
+* @return The device
+*/
+const mpu6050_instance_t* GetMPU6050Instance(uint8_t index)
+{
+    assert(index < MPU6050_COUNT);
+    return &mpu6050_instances[index];
+}
+
+/**
+* @brief Selects an MPU6050 in the driver and switches to its pins
+* @param[in] index The device index in 0 .. MPU6050_COUNT-1
+*/
+static void SelectMPU6050(uint8_t index)
+{
+    const mpu6050_instance_t *const instance = &mpu6050_instances[index];
+    MPU6050_Select(instance->address, instance->arbiter_handle);
+
+    if (I2CARBITER_INVALID_HANDLE == instance->arbiter_handle)
+    {
+        I2CArbiter_Select(instance->address);
+    }
+    else
+    {
+        I2CArbiter_SelectHandle(instance->arbiter_handle);
+    }
+}
+
+/**
+* @brief Sets up the MPU6050 communication of the selected device
+*/
+static void InitSelectedMPU6050()
 {
     mpu6050_confreg_t *configuration = &config_buffer.mpu6050_configuration;
 
@@ -105,9 +188,6 @@ void InitMPU6050()
     * Power up, wait for some seconds, then reset.
     */
 
-    /* switch to the correct port */
-    I2CArbiter_Select(MPU6050_I2CADDR);
-
     /* perform identity check */
     uint8_t value = MPU6050_WhoAmI();
     assert(value == 0x68);
@@ -122,31 +202,49 @@ void InitMPU6050()
 
     /* read configuration and modify */
     MPU6050_FetchConfiguration(configuration);
-#if DEBUG
-    MPU6050_SetGyroscopeSampleRateDivider(configuration, 80); /* the gyro samples at 8kHz, so division by 40 --> 200Hz */
-#else
-    MPU6050_SetGyroscopeSampleRateDivider(configuration, 40); /* the gyro samples at 8kHz, so division by 40 --> 200Hz */
-#endif
+    MPU6050_SetGyroscopeSampleRateDivider(configuration, performance_presets[PERFORMANCE_PRESET_DEFAULT].sample_rate_divider);
+    MPU6050_SetDigitalLowPass(configuration, performance_presets[PERFORMANCE_PRESET_DEFAULT].low_pass);
     
-    MPU6050_SetGyroscopeFullScale(configuration, MPU6050_GYRO_FS_2000);
-    mpu6050_gyroscope_scaler = fix16_from_float(MPU6050_GYRO_LSB(MPU6050_GYRO_FS_2000));
+    MPU6050_SetGyroscopeFullScale(configuration, MPU6050_GYROSCOPE_FULL_SCALE);
+    mpu6050_gyroscope_scaler = fix16_from_float(MPU6050_GYRO_LSB(MPU6050_GYROSCOPE_FULL_SCALE));
 
-    MPU6050_SetAccelerometerFullScale(configuration, MPU6050_ACC_FS_4);
-    mpu6050_accelerometer_scaler = fix16_from_int(8192);    /* scaler value for ACC_FS_4*/
+    MPU6050_SetAccelerometerFullScale(configuration, MPU6050_ACCELEROMETER_FULL_SCALE);
+    mpu6050_accelerometer_scaler = fix16_from_int(MPU6050_ACC_LSB(MPU6050_ACCELEROMETER_FULL_SCALE));
 
     MPU6050_ConfigureInterrupts(configuration,
         MPU6050_INTLEVEL_ACTIVELOW,
         MPU6050_INTOPEN_OPENDRAIN,
         MPU6050_INTLATCH_LATCHED, /* if configured to PULSE the line goes postal */
         MPU6050_INTRDCLEAR_READSTATUS);
+#if MPU6050_FIFO_MODE
+    MPU6050_EnableInterrupts(configuration,
+        MPU6050_INT_DISABLED,
+        MPU6050_INT_DISABLED,
+        MPU6050_INT_DISABLED); /* the FIFO is drained periodically */
+    MPU6050_SelectFifoSources(configuration,
+        MPU6050_INT_DISABLED,
+        MPU6050_INT_ENABLED,
+        MPU6050_INT_ENABLED); /* accelerometer and gyroscope, 12 byte frames */
+    MPU6050_EnableFifo(configuration, MPU6050_INT_ENABLED);
+#else
     MPU6050_EnableInterrupts(configuration,
         MPU6050_INT_DISABLED,
         MPU6050_INT_DISABLED,
         MPU6050_INT_ENABLED); /* enable data ready interrupt */
+#endif
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+    /* connect the auxiliary bus to the host so that the HMC5883L can be configured */
+    MPU6050_SetAuxiliaryBypass(configuration, MPU6050_INT_ENABLED);
+#endif
     MPU6050_SelectClockSource(configuration, MPU6050_CLOCK_XGYROPLL);
     MPU6050_SetSleepMode(configuration, MPU6050_SLEEP_DISABLED);
     MPU6050_StoreConfiguration(configuration);
 
+#if MPU6050_FIFO_MODE
+    /* start with a clean FIFO */
+    MPU6050_ResetFifo();
+#endif
+
     /* configure interrupts for MPU6050 */
     /* INT is on PTA13 */
     SIM->SCGC5 |= (1 << SIM_SCGC5_PORTA_SHIFT) & SIM_SCGC5_PORTA_MASK; /* power to the masses */
@@ -154,12 +252,26 @@ void InitMPU6050()
     MPU6050_INT_GPIO->PDDR &= ~(GPIO_PDDR_PDD(1 << MPU6050_INT_PIN));
 
     /* prepare interrupts for pin change / PORTA */
-    NVIC_ICPR |= 1 << 30;	/* clear pending flag */
-    NVIC_ISER |= 1 << 30;	/* enable interrupt */
+    IRQ_Enable(PORTA_IRQ);
 
     IO_SendZString("MPU6050: configuration done.\r\n");
 }
 
+/**
+* @brief Sets up the MPU6050 communication of all devices
+*
+* The redundant devices raise data ready as well; Their open drain INT lines may stay
+* unconnected or be wired to that of device zero, since all are read on its interrupt.
+*/
+void InitMPU6050()
+{
+    for (uint8_t index = MPU6050_COUNT; index-- > 0;)
+    {
+        SelectMPU6050(index);
+        InitSelectedMPU6050();
+    }
+}
+
 /**
 * @brief Sets up the HMC5883L communication
 */
@@ -176,7 +288,7 @@ void InitHMC5883L()
     /* read configuration and modify */
     HMC5883L_FetchConfiguration(configuration);
     HMC5883L_SetAveraging(configuration, HMC5883L_MA_1);
-    HMC5883L_SetOutputRate(configuration, HMC5883L_DO_75Hz);
+    HMC5883L_SetOutputRate(configuration, performance_presets[PERFORMANCE_PRESET_DEFAULT].magnetometer_rate);
     HMC5883L_SetMeasurementMode(configuration, HMC5883L_MS_NORMAL);
     
     HMC5883L_SetGain(configuration, HMC5883L_GN_1090_1p3Ga);
@@ -185,9 +297,111 @@ void InitHMC5883L()
     HMC5883L_SetOperatingMode(configuration, HMC5883L_MD_CONT);
     HMC5883L_StoreConfiguration(configuration);
 
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_DRDY
+    /* configure interrupts for HMC5883L */
+    /* DRDY is internally pulled high and pulses low for 250us when data is ready */
+    SIM->SCGC5 |= (1 << SIM_SCGC5_PORTA_SHIFT) & SIM_SCGC5_PORTA_MASK; /* power to the masses */
+    HMC5883L_INT_PORT->PCR[HMC5883L_INT_PIN] = PORT_PCR_ISF_MASK | PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge */
+    HMC5883L_INT_GPIO->PDDR &= ~(GPIO_PDDR_PDD(1 << HMC5883L_INT_PIN));
+
+    /* prepare interrupts for pin change / PORTA */
+    IRQ_Enable(PORTA_IRQ);
+#endif
+
     IO_SendZString("HMC5883L: configuration done.\r\n");
 }
 
+/**
+* @brief Hands the HMC5883L over to the MPU6050 auxiliary I2C master
+*/
+void InitMPU6050Slaves()
+{
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+    mpu6050_confreg_t *configuration = &config_buffer.mpu6050_configuration;
+    IO_SendZString("MPU6050: slaving HMC5883L ...\r\n");
+
+    /* the HMC5883L hangs off the auxiliary bus of device zero */
+    SelectMPU6050(0);
+    MPU6050_FetchConfiguration(configuration);
+
+    /* the status register of the HMC5883L ends up in EXT_SENS_DATA_00, the data output registers in 01 .. 06;
+     * the slaves are read in order, so the status tells if the data read right after is a new sample */
+    MPU6050_SetAuxiliaryBypass(configuration, MPU6050_INT_DISABLED);
+    MPU6050_ConfigureSlaveRead(configuration, 0, HMC5883L_I2CADDR, HMC5883L_REG_SR, 1);
+    MPU6050_ConfigureSlaveRead(configuration, 1, HMC5883L_I2CADDR, HMC5883L_REG_DXRA, HMC5883L_DATA_REGISTER_COUNT);
+    MPU6050_ConfigureI2CMaster(configuration,
+        MPU6050_INT_ENABLED,
+        MPU6050_INT_ENABLED, /* raise data ready only after the magnetometer data arrived */
+        MPU6050_I2CMST_CLK_400KHZ);
+    MPU6050_StoreConfiguration(configuration);
+
+    IO_SendZString("MPU6050: slaving done.\r\n");
+#endif
+}
+
+/**
+* @brief Fetches the settings of a performance preset
+* @param[in] preset The preset
+* @return The settings or NULL if the preset is invalid
+*/
+const performance_preset_config_t* GetPerformancePreset(performance_preset_t preset)
+{
+    if ((unsigned)preset >= PRESET_COUNT) return NULL;
+    return &performance_presets[preset];
+}
+
+/**
+* @brief Switches the MPU6050 sample rate and low pass filter and the HMC5883L output rate of a preset
+* @param[in] preset The preset settings
+* @return Zero on success, the I2C error flags otherwise
+*/
+uint8_t SetSensorPreset(const performance_preset_config_t *const preset)
+{
+    /* device zero last, so that it stays selected */
+    uint8_t error = 0;
+    for (uint8_t index = MPU6050_COUNT; index-- > 0;)
+    {
+        SelectMPU6050(index);
+        MPU6050_WriteSampleRate(preset->sample_rate_divider, preset->low_pass);
+        error |= I2C_FetchError();
+    }
+    if (error) return error;
+
+#if HMC5883L_FETCH_MODE != HMC5883L_FETCH_AUX
+    I2CArbiter_Select(HMC5883L_I2CADDR);
+    HMC5883L_WriteOutputRate(preset->magnetometer_rate);
+    error = I2C_FetchError();
+#endif
+
+    return error;
+}
+
+/**
+* @brief Switches the MPU6050 full scale ranges along with their scaling values
+* @param[in] gyroscope The gyroscope range
+* @param[in] accelerometer The accelerometer range
+* @return Zero on success; Otherwise, the I2C error flags and the scaling values are unchanged.
+*/
+uint8_t SetMPU6050FullScale(mpu6050_gyro_fs_t gyroscope, mpu6050_acc_fs_t accelerometer)
+{
+    MPU6050_WriteFullScale(gyroscope, accelerometer);
+
+    const uint8_t error = I2C_FetchError();
+    if (error) return error;
+
+    mpu6050_gyroscope_scaler = fix16_from_float(MPU6050_GYRO_LSB(gyroscope));
+    mpu6050_accelerometer_scaler = fix16_from_int(MPU6050_ACC_LSB(accelerometer));
+    return 0;
+}
+
+/**
+* @brief Gets the scaling value for the MMA8451Q accelerometer
+*/
+fix16_t mma8451q_accelerometer_get_scaler()
+{
+    return mma8451q_accelerometer_scaler;
+}
+
 /**
 * @brief Gets the scaling value for the MPU6050 accelerometer
 */
@@ -4,16 +4,23 @@
  */
 
 /*!
-* \def DATA_FUSE_MODE Set to the <code>1</code> to enable raw sensor data transmission or disable with <code>0</code> to enable data fusion
+* \def RUN_MODE_DEFAULT The run mode after reset (see {\ref run_mode_t}); Switched at runtime over the serial line
 */
-#define DATA_FETCH_MODE 0
+#define RUN_MODE_DEFAULT RUN_FUSE
 
 /*!
-* \def DATA_FUSE_MODE Set to the opposite of {\ref DATA_FETCH_MODE} and enables sensor fusion
+* \def RUN_FUSE_FETCH_DECIMATION In the combined run mode, only every n-th MPU6050 fetch is transmitted raw
 */
-#define DATA_FUSE_MODE (!DATA_FETCH_MODE)
+#define RUN_FUSE_FETCH_DECIMATION 10
 
-#if 1
+/*!
+* \def DATA_FETCH_CAPTURE Set to <code>1</code> to transmit raw sensor data as capture frames (see capture_frame.h) or <code>0</code> to send one frame per sensor
+*/
+#define DATA_FETCH_CAPTURE 1
+
+#if !BENCHMARK_FIRMWARE
+
+#include <string.h>
 
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
@@ -21,51 +28,173 @@
 
 #include "cpu/clock.h"
 #include "cpu/systick.h"
+#include "cpu/timebase.h"
 #include "cpu/delay.h"
+#include "cpu/events.h"
+#include "cpu/governor.h"
+#include "cpu/profile.h"
+#include "cpu/instrument.h"
+#include "cpu/ramfunc.h"
 #include "comm/uart.h"
 #include "comm/buffer.h"
 #include "comm/io.h"
 #include "comm/p2pprotocol.h"
+#include "comm/command.h"
 
 #include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
+#include "i2c/i2casync.h"
 #include "imu/mma8451q.h"
 #include "imu/mpu6050.h"
+#include "imu/mpu6050_autorange.h"
+#include "imu/acquisition.h"
+#include "imu/sensor_sample.h"
 #include "imu/hmc5883l.h"
 #include "led/led.h"
 
 #include "fusion/sensor_prepare.h"
 #include "fusion/sensor_fusion.h"
+#include "fusion/gyro_bias.h"
+#include "fusion/sensor_calibration.h"
+#include "fusion/parameter_store.h"
+#include "fusion/mag_calibration.h"
+#include "fusion/output_encoding.h"
+#include "fusion/warm_restart.h"
 
 #include "init_sensors.h"
 #include "nice_names.h"
 #include "output_mode.h"
+#include "capture_frame.h"
 
-#define UART_RX_BUFFER_SIZE	(16)				        /*! Size of the UART RX buffer in byte*/
+#define UART_RX_BUFFER_SIZE	(128)				        /*! Size of the UART RX buffer in byte; Holds the bytes received between two polls */
 #define UART_TX_BUFFER_SIZE	(64)				        /*! Size of the UART TX buffer in byte */
-static uint8_t uartInputData[UART_RX_BUFFER_SIZE]  __attribute__((aligned(4))), 	    /*! The UART RX buffer */
+static uint8_t uartInputData[UART_RX_BUFFER_SIZE]  __attribute__((aligned(UART_RX_BUFFER_SIZE))), /*! The UART RX buffer; Aligned for the circular receive DMA */
                uartOutputData[UART_TX_BUFFER_SIZE]  __attribute__((aligned(4)));	/*! The UART TX buffer */
 static buffer_t uartInputFifo, 						    /*! The UART RX buffer driver */
 		        uartOutputFifo;							/*! The UART TX buffer driver */
 
-#define I2CARBITER_COUNT 	(3)					/*< Number of I2C devices we're talking to */
+#if MPU6050_COUNT > 3
+#error Up to three MPU6050 are supported, see InitI2CArbiter()
+#endif
+
+#if MPU6050_COUNT > 1 && (MPU6050_FIFO_MODE || MPU6050_AUTORANGE)
+#error Redundant MPU6050 are read on the data ready interrupt, with the ranges configured at boot
+#endif
+
+#if MPU6050_COUNT + 1 > I2CASYNC_QUEUE_SIZE
+#error The reads of all MPU6050 and the HMC5883L must fit the I2C transaction queue
+#endif
+
+#if MPU6050_ISR_ACQUISITION && (MPU6050_FIFO_MODE || MPU6050_COUNT > 1)
+#error The interrupt driven acquisition reads a single MPU6050 on its data ready interrupt
+#endif
+
+/*!
+* \def MPU6050_BATCHED Nonzero if the MPU6050 samples of an iteration arrive in a batch, from the FIFO or the acquisition queue
+*/
+#define MPU6050_BATCHED (MPU6050_FIFO_MODE || MPU6050_ISR_ACQUISITION)
+
+#define I2CARBITER_COUNT 	(2 + MPU6050_COUNT)	/*< Number of I2C devices we're talking to */
 i2carbiter_entry_t i2carbiter_entries[I2CARBITER_COUNT]; /*< Structure for the pin enabling/disabling manager */
+static i2carbiter_handle_t mma8451q_arbiter_handle,	/*< The I2C arbiter handle of the MMA8451Q */
+                           mpu6050_arbiter_handle,	/*< The I2C arbiter handle of the MPU6050 */
+                           hmc5883l_arbiter_handle;	/*< The I2C arbiter handle of the HMC5883L */
 
 /**
- * @brief Indicates that polling the MMA8451Q is required
+ * @brief I2C fault counters of a device, indexed by {@see i2carbiter_handle_t}
  */
-static volatile uint8_t poll_mma8451q = 1;
+static struct {
+    uint16_t errors;                                /*< Failed or timed out transfers */
+    uint16_t retries;                               /*< Transfers repeated after a bus recovery */
+    uint32_t transactions;                          /*< Asynchronous reads waited for, including the repeated ones */
+} i2c_statistics[I2CARBITER_COUNT];
 
 /**
- * @brief Indicates that polling the MPU6050 is required
+ * @brief Timebase value latched when the MPU6050 signalled data ready
  */
-static volatile uint8_t poll_mpu6050 = 1;
+static volatile uint32_t mpu6050_timestamp = 0;
 
 /*!
 *  \brief The output mode
 */
 static output_mode_t output_mode = QUATERNION_RPY;
 
+/*!
+*  \brief The run mode
+*/
+static run_mode_t run_mode = RUN_MODE_DEFAULT;
+
+/*!
+*  \brief The requested period of the fused output in milliseconds
+*/
+static uint16_t output_period = 100;
+
+/*!
+*  \brief The period of the fused output the UART can sustain, at least {\ref output_period}
+*/
+static uint16_t output_effective_period = 100;
+
+/*!
+*  \brief The timing options of the fused output, see {\ref output_timing_t}
+*/
+static uint8_t output_timing = 0;
+
+/*!
+*  \brief The airtime of a fused output frame in microseconds; The latency {\ref OUTPUT_TIMING_EXTRAPOLATE} adds to the state age.
+*/
+static uint32_t output_airtime = 0;
+
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_TIMER
+/*!
+*  \brief The HMC5883L polling period in milliseconds, see {\ref performance_preset_config_t}
+*/
+static uint32_t hmc5883l_read_period = 1000 / 75;
+#endif
+
+#if MPU6050_FIFO_MODE
+/*!
+*  \brief The MPU6050 FIFO drain period in milliseconds, see {\ref performance_preset_config_t}
+*/
+static uint32_t mpu6050_fifo_period = 20;
+#endif
+
+/*!
+*  \brief The baud rate to switch to once the acknowledge of {\ref COMMAND_SET_BAUD_RATE} was sent
+*/
+static uart0_baud_t pending_baud;
+
+/*!
+*  \brief Nonzero if {\ref pending_baud} is to be applied
+*/
+static uint8_t baud_change_pending = 0;
+
+/*!
+*  \brief The encoder state of the {\ref QUATERNION_DELTA} output mode
+*/
+static output_delta_t output_delta;
+
+#if MPU6050_AUTORANGE
+/*!
+*  \brief The full scale auto-ranging state of the MPU6050
+*/
+static mpu6050_autorange_t mpu6050_autorange;
+#endif
+
+/*!
+*  \brief The number of fused output frames skipped because the transmitter was still busy
+*/
+static uint16_t output_dropped = 0;
+
+/*!
+*  \brief Enables or disables the fused and raw sensor data output
+*/
+static uint8_t streaming = 1;
+
+/*!
+*  \brief Requests a restart of the fusion after it had been suspended
+*/
+static uint8_t fusion_restart = 0;
+
 /************************************************************************/
 /* Interrupt handlers                                                   */
 /************************************************************************/
@@ -73,16 +202,18 @@ static output_mode_t output_mode = QUATERNION_RPY;
 /**
  * @brief Handler for interrupts on port A
  */
-void PORTA_Handler()
+RAMFUNC void PORTA_Handler()
 {
+    INSTRUMENT_ISR(INSTRUMENT_ISR_PORTA);
+
 #if ENABLE_MMA8451Q	
     register uint32_t isfr_mma = MMA8451Q_INT_PORT->ISFR;
 
 	/* check MMA8451Q */
     register uint32_t fromMMA8451Q 	= (isfr_mma & ((1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN)));
-	if (fromMMA8451Q || fromMPU6050)
+	if (fromMMA8451Q)
 	{
-		poll_mma8451q = 1;
+		Events_Signal(EVENT_MMA8451Q);
 		LED_RedOn();
 		
 		/* clear interrupts using BME decorated logical OR store 
@@ -97,7 +228,13 @@ void PORTA_Handler()
     register uint32_t fromMPU6050 = (isfr_mpu & (1 << MPU6050_INT_PIN));
 	if (fromMPU6050)
 	{
-		poll_mpu6050 = 1;
+#if MPU6050_ISR_ACQUISITION
+		/* the read starts right away; its completion queues the sample */
+		Acquisition_MPU6050Ready(Timebase_Microseconds());
+#else
+		mpu6050_timestamp = Timebase_Microseconds();
+		Events_Signal(EVENT_MPU6050);
+#endif
 		LED_BlueOn();
 		
 		/* clear interrupts using BME decorated logical OR store 
@@ -105,6 +242,24 @@ void PORTA_Handler()
 		 */
 		BME_OR_W(&MMA8451Q_INT_PORT->ISFR, (1 << MPU6050_INT_PIN));
 	}
+
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_DRDY
+	/* check HMC5883L */
+    register uint32_t fromHMC5883L = (isfr_mpu & (1 << HMC5883L_INT_PIN));
+	if (fromHMC5883L)
+	{
+#if MPU6050_ISR_ACQUISITION
+		Acquisition_ReadHMC5883L(Timebase_Microseconds());
+#else
+		Events_Signal(EVENT_HMC5883L);
+#endif
+		
+		/* clear interrupts using BME decorated logical OR store 
+		 * PORTA->ISFR |= (1 << HMC5883L_INT_PIN); 
+		 */
+		BME_OR_W(&HMC5883L_INT_PORT->ISFR, (1 << HMC5883L_INT_PIN));
+	}
+#endif
 }
 
 /************************************************************************/
@@ -124,15 +279,119 @@ void InitI2CArbiter()
     I2CArbiter_PrepareEntry(&i2carbiter_entries[0], MMA8451Q_I2CADDR, PORTE, 24, 5, 25, 5);
     I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, PORTB, 0, 2, 1, 2);
     I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, PORTB, 0, 2, 1, 2);
+#if MPU6050_COUNT > 1
+    /* a redundant MPU6050 on the same pins, with AD0 at the other level */
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[3], MPU6050_I2CADDR_ALT, PORTB, 0, 2, 1, 2);
+#endif
+#if MPU6050_COUNT > 2
+    /* another one on the pins of the MMA8451Q, reusing the default address */
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[4], MPU6050_I2CADDR, PORTE, 24, 5, 25, 5);
+#endif
     I2CArbiter_Configure(i2carbiter_entries, I2CARBITER_COUNT);
+
+    /* the MPU6050 of the virtual IMU; Handles are the entry indices */
+    SetMPU6050Instance(0, MPU6050_I2CADDR, 1);
+#if MPU6050_COUNT > 1
+    SetMPU6050Instance(1, MPU6050_I2CADDR_ALT, 3);
+#endif
+#if MPU6050_COUNT > 2
+    SetMPU6050Instance(2, MPU6050_I2CADDR, 4);
+#endif
+
+    /* resolve the handles once, so that switching in the main loop needs no lookup */
+    mma8451q_arbiter_handle = I2CArbiter_Lookup(MMA8451Q_I2CADDR);
+    mpu6050_arbiter_handle = I2CArbiter_Lookup(MPU6050_I2CADDR);
+    hmc5883l_arbiter_handle = I2CArbiter_Lookup(HMC5883L_I2CADDR);
+}
+
+/**
+ * @brief Waits for the background reads before blocking I2C functions are used
+ *
+ * With the interrupt driven acquisition, its reads are held back until {@see ResumeI2C()}.
+ */
+static void SuspendI2C()
+{
+#if MPU6050_ISR_ACQUISITION
+    Acquisition_Suspend();
+#else
+    I2CAsync_WaitWhileBusy();
+#endif
+}
+
+/**
+ * @brief Lets the background reads continue after {@see SuspendI2C()}
+ */
+static void ResumeI2C()
+{
+#if MPU6050_ISR_ACQUISITION
+    Acquisition_Resume();
+#endif
+}
+
+/**
+ * @brief Recovers the bus after a failed transfer
+ * @param[in] handle The I2C arbiter handle of the device that failed
+ *
+ * Aborts the asynchronous engine, clocks SDA free and counts the error and the retry
+ * the caller is about to make. Takes about 100 us.
+ */
+static void RecoverI2C(i2carbiter_handle_t handle)
+{
+    ++i2c_statistics[handle].errors;
+    ++i2c_statistics[handle].retries;
+
+#if MPU6050_ISR_ACQUISITION
+    /* no read may start while the bus is clocked free */
+    Acquisition_Suspend();
+#endif
+    I2CAsync_Abort();
+    I2CArbiter_SelectHandle(handle);
+    I2CArbiter_ResetBus();
+#if MPU6050_ISR_ACQUISITION
+    Acquisition_Resume();
+#endif
+}
+
+/**
+ * @brief Waits for an asynchronous read and repeats it once after recovering the bus if it failed
+ * @param[in] transaction The transaction
+ * @return The transaction status
+ *
+ * Transactions that were only aborted because another one failed are resubmitted without another recovery.
+ */
+static uint8_t WaitForI2C(i2casync_transaction_t *const transaction)
+{
+    ++i2c_statistics[transaction->arbiterHandle].transactions;
+
+    uint8_t status = I2CAsync_WaitFor(transaction);
+    if (I2CASYNC_SUCCESS == status) return status;
+
+    if (I2CASYNC_ABORTED != status)
+    {
+        RecoverI2C(transaction->arbiterHandle);
+    }
+    else
+    {
+        ++i2c_statistics[transaction->arbiterHandle].retries;
+    }
+
+    if (I2CASYNC_SUCCESS == I2CAsync_Submit(transaction))
+    {
+        ++i2c_statistics[transaction->arbiterHandle].transactions;
+        status = I2CAsync_WaitFor(transaction);
+    }
+
+    if (I2CASYNC_SUCCESS != status)
+    {
+        ++i2c_statistics[transaction->arbiterHandle].errors;
+    }
+    return status;
 }
 
 /************************************************************************/
 /* Signaling of fusion process                                          */
 /************************************************************************/
 
-#if DATA_FUSE_MODE
-
 /**
 * @brief Sets up the GPIOs for fusion signaling
 */
@@ -175,7 +434,741 @@ STATIC_INLINE void FusionSignal_Clear()
     GPIOB->PCOR = (1 << 8) | (1 << 9);
 }
 
-#endif // #if DATA_FUSE_MODE
+/************************************************************************/
+/* Redundant MPU6050                                                    */
+/************************************************************************/
+
+#if MPU6050_COUNT > 1
+
+/**
+* @brief The read state of a redundant MPU6050
+*/
+typedef struct {
+    i2casync_transaction_t transaction;     /*< The asynchronous read */
+    mpu6050_intdatareg_t raw;               /*< The raw register buffer */
+    mpu6050_sensor_t sample;                /*< The latest sample */
+    uint8_t fresh;                          /*< Nonzero if the data ready flag of the latest read reported a new sample */
+} mpu6050_redundant_t;
+
+/**
+* @brief The redundant MPU6050, devices 1 .. MPU6050_COUNT-1
+*/
+static mpu6050_redundant_t mpu6050_redundant[MPU6050_COUNT - 1];
+
+/**
+* @brief The redundant MPU6050 read first, advanced round-robin with every read
+*/
+static uint8_t mpu6050_redundant_first = 0;
+
+/**
+* @brief Queues the reads of the redundant MPU6050 behind that of the first one
+*
+* All are read on the data ready interrupt of the first device; The order rotates, so
+* that the delay between the sampling and the read is spread evenly over the devices.
+*/
+static void QueueRedundantMPU6050()
+{
+    for (uint8_t i = 0; i < MPU6050_COUNT - 1; ++i)
+    {
+        const uint8_t index = (uint8_t)((mpu6050_redundant_first + i) % (MPU6050_COUNT - 1));
+        mpu6050_redundant_t *const device = &mpu6050_redundant[index];
+        const mpu6050_instance_t *const instance = GetMPU6050Instance(index + 1);
+
+        MPU6050_ReadDataAsyncFrom(&device->transaction, &device->raw, instance->address, instance->arbiter_handle);
+    }
+}
+
+/**
+* @brief Waits for the reads of the redundant MPU6050 and checks their data ready flags
+*
+* Devices whose read failed or that reported no new sample contribute nothing to this sample.
+*/
+static void CollectRedundantMPU6050()
+{
+    for (uint8_t i = 0; i < MPU6050_COUNT - 1; ++i)
+    {
+        const uint8_t index = (uint8_t)((mpu6050_redundant_first + i) % (MPU6050_COUNT - 1));
+        mpu6050_redundant_t *const device = &mpu6050_redundant[index];
+
+        device->fresh = 0;
+        if (I2CASYNC_SUCCESS != WaitForI2C(&device->transaction)) continue;
+
+        /* the read clears the latched flag, so it is only set for a sample not read before */
+        MPU6050_DecodeData(&device->raw, &device->sample);
+        device->fresh = (device->sample.status != 0);
+    }
+
+    mpu6050_redundant_first = (uint8_t)((mpu6050_redundant_first + 1) % (MPU6050_COUNT - 1));
+}
+
+/**
+* @brief Averages the prepared gyroscope data of the first MPU6050 with the fresh samples of the redundant ones
+* @param[inout] gyro The prepared data of the first device; Overwritten with the average.
+*/
+static void AverageRedundantGyroscope(v3d *const gyro)
+{
+    uint_fast8_t count = 1;
+    for (uint_fast8_t i = 0; i < MPU6050_COUNT - 1; ++i)
+    {
+        const mpu6050_redundant_t *const device = &mpu6050_redundant[i];
+        if (!device->fresh) continue;
+
+        v3d sample;
+        sensor_prepare_redundant_mpu6050_gyroscope_data(i + 1, &sample, device->sample.gyro.x, device->sample.gyro.y, device->sample.gyro.z);
+        v3d_add(gyro, gyro, &sample);
+        ++count;
+    }
+    sensor_prepare_average(gyro, count);
+}
+
+/**
+* @brief Averages the prepared accelerometer data of the first MPU6050 with the fresh samples of the redundant ones
+* @param[inout] acc The prepared data of the first device; Overwritten with the average.
+*/
+static void AverageRedundantAccelerometer(v3d *const acc)
+{
+    uint_fast8_t count = 1;
+    for (uint_fast8_t i = 0; i < MPU6050_COUNT - 1; ++i)
+    {
+        const mpu6050_redundant_t *const device = &mpu6050_redundant[i];
+        if (!device->fresh) continue;
+
+        v3d sample;
+        sensor_prepare_redundant_mpu6050_accelerometer_data(i + 1, &sample, device->sample.accel.x, device->sample.accel.y, device->sample.accel.z);
+        v3d_add(acc, acc, &sample);
+        ++count;
+    }
+    sensor_prepare_average(acc, count);
+}
+
+#endif // MPU6050_COUNT > 1
+
+/************************************************************************/
+/* Raw sensor data capture                                              */
+/************************************************************************/
+
+#if DATA_FETCH_CAPTURE
+
+/**
+* @brief Sequence number of the next captured MPU6050 sample
+*/
+static uint16_t capture_sequence = 0;
+
+/**
+* @brief Sends a batch of MPU6050 samples along with the latest HMC5883L sample as capture frames
+* @param[in] samples The MPU6050 samples, oldest first
+* @param[in] count The number of samples; Batches larger than {\ref CAPTURE_MAX_SAMPLES} are split over multiple frames.
+* @param[in] compass The latest HMC5883L sample
+* @param[in] compass_fresh Nonzero if the HMC5883L sample was read since the previous frame
+* @param[in] timestamp Timebase microseconds of the last sample of the batch
+*/
+static void Capture_SendFrames(const mpu6050_sensor_t *samples, size_t count, const hmc5883l_data_t *const compass, uint8_t compass_fresh, uint32_t timestamp)
+{
+    static const uint8_t type = CAPTURE_FRAME_TYPE;
+    capture_frame_t frame;
+
+    frame.timestamp = timestamp;
+    frame.compass[0] = compass->x;
+    frame.compass[1] = compass->y;
+    frame.compass[2] = compass->z;
+
+    do
+    {
+        const uint8_t chunk = (count > CAPTURE_MAX_SAMPLES) ? CAPTURE_MAX_SAMPLES : (uint8_t)count;
+
+        frame.sequence = capture_sequence;
+        frame.count = chunk;
+        frame.flags = compass_fresh ? CAPTURE_FLAG_COMPASS_FRESH : 0;
+
+        for (uint8_t i = 0; i < chunk; ++i)
+        {
+            frame.samples[i].accel[0] = samples[i].accel.x;
+            frame.samples[i].accel[1] = samples[i].accel.y;
+            frame.samples[i].accel[2] = samples[i].accel.z;
+            frame.samples[i].gyro[0] = samples[i].gyro.x;
+            frame.samples[i].gyro[1] = samples[i].gyro.y;
+            frame.samples[i].gyro[2] = samples[i].gyro.z;
+        }
+
+        IO_SubmitFrame(&type, 1, (const uint8_t*)&frame, CAPTURE_FRAME_SIZE(chunk));
+
+        capture_sequence += chunk;
+
+        /* the compass sample is only flagged fresh in the first frame of a batch */
+        compass_fresh = 0;
+        samples += chunk;
+        count -= chunk;
+    } while (count > 0);
+}
+
+#endif // DATA_FETCH_CAPTURE
+
+/************************************************************************/
+/* Output rate limiting                                                 */
+/************************************************************************/
+
+/*!
+* \brief Determines the payload length of a fused output frame
+* \param[in] mode The output mode
+* \return The payload length in byte, including the type and the times of {\ref OUTPUT_TIMING_STAMP} and {\ref OUTPUT_TIMING_LATENCY}
+*/
+static uint8_t OutputPayloadLength(output_mode_t mode)
+{
+    uint8_t payload;
+    switch (mode)
+    {
+        case RPY:                   payload = 3 * sizeof(fix16_t); break;
+        case QUATERNION:            payload = 4 * sizeof(fix16_t); break;
+        case QUATERNION_RPY:        payload = 7 * sizeof(fix16_t); break;
+        case QUATERNION_COMPACT:    payload = OUTPUT_SMALLEST_THREE_SIZE; break;
+        case RPY_COMPACT:           payload = 3 * sizeof(int16_t); break;
+        case QUATERNION_DELTA:      payload = 1 + 4 * sizeof(int8_t); break; /* the occasional key frame is four bytes longer */
+        case RATES_ACCELERATION:    payload = 6 * sizeof(fix16_t); break;
+        case QUATERNION_RATES_ACCELERATION: payload = 10 * sizeof(fix16_t); break;
+        case SENSORS_RAW:
+        default:                    payload = 6 * sizeof(fix16_t); break;
+    }
+
+    if (output_timing & OUTPUT_TIMING_STAMP) payload += sizeof(uint32_t);
+    if (output_timing & OUTPUT_TIMING_LATENCY) payload += sizeof(uint32_t);
+    return 1 + payload;
+}
+
+/*!
+* \brief Determines the airtime of a fused output frame in microseconds
+* \param[in] mode The output mode
+* \return The time it takes to send one frame in the current framing at the current baud rate, rounded up
+*
+* Escaped P2PPE bytes are not accounted for; Frames that do not fit the remaining
+* bandwidth are dropped when they are due.
+*/
+static uint32_t OutputFrameTime(output_mode_t mode)
+{
+    const uint32_t bits = UART0_BITS_PER_BYTE * IO_FrameLength(OutputPayloadLength(mode));
+    const uint32_t baud_rate = Uart0_BaudRate();
+    return (bits * 1000000u + baud_rate - 1) / baud_rate;
+}
+
+/*!
+* \brief Submits a fused output frame, followed by the state time if {\ref OUTPUT_TIMING_STAMP} is set
+*        and the latch-to-transmit delay if {\ref OUTPUT_TIMING_LATENCY} is set
+* \param[in] type The frame type
+* \param[in] data The payload
+* \param[in] length The payload length in byte
+* \param[in] state_time The time of the fused state, see {\ref fusion_get_state_time()}
+*
+* The delay is taken right before the frame is queued, so the host adds the airtime
+* of the frame to obtain the delay to its reception.
+*/
+static void SubmitOutputFrame(uint8_t type, const void *data, uint8_t length, uint32_t state_time)
+{
+    if (0 == (output_timing & (OUTPUT_TIMING_STAMP | OUTPUT_TIMING_LATENCY)))
+    {
+        IO_SubmitFrame(&type, 1, (const uint8_t*)data, length);
+        return;
+    }
+
+    /* the longest fused payload is that of QUATERNION_RATES_ACCELERATION */
+    uint8_t payload[10 * sizeof(fix16_t) + 2 * sizeof(uint32_t)];
+    memcpy(payload, data, length);
+    if (output_timing & OUTPUT_TIMING_STAMP)
+    {
+        memcpy(&payload[length], &state_time, sizeof(uint32_t));
+        length += sizeof(uint32_t);
+    }
+    if (output_timing & OUTPUT_TIMING_LATENCY)
+    {
+        const uint32_t delay = Timebase_Microseconds() - state_time;
+        memcpy(&payload[length], &delay, sizeof(uint32_t));
+        length += sizeof(uint32_t);
+    }
+    IO_SubmitFrame(&type, 1, payload, length);
+}
+
+/*!
+* \brief Fetches the orientation quaternion of a fused output frame
+* \param[out] orientation The orientation quaternion
+* \param[in] state_time The time of the fused state, see {\ref fusion_get_state_time()}
+*
+* With {\ref OUTPUT_TIMING_EXTRAPOLATE}, the frame is about to be submitted to the idle transmitter,
+* so that it is complete after the state age plus the frame airtime.
+*/
+static void FetchOutputQuaternion(qf16 *const orientation, uint32_t state_time)
+{
+    if (0 == (output_timing & OUTPUT_TIMING_EXTRAPOLATE))
+    {
+        fusion_fetch_quaternion(orientation);
+        return;
+    }
+
+    const uint32_t latency = (Timebase_Microseconds() - state_time) + output_airtime;
+    fusion_fetch_quaternion_extrapolated(orientation, Timebase_ToSeconds(latency));
+}
+
+/*!
+* \brief Recalculates the effective output period after the period, the output mode, the timing, the framing or the baud rate changed
+*/
+static void UpdateOutputPeriod()
+{
+    output_airtime = OutputFrameTime(output_mode);
+
+    const uint16_t frame_time = (uint16_t)((output_airtime + 999u) / 1000u);
+    output_effective_period = (output_period > frame_time) ? output_period : frame_time;
+}
+
+/*!
+* \brief Applies a performance preset
+* \param[in] preset The preset
+* \param[in] configure_sensors Nonzero if the sensor rates are to be written; Zero at boot, where they were configured along with the sensors.
+* \return The status to acknowledge the command with
+*/
+static command_status_t ApplyPerformancePreset(performance_preset_t preset, uint8_t configure_sensors)
+{
+    const performance_preset_config_t *const config = GetPerformancePreset(preset);
+    if (NULL == config) return COMMAND_INVALID_VALUE;
+
+    if (configure_sensors)
+    {
+        SuspendI2C();
+        const uint8_t error = SetSensorPreset(config);
+        if (0 != error)
+        {
+            RecoverI2C(mpu6050_arbiter_handle);
+        }
+        ResumeI2C();
+        if (0 != error) return COMMAND_FAILED;
+    }
+
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_TIMER
+    hmc5883l_read_period = config->magnetometer_period;
+#endif
+#if MPU6050_FIFO_MODE
+    mpu6050_fifo_period = config->fifo_period;
+#endif
+    fusion_set_hybrid_decimation(config->hybrid_decimation);
+
+    output_period = config->output_period;
+    UpdateOutputPeriod();
+    return COMMAND_OK;
+}
+
+/************************************************************************/
+/* Command execution                                                    */
+/************************************************************************/
+
+/**
+* @brief Sends the statistics frame
+*
+* The frame is {@see COMMAND_STATS_FRAME_TYPE}, followed by the uptime in milliseconds (uint32_t),
+* the received, rejected and malformed command frame counts (uint16_t), the run mode,
+* the output mode and the streaming flag (uint8_t), the I2C error and retry counts
+* (uint16_t each) of the MMA8451Q, MPU6050 and HMC5883L, the effective output period
+* in milliseconds and the number of skipped output frames (uint16_t), and the number of
+* stream frames dropped by the transmit queue (uint32_t), in native endianness.
+*/
+static void SendStatistics()
+{
+    const command_statistics_t *const statistics = Command_GetStatistics();
+
+#pragma pack(1)
+    struct __attribute__ ((__packed__)) {
+        uint32_t uptime;
+        uint16_t received, rejected, framingErrors;
+        uint8_t runMode, outputMode, streaming;
+        uint16_t i2c[3][2];
+        uint16_t outputPeriod, outputDropped;
+        uint32_t framesDropped;
+    } buffer = {
+        systemTime(),
+        statistics->received, statistics->rejected, statistics->framingErrors,
+        (uint8_t)run_mode, (uint8_t)output_mode, streaming,
+        { { 0 } },
+        output_effective_period, output_dropped,
+        IO_DroppedFrames()
+    };
+#pragma pack()
+
+    const i2carbiter_handle_t handles[3] = { mma8451q_arbiter_handle, mpu6050_arbiter_handle, hmc5883l_arbiter_handle };
+    for (int i = 0; i < 3; ++i)
+    {
+        buffer.i2c[i][0] = i2c_statistics[handles[i]].errors;
+        buffer.i2c[i][1] = i2c_statistics[handles[i]].retries;
+    }
+
+    const uint8_t type = COMMAND_STATS_FRAME_TYPE;
+    IO_SendFrame(&type, 1, (const uint8_t*)&buffer, sizeof(buffer));
+}
+
+/**
+* @brief Answers {@see COMMAND_PING} with an echo frame
+* @param[in] command The ping command
+*
+* The frame is {@see COMMAND_ECHO_FRAME_TYPE}, followed by the time the ping was received
+* and the time the echo is sent in microseconds (uint32_t), and the ping arguments, so that
+* the host can tell the time spent in the firmware from the round-trip time.
+*/
+static void SendEcho(const command_t *const command)
+{
+    uint8_t buffer[2 * sizeof(uint32_t) + COMMAND_MAX_LENGTH];
+    memcpy(&buffer[0], &command->time, sizeof(uint32_t));
+    memcpy(&buffer[2 * sizeof(uint32_t)], command->args, command->length);
+
+    /* the transmit time is taken last, right before the frame is queued */
+    const uint32_t transmitTime = Timebase_Microseconds();
+    memcpy(&buffer[sizeof(uint32_t)], &transmitTime, sizeof(uint32_t));
+
+    const uint8_t type = COMMAND_ECHO_FRAME_TYPE;
+    IO_SendFrame(&type, 1, buffer, 2 * sizeof(uint32_t) + command->length);
+}
+
+/**
+* @brief Sends the instrumentation frame and resets the interrupt handler counters
+*
+* The frame is {@see INSTRUMENT_FRAME_TYPE}, followed by the uptime in milliseconds, the
+* static SRAM size, the stack reservation, the stack high-water mark and the untouched SRAM
+* in bytes (uint32_t), the peak occupancy of the UART RX and TX buffers in bytes (uint16_t),
+* the I2C transaction counts of the MMA8451Q, MPU6050 and HMC5883L (uint32_t), the acquisition
+* overruns, dropped samples and failed reads (uint16_t) and its peak queue occupancy (uint8_t), and, per
+* {@see instrument_isr_t}, the invocation count and the cycle sum since the last frame (uint32_t),
+* the maximum cycles of one invocation and the worst-case entry latency in cycles (uint16_t),
+* and the current {@see clock_level_t} (uint8_t) the cycles are counted at and the duty cycle
+* of the fusion in permille (uint16_t), in native endianness.
+*/
+static void SendInstrumentation()
+{
+    instrument_stack_t stack;
+    Instrument_FetchStack(&stack);
+
+    acquisition_statistics_t acquisition;
+    Acquisition_FetchStatistics(&acquisition);
+
+#pragma pack(1)
+    struct __attribute__ ((__packed__)) {
+        uint32_t uptime;
+        uint32_t staticSize, stackReserved, stackUsed, untouched;
+        uint16_t rxPeak, txPeak;
+        uint32_t i2c[3];
+        uint16_t overruns, dropped, errors;
+        uint8_t queuePeak;
+        struct __attribute__ ((__packed__)) {
+            uint32_t count, cycles;
+            uint16_t max, latency;
+        } isr[INSTRUMENT_ISR_COUNT];
+        uint8_t clockLevel;
+        uint16_t dutyCycle;
+    } buffer = {
+        systemTime(),
+        stack.static_size, stack.stack_reserved, stack.stack_used, stack.untouched,
+        (uint16_t)RingBuffer_Peak(&uartInputFifo), (uint16_t)RingBuffer_Peak(&uartOutputFifo),
+        { 0 },
+        acquisition.overruns, acquisition.dropped, acquisition.errors,
+        acquisition.peak,
+        { { 0 } },
+        (uint8_t)Clock_Level(), Governor_DutyCycle()
+    };
+#pragma pack()
+
+    const i2carbiter_handle_t handles[3] = { mma8451q_arbiter_handle, mpu6050_arbiter_handle, hmc5883l_arbiter_handle };
+    for (int i = 0; i < 3; ++i)
+    {
+        buffer.i2c[i] = i2c_statistics[handles[i]].transactions;
+    }
+
+    instrument_isr_counter_t counters[INSTRUMENT_ISR_COUNT];
+    Instrument_FetchIsrs(counters);
+    for (int i = 0; i < INSTRUMENT_ISR_COUNT; ++i)
+    {
+        buffer.isr[i].count = counters[i].count;
+        buffer.isr[i].cycles = counters[i].cycles;
+        buffer.isr[i].max = counters[i].max;
+        buffer.isr[i].latency = counters[i].latency;
+    }
+
+    const uint8_t type = INSTRUMENT_FRAME_TYPE;
+    IO_SendFrame(&type, 1, (const uint8_t*)&buffer, sizeof(buffer));
+}
+
+/**
+* @brief Working copy of the sensor calibration modified by the calibration commands
+*/
+static sensor_calibration_t calibration;
+
+/**
+* @brief Rebuilds the folded sensor data transforms from the current calibration
+*/
+static void PrepareSensorTransforms()
+{
+    sensor_prepare_initialize(mpu6050_accelerometer_get_scaler(), mpu6050_gyroscope_get_scaler(), hmc5883l_magnetometer_get_scaler());
+#if ENABLE_MMA8451Q && MMA8451Q_FUSE_ACCELEROMETER
+    sensor_prepare_initialize_mma8451q(mma8451q_accelerometer_get_scaler());
+#endif
+}
+
+#if MPU6050_AUTORANGE
+/**
+ * @brief Switches the MPU6050 to the requested ranges and folds the new scalers into the data preparation
+ *
+ * Called between samples, so that every sample is prepared with the scalers it was converted with;
+ * The reads that may have been converted before the switch are discarded by the caller afterwards.
+ */
+static void SwitchMPU6050Range()
+{
+    SuspendI2C();
+    I2CArbiter_SelectHandle(mpu6050_arbiter_handle);
+
+    const uint8_t error = SetMPU6050FullScale(mpu6050_autorange.next_gyroscope, mpu6050_autorange.next_accelerometer);
+    if (error)
+    {
+        /* the request is repeated by the next samples */
+        RecoverI2C(mpu6050_arbiter_handle);
+    }
+    else
+    {
+        PrepareSensorTransforms();
+    }
+    ResumeI2C();
+
+    MPU6050_AutorangeSwitched(&mpu6050_autorange, !error);
+}
+#endif
+
+/**
+* @brief Selects the calibration of a sensor
+* @param[in] sensor The {@see command_sensor_t}
+* @param[out] matrix The affine transformation
+* @param[out] variances The variances
+* @return Nonzero if the sensor is valid
+*/
+static uint8_t SelectCalibration(uint8_t sensor, fix16_t (**matrix)[4], fix16_t **variances)
+{
+    switch (sensor)
+    {
+        case COMMAND_SENSOR_ACCELEROMETER:
+            *matrix = calibration.mpu6050_accelerometer;
+            *variances = calibration.var_mpu6050_accelerometer;
+            return 1;
+        case COMMAND_SENSOR_GYROSCOPE:
+            *matrix = calibration.mpu6050_gyroscope;
+            *variances = calibration.var_mpu6050_gyroscope;
+            return 1;
+        case COMMAND_SENSOR_MAGNETOMETER:
+            *matrix = calibration.hmc5883l;
+            *variances = calibration.var_hmc5883l;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+* @brief Executes a command
+* @param[in] command The command
+* @return The status to acknowledge the command with
+*/
+static command_status_t ExecuteCommand(const command_t *const command)
+{
+    switch (command->id)
+    {
+        case COMMAND_SET_OUTPUT_MODE:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            const output_mode_t mode = (output_mode_t)command->args[0];
+            if (mode != SENSORS_RAW && mode != RPY && mode != QUATERNION && mode != QUATERNION_RPY
+                && mode != QUATERNION_COMPACT && mode != RPY_COMPACT && mode != QUATERNION_DELTA
+                && mode != RATES_ACCELERATION && mode != QUATERNION_RATES_ACCELERATION) return COMMAND_INVALID_VALUE;
+
+            /* the receiver needs a key frame to start from */
+            if (mode == QUATERNION_DELTA) output_delta_initialize(&output_delta);
+
+            output_mode = mode;
+            UpdateOutputPeriod();
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_RUN_MODE:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            const run_mode_t mode = (run_mode_t)command->args[0];
+            if (mode != RUN_FUSE && mode != RUN_FETCH && mode != RUN_FUSE_FETCH) return COMMAND_INVALID_VALUE;
+
+            /* the fusion restarts from scratch after having been suspended */
+            if (!RUN_MODE_FUSES(run_mode) && RUN_MODE_FUSES(mode)) fusion_restart = 1;
+
+            run_mode = mode;
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_OUTPUT_PERIOD:
+        {
+            if (command->length != sizeof(uint16_t)) return COMMAND_INVALID_LENGTH;
+
+            uint16_t period;
+            memcpy(&period, command->args, sizeof(uint16_t));
+            if (period == 0) return COMMAND_INVALID_VALUE;
+
+            output_period = period;
+            UpdateOutputPeriod();
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_FILTER_PARAMETER:
+        {
+            if (command->length != 1 + sizeof(fix16_t)) return COMMAND_INVALID_LENGTH;
+
+            fix16_t value;
+            memcpy(&value, &command->args[1], sizeof(fix16_t));
+            if (0 != fusion_set_parameter((fusion_parameter_t)command->args[0], value)) return COMMAND_INVALID_VALUE;
+            return COMMAND_OK;
+        }
+        case COMMAND_START_STREAMING:
+        case COMMAND_STOP_STREAMING:
+        {
+            if (command->length != 0) return COMMAND_INVALID_LENGTH;
+
+            streaming = (COMMAND_START_STREAMING == command->id);
+            return COMMAND_OK;
+        }
+        case COMMAND_REQUEST_STATS:
+        {
+            if (command->length != 0) return COMMAND_INVALID_LENGTH;
+
+            SendStatistics();
+            SendInstrumentation();
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_CALIBRATION_ROW:
+        case COMMAND_SET_VARIANCES:
+        {
+            const uint8_t isRow = (COMMAND_SET_CALIBRATION_ROW == command->id);
+            if (command->length != (isRow ? 2 + 4*sizeof(fix16_t) : 1 + 3*sizeof(fix16_t))) return COMMAND_INVALID_LENGTH;
+
+            fix16_t (*matrix)[4];
+            fix16_t *variances;
+            sensor_calibration_fetch(&calibration);
+            if (!SelectCalibration(command->args[0], &matrix, &variances)) return COMMAND_INVALID_VALUE;
+
+            if (isRow)
+            {
+                if (command->args[1] > 2) return COMMAND_INVALID_VALUE;
+                memcpy(matrix[command->args[1]], &command->args[2], 4*sizeof(fix16_t));
+            }
+            else
+            {
+                memcpy(variances, &command->args[1], 3*sizeof(fix16_t));
+            }
+
+            if (0 != sensor_calibration_apply(&calibration)) return COMMAND_INVALID_VALUE;
+            PrepareSensorTransforms();
+            return COMMAND_OK;
+        }
+        case COMMAND_SAVE_PARAMETERS:
+        case COMMAND_ERASE_PARAMETERS:
+        {
+            if (command->length != 0) return COMMAND_INVALID_LENGTH;
+
+            const parameter_store_result_t result = (COMMAND_SAVE_PARAMETERS == command->id)
+                ? parameter_store_save()
+                : parameter_store_erase();
+            return (PARAMETER_STORE_OK == result) ? COMMAND_OK : COMMAND_FAILED;
+        }
+        case COMMAND_START_MAG_CALIBRATION:
+        {
+            if (command->length != 0) return COMMAND_INVALID_LENGTH;
+
+            mag_calibration_start();
+            return COMMAND_OK;
+        }
+        case COMMAND_FINISH_MAG_CALIBRATION:
+        {
+            if (command->length != 0) return COMMAND_INVALID_LENGTH;
+            if (!mag_calibration_is_active()) return COMMAND_INVALID_VALUE;
+
+            // only the magnetometer transformation changes; The variances are not revalidated.
+            fix16_t transformation[3][4];
+            if (0 != mag_calibration_solve(hmc5883l_magnetometer_get_scaler(), transformation)) return COMMAND_FAILED;
+            sensor_calibration_apply_hmc5883l(transformation);
+            PrepareSensorTransforms();
+
+            return (PARAMETER_STORE_OK == parameter_store_save()) ? COMMAND_OK : COMMAND_FAILED;
+        }
+        case COMMAND_SET_FRAMING:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            const io_framing_t framing = (io_framing_t)command->args[0];
+            if (IO_FRAMING_P2PPE != framing && IO_FRAMING_COBS != framing && IO_FRAMING_P2PPE_TRAILER != framing) return COMMAND_INVALID_VALUE;
+
+            /* effective immediately; the acknowledge is sent in the new framing */
+            IO_SetFraming(framing);
+            UpdateOutputPeriod();
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_BAUD_RATE:
+        {
+            if (command->length != sizeof(uint32_t)) return COMMAND_INVALID_LENGTH;
+
+            uint32_t baud_rate;
+            memcpy(&baud_rate, command->args, sizeof(uint32_t));
+            if (0 != Uart0_CalculateBaud(baud_rate, &pending_baud)) return COMMAND_INVALID_VALUE;
+
+            /* the acknowledge is sent at the old baud rate, see ApplyPendingBaud() */
+            baud_change_pending = 1;
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_FUSION_MODE:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            if (0 != fusion_set_mode((fusion_mode_t)command->args[0])) return COMMAND_INVALID_VALUE;
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_PERFORMANCE_PRESET:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            return ApplyPerformancePreset((performance_preset_t)command->args[0], 1);
+        }
+        case COMMAND_SET_CLOCK_LEVEL:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+
+            if (0 != Governor_SetMode(command->args[0])) return COMMAND_INVALID_VALUE;
+            return COMMAND_OK;
+        }
+        case COMMAND_SET_OUTPUT_TIMING:
+        {
+            if (command->length != 1) return COMMAND_INVALID_LENGTH;
+            if (command->args[0] & ~OUTPUT_TIMING_MASK) return COMMAND_INVALID_VALUE;
+
+            /* the state time lengthens the frames */
+            output_timing = command->args[0];
+            UpdateOutputPeriod();
+            return COMMAND_OK;
+        }
+        case COMMAND_PING:
+        {
+            SendEcho(command);
+            return COMMAND_OK;
+        }
+        default:
+        {
+            return COMMAND_UNKNOWN;
+        }
+    }
+}
+
+/*!
+* \brief Switches to the baud rate requested by {\ref COMMAND_SET_BAUD_RATE} once everything queued was sent
+*/
+static void ApplyPendingBaud()
+{
+    if (!baud_change_pending) return;
+
+    while (IO_TransmitBusy()) {}
+    Uart0_SetBaud(&pending_baud);
+    baud_change_pending = 0;
+
+    UpdateOutputPeriod();
+}
 
 /************************************************************************/
 /* Main program                                                         */
@@ -183,9 +1176,16 @@ STATIC_INLINE void FusionSignal_Clear()
 
 int main(void)
 {
+    /* paint the free stack for the high-water report */
+    Instrument_PaintStack();
+
     /* initialize the core clock and the systick timer */
     InitClock();
     InitSysTick();
+    InitTimebase();
+
+    /* prepare the trace capture of the fusion hot path */
+    Instrument_InitTrace();
     
     /* initialize the RGB led */
     LED_Init();
@@ -193,34 +1193,61 @@ int main(void)
     /* Initialize UART0 */
     InitUart0();
 
+    /* after a warm reset, the fusion resumes from its snapshot and the greeting is skipped */
+    const uint8_t warm_restart = (WARM_RESTART_OK == warm_restart_check());
+
     /* double rainbow all across the sky */
-    DoubleFlash();
+    if (!warm_restart) DoubleFlash();
 
     /* initialize the I2C bus */
     I2C_Init();
 
-#if DATA_FUSE_MODE
-
     /* signaling for fusion */
     FusionSignal_Init();
 
-#endif // DATA_FUSE_MODE
-
     /* initialize UART fifos */
     RingBuffer_Init(&uartInputFifo, &uartInputData, UART_RX_BUFFER_SIZE);
     RingBuffer_Init(&uartOutputFifo, &uartOutputData, UART_TX_BUFFER_SIZE);
 
     /* initialize UART0 interrupts */
     Uart0_InitializeIrq(&uartInputFifo, &uartOutputFifo);
+#if UART0_USE_DMA_RX
+    /* commands are received by DMA */
+    Uart0_InitializeDmaReceive();
+#else
     Uart0_EnableReceiveIrq();
+#endif
+
+    /* initialize the command decoder */
+    Command_Init();
+
+#if UART0_USE_DMA_TX
+    /* frames are sent by DMA */
+    Uart0_InitializeDmaTransmit();
+#endif
 
     /* initialize I2C arbiter */
     InitI2CArbiter();
 		
 	/* initialize the IMUs */
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+    /* the MPU6050 has to open the auxiliary bus first */
+	InitMPU6050();
+    InitHMC5883L();
+    InitMPU6050Slaves();
+#else
     InitHMC5883L();
 	InitMPU6050();
 //    InitMPU6050();
+#endif
+
+    /* from here on, sensor data is fetched in the background */
+    I2CAsync_Init();
+#if MPU6050_ISR_ACQUISITION
+    /* the interrupt handlers submit the reads from the first resume on */
+    Acquisition_Init(mpu6050_arbiter_handle, hmc5883l_arbiter_handle,
+        (HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX) ? HMC5883L_AUX_REGISTER_COUNT : 0);
+#endif
 
 #if ENABLE_MMA8451Q
 	InitMMA8451Q();
@@ -228,61 +1255,129 @@ int main(void)
 
 	/* Wait for the config messages to get flushed */
     //TrafficLight();
-    DoubleFlash();
+    if (!warm_restart) DoubleFlash();
 	RingBuffer_BlockWhileNotEmpty(&uartOutputFifo);
 
 #if ENABLE_MMA8451Q
-	/* initialize the MMA8451Q data structure for accelerometer data fetching */
-	mma8451q_acc_t acc;
-	MMA8451Q_InitializeData(&acc);
+	/* initialize the MMA8451Q data structures for accelerometer data fetching */
+#if MMA8451Q_FIFO_MODE
+	mma8451q_acc_t mma_samples[MMA8451Q_FIFO_SIZE];
+#else
+	mma8451q_acc_t mma_samples[1];
 #endif
-
-	/* initialize the MPU6050 data structure */
-    mpu6050_sensor_t accgyrotemp, previous_accgyrotemp;
-	MPU6050_InitializeData(&accgyrotemp);
-    MPU6050_InitializeData(&previous_accgyrotemp);
+	uint8_t mma_count = 0;
+	MMA8451Q_InitializeData(&mma_samples[0]);
 	
-	/* initialize the HMC5883L data structure */
-	hmc5883l_data_t compass, previous_compass;
-    HMC5883L_InitializeData(&compass);
-    HMC5883L_InitializeData(&previous_compass);
+#if MMA8451Q_FUSE_ACCELEROMETER
+	/* MMA8451Q samples accumulated until the next MPU6050 accelerometer sample is fused */
+	int32_t mma_sum[3] = { 0, 0, 0 };
+	uint_fast8_t mma_sum_count = 0;
+#endif
+#endif
+
+	/* the latest MPU6050 and HMC5883L samples and the sequence numbers fused last */
+    sensor_sample_t mpu6050_sample, hmc5883l_sample;
+    SensorSample_Initialize(&mpu6050_sample, SENSOR_MPU6050);
+    SensorSample_Initialize(&hmc5883l_sample, SENSOR_HMC5883L);
+    uint16_t mpu6050_handled = mpu6050_sample.sequence,
+             hmc5883l_handled = hmc5883l_sample.sequence;
+    mpu6050_sensor_t *const accgyrotemp = &mpu6050_sample.mpu6050;
+    hmc5883l_data_t *const compass = &hmc5883l_sample.hmc5883l;
+
+#if !MPU6050_ISR_ACQUISITION
+    /* asynchronous transactions and raw register buffers for the sensor reads */
+    i2casync_transaction_t mpu6050_transaction, hmc5883l_transaction;
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+    mpu6050_fulldatareg_t mpu6050_raw; /* internal data followed by the slaved HMC5883L data */
+#else
+    mpu6050_intdatareg_t mpu6050_raw;
+#endif
+    uint8_t hmc5883l_raw[HMC5883L_DATA_REGISTER_COUNT];
+    uint32_t hmc5883l_timestamp = 0; /* time the current HMC5883L reading was requested */
+#endif
 
+#if MPU6050_BATCHED
+    /* batch of samples drained from the MPU6050 FIFO or the acquisition queue, and their times */
+    mpu6050_sensor_t batch_samples[MPU6050_FIFO_MAX_BATCH];
+    uint32_t batch_timestamps[MPU6050_FIFO_MAX_BATCH];
+    size_t batch_count = 0;
+#endif
+#if MPU6050_FIFO_MODE
+    uint32_t lastFifoRead = 0;
+#endif
+
+#if PROFILE_ENABLED
+    uint32_t lastProfileReport = 0;
+#endif
+
+#if WARM_RESTART_ENABLED
+    uint32_t lastCheckpoint = 0;
+#endif
+
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_TIMER
     /* initialize HMC5883L reading */
     uint32_t lastHMCRead = 0;
-    const uint32_t readHMCEvery = 1000 / 75; /* at 75Hz, data come every (1000/75Hz) ms. */
+#endif
     	
     /************************************************************************/
-    /* Fetch scaler values                                                  */
+    /* Load the stored parameters and prepare the sensor data transforms    */
     /************************************************************************/
 
-#if DATA_FUSE_MODE
+    /* the calibration and filter parameters stored in flash replace the compiled-in defaults */
+    parameter_store_load();
 
-    const fix16_t mpu6050_accelerometer_scaler = mpu6050_accelerometer_get_scaler();
-    const fix16_t mpu6050_gyroscope_scaler = mpu6050_gyroscope_get_scaler();
-    const fix16_t hmc5883l_magnetometer_scaler = hmc5883l_magnetometer_get_scaler();
-
-#endif // DATA_FUSE_MODE
+    PrepareSensorTransforms();
+#if MPU6050_AUTORANGE
+    MPU6050_AutorangeInitialize(&mpu6050_autorange, MPU6050_GYROSCOPE_FULL_SCALE, MPU6050_ACCELEROMETER_FULL_SCALE);
+#endif
 
     /************************************************************************/
     /* Prepare data fusion                                                  */
     /************************************************************************/
 
-#if DATA_FUSE_MODE
-
     uint32_t last_transmit_time = 0;
-    uint32_t last_fusion_time = systemTime();
+    uint32_t last_fusion_time = Timebase_Microseconds();
 
     fusion_initialize();
+    gyro_bias_initialize();
+    output_delta_initialize(&output_delta);
+
+    /* continue with the converged filters instead of bootstrapping */
+    if (warm_restart) warm_restart_resume();
+    else warm_restart_invalidate();
+
+    /* the rates depending on the sensor rates configured at boot */
+    ApplyPerformancePreset(PERFORMANCE_PRESET_DEFAULT, 0);
+
+    /* the load is measured from here on */
+    Governor_Init();
+
+    /************************************************************************/
+    /* Prepare raw sensor data output                                       */
+    /************************************************************************/
 
-#endif // DATA_FUSE_MODE
+    uint_fast8_t raw_decimation_counter = 0;
+    uint_fast8_t compass_pending = 0; /* fresh compass data not yet transmitted */
 
     /************************************************************************/
     /* Main loop                                                            */
     /************************************************************************/
 
+    /* poll the sensors once, in case their data ready edges were missed during initialization */
+#if MPU6050_ISR_ACQUISITION
+    Acquisition_Resume();
+#if ENABLE_MMA8451Q
+    Events_Signal(EVENT_MMA8451Q);
+#endif
+#elif ENABLE_MMA8451Q
+    Events_Signal(EVENT_MPU6050 | EVENT_MMA8451Q);
+#else
+    Events_Signal(EVENT_MPU6050);
+#endif
+
 	for(;;) 
 	{
-        /* helper variables to track data freshness */
+        /* nonzero if the sensors reported new samples since the last fusion */
         uint_fast8_t have_gyro_data = 0;
         uint_fast8_t have_acc_data = 0;
         uint_fast8_t have_mag_data = 0;
@@ -298,77 +1393,286 @@ int main(void)
         int readMMA;
 #endif
 		
-		/* atomic detection of fresh data */
+		/* atomic detection of fresh data; the timestamp belongs to the fetched MPU6050 event */
 		__disable_irq();
+		const uint32_t events = Events;
+		uint32_t sample_time = mpu6050_timestamp;
+		Events = 0;
+		__enable_irq();
+		
 #if ENABLE_MMA8451Q
-		readMMA = poll_mma8451q;
+		readMMA = (events & EVENT_MMA8451Q) != 0;
 #endif
-		readMPU = poll_mpu6050;
-		poll_mma8451q = 0;
-		poll_mpu6050 = 0;
-		__enable_irq();
+		readMPU = (events & EVENT_MPU6050) != 0;
+		readHMC = (events & EVENT_HMC5883L) != 0;
+		
+		/* samples not announced by the MPU6050 interrupt are stamped on fetch */
+#if !MPU6050_BATCHED
+		if (!readMPU)
+#endif
+		{
+			sample_time = Timebase_Microseconds();
+		}
 		
 		/* detection of HMC read */
-		/*
-		 * TODO: read synchronized with MPU
-		 */
-		readHMC = 0;
 		uint32_t time = systemTime(); 
-		if ((time - lastHMCRead) >= readHMCEvery)
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_TIMER
+		readHMC = 0;
+		if ((time - lastHMCRead) >= hmc5883l_read_period)
 		{
+#if MPU6050_ISR_ACQUISITION
+			/* the sample is queued once read */
+			Acquisition_ReadHMC5883L(Timebase_Microseconds());
+#else
 			readHMC = 1;
+#endif
 			lastHMCRead = time;
 		}
+#elif HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+		/* the magnetometer data arrive along with the MPU6050 data */
+		readHMC = 0;
+#endif
+
+#if MPU6050_FIFO_MODE
+		/* in FIFO mode the data ready interrupt is disabled; drain periodically instead */
+		readMPU = 0;
+		if ((time - lastFifoRead) >= mpu6050_fifo_period)
+		{
+			readMPU = 1;
+			lastFifoRead = time;
+		}
+#endif
 
         /************************************************************************/
-        /* Fetching MPU6050 sensor data if required                             */
+        /* Queue MPU6050 and HMC5883L sensor data fetching if required          */
         /************************************************************************/
 
-		/* read accelerometer/gyro */
+#if MPU6050_ISR_ACQUISITION
+		/* the interrupt handlers have fetched already; drain their samples, oldest first */
+		readMPU = readHMC = 0;
+		batch_count = 0;
+		sensor_sample_t queued;
+		while ((batch_count < MPU6050_FIFO_MAX_BATCH) && Acquisition_Fetch(&queued))
+		{
+			if (SENSOR_MPU6050 == queued.source)
+			{
+				++i2c_statistics[mpu6050_arbiter_handle].transactions;
+				batch_samples[batch_count] = queued.mpu6050;
+				batch_timestamps[batch_count] = queued.timestamp;
+				++batch_count;
+				mpu6050_sample = queued;
+				continue;
+			}
+
+#if HMC5883L_FETCH_MODE != HMC5883L_FETCH_AUX
+			++i2c_statistics[hmc5883l_arbiter_handle].transactions;
+#endif
+			/* only the latest compass sample of a batch is fused */
+			hmc5883l_sample = queued;
+		}
+		have_mag_data = (SensorSample_Take(&hmc5883l_sample, &hmc5883l_handled) != 0);
+		readHMC = have_mag_data;
+
+		/* every queued sample was reported new by its status */
+		if (batch_count > 0)
+		{
+			LED_BlueOff();
+			readMPU = 1;
+			sample_time = mpu6050_sample.timestamp;
+		}
+		else if (readHMC)
+		{
+			sample_time = hmc5883l_sample.timestamp;
+		}
+		eventsProcessed = readMPU || readHMC;
+
+		/* a full batch leaves samples for the next iteration */
+		if (batch_count == MPU6050_FIFO_MAX_BATCH)
+		{
+			Events_Signal(EVENT_MPU6050);
+		}
+
+		/* the bus is recovered here rather than in the handlers */
+		const i2carbiter_handle_t failed_handle = Acquisition_FetchFailure();
+		if (I2CARBITER_INVALID_HANDLE != failed_handle)
+		{
+			RecoverI2C(failed_handle);
+		}
+#else
+		/* the transfers are carried out by the I2C0 IRQ in the background */
 		if (readMPU)
 		{
 			LED_BlueOff();
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+			MPU6050_ReadFullDataAsync(&mpu6050_transaction, &mpu6050_raw, HMC5883L_AUX_REGISTER_COUNT);
+#elif !MPU6050_FIFO_MODE
+			MPU6050_ReadDataAsync(&mpu6050_transaction, &mpu6050_raw);
+#endif
+#if MPU6050_COUNT > 1
+			QueueRedundantMPU6050();
+#endif
 			
-			I2CArbiter_Select(MPU6050_I2CADDR);
-			MPU6050_ReadData(&accgyrotemp);
+			/* mark event as detected */
+			eventsProcessed = 1;
+		}
+		
+		if (readHMC)
+		{
+			/* the data is only read if the status reports a new sample, in the same bus session */
+			HMC5883L_ReadDataAsync(&hmc5883l_transaction, hmc5883l_raw);
+			hmc5883l_timestamp = Timebase_Microseconds();
 			
 			/* mark event as detected */
 			eventsProcessed = 1;
+		}
+#endif // MPU6050_ISR_ACQUISITION
+
+        /************************************************************************/
+        /* Predict on the previous sample while the bus is busy                 */
+        /************************************************************************/
+
+        const uint32_t current_time = systemTime();
+        fix16_t deltaT = 0;
+        uint32_t elapsed = 0;
+
+        if (eventsProcessed && RUN_MODE_FUSES(run_mode))
+        {
+            // get the time differential
+            elapsed = sample_time - last_fusion_time;
+            deltaT = Timebase_ToSeconds(elapsed);
 
-            /* check for data freshness */
-            have_acc_data = (accgyrotemp.accel.x != previous_accgyrotemp.accel.x)
-                || (accgyrotemp.accel.y != previous_accgyrotemp.accel.y)
-                || (accgyrotemp.accel.z != previous_accgyrotemp.accel.z);
+            last_fusion_time = sample_time;
 
-            have_gyro_data = (accgyrotemp.gyro.x != previous_accgyrotemp.gyro.x)
-                || (accgyrotemp.gyro.y != previous_accgyrotemp.gyro.y)
-                || (accgyrotemp.gyro.z != previous_accgyrotemp.gyro.z);
+#if !MPU6050_BATCHED
+            FusionSignal_Predict();
+
+            // predict the current measurements
+            PROFILE_START(predict_start);
+            INSTRUMENT_TRACE_START();
+            fusion_predict(deltaT);
+            INSTRUMENT_TRACE_STOP();
+            PROFILE_STOP(PROFILE_STAGE_PREDICT, predict_start);
+#endif
+        }
+
+        /************************************************************************/
+        /* Collecting MPU6050 sensor data                                       */
+        /************************************************************************/
+
+        PROFILE_START(read_start);
+
+#if MPU6050_FIFO_MODE
+		if (readMPU)
+		{
+			/* the FIFO is drained with a single blocking burst read */
+			I2CAsync_WaitWhileBusy();
+			I2CArbiter_SelectHandle(mpu6050_arbiter_handle);
+			batch_count = MPU6050_ReadFifo(batch_samples, MPU6050_FIFO_MAX_BATCH);
+			if (I2C_FetchError())
+			{
+				RecoverI2C(mpu6050_arbiter_handle);
+				batch_count = MPU6050_ReadFifo(batch_samples, MPU6050_FIFO_MAX_BATCH);
+				if (I2C_FetchError())
+				{
+					++i2c_statistics[mpu6050_arbiter_handle].errors;
+					batch_count = 0;
+				}
+			}
+
+			/* every FIFO frame is a new sample; the frames carry no time, so spread them evenly since the last drain */
+			for (size_t i = 0; i < batch_count; ++i)
+			{
+				batch_timestamps[i] = sample_time - elapsed + (uint32_t)(i + 1) * elapsed / (uint32_t)batch_count;
+			}
+			if (batch_count > 0)
+			{
+				*accgyrotemp = batch_samples[batch_count - 1];
+				SensorSample_Advance(&mpu6050_sample, (uint16_t)batch_count, batch_timestamps[batch_count - 1]);
+			}
+		}
+#elif !MPU6050_ISR_ACQUISITION
+		if (readMPU && (I2CASYNC_SUCCESS == WaitForI2C(&mpu6050_transaction)))
+		{
+#if HMC5883L_FETCH_MODE == HMC5883L_FETCH_AUX
+			MPU6050_DecodeData(&mpu6050_raw.internalData, accgyrotemp);
+
+			/* the status register was read right before the data output registers */
+			if (HMC5883L_DataReady(mpu6050_raw.EXT_SENS_DATA_00))
+			{
+				compass->status = mpu6050_raw.EXT_SENS_DATA_00;
+				HMC5883L_DecodeData(&mpu6050_raw.EXT_SENS_DATA_01, compass);
+				SensorSample_Advance(&hmc5883l_sample, 1, sample_time);
+			}
+#else
+			MPU6050_DecodeData(&mpu6050_raw, accgyrotemp);
+#endif
 
-            /* loop current data --> previous data */
-            previous_accgyrotemp = accgyrotemp;
+			/* the read clears the latched data ready flag, so it is only set for a sample not read before */
+			if (accgyrotemp->status != 0)
+			{
+				SensorSample_Advance(&mpu6050_sample, 1, sample_time);
+			}
 		}
+
+#if MPU6050_COUNT > 1
+		if (readMPU) CollectRedundantMPU6050();
+#endif
+#endif // MPU6050_FIFO_MODE, MPU6050_ISR_ACQUISITION
+
+        /* exactly the samples the MPU6050 reported since the last iteration */
+        have_acc_data = have_gyro_data = (SensorSample_Take(&mpu6050_sample, &mpu6050_handled) != 0);
+
+#if MPU6050_AUTORANGE
+        /* track the peaks, unless the read may straddle the last range switch */
+        uint8_t range_switch = 0;
+        if (have_acc_data || have_gyro_data)
+        {
+            if (MPU6050_AutorangeSettling(&mpu6050_autorange))
+            {
+                have_acc_data = have_gyro_data = 0;
+#if MPU6050_BATCHED
+                batch_count = 0;
+#endif
+            }
+            else
+            {
+#if MPU6050_BATCHED
+                for (size_t i = 0; i < batch_count; ++i)
+                {
+                    range_switch |= MPU6050_AutorangeUpdate(&mpu6050_autorange, &batch_samples[i]);
+                }
+#else
+                range_switch = MPU6050_AutorangeUpdate(&mpu6050_autorange, accgyrotemp);
+#endif
+            }
+        }
+#endif
 		
         /************************************************************************/
-        /* Fetching HMC5883L sensor data if required                            */
+        /* Collecting HMC5883L sensor data                                      */
         /************************************************************************/
 
-		/* read compass data */
-		if (readHMC)
+#if HMC5883L_FETCH_MODE != HMC5883L_FETCH_AUX && !MPU6050_ISR_ACQUISITION
+		if (readHMC && (I2CASYNC_SUCCESS == WaitForI2C(&hmc5883l_transaction)) && HMC5883L_DataReady(hmc5883l_transaction.statusRegister))
 		{
-			I2CArbiter_Select(HMC5883L_I2CADDR);
-			HMC5883L_ReadData(&compass);
-			
-			/* mark event as detected */
-			eventsProcessed = 1;
+			compass->status = hmc5883l_transaction.statusRegister;
+			HMC5883L_DecodeData(hmc5883l_raw, compass);
+			SensorSample_Advance(&hmc5883l_sample, 1, hmc5883l_timestamp);
+		}
+#endif
+
+#if !MPU6050_ISR_ACQUISITION
+        /* exactly the samples the HMC5883L reported since the last iteration */
+        have_mag_data = (SensorSample_Take(&hmc5883l_sample, &hmc5883l_handled) != 0);
+#endif
 
-            /* check for data freshness */
-            have_mag_data = (compass.x != previous_compass.x)
-                || (compass.y != previous_compass.y)
-                || (compass.z != previous_compass.z);
+        /* feed the on-target magnetometer calibration, in any run mode */
+        if (have_mag_data)
+        {
+            mag_calibration_update(compass->x, compass->y, compass->z);
+        }
 
-            /* loop current data --> previous data */
-            previous_compass = compass;
-		}
+		if (readMPU || readHMC) PROFILE_STOP(PROFILE_STAGE_I2C_READ, read_start);
 		
         /************************************************************************/
         /* Fetching MMA8451Q sensor data if required                            */
@@ -380,8 +1684,47 @@ int main(void)
 		{
 			LED_RedOff();
 			
-			I2CArbiter_Select(MMA8451Q_I2CADDR);
-			MMA8451Q_ReadAcceleration14bitNoFifo(&acc);
+			/* the MMA8451Q is read blocking */
+			SuspendI2C();
+			I2CArbiter_SelectHandle(mma8451q_arbiter_handle);
+#if MMA8451Q_FIFO_MODE
+			/* drain the batch that raised the watermark */
+			mma_count = MMA8451Q_ReadFifo(mma_samples, MMA8451Q_FIFO_SIZE);
+			if (I2C_FetchError())
+			{
+				RecoverI2C(mma8451q_arbiter_handle);
+				mma_count = MMA8451Q_ReadFifo(mma_samples, MMA8451Q_FIFO_SIZE);
+				if (I2C_FetchError())
+				{
+					++i2c_statistics[mma8451q_arbiter_handle].errors;
+					mma_count = 0;
+				}
+			}
+#else
+			MMA8451Q_ReadAcceleration14bitNoFifo(&mma_samples[0]);
+			if (I2C_FetchError())
+			{
+				RecoverI2C(mma8451q_arbiter_handle);
+				MMA8451Q_ReadAcceleration14bitNoFifo(&mma_samples[0]);
+				if (I2C_FetchError())
+				{
+					++i2c_statistics[mma8451q_arbiter_handle].errors;
+					mma_samples[0].status = 0;
+				}
+			}
+			mma_count = (mma_samples[0].status != 0) ? 1 : 0;
+#endif
+			ResumeI2C();
+
+#if MMA8451Q_FUSE_ACCELEROMETER
+			/* accumulate the batch until the MPU6050 accelerometer catches up */
+			for (uint8_t i = 0; i < mma_count && mma_sum_count < UINT8_MAX; ++i, ++mma_sum_count)
+			{
+				mma_sum[0] += mma_samples[i].x;
+				mma_sum[1] += mma_samples[i].y;
+				mma_sum[2] += mma_samples[i].z;
+			}
+#endif
 			
 			/* mark event as detected */
 			eventsProcessed = 1;
@@ -392,87 +1735,185 @@ int main(void)
         /* Raw sensor data output over serial                                   */
         /************************************************************************/
 
-#if DATA_FETCH_MODE
-
 		/* data availability + sanity check 
 		 * This sent me on a long bug hunt: Sometimes the interrupt would be raised
 		 * even if not all data registers were written. This always resulted in a
 		 * z data register not being fully written which, in turn, resulted in
 		 * extremely jumpy measurements. 
 		 */
-		if (readMPU && accgyrotemp.status != 0)
-		{
-			/* write data */
-			uint8_t type = 0x02;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)accgyrotemp.data, sizeof(accgyrotemp.data), IO_SendByte);
-		}
-		
-		/* data availability + sanity check */
-		if (readHMC && (compass.status & HMC5883L_SR_RDY_MASK) != 0) /* TODO: check if not in lock state */
-		{
-			uint8_t type = 0x03;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)compass.xyz, sizeof(compass.xyz), IO_SendByte);
-		}
-		
+        if (streaming && RUN_MODE_FETCHES(run_mode))
+        {
+            /* MPU6050 samples of this iteration, oldest first */
+#if MPU6050_BATCHED
+            const mpu6050_sensor_t *const samples = batch_samples;
+            const size_t sample_count = readMPU ? batch_count : 0;
+#else
+            const mpu6050_sensor_t *const samples = accgyrotemp;
+            const size_t sample_count = have_acc_data ? 1 : 0;
+#endif
+            compass_pending |= have_mag_data;
+
+            /* in the combined mode, only every n-th fetch is transmitted along with the pending compass data */
+            uint_fast8_t transmit = 1;
+            if (run_mode == RUN_FUSE_FETCH)
+            {
+                transmit = (sample_count > 0) && (++raw_decimation_counter >= RUN_FUSE_FETCH_DECIMATION);
+                if (transmit) raw_decimation_counter = 0;
+            }
+
+            if (transmit && (sample_count > 0 || compass_pending))
+            {
+#if DATA_FETCH_CAPTURE
+                Capture_SendFrames(samples, sample_count, compass, compass_pending, sample_time);
+#else
+                for (size_t i = 0; i < sample_count; ++i)
+                {
+                    /* write data */
+                    uint8_t type = 0x02;
+                    IO_SubmitFrame(&type, 1, (uint8_t*)samples[i].data, sizeof(samples[i].data));
+                }
+
+                if (compass_pending)
+                {
+                    uint8_t type = 0x03;
+                    IO_SubmitFrame(&type, 1, (uint8_t*)compass->xyz, sizeof(compass->xyz));
+                }
+#endif
+                compass_pending = 0;
+            }
+#if DATA_FETCH_CAPTURE
+            else
+            {
+                /* skipped samples keep their sequence numbers */
+                capture_sequence += sample_count;
+            }
+#endif
+
 #if ENABLE_MMA8451Q
-		/* data availability + sanity check */
-		if (readMMA && acc.status != 0) 
-		{
-			uint8_t type = 0x01;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)acc.xyz, sizeof(acc.xyz), IO_SendByte);
-		}
+            /* data availability + sanity check */
+            for (uint8_t i = 0; readMMA && i < mma_count; ++i)
+            {
+                uint8_t type = 0x01;
+                IO_SubmitFrame(&type, 1, (uint8_t*)mma_samples[i].xyz, sizeof(mma_samples[i].xyz));
+            }
 #endif
-		
-#endif // DATA_FETCH_MODE
+        }
 
         /************************************************************************/
         /* Sensor data fusion                                                   */
         /************************************************************************/
 
-#if DATA_FUSE_MODE
-
         // if there were sensor data ...
-        if (eventsProcessed)
+        if (eventsProcessed && RUN_MODE_FUSES(run_mode))
         {
             v3d gyro, acc, mag;
 
+            // the temperature drives the gyroscope bias model
+            const fix16_t temperature = sensor_prepare_mpu6050_temperature(accgyrotemp->temperature);
+
+#if MPU6050_BATCHED
+            // fuse all but the last sample of the batch right away,
+            // each over the time since its predecessor
+            if (batch_count > 1)
+            {
+                uint32_t previous_time = sample_time - elapsed;
+                for (size_t i = 0; i + 1 < batch_count; ++i)
+                {
+                    const mpu6050_sensor_t *const sample = &batch_samples[i];
+                    const uint32_t timestamp = batch_timestamps[i];
+                    const fix16_t sample_deltaT = Timebase_ToSeconds(timestamp - previous_time);
+                    previous_time = timestamp;
+
+                    PROFILE_START(sample_prepare_start);
+                    sensor_prepare_mpu6050_gyroscope_data(&gyro, sample->gyro.x, sample->gyro.y, sample->gyro.z);
+                    gyro_bias_correct(&gyro, temperature);
+                    fusion_set_gyroscope_v3d(&gyro, timestamp);
+                    sensor_prepare_mpu6050_accelerometer_data(&acc, sample->accel.x, sample->accel.y, sample->accel.z);
+                    fusion_set_accelerometer_v3d(&acc, timestamp);
+                    gyro_bias_update(&gyro, &acc, temperature);
+                    PROFILE_STOP(PROFILE_STAGE_PREPARE, sample_prepare_start);
+
+                    FusionSignal_Predict();
+                    PROFILE_START(sample_predict_start);
+                    fusion_predict(sample_deltaT);
+                    PROFILE_STOP(PROFILE_STAGE_PREDICT, sample_predict_start);
+                    FusionSignal_Update();
+                    fusion_update(sample_deltaT);
+                }
+                deltaT = Timebase_ToSeconds(sample_time - previous_time);
+            }
+
+            // the last sample takes the regular path
+            FusionSignal_Predict();
+            PROFILE_START(predict_start);
+            INSTRUMENT_TRACE_START();
+            fusion_predict(deltaT);
+            INSTRUMENT_TRACE_STOP();
+            PROFILE_STOP(PROFILE_STAGE_PREDICT, predict_start);
+#endif
+
+            PROFILE_START(prepare_start);
+
             // convert, calibrate and store gyroscope data
             if (have_gyro_data)
             {
-                sensor_prepare_mpu6050_gyroscope_data(&gyro, accgyrotemp.gyro.x, accgyrotemp.gyro.y, accgyrotemp.gyro.z, mpu6050_gyroscope_scaler);
-                fusion_set_gyroscope_v3d(&gyro);
+                sensor_prepare_mpu6050_gyroscope_data(&gyro, accgyrotemp->gyro.x, accgyrotemp->gyro.y, accgyrotemp->gyro.z);
+#if MPU6050_COUNT > 1
+                AverageRedundantGyroscope(&gyro);
+#endif
+                gyro_bias_correct(&gyro, temperature);
+                fusion_set_gyroscope_v3d(&gyro, sample_time);
             }
 
             // convert, calibrate and store accelerometer data
             if (have_acc_data)
             {
-                sensor_prepare_mpu6050_accelerometer_data(&acc, accgyrotemp.accel.x, accgyrotemp.accel.y, accgyrotemp.accel.z, mpu6050_accelerometer_scaler);
-                fusion_set_accelerometer_v3d(&acc);
+                sensor_prepare_mpu6050_accelerometer_data(&acc, accgyrotemp->accel.x, accgyrotemp->accel.y, accgyrotemp->accel.z);
+#if MPU6050_COUNT > 1
+                AverageRedundantAccelerometer(&acc);
+#endif
+
+#if ENABLE_MMA8451Q && MMA8451Q_FUSE_ACCELEROMETER
+                // blend in the MMA8451Q samples since the last fusion, averaged
+                if (mma_sum_count > 0)
+                {
+                    const int32_t half = (int32_t)(mma_sum_count / 2);
+                    v3d mma;
+                    sensor_prepare_mma8451q_accelerometer_data(&mma,
+                        (int16_t)((mma_sum[0] + (mma_sum[0] >= 0 ? half : -half)) / (int32_t)mma_sum_count),
+                        (int16_t)((mma_sum[1] + (mma_sum[1] >= 0 ? half : -half)) / (int32_t)mma_sum_count),
+                        (int16_t)((mma_sum[2] + (mma_sum[2] >= 0 ? half : -half)) / (int32_t)mma_sum_count));
+                    sensor_prepare_combine_accelerometers(&acc, &mma, mma_sum_count);
+
+                    mma_sum[0] = mma_sum[1] = mma_sum[2] = 0;
+                    mma_sum_count = 0;
+                }
+#endif
+
+                fusion_set_accelerometer_v3d(&acc, sample_time);
+            }
+
+            // learn the gyroscope bias while stationary
+            if (have_gyro_data && have_acc_data)
+            {
+                gyro_bias_update(&gyro, &acc, temperature);
             }
 
             // convert, calibrate and store magnetometer data
             if (have_mag_data)
             {
-                sensor_prepare_hmc5883l_data(&mag, compass.x, compass.y, compass.z, hmc5883l_magnetometer_scaler);
-                fusion_set_magnetometer_v3d(&mag);
+                sensor_prepare_hmc5883l_data(&mag, compass->x, compass->y, compass->z);
+                fusion_set_magnetometer_v3d(&mag, hmc5883l_sample.timestamp);
             }
 
-            // get the time differential
-            const uint32_t current_time = systemTime();
-            const fix16_t deltaT_ms = fix16_from_int(current_time - last_fusion_time);
-            const fix16_t deltaT = fix16_mul(deltaT_ms, F16(0.001));
-            
-            last_fusion_time = current_time;
-            
-            FusionSignal_Predict();
-
-            // predict the current measurements
-            fusion_predict(deltaT);
+            PROFILE_STOP(PROFILE_STAGE_PREPARE, prepare_start);
 
             FusionSignal_Update();
 
             // correct the measurements
+            INSTRUMENT_TRACE_START();
             fusion_update(deltaT);
+            INSTRUMENT_TRACE_STOP();
 
             
             FusionSignal_Clear();
@@ -499,118 +1940,203 @@ int main(void)
                 /* write data */
                 uint8_t type = 42;
                 fix16_t buffer[3] = { roll, pitch, yaw };
-                P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
+                IO_SubmitFrame(&type, 1, (uint8_t*)buffer, sizeof(buffer));
 
                 last_transmit_time = current_time;
             }
 #endif
 #else
-            if (current_time - last_transmit_time >= 100)
+            if (streaming && current_time - last_transmit_time >= output_effective_period)
             {
-                /* write data */
-                switch (output_mode)
+                last_transmit_time = current_time;
+
+                /* too slow a link degrades the rate; submitting would only replace the queued frame */
+                if (IO_TransmitBusy())
                 {
-                    case RPY:
-                    {
-                                fix16_t roll, pitch, yaw;
-                                fusion_fetch_angles(&roll, &pitch, &yaw);
-
-                                /* write data */
-                                uint8_t type = 42;
-                                fix16_t buffer[3] = { roll, pitch, yaw };
-                                P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                break;
-                    }
-                    case QUATERNION:
-                    {
-                                       qf16 orientation;
-                                       fusion_fetch_quaternion(&orientation);
+                    ++output_dropped;
+                }
+                else
+                {
+                    PROFILE_START(output_start);
 
-                                       uint8_t type = 43;
-                                       fix16_t buffer[4] = { orientation.a, orientation.b, orientation.c, orientation.d };
-                                       P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                       break;
-                    }
-                    case QUATERNION_RPY:
+                    /* write data */
+                    const uint32_t state_time = fusion_get_state_time();
+                    switch (output_mode)
                     {
-                                           fix16_t roll, pitch, yaw;
-                                           fusion_fetch_angles(&roll, &pitch, &yaw);
-
+                        case RPY:
+                        {
+                                    fix16_t roll, pitch, yaw;
+                                    fusion_fetch_angles(&roll, &pitch, &yaw);
+
+                                    /* write data */
+                                    fix16_t buffer[3] = { roll, pitch, yaw };
+                                    SubmitOutputFrame(RPY, buffer, sizeof(buffer), state_time);
+                                    break;
+                        }
+                        case QUATERNION:
+                        {
                                            qf16 orientation;
-                                           fusion_fetch_quaternion(&orientation);
+                                           FetchOutputQuaternion(&orientation, state_time);
 
-                                           uint8_t type = 44;
-                                           fix16_t buffer[7] = { orientation.a, orientation.b, orientation.c, orientation.d, roll, pitch, yaw };
-                                           P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
+                                           fix16_t buffer[4] = { orientation.a, orientation.b, orientation.c, orientation.d };
+                                           SubmitOutputFrame(QUATERNION, buffer, sizeof(buffer), state_time);
                                            break;
+                        }
+                        case QUATERNION_RPY:
+                        {
+                                               fix16_t roll, pitch, yaw;
+                                               fusion_fetch_angles(&roll, &pitch, &yaw);
+
+                                               qf16 orientation;
+                                               FetchOutputQuaternion(&orientation, state_time);
+
+                                               fix16_t buffer[7] = { orientation.a, orientation.b, orientation.c, orientation.d, roll, pitch, yaw };
+                                               SubmitOutputFrame(QUATERNION_RPY, buffer, sizeof(buffer), state_time);
+                                               break;
+                        }
+                        case QUATERNION_COMPACT:
+                        {
+                            qf16 orientation;
+                            FetchOutputQuaternion(&orientation, state_time);
+
+                            uint8_t buffer[OUTPUT_SMALLEST_THREE_SIZE];
+                            output_encode_smallest_three(buffer, &orientation);
+                            SubmitOutputFrame(QUATERNION_COMPACT, buffer, sizeof(buffer), state_time);
+                            break;
+                        }
+                        case RPY_COMPACT:
+                        {
+                            fix16_t roll, pitch, yaw;
+                            fusion_fetch_angles(&roll, &pitch, &yaw);
+
+                            int16_t buffer[3];
+                            output_encode_angles(buffer, roll, pitch, yaw);
+                            SubmitOutputFrame(RPY_COMPACT, buffer, sizeof(buffer), state_time);
+                            break;
+                        }
+                        case QUATERNION_DELTA:
+                        {
+                            qf16 orientation;
+                            FetchOutputQuaternion(&orientation, state_time);
+
+                            uint8_t type;
+                            uint8_t buffer[OUTPUT_DELTA_MAX_PAYLOAD];
+                            const uint8_t length = output_delta_encode(&output_delta, &orientation, &type, QUATERNION_DELTA, buffer);
+                            SubmitOutputFrame(type, buffer, length, state_time);
+                            break;
+                        }
+                        case RATES_ACCELERATION:
+                        {
+                            v3d rate, acceleration;
+                            fusion_fetch_angular_rate(&rate);
+                            fusion_fetch_linear_acceleration(&acceleration);
+
+                            fix16_t buffer[6] = { rate.x, rate.y, rate.z, acceleration.x, acceleration.y, acceleration.z };
+                            SubmitOutputFrame(RATES_ACCELERATION, buffer, sizeof(buffer), state_time);
+                            break;
+                        }
+                        case QUATERNION_RATES_ACCELERATION:
+                        {
+                            qf16 orientation;
+                            FetchOutputQuaternion(&orientation, state_time);
+
+                            v3d rate, acceleration;
+                            fusion_fetch_angular_rate(&rate);
+                            fusion_fetch_linear_acceleration(&acceleration);
+
+                            fix16_t buffer[10] = { orientation.a, orientation.b, orientation.c, orientation.d,
+                                rate.x, rate.y, rate.z, acceleration.x, acceleration.y, acceleration.z };
+                            SubmitOutputFrame(QUATERNION_RATES_ACCELERATION, buffer, sizeof(buffer), state_time);
+                            break;
+                        }
+                        case SENSORS_RAW:
+                        {
+                                            fix16_t buffer[6] = { acc.x, acc.y, acc.z, mag.x, mag.y, mag.z };
+                                            SubmitOutputFrame(SENSORS_RAW, buffer, sizeof(buffer), state_time);
+                                            break;
+                        }
                     }
-                    case SENSORS_RAW:
-                    {
-                                        uint8_t type = 0;
-                                        fix16_t buffer[6] = { acc.x, acc.y, acc.z, mag.x, mag.y, mag.z };
-                                        P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                        break;
-                    }
-                }
 
-                last_transmit_time = current_time;
+                    PROFILE_STOP(PROFILE_STAGE_OUTPUT, output_start);
+                }
             }
 #endif
 
         }
 
-#endif // DATA_FUSE_MODE
+#if MPU6050_AUTORANGE
+        /* the current sample has been prepared with the old scalers */
+        if (range_switch)
+        {
+            SwitchMPU6050Range();
+        }
+#endif
+
+        /************************************************************************/
+        /* Profiling report                                                     */
+        /************************************************************************/
+
+#if PROFILE_ENABLED
+        if ((systemTime() - lastProfileReport) >= PROFILE_REPORT_PERIOD)
+        {
+            Profile_Report();
+            lastProfileReport = systemTime();
+        }
+#endif
+
+        /************************************************************************/
+        /* Warm restart checkpoint                                              */
+        /************************************************************************/
+
+#if WARM_RESTART_ENABLED
+        if ((systemTime() - lastCheckpoint) >= WARM_RESTART_CHECKPOINT_PERIOD)
+        {
+            warm_restart_checkpoint();
+            lastCheckpoint = systemTime();
+        }
+#endif
+
+        /************************************************************************/
+        /* Core clock scaling                                                   */
+        /************************************************************************/
+
+        Governor_Update();
 
         /************************************************************************/
         /* Read user data input                                                 */
         /************************************************************************/
 
-		/* as long as there is data in the buffer */
-		while(!RingBuffer_Empty(&uartInputFifo))
+		/* decode all complete command frames */
+		command_t command;
+		while (Command_Poll(&command))
 		{
 			/* light one led */
 			LED_RedOn();
 			
-			/* fetch byte */
-			uint8_t data = IO_ReadByte();
-			
-            output_mode = (output_mode_t)data;
-
-            LED_RedOff();
-#if 0
-			/* echo to output */
-			IO_SendByte(data);
+			Command_Acknowledge(&command, ExecuteCommand(&command));
+			ApplyPendingBaud();
 			
-			/* mark event as detected */
-			eventsProcessed = 1;
-#endif
+			LED_RedOff();
+		}
+		
+		if (fusion_restart)
+		{
+			fusion_initialize();
+			warm_restart_invalidate();
+			last_fusion_time = Timebase_Microseconds();
+			fusion_restart = 0;
 		}
 		
         /************************************************************************/
-        /* Save energy if you like to                                           */
+        /* Save energy until the next event                                     */
         /************************************************************************/
 
-		/* in case of no events, allow a sleep */
-		if (!eventsProcessed)
-		{
-			/*
-			 * Care must be taken with this instruction here, as it can lead
-			 * to a condition where after being woken up (e.g. by the SysTick)
-			 * and looping through, immediately before entering WFI again
-			 * an interrupt would yield a true condition for the branches below.
-			 * In this case this loop would be blocked until the next IRQ,
-			 * which, in case of a 1ms SysTick timer, could be too late.
-			 * 
-			 * To counter this behaviour, SysTick has been speed up by factor
-			 * four (0.25ms).
-			 */
-#if 0
-			__WFI();
-#endif
-		}
+		/* the SysTick, sensor, UART and I2C handlers signal their events; the core
+		 * only sleeps if none arrived since the fetch at the top of the loop */
+		Events_WaitForAny();
 	}
 
 	return 0;
 }
 
-#endif // 0
\ No newline at end of file
+#endif // !BENCHMARK_FIRMWARE
@@ -1,4 +1,25 @@
-#if 0
+/*
+ * maintest.c
+ *
+ * On-target microbenchmark firmware of the fixed point primitives and the
+ * fusion stages. Built instead of the fusion firmware by "make BENCHMARK=1",
+ * which defines BENCHMARK_FIRMWARE; See main.c.
+ *
+ * Each benchmark is timed in core cycles with the SysTick based counter of
+ * the profiling (see {@see Profile_Cycles()}), the call overhead of an empty
+ * benchmark is subtracted. The results are sent over UART0 as a plain text
+ * table once per {@see BENCHMARK_REPORT_PERIOD}:
+ *
+ *   benchmark              min      avg      max
+ *   fix16_mul               38       38       41
+ *
+ * in cycles per call at the core clock given in the header line. The minimum
+ * is free of interrupts, the maximum includes the SysTick and UART handlers.
+ */
+
+#if BENCHMARK_FIRMWARE
+
+#include <stdint.h>
 
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
@@ -6,29 +27,336 @@
 
 #include "cpu/clock.h"
 #include "cpu/systick.h"
+#include "cpu/delay.h"
+#include "cpu/profile.h"
+#include "comm/uart.h"
+#include "comm/buffer.h"
+#include "comm/io.h"
 
+#include "fixmath.h"
+#include "fixmatrix.h"
+#include "fixkalman.h"
 #include "fixvector3d.h"
-#include "fusion/sensor_calibration.h"
-
+#include "fixquat.h"
+#include "fusion/fix16_fast.h"
 #include "fusion/sensor_fusion.h"
 
-void main()
+#if !PROFILE_ENABLED
+#error The benchmarks are timed with the profiling counters
+#endif
+
+/*!
+* \def BENCHMARK_RUNS The number of timed runs per benchmark
+*/
+#define BENCHMARK_RUNS (16)
+
+/*!
+* \def BENCHMARK_REPORT_PERIOD The period in milliseconds at which the table is repeated
+*/
+#define BENCHMARK_REPORT_PERIOD (5000u) /* ms */
+
+/*!
+* \def BENCHMARK_KALMAN_STATES The number of states of the libfixkalman benchmark filter
+*
+* Bound by the matrix size of the build (FIXMATRIX_MAX_SIZE); The fusion filters
+* themselves use the structure-aware kernels timed by the fusion benchmarks.
+*/
+#define BENCHMARK_KALMAN_STATES (FIXMATRIX_MAX_SIZE)
+
+#define UART_RX_BUFFER_SIZE	(32)				        /*! Size of the UART RX buffer in byte */
+#define UART_TX_BUFFER_SIZE	(64)				        /*! Size of the UART TX buffer in byte */
+static uint8_t uartInputData[UART_RX_BUFFER_SIZE],      /*! The UART RX buffer */
+               uartOutputData[UART_TX_BUFFER_SIZE];     /*! The UART TX buffer */
+static buffer_t uartInputFifo, 						    /*! The UART RX buffer driver */
+		        uartOutputFifo;							/*! The UART TX buffer driver */
+
+/*!
+* \brief A benchmark
+*/
+typedef struct {
+    const char *name;           //!< The name in the table; Up to 20 characters.
+    void (*setup)();            //!< Prepares each run outside of the timing, or NULL
+    void (*run)();              //!< Calls the benchmarked function once
+    uint8_t iterations;         //!< The number of calls per timed run
+} benchmark_t;
+
+/************************************************************************/
+/* Operands                                                             */
+/************************************************************************/
+
+/*!
+* \brief The scalar operands; Volatile, so that the calls are not folded.
+*/
+static volatile fix16_t operand_a = F16(0.7071), operand_b = F16(-1.3), operand_c = F16(2.25);
+
+/*!
+* \brief The sink of the scalar results
+*/
+static volatile fix16_t result;
+
+/*!
+* \brief The matrix operands and result
+*/
+static mf16 matrix_a, matrix_b, matrix_spd, matrix_result;
+
+/*!
+* \brief The libfixkalman benchmark filter
+*/
+static kalman16_uc_t kf;
+
+/*!
+* \brief The libfixkalman benchmark observation
+*/
+static kalman16_observation_t kfm;
+
+/*!
+* \brief The sink of the fusion output
+*/
+static qf16 quaternion;
+
+/************************************************************************/
+/* Benchmarks                                                           */
+/************************************************************************/
+
+static void bench_empty() {}
+
+static void bench_fix16_mul() { result = fix16_mul(operand_a, operand_b); }
+static void bench_fix16_div() { result = fix16_div(operand_a, operand_b); }
+static void bench_fix16_sqrt() { result = fix16_sqrt(operand_c); }
+static void bench_fix16_atan2() { result = fix16_atan2(operand_a, operand_b); }
+
+static void bench_fix16_fast_mul() { result = fix16_fast_mul(operand_a, operand_b); }
+static void bench_fix16_fast_mul_unit() { result = fix16_fast_mul_unit(operand_a, operand_b); }
+static void bench_fix16_fast_rsqrt() { result = fix16_fast_rsqrt(operand_c); }
+static void bench_fix16_fast_atan2() { result = fix16_fast_atan2(operand_a, operand_b); }
+
+static void bench_mf16_mul() { mf16_mul(&matrix_result, &matrix_a, &matrix_b); }
+static void bench_mf16_mul_bt() { mf16_mul_bt(&matrix_result, &matrix_a, &matrix_b); }
+static void bench_mf16_cholesky() { mf16_cholesky(&matrix_result, &matrix_spd); }
+static void bench_mf16_invert_lt() { mf16_invert_lt(&matrix_b, &matrix_result); }
+
+static void bench_kalman_predict_P() { kalman_predict_P_uc(&kf); }
+static void bench_kalman_correct() { kalman_correct_uc(&kf, &kfm); }
+
+static void bench_fusion_predict() { fusion_predict(F16(0.01)); }
+static void bench_fusion_fetch_quaternion() { fusion_fetch_quaternion(&quaternion); }
+
+/*!
+* \brief Registers a sample of each sensor; At rest and level, facing north.
+*/
+static void set_sensors()
+{
+    static const v3d accelerometer = { F16(0.01), F16(-0.02), F16(1) };
+    static const v3d gyroscope = { F16(0.001), F16(-0.002), F16(0.0005) };
+    static const v3d magnetometer = { F16(0.2), F16(0.01), F16(-0.4) };
+    static uint32_t timestamp = 0;
+
+    timestamp += 10000;
+    fusion_set_accelerometer_v3d(&accelerometer, timestamp);
+    fusion_set_gyroscope_v3d(&gyroscope, timestamp);
+    fusion_set_magnetometer_v3d(&magnetometer, timestamp);
+}
+
+static void bench_fusion_update() { fusion_update(F16(0.01)); }
+
+/*!
+* \brief Fills the matrix operands; The SPD matrix is diagonally dominant.
+*/
+static void setup_matrices()
+{
+    matrix_a.rows = matrix_a.columns = FIXMATRIX_MAX_SIZE;
+    matrix_b.rows = matrix_b.columns = FIXMATRIX_MAX_SIZE;
+    matrix_spd.rows = matrix_spd.columns = FIXMATRIX_MAX_SIZE;
+    matrix_a.errors = matrix_b.errors = matrix_spd.errors = 0;
+
+    for (uint_fast8_t r = 0; r < FIXMATRIX_MAX_SIZE; ++r)
+    {
+        for (uint_fast8_t c = 0; c < FIXMATRIX_MAX_SIZE; ++c)
+        {
+            matrix_a.data[r][c] = fix16_from_int(r + 1) / (c + 2);
+            matrix_b.data[r][c] = fix16_from_int(c + 1) / (r + 3);
+            matrix_spd.data[r][c] = (r == c) ? F16(4) : F16(0.5);
+        }
+    }
+}
+
+/*!
+* \brief Decomposes the SPD matrix for the inversion of its lower triangular factor
+*/
+static void setup_invert_lt()
+{
+    setup_matrices();
+    mf16_cholesky(&matrix_result, &matrix_spd);
+}
+
+/*!
+* \brief Resets the libfixkalman filter to a position/velocity like model
+*/
+static void setup_kalman()
+{
+    kalman_filter_initialize_uc(&kf, BENCHMARK_KALMAN_STATES);
+    kalman_observation_initialize(&kfm, BENCHMARK_KALMAN_STATES, BENCHMARK_KALMAN_STATES);
+
+    mf16_fill_diagonal(&kf.A, F16(1));
+    mf16_fill_diagonal(&kf.P, F16(5));
+    mf16_fill_diagonal(&kf.Q, F16(0.01));
+    for (uint_fast8_t i = 0; i + 1 < BENCHMARK_KALMAN_STATES; ++i)
+    {
+        kf.A.data[i][i + 1] = F16(0.01);
+    }
+
+    mf16_fill_diagonal(&kfm.H, F16(1));
+    mf16_fill_diagonal(&kfm.R, F16(0.5));
+    for (uint_fast8_t i = 0; i < BENCHMARK_KALMAN_STATES; ++i)
+    {
+        kfm.z.data[i][0] = F16(0.25);
+    }
+}
+
+/*!
+* \brief The benchmarks in table order
+*/
+static const benchmark_t benchmarks[] = {
+    { "fix16_mul",              NULL,               bench_fix16_mul,                32 },
+    { "fix16_div",              NULL,               bench_fix16_div,                32 },
+    { "fix16_sqrt",             NULL,               bench_fix16_sqrt,               32 },
+    { "fix16_atan2",            NULL,               bench_fix16_atan2,              32 },
+    { "fix16_fast_mul",         NULL,               bench_fix16_fast_mul,           32 },
+    { "fix16_fast_mul_unit",    NULL,               bench_fix16_fast_mul_unit,      32 },
+    { "fix16_fast_rsqrt",       NULL,               bench_fix16_fast_rsqrt,         32 },
+    { "fix16_fast_atan2",       NULL,               bench_fix16_fast_atan2,         32 },
+    { "mf16_mul",               setup_matrices,     bench_mf16_mul,                 4 },
+    { "mf16_mul_bt",            setup_matrices,     bench_mf16_mul_bt,              4 },
+    { "mf16_cholesky",          setup_matrices,     bench_mf16_cholesky,            4 },
+    { "mf16_invert_lt",         setup_invert_lt,    bench_mf16_invert_lt,           1 },
+    { "kalman_predict_P_uc",    setup_kalman,       bench_kalman_predict_P,         1 },
+    { "kalman_correct_uc",      setup_kalman,       bench_kalman_correct,           1 },
+    { "fusion_predict",         NULL,               bench_fusion_predict,           1 },
+    { "fusion_update",          set_sensors,        bench_fusion_update,            1 },
+    { "fusion_fetch_quat",      bench_fusion_predict, bench_fusion_fetch_quaternion, 1 },
+};
+
+/************************************************************************/
+/* Timing                                                               */
+/************************************************************************/
+
+/*!
+* \brief Times one run of a benchmark
+* \param[in] benchmark The benchmark
+* \return The cycles of all calls of the run
+*/
+static uint32_t Measure(const benchmark_t *const benchmark)
+{
+    void (*const run)() = benchmark->run;
+    const uint8_t iterations = benchmark->iterations;
+
+    if (NULL != benchmark->setup) benchmark->setup();
+
+    const uint32_t start = Profile_Cycles();
+    for (uint8_t i = 0; i < iterations; ++i)
+    {
+        run();
+    }
+    return Profile_Cycles() - start;
+}
+
+/*!
+* \brief Sends an unsigned number right-aligned
+* \param[in] value The number
+* \param[in] width The field width
+*/
+static void SendColumn(uint32_t value, uint8_t width)
+{
+    char text[11];
+    uint8_t length = 0;
+    do
+    {
+        text[sizeof(text) - 1 - length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (0 != value && length < sizeof(text));
+
+    while (width-- > length) IO_SendByte(' ');
+    IO_SendString(&text[sizeof(text) - length], length);
+}
+
+/*!
+* \brief Sends a string left-aligned
+* \param[in] text The string
+* \param[in] width The field width
+*/
+static void SendName(const char *const text, uint8_t width)
+{
+    uint8_t length = 0;
+    while (0 != text[length]) ++length;
+
+    IO_SendString(text, length);
+    while (width-- > length) IO_SendByte(' ');
+}
+
+/*!
+* \brief Runs all benchmarks and sends the table
+*/
+static void RunBenchmarks()
+{
+    IO_SendZString("\r\nbenchmark              min      avg      max  cycles at ");
+    SendColumn(ClockCoreFrequency / 1000000u, 0);
+    IO_SendZString(" MHz\r\n");
+
+    for (uint8_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); ++b)
+    {
+        const benchmark_t *const benchmark = &benchmarks[b];
+
+        /* the call and timing overhead, subtracted from each run */
+        const benchmark_t empty = { "", NULL, bench_empty, benchmark->iterations };
+
+        /* the transmit interrupts would show in the timing */
+        RingBuffer_BlockWhileNotEmpty(&uartOutputFifo);
+
+        uint32_t min = UINT32_MAX, max = 0, sum = 0;
+        for (uint8_t r = 0; r < BENCHMARK_RUNS; ++r)
+        {
+            const uint32_t overhead = Measure(&empty);
+            const uint32_t cycles = Measure(benchmark);
+            const uint32_t perCall = (cycles > overhead ? cycles - overhead : 0) / benchmark->iterations;
+
+            if (perCall < min) min = perCall;
+            if (perCall > max) max = perCall;
+            sum += perCall;
+        }
+
+        SendName(benchmark->name, 20);
+        SendColumn(min, 7);
+        SendColumn(sum / BENCHMARK_RUNS, 9);
+        SendColumn(max, 9);
+        IO_SendZString("\r\n");
+    }
+}
+
+/************************************************************************/
+/* Main program                                                         */
+/************************************************************************/
+
+int main(void)
 {
     /* initialize the core clock and the systick timer */
     InitClock();
     InitSysTick();
-    
+
+    /* initialize UART0 and its fifos */
+    InitUart0();
+    RingBuffer_Init(&uartInputFifo, &uartInputData, UART_RX_BUFFER_SIZE);
+    RingBuffer_Init(&uartOutputFifo, &uartOutputData, UART_TX_BUFFER_SIZE);
+    Uart0_InitializeIrq(&uartInputFifo, &uartOutputFifo);
+
     fusion_initialize();
 
-    v3d a = { F16(-0.99976), F16(0.026611), F16(-0.14551) };
+    for (;;)
+    {
+        RunBenchmarks();
+        delay_ms(BENCHMARK_REPORT_PERIOD);
+    }
 
-    mpu6050_calibrate_accelerometer(&a.x, &a.y, &a.z);
-    
-    float x = fix16_to_float(a.x);
-    float y = fix16_to_float(a.y);
-    float z = fix16_to_float(a.z);
-    
-    for (;;) {}
+    return 0;
 }
 
-#endif 
\ No newline at end of file
+#endif // BENCHMARK_FIRMWARE
@@ -5,7 +5,7 @@
 BINARYDIR := Debug
 
 #Additional flags
-PREPROCESSOR_MACROS := DEBUG FIXMATRIX_MAX_SIZE=6 KALMAN_DISABLE_C FIXMATH_NO_CACHE
+PREPROCESSOR_MACROS := DEBUG FIXMATRIX_MAX_SIZE=4 KALMAN_DISABLE_C FIXMATH_NO_CACHE FIX16_FAST_KERNELS
 INCLUDE_DIRS := Project_Headers drivers libraries\libfixmath libraries\libfixmatrix libraries\libfixkalman
 LIBRARY_DIRS := 
 LIBRARY_NAMES := 
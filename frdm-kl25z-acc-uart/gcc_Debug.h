@@ -35,6 +35,7 @@
 #define __cpp_binary_literals 201304
 #define __LLACCUM_MAX__ 0X7FFFFFFFFFFFFFFFP-31LLK
 #define FIXMATH_NO_CACHE 1
+#define FIX16_FAST_KERNELS 1
 #define __GCC_ATOMIC_CHAR32_T_LOCK_FREE 1
 #define __FRACT_FBIT__ 15
 #define __UINT_FAST64_MAX__ 18446744073709551615ULL
@@ -214,7 +215,7 @@
 #define __SIZEOF_PTRDIFF_T__ 4
 #define __LACCUM_EPSILON__ 0x1P-31LK
 #define __DEC32_SUBNORMAL_MIN__ 0.000001E-95DF
-#define FIXMATRIX_MAX_SIZE 6
+#define FIXMATRIX_MAX_SIZE 4
 #define __INT_FAST16_MAX__ 2147483647
 #define __UINT_FAST32_MAX__ 4294967295U
 #define __UINT_LEAST64_TYPE__ long long unsigned int
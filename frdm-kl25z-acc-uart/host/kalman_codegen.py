@@ -0,0 +1,200 @@
+"""
+kalman_codegen.py
+
+Generates the straight-line Kalman kernels of the sensor fusion
+(Project_Headers/fusion/kalman_kernels.h) from a symbolic model of the
+filters in sensor_fusion.c: The sparsity pattern of the transition matrix,
+the states selected by the rows of each observation model and the diagonal
+process and observation noise. Structurally zero terms are not emitted and
+only the upper triangle of the symmetric covariance is calculated.
+
+    python host/kalman_codegen.py > Project_Headers/fusion/kalman_kernels.h
+
+or "make kalman-kernels". Rerun whenever the model below or the filter
+structure in sensor_fusion.c changes.
+
+Created on: Mar 13, 2014
+    Author: Markus
+"""
+
+import sys
+
+# The filter engines, see FUSION_ENGINE in sensor_fusion.h. Each estimates
+# "axes" DCM rows of three components, followed by three angular velocities.
+# The transition matrix is A = [I B; 0 I] with one skew-symmetric block of B
+# per row, whose diagonal is zero; kf->B holds the blocks, kf->q the diagonal of Q.
+# The rows of an observation model each select a single state with unit gain,
+# the observation noise is diagonal, see fusion_observation_t.
+ENGINES = [
+    ("FUSION_ENGINE_DUAL", {
+        "axes": 1,
+        "observations": [
+            ("axis_gyro", "accelerometer and magnetometer: the DCM row, then the angular velocities", [0, 1, 2, 3, 4, 5]),
+            ("gyro", "gyroscope: the angular velocities", [3, 4, 5]),
+        ],
+    }),
+    ("FUSION_ENGINE_JOINT", {
+        "axes": 2,
+        "observations": [
+            ("attitude_gyro", "accelerometer: the attitude row, then the angular velocities", [0, 1, 2, 6, 7, 8]),
+            ("orientation", "magnetometer: the orientation row", [3, 4, 5]),
+            ("gyro", "gyroscope: the angular velocities", [6, 7, 8]),
+        ],
+    }),
+]
+
+INDENT = "    "
+
+
+def packed(n, i, j):
+    """Index of (i, j) in the packed upper triangle of an n x n matrix, see packed_index."""
+    if i > j:
+        i, j = j, i
+    return i * n - (i * (i - 1)) // 2 + (j - i)
+
+
+def transition(axes):
+    """The nonzero off-identity entries of A per row: {row: [(column, expression)]}."""
+    gyro = 3 * axes
+    entries = {}
+    for axis in range(axes):
+        for r in range(3):
+            entries[3 * axis + r] = [(gyro + c, "kf->B[%d][%d][%d]" % (axis, r, c)) for c in range(3) if c != r]
+    return entries
+
+
+def accumulate(first, terms):
+    """Chains fusion_add over a start value and products."""
+    expression = first
+    for a, b in terms:
+        expression = "fusion_add(%s, fusion_mul(%s, %s), *overflow)" % (expression, a, b)
+    return expression
+
+
+def emit_predict(out, n, axes):
+    a = transition(axes)
+    P = lambda i, j: "kf->P[%d]" % packed(n, i, j)
+    T = lambda i, j: ("t%d_%d" % (i, j)) if i in a else P(i, j)
+
+    # T = A*P; Only rows with off-identity entries differ from P.
+    needed = set()
+    for i in range(n):
+        for j in range(i, n):
+            if i in a:
+                needed.add((i, j))
+            for l, _ in a.get(j, []):
+                if i in a:
+                    needed.add((i, l))
+
+    out.append("/*!")
+    out.append("* \\brief Predicts the covariance, P = A*P*A' + Q; Generated.")
+    out.append("* \\param[inout] kf The filter")
+    out.append("* \\param[inout] overflow The flag word of the additions, see {\\ref fix16_fast_add()}")
+    out.append("*/")
+    out.append("HOT NONNULL")
+    out.append("static void fusion_predict_P_generated(fusion_filter_t *const kf, uint32_t *const overflow)")
+    out.append("{")
+    out.append(INDENT + "// T = A*P for the rows coupled to the angular velocities")
+    for i, j in sorted(needed):
+        out.append(INDENT + "const fix16_t %s = %s;" % (T(i, j), accumulate(P(i, j), [(b, P(k, j)) for k, b in a[i]])))
+    out.append("")
+    out.append(INDENT + "// P = T*A' + Q (upper triangle)")
+    for i in range(n):
+        for j in range(i, n):
+            expression = accumulate(T(i, j), [(T(i, l), b) for l, b in a.get(j, [])])
+            if i == j:
+                expression = "fusion_add(%s, kf->q[%d], *overflow)" % (expression, i)
+            if expression != P(i, j):
+                out.append(INDENT + "%s = %s;" % (P(i, j), expression))
+    out.append("}")
+    out.append("")
+
+
+def emit_correct(out, n, name, description, states):
+    P = lambda i, j: "kf->P[%d]" % packed(n, i, j)
+
+    out.append("/*!")
+    out.append("* \\brief Corrects with the %s observation model; Generated." % name)
+    out.append("* \\param[inout] kf The filter")
+    out.append("* \\param[in] z The observation vector")
+    out.append("* \\param[in] r The diagonal of the observation noise")
+    out.append("* \\param[inout] overflow The flag word of the additions, see {\\ref fix16_fast_add()}")
+    out.append("*")
+    out.append("* Observes the %s; States %s." % (description, ", ".join(str(s) for s in states)))
+    out.append("*/")
+    out.append("HOT NONNULL")
+    out.append("static void fusion_correct_%s_generated(fusion_filter_t *const kf, const fix16_t *const z, const fix16_t *const r, uint32_t *const overflow)" % name)
+    out.append("{")
+    for row, s in enumerate(states):
+        if row > 0:
+            out.append("")
+        out.append(INDENT + "// observation %d selects state %d" % (row, s))
+        out.append(INDENT + "{")
+        for j in range(n):
+            out.append(INDENT * 2 + "const fix16_t ph%d = %s;" % (j, P(j, s)))
+        out.append(INDENT * 2 + "const fix16_t inv_s = fix16_div(F16_ONE, fusion_add(ph%d, r[%d], *overflow));" % (s, row))
+        out.append(INDENT * 2 + "const fix16_t innovation = fusion_sub(z[%d], kf->x[%d], *overflow);" % (row, s))
+        for j in range(n):
+            out.append(INDENT * 2 + "const fix16_t k%d = fusion_mul(ph%d, inv_s);" % (j, j))
+        for j in range(n):
+            out.append(INDENT * 2 + "kf->x[%d] = fusion_add(kf->x[%d], fusion_mul(k%d, innovation), *overflow);" % (j, j, j))
+        for j in range(n):
+            for k in range(j, n):
+                out.append(INDENT * 2 + "%s = fusion_sub(%s, fusion_mul(k%d, ph%d), *overflow);" % (P(j, k), P(j, k), j, k))
+        out.append(INDENT + "}")
+    out.append("}")
+    out.append("")
+
+
+def emit_dispatch(out, observations):
+    out.append("/*!")
+    out.append("* \\brief Corrects with the generated kernel matching an observation model")
+    out.append("* \\param[inout] kf The filter")
+    out.append("* \\param[in] kfm The observation")
+    out.append("* \\param[inout] overflow The flag word of the additions, see {\\ref fix16_fast_add()}")
+    out.append("* \\return Nonzero if a kernel matched, zero if the model is not generated")
+    out.append("*/")
+    out.append("HOT NONNULL")
+    out.append("static uint_fast8_t fusion_correct_generated(fusion_filter_t *const kf, const fusion_observation_t *const kfm, uint32_t *const overflow)")
+    out.append("{")
+    for name, _, states in observations:
+        condition = " && ".join(["%d == kfm->count" % len(states)] + ["%d == kfm->state[%d]" % (s, row) for row, s in enumerate(states)])
+        out.append(INDENT + "if (%s)" % condition)
+        out.append(INDENT + "{")
+        out.append(INDENT * 2 + "fusion_correct_%s_generated(kf, kfm->z, kfm->r, overflow);" % name)
+        out.append(INDENT * 2 + "return 1;")
+        out.append(INDENT + "}")
+    out.append(INDENT + "return 0;")
+    out.append("}")
+    out.append("")
+
+
+def main():
+    out = []
+    out.append("/*")
+    out.append("* kalman_kernels.h")
+    out.append("*")
+    out.append("* Straight-line Kalman kernels of the sensor fusion, generated by host/kalman_codegen.py")
+    out.append("* from the filter model; Do not edit. Included by sensor_fusion.c only, after the")
+    out.append("* filter types and the fusion_* arithmetic, see {\\ref FUSION_GENERATED_KERNELS}.")
+    out.append("*/")
+    out.append("")
+    out.append("#ifndef KALMAN_KERNELS_H_")
+    out.append("#define KALMAN_KERNELS_H_")
+    out.append("")
+    for index, (engine, model) in enumerate(ENGINES):
+        n = 3 * model["axes"] + 3
+        out.append("%s FUSION_ENGINE == %s" % ("#if" if index == 0 else "#elif", engine))
+        out.append("")
+        emit_predict(out, n, model["axes"])
+        for name, description, states in model["observations"]:
+            emit_correct(out, n, name, description, states)
+        emit_dispatch(out, model["observations"])
+    out.append("#endif")
+    out.append("")
+    out.append("#endif /* KALMAN_KERNELS_H_ */")
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,238 @@
+"""
+p2pbench.py
+
+End-to-end latency and throughput benchmark of the serial link. The ping
+test sends timestamped COMMAND_PING frames and matches the echo frames,
+which carry the receive and transmit times of the firmware, to report the
+round-trip time, the time spent in the firmware and the one-way estimate.
+The stream test selects each output mode at each baud rate, enables the
+latch-to-transmit delay of OUTPUT_TIMING_LATENCY and reports the fused
+frames per second and the delay distribution; The airtime of each frame is
+added, so the delay is that from the sample latch to the last byte on the
+wire. Both use the P2PPE framing and the native decoder (p2ppd.py).
+
+    python host/p2pbench.py ping /dev/ttyACM0 [--baud 115200] [--count 1000]
+    python host/p2pbench.py stream /dev/ttyACM0 [--baud 115200] [--bauds 115200,230400] [--modes 43,45] [--seconds 5]
+
+Rerun both after every change to the communication path.
+
+Created on: Mar 13, 2014
+    Author: Markus
+"""
+
+import struct
+import sys
+import time
+
+# the commands and frame types, see command.h
+COMMAND_SET_OUTPUT_MODE = 0x01
+COMMAND_START_STREAMING = 0x05
+COMMAND_STOP_STREAMING = 0x06
+COMMAND_SET_BAUD_RATE = 0x0F
+COMMAND_SET_OUTPUT_TIMING = 0x13
+COMMAND_PING = 0x14
+
+COMMAND_ACK_FRAME_TYPE = 0x11
+COMMAND_ECHO_FRAME_TYPE = 0x14
+COMMAND_OK = 0
+
+# the output modes and their frame types, see output_mode.h
+OUTPUT_MODES = {
+    0: ("SENSORS_RAW", (0,)),
+    42: ("RPY", (42,)),
+    43: ("QUATERNION", (43,)),
+    44: ("QUATERNION_RPY", (44,)),
+    45: ("QUATERNION_COMPACT", (45,)),
+    46: ("RPY_COMPACT", (46,)),
+    47: ("QUATERNION_DELTA", (47, 48)),
+    49: ("RATES_ACCELERATION", (49,)),
+    50: ("QUATERNION_RATES_ACCELERATION", (50,)),
+}
+
+OUTPUT_TIMING_LATENCY = 0x04
+
+# the P2PPE framing, see p2pprotocol.c
+PREAMBLE = b"\xDA\x7A"
+SOH = 0x01
+EOT = 0x04
+ESC = 0x1B
+ESC_XOR = 0x42
+FRAME_OVERHEAD = len(PREAMBLE) + 3  # SOH, length and EOT
+BITS_PER_BYTE = 10
+
+ACK_TIMEOUT = 0.5  # s
+
+
+def now():
+    """A monotonic host time in microseconds."""
+    return int(time.perf_counter() * 1000000)
+
+
+def encode(payload):
+    """Encodes a command payload as a P2PPE frame; The length is not escaped."""
+    out = bytearray(PREAMBLE)
+    out.append(SOH)
+    out.append(len(payload))
+    for byte in bytearray(payload):
+        if byte == EOT or byte == ESC:
+            out.append(ESC)
+            byte ^= ESC_XOR
+        out.append(byte)
+    out.append(EOT)
+    return bytes(out)
+
+
+def airtime(frame, baud):
+    """The time it took to send a decoded frame in microseconds, ignoring escapes."""
+    return (FRAME_OVERHEAD + 1 + len(frame.data)) * BITS_PER_BYTE * 1000000 // baud
+
+
+def percentiles(values):
+    """Formats the minimum, the median, the 90th and 99th percentile and the maximum."""
+    if not values:
+        return "no samples"
+    values = sorted(values)
+    pick = lambda p: values[min(len(values) - 1, int(p * len(values)))]
+    return "min %d, p50 %d, p90 %d, p99 %d, max %d us" % (values[0], pick(0.5), pick(0.9), pick(0.99), values[-1])
+
+
+class Link(object):
+    """A serial port with the native decoder and the acknowledged commands."""
+
+    def __init__(self, port, baud):
+        import serial
+        from p2ppd import Decoder
+
+        self.line = serial.Serial(port, baud, timeout=0.01)
+        self.decoder = Decoder()
+
+    def close(self):
+        self.line.close()
+
+    def send(self, command, args=b""):
+        self.line.write(encode(bytes(bytearray([command])) + args))
+
+    def frames(self):
+        """Yields the frames decoded from one read along with the host receive time."""
+        chunk = self.line.read(4096)
+        received = now()
+        for frame in self.decoder.feed(chunk):
+            yield received, frame
+
+    def request(self, command, args=b""):
+        """Sends a command and waits for its acknowledge; Other frames are discarded."""
+        self.send(command, args)
+        deadline = time.time() + ACK_TIMEOUT
+        while time.time() < deadline:
+            for _, frame in self.frames():
+                if frame.type == COMMAND_ACK_FRAME_TYPE and bytearray(frame.data)[0] == command:
+                    status = bytearray(frame.data)[1]
+                    if status != COMMAND_OK:
+                        raise RuntimeError("command 0x%02X failed with status %d" % (command, status))
+                    return
+        raise RuntimeError("command 0x%02X was not acknowledged" % command)
+
+    def set_baud(self, baud):
+        """Switches both ends to a baud rate; The firmware acknowledges at the old one."""
+        if baud == self.line.baudrate:
+            return
+        self.request(COMMAND_SET_BAUD_RATE, struct.pack("<I", baud))
+        time.sleep(0.05)
+        self.line.baudrate = baud
+        self.line.reset_input_buffer()
+
+    def drain(self, seconds=0.1):
+        deadline = time.time() + seconds
+        while time.time() < deadline:
+            for _ in self.frames():
+                pass
+
+
+def ping(link, count):
+    """Sends pings one at a time and reports the latency distribution."""
+    link.request(COMMAND_STOP_STREAMING)
+    link.drain()
+
+    round_trips, residences, lost = [], [], 0
+    for index in range(count):
+        sent = now()
+        link.send(COMMAND_PING, struct.pack("<QI", sent, index))
+        deadline = time.time() + ACK_TIMEOUT
+        echo = None
+        while echo is None and time.time() < deadline:
+            for received, frame in link.frames():
+                if frame.type != COMMAND_ECHO_FRAME_TYPE or len(frame.data) != 20:
+                    continue
+                receive_time, transmit_time, sent_time, echoed = struct.unpack("<IIQI", frame.data)
+                if echoed == index and sent_time == sent:
+                    echo = (received - sent, (transmit_time - receive_time) & 0xFFFFFFFF)
+        if echo is None:
+            lost += 1
+            continue
+        round_trips.append(echo[0])
+        residences.append(echo[1])
+
+    one_way = [(rtt - residence) // 2 for rtt, residence in zip(round_trips, residences)]
+    print("%d pings at %d baud, %d lost" % (count, link.line.baudrate, lost))
+    print("  round trip: %s" % percentiles(round_trips))
+    print("  firmware:   %s" % percentiles(residences))
+    print("  one way:    %s" % percentiles(one_way))
+
+
+def stream(link, bauds, modes, seconds):
+    """Streams each output mode at each baud rate and reports the throughput and the delay."""
+    link.request(COMMAND_SET_OUTPUT_TIMING, struct.pack("<B", OUTPUT_TIMING_LATENCY))
+    try:
+        for baud in bauds:
+            link.request(COMMAND_STOP_STREAMING)
+            link.set_baud(baud)
+            for mode in modes:
+                name, types = OUTPUT_MODES[mode]
+                link.request(COMMAND_SET_OUTPUT_MODE, struct.pack("<B", mode))
+                link.request(COMMAND_START_STREAMING)
+                link.drain()
+
+                frames, delays = 0, []
+                start = time.time()
+                while time.time() - start < seconds:
+                    for _, frame in link.frames():
+                        if frame.type not in types or len(frame.data) < 4:
+                            continue
+                        frames += 1
+                        delay = struct.unpack("<I", frame.data[-4:])[0]
+                        delays.append(delay + airtime(frame, baud))
+                elapsed = time.time() - start
+
+                link.request(COMMAND_STOP_STREAMING)
+                print("%7d baud %-30s %8.1f frames/s, latch to host: %s" % (baud, name, frames / elapsed, percentiles(delays)))
+    finally:
+        link.request(COMMAND_SET_OUTPUT_TIMING, struct.pack("<B", 0))
+
+
+def option(options, name, default):
+    return options[options.index(name) + 1] if name in options else default
+
+
+def main(argv):
+    if len(argv) < 3 or argv[1] not in ("ping", "stream"):
+        print(__doc__.strip().split("\n\n")[2])
+        return 2
+
+    options = argv[3:]
+    baud = int(option(options, "--baud", "115200"))
+    link = Link(argv[2], baud)
+    try:
+        if argv[1] == "ping":
+            ping(link, int(option(options, "--count", "1000")))
+        else:
+            bauds = [int(b) for b in option(options, "--bauds", str(baud)).split(",")]
+            modes = [int(m) for m in option(options, "--modes", ",".join(str(m) for m in sorted(OUTPUT_MODES))).split(",")]
+            stream(link, bauds, modes, float(option(options, "--seconds", "5")))
+            link.set_baud(baud)
+    finally:
+        link.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,269 @@
+/*
+ * p2plog.c
+ *
+ *  Created on: Mar 13, 2014
+ *      Author: Markus
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "p2plog.h"
+
+/**
+ * @brief The size of the data of index and end records
+ */
+#define INDEX_SIZE			(sizeof(p2plog_index_t))
+
+/**
+ * @brief Rounds a data length up to the record alignment
+ * @param[in] length The length
+ * @return The padded length
+ */
+static size_t padded(size_t length)
+{
+	return (length + P2PLOG_ALIGNMENT - 1) & ~(size_t)(P2PLOG_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Fetches the record at an offset
+ * @param[in] reader The reader
+ * @param[in] offset The file offset
+ * @return The record or NULL if it does not fit in the mapping
+ */
+static const p2plog_record_t *recordAt(const p2plog_reader_t *const reader, size_t offset)
+{
+	if (offset > reader->size || reader->size - offset < sizeof(p2plog_record_t)) return NULL;
+
+	const p2plog_record_t *const record = (const p2plog_record_t*)(reader->base + offset);
+	if (reader->size - offset - sizeof(p2plog_record_t) < record->length) return NULL;
+	return record;
+}
+
+/**
+ * @brief Appends an index offset
+ * @param[inout] reader The reader
+ * @param[in] offset The offset
+ * @param[inout] capacity The capacity of the index array
+ * @return Zero on success
+ */
+static int appendIndex(p2plog_reader_t *const reader, size_t offset, size_t *const capacity)
+{
+	if (reader->index_count == *capacity)
+	{
+		*capacity = (0 == *capacity) ? 64 : 2 * *capacity;
+		size_t *const grown = realloc(reader->index, *capacity * sizeof(size_t));
+		if (NULL == grown) return 1;
+		reader->index = grown;
+	}
+	reader->index[reader->index_count++] = offset;
+	return 0;
+}
+
+/**
+ * @brief Loads the index by following the chain from the end record
+ * @param[inout] reader The reader
+ * @return Zero on success, nonzero if the log has no valid end record
+ */
+static int loadChainedIndex(p2plog_reader_t *const reader)
+{
+	const size_t tail = sizeof(p2plog_record_t) + INDEX_SIZE;
+	if (reader->size < reader->header->header_size + tail) return 1;
+
+	const p2plog_record_t *record = recordAt(reader, reader->size - tail);
+	if (NULL == record || P2PLOG_RECORD_END != record->kind || INDEX_SIZE != record->length) return 1;
+
+	/* count the chain first, so that the offsets can be stored in file order */
+	size_t count = 0;
+	uint64_t offset = ((const p2plog_index_t*)(record + 1))->previous;
+	while (0 != offset)
+	{
+		record = recordAt(reader, (size_t)offset);
+		if (NULL == record || P2PLOG_RECORD_INDEX != record->kind || INDEX_SIZE != record->length) return 1;
+
+		const uint64_t previous = ((const p2plog_index_t*)(record + 1))->previous;
+		if (previous >= offset) return 1;
+		offset = previous;
+		++count;
+	}
+
+	reader->index = malloc((count > 0 ? count : 1) * sizeof(size_t));
+	if (NULL == reader->index) return 1;
+	reader->index_count = count;
+
+	record = recordAt(reader, reader->size - tail);
+	offset = ((const p2plog_index_t*)(record + 1))->previous;
+	while (0 != offset)
+	{
+		reader->index[--count] = (size_t)offset;
+		offset = ((const p2plog_index_t*)(reader->base + offset + sizeof(p2plog_record_t)))->previous;
+	}
+	return 0;
+}
+
+/**
+ * @brief Loads the index of a log that was not closed by scanning the record headers
+ * @param[inout] reader The reader
+ * @return Zero on success
+ *
+ * The mapping is shortened to the last complete record.
+ */
+static int scanIndex(p2plog_reader_t *const reader)
+{
+	size_t capacity = 0;
+	size_t offset = reader->header->header_size;
+	const p2plog_record_t *record;
+
+	while (NULL != (record = recordAt(reader, offset)))
+	{
+		if (P2PLOG_RECORD_INDEX == record->kind && 0 != appendIndex(reader, offset, &capacity)) return 1;
+		offset += sizeof(p2plog_record_t) + padded(record->length);
+	}
+
+	if (offset < reader->size) reader->size = offset;
+	return 0;
+}
+
+/**
+ * @brief Maps a log and loads its index
+ * @param[out] reader The reader
+ * @param[in] path The file path
+ * @return Zero on success, nonzero if the file cannot be mapped or is no log
+ */
+int P2PLog_Open(p2plog_reader_t *const reader, const char *const path)
+{
+	memset(reader, 0, sizeof(*reader));
+
+	const int file = open(path, O_RDONLY);
+	if (file < 0) return 1;
+
+	struct stat status;
+	if (0 != fstat(file, &status) || (size_t)status.st_size < sizeof(p2plog_header_t))
+	{
+		close(file);
+		return 1;
+	}
+
+	void *const base = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (MAP_FAILED == base) return 1;
+
+	reader->base = base;
+	reader->mapped = (size_t)status.st_size;
+	reader->size = reader->mapped;
+	reader->header = (const p2plog_header_t*)base;
+
+	if (0 != memcmp(reader->header->magic, P2PLOG_MAGIC, sizeof(reader->header->magic))
+		|| P2PLOG_VERSION != reader->header->version
+		|| reader->header->header_size < sizeof(p2plog_header_t)
+		|| reader->header->header_size > reader->size)
+	{
+		P2PLog_Close(reader);
+		return 1;
+	}
+
+	if (0 != loadChainedIndex(reader))
+	{
+		free(reader->index);
+		reader->index = NULL;
+		reader->index_count = 0;
+
+		if (0 != scanIndex(reader))
+		{
+			P2PLog_Close(reader);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Unmaps a log
+ * @param[inout] reader The reader
+ */
+void P2PLog_Close(p2plog_reader_t *const reader)
+{
+	if (NULL != reader->base)
+	{
+		munmap((void*)reader->base, reader->mapped);
+	}
+	free(reader->index);
+	memset(reader, 0, sizeof(*reader));
+}
+
+/**
+ * @brief The cursor of the first record
+ * @param[in] reader The reader
+ * @return The cursor
+ */
+size_t P2PLog_Begin(const p2plog_reader_t *const reader)
+{
+	return reader->header->header_size;
+}
+
+/**
+ * @brief Reads the next frame
+ * @param[in] reader The reader
+ * @param[inout] cursor The file offset to read from; Advanced past the frame.
+ * @param[out] frame The frame
+ * @return Nonzero if a frame was read
+ */
+int P2PLog_Next(const p2plog_reader_t *const reader, size_t *const cursor, p2plog_frame_t *const frame)
+{
+	const p2plog_record_t *record;
+	while (NULL != (record = recordAt(reader, *cursor)))
+	{
+		*cursor += sizeof(p2plog_record_t) + padded(record->length);
+		if (P2PLOG_RECORD_FRAME != record->kind) continue;
+
+		frame->time = record->time;
+		frame->sequence = record->sequence;
+		frame->type = record->type;
+		frame->length = record->length;
+		frame->data = (const uint8_t*)(record + 1);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Finds the first frame received at or after a time
+ * @param[in] reader The reader
+ * @param[in] time The host time, microseconds since the Unix epoch
+ * @return The cursor of that frame, the end of the log if there is none
+ */
+size_t P2PLog_Seek(const p2plog_reader_t *const reader, uint64_t time)
+{
+	/* the last index point not later than the time */
+	size_t cursor = P2PLog_Begin(reader);
+	size_t low = 0, high = reader->index_count;
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (recordAt(reader, reader->index[middle])->time <= time)
+		{
+			cursor = reader->index[middle];
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	/* the frames are in receive order */
+	p2plog_frame_t frame;
+	size_t next = cursor;
+	while (P2PLog_Next(reader, &next, &frame))
+	{
+		if (frame.time >= time) return cursor;
+		cursor = next;
+	}
+	return reader->size;
+}
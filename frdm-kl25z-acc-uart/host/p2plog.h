@@ -0,0 +1,163 @@
+/*
+ * p2plog.h
+ *
+ * Indexed binary capture log of the frames received from the firmware.
+ * The log is append-only, so that hour-long sessions are streamed to disk
+ * as they arrive, and laid out to be memory-mapped by the readers:
+ *
+ *   header | record | record | ... | index | record | ... | index | ... | end
+ *
+ * Each record is a {@see p2plog_record_t} followed by its data, padded to
+ * {@see P2PLOG_ALIGNMENT}. Frame records hold the decoded payload of one frame,
+ * index records are written once per index period and chain back to the
+ * previous one, and the end record written on close points to the last index.
+ * A log without an end record (e.g. after a crash) is indexed by a forward
+ * scan over the record headers instead.
+ *
+ * All values are little endian. The recorder is host/p2plog.py, which also
+ * provides a Python reader; The replay benchmark reads the logs with the
+ * reader declared here.
+ *
+ *  Created on: Mar 13, 2014
+ *      Author: Markus
+ */
+
+#ifndef P2PLOG_H_
+#define P2PLOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The magic bytes at the start of a log
+ */
+#define P2PLOG_MAGIC				"P2PLOG\r\n"
+
+/**
+ * @brief The format version
+ */
+#define P2PLOG_VERSION				(1)
+
+/**
+ * @brief The alignment of the records in bytes
+ */
+#define P2PLOG_ALIGNMENT			(8)
+
+/**
+ * @brief The record kinds
+ */
+typedef enum {
+	P2PLOG_RECORD_FRAME = 0,		/*< A received frame; The data is the frame payload following the type */
+	P2PLOG_RECORD_INDEX = 1,		/*< An index point; The data is a {@see p2plog_index_t} */
+	P2PLOG_RECORD_END = 2			/*< The end of a closed log; The data is a {@see p2plog_index_t} */
+} p2plog_kind_t;
+
+/**
+ * @brief The file header
+ */
+typedef struct __attribute__ ((__packed__)) {
+	char magic[8];					/*< {@see P2PLOG_MAGIC} */
+	uint16_t version;				/*< {@see P2PLOG_VERSION} */
+	uint16_t header_size;			/*< The size of this header; The first record follows it. */
+	uint32_t index_period;			/*< The host time between two index records in microseconds */
+	uint64_t start_time;			/*< The host time the log was started at, microseconds since the Unix epoch */
+	uint8_t trailer;				/*< Nonzero if the frames carried the sequence trailer, so that the sequence numbers are valid */
+	uint8_t reserved[7];			/*< Zero */
+} p2plog_header_t;
+
+/**
+ * @brief The header of a record
+ */
+typedef struct __attribute__ ((__packed__)) {
+	uint64_t time;					/*< The host time the frame was received at, microseconds since the Unix epoch */
+	uint16_t length;				/*< The number of data bytes following, without the padding */
+	uint16_t sequence;				/*< The frame sequence number, see {@see p2plog_header_t::trailer} */
+	uint8_t kind;					/*< The {@see p2plog_kind_t} */
+	uint8_t type;					/*< The frame type of frame records */
+	uint16_t reserved;				/*< Zero */
+} p2plog_record_t;
+
+/**
+ * @brief The data of index and end records
+ */
+typedef struct __attribute__ ((__packed__)) {
+	uint64_t previous;				/*< The file offset of the previous index record, zero if none */
+	uint64_t frames;				/*< The number of frame records before this record */
+} p2plog_index_t;
+
+/**
+ * @brief A frame read from a log
+ *
+ * The data points into the mapping and is valid until the reader is closed.
+ */
+typedef struct {
+	uint64_t time;					/*< The host receive time, microseconds since the Unix epoch */
+	uint16_t sequence;				/*< The frame sequence number */
+	uint8_t type;					/*< The frame type */
+	uint16_t length;				/*< The number of data bytes */
+	const uint8_t *data;			/*< The data following the type */
+} p2plog_frame_t;
+
+/**
+ * @brief A memory-mapped log
+ */
+typedef struct {
+	const uint8_t *base;			/*< The mapping */
+	size_t mapped;					/*< The size of the mapping */
+	size_t size;					/*< The size of the log; Excludes a truncated last record. */
+	const p2plog_header_t *header;	/*< The file header */
+	size_t *index;					/*< The offsets of the index records in file order */
+	size_t index_count;				/*< The number of index records */
+} p2plog_reader_t;
+
+/**
+ * @brief Maps a log and loads its index
+ * @param[out] reader The reader
+ * @param[in] path The file path
+ * @return Zero on success, nonzero if the file cannot be mapped or is no log
+ */
+int P2PLog_Open(p2plog_reader_t *const reader, const char *const path);
+
+/**
+ * @brief Unmaps a log
+ * @param[inout] reader The reader
+ */
+void P2PLog_Close(p2plog_reader_t *const reader);
+
+/**
+ * @brief The cursor of the first record
+ * @param[in] reader The reader
+ * @return The cursor, see {@see P2PLog_Next()}
+ */
+size_t P2PLog_Begin(const p2plog_reader_t *const reader);
+
+/**
+ * @brief Reads the next frame
+ * @param[in] reader The reader
+ * @param[inout] cursor The file offset to read from; Advanced past the frame.
+ * @param[out] frame The frame; Only valid if the return value is nonzero.
+ * @return Nonzero if a frame was read, zero at the end of the log
+ *
+ * Index and end records are skipped.
+ */
+int P2PLog_Next(const p2plog_reader_t *const reader, size_t *const cursor, p2plog_frame_t *const frame);
+
+/**
+ * @brief Finds the first frame received at or after a time
+ * @param[in] reader The reader
+ * @param[in] time The host time, microseconds since the Unix epoch
+ * @return The cursor of that frame, the end of the log if there is none
+ *
+ * Binary searches the index, then scans at most one index period of records.
+ */
+size_t P2PLog_Seek(const p2plog_reader_t *const reader, uint64_t time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* P2PLOG_H_ */
@@ -0,0 +1,259 @@
+"""
+p2plog.py
+
+Writer, memory-mapped reader and serial recorder of the indexed binary
+capture logs; See p2plog.h for the format. The recorder decodes the stream
+with the native decoder (p2ppd.py) and appends every raw and fused frame
+with its host receive time, writing an index record once per second, so
+that hour-long sessions at full rate are streamed to disk instead of being
+buffered in memory.
+
+    python host/p2plog.py record /dev/ttyACM0 session.p2plog [--baud 115200] [--trailer]
+    python host/p2plog.py info session.p2plog
+
+    from p2plog import Reader
+    with Reader("session.p2plog") as log:
+        for frame in log.frames(start=log.start_time + 60 * 1000000):
+            print(frame.time, frame.type, len(frame.data))
+
+The logs are also the input of the replay benchmark, see host/replay.c.
+
+Created on: Mar 13, 2014
+    Author: Markus
+"""
+
+import mmap
+import struct
+import sys
+import time
+
+MAGIC = b"P2PLOG\r\n"
+VERSION = 1
+ALIGNMENT = 8
+
+RECORD_FRAME = 0
+RECORD_INDEX = 1
+RECORD_END = 2
+
+# little endian layouts of p2plog_header_t, p2plog_record_t and p2plog_index_t
+_HEADER = struct.Struct("<8sHHIQB7x")
+_RECORD = struct.Struct("<QHHBBH")
+_INDEX = struct.Struct("<QQ")
+
+DEFAULT_INDEX_PERIOD = 1000000  # us
+
+
+def _padding(length):
+    return -length % ALIGNMENT
+
+
+def now():
+    """The host time in microseconds since the Unix epoch."""
+    return int(time.time() * 1000000)
+
+
+class Frame(object):
+    """A logged frame; data is the payload following the type."""
+
+    def __init__(self, time, type, sequence, data):
+        self.time = time
+        self.type = type
+        self.sequence = sequence
+        self.data = data
+
+
+class Writer(object):
+    """Appends frames to a new log; Close it to write the end record."""
+
+    def __init__(self, path, trailer=False, index_period=DEFAULT_INDEX_PERIOD, start_time=None):
+        self._file = open(path, "wb")
+        self._index_period = index_period
+        self._offset = 0
+        self._last_index = 0
+        self._next_index = None
+        self._frames = 0
+        self.start_time = now() if start_time is None else start_time
+        self._write(_HEADER.pack(MAGIC, VERSION, _HEADER.size, index_period, self.start_time, 1 if trailer else 0))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _write(self, data):
+        self._file.write(data)
+        self._offset += len(data)
+
+    def _record(self, kind, time, data, type=0, sequence=0):
+        offset = self._offset
+        self._write(_RECORD.pack(time, len(data), sequence, kind, type, 0))
+        self._write(data + b"\0" * _padding(len(data)))
+        return offset
+
+    def write(self, type, data, sequence=0, time=None):
+        """Appends a frame received at the given host time, now by default."""
+        time = now() if time is None else time
+        if self._next_index is None or time >= self._next_index:
+            self._last_index = self._record(RECORD_INDEX, time, _INDEX.pack(self._last_index, self._frames))
+            self._next_index = time + self._index_period
+        self._record(RECORD_FRAME, time, bytes(data), type, sequence)
+        self._frames += 1
+
+    def flush(self):
+        self._file.flush()
+
+    def close(self):
+        if self._file.closed:
+            return
+        self._record(RECORD_END, now(), _INDEX.pack(self._last_index, self._frames))
+        self._file.close()
+
+
+class Reader(object):
+    """A memory-mapped log; Logs that were not closed are indexed by a scan."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, header_size, self.index_period, self.start_time, trailer = _HEADER.unpack_from(self._map, 0)
+        if magic != MAGIC or version != VERSION or header_size < _HEADER.size:
+            self._map.close()
+            raise ValueError("%s is no capture log" % path)
+        self.trailer = bool(trailer)
+        self._begin = header_size
+        self._size = len(self._map)
+        self.index = self._chained_index()
+        if self.index is None:
+            self.index = self._scan_index()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        self._map.close()
+
+    def _record(self, offset):
+        """Returns (time, length, sequence, kind, type) or None past the end."""
+        if offset + _RECORD.size > self._size:
+            return None
+        time, length, sequence, kind, type, _ = _RECORD.unpack_from(self._map, offset)
+        if offset + _RECORD.size + length > self._size:
+            return None
+        return time, length, sequence, kind, type
+
+    def _chained_index(self):
+        tail = self._size - _RECORD.size - _INDEX.size
+        record = self._record(tail) if tail >= self._begin else None
+        if record is None or record[3] != RECORD_END or record[1] != _INDEX.size:
+            return None
+        offsets = []
+        offset = _INDEX.unpack_from(self._map, tail + _RECORD.size)[0]
+        while offset:
+            record = self._record(offset)
+            if record is None or record[3] != RECORD_INDEX:
+                return None
+            offsets.append(offset)
+            previous = _INDEX.unpack_from(self._map, offset + _RECORD.size)[0]
+            if previous >= offset:
+                return None
+            offset = previous
+        offsets.reverse()
+        return offsets
+
+    def _scan_index(self):
+        offsets = []
+        offset = self._begin
+        while True:
+            record = self._record(offset)
+            if record is None:
+                break
+            if record[3] == RECORD_INDEX:
+                offsets.append(offset)
+            offset += _RECORD.size + record[1] + _padding(record[1])
+        self._size = offset
+        return offsets
+
+    def seek(self, time):
+        """The offset of the last index point not later than the host time."""
+        low, high, offset = 0, len(self.index), self._begin
+        while low < high:
+            middle = (low + high) // 2
+            if self._record(self.index[middle])[0] <= time:
+                offset = self.index[middle]
+                low = middle + 1
+            else:
+                high = middle
+        return offset
+
+    def frames(self, start=None, end=None):
+        """Yields the frames received from the start to before the end host time."""
+        offset = self._begin if start is None else self.seek(start)
+        while True:
+            record = self._record(offset)
+            if record is None:
+                return
+            time, length, sequence, kind, type = record
+            data_offset = offset + _RECORD.size
+            offset = data_offset + length + _padding(length)
+            if kind != RECORD_FRAME or (start is not None and time < start):
+                continue
+            if end is not None and time >= end:
+                return
+            yield Frame(time, type, sequence, self._map[data_offset:data_offset + length])
+
+
+def record(port, path, baud=115200, trailer=False):
+    """Records the frames received on a serial port until interrupted."""
+    import serial
+    from p2ppd import Decoder
+
+    decoder = Decoder(trailer=trailer)
+    with serial.Serial(port, baud, timeout=0.1) as line, Writer(path, trailer=trailer) as log:
+        flushed = now()
+        try:
+            while True:
+                chunk = line.read(4096)
+                received = now()
+                for frame in decoder.feed(chunk):
+                    log.write(frame.type, frame.data, frame.sequence, received)
+                if received - flushed >= DEFAULT_INDEX_PERIOD:
+                    log.flush()
+                    flushed = received
+        except KeyboardInterrupt:
+            pass
+    print(decoder.statistics)
+
+
+def info(path):
+    """Prints the duration, the frame counts per type and the index of a log."""
+    with Reader(path) as log:
+        counts, first, last = {}, None, None
+        for frame in log.frames():
+            counts[frame.type] = counts.get(frame.type, 0) + 1
+            first = frame.time if first is None else first
+            last = frame.time
+        duration = (last - first) / 1e6 if first is not None else 0.0
+        print("%s: %.1f s, %d index points, trailer %s" % (path, duration, len(log.index), log.trailer))
+        for type in sorted(counts):
+            print("  type %3d: %d frames" % (type, counts[type]))
+
+
+def main(argv):
+    if len(argv) >= 4 and argv[1] == "record":
+        options = argv[4:]
+        baud = int(options[options.index("--baud") + 1]) if "--baud" in options else 115200
+        record(argv[2], argv[3], baud, "--trailer" in options)
+    elif len(argv) == 3 and argv[1] == "info":
+        info(argv[2])
+    else:
+        print(__doc__.strip().split("\n\n")[2])
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
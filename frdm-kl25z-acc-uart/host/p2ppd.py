@@ -0,0 +1,140 @@
+"""
+p2ppd.py
+
+Python wrapper of the host-side P2PPE decoder (p2ppd_host.h) via ctypes.
+Build the library with "make host-decoder" first; It is looked up next to this
+file, in Debug/host and Release/host, or at the path given to Decoder().
+
+    from p2ppd import Decoder
+    decoder = Decoder(trailer=False)
+    for frame in decoder.feed(port.read(4096)):
+        print(frame.type, frame.values)
+
+Created on: Mar 10, 2014
+    Author: Markus
+"""
+
+import ctypes
+import os
+
+P2PHOST_MAX_PAYLOAD = 255
+
+# the output modes with typed accessors, see output_mode.h
+SENSORS_RAW = 0
+RPY = 42
+QUATERNION = 43
+QUATERNION_RPY = 44
+
+
+class _Frame(ctypes.Structure):
+    _fields_ = [("type", ctypes.c_uint8),
+                ("length", ctypes.c_uint8),
+                ("sequence", ctypes.c_uint16),
+                ("data", ctypes.POINTER(ctypes.c_uint8))]
+
+
+class _Statistics(ctypes.Structure):
+    _fields_ = [("frames", ctypes.c_uint32),
+                ("malformed", ctypes.c_uint32),
+                ("crc_errors", ctypes.c_uint32),
+                ("lost", ctypes.c_uint32)]
+
+
+class _FirmwareDecoder(ctypes.Structure):
+    _fields_ = [("buffer", ctypes.POINTER(ctypes.c_uint8)),
+                ("size", ctypes.c_uint8),
+                ("state", ctypes.c_uint8),
+                ("length", ctypes.c_uint8),
+                ("count", ctypes.c_uint8),
+                ("escaped", ctypes.c_uint8)]
+
+
+class _Decoder(ctypes.Structure):
+    _fields_ = [("decoder", _FirmwareDecoder),
+                ("buffer", ctypes.c_uint8 * P2PHOST_MAX_PAYLOAD),
+                ("trailer", ctypes.c_uint8),
+                ("synchronized", ctypes.c_uint8),
+                ("next_sequence", ctypes.c_uint16),
+                ("statistics", _Statistics)]
+
+
+class Frame(object):
+    """A decoded frame; values holds the typed content of the output modes 0, 42, 43 and 44, else None."""
+
+    def __init__(self, type, sequence, data, values):
+        self.type = type
+        self.sequence = sequence
+        self.data = data
+        self.values = values
+
+
+def _load(path):
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates = [path] if path else [os.path.join(here, "libp2ppd.so"),
+                                      os.path.join(here, "..", "Release", "host", "libp2ppd.so"),
+                                      os.path.join(here, "..", "Debug", "host", "libp2ppd.so")]
+    for candidate in candidates:
+        if os.path.exists(candidate):
+            library = ctypes.CDLL(candidate)
+            break
+    else:
+        raise OSError("libp2ppd.so not found, build it with 'make host-decoder'")
+
+    double3 = ctypes.c_double * 3
+    double4 = ctypes.c_double * 4
+    library.P2PHost_Init.argtypes = [ctypes.POINTER(_Decoder), ctypes.c_uint8]
+    library.P2PHost_Decode.argtypes = [ctypes.POINTER(_Decoder), ctypes.c_void_p, ctypes.c_size_t,
+                                       ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(_Frame)]
+    library.P2PHost_Decode.restype = ctypes.c_int
+    library.P2PHost_SensorsRaw.argtypes = [ctypes.POINTER(_Frame), double3, double3]
+    library.P2PHost_Rpy.argtypes = [ctypes.POINTER(_Frame), double3]
+    library.P2PHost_Quaternion.argtypes = [ctypes.POINTER(_Frame), double4]
+    library.P2PHost_QuaternionRpy.argtypes = [ctypes.POINTER(_Frame), double4, double3]
+    return library
+
+
+class Decoder(object):
+    """A streaming decoder of one board; Feed it chunks of any size."""
+
+    def __init__(self, trailer=False, library=None):
+        self._library = _load(library)
+        self._decoder = _Decoder()
+        self._frame = _Frame()
+        self._consumed = ctypes.c_size_t()
+        self._library.P2PHost_Init(ctypes.byref(self._decoder), 1 if trailer else 0)
+
+    @property
+    def statistics(self):
+        """The frame, malformed, CRC error and lost frame counts."""
+        s = self._decoder.statistics
+        return {"frames": s.frames, "malformed": s.malformed, "crc_errors": s.crc_errors, "lost": s.lost}
+
+    def feed(self, chunk):
+        """Yields the frames completed by the chunk."""
+        length = len(chunk)
+        buffer = ctypes.create_string_buffer(bytes(chunk), length)
+        address = ctypes.addressof(buffer)
+        offset = 0
+        while offset < length:
+            found = self._library.P2PHost_Decode(ctypes.byref(self._decoder), address + offset, length - offset,
+                                                 ctypes.byref(self._consumed), ctypes.byref(self._frame))
+            offset += self._consumed.value
+            if not found:
+                break
+            yield self._convert()
+
+    def _convert(self):
+        frame = ctypes.byref(self._frame)
+        a, b = (ctypes.c_double * 4)(), (ctypes.c_double * 3)()
+        c = (ctypes.c_double * 3)()
+        values = None
+        if self._library.P2PHost_SensorsRaw(frame, b, c):
+            values = (tuple(b), tuple(c))
+        elif self._library.P2PHost_Rpy(frame, b):
+            values = tuple(b)
+        elif self._library.P2PHost_Quaternion(frame, a):
+            values = tuple(a)
+        elif self._library.P2PHost_QuaternionRpy(frame, a, b):
+            values = (tuple(a), tuple(b))
+        data = ctypes.string_at(self._frame.data, self._frame.length)
+        return Frame(self._frame.type, self._frame.sequence, data, values)
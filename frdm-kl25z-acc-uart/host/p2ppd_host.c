@@ -0,0 +1,221 @@
+/*
+ * p2ppd_host.c
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#include "p2ppd_host.h"
+#include "comm/crc16.h"
+
+/**
+ * @brief The number of bytes of the sequence number in the trailer
+ */
+#define SEQUENCE_LENGTH		(P2PPE_TRAILER_LENGTH - 2)
+
+/**
+ * @brief Initializes a host decoder
+ * @param[out] decoder The decoder
+ * @param[in] trailer Nonzero if the frames carry the sequence and CRC-16 trailer
+ */
+void P2PHost_Init(p2phost_decoder_t *const decoder, uint8_t trailer)
+{
+	P2PPD_Init(&decoder->decoder, decoder->buffer, P2PHOST_MAX_PAYLOAD);
+	decoder->trailer = trailer;
+	decoder->synchronized = 0;
+	decoder->next_sequence = 0;
+	decoder->statistics.frames = 0;
+	decoder->statistics.malformed = 0;
+	decoder->statistics.crc_errors = 0;
+	decoder->statistics.lost = 0;
+}
+
+/**
+ * @brief Reads a little endian value of the trailer
+ * @param[in] data The first byte
+ * @param[in] count The number of bytes
+ * @return The value
+ */
+static uint16_t readTrailer(const uint8_t *const data, uint8_t count)
+{
+	uint16_t value = 0;
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		value |= (uint16_t)data[i] << (8*i);
+	}
+	return value;
+}
+
+/**
+ * @brief Checks and strips the trailer of a decoded payload
+ * @param[inout] decoder The decoder
+ * @param[inout] length The payload length; Reduced by the trailer length.
+ * @param[out] sequence The sequence number
+ * @return Nonzero if the CRC matched
+ */
+static int checkTrailer(p2phost_decoder_t *const decoder, uint8_t *const length, uint16_t *const sequence)
+{
+	if (*length < P2PPE_TRAILER_LENGTH) return 0;
+
+	const uint8_t payload = *length - 2;
+	const uint16_t crc = readTrailer(&decoder->buffer[payload], 2);
+	if (crc != CRC16_Update(CRC16_INITIAL, decoder->buffer, payload)) return 0;
+
+	*sequence = readTrailer(&decoder->buffer[payload - SEQUENCE_LENGTH], SEQUENCE_LENGTH);
+	*length = payload - SEQUENCE_LENGTH;
+
+	/* count the frames missing since the last one; The sequence wraps at its width */
+	if (decoder->synchronized)
+	{
+		const uint16_t mask = (uint16_t)((1u << P2PPE_SEQUENCE_BITS) - 1);
+		decoder->statistics.lost += (uint16_t)(*sequence - decoder->next_sequence) & mask;
+	}
+	decoder->next_sequence = *sequence + 1;
+	decoder->synchronized = 1;
+	return 1;
+}
+
+/**
+ * @brief Decodes the next frame from a chunk of the byte stream
+ * @param[inout] decoder The decoder
+ * @param[in] data The chunk
+ * @param[in] length The chunk length in bytes
+ * @param[out] consumed The number of bytes consumed, up to the end of the frame or the chunk
+ * @param[out] frame The decoded frame; Only valid if the return value is nonzero.
+ * @return Nonzero if a frame was decoded
+ */
+int P2PHost_Decode(p2phost_decoder_t *const decoder, const uint8_t *const data, size_t length, size_t *const consumed, p2phost_frame_t *const frame)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		const p2ppd_result_t result = P2PPD_Decode(&decoder->decoder, data[i]);
+		if (P2PPD_ERROR == result)
+		{
+			++decoder->statistics.malformed;
+			continue;
+		}
+		if (P2PPD_FRAME != result) continue;
+
+		uint8_t payload = decoder->decoder.count;
+		uint16_t sequence = 0;
+		if (decoder->trailer && !checkTrailer(decoder, &payload, &sequence))
+		{
+			++decoder->statistics.crc_errors;
+			continue;
+		}
+		if (0 == payload)
+		{
+			++decoder->statistics.malformed;
+			continue;
+		}
+
+		frame->type = decoder->buffer[0];
+		frame->length = payload - 1;
+		frame->sequence = sequence;
+		frame->data = &decoder->buffer[1];
+		++decoder->statistics.frames;
+
+		*consumed = i + 1;
+		return 1;
+	}
+
+	*consumed = length;
+	return 0;
+}
+
+/**
+ * @brief Fetches the decoder counters
+ * @param[in] decoder The decoder
+ * @return The counters
+ */
+const p2phost_statistics_t* P2PHost_Statistics(const p2phost_decoder_t *const decoder)
+{
+	return &decoder->statistics;
+}
+
+/**
+ * @brief Converts a fix16 value of a frame
+ * @param[in] frame The frame
+ * @param[in] index The index of the value, counting fix16 values from the start of the data
+ * @return The value; Zero if the frame is too short.
+ *
+ * The firmware sends in its native, little endian byte order.
+ */
+double P2PHost_Fix16(const p2phost_frame_t *const frame, size_t index)
+{
+	const size_t offset = 4 * index;
+	if (offset + 4 > frame->length) return 0;
+
+	const uint8_t *const bytes = &frame->data[offset];
+	const uint32_t raw = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	return (int32_t)raw / 65536.0;
+}
+
+/**
+ * @brief Converts consecutive fix16 values of a frame of a given type and size
+ * @param[in] frame The frame
+ * @param[in] type The expected type
+ * @param[in] first The index of the first value
+ * @param[in] count The number of values
+ * @param[in] total The number of fix16 values of a frame of this type
+ * @param[out] values The values
+ * @return Nonzero if the frame is of the type and size
+ */
+static int fetchValues(const p2phost_frame_t *const frame, uint8_t type, size_t first, size_t count, size_t total, double *const values)
+{
+	if (frame->type != type || frame->length != 4 * total) return 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		values[i] = P2PHost_Fix16(frame, first + i);
+	}
+	return 1;
+}
+
+/**
+ * @brief Fetches the data of a raw sensor frame (output mode 0)
+ * @param[in] frame The frame
+ * @param[out] accelerometer The prepared accelerometer data, x, y and z
+ * @param[out] magnetometer The prepared magnetometer data, x, y and z
+ * @return Nonzero if the frame is a raw sensor frame
+ */
+int P2PHost_SensorsRaw(const p2phost_frame_t *const frame, double accelerometer[3], double magnetometer[3])
+{
+	return fetchValues(frame, 0, 0, 3, 6, accelerometer)
+		&& fetchValues(frame, 0, 3, 3, 6, magnetometer);
+}
+
+/**
+ * @brief Fetches the angles of an angle frame (output mode 42)
+ * @param[in] frame The frame
+ * @param[out] rpy The roll, pitch and yaw angles in radians
+ * @return Nonzero if the frame is an angle frame
+ */
+int P2PHost_Rpy(const p2phost_frame_t *const frame, double rpy[3])
+{
+	return fetchValues(frame, 42, 0, 3, 3, rpy);
+}
+
+/**
+ * @brief Fetches the orientation of a quaternion frame (output mode 43)
+ * @param[in] frame The frame
+ * @param[out] quaternion The orientation as w, x, y and z
+ * @return Nonzero if the frame is a quaternion frame
+ */
+int P2PHost_Quaternion(const p2phost_frame_t *const frame, double quaternion[4])
+{
+	return fetchValues(frame, 43, 0, 4, 4, quaternion);
+}
+
+/**
+ * @brief Fetches the orientation and the angles of a quaternion and angle frame (output mode 44)
+ * @param[in] frame The frame
+ * @param[out] quaternion The orientation as w, x, y and z
+ * @param[out] rpy The roll, pitch and yaw angles in radians
+ * @return Nonzero if the frame is a quaternion and angle frame
+ */
+int P2PHost_QuaternionRpy(const p2phost_frame_t *const frame, double quaternion[4], double rpy[3])
+{
+	return fetchValues(frame, 44, 0, 4, 7, quaternion)
+		&& fetchValues(frame, 44, 4, 3, 7, rpy);
+}
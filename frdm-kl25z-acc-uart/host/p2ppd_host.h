@@ -0,0 +1,146 @@
+/*
+ * p2ppd_host.h
+ *
+ * Host-side streaming decoder of the P2PPE frames sent by the firmware.
+ * Wraps the firmware decoder (p2pprotocol.c) to consume arbitrary chunks of
+ * the byte stream without allocations, optionally checks the sequence and
+ * CRC-16 trailer (IO_FRAMING_P2PPE_TRAILER), and provides typed accessors
+ * for the fused output frames.
+ *
+ * Build the shared library with "make host-decoder"; See host/p2ppd.py for
+ * the Python wrapper. Decoders are independent, so one per board can be fed
+ * from as many threads.
+ *
+ *  Created on: Mar 10, 2014
+ *      Author: Markus
+ */
+
+#ifndef P2PPD_HOST_H_
+#define P2PPD_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "comm/p2pprotocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The largest payload a frame can announce
+ */
+#define P2PHOST_MAX_PAYLOAD			(255)
+
+/**
+ * @brief A decoded frame
+ *
+ * The data points into the decoder and is valid until the decoder is fed again.
+ */
+typedef struct {
+	uint8_t type;					/*< The frame type, i.e. the first payload byte; The output mode for fused output frames */
+	uint8_t length;					/*< The number of data bytes following the type, without the trailer */
+	uint16_t sequence;				/*< The sequence number if the frames carry a trailer, zero otherwise */
+	const uint8_t *data;			/*< The data following the type */
+} p2phost_frame_t;
+
+/**
+ * @brief The decoder counters
+ */
+typedef struct {
+	uint32_t frames;				/*< The number of frames returned */
+	uint32_t malformed;				/*< The number of frames dropped by the P2PPE decoder */
+	uint32_t crc_errors;			/*< The number of frames dropped because of a trailer CRC mismatch */
+	uint32_t lost;					/*< The number of frames missing according to the gaps in the sequence */
+} p2phost_statistics_t;
+
+/**
+ * @brief State of a host decoder
+ *
+ * The firmware decoder points into the buffer, so the state must not be copied.
+ */
+typedef struct {
+	p2ppd_decoder_t decoder;		/*< The firmware decoder */
+	uint8_t buffer[P2PHOST_MAX_PAYLOAD];	/*< The payload buffer */
+	uint8_t trailer;				/*< Nonzero if the frames carry the sequence and CRC-16 trailer */
+	uint8_t synchronized;			/*< Nonzero once a sequence number was seen */
+	uint16_t next_sequence;			/*< The expected sequence number */
+	p2phost_statistics_t statistics;	/*< The counters */
+} p2phost_decoder_t;
+
+/**
+ * @brief Initializes a host decoder
+ * @param[out] decoder The decoder
+ * @param[in] trailer Nonzero if the frames carry the sequence and CRC-16 trailer, see {@see P2PPE_EncodeFrameTrailed()}
+ */
+void P2PHost_Init(p2phost_decoder_t *const decoder, uint8_t trailer);
+
+/**
+ * @brief Decodes the next frame from a chunk of the byte stream
+ * @param[inout] decoder The decoder
+ * @param[in] data The chunk
+ * @param[in] length The chunk length in bytes
+ * @param[out] consumed The number of bytes consumed, up to the end of the frame or the chunk
+ * @param[out] frame The decoded frame; Only valid if the return value is nonzero.
+ * @return Nonzero if a frame was decoded
+ *
+ * Call with the remaining bytes of the chunk until it returns zero; A frame that is
+ * split across chunks is completed by the next chunk. Frames without a type byte and,
+ * with a trailer, frames failing the CRC are counted and skipped.
+ */
+int P2PHost_Decode(p2phost_decoder_t *const decoder, const uint8_t *const data, size_t length, size_t *const consumed, p2phost_frame_t *const frame);
+
+/**
+ * @brief Fetches the decoder counters
+ * @param[in] decoder The decoder
+ * @return The counters
+ */
+const p2phost_statistics_t* P2PHost_Statistics(const p2phost_decoder_t *const decoder);
+
+/**
+ * @brief Converts a fix16 value of a frame
+ * @param[in] frame The frame
+ * @param[in] index The index of the value, counting fix16 values from the start of the data
+ * @return The value; Zero if the frame is too short.
+ */
+double P2PHost_Fix16(const p2phost_frame_t *const frame, size_t index);
+
+/**
+ * @brief Fetches the data of a raw sensor frame (output mode 0)
+ * @param[in] frame The frame
+ * @param[out] accelerometer The prepared accelerometer data, x, y and z
+ * @param[out] magnetometer The prepared magnetometer data, x, y and z
+ * @return Nonzero if the frame is a raw sensor frame
+ */
+int P2PHost_SensorsRaw(const p2phost_frame_t *const frame, double accelerometer[3], double magnetometer[3]);
+
+/**
+ * @brief Fetches the angles of an angle frame (output mode 42)
+ * @param[in] frame The frame
+ * @param[out] rpy The roll, pitch and yaw angles in radians
+ * @return Nonzero if the frame is an angle frame
+ */
+int P2PHost_Rpy(const p2phost_frame_t *const frame, double rpy[3]);
+
+/**
+ * @brief Fetches the orientation of a quaternion frame (output mode 43)
+ * @param[in] frame The frame
+ * @param[out] quaternion The orientation as w, x, y and z
+ * @return Nonzero if the frame is a quaternion frame
+ */
+int P2PHost_Quaternion(const p2phost_frame_t *const frame, double quaternion[4]);
+
+/**
+ * @brief Fetches the orientation and the angles of a quaternion and angle frame (output mode 44)
+ * @param[in] frame The frame
+ * @param[out] quaternion The orientation as w, x, y and z
+ * @param[out] rpy The roll, pitch and yaw angles in radians
+ * @return Nonzero if the frame is a quaternion and angle frame
+ */
+int P2PHost_QuaternionRpy(const p2phost_frame_t *const frame, double quaternion[4], double rpy[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* P2PPD_HOST_H_ */
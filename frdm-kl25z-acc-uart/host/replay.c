@@ -0,0 +1,590 @@
+/*
+* replay.c
+*
+* Host-side replay benchmark of the sensor fusion.
+* Feeds a recorded stream of raw MPU6050/HMC5883L samples through the same
+* prepare/predict/update sequence as the firmware main loop, measures the
+* throughput and optionally compares the outputs against a golden run.
+*
+* Build with "make host-replay"; The input is a capture log recorded by host/p2plog.py
+* or a text file as written by matlab/export_replay_data.m.
+*
+*  Created on: Mar 9, 2014
+*      Author: Markus
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fixmath.h"
+#include "fixvector3d.h"
+#include "fusion/gyro_bias.h"
+#include "fusion/sensor_fusion.h"
+#include "fusion/sensor_prepare.h"
+#include "capture_frame.h"
+#include "p2plog.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/************************************************************************/
+/* Sensor configuration, matches init_sensors.c                         */
+/************************************************************************/
+
+/*!
+* \brief MPU6050 accelerometer scaler (ACC_FS_4)
+*/
+static const fix16_t mpu6050_accelerometer_scaler = F16(8192);
+
+/*!
+* \brief MPU6050 gyroscope scaler (GYRO_FS_2000)
+*/
+static const fix16_t mpu6050_gyroscope_scaler = F16(16.4);
+
+/*!
+* \brief HMC5883L magnetometer scaler (GN_1090_1p3Ga)
+*/
+static const fix16_t hmc5883l_magnetometer_scaler = F16(1090);
+
+/************************************************************************/
+/* Replay data                                                          */
+/************************************************************************/
+
+/*!
+* \brief A recorded sample
+*/
+typedef struct {
+    char sensor;            //!< 'm' for MPU6050 accelerometer + gyroscope, 'h' for HMC5883L
+    double time;            //!< The sample time in seconds
+    int16_t raw[6];         //!< The raw sensor values; x, y, z (accelerometer, then gyroscope for the MPU6050)
+} replay_sample_t;
+
+/*!
+* \brief The fusion output after an MPU6050 sample
+*/
+typedef struct {
+    double time;            //!< The sample time in seconds
+    double q[4];            //!< The orientation quaternion (w, x, y, z)
+    double rpy[3];          //!< Roll, pitch and yaw in radians
+} replay_output_t;
+
+/*!
+* \brief Loads a replay file
+* \param[in] path The file path
+* \param[out] count The number of samples loaded
+* \return The samples or NULL on error
+*
+* Each line is either "mpu <time> <ax> <ay> <az> <gx> <gy> <gz>" or "hmc <time> <mx> <my> <mz>",
+* with the time in seconds and the raw, decoded register values. Lines starting with '#' are ignored.
+*/
+static replay_sample_t *load_samples(const char *const path, size_t *const count)
+{
+    FILE *const file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    replay_sample_t *samples = malloc(capacity * sizeof(replay_sample_t));
+    *count = 0;
+
+    char line[256];
+    unsigned int line_number = 0;
+    while (NULL != samples && NULL != fgets(line, sizeof(line), file))
+    {
+        ++line_number;
+        if ('#' == line[0] || '\n' == line[0]) continue;
+
+        replay_sample_t sample;
+        char sensor[4];
+        int v[6];
+        const int fields = sscanf(line, "%3s %lf %d %d %d %d %d %d", sensor, &sample.time, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]);
+
+        if (0 == strcmp(sensor, "mpu") && 8 == fields)
+        {
+            sample.sensor = 'm';
+        }
+        else if (0 == strcmp(sensor, "hmc") && 5 == fields)
+        {
+            sample.sensor = 'h';
+            v[3] = v[4] = v[5] = 0;
+        }
+        else
+        {
+            fprintf(stderr, "%s:%u: malformed sample\n", path, line_number);
+            continue;
+        }
+
+        for (int i = 0; i < 6; ++i)
+        {
+            sample.raw[i] = (int16_t)v[i];
+        }
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            replay_sample_t *const grown = realloc(samples, capacity * sizeof(replay_sample_t));
+            if (NULL == grown) free(samples);
+            samples = grown;
+            if (NULL == samples) break;
+        }
+        samples[(*count)++] = sample;
+    }
+
+    fclose(file);
+    if (NULL == samples) fprintf(stderr, "out of memory\n");
+    return samples;
+}
+
+/*!
+* \brief Checks whether a file is a capture log
+* \param[in] path The file path
+* \return Nonzero if the file starts with {\ref P2PLOG_MAGIC}
+*/
+static int is_capture_log(const char *const path)
+{
+    char magic[sizeof(P2PLOG_MAGIC) - 1];
+
+    FILE *const file = fopen(path, "rb");
+    if (NULL == file) return 0;
+    const size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    return (sizeof(magic) == read) && (0 == memcmp(magic, P2PLOG_MAGIC, sizeof(magic)));
+}
+
+/*!
+* \brief Reads the next capture frame of a log, skipping all other frames
+* \param[in] log The log
+* \param[inout] cursor The log cursor
+* \return The frame or NULL at the end of the log
+*/
+static const capture_frame_t *next_capture(const p2plog_reader_t *const log, size_t *const cursor)
+{
+    p2plog_frame_t frame;
+    while (P2PLog_Next(log, cursor, &frame))
+    {
+        if (CAPTURE_FRAME_TYPE != frame.type || frame.length < CAPTURE_FRAME_SIZE(0)) continue;
+
+        const capture_frame_t *const capture = (const capture_frame_t*)frame.data;
+        if (capture->count > CAPTURE_MAX_SAMPLES || frame.length < CAPTURE_FRAME_SIZE(capture->count)) continue;
+        return capture;
+    }
+    return NULL;
+}
+
+/*!
+* \brief Loads the samples of the capture frames in a log
+* \param[in] path The file path
+* \param[out] count The number of samples loaded
+* \return The samples or NULL on error
+*
+* A batch read from the MPU6050 FIFO may be split over several frames, which all carry the
+* timestamp of the last sample of the batch. The samples before it are placed at the sample
+* period, estimated over the whole log from the sequence numbers; The HMC5883L sample flagged
+* fresh is placed at the first sample of its batch.
+*/
+static replay_sample_t *load_capture(const char *const path, size_t *const count)
+{
+    p2plog_reader_t log;
+    if (0 != P2PLog_Open(&log, path))
+    {
+        fprintf(stderr, "%s: cannot read the capture log\n", path);
+        return NULL;
+    }
+
+    // first pass: the sample count and the sample period from the first and last batch
+    size_t capacity = 0;
+    int64_t elapsed = 0, samples_elapsed = 0;
+    uint32_t first_stamp = 0, last_stamp = 0;
+    uint16_t last_end = 0;
+    int first_batch = 1;
+
+    size_t cursor = P2PLog_Begin(&log);
+    const capture_frame_t *capture;
+    for (int first = 1; NULL != (capture = next_capture(&log, &cursor)); first = 0)
+    {
+        capacity += capture->count + ((capture->flags & CAPTURE_FLAG_COMPASS_FRESH) ? 1 : 0);
+
+        const uint16_t end = (uint16_t)(capture->sequence + capture->count - 1);
+        if (!first && capture->timestamp != first_stamp) first_batch = 0;
+        if (first_batch)
+        {
+            first_stamp = capture->timestamp;
+        }
+        else
+        {
+            elapsed += (uint32_t)(capture->timestamp - last_stamp);
+            samples_elapsed += (uint16_t)(end - last_end);
+        }
+        last_stamp = capture->timestamp;
+        last_end = end;
+    }
+    const double period = (samples_elapsed > 0) ? 1e-6 * (double)elapsed / (double)samples_elapsed : 1e-3;
+
+    replay_sample_t *const samples = malloc((capacity > 0 ? capacity : 1) * sizeof(replay_sample_t));
+    *count = 0;
+    if (NULL == samples)
+    {
+        fprintf(stderr, "out of memory\n");
+        P2PLog_Close(&log);
+        return NULL;
+    }
+
+    // second pass: the samples, batch by batch
+    double batch_time = 0;
+    uint32_t previous_stamp = 0;
+    cursor = P2PLog_Begin(&log);
+    capture = next_capture(&log, &cursor);
+    for (int first = 1; NULL != capture; first = 0)
+    {
+        const uint32_t stamp = capture->timestamp;
+        if (!first) batch_time += 1e-6 * (double)(uint32_t)(stamp - previous_stamp);
+        previous_stamp = stamp;
+
+        // the batch ends with the last of the consecutive frames stamped alike
+        uint16_t end = (uint16_t)(capture->sequence + capture->count - 1);
+        size_t ahead = cursor;
+        const capture_frame_t *next;
+        while (NULL != (next = next_capture(&log, &ahead)) && stamp == next->timestamp)
+        {
+            end = (uint16_t)(next->sequence + next->count - 1);
+        }
+
+        do
+        {
+            if (capture->flags & CAPTURE_FLAG_COMPASS_FRESH)
+            {
+                replay_sample_t *const sample = &samples[(*count)++];
+                sample->sensor = 'h';
+                sample->time = batch_time - period * (uint16_t)(end - capture->sequence);
+                for (int i = 0; i < 3; ++i)
+                {
+                    sample->raw[i] = capture->compass[i];
+                    sample->raw[3 + i] = 0;
+                }
+            }
+
+            for (uint8_t s = 0; s < capture->count; ++s)
+            {
+                replay_sample_t *const sample = &samples[(*count)++];
+                sample->sensor = 'm';
+                sample->time = batch_time - period * (uint16_t)(end - (uint16_t)(capture->sequence + s));
+                for (int i = 0; i < 3; ++i)
+                {
+                    sample->raw[i] = capture->samples[s].accel[i];
+                    sample->raw[3 + i] = capture->samples[s].gyro[i];
+                }
+            }
+
+            capture = next_capture(&log, &cursor);
+        } while (NULL != capture && stamp == capture->timestamp);
+    }
+
+    P2PLog_Close(&log);
+    return samples;
+}
+
+/*!
+* \brief Loads a golden output file as written by {\ref write_outputs}
+* \param[in] path The file path
+* \param[out] count The number of outputs loaded
+* \return The outputs or NULL on error
+*/
+static replay_output_t *load_outputs(const char *const path, size_t *const count)
+{
+    FILE *const file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    replay_output_t *outputs = malloc(capacity * sizeof(replay_output_t));
+    *count = 0;
+
+    char line[256];
+    while (NULL != outputs && NULL != fgets(line, sizeof(line), file))
+    {
+        if ('#' == line[0]) continue;
+
+        replay_output_t output;
+        if (8 != sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf", &output.time,
+            &output.q[0], &output.q[1], &output.q[2], &output.q[3],
+            &output.rpy[0], &output.rpy[1], &output.rpy[2])) continue;
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            replay_output_t *const grown = realloc(outputs, capacity * sizeof(replay_output_t));
+            if (NULL == grown) free(outputs);
+            outputs = grown;
+            if (NULL == outputs) break;
+        }
+        outputs[(*count)++] = output;
+    }
+
+    fclose(file);
+    return outputs;
+}
+
+/*!
+* \brief Writes the fusion outputs
+* \param[in] path The file path
+* \param[in] outputs The outputs
+* \param[in] count The number of outputs
+*/
+static void write_outputs(const char *const path, const replay_output_t *const outputs, const size_t count)
+{
+    FILE *const file = fopen(path, "w");
+    if (NULL == file)
+    {
+        perror(path);
+        return;
+    }
+
+    fprintf(file, "# time qw qx qy qz roll pitch yaw\n");
+    for (size_t i = 0; i < count; ++i)
+    {
+        const replay_output_t *const o = &outputs[i];
+        fprintf(file, "%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n", o->time,
+            o->q[0], o->q[1], o->q[2], o->q[3], o->rpy[0], o->rpy[1], o->rpy[2]);
+    }
+
+    fclose(file);
+}
+
+/************************************************************************/
+/* Replay                                                               */
+/************************************************************************/
+
+/*!
+* \brief Converts the sample time to the wrapping microsecond timestamps of the fusion
+* \param[in] sample The sample
+* \return The timestamp
+*/
+static uint32_t replay_timestamp(const replay_sample_t *const sample)
+{
+    return (uint32_t)(uint64_t)llround(sample->time * 1e6);
+}
+
+/*!
+* \brief Runs the samples through the fusion, in the order of the firmware main loop
+* \param[in] samples The samples
+* \param[in] count The number of samples
+* \param[out] outputs The outputs, one per MPU6050 sample; May be NULL.
+* \return The number of MPU6050 samples fused
+*/
+static size_t replay(const replay_sample_t *const samples, const size_t count, replay_output_t *const outputs)
+{
+    size_t fused = 0;
+    double last_time = (count > 0) ? samples[0].time : 0;
+
+    sensor_prepare_initialize(mpu6050_accelerometer_scaler, mpu6050_gyroscope_scaler, hmc5883l_magnetometer_scaler);
+    fusion_initialize();
+    gyro_bias_initialize();
+
+    // the capture format carries no temperature
+    const fix16_t temperature = F16(25);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const replay_sample_t *const sample = &samples[i];
+
+        // magnetometer readings are picked up by the next update
+        if ('h' == sample->sensor)
+        {
+            v3d mag;
+            sensor_prepare_hmc5883l_data(&mag, sample->raw[0], sample->raw[1], sample->raw[2]);
+            fusion_set_magnetometer_v3d(&mag, replay_timestamp(sample));
+            continue;
+        }
+
+        const fix16_t deltaT = fix16_from_dbl(sample->time - last_time);
+        last_time = sample->time;
+
+        fusion_predict(deltaT);
+
+        v3d gyro, acc;
+        sensor_prepare_mpu6050_gyroscope_data(&gyro, sample->raw[3], sample->raw[4], sample->raw[5]);
+        gyro_bias_correct(&gyro, temperature);
+        fusion_set_gyroscope_v3d(&gyro, replay_timestamp(sample));
+        sensor_prepare_mpu6050_accelerometer_data(&acc, sample->raw[0], sample->raw[1], sample->raw[2]);
+        fusion_set_accelerometer_v3d(&acc, replay_timestamp(sample));
+        gyro_bias_update(&gyro, &acc, temperature);
+
+        fusion_update(deltaT);
+
+        if (NULL != outputs)
+        {
+            replay_output_t *const o = &outputs[fused];
+
+            qf16 orientation;
+            fix16_t roll, pitch, yaw;
+            fusion_fetch_quaternion(&orientation);
+            fusion_fetch_angles(&roll, &pitch, &yaw);
+
+            o->time = sample->time;
+            o->q[0] = fix16_to_dbl(orientation.a);
+            o->q[1] = fix16_to_dbl(orientation.b);
+            o->q[2] = fix16_to_dbl(orientation.c);
+            o->q[3] = fix16_to_dbl(orientation.d);
+            o->rpy[0] = fix16_to_dbl(roll);
+            o->rpy[1] = fix16_to_dbl(pitch);
+            o->rpy[2] = fix16_to_dbl(yaw);
+        }
+
+        ++fused;
+    }
+
+    return fused;
+}
+
+/*!
+* \brief Wraps an angle difference to [-pi..pi]
+*/
+static double wrap_angle(double angle)
+{
+    while (angle > M_PI) angle -= 2 * M_PI;
+    while (angle < -M_PI) angle += 2 * M_PI;
+    return angle;
+}
+
+/*!
+* \brief Compares the outputs against a golden run and prints the deltas
+* \return Nonzero if the deltas exceed the tolerance
+*/
+static int compare_outputs(const replay_output_t *const outputs, const size_t count, const replay_output_t *const golden, const size_t golden_count, const double tolerance)
+{
+    if (count != golden_count)
+    {
+        printf("golden run has %zu outputs, replay has %zu\n", golden_count, count);
+        return 1;
+    }
+
+    double max_q = 0, max_angle = 0, rms_angle = 0;
+    size_t worst = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // q and -q describe the same orientation
+        double same = 0, flipped = 0;
+        for (int j = 0; j < 4; ++j)
+        {
+            same = fmax(same, fabs(outputs[i].q[j] - golden[i].q[j]));
+            flipped = fmax(flipped, fabs(outputs[i].q[j] + golden[i].q[j]));
+        }
+        max_q = fmax(max_q, fmin(same, flipped));
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const double delta = fabs(wrap_angle(outputs[i].rpy[j] - golden[i].rpy[j]));
+            rms_angle += delta * delta;
+            if (delta > max_angle)
+            {
+                max_angle = delta;
+                worst = i;
+            }
+        }
+    }
+    rms_angle = sqrt(rms_angle / (3.0 * (count > 0 ? count : 1)));
+
+    printf("quaternion delta: max %.6f\n", max_q);
+    printf("angle delta:      max %.6f rad (at t=%.3f s), rms %.6f rad\n", max_angle, (count > 0) ? outputs[worst].time : 0.0, rms_angle);
+
+    return (max_angle > tolerance) ? 1 : 0;
+}
+
+/*!
+* \brief Prints the usage
+*/
+static void usage(const char *const name)
+{
+    fprintf(stderr, "usage: %s [-n repetitions] [-m mode] [-o output] [-g golden] [-t tolerance] samples\n", name);
+    fprintf(stderr, "  mode: 0 = Kalman, 1 = complementary, 2 = hybrid\n");
+    fprintf(stderr, "  samples: a capture log recorded by host/p2plog.py or a text file from matlab/export_replay_data.m\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *golden_path = NULL;
+    const char *output_path = NULL;
+    const char *samples_path = NULL;
+    int repetitions = 10;
+    int mode = FUSION_MODE_KALMAN;
+    double tolerance = 0.01;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-n") && i + 1 < argc) repetitions = atoi(argv[++i]);
+        else if (0 == strcmp(argv[i], "-m") && i + 1 < argc) mode = atoi(argv[++i]);
+        else if (0 == strcmp(argv[i], "-o") && i + 1 < argc) output_path = argv[++i];
+        else if (0 == strcmp(argv[i], "-g") && i + 1 < argc) golden_path = argv[++i];
+        else if (0 == strcmp(argv[i], "-t") && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if ('-' != argv[i][0] && NULL == samples_path) samples_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (NULL == samples_path || repetitions < 1 || 0 != fusion_set_mode((fusion_mode_t)mode))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t count;
+    replay_sample_t *const samples = is_capture_log(samples_path) ? load_capture(samples_path, &count) : load_samples(samples_path, &count);
+    if (NULL == samples) return 2;
+
+    // reference pass, recording the outputs
+    replay_output_t *const outputs = malloc((count > 0 ? count : 1) * sizeof(replay_output_t));
+    if (NULL == outputs)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    const size_t fused = replay(samples, count, outputs);
+
+    // timed passes
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < repetitions; ++i)
+    {
+        replay(samples, count, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + 1e-9 * (double)(end.tv_nsec - start.tv_nsec);
+    const double rate = (seconds > 0) ? ((double)fused * repetitions / seconds) : 0;
+    printf("%s engine, mode %d: %zu MPU6050 samples, %zu total, %d repetitions in %.3f s: %.0f samples/s\n",
+        (FUSION_ENGINE == FUSION_ENGINE_JOINT) ? "joint" : "dual", mode, fused, count, repetitions, seconds, rate);
+
+    if (NULL != output_path)
+    {
+        write_outputs(output_path, outputs, fused);
+    }
+
+    int result = 0;
+    if (NULL != golden_path)
+    {
+        size_t golden_count;
+        replay_output_t *const golden = load_outputs(golden_path, &golden_count);
+        result = (NULL == golden) ? 2 : compare_outputs(outputs, fused, golden, golden_count, tolerance);
+        free(golden);
+    }
+
+    free(outputs);
+    free(samples);
+    return result;
+}
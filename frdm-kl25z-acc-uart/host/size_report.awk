@@ -0,0 +1,267 @@
+# size_report.awk
+#
+# Per-module flash and SRAM usage from the GNU ld map file, and a static
+# worst-case stack estimate from the -fstack-usage files along the call graph
+# of the disassembly, checked against the size budget; See "make size-report".
+#
+# Usage: awk -v modules="object.o=module ..." [-v nesting=2] [-v update=1] \
+#            -f host/size_report.awk budget.txt image.map *.su image.dis
+#
+# The call graph follows direct branches and function addresses in the literal
+# pools, which covers the long calls into SRAM and, conservatively, the callbacks;
+# Calls through computed pointers are not followed. The estimate stacks the deepest
+# call chain of main and the 'nesting' deepest interrupt handlers with their
+# exception frames.
+#
+# Exits nonzero if a figure exceeds its budget. With update=1, prints the budget
+# file with the module figures of this build instead, keeping the totals.
+
+BEGIN {
+    count = split(modules, pairs, " ")
+    for (i = 1; i <= count; ++i) {
+        split(pairs[i], pair, "=")
+        module_of[pair[1]] = pair[2]
+    }
+
+    # the modules reported even if empty, in this order
+    module_count = split("fusion libfixmath libfixmatrix libfixkalman drivers comm app toolchain", module_order, " ")
+
+    if (nesting == "") nesting = 2
+    exception_frame = 32
+
+    # the output sections by memory; .data and .ramfunc are loaded from flash
+    count = split(".vectortable .cfmconfig .text .ARM.extab .exidx .ctors .dtors .preinit_array .init_array .fini_array .data .ramfunc", list, " ")
+    for (i = 1; i <= count; ++i) flash_section[list[i]] = 1
+    count = split(".mtb .ramfunc .data .bss", list, " ")
+    for (i = 1; i <= count; ++i) sram_section[list[i]] = 1
+}
+
+# converts a hexadecimal number with or without the 0x prefix
+function hex(text,    value, i, digit) {
+    sub(/^0[xX]/, "", text)
+    value = 0
+    for (i = 1; i <= length(text); ++i) {
+        digit = index("0123456789abcdef", tolower(substr(text, i, 1)))
+        if (digit == 0) break
+        value = value * 16 + digit - 1
+    }
+    return value
+}
+
+# maps an object file of the map file to its module
+function module_name(object,    base) {
+    if (object ~ /\.a\(/) return "toolchain"
+    base = object
+    gsub(/.*[\/\\]/, "", base)
+    if (base in module_of) return module_of[base]
+    return "toolchain"
+}
+
+function add_input(section, size, object,    module, bytes) {
+    module = module_name(object)
+    bytes = hex(size)
+    if (section in flash_section) flash[module] += bytes
+    if (section in sram_section) sram[module] += bytes
+}
+
+function add_output(section, size) {
+    if (section in flash_section) total_flash += hex(size)
+    if (section in sram_section) total_sram += hex(size)
+}
+
+# the deepest stack use of a call chain starting at a function
+function depth(function_name,    best, i, d) {
+    if (function_name in memo) return memo[function_name]
+    if (function_name in visiting) {
+        recursive[function_name] = 1
+        return 0
+    }
+
+    visiting[function_name] = 1
+    best = 0
+    for (i = 1; i <= callee_count[function_name]; ++i) {
+        d = depth(callee[function_name, i])
+        if (d > best) best = d
+    }
+    delete visiting[function_name]
+
+    if (!(function_name in frame)) unknown[function_name] = 1
+    memo[function_name] = frame[function_name] + best
+    return memo[function_name]
+}
+
+function add_edge(caller, target) {
+    if (target == caller || ((caller, target) in edge)) return
+    edge[caller, target] = 1
+    callee[caller, ++callee_count[caller]] = target
+}
+
+FNR == 1 {
+    kind = "budget"
+    if (FILENAME ~ /\.map$/) kind = "map"
+    else if (FILENAME ~ /\.su$/) kind = "su"
+    else if (FILENAME ~ /\.dis$/) kind = "dis"
+}
+
+# budget: "module flash sram", "total flash sram" and "stack bytes"; "-" is unbudgeted
+kind == "budget" {
+    budget_line[++budget_lines] = $0
+    if ($0 ~ /^[ \t]*(#|$)/) next
+    budget_flash[$1] = $2
+    budget_sram[$1] = $3
+    next
+}
+
+kind == "map" {
+    if (!in_map) {
+        if ($0 ~ /^Linker script and memory map/) in_map = 1
+        next
+    }
+
+    # output section, the size either on the same or on the next line
+    if ($0 ~ /^[._A-Za-z]/) {
+        section = $1
+        pending_output = (NF == 1)
+        pending_input = 0
+        if (NF >= 3 && $2 ~ /^0x/ && $3 ~ /^0x/) add_output(section, $3)
+        next
+    }
+    if (pending_output) {
+        pending_output = 0
+        if ($1 ~ /^0x/ && $2 ~ /^0x/) add_output(section, $2)
+        next
+    }
+
+    # input section, the address, size and object either on the same or on the next line
+    if ($0 ~ /^ (\.|COMMON)/) {
+        pending_input = (NF == 1)
+        if (NF >= 4 && $2 ~ /^0x/ && $3 ~ /^0x/) add_input(section, $3, $4)
+        next
+    }
+    if (pending_input) {
+        pending_input = 0
+        if (NF >= 3 && $1 ~ /^0x/ && $2 ~ /^0x/) add_input(section, $2, $3)
+    }
+    next
+}
+
+# stack usage: "file.c:line:column:function<TAB>bytes<TAB>qualifiers"
+kind == "su" {
+    split($0, field, "\t")
+    name = field[1]
+    sub(/.*:/, "", name)
+    bytes = field[2] + 0
+    if (!(name in frame) || bytes > frame[name]) frame[name] = bytes
+    if (field[3] ~ /dynamic/ && field[3] !~ /bounded/) unbounded[name] = 1
+
+    object = FILENAME
+    gsub(/.*[\/\\]/, "", object)
+    sub(/\.su$/, ".o", object)
+    module = (object in module_of) ? module_of[object] : "toolchain"
+    if (bytes > max_frame[module]) max_frame[module] = bytes
+    next
+}
+
+kind == "dis" {
+    # function header: "00000470 <fusion_update>:"
+    if ($0 ~ /^[0-9a-fA-F]+ <[^>]+>:$/) {
+        current = $2
+        gsub(/[<>:]/, "", current)
+        function_at[hex($1)] = current
+        next
+    }
+    if (current == "") next
+
+    # direct calls and tail calls to other functions; Branches within a function carry an offset
+    if ($0 ~ /\t(bl|blx|b|b\.n|b\.w)\t/ && match($0, /<[^>+]+>/)) {
+        add_edge(current, substr($0, RSTART + 1, RLENGTH - 2))
+        next
+    }
+
+    # literal pool words, resolved once all function addresses are known
+    if ($0 ~ /\t\.word\t0x/) {
+        literal_function[++literal_count] = current
+        literal_value[literal_count] = $NF
+    }
+    next
+}
+
+END {
+    # Thumb function addresses have the lowest bit set
+    for (i = 1; i <= literal_count; ++i) {
+        address = hex(literal_value[i])
+        if ((address % 2) == 1 && ((address - 1) in function_at)) add_edge(literal_function[i], function_at[address - 1])
+    }
+
+    root = ("Reset_Handler" in callee_count) ? "Reset_Handler" : "main"
+    main_depth = depth(root)
+
+    # the deepest interrupt handlers
+    handler_count = 0
+    for (address in function_at) {
+        name = function_at[address]
+        if (name ~ /_Handler$/ && name != "Reset_Handler") handlers[++handler_count] = name
+    }
+    for (i = 1; i <= handler_count; ++i) {
+        for (j = i + 1; j <= handler_count; ++j) {
+            if (depth(handlers[j]) > depth(handlers[i])) {
+                name = handlers[i]; handlers[i] = handlers[j]; handlers[j] = name
+            }
+        }
+    }
+    stack = main_depth
+    nested = ""
+    for (i = 1; i <= nesting && i <= handler_count; ++i) {
+        stack += depth(handlers[i]) + exception_frame
+        nested = nested sprintf(" + %s %d", handlers[i], depth(handlers[i]) + exception_frame)
+    }
+
+    if (update) {
+        for (i = 1; i <= budget_lines; ++i) {
+            split(budget_line[i], field, " ")
+            if (budget_line[i] ~ /^[ \t]*(#|$)/ || field[1] == "total" || field[1] == "stack") print budget_line[i]
+            else printf "%-16s %8d %8d\n", field[1], flash[field[1]], sram[field[1]]
+            printed[field[1]] = 1
+        }
+        for (i = 1; i <= module_count; ++i) {
+            name = module_order[i]
+            if (!(name in printed)) printf "%-16s %8d %8d\n", name, flash[name], sram[name]
+        }
+        exit 0
+    }
+
+    failed = 0
+    printf "%-16s %8s %8s %12s %12s %10s\n", "module", "flash", "sram", "flash budget", "sram budget", "max frame"
+    total_modules_flash = total_modules_sram = 0
+    for (i = 1; i <= module_count; ++i) {
+        name = module_order[i]
+        printf "%-16s %8d %8d %12s %12s %10d\n", name, flash[name], sram[name], budget_flash[name], budget_sram[name], max_frame[name]
+        failed += check(name " flash", flash[name], budget_flash[name])
+        failed += check(name " SRAM", sram[name], budget_sram[name])
+    }
+    printf "%-16s %8d %8d %12s %12s\n", "total", total_flash, total_sram, budget_flash["total"], budget_sram["total"]
+    failed += check("total flash", total_flash, budget_flash["total"])
+    failed += check("total SRAM", total_sram, budget_sram["total"])
+
+    printf "\nstack estimate: %d bytes (%s %d%s), budget %s\n", stack, root, main_depth, nested, budget_flash["stack"]
+    failed += check("stack", stack, budget_flash["stack"])
+
+    names = ""
+    for (name in recursive) names = names " " name
+    if (names != "") print "recursion, counted once:" names
+    names = ""
+    for (name in unbounded) names = names " " name
+    if (names != "") print "dynamic stack, not bounded:" names
+    count = 0
+    for (name in unknown) ++count
+    if (count > 0) printf "no stack usage for %d functions of the chains (toolchain or assembly), counted as 0\n", count
+
+    if (failed) exit 1
+}
+
+function check(what, value, budget) {
+    if (budget == "" || budget == "-") return 0
+    if (value + 0 <= budget + 0) return 0
+    printf "size-report: %s %d exceeds the budget of %d bytes\n", what, value, budget > "/dev/stderr"
+    return 1
+}
@@ -0,0 +1,72 @@
+function [payload, valid, stats] = checkFrameTrailer(payload, sequenceBits)
+% CHECKFRAMETRAILER Verifies and strips the sequence and CRC trailer of a frame
+%   [payload, valid, stats] = checkFrameTrailer(payload) checks a P2PPE
+%   payload sent with framing 2 (see sendCommand.m, command 14): The frame
+%   ends with the sequence number (uint16) and the CRC-16 over everything
+%   before it, both little endian. The trailer is removed from payload.
+%   valid is false if the CRC does not match; Such frames must be dropped.
+%
+%   checkFrameTrailer(payload, 8) expects 8 bit sequence numbers, as sent
+%   by firmware built with P2PPE_SEQUENCE_BITS 8.
+%
+%   stats counts the frames received, corrupted and lost (gaps in the
+%   sequence numbers) since the last reset; checkFrameTrailer() resets them.
+
+persistent counters expectedSequence
+
+if nargin == 0 || isempty(counters)
+    counters = struct('received', 0, 'corrupted', 0, 'lost', 0);
+    expectedSequence = [];
+    if nargin == 0
+        payload = [];
+        valid = false;
+        stats = counters;
+        return;
+    end
+end
+if nargin < 2, sequenceBits = 16; end
+
+payload = uint8(payload(:)');
+sequenceLength = sequenceBits / 8;
+valid = false;
+
+if numel(payload) < sequenceLength + 2
+    counters.corrupted = counters.corrupted + 1;
+    stats = counters;
+    return;
+end
+
+% CRC-16/CCITT as calculated by comm/crc16.c
+body = payload(1:end-2);
+crc = uint16(65535);
+for byte = body
+    crc = bitxor(crc, bitshift(uint16(byte), 8));
+    for bit = 1:8
+        if bitand(crc, uint16(32768))
+            crc = bitxor(bitshift(crc, 1), uint16(4129));
+        else
+            crc = bitshift(crc, 1);
+        end
+    end
+end
+received = uint16(payload(end-1)) + bitshift(uint16(payload(end)), 8);
+
+if crc ~= received
+    counters.corrupted = counters.corrupted + 1;
+    stats = counters;
+    return;
+end
+
+% sequence number; a gap means frames were lost or dropped by the board
+sequence = double(body(end-sequenceLength+1:end)) * (256 .^ (0:sequenceLength-1))';
+if ~isempty(expectedSequence)
+    counters.lost = counters.lost + mod(sequence - expectedSequence, 2^sequenceBits);
+end
+expectedSequence = mod(sequence + 1, 2^sequenceBits);
+
+counters.received = counters.received + 1;
+payload = body(1:end-sequenceLength);
+valid = true;
+stats = counters;
+
+end
@@ -0,0 +1,122 @@
+function [frames, remainder, errors] = cobsDecode(stream)
+% COBSDECODE Decodes COBS framed data received from the board
+%   [frames, remainder, errors] = cobsDecode(stream) splits the received
+%   bytes at the zero delimiters and decodes the frames as documented in
+%   comm/cobs.h. frames is a cell array of payloads (type byte first,
+%   without the CRC); Frames with a wrong CRC or a malformed encoding are
+%   dropped and counted in errors.
+%
+%   remainder holds the bytes after the last delimiter, which belong to a
+%   frame not yet complete; Prepend it to the next chunk of data:
+%       [frames, rest] = cobsDecode([rest; fread(s, s.BytesAvailable)]);
+%
+%   The stream is processed per frame and per COBS block rather than per
+%   byte; The CRCs of all frames are calculated at once.
+
+stream = uint8(stream(:)');
+delimiters = find(stream == 0);
+
+if isempty(delimiters)
+    frames = {};
+    remainder = stream;
+    errors = 0;
+    return;
+end
+
+remainder = stream(delimiters(end)+1:end);
+
+% frame boundaries, skipping empty frames between consecutive delimiters
+starts = [1, delimiters(1:end-1) + 1];
+stops  = delimiters - 1;
+keep   = stops >= starts;
+starts = starts(keep);
+stops  = stops(keep);
+
+decoded = cell(1, numel(starts));
+valid   = false(1, numel(starts));
+for i = 1:numel(starts)
+    encoded = stream(starts(i):stops(i));
+    n = numel(encoded);
+
+    % follow the chain of code bytes; each one is replaced by the zero it stands for
+    isCode = false(1, n);
+    position = 1;
+    lastCode = 0;
+    while position <= n
+        isCode(position) = true;
+        lastCode = double(encoded(position));
+        position = position + lastCode;
+    end
+
+    % the last block must end exactly at the delimiter
+    if position ~= n + 1
+        continue;
+    end
+
+    % zeros are implied after every block except full ones and the last one
+    codes = find(isCode);
+    implied = double(encoded(codes(1:end-1))) ~= 255;
+    out = encoded;
+    out(codes) = 0;
+    drop = codes([true, ~implied]);
+    out(drop) = [];
+
+    if numel(out) >= 2
+        decoded{i} = out;
+        valid(i) = true;
+    end
+end
+
+decoded = decoded(valid);
+errors = sum(~valid);
+
+% check the CRCs of all frames at once, one byte position per iteration
+lengths = cellfun(@numel, decoded) - 2;
+crc = crc16(decoded, lengths);
+received = cellfun(@(f) uint16(f(end-1)) + bitshift(uint16(f(end)), 8), decoded);
+ok = (crc == received);
+
+errors = errors + sum(~ok);
+frames = cellfun(@(f) f(1:end-2), decoded(ok), 'UniformOutput', false);
+
+end
+
+function crc = crc16(frames, lengths)
+% CRC16 CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) of the
+% first lengths(i) bytes of frames{i}, as calculated by comm/crc16.c
+
+persistent table
+if isempty(table)
+    table = zeros(1, 256, 'uint16');
+    for i = 0:255
+        value = bitshift(uint16(i), 8);
+        for bit = 1:8
+            if bitand(value, uint16(32768))
+                value = bitxor(bitshift(value, 1), uint16(4129));
+            else
+                value = bitshift(value, 1);
+            end
+        end
+        table(i+1) = value;
+    end
+end
+
+count = numel(frames);
+crc = repmat(uint16(65535), 1, count);
+if count == 0
+    return;
+end
+
+% pad the frames into a matrix with one frame per row
+data = zeros(count, max(lengths), 'uint8');
+for i = 1:count
+    data(i, 1:lengths(i)) = frames{i}(1:lengths(i));
+end
+
+for column = 1:size(data, 2)
+    rows = lengths >= column;
+    index = bitxor(bitshift(crc(rows), -8), uint16(data(rows, column)')) + 1;
+    crc(rows) = bitxor(bitshift(crc(rows), 8), table(index));
+end
+
+end
@@ -0,0 +1,59 @@
+function [q, rpy] = decodeCompactOutput(type, payload)
+% DECODECOMPACTOUTPUT Decodes the compact fused output frames
+%   [q, rpy] = decodeCompactOutput(type, payload) decodes the payload of a
+%   frame of the given type (without the type byte) as documented in
+%   fusion/output_encoding.h:
+%       45 = quaternion in smallest-three format
+%       46 = roll, pitch, yaw as 16 bit binary angles
+%       47 = quaternion delta against the previous frame
+%       48 = quaternion key frame in Q1.15
+%
+%   q is the quaternion [w x y z], rpy the angles [roll pitch yaw] in
+%   radians; Values not contained in the frame are empty. Delta frames
+%   return an empty q until a key frame was seen and after a gap in the
+%   sequence numbers.
+
+persistent reference expectedSequence
+
+q = [];
+rpy = [];
+payload = uint8(payload(:)');
+
+switch type
+    case 45
+        bits = uint64(0);
+        for i = 1:6
+            bits = bitor(bits, bitshift(uint64(payload(i)), 8*(i-1)));
+        end
+
+        largest = double(bitshift(bits, -45)) + 1;
+        q = zeros(1, 4);
+        shift = -30;
+        for i = 1:4
+            if i == largest, continue; end
+            value = double(bitand(bitshift(bits, shift), uint64(32767)));
+            if value >= 16384, value = value - 32768; end
+            q(i) = value / 16383 / sqrt(2);
+            shift = shift + 15;
+        end
+        q(largest) = sqrt(max(0, 1 - sum(q.^2)));
+
+    case 46
+        rpy = double(typecast(payload(1:6), 'int16')) * pi / 32768;
+
+    case 48
+        reference = double(typecast(payload(2:9), 'int16'));
+        expectedSequence = mod(double(payload(1)) + 1, 256);
+        q = reference / 32767;
+
+    case 47
+        if isempty(reference) || isempty(expectedSequence) || double(payload(1)) ~= expectedSequence
+            reference = [];
+            return;
+        end
+        reference = reference + double(typecast(payload(2:5), 'int8'));
+        expectedSequence = mod(expectedSequence + 1, 256);
+        q = reference / 32767;
+end
+
+end
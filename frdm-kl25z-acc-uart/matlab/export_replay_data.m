@@ -0,0 +1,58 @@
+function export_replay_data(filename, accScaling, gyroScaling, compassScaling)
+% EXPORT_REPLAY_DATA Writes the sensor data buffers as input for the host replay benchmark
+%   export_replay_data(filename) exports the buffers captured by serial_test.m
+%   (or loaded from the files written by save_sensor_data.m) to a text file
+%   that can be fed to the host/replay.c benchmark ("make host-replay").
+%
+%   export_replay_data(filename, accScaling, gyroScaling, compassScaling)
+%   uses the given scalings instead of those assumed by serial_test.m.
+%
+%   The buffers hold scaled and axis-swapped values; both are undone, so
+%   that the file contains the decoded raw register values:
+%       mpu <time> <ax> <ay> <az> <gx> <gy> <gz>
+%       hmc <time> <mx> <my> <mz>
+
+if nargin < 2, accScaling = 8192; end
+if nargin < 3, gyroScaling = 131; end
+if nargin < 4, compassScaling = 1090; end
+
+% fetch data
+global accelBuffer gyroBuffer compassBuffer
+
+% undo the axis swapping of serial_test.m
+mpu = [
+    accelBuffer(:, 1), ...
+     accelBuffer(:, 3) * accScaling, ...
+    -accelBuffer(:, 2) * accScaling, ...
+    -accelBuffer(:, 4) * accScaling, ...
+     gyroBuffer(:, 3) * gyroScaling, ...
+    -gyroBuffer(:, 2) * gyroScaling, ...
+     gyroBuffer(:, 4) * gyroScaling
+    ];
+
+hmc = [
+    compassBuffer(:, 1), ...
+    compassBuffer(:, 2) * compassScaling, ...
+    compassBuffer(:, 4) * compassScaling, ...
+    compassBuffer(:, 3) * compassScaling
+    ];
+
+% merge by time
+samples = [ones(size(mpu, 1), 1), mpu; 2*ones(size(hmc, 1), 1), hmc, zeros(size(hmc, 1), 3)];
+[~, order] = sort(samples(:, 2));
+samples = samples(order, :);
+
+disp(['Exporting ' num2str(size(samples, 1)) ' samples to ' filename]);
+
+file = fopen(filename, 'w');
+fprintf(file, '# exported by export_replay_data.m\n');
+for i = 1:size(samples, 1)
+    if samples(i, 1) == 1
+        fprintf(file, 'mpu %.6f %d %d %d %d %d %d\n', samples(i, 2), round(samples(i, 3:8)));
+    else
+        fprintf(file, 'hmc %.6f %d %d %d\n', samples(i, 2), round(samples(i, 3:5)));
+    end
+end
+fclose(file);
+
+end
@@ -0,0 +1,100 @@
+function sendCommand(s, command, args, framing)
+% SENDCOMMAND Sends a P2PPE or COBS framed command to the board
+%   sendCommand(s, command) sends the command without arguments.
+%   sendCommand(s, command, args) sends the command followed by the
+%   argument bytes args, e.g. typecast(uint16(50), 'uint8').
+%   sendCommand(s, command, args, 'cobs') sends it COBS framed with a
+%   CRC (see comm/cobs.h) instead. The board accepts both at any time.
+%
+%   Commands (see comm/command.h):
+%       1 = set output mode (uint8)
+%       2 = set run mode (uint8; 'F', 'R' or 'C')
+%       3 = set output period in ms (uint16, at least 1; frames that exceed
+%           the UART bandwidth are dropped)
+%       4 = set filter parameter (uint8 parameter, fix16 value)
+%       5 = start streaming
+%       6 = stop streaming
+%       7 = request statistics (answered with a statistics and an
+%           instrumentation frame, see cpu/instrument.h)
+%       8 = set calibration row (uint8 sensor, uint8 row, fix16 x4)
+%       9 = set variances (uint8 sensor, fix16 x3)
+%      10 = save calibration and filter parameters to flash
+%      11 = erase the stored parameters
+%      12 = start the magnetometer calibration (rotate the board in all directions)
+%      13 = finish the magnetometer calibration; fits, applies and stores it
+%      14 = set the framing of sent frames (uint8; 0 = P2PPE, 1 = COBS,
+%           2 = P2PPE with sequence and CRC trailer); the acknowledge
+%           already uses the new framing, see cobsDecode.m and
+%           checkFrameTrailer.m
+%      15 = set the baud rate (uint32, e.g. 1000000 or 3000000); acknowledged
+%           at the old rate, reopen the port at the new one afterwards
+%      16 = set the fusion mode (uint8; 0 = Kalman, 1 = complementary,
+%           2 = complementary corrected by the Kalman filter every 10th sample)
+%      17 = set the performance preset (uint8; 0 = 1 kHz low latency,
+%           1 = 200 Hz balanced, 2 = 50 Hz low power); also sets the
+%           output period, see init_sensors.h
+%
+%   Sensors are 0 = accelerometer, 1 = gyroscope, 2 = magnetometer; fix16
+%   values are typecast(int32(round(value * 65536)), 'uint8').
+%
+%   The board answers with an acknowledge frame of type 17 holding the
+%   command and the status (0 = OK, 1 = unknown, 2 = length, 3 = value,
+%   4 = failed).
+
+if nargin < 3, args = uint8([]); end
+if nargin < 4, framing = 'p2ppe'; end
+
+SOH     = uint8(1);
+EOT     = uint8(4);
+ESC     = uint8(27);
+ESC_XOR = uint8(66);
+
+payload = [uint8(command), uint8(args(:)')];
+
+if strcmpi(framing, 'cobs')
+    fwrite(s, cobsEncode(payload), 'uint8');
+    return;
+end
+
+% escape the payload
+encoded = uint8([]);
+for byte = payload
+    if byte == EOT || byte == ESC
+        encoded = [encoded, ESC, bitxor(byte, ESC_XOR)];
+    else
+        encoded = [encoded, byte];
+    end
+end
+
+frame = [uint8([218 122]), SOH, uint8(numel(payload)), encoded, EOT];
+fwrite(s, frame, 'uint8');
+
+end
+
+function frame = cobsEncode(payload)
+% COBSENCODE Appends the CRC-16 to the payload and COBS encodes it;
+% Commands are shorter than 254 bytes, so there are no full blocks.
+
+crc = uint16(65535);
+for byte = payload
+    crc = bitxor(crc, bitshift(uint16(byte), 8));
+    for bit = 1:8
+        if bitand(crc, uint16(32768))
+            crc = bitxor(bitshift(crc, 1), uint16(4129));
+        else
+            crc = bitshift(crc, 1);
+        end
+    end
+end
+data = [payload, uint8(bitand(crc, 255)), uint8(bitshift(crc, -8))];
+
+% replace every zero by the distance to the next one
+frame = uint8([]);
+start = 1;
+for stop = [find(data == 0), numel(data) + 1]
+    frame = [frame, uint8(stop - start + 1), data(start:stop-1)];
+    start = stop + 1;
+end
+frame = [frame, uint8(0)];
+
+end
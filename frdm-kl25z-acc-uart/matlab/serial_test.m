@@ -40,6 +40,9 @@ function serial_test
     disp('Connecting to serial port ...');
     fopen(s);
     disp('Connected to serial port.');
+    
+    % Switch the board to raw sensor data transmission
+    sendCommand(s, 2, uint8('R'));
 
     % Prepare plot
     figureHandle = figure('NumberTitle', 'off', ...
@@ -128,6 +131,10 @@ function serial_test
     sensorDataCount = zeros(4,1);
     totalDataCount = 0;
     
+    % capture frame sequence tracking
+    nextCaptureSequence = NaN;
+    droppedSamples = 0;
+    
     % data buffers
     BUFFER_STEP_SIZE = 1000;
     global accelBuffer gyroBuffer compassBuffer temperatureBuffer
@@ -248,6 +255,79 @@ function serial_test
                         compassBuffer = [compassBuffer; zeros(BUFFER_STEP_SIZE, 4)];
                     end
                     compassBuffer(sensorDataCount(COMPASS), 1:4) = [timestamp; compassXYZ];
+                    
+                elseif type == 4
+                    % Decode raw sensor capture frame
+                    accScaling     = 8192; %16384 for 2g mode
+                    gyroScaling    = 131; %131 in 250/s mode
+                    compassScaling = 1090;
+                    
+                    sequence    = double(typecast(data(2:3), 'uint16'));
+                    timestamp   = double(typecast(data(4:7), 'uint32')) * 1E-6; % device time
+                    sampleCount = double(data(8));
+                    flags       = data(9);
+                    
+                    % a gap in the sequence means dropped samples
+                    if ~isnan(nextCaptureSequence) && sequence ~= nextCaptureSequence
+                        droppedSamples = droppedSamples + mod(sequence - nextCaptureSequence, 65536);
+                        disp(sprintf('Dropped samples: %d', droppedSamples));
+                    end
+                    nextCaptureSequence = mod(sequence + sampleCount, 65536);
+                    
+                    % the compass sample is repeated until fresh data was read
+                    if bitand(flags, 1)
+                        sensorDataCount(COMPASS) = sensorDataCount(COMPASS) + 1;
+                        compassXYZ = [
+                             double(typecast(data(10:11), 'int16'));
+                             double(typecast(data(14:15), 'int16')); % because of an error in my driver, these axes
+                             double(typecast(data(12:13), 'int16')); % need to be flipped for the HMC5883L
+                            ] / compassScaling;
+                        
+                        % attach data to buffer
+                        if mod(sensorDataCount(COMPASS), BUFFER_STEP_SIZE) == 0
+                            compassBuffer = [compassBuffer; zeros(BUFFER_STEP_SIZE, 4)];
+                        end
+                        compassBuffer(sensorDataCount(COMPASS), 1:4) = [timestamp; compassXYZ];
+                    end
+                    
+                    % samples of a FIFO batch share the timestamp of its last sample
+                    for i = 0:sampleCount-1
+                        offset = 16 + i*12;
+                        sensorDataCount(ACCELEROMETER) = sensorDataCount(ACCELEROMETER) + 1;
+                        sensorDataCount(GYROSCOPE)     = sensorDataCount(GYROSCOPE) + 1;
+                        
+                        % Swapping components due to orientation on my board
+                        accXYZ = [
+                            -double(typecast(data(offset+2:offset+3), 'int16'));
+                             double(typecast(data(offset+0:offset+1), 'int16'));
+                            -double(typecast(data(offset+4:offset+5), 'int16')); % invert Z axis for MPU6050
+                            ] / accScaling;
+                        gyroXYZ = [
+                            -double(typecast(data(offset+8:offset+9),   'int16'));
+                             double(typecast(data(offset+6:offset+7),   'int16'));
+                             double(typecast(data(offset+10:offset+11), 'int16'));
+                            ] / gyroScaling;
+                        
+                        % attach data to buffer
+                        if mod(sensorDataCount(ACCELEROMETER), BUFFER_STEP_SIZE) == 0
+                            accelBuffer = [accelBuffer; zeros(BUFFER_STEP_SIZE, 4)];
+                        end
+                        accelBuffer(sensorDataCount(ACCELEROMETER), 1:4) = [timestamp; accXYZ];
+                        
+                        % attach data to buffer
+                        if mod(sensorDataCount(GYROSCOPE), BUFFER_STEP_SIZE) == 0
+                            gyroBuffer = [gyroBuffer; zeros(BUFFER_STEP_SIZE, 4)];
+                        end
+                        gyroBuffer(sensorDataCount(GYROSCOPE), 1:4) = [timestamp; gyroXYZ];
+                    end
+                    
+                elseif type == 17
+                    % Command acknowledge
+                    if data(3) ~= 0
+                        disp(sprintf('Command %d rejected with status %d', data(2), data(3)));
+                    end
+                    continue;
+                    
                 else
                     disp('unknown sensor type');
                     continue;
@@ -309,6 +389,9 @@ function serial_test
     function cleanUp()
         disp('Cleaning up ...');
         
+        % Switch the board back to sensor fusion
+        sendCommand(s, 2, uint8('F'));
+        
         % Closing the port
         fclose(s);
         delete(s);
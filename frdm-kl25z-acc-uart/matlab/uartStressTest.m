@@ -0,0 +1,106 @@
+function passed = uartStressTest(s, count, window)
+% UARTSTRESSTEST Checks that no byte is lost with RX and TX at full load
+%   passed = uartStressTest(s) sends 1000 commands to the board in bursts
+%   at the full baud rate of the serial port s while the board streams its
+%   output, and verifies that every command is acknowledged and that every
+%   received frame is intact.
+%
+%   passed = uartStressTest(s, count, window) sends count commands and
+%   keeps at most window of them unacknowledged, so that the board's 128
+%   byte receive buffer cannot overflow by design; Loss therefore points to
+%   the drivers, not to the test.
+%
+%   Frames are exchanged COBS framed with CRC (see cobsDecode.m). The test
+%   command sets the output period to 1 ms to keep the transmitter busy;
+%   The board is switched back to P2PPE framing afterwards.
+
+if nargin < 2, count = 1000; end
+if nargin < 3, window = 16; end
+
+SET_OUTPUT_PERIOD = 3;
+START_STREAMING   = 5;
+REQUEST_STATS     = 7;
+SET_FRAMING       = 14;
+ACK_TYPE          = 17;
+STATS_TYPE        = 18;
+
+flushinput(s);
+sendCommand(s, SET_FRAMING, uint8(1), 'cobs');
+sendCommand(s, START_STREAMING, [], 'cobs');
+pause(0.1);
+flushinput(s);
+
+% the command statistics before the test
+stats = requestStats();
+receivedBefore = stats(1);
+framingErrorsBefore = stats(3);
+
+% a harmless command with a short acknowledge, so that RX and TX are balanced
+command = [SET_OUTPUT_PERIOD, typecast(uint16(1), 'uint8')];
+
+rest = uint8([]);
+sent = 0;
+acknowledged = 0;
+corrupted = 0;
+failed = 0;
+deadline = tic;
+while acknowledged < count && toc(deadline) < 10
+    % top up the window in one burst
+    burst = min(window - (sent - acknowledged), count - sent);
+    for i = 1:burst
+        sendCommand(s, command(1), command(2:end), 'cobs');
+    end
+    sent = sent + burst;
+
+    % collect the acknowledges between the streamed frames
+    if s.BytesAvailable > 0
+        [frames, rest, errors] = cobsDecode([rest, fread(s, s.BytesAvailable, 'uint8')']);
+        corrupted = corrupted + errors;
+        for i = 1:numel(frames)
+            frame = frames{i};
+            if frame(1) == ACK_TYPE && frame(2) == SET_OUTPUT_PERIOD
+                acknowledged = acknowledged + 1;
+                failed = failed + (frame(3) ~= 0);
+                deadline = tic;
+            end
+        end
+    end
+end
+
+stats = requestStats();
+lost = count - acknowledged;
+receivedCommands = stats(1) - receivedBefore - 1;
+framingErrors = stats(3) - framingErrorsBefore;
+
+sendCommand(s, SET_FRAMING, uint8(0), 'cobs');
+
+disp(['commands sent:         ' num2str(count)]);
+disp(['commands received:     ' num2str(receivedCommands)]);
+disp(['acknowledges received: ' num2str(acknowledged) ' (' num2str(failed) ' failed)']);
+disp(['framing errors (RX):   ' num2str(framingErrors)]);
+disp(['corrupted frames (TX): ' num2str(corrupted)]);
+
+passed = (lost == 0) && (failed == 0) && (receivedCommands == count) ...
+    && (framingErrors == 0) && (corrupted == 0);
+
+    function values = requestStats()
+        % received, rejected and framing errors from the statistics frame
+        sendCommand(s, REQUEST_STATS, [], 'cobs');
+        values = [];
+        pending = uint8([]);
+        started = tic;
+        while isempty(values) && toc(started) < 2
+            if s.BytesAvailable > 0
+                [statsFrames, pending] = cobsDecode([pending, fread(s, s.BytesAvailable, 'uint8')']);
+                for k = 1:numel(statsFrames)
+                    if statsFrames{k}(1) == STATS_TYPE
+                        values = double(typecast(statsFrames{k}(6:11), 'uint16'));
+                    end
+                end
+            end
+        end
+        if isempty(values)
+            error('uartStressTest:timeout', 'no statistics frame received');
+        end
+    end
+end
@@ -5,7 +5,7 @@
 BINARYDIR := Release
 
 #Additional flags
-PREPROCESSOR_MACROS := NDEBUG RELEASE FIXMATRIX_MAX_SIZE=6 KALMAN_DISABLE_C FIXMATH_NO_CACHE
+PREPROCESSOR_MACROS := NDEBUG RELEASE FIXMATRIX_MAX_SIZE=4 KALMAN_DISABLE_C FIXMATH_NO_CACHE FIX16_FAST_KERNELS PROFILE_ENABLED=0 PROFILE_BUSY_ENABLED=1 GOVERNOR_ENABLED=1
 INCLUDE_DIRS := Project_Headers drivers libraries\libfixmath libraries\libfixmatrix libraries\libfixkalman
 LIBRARY_DIRS := 
 LIBRARY_NAMES := 